@@ -0,0 +1,52 @@
+#
+#
+# Provides Google Benchmark, either from the system or downloaded, and a
+# helper macro to add benchmarks. Add make bench, as well, which runs the
+# benchmarks and writes the results as JSON to the build directory.
+#
+#
+find_package(benchmark QUIET)
+
+if(benchmark_FOUND)
+  set(GBENCHMARK_LIBRARY benchmark::benchmark)
+else()
+  include(FetchContent)
+  FetchContent_Declare(googlebenchmark
+    GIT_REPOSITORY      https://github.com/google/benchmark.git
+    GIT_TAG             v1.5.2)
+  FetchContent_GetProperties(googlebenchmark)
+  if(NOT googlebenchmark_POPULATED)
+    FetchContent_Populate(googlebenchmark)
+    set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "" FORCE)
+    set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+    set(CMAKE_SUPPRESS_DEVELOPER_WARNINGS 1 CACHE BOOL "")
+    add_subdirectory(${googlebenchmark_SOURCE_DIR} ${googlebenchmark_BINARY_DIR} EXCLUDE_FROM_ALL)
+    unset(CMAKE_SUPPRESS_DEVELOPER_WARNINGS)
+  endif()
+  set(GBENCHMARK_LIBRARY benchmark)
+  set_target_properties(benchmark PROPERTIES FOLDER "Extern")
+endif()
+
+# Target must already exist. The benchmark executable is not added to
+# CTest, as the results are timings rather than pass/fail.
+macro(add_gbenchmark BENCHNAME)
+  target_link_libraries(${BENCHNAME} PRIVATE ${GBENCHMARK_LIBRARY} gtest)
+  set_target_properties(${BENCHNAME} PROPERTIES FOLDER "Benchmarks")
+
+  add_custom_target(bench
+    COMMAND ${BENCHNAME}
+      --benchmark_out=${PROFINET_BINARY_DIR}/${BENCHNAME}.json
+      --benchmark_out_format=json
+    DEPENDS ${BENCHNAME}
+    WORKING_DIRECTORY ${PROFINET_BINARY_DIR}
+    COMMENT "Running ${BENCHNAME}, results in ${BENCHNAME}.json"
+    USES_TERMINAL)
+  set_target_properties(bench PROPERTIES FOLDER "Scripts")
+endmacro()
+
+mark_as_advanced(
+  BENCHMARK_ENABLE_TESTING
+  BENCHMARK_ENABLE_GTEST_TESTS
+  BENCHMARK_ENABLE_INSTALL
+  )
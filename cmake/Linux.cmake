@@ -21,6 +21,16 @@ if (USE_SCHED_FIFO)
   add_compile_definitions(USE_SCHED_FIFO)
 endif()
 
+include(CheckIncludeFile)
+check_include_file(sys/sdt.h HAVE_SYS_SDT_H)
+cmake_dependent_option (USE_USDT
+  "Add USDT tracepoints for bpftrace and perf. Needs sys/sdt.h"
+  ON "HAVE_SYS_SDT_H" OFF)
+
+if (USE_USDT)
+  add_compile_definitions(USE_USDT)
+endif()
+
 target_include_directories(profinet
   PRIVATE
   src/osal/linux
@@ -30,6 +40,9 @@ target_sources(profinet
   PRIVATE
   src/osal/linux/osal.c
   src/osal/linux/osal_eth.c
+  src/osal/linux/osal_log.c
+  src/osal/linux/osal_poll.c
+  src/osal/linux/osal_tcp.c
   src/osal/linux/osal_udp.c
   )
 
@@ -75,9 +88,40 @@ if (BUILD_TESTING)
   target_sources(pf_test
     PRIVATE
     ${PROFINET_SOURCE_DIR}/src/osal/linux/osal.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_log.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_poll.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_tcp.c
     )
   target_include_directories(pf_test
     PRIVATE
     src/osal/linux
     )
 endif()
+
+if (BUILD_BENCHMARKS)
+  target_sources(pf_bench
+    PRIVATE
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_log.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_poll.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_tcp.c
+    )
+  target_include_directories(pf_bench
+    PRIVATE
+    src/osal/linux
+    )
+endif()
+
+if (BUILD_SOAK)
+  target_sources(pf_soak
+    PRIVATE
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_log.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_poll.c
+    ${PROFINET_SOURCE_DIR}/src/osal/linux/osal_tcp.c
+    )
+  target_include_directories(pf_soak
+    PRIVATE
+    src/osal/linux
+    )
+endif()
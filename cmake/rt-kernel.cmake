@@ -30,6 +30,7 @@ target_sources(profinet
   PRIVATE
   src/osal/rt-kernel/osal.c
   src/osal/rt-kernel/osal_eth.c
+  src/osal/rt-kernel/osal_tcp.c
   src/osal/rt-kernel/osal_udp.c
   src/osal/rt-kernel/dwmac1000.c
   )
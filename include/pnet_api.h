@@ -52,15 +52,17 @@ extern "C"
  * the value to 1), except for parsing the RPC Connect request message and generating the
  * connect RPC Connect response message.
  */
-#define PNET_OPTION_FAST_STARTUP                               1
+#define PNET_OPTION_FAST_STARTUP                               1     /**< Cache the AR configuration of repeated connect requests, see pnet_cfg_t.fast_startup_nonvol */
 #define PNET_OPTION_PARAMETER_SERVER                           1
 #define PNET_OPTION_IR                                         1
-#define PNET_OPTION_SR                                         1
+#define PNET_OPTION_SR                                         1     /**< System redundancy AR sets, see pnet_get_sr_status() */
 #define PNET_OPTION_REDUNDANCY                                 1
 #define PNET_OPTION_AR_VENDOR_BLOCKS                           1
 #define PNET_OPTION_RS                                         1
 #define PNET_OPTION_MC_CR                                      1
 #define PNET_OPTION_SRL                                        0
+#define PNET_OPTION_METRICS                                    1     /**< Serve statistics in Prometheus text format, see pnet_cfg_t.metrics_port */
+#define PNET_OPTION_PTCP                                       1     /**< PTCP sync slave, see pnet_get_ptcp_status() */
 
 /**
  * Disable use of atomic operations (stdatomic.h).
@@ -80,10 +82,13 @@ extern "C"
  * Please note that some defines have minimum requirements.
  * These values are used as is by the stack. No validation is performed.
  */
-#define PNET_MAX_AR                                            2     /**< Number of connections. Must be > 0. "Automated RT Tester" uses 2 */
+#define PNET_MAX_AR                                            2     /**< Default number of connections, see pnet_cfg_t.max_ar. Must be > 0. "Automated RT Tester" uses 2 */
+#define PNET_MAX_AR_LIMIT                                      64    /**< Largest allowed pnet_cfg_t.max_ar */
 #define PNET_MAX_API                                           1     /**< Number of Application Processes. Must be > 0. */
 #define PNET_MAX_CR                                            2     /**< Per AR. 1 input and 1 output. */
-#ifdef MVRUNTIME
+#if defined(PNET_MAX_MODULES)
+/* Set by the build, for example for a shared device with many ARs */
+#elif defined(MVRUNTIME)
 #define PNET_MAX_MODULES                                       27	 /**< Per API. Should be > 1 to allow at least one I/O module. */
 #elif defined(READER)
 #define PNET_MAX_MODULES                                       60	 /**< Per API. Should be > 1 to allow at least one I/O module. */
@@ -950,6 +955,9 @@ typedef int (*pnet_alarm_ack_cnf)(
  * the device should not do a hard or soft reset for reset mode 1 or 2. It is
  * allowed for the factory reset case (but not mandatory).
  *
+ * This callback is called by the control-plane thread of the stack
+ * (\a PNET_THREAD_CONTROL), so it may block without delaying cyclic data.
+ *
  * @param net                       InOut: The p-net stack instance
  * @param arg                       InOut: User-defined data (not used by p-net)
  * @param should_reset_application  In:    True if the user should reset the application data.
@@ -971,6 +979,9 @@ typedef int (*pnet_reset_ind)(
  * It is optional to implement this callback (but a complianct Profinet device
  * must have a signal LED)
  *
+ * This callback is called by the control-plane thread of the stack
+ * (\a PNET_THREAD_CONTROL).
+ *
  * @param net                       InOut: The p-net stack instance
  * @param arg                       InOut: User-defined data (not used by p-net)
  * @param led_state                 In:    True if the signal LED should be on.
@@ -1228,6 +1239,22 @@ typedef struct pnet_alarm_ack
    pnet_pnio_status_t      pnio_status;			/* Application status response */
 } pnet_alarm_ack_t;
 
+/**
+ * The threads of the stack, see pnet_cfg_t.thread_cfg.
+ *
+ * Alarms are handled by pnet_handle_periodic(), so they run in the thread of
+ * the application that calls it, normally woken by the periodic timer.
+ */
+typedef enum pnet_thread
+{
+   PNET_THREAD_RX = 0,        /**< Receives Ethernet frames, including cyclic data */
+   PNET_THREAD_TIMER,         /**< Periodic timer of the application, see os_timer_create_cfg() */
+   PNET_THREAD_RPC,           /**< Receives RPC requests, if OS_USE_UDP_THREAD is set */
+   PNET_THREAD_BACKGROUND,    /**< Diagnosis writes to nonvolatile memory and the metrics endpoint */
+   PNET_THREAD_CONTROL,       /**< IP settings, nonvolatile memory and application call-backs requested by DCP */
+   PNET_THREAD_MAX
+} pnet_thread_t;
+
 /**
  * This is all the configuration needed to use the Profinet stack.
  *
@@ -1288,6 +1315,40 @@ typedef struct pnet_cfg
    char                    CIM_NonvolFilePath[MAX_NONVOL_FILE_PATH_LENGTH];
    char                    PDev_NonvolFilePath[MAX_NONVOL_FILE_PATH_LENGTH];
    char                    NonPDev_NonvolFilePath[MAX_NONVOL_FILE_PATH_LENGTH];
+   char                    Journal_NonvolFilePath[MAX_NONVOL_FILE_PATH_LENGTH]; /**< If set, all nonvolatile data is kept in this journal file instead of the files above. */
+   uint32_t                diag_nonvol_window_ms;  /**< Max delay before diag changes are written to nonvolatile memory. 0 selects the default (1000 ms). */
+   uint16_t                metrics_port;           /**< If not 0, serve metrics in Prometheus text format on this TCP port of the loopback interface. */
+
+   /**
+    * CPU set, scheduling policy, priority and stack size of each thread,
+    * indexed by pnet_thread_t. A member that is 0 keeps the default of the
+    * thread. pnet_init() fails if the receive or RPC thread cannot be
+    * created as configured. The other threads log an error.
+    */
+   os_thread_cfg_t         thread_cfg[PNET_THREAD_MAX];
+
+   /**
+    * If true, pnet_init() locks the memory of the process, faults in the
+    * stack instance, the heap and the thread stacks, and preallocates the
+    * frame buffers. See pnet_get_rt_allocations().
+    */
+   bool                    rt_startup;
+   uint16_t                rt_frame_buffers;       /**< Preallocated frame buffers if rt_startup is set. 0 selects the default (32). */
+
+   /**
+    * Number of concurrent ARs, for example for a shared device with one AR
+    * per IO-controller. The ARs, RPC sessions, timeouts and frame handlers
+    * are allocated by pnet_init() for this number. 0 selects PNET_MAX_AR.
+    * At most PNET_MAX_AR_LIMIT.
+    */
+   uint16_t                max_ar;
+
+   /**
+    * If true, the AR configuration derived from accepted connect requests
+    * is also kept in the journal, so that the first connect after a restart
+    * is fast as well. Only used if Journal_NonvolFilePath is set.
+    */
+   bool                    fast_startup_nonvol;
 } pnet_cfg_t;
 
 
@@ -1327,6 +1388,56 @@ PNET_EXPORT pnet_t* pnet_init(
 PNET_EXPORT void pnet_handle_periodic(
    pnet_t                  *net);
 
+/**
+ * Get a file descriptor for an event loop.
+ *
+ * Instead of calling pnet_handle_periodic() at a fixed tick, the application
+ * may wait until this descriptor is readable, for example with poll(), epoll
+ * or libuv, and then call pnet_process(). The descriptor becomes readable
+ * when a timeout of the stack is due, an RPC socket is readable or an alarm
+ * has been received. Ethernet frames, including cyclic data, are still
+ * received by the receive thread of the stack.
+ *
+ * The descriptor is created by the first call, and the stack then wakes up
+ * exactly when a timeout is due instead of at the tick given to pnet_init().
+ * Call this function before the first connect. The descriptor belongs to
+ * the stack. Do not read from it or close it.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @return  The file descriptor, or -1 if an error occurred or the platform
+ *          has no file descriptors.
+ */
+PNET_EXPORT int pnet_get_fd(
+   pnet_t                  *net);
+
+/**
+ * Get the time until the next timeout of the stack is due.
+ *
+ * For event loops that keep their own timers. The descriptor from
+ * pnet_get_fd() already becomes readable when the timeout is due.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_delay_us       Out:  Time until the timeout, in microseconds.
+ *                               0 if it is due now.
+ * @return  0  if a timeout is scheduled.
+ *          -1 if none is scheduled, or an error occurred.
+ */
+PNET_EXPORT int pnet_next_deadline(
+   pnet_t                  *net,
+   uint32_t                *p_delay_us);
+
+/**
+ * Do all work that is due. Call it when the descriptor from pnet_get_fd()
+ * is readable or the time from pnet_next_deadline() has passed.
+ *
+ * Does the same as pnet_handle_periodic(), and prepares the descriptor for
+ * the next event. Spurious calls are harmless.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+PNET_EXPORT void pnet_process(
+   pnet_t                  *net);
+
 /**
  * Application signals ready to exchange data.
  *
@@ -1913,6 +2024,207 @@ PNET_EXPORT void pnet_show(
    pnet_t                  *net,
    unsigned                level);
 
+/**
+ * Modules with a log level that can be changed at runtime.
+ */
+typedef enum pnet_log_module
+{
+   PNET_LOG_MODULE_ETH = 0,
+   PNET_LOG_MODULE_CPM,
+   PNET_LOG_MODULE_PPM,
+   PNET_LOG_MODULE_DCP,
+   PNET_LOG_MODULE_RPC,
+   PNET_LOG_MODULE_ALARM,
+   PNET_LOG_MODULE_AL_BUF,
+   PNET_LOG_MODULE_PNET,
+   PNET_LOG_MODULE_ALL,       /**< All modules (only for pnet_set_log_level()) */
+} pnet_log_module_t;
+
+#define PNET_LOG_LEVEL_DEBUG                 0x00
+#define PNET_LOG_LEVEL_INFO                  0x01
+#define PNET_LOG_LEVEL_WARNING               0x02
+#define PNET_LOG_LEVEL_ERROR                 0x03
+#define PNET_LOG_LEVEL_OFF                   0x04
+
+/**
+ * Set the runtime log level of a module.
+ *
+ * Messages below the level are not logged. Messages below the
+ * compile-time LOG_LEVEL are never logged, whatever the runtime level.
+ * The levels are shared by all stack instances.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param module           In:   The module, or PNET_LOG_MODULE_ALL.
+ * @param level            In:   PNET_LOG_LEVEL_DEBUG .. PNET_LOG_LEVEL_OFF.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+PNET_EXPORT int pnet_set_log_level(
+   pnet_t                  *net,
+   pnet_log_module_t       module,
+   uint8_t                 level);
+
+/**
+ * Get the runtime log level of a module.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param module           In:   The module.
+ * @param p_level          Out:  The log level.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+PNET_EXPORT int pnet_get_log_level(
+   pnet_t                  *net,
+   pnet_log_module_t       module,
+   uint8_t                 *p_level);
+
+/**
+ * Traffic classes with separate interface counters.
+ */
+typedef enum pnet_traffic_class
+{
+   PNET_TRAFFIC_CLASS_RT = 0,       /**< Cyclic RT data frames */
+   PNET_TRAFFIC_CLASS_ALARM,        /**< RT alarm frames (RTA) */
+   PNET_TRAFFIC_CLASS_DCP,
+   PNET_TRAFFIC_CLASS_LLDP,
+   PNET_TRAFFIC_CLASS_RPC,          /**< DCE/RPC over UDP. Octets are UDP payload */
+   PNET_TRAFFIC_CLASS_OTHER,        /**< Other and unknown frames */
+   PNET_TRAFFIC_CLASS_MAX
+} pnet_traffic_class_t;
+
+typedef struct pnet_traffic_stats
+{
+   uint32_t                in_packets;
+   uint32_t                in_octets;
+   uint32_t                in_discards;
+   uint32_t                in_errors;
+   uint32_t                out_packets;
+   uint32_t                out_octets;
+   uint32_t                out_discards;
+   uint32_t                out_errors;
+} pnet_traffic_stats_t;
+
+/**
+ * Interface statistics.
+ *
+ * The if* members are the totals reported in the PDPortStatistic record.
+ * All counters are 32 bits and wrap around, like the MIB-II counters.
+ */
+typedef struct pnet_interface_stats
+{
+   uint32_t                ifInOctets;
+   uint32_t                ifOutOctets;
+   uint32_t                ifInDiscards;
+   uint32_t                ifOutDiscards;
+   uint32_t                ifInErrors;
+   uint32_t                ifOutErrors;
+   pnet_traffic_stats_t    traffic[PNET_TRAFFIC_CLASS_MAX];
+} pnet_interface_stats_t;
+
+/**
+ * Read the interface statistics.
+ *
+ * The stack counts in per-thread counters, so the traffic path never
+ * waits for a reader. This function sums them. It may be called from any
+ * thread.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_stats          Out:  The statistics.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+PNET_EXPORT int pnet_get_interface_statistics(
+   pnet_t                  *net,
+   pnet_interface_stats_t  *p_stats);
+
+/**
+ * Get the number of heap allocations since the last PRMEND.
+ *
+ * Only available if pnet_cfg_t.rt_startup was set. Allocations by the
+ * stack and by the application via the OSAL are counted. In a well-behaved
+ * system the count stays 0 while data is exchanged. The stack logs a warning
+ * the first time it is not.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_count          Out:  The number of allocations.
+ * @return  0  if the operation succeeded.
+ *          -1 if rt_startup is not set or no PRMEND has been seen yet.
+ */
+PNET_EXPORT int pnet_get_rt_allocations(
+   pnet_t                  *net,
+   uint32_t                *p_count);
+
+/**
+ * States of the PTCP sync slave.
+ */
+typedef enum pnet_ptcp_state
+{
+   PNET_PTCP_STATE_LISTENING = 0,   /**< No sync master */
+   PNET_PTCP_STATE_LOCKING,         /**< Following a sync master, not yet within the limit */
+   PNET_PTCP_STATE_SYNC,            /**< Synchronized */
+} pnet_ptcp_state_t;
+
+/**
+ * Status of the PTCP sync slave.
+ */
+typedef struct pnet_ptcp_status
+{
+   pnet_ptcp_state_t       state;
+   pnet_ethaddr_t          master_addr;      /**< Valid unless LISTENING */
+   int32_t                 offset;           /**< Master minus local time at the last sync frame, after correction. Nanoseconds */
+   int32_t                 rate;             /**< Frequency correction of the local clock. ppb */
+   uint32_t                line_delay;       /**< Measured delay to the neighbour. Nanoseconds */
+   uint32_t                sync_count;       /**< Sync frames used */
+   uint32_t                step_count;       /**< Times the local clock was stepped */
+} pnet_ptcp_status_t;
+
+/**
+ * Read the status of the PTCP sync slave.
+ *
+ * The stack follows the first PTCP clock sync master it hears. Its own
+ * time is adjusted by a PI servo, with the receive timestamps of the
+ * network interface if available. The PPM and CPM align their cycles to
+ * the master once the state is PNET_PTCP_STATE_SYNC.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_status         Out:  The status.
+ * @return  0  if the operation succeeded.
+ *          -1 if PTCP is not supported.
+ */
+PNET_EXPORT int pnet_get_ptcp_status(
+   pnet_t                  *net,
+   pnet_ptcp_status_t      *p_status);
+
+/**
+ * Switchover statistics of the system redundancy AR sets.
+ */
+typedef struct pnet_sr_status
+{
+   uint32_t                switchovers;      /**< Times a backup AR has become primary */
+   uint32_t                primary_losses;   /**< Primary ARs aborted while another AR of the set was connected */
+   uint16_t                primary_arep;     /**< The AR that became primary at the last switchover. 0 if none */
+   uint64_t                last_switchover;  /**< When, on the clock of os_get_current_time_ns(). Nanoseconds */
+} pnet_sr_status_t;
+
+/**
+ * Read the switchover statistics of the system redundancy AR sets.
+ *
+ * The ARs of type IOCARSR from the two controllers of a redundant pair form
+ * an AR set. The primary AR owns the submodules, so the outputs are read
+ * from it. The backup ARs receive their outputs and send the same inputs
+ * as the primary AR, so a backup AR takes over in the cycle its controller
+ * says it is primary. The State bit of the data status of the input CRs is
+ * handled by the stack for these ARs.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_status         Out:  The statistics.
+ * @return  0  if the operation succeeded.
+ *          -1 if system redundancy is not supported.
+ */
+PNET_EXPORT int pnet_get_sr_status(
+   pnet_t                  *net,
+   pnet_sr_status_t        *p_status);
+
 PNET_EXPORT void pnet_restore_diag(
    pnet_t                  *net);
 
@@ -34,6 +34,8 @@
 #define APP_DEFAULT_ETHERNET_INTERFACE "eth0"
 #define APP_PRIORITY                   15
 #define APP_STACKSIZE                  4096        /* bytes */
+#define APP_TIMER_PRIORITY             5
+#define APP_TIMER_STACKSIZE            1024        /* bytes */
 #define APP_MAIN_SLEEPTIME_US          5000*1000
 
 
@@ -75,6 +77,7 @@ void show_usage()
    printf("   -s NAME      Set station name. Defaults to %s\n", APP_DEFAULT_STATION_NAME);
    printf("   -b FILE      Path to read button1. Defaults to not read button1.\n");
    printf("   -d FILE      Path to read button2. Defaults to not read button2.\n");
+   printf("   -c CPU       Run the stack and application threads on this CPU only.\n");
 }
 
 /**
@@ -103,9 +106,10 @@ struct cmd_args parse_commandline_arguments(int argc, char *argv[])
    strcpy(output_arguments.station_name, APP_DEFAULT_STATION_NAME);
    strcpy(output_arguments.eth_interface, APP_DEFAULT_ETHERNET_INTERFACE);
    output_arguments.verbosity = 0;
+   output_arguments.cpu = -1;
 
    int option;
-   while ((option = getopt(argc, argv, "hvi:s:b:d:")) != -1) {
+   while ((option = getopt(argc, argv, "hvi:s:b:d:c:")) != -1) {
       switch (option) {
       case 'v':
          output_arguments.verbosity++;
@@ -122,6 +126,14 @@ struct cmd_args parse_commandline_arguments(int argc, char *argv[])
       case 'd':
          strcpy(output_arguments.path_button2, optarg);
          break;
+      case 'c':
+         output_arguments.cpu = atoi(optarg);
+         if ((output_arguments.cpu < 0) || (output_arguments.cpu >= 64))
+         {
+            printf("Error: Invalid CPU number: %s\n", optarg);
+            exit(EXIT_CODE_ERROR);
+         }
+         break;
       case 'h':
          /* fallthrough */
       case '?':
@@ -432,6 +444,8 @@ int main(int argc, char *argv[])
    os_ipaddr_t             ip;
    os_ipaddr_t             netmask;
    os_ipaddr_t             gateway;
+   os_thread_cfg_t         thread_cfg;
+   int                     ix;
    int                     ret = 0;
 
    memset(&appdata, 0, sizeof(appdata));
@@ -452,6 +466,7 @@ int main(int argc, char *argv[])
       printf("Button1 file:        %s\n", appdata.arguments.path_button1);
       printf("Button2 file:        %s\n", appdata.arguments.path_button2);
       printf("Station name:        %s\n", appdata.arguments.station_name);
+      printf("CPU:                 %d\n", appdata.arguments.cpu);
    }
 
    /* Read IP, netmask, gateway and MAC address from operating system */
@@ -492,6 +507,13 @@ int main(int argc, char *argv[])
    strcpy(pnet_default_cfg.station_name, appdata.arguments.station_name);
    memcpy(pnet_default_cfg.eth_addr.addr, macbuffer.addr, sizeof(pnet_ethaddr_t));
    pnet_default_cfg.cb_arg = (void*) &appdata;
+   if (appdata.arguments.cpu >= 0)
+   {
+      for (ix = 0; ix < PNET_THREAD_MAX; ix++)
+      {
+         pnet_default_cfg.thread_cfg[ix].cpu_mask = 1ULL << appdata.arguments.cpu;
+      }
+   }
 
    app_set_led(APP_DATA_LED_ID, false);
 
@@ -529,9 +551,24 @@ int main(int argc, char *argv[])
 
    /* Initialize timer and Profinet stack */
    appdata.main_events = os_event_create();
-   appdata.main_timer  = os_timer_create(TICK_INTERVAL_US, main_timer_tick, (void*)&appdata, false);
+   thread_cfg = pnet_default_cfg.thread_cfg[PNET_THREAD_TIMER];
+   thread_cfg.priority = APP_TIMER_PRIORITY;
+   thread_cfg.stack_size = APP_TIMER_STACKSIZE;
+   appdata.main_timer  = os_timer_create_cfg(TICK_INTERVAL_US, main_timer_tick, (void*)&appdata, false, &thread_cfg);
+   if (appdata.main_timer == NULL)
+   {
+      printf("Failed to create the main timer.\n");
+      exit(EXIT_CODE_ERROR);
+   }
 
-   os_thread_create("pn_main", APP_PRIORITY, APP_STACKSIZE, pn_main, (void*)&appdata_and_stack);
+   /* pnet_handle_periodic() is called from this thread, on the timer CPUs */
+   thread_cfg.priority = APP_PRIORITY;
+   thread_cfg.stack_size = APP_STACKSIZE;
+   if (os_thread_create_cfg("pn_main", &thread_cfg, pn_main, (void*)&appdata_and_stack) == NULL)
+   {
+      printf("Failed to create the main thread.\n");
+      exit(EXIT_CODE_ERROR);
+   }
    os_timer_start(appdata.main_timer);
 
    for(;;)
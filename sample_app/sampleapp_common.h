@@ -107,6 +107,7 @@ struct cmd_args {
    char station_name[64];
    char eth_interface[64];
    int  verbosity;
+   int  cpu;               /* -1 for all CPUs */
 };
 
 typedef struct app_data_obj
@@ -156,11 +156,73 @@ void pf_alarm_show(
 
 /*****************************************************************************/
 
+/* Forward declarations */
+static int pf_alarm_apmr_high_handler(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg);
+static int pf_alarm_apmr_low_handler(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg);
+
 void pf_alarm_init(
    pnet_t                  *net)
 {
    /* Enable alarms from the start */
    net->global_alarm_enable = true;
+
+   /* Shared by all ARs, see pf_alarm_find_apmx() */
+   pf_eth_frame_id_map_add(net, PF_FRAME_ID_ALARM_LOW, pf_alarm_apmr_low_handler, NULL);
+   pf_eth_frame_id_map_add(net, PF_FRAME_ID_ALARM_HIGH, pf_alarm_apmr_high_handler, NULL);
+}
+
+/**
+ * @internal
+ * Find the APMX instance that an incoming alarm frame belongs to.
+ *
+ * The alarm frame IDs are the same for all ARs. The AR is found by the
+ * MAC address of the controller and the AlarmDstEndpoint of the frame,
+ * which is our alarm reference.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_buf            In:   The Ethernet frame buffer.
+ * @param frame_id_pos     In:   Position in the buffer of the frame id.
+ * @param prio_ix          In:   0 for low and 1 for high priority.
+ * @return  The APMX instance, or NULL if not found.
+ */
+static pf_apmx_t *pf_alarm_find_apmx(
+   pnet_t                  *net,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   uint16_t                prio_ix)
+{
+   pf_apmx_t               *p_apmx = NULL;
+   const uint8_t           *p_bytes = (const uint8_t *)p_buf->payload;
+   uint16_t                dst_ref;
+   uint16_t                ix = 0;
+
+   if (p_buf->len >= (uint16_t)(frame_id_pos + 4))
+   {
+      dst_ref = ((uint16_t)p_bytes[frame_id_pos + 2] << 8) | p_bytes[frame_id_pos + 3];
+      while ((p_apmx == NULL) && (net->cmrpc_ar != NULL) && (ix < net->max_ar))
+      {
+         if ((net->cmrpc_ar[ix].in_use == true) &&
+             (net->cmrpc_ar[ix].apmx[prio_ix].apmr_state != PF_APMR_STATE_CLOSED) &&
+             (net->cmrpc_ar[ix].apmx[prio_ix].src_ref == dst_ref) &&
+             (memcmp(&p_bytes[sizeof(pnet_ethaddr_t)], &net->cmrpc_ar[ix].apmx[prio_ix].da, sizeof(pnet_ethaddr_t)) == 0))
+         {
+            p_apmx = &net->cmrpc_ar[ix].apmx[prio_ix];
+         }
+         ix++;
+      }
+   }
+
+   return p_apmx;
 }
 
 /**
@@ -463,9 +525,9 @@ static int pf_alarm_alpmr_apmr_a_data_ind(
  * @param frame_id         In:   The Ethernet frame id.
  * @param p_buf            In:   The Ethernet frame buffer.
  * @param frame_id_pos     In:   Position in the buffer of the frame id.
- * @param p_arg            In:   The AR.
- * @return  0  if the operation succeeded.
- *          -1 if an error occurred.
+ * @param p_arg            In:   Not used.
+ * @return  1  if the frame was handled.
+ *          0  if it belongs to no AR.
  */
 static int pf_alarm_apmr_high_handler(
    pnet_t                  *net,
@@ -474,15 +536,19 @@ static int pf_alarm_apmr_high_handler(
    uint16_t                frame_id_pos,
    void                    *p_arg)
 {
-   int                     ret = 1;       /* Means "handled" */
-   pf_apmx_t               *p_apmx = (pf_apmx_t *)p_arg;
+   int                     ret = 0;       /* Means "not handled" */
+   pf_apmx_t               *p_apmx = NULL;
    pf_apmr_msg_t           *p_apmr_msg;
    uint16_t                nbr;
+   os_poll_t               *p_poll = NULL;
 
-   if (ret != 0)
+   if (p_buf != NULL)
    {
-      if (p_buf != NULL)
+      p_apmx = pf_alarm_find_apmx(net, p_buf, frame_id_pos, 1);
+      if (p_apmx != NULL)
       {
+         ret = 1;       /* Means "handled" */
+
          nbr = p_apmx->apmr_msg_nbr++;    /* ToDo: Make atomic */
          if (p_apmx->apmr_msg_nbr >= NELEMENTS(p_apmx->apmr_msg))
          {
@@ -493,8 +559,18 @@ static int pf_alarm_apmr_high_handler(
          p_apmr_msg->frame_id_pos = frame_id_pos;
          if (os_mbox_post(p_apmx->p_alarm_q, (void *)p_apmr_msg, 0) != 0)
          {
+            p_apmx->alarm_q_lost++;
             LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): Lost one alarm\n", __LINE__);
          }
+         else
+         {
+            p_apmx->alarm_q_posted++;
+            p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+            if (p_poll != NULL)
+            {
+               os_poll_wake(p_poll);   /* See pnet_get_fd() */
+            }
+         }
       }
    }
 
@@ -513,9 +589,9 @@ static int pf_alarm_apmr_high_handler(
  * @param frame_id         In:   The Ethernet frame id.
  * @param p_buf            In:   The Ethernet frame buffer.
  * @param frame_id_pos     In:   Position in the buffer of the frame id.
- * @param p_arg            In:   The AR.
- * @return  0  if the operation succeeded.
- *          -1 if an error occurred.
+ * @param p_arg            In:   Not used.
+ * @return  1  if the frame was handled.
+ *          0  if it belongs to no AR.
  */
 static int pf_alarm_apmr_low_handler(
    pnet_t                  *net,
@@ -524,15 +600,19 @@ static int pf_alarm_apmr_low_handler(
    uint16_t                frame_id_pos,
    void                    *p_arg)
 {
-   int                     ret = 1;       /* Means "handled" */
-   pf_apmx_t               *p_apmx = (pf_apmx_t *)p_arg;
+   int                     ret = 0;       /* Means "not handled" */
+   pf_apmx_t               *p_apmx = NULL;
    pf_apmr_msg_t           *p_apmr_msg;
    uint16_t                nbr;
+   os_poll_t               *p_poll = NULL;
 
-   if (ret != 0)
+   if (p_buf != NULL)
    {
-      if (p_buf != NULL)
+      p_apmx = pf_alarm_find_apmx(net, p_buf, frame_id_pos, 0);
+      if (p_apmx != NULL)
       {
+         ret = 1;       /* Means "handled" */
+
          nbr = p_apmx->apmr_msg_nbr++;    /* ToDo: Make atomic */
          if (p_apmx->apmr_msg_nbr >= NELEMENTS(p_apmx->apmr_msg))
          {
@@ -543,8 +623,18 @@ static int pf_alarm_apmr_low_handler(
          p_apmr_msg->frame_id_pos = frame_id_pos;
          if (os_mbox_post(p_apmx->p_alarm_q, (void *)p_apmr_msg, 0) != 0)
          {
+            p_apmx->alarm_q_lost++;
             LOG_ERROR(PF_ALARM_LOG, "Alarm(%d): Lost one alarm\n", __LINE__);
          }
+         else
+         {
+            p_apmx->alarm_q_posted++;
+            p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+            if (p_poll != NULL)
+            {
+               os_poll_wake(p_poll);   /* See pnet_get_fd() */
+            }
+         }
       }
    }
 
@@ -568,7 +658,7 @@ static int pf_alarm_apmr_low_handler(
 static void pf_alarm_apms_timeout(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    pf_apmx_t               *p_apmx = (pf_apmx_t *)arg;
    os_buf_t                *p_rta;
@@ -589,12 +679,12 @@ static void pf_alarm_apms_timeout(
          {
             if (os_eth_send(p_apmx->p_ar->p_sess->eth_handle, p_apmx->p_rta) <= 0)
             {
-            	net->interface_statistics.ifOutErrors++;
+               pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_ALARM);
                LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): Error from os_eth_send(rta)\n", __LINE__);
             }
             else
             {
-            	net->interface_statistics.ifOutOctects++;
+               pf_stats_out(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_ALARM, p_apmx->p_rta->len);
             }
          }
 
@@ -699,6 +789,9 @@ static int pf_alarm_apmx_activate(
          if (p_ar->apmx[ix].p_alarm_q == NULL)
          {
             p_ar->apmx[ix].p_alarm_q = os_mbox_create(PNET_MAX_ALARMS);
+            p_ar->apmx[ix].alarm_q_posted = 0;
+            p_ar->apmx[ix].alarm_q_lost = 0;
+            p_ar->apmx[ix].alarm_q_fetched = 0;
          }
          memset(p_ar->apmx[ix].apmr_msg, 0, sizeof(p_ar->apmx[ix].apmr_msg));
          p_ar->apmx[ix].apmr_msg_nbr = 0;
@@ -715,9 +808,6 @@ static int pf_alarm_apmx_activate(
       }
    }
 
-   pf_eth_frame_id_map_add(net, PF_FRAME_ID_ALARM_LOW, pf_alarm_apmr_low_handler, &p_ar->apmx[0]);
-   pf_eth_frame_id_map_add(net, PF_FRAME_ID_ALARM_HIGH, pf_alarm_apmr_high_handler, &p_ar->apmx[1]);
-
    return ret;
 }
 
@@ -749,6 +839,7 @@ static int pf_alarm_apms_a_data_ind(
       {
          if (p_fixed->ack_seq_nbr == p_apmx->send_seq_count)
          {
+            PF_TRACE2(alarm_ack, p_apmx->frame_id, p_fixed->ack_seq_nbr);
             p_apmx->send_seq_count_o = p_apmx->send_seq_count;
             p_apmx->send_seq_count = (p_apmx->send_seq_count + 1) & 0x7fff;
 
@@ -932,14 +1023,15 @@ static int pf_alarm_apms_a_data_req(
             pf_put_uint16(true, var_part_len, PF_FRAME_BUFFER_SIZE, p_buf, &var_part_len_pos);
 
             p_rta->len = pos;
+            PF_TRACE3(alarm_send, p_apmx->frame_id, p_fixed->pdu_type.type, p_fixed->send_seq_num);
             if (os_eth_send(p_apmx->p_ar->p_sess->eth_handle, p_rta) <= 0)
             {
-            	net->interface_statistics.ifOutOctects++;
+               pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_ALARM);
                LOG_ERROR(PF_ALARM_LOG, "pf_alarm(%d): Error from os_eth_send(rta)\n", __LINE__);
             }
             else
             {
-            	net->interface_statistics.ifOutErrors++;
+               pf_stats_out(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_ALARM, p_rta->len);
                ret = 0;
             }
          }
@@ -1078,9 +1170,6 @@ static int pf_alarm_apmx_close(
       }
    }
 
-   pf_eth_frame_id_map_remove(net, PF_FRAME_ID_ALARM_HIGH);
-   pf_eth_frame_id_map_remove(net, PF_FRAME_ID_ALARM_LOW);
-
    for (ix = 0; ix < NELEMENTS(p_ar->apmx); ix++)
    {
       if (p_ar->apmx[ix].apms_state != PF_APMS_STATE_CLOSED)
@@ -1495,6 +1584,7 @@ static int pf_alarm_apmr_periodic(
              (p_apmx->apmr_state != PF_APMR_STATE_CLOSED) &&
              (os_mbox_fetch(p_apmx->p_alarm_q, (void **)&p_alarm_msg, 0) == 0))
       {
+         p_apmx->alarm_q_fetched++;
          if (p_alarm_msg != NULL)
          {
             /* Got something - extract! */
@@ -1822,7 +1912,7 @@ int pf_alarm_periodic(
 
    if (net->global_alarm_enable == true)
    {
-      for (ix = 0; ix < PNET_MAX_AR; ix++)
+      for (ix = 0; ix < net->max_ar; ix++)
       {
          p_ar = pf_ar_find_by_index(net, ix);
          if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -98,7 +98,33 @@ static void pf_cpm_state_ind(
    bool                    start)
 {
    pf_cmio_cpm_state_ind(net, p_ar, crep, start);
-   pf_cmdmc_cpm_state_ind(p_ar, crep, start);
+   pf_cmdmc_cpm_state_ind(net, p_ar, crep, start);
+}
+
+/**
+ * @internal
+ * Calculate the delay to the next check of the data hold timer.
+ *
+ * When synchronized to a PTCP master, the check is done in the middle of
+ * the cycles of the master, away from the time the frames are sent.
+ * Otherwise the control interval is used.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_cpm            In:   The CPM instance.
+ * @param current_time     In:   The current device time, in nanoseconds.
+ * @return Number of microseconds of delay to use with the scheduler.
+ */
+static uint32_t pf_cpm_next_delay(
+   pnet_t                  *net,
+   const pf_cpm_t          *p_cpm,
+   uint64_t                current_time)
+{
+   uint32_t                delay = p_cpm->control_interval;
+
+   (void)pf_ptcp_phase_delay(net, current_time, p_cpm->control_interval,
+      p_cpm->control_interval / 2, &delay);
+
+   return delay;
 }
 
 /**
@@ -109,15 +135,15 @@ static void pf_cpm_state_ind(
  *
  * @param net              InOut: The p-net stack instance
  * @param arg              In:   The IOCR instance.
- * @param current_time     In:   The current device time.
+ * @param current_time     In:   The current device time, in nanoseconds.
  */
 static void pf_cpm_control_interval_expired(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    pf_iocr_t               *p_iocr = (pf_iocr_t *)arg;
-   uint32_t                start = os_get_current_time_us();
+   uint64_t                start = os_get_current_time_ns();
    uint32_t                exec;
 
    p_iocr->cpm.ci_timer = UINT32_MAX;
@@ -149,7 +175,7 @@ static void pf_cpm_control_interval_expired(
       if (p_iocr->cpm.ci_running == true)
       {
          /* Timer auto-reload */
-         if (pf_scheduler_add(net, p_iocr->cpm.control_interval, cpm_sync_name,
+         if (pf_scheduler_add(net, pf_cpm_next_delay(net, &p_iocr->cpm, current_time), cpm_sync_name,
             pf_cpm_control_interval_expired, arg, &p_iocr->cpm.ci_timer) != 0)
          {
             p_iocr->cpm.ci_timer = UINT32_MAX;
@@ -161,7 +187,7 @@ static void pf_cpm_control_interval_expired(
          }
       }
    }
-   exec = os_get_current_time_us() - start;
+   exec = (uint32_t)((os_get_current_time_ns() - start) / 1000);
    if (exec > p_iocr->cpm.max_exec)
    {
       p_iocr->cpm.max_exec = exec;
@@ -289,9 +315,13 @@ int pf_cpm_check_cycle(
 /**
  * @internal
  * Perform a check of the source address of the received frame.
+ *
+ * The provider of a multicast consumer CR is not the controller. Its frames
+ * are instead checked for the multicast address of the CR.
  * @param p_cpm            In:   The CPM instance.
  * @param p_buf            In:   The frame buffer.
- * @return
+ * @return  0  If the address is OK.
+ *          -1 If not.
  */
 static int pf_cpm_check_src_addr(
    pf_cpm_t                *p_cpm,
@@ -300,7 +330,14 @@ static int pf_cpm_check_src_addr(
    int ret = -1;
 
    /* Payload contains [da], [sa], <etc> */
-   if (memcmp(&p_cpm->sa,
+   if (p_cpm->mc_consumer == true)
+   {
+      if (memcmp(&p_cpm->mc_da, p_buf->payload, sizeof(p_cpm->mc_da)) == 0)
+      {
+         ret = 0;
+      }
+   }
+   else if (memcmp(&p_cpm->sa,
       &((uint8_t*)p_buf->payload)[sizeof(pnet_ethaddr_t)],
       sizeof(p_cpm->sa)) == 0)
    {
@@ -392,7 +429,7 @@ static void pf_cpm_get_buf(
  * @return  0     If the frame was NOT handled by this function.
  *          1     If the frame was handled and the buffer freed.
  */
-static int pf_cpm_c_data_ind(
+int pf_cpm_c_data_ind(
    pnet_t                  *net,
    uint16_t                frame_id,
    os_buf_t                *p_buf,
@@ -422,6 +459,7 @@ static int pf_cpm_c_data_ind(
    switch (p_cpm->state)
    {
    case PF_CPM_STATE_W_START:
+      PF_TRACE3(cpm_reject, frame_id, 0, 0x08);
       p_iocr->p_ar->err_cls = PNET_ERROR_CODE_1_CPM;
       p_iocr->p_ar->err_code = PNET_ERROR_CODE_2_CPM_INVALID_STATE;
       p_cpm->errline = __LINE__;
@@ -449,15 +487,38 @@ static int pf_cpm_c_data_ind(
       len = p_buf->len - frame_id_pos;
       len += 2*sizeof(pnet_ethaddr_t) + sizeof(uint16_t);
 
-      frame_structure = ((transfer_status == 0) &&
-            (pf_cpm_check_src_addr(p_cpm, p_buf) == 0) &&
-            /* Frame_id is OK - or we would not be here. */
-            (len == p_cpm->buffer_length));
+      if (p_cpm->dfp.active == true)
+      {
+         /* Only the subframe of this device is checked. It has its own data status. */
+         frame_structure = ((transfer_status == 0) &&
+               (pf_cpm_check_src_addr(p_cpm, p_buf) == 0) &&
+               (pf_dfp_check_frame(&p_cpm->dfp, p_ind_buf, frame_id_pos, p_buf->len, &data_status) == 0));
+         data_valid = (data_status & 0x04) != 0;
+         backup = (data_status & 0x01) == 0;
+         primary = (data_status & 0x01) != 0;
+      }
+      else
+      {
+         frame_structure = ((transfer_status == 0) &&
+               (pf_cpm_check_src_addr(p_cpm, p_buf) == 0) &&
+               /* Frame_id is OK - or we would not be here. */
+               (len == p_cpm->buffer_length));
+      }
       c_sdu_structure = (pf_cpm_check_cycle(p_cpm->cycle, cycle) == 0);
 
       dht_reload = (frame_structure && c_sdu_structure && (data_valid || backup));
       update_data = (frame_structure && c_sdu_structure && data_valid && (primary || backup));
 
+      if (update_data)
+      {
+         PF_TRACE2(cpm_accept, frame_id, cycle);
+      }
+      else
+      {
+         PF_TRACE3(cpm_reject, frame_id, cycle,
+            (frame_structure ? 0 : 0x01) | (c_sdu_structure ? 0 : 0x02) | (data_valid ? 0 : 0x04));
+      }
+
       if (data_valid == false)
       {
          /* 19 */
@@ -476,7 +537,22 @@ static int pf_cpm_c_data_ind(
             /* 20 */
             pf_cpm_put_buf(net, p_cpm, &p_buf);
             p_cpm->frame_id_pos = frame_id_pos; /* Save for consumer */
-            p_cpm->buffer_pos = p_cpm->frame_id_pos + sizeof(uint16_t);
+            if (p_cpm->dfp.active == true)
+            {
+               /* The data is read directly from the subframe */
+               p_cpm->buffer_pos = pf_dfp_data_pos(&p_cpm->dfp, frame_id_pos);
+            }
+            else
+            {
+               p_cpm->buffer_pos = p_cpm->frame_id_pos + sizeof(uint16_t);
+            }
+#if PNET_OPTION_SR
+            if (p_iocr->p_ar->ar_param.ar_type == PF_ART_IOCAR_SR)
+            {
+               /* Switch over as soon as the controller says primary */
+               pf_cmsr_cpm_state_ind(net, p_iocr->p_ar, primary);
+            }
+#endif
             (void)pf_cmio_cpm_new_data_ind(p_iocr->p_ar, p_iocr->crep, true);
          }
          else
@@ -561,6 +637,8 @@ int pf_cpm_activate_req(
       p_cpm->recv_cnt = 0;
 
       memcpy(&p_cpm->sa, &p_ar->ar_param.cm_initiator_mac_add, sizeof(p_cpm->sa));
+      p_cpm->mc_consumer = (p_iocr->param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER);
+      memcpy(&p_cpm->mc_da, &p_iocr->param.iocr_multicast_mac_add, sizeof(p_cpm->mc_da));
 
       p_cpm->buffer_pos = 2*sizeof(pnet_ethaddr_t) +               /* ETH src and dest addr */
             sizeof(uint16_t) +                                    /* LT */
@@ -572,6 +650,8 @@ int pf_cpm_activate_req(
             1 +                                                   /* data status */
             1;                                                    /* transfer status */
 
+      pf_dfp_get_subframe(p_ar, p_iocr->param.iocr_reference, &p_cpm->dfp);
+
       p_cpm->nbr_frame_id = 1;   /* ToDo: For now. More for RTC_3 */
 
       p_cpm->frame_id[0] = p_iocr->param.frame_id;
@@ -583,10 +663,10 @@ int pf_cpm_activate_req(
          pf_eth_frame_id_map_add(net, p_cpm->frame_id[1], pf_cpm_c_data_ind, p_iocr);
       }
 
-      /* ToDo: Shall be aligned with local send clock or PTCP (Does it matter for RTClass1/2?) */
+      /* Aligned with the cycles of the PTCP master, if any */
       pf_cpm_set_state(p_cpm, PF_CPM_STATE_FRUN);
       p_cpm->ci_running = true;
-      ret = pf_scheduler_add(net, p_cpm->control_interval, cpm_sync_name,
+      ret = pf_scheduler_add(net, pf_cpm_next_delay(net, p_cpm, os_get_current_time_ns()), cpm_sync_name,
          pf_cpm_control_interval_expired, p_iocr, &p_cpm->ci_timer);
       if (ret != 0)
       {
@@ -767,6 +847,29 @@ int pf_cpm_get_data_and_iops(
    return ret;
 }
 
+int pf_cpm_get_data_and_iops_len(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_cpm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      *p_data_len = p_iodata->data_length;
+      *p_iops_len = (uint8_t)p_iodata->iops_length;
+      ret = 0;
+   }
+
+   return ret;
+}
+
 int pf_cpm_get_iocs(
    pnet_t                  *net,
    uint32_t                api_id,
@@ -797,6 +900,10 @@ int pf_cpm_get_iocs(
          {
             LOG_DEBUG(PF_CPM_LOG, "CPM(%d): iocs_length is zero in get iocs\n", __LINE__);
          }
+         else if (*p_iocs_len < p_iodata->iocs_length)
+         {
+            LOG_ERROR(PF_CPM_LOG, "CPM(%d): iocs_len %u expected length %u\n", __LINE__, (unsigned)*p_iocs_len, (unsigned)p_iodata->iocs_length);
+         }
          else
          {
             pf_cpm_get_buf(net, &p_iocr->cpm, &new_flag, &p_buffer);
@@ -77,6 +77,27 @@ int pf_cpm_activate_req(
    pf_ar_t                 *p_ar,
    uint32_t                crep);
 
+/**
+ * Retrieve the data and IOPS lengths of a sub-module.
+ *
+ * Lets a caller reserve room for the data and IOPS before retrieving them.
+ * @param net              InOut: The p-net stack instance
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param p_data_len       Out:  Length of the sub-module data.
+ * @param p_iops_len       Out:  Length of the IOPS.
+ * @return  0  if the lengths could be retrieved.
+ *          -1 if an error occurred.
+ */
+int pf_cpm_get_data_and_iops_len(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops_len);
+
 /**
  * Retrieve the specified sub-slot IOCS sent from the controller.
  * User must supply a buffer large enough to hold the received IOCS.
@@ -171,6 +192,13 @@ int pf_cpm_check_cycle(
   int32_t                  prev,
   uint16_t                 now);
 
+int pf_cpm_c_data_ind(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg);
+
 #ifdef __cplusplus
 }
 #endif
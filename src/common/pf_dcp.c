@@ -141,7 +141,7 @@ static const pf_dcp_opt_sub_t device_options[] =
 static void pf_dcp_responder(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    os_buf_t                *p_buf = (os_buf_t *)arg;
    if (p_buf != NULL)
@@ -150,12 +150,12 @@ static void pf_dcp_responder(
       {
          if (os_eth_send(net->eth_handle, p_buf) <= 0)
          {
-        	 net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_DCP);
             LOG_ERROR(PNET_LOG, "DCP(%d): Error from os_eth_send(dcp)\n", __LINE__);
          }
          else
          {
-        	 net->interface_statistics.ifOutOctects++;
+            pf_stats_out(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_DCP, p_buf->len);
             LOG_DEBUG(PNET_LOG, "DCP(%d): Sent a DCP response.\n", __LINE__);
          }
          os_buf_free(p_buf);
@@ -177,7 +177,7 @@ static void pf_dcp_responder(
 static void pf_dcp_clear_sam(
    pnet_t                     *net,
    void                       *arg,
-   uint32_t                   current_time)
+   uint64_t                   current_time)
 {
    net->dcp_sam = mac_nil;
 }
@@ -422,25 +422,18 @@ static int pf_dcp_get_req(
 
 /**
  * @internal
- * Execute DCP control states.
-
- * This functions blinks the Profinet signal LED 3 times at 1 Hz.
- * The LED is accessed via the pnet_signal_led_ind() callback function.
+ * Turn the signal LED on or off.
  *
- * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ * This is a job for the worker thread. Arguments should fulfill pf_worker_ftn_t
  *
  * @param net                 InOut: The p-net stack instance
- * @param arg                 In:   The current state.
- * @param current_time        In:   The current time.
+ * @param arg                 In:   1 to turn the LED on, 0 to turn it off.
  */
-static void pf_dcp_control_signal(
+static void pf_dcp_signal_led(
    pnet_t                     *net,
-   void                       *arg,
-   uint32_t                   current_time)
+   void                       *arg)
 {
-   uint32_t                   state = (uint32_t)(uintptr_t)arg;
-
-   if ((state % 2) == 1)
+   if ((uintptr_t)arg == 1)
    {
       /* Turn LED on */
       if (pf_fspm_signal_led_ind(net, true) != 0){
@@ -454,6 +447,53 @@ static void pf_dcp_control_signal(
          LOG_ERROR(PF_DCP_LOG, "DCP(%d): Could not turn signal LED off\n", __LINE__);
       }
    }
+}
+
+/**
+ * @internal
+ * Apply the settings of a DCP set request, and announce them with LLDP.
+ *
+ * This is a job for the worker thread, as changing the IP settings may take
+ * long. Arguments should fulfill pf_worker_ftn_t
+ *
+ * @param net                 InOut: The p-net stack instance
+ * @param arg                 In:   Not used.
+ */
+static void pf_dcp_set_commit(
+   pnet_t                     *net,
+   void                       *arg)
+{
+   pf_cmina_dcp_set_commit(net);
+   /*Check if we need to shut down the LLDP TX'ing*/
+   if(!net->fspm_cfg.lldp_peer_req.peerBoundary.boundary.not_send_LLDP_Frames)
+   {
+      pf_lldp_send(net, PF_STATS_CTX_WORKER);
+   }
+}
+
+/**
+ * @internal
+ * Execute DCP control states.
+
+ * This functions blinks the Profinet signal LED 3 times at 1 Hz.
+ * The LED is accessed via the pnet_signal_led_ind() callback function,
+ * which is called by the worker thread.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net                 InOut: The p-net stack instance
+ * @param arg                 In:   The current state.
+ * @param current_time        In:   The current time.
+ */
+static void pf_dcp_control_signal(
+   pnet_t                     *net,
+   void                       *arg,
+   uint64_t                   current_time)
+{
+   uint32_t                   state = (uint32_t)(uintptr_t)arg;
+
+   /* The application call-back may be slow. Keep it out of the scheduler. */
+   pf_worker_post(net, pf_dcp_signal_led, (void *)(uintptr_t)(state % 2));
 
    if ((state > 0) && (state < 200))   /* Plausibility test */
    {
@@ -806,24 +846,19 @@ static int pf_dcp_get_set(
 
          if (os_eth_send(net->eth_handle, p_rsp) <= 0)
          {
-        	 net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_DCP);
             LOG_ERROR(PNET_LOG, "pf_dcp(%d): Error from os_eth_send(dcp)\n", __LINE__);
          }
          else
          {
-        	 net->interface_statistics.ifOutOctects++;
+            pf_stats_out(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_DCP, p_rsp->len);
             LOG_DEBUG(PF_DCP_LOG,"DCP(%d): Sent DCP Get/Set response\n", __LINE__);
          }
 
          /* Send LLDP _after_ the response in order to pass I/O-tester tests. */
          if (p_src_dcphdr->service_id == PF_DCP_SERVICE_SET)
          {
-            pf_cmina_dcp_set_commit(net);
-        	/*Check if we need to shut down the LLDP TX'ing*/
-        	if(!net->fspm_cfg.lldp_peer_req.peerBoundary.boundary.not_send_LLDP_Frames)
-        	{
-        		pf_lldp_send(net);
-        	}
+            pf_worker_post(net, pf_dcp_set_commit, NULL);
          }
       }
    }
@@ -1004,12 +1039,12 @@ int pf_dcp_hello_req(
          p_buf->len = dst_pos;
          if (os_eth_send(net->eth_handle, p_buf) <= 0)
          {
-        	 net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_DCP);
             LOG_ERROR(PNET_LOG, "pf_dcp(%d): Error from os_eth_send(dcp)\n", __LINE__);
          }
          else
          {
-        	 net->interface_statistics.ifOutOctects++;
+            pf_stats_out(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_DCP, p_buf->len);
          }
       }
       os_buf_free(p_buf);
@@ -0,0 +1,195 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+#define PF_DFP_CRC16_POLYNOMIAL           0x755b
+
+static uint16_t            pf_dfp_crc_table[256];
+
+void pf_dfp_init(void)
+{
+   uint16_t                ix;
+   uint16_t                bit;
+   uint16_t                crc;
+
+   for (ix = 0; ix < NELEMENTS(pf_dfp_crc_table); ix++)
+   {
+      crc = (uint16_t)(ix << 8);
+      for (bit = 0; bit < 8; bit++)
+      {
+         crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ PF_DFP_CRC16_POLYNOMIAL) : (uint16_t)(crc << 1);
+      }
+      pf_dfp_crc_table[ix] = crc;
+   }
+}
+
+uint16_t pf_dfp_crc16(
+   uint16_t                crc,
+   const uint8_t           *p_data,
+   uint16_t                len)
+{
+   while (len-- > 0)
+   {
+      crc = (uint16_t)(crc << 8) ^ pf_dfp_crc_table[((crc >> 8) ^ *p_data++) & 0xff];
+   }
+
+   return crc;
+}
+
+/**
+ * @internal
+ * Calculate the SFCRC16 of a packed frame.
+ *
+ * It covers the destination and source MAC addresses and the frame ID,
+ * but not the VLAN tag and the EtherType between them.
+ *
+ * @param p_frame          In:   The frame, starting with the MAC addresses.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @return the CRC.
+ */
+static uint16_t pf_dfp_header_crc(
+   const uint8_t           *p_frame,
+   uint16_t                frame_id_pos)
+{
+   uint16_t                crc;
+
+   crc = pf_dfp_crc16(0, p_frame, 2 * sizeof(pnet_ethaddr_t));
+   crc = pf_dfp_crc16(crc, &p_frame[frame_id_pos], sizeof(uint16_t));
+
+   return crc;
+}
+
+/**
+ * @internal
+ * Calculate the SFCRC16 of a subframe.
+ *
+ * @param p_sf             In:   The subframe.
+ * @param p_frame          In:   The frame, starting with the MAC addresses.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @return the CRC.
+ */
+static uint16_t pf_dfp_subframe_crc(
+   const pf_dfp_subframe_t *p_sf,
+   const uint8_t           *p_frame,
+   uint16_t                frame_id_pos)
+{
+   uint16_t                frame_id;
+
+   frame_id = (uint16_t)p_frame[frame_id_pos] * 0x100 + p_frame[frame_id_pos + 1];
+
+   return pf_dfp_crc16(frame_id,
+      &p_frame[frame_id_pos + sizeof(uint16_t) + p_sf->offset],
+      PF_DFP_SUBFRAME_HEADER_SIZE + p_sf->length);
+}
+
+void pf_dfp_get_subframe(
+   const pf_ar_t           *p_ar,
+   uint16_t                iocr_reference,
+   pf_dfp_subframe_t       *p_sf)
+{
+   uint16_t                ix;
+
+   memset(p_sf, 0, sizeof(*p_sf));
+   if (p_ar->ir_info.valid == true)
+   {
+      for (ix = 0; (ix < p_ar->ir_info.nbr_iocrs) && (ix < NELEMENTS(p_ar->ir_info.dfp_iocrs)); ix++)
+      {
+         if (p_ar->ir_info.dfp_iocrs[ix].iocr_reference == iocr_reference)
+         {
+            p_sf->active = true;
+            p_sf->offset = p_ar->ir_info.dfp_iocrs[ix].subframe_offset;
+            p_sf->position = p_ar->ir_info.dfp_iocrs[ix].subframe_data.subframe_position;
+            p_sf->length = p_ar->ir_info.dfp_iocrs[ix].subframe_data.subframe_length;
+         }
+      }
+   }
+}
+
+uint16_t pf_dfp_data_pos(
+   const pf_dfp_subframe_t *p_sf,
+   uint16_t                frame_id_pos)
+{
+   return frame_id_pos + sizeof(uint16_t) + p_sf->offset + PF_DFP_SUBFRAME_HEADER_SIZE;
+}
+
+void pf_dfp_put_header(
+   uint8_t                 *p_frame,
+   uint16_t                frame_id_pos)
+{
+   uint16_t                crc = pf_dfp_header_crc(p_frame, frame_id_pos);
+
+   p_frame[frame_id_pos + 2] = (uint8_t)(crc >> 8);
+   p_frame[frame_id_pos + 3] = (uint8_t)crc;
+}
+
+void pf_dfp_put_subframe(
+   const pf_dfp_subframe_t *p_sf,
+   uint8_t                 *p_frame,
+   uint16_t                frame_id_pos,
+   uint16_t                cycle,
+   uint8_t                 data_status)
+{
+   uint16_t                pos = frame_id_pos + sizeof(uint16_t) + p_sf->offset;
+   uint16_t                crc;
+
+   p_frame[pos] = p_sf->position & PF_DFP_POSITION_MASK;
+   p_frame[pos + 1] = p_sf->length;
+   p_frame[pos + 2] = (uint8_t)cycle;
+   p_frame[pos + 3] = data_status;
+
+   crc = pf_dfp_subframe_crc(p_sf, p_frame, frame_id_pos);
+   pos += PF_DFP_SUBFRAME_HEADER_SIZE + p_sf->length;
+   p_frame[pos] = (uint8_t)(crc >> 8);
+   p_frame[pos + 1] = (uint8_t)crc;
+}
+
+int pf_dfp_check_frame(
+   const pf_dfp_subframe_t *p_sf,
+   const uint8_t           *p_frame,
+   uint16_t                frame_id_pos,
+   uint16_t                frame_len,
+   uint8_t                 *p_data_status)
+{
+   int                     ret = -1;
+   uint32_t                pos = (uint32_t)frame_id_pos + sizeof(uint16_t);
+   uint32_t                end;
+   uint16_t                crc;
+
+   end = pos + p_sf->offset + PF_DFP_SUBFRAME_HEADER_SIZE + p_sf->length + PF_DFP_SUBFRAME_CRC_SIZE;
+   if ((p_sf->active == true) &&
+       (p_sf->offset >= PF_DFP_HEADER_SIZE) &&
+       (end + sizeof(uint16_t) + 2 <= frame_len))      /* APDU status follows */
+   {
+      crc = (uint16_t)p_frame[pos] * 0x100 + p_frame[pos + 1];
+      if ((crc == 0) || (crc == pf_dfp_header_crc(p_frame, frame_id_pos)))
+      {
+         pos += p_sf->offset;
+         if (((p_frame[pos] & PF_DFP_POSITION_MASK) == p_sf->position) &&
+             (p_frame[pos + 1] == p_sf->length))
+         {
+            crc = (uint16_t)p_frame[end - 2] * 0x100 + p_frame[end - 1];
+            if (crc == pf_dfp_subframe_crc(p_sf, p_frame, frame_id_pos))
+            {
+               *p_data_status = p_frame[pos + 3];
+               ret = 0;
+            }
+         }
+      }
+   }
+
+   return ret;
+}
@@ -0,0 +1,153 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Dynamic Frame Packing (DFP).
+ *
+ * With DFP the cyclic data of several devices in a line share one frame.
+ * The C-SDU of a packed frame starts with an SFCRC16 over the destination
+ * and source MAC addresses and the frame ID (0 if not checked), followed
+ * by one subframe per device and an end delimiter (two zero bytes):
+ *
+ *    SFPosition (1) SFDataLength (1) SFCycleCounter (1) SFDataStatus (1)
+ *    Data (SFDataLength) SFCRC16 (2)
+ *
+ * The SFCRC16 of a subframe covers its header and data, with the frame ID
+ * as start value. The CRC-16 generator polynomial is 0x755B.
+ *
+ * The IR info block of the connect request tells where the subframe of
+ * each IOCR is, see pf_dfp_get_subframe(). The IO data objects of a DFP
+ * IOCR are placed relative to the data of its subframe, so the PPM and
+ * CPM pack and unpack the subframe and the rest of the stack sees an
+ * ordinary C-SDU.
+ */
+
+#ifndef PF_DFP_H
+#define PF_DFP_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PF_DFP_HEADER_SIZE             2        /* SFCRC16 of the packed frame */
+#define PF_DFP_SUBFRAME_HEADER_SIZE    4
+#define PF_DFP_SUBFRAME_CRC_SIZE       2
+#define PF_DFP_POSITION_MASK           0x7f
+
+/**
+ * Create the lookup table for the CRC-16 calculation.
+ */
+void pf_dfp_init(void);
+
+/**
+ * Calculate a CRC-16 (polynomial 0x755B) over a buffer.
+ *
+ * Use the returned value as start value to continue the calculation
+ * over the next buffer.
+ *
+ * @param crc              In:   Start value.
+ * @param p_data           In:   The data.
+ * @param len              In:   Number of bytes.
+ * @return the CRC.
+ */
+uint16_t pf_dfp_crc16(
+   uint16_t                crc,
+   const uint8_t           *p_data,
+   uint16_t                len);
+
+/**
+ * Find the subframe of an IOCR in the IR info of its AR.
+ *
+ * @param p_ar             In:   The AR instance.
+ * @param iocr_reference   In:   The IOCR reference.
+ * @param p_sf             Out:  The subframe. Not active if the IOCR does
+ *                               not use DFP.
+ */
+void pf_dfp_get_subframe(
+   const pf_ar_t           *p_ar,
+   uint16_t                iocr_reference,
+   pf_dfp_subframe_t       *p_sf);
+
+/**
+ * Return the position of the data of a subframe in a frame.
+ *
+ * @param p_sf             In:   The subframe.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @return the position.
+ */
+uint16_t pf_dfp_data_pos(
+   const pf_dfp_subframe_t *p_sf,
+   uint16_t                frame_id_pos);
+
+/**
+ * Write the SFCRC16 of the packed frame.
+ *
+ * The MAC addresses and the frame ID must be in place. They do not change
+ * between cycles, so this is done once.
+ *
+ * @param p_frame          InOut: The frame, starting with the MAC addresses.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ */
+void pf_dfp_put_header(
+   uint8_t                 *p_frame,
+   uint16_t                frame_id_pos);
+
+/**
+ * Write the header and the SFCRC16 of a subframe.
+ *
+ * The data must already be in place, see pf_dfp_data_pos().
+ *
+ * @param p_sf             In:   The subframe.
+ * @param p_frame          InOut: The frame, starting with the MAC addresses.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @param cycle            In:   The cycle counter.
+ * @param data_status      In:   The data status.
+ */
+void pf_dfp_put_subframe(
+   const pf_dfp_subframe_t *p_sf,
+   uint8_t                 *p_frame,
+   uint16_t                frame_id_pos,
+   uint16_t                cycle,
+   uint8_t                 data_status);
+
+/**
+ * Check a received packed frame and the subframe of this device.
+ *
+ * Checks the SFCRC16 of the frame (unless 0), and the bounds, position,
+ * length and SFCRC16 of the subframe. The other subframes are not
+ * looked at.
+ *
+ * @param p_sf             In:   The subframe.
+ * @param p_frame          In:   The frame, starting with the MAC addresses.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @param frame_len        In:   Length of the frame, including the APDU status.
+ * @param p_data_status    Out:  The data status of the subframe.
+ * @return  0  if the subframe is OK.
+ *          -1 if not.
+ */
+int pf_dfp_check_frame(
+   const pf_dfp_subframe_t *p_sf,
+   const uint8_t           *p_frame,
+   uint16_t                frame_id_pos,
+   uint16_t                frame_len,
+   uint8_t                 *p_data_status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_DFP_H */
@@ -37,11 +37,111 @@ int pf_eth_init(
 {
    int ret = 0;
 
-   memset(net->eth_id_map, 0, sizeof(net->eth_id_map));
+   if (net->eth_id_map == NULL)
+   {
+      net->eth_id_map_size = 16;
+      while (net->eth_id_map_size < 2 * PF_ETH_MAX_MAP(net->max_ar))
+      {
+         net->eth_id_map_size *= 2;
+      }
+      net->eth_id_map = os_malloc(net->eth_id_map_size * sizeof(net->eth_id_map[0]));
+      if (net->eth_id_map == NULL)
+      {
+         LOG_ERROR(PF_ETH_LOG, "ETH(%d): Could not allocate the frame id map\n", __LINE__);
+         net->eth_id_map_size = 0;
+         ret = -1;
+      }
+   }
+
+   if (net->eth_id_map != NULL)
+   {
+      memset(net->eth_id_map, 0, net->eth_id_map_size * sizeof(net->eth_id_map[0]));
+   }
 
    return ret;
 }
 
+void pf_eth_exit(
+   pnet_t                  *net)
+{
+   os_free(net->eth_id_map);
+   net->eth_id_map = NULL;
+   net->eth_id_map_size = 0;
+}
+
+/**
+ * @internal
+ * Get the first index of the frame id map to probe for a frame id.
+ *
+ * The map is a hash table with linear probing. Entries that have been in
+ * use stay probed, so a lookup stops at the first entry that never was.
+ * @param net              In:   The p-net stack instance
+ * @param frame_id         In:   The frame ID.
+ * @return  The index.
+ */
+static uint16_t pf_eth_frame_id_hash(
+   pnet_t                  *net,
+   uint16_t                frame_id)
+{
+   return (frame_id ^ (frame_id >> 8)) & (net->eth_id_map_size - 1);
+}
+
+/**
+ * @internal
+ * Find a frame id in the frame id map.
+ * @param net              In:   The p-net stack instance
+ * @param frame_id         In:   The frame ID.
+ * @return  The index of the entry, or net->eth_id_map_size if not found.
+ */
+static uint16_t pf_eth_frame_id_find(
+   pnet_t                  *net,
+   uint16_t                frame_id)
+{
+   uint16_t                ix = pf_eth_frame_id_hash(net, frame_id);
+   uint16_t                cnt = 0;
+
+   while ((cnt < net->eth_id_map_size) &&
+          (net->eth_id_map[ix].probed == true) &&
+          ((net->eth_id_map[ix].in_use == false) ||
+           (net->eth_id_map[ix].frame_id != frame_id)))
+   {
+      ix = (ix + 1) & (net->eth_id_map_size - 1);
+      cnt++;
+   }
+
+   if ((cnt >= net->eth_id_map_size) || (net->eth_id_map[ix].probed == false))
+   {
+      ix = net->eth_id_map_size;
+   }
+
+   return ix;
+}
+
+/**
+ * @internal
+ * Find the traffic class of a PROFINET frame.
+ * @param frame_id         In:   The frame ID.
+ * @return  The traffic class.
+ */
+static pnet_traffic_class_t pf_eth_traffic_class(
+   uint16_t                frame_id)
+{
+   if ((frame_id >= 0xfefc) && (frame_id <= 0xfeff))
+   {
+      return PNET_TRAFFIC_CLASS_DCP;
+   }
+   else if ((frame_id == 0xfc01) || (frame_id == 0xfe01))
+   {
+      return PNET_TRAFFIC_CLASS_ALARM;
+   }
+   else if ((frame_id >= 0x0100) && (frame_id < 0xfc00))
+   {
+      return PNET_TRAFFIC_CLASS_RT;
+   }
+
+   return PNET_TRAFFIC_CLASS_OTHER;
+}
+
 int pf_eth_recv(
    void                    *arg,
    os_buf_t                *p_buf)
@@ -54,6 +154,7 @@ int pf_eth_recv(
    uint16_t    *p_data;
    uint16_t    ix = 0;
    pnet_t      *net = (pnet_t*)arg;
+   uint32_t    len = p_buf->len;    /* The handler may free the buffer */
 
    /* Skip ALL VLAN tags */
    p_data = (uint16_t *)(&((uint8_t *)p_buf->payload)[type_pos]);
@@ -71,34 +172,35 @@ int pf_eth_recv(
    p_data = (uint16_t *)(&((uint8_t *)p_buf->payload)[frame_pos]);
    frame_id = ntohs(p_data[0]);
 
+   PF_TRACE3(eth_recv, type, frame_id, len);
+
    switch (type)
    {
    case OS_ETHTYPE_PROFINET:
       /* Find the associated frame handler */
-      ix = 0;
-      while ((ix < NELEMENTS(net->eth_id_map)) &&
-             ((net->eth_id_map[ix].in_use == false) ||
-              (net->eth_id_map[ix].frame_id != frame_id)))
-      {
-         ix++;
-      }
-      if (ix < NELEMENTS(net->eth_id_map))
+      ix = pf_eth_frame_id_find(net, frame_id);
+      if (ix < net->eth_id_map_size)
       {
+         pf_stats_in(net, PF_STATS_CTX_RX, pf_eth_traffic_class(frame_id), len);
+
          /* Call the frame handler */
          ret = net->eth_id_map[ix].frame_handler(net, frame_id, p_buf,
         		 frame_pos, net->eth_id_map[ix].p_arg);
       }
-      net->interface_statistics.ifInOctects++;
+      else
+      {
+         pf_stats_in_discard(net, PF_STATS_CTX_RX, pf_eth_traffic_class(frame_id));
+      }
       break;
    case OS_ETHTYPE_LLDP:
 	   LOG_INFO(PF_ETH_LOG, "LLDP: Recieved LLDP frame\n");
 	   /* eth_display_data(p_buf->payload,p_buf->len); */
+	   pf_stats_in(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_LLDP, len);
 	   pf_lldp_recv(net,p_buf,frame_pos);
-	  net->interface_statistics.ifInOctects++;
       break;
    default:
       /* Not a profinet packet. */
-	  net->interface_statistics.ifInDiscards++;
+	  pf_stats_in_discard(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_OTHER);
       ret = 0;
       break;
    }
@@ -112,21 +214,24 @@ void pf_eth_frame_id_map_add(
    pf_eth_frame_handler_t  frame_handler,
    void                    *p_arg)
 {
-   uint16_t                ix = 0;
+   uint16_t                ix = pf_eth_frame_id_hash(net, frame_id);
+   uint16_t                cnt = 0;
 
-   while ((ix < NELEMENTS(net->eth_id_map)) &&
+   while ((cnt < net->eth_id_map_size) &&
           (net->eth_id_map[ix].in_use == true))
    {
-      ix++;
+      ix = (ix + 1) & (net->eth_id_map_size - 1);
+      cnt++;
    }
 
-   if (ix < NELEMENTS(net->eth_id_map))
+   if (cnt < net->eth_id_map_size)
    {
       LOG_DEBUG(PF_ETH_LOG, "ETH(%d): Add FrameIds %#x at index %u\n", __LINE__,
          (unsigned)frame_id, (unsigned)ix);
       net->eth_id_map[ix].frame_id = frame_id;
       net->eth_id_map[ix].frame_handler = frame_handler;
       net->eth_id_map[ix].p_arg = p_arg;
+      net->eth_id_map[ix].probed = true;
       net->eth_id_map[ix].in_use = true;
    }
    else
@@ -139,19 +244,25 @@ void pf_eth_frame_id_map_remove(
    pnet_t                  *net,
    uint16_t                frame_id)
 {
-   uint16_t                ix = 0;
+   uint16_t                ix = pf_eth_frame_id_find(net, frame_id);
+   uint16_t                mask = net->eth_id_map_size - 1;
 
-   while ((ix < NELEMENTS(net->eth_id_map)) &&
-          ((net->eth_id_map[ix].in_use == false) ||
-           (net->eth_id_map[ix].frame_id != frame_id)))
-   {
-      ix++;
-   }
-
-   if (ix < NELEMENTS(net->eth_id_map))
+   if (ix < net->eth_id_map_size)
    {
       net->eth_id_map[ix].in_use = false;
       LOG_DEBUG(PF_ETH_LOG, "ETH(%d): Free room for FrameIds %#x at index %u\n", __LINE__,
          (unsigned)frame_id, (unsigned)ix);
+
+      /* Unprobe free entries at the end of a probe sequence, so that
+       * lookups stay short while ARs come and go */
+      if (net->eth_id_map[(ix + 1) & mask].probed == false)
+      {
+         while ((net->eth_id_map[ix].probed == true) &&
+                (net->eth_id_map[ix].in_use == false))
+         {
+            net->eth_id_map[ix].probed = false;
+            ix = (ix - 1) & mask;
+         }
+      }
    }
 }
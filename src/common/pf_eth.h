@@ -31,6 +31,13 @@ extern "C"
 int pf_eth_init(
    pnet_t                  *net);
 
+/**
+ * Free the frame id map. No frame may be received after this.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_eth_exit(
+   pnet_t                  *net);
+
 /**
  * Add a frame_id entry to the frame id filter map.
  *
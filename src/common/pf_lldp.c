@@ -300,7 +300,7 @@ static void pf_lldp_send_remote_mismatch_alarm(pnet_t *net)
 {
 
 	uint16_t ix = 0,
-			 maxIndex = NELEMENTS(net->cmrpc_ar);
+			 maxIndex = net->max_ar;
 
     pf_ar_t				*p_ar = NULL;	
 	pf_diag_item_t 		diag_item;
@@ -430,7 +430,7 @@ static void pf_lldp_send_port_datachange_alarm(pnet_t *net)
 {
 
 	uint16_t ix = 0,
-			 maxIndex = NELEMENTS(net->cmrpc_ar);
+			 maxIndex = net->max_ar;
 	uint32_t	api_ix = 0,
 				mod_ix = 0,
 				sub_ix = 0;
@@ -618,7 +618,7 @@ void pf_lldp_timer_cb(os_timer_t *timer)
 	/*Check if we need to shut down the LLDP TX'ing*/
 	if(!net->fspm_cfg.lldp_peer_req.peerBoundary.boundary.not_send_LLDP_Frames)
 	{
-		pf_lldp_send(net);
+		pf_lldp_send(net, PF_STATS_CTX_TIMER);
 		
 		/*Start the timer */
 		os_timer_start(net->eth_handle->lldpBroadcastTimer);
@@ -632,7 +632,8 @@ void pf_lldp_timer_cb(os_timer_t *timer)
 #endif
 
 void pf_lldp_send(
-   pnet_t                  *net)
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx)
 {
 	
 	/*Check if we need to shut down the LLDP TX'ing*/
@@ -734,11 +735,11 @@ void pf_lldp_send(
         if (os_eth_lldp_send(net->eth_handle, p_lldp_buffer) <= 0)
          {
             LOG_ERROR(PNET_LOG, "LLDP(%d): Error from os_eth_lldp_send(lldp)\n", __LINE__);
-            net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, ctx, PNET_TRAFFIC_CLASS_LLDP);
          }
         else
         {
-        	net->interface_statistics.ifOutOctects++;
+           pf_stats_out(net, ctx, PNET_TRAFFIC_CLASS_LLDP, p_lldp_buffer->len);
         }
       }
 
@@ -95,9 +95,11 @@ void pf_lldp_init(
 /**
  * Build and send an LLDP message.
  * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread, for the counters.
  */
 void pf_lldp_send(
-   pnet_t                  *net);
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx);
 
 /**
  * Recieve an LLDP message.
@@ -0,0 +1,651 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "pf_includes.h"
+
+#if PNET_OPTION_METRICS
+
+#define PF_METRICS_THREAD_PRIO            1        /* Below everything else */
+#define PF_METRICS_THREAD_STACKSIZE       4096
+#define PF_METRICS_REQUEST_SIZE           512
+#define PF_METRICS_TIMEOUT                1000     /* milliseconds */
+#define PF_METRICS_ACCEPT_TIMEOUT         100      /* milliseconds. How long pf_metrics_exit() may wait. */
+#define PF_METRICS_SNAPSHOT_TIMEOUT       100      /* milliseconds */
+#define PF_METRICS_READ_TRIES             3
+
+typedef struct pf_metrics_out
+{
+   char                    *p_buf;
+   size_t                  size;
+   size_t                  pos;
+   bool                    overflow;
+} pf_metrics_out_t;
+
+static const char *pf_metrics_class_names[PNET_TRAFFIC_CLASS_MAX] =
+{
+   "rt", "alarm", "dcp", "lldp", "rpc", "other"
+};
+
+/**
+ * @internal
+ * Append formatted text to the output buffer.
+ * @param p_out            InOut: The output buffer.
+ * @param fmt              In:   printf() format string.
+ */
+static void pf_metrics_printf(
+   pf_metrics_out_t        *p_out,
+   const char              *fmt,
+   ...) CC_FORMAT(2, 3);
+
+static void pf_metrics_printf(
+   pf_metrics_out_t        *p_out,
+   const char              *fmt,
+   ...)
+{
+   va_list                 list;
+   int                     len;
+
+   if (p_out->overflow == false)
+   {
+      va_start(list, fmt);
+      len = vsnprintf(&p_out->p_buf[p_out->pos], p_out->size - p_out->pos, fmt, list);
+      va_end(list);
+
+      if ((len < 0) || ((size_t)len >= p_out->size - p_out->pos))
+      {
+         p_out->overflow = true;
+      }
+      else
+      {
+         p_out->pos += len;
+      }
+   }
+}
+
+/**
+ * @internal
+ * Append the HELP and TYPE lines of a metric family.
+ * @param p_out            InOut: The output buffer.
+ * @param p_name           In:   Metric name.
+ * @param p_type           In:   "counter", "gauge" or "histogram".
+ * @param p_help           In:   Description.
+ */
+static void pf_metrics_family(
+   pf_metrics_out_t        *p_out,
+   const char              *p_name,
+   const char              *p_type,
+   const char              *p_help)
+{
+   pf_metrics_printf(p_out, "# HELP %s %s\n# TYPE %s %s\n",
+      p_name, p_help, p_name, p_type);
+}
+
+static void pf_metrics_interface(
+   pnet_t                  *net,
+   pf_metrics_out_t        *p_out)
+{
+   pnet_interface_stats_t  stats;
+   uint16_t                tc;
+
+   pf_stats_get(net, &stats);
+
+   pf_metrics_family(p_out, "pnet_interface_packets_total", "counter",
+      "Frames (UDP datagrams for RPC) per direction and traffic class.");
+   for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+   {
+      pf_metrics_printf(p_out, "pnet_interface_packets_total{direction=\"in\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].in_packets);
+      pf_metrics_printf(p_out, "pnet_interface_packets_total{direction=\"out\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].out_packets);
+   }
+
+   pf_metrics_family(p_out, "pnet_interface_octets_total", "counter",
+      "Octets per direction and traffic class. UDP payload only for RPC.");
+   for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+   {
+      pf_metrics_printf(p_out, "pnet_interface_octets_total{direction=\"in\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].in_octets);
+      pf_metrics_printf(p_out, "pnet_interface_octets_total{direction=\"out\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].out_octets);
+   }
+
+   pf_metrics_family(p_out, "pnet_interface_discards_total", "counter",
+      "Frames dropped without error, per direction and traffic class.");
+   for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+   {
+      pf_metrics_printf(p_out, "pnet_interface_discards_total{direction=\"in\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].in_discards);
+      pf_metrics_printf(p_out, "pnet_interface_discards_total{direction=\"out\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].out_discards);
+   }
+
+   pf_metrics_family(p_out, "pnet_interface_errors_total", "counter",
+      "Frames that could not be received or sent, per direction and traffic class.");
+   for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+   {
+      pf_metrics_printf(p_out, "pnet_interface_errors_total{direction=\"in\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].in_errors);
+      pf_metrics_printf(p_out, "pnet_interface_errors_total{direction=\"out\",class=\"%s\"} %" PRIu32 "\n",
+         pf_metrics_class_names[tc], stats.traffic[tc].out_errors);
+   }
+}
+
+/**
+ * @internal
+ * Check if the stack sends the frames of an IOCR.
+ * @param p_iocr           In:   The IOCR.
+ * @return  true if the PPM handles the IOCR, false if the CPM does.
+ */
+static bool pf_metrics_iocr_is_provider(
+   const pf_iocr_t         *p_iocr)
+{
+   return (p_iocr->param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+          (p_iocr->param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER);
+}
+
+static void pf_metrics_iocr(
+   pnet_t                  *net,
+   pf_metrics_out_t        *p_out)
+{
+   static const char       *iocr_families[][3] =
+   {
+      { "pnet_iocr_frames_total", "counter", "Cyclic frames sent (input IOCR) or received (output IOCR)." },
+      { "pnet_iocr_errors_total", "counter", "Cyclic frames that could not be sent or were received in the wrong state." },
+      { "pnet_iocr_cycle_seconds", "gauge", "Time between cyclic frames." },
+      { "pnet_iocr_data_hold_cycles", "gauge", "Cycles since the last valid frame, for output IOCRs." },
+   };
+   uint16_t                family;
+   uint16_t                ar_ix;
+   uint16_t                cr_ix;
+   const pf_metrics_ar_t   *p_ar;
+   const pf_metrics_iocr_t *p_iocr;
+   uint32_t                value;
+
+   for (family = 0; family < NELEMENTS(iocr_families); family++)
+   {
+      pf_metrics_family(p_out, iocr_families[family][0], iocr_families[family][1],
+         iocr_families[family][2]);
+      for (ar_ix = 0; (net->metrics_ars != NULL) && (ar_ix < net->max_ar); ar_ix++)
+      {
+         p_ar = &net->metrics_ars[ar_ix];
+         if (p_ar->in_use == false)
+         {
+            continue;
+         }
+         for (cr_ix = 0; cr_ix < p_ar->nbr_iocrs; cr_ix++)
+         {
+            p_iocr = &p_ar->iocrs[cr_ix];
+            switch (family)
+            {
+            case 0:
+               value = p_iocr->frames;
+               break;
+            case 1:
+               value = p_iocr->errors;
+               break;
+            case 2:
+               value = p_iocr->cycle_us;
+               break;
+            default:
+               if (p_iocr->provider)
+               {
+                  continue;
+               }
+               value = p_iocr->dht;
+               break;
+            }
+
+            pf_metrics_printf(p_out, "%s{ar=\"%u\",iocr=\"%u\",frame_id=\"0x%04x\",direction=\"%s\"} ",
+               iocr_families[family][0], (unsigned)ar_ix, (unsigned)cr_ix,
+               (unsigned)p_iocr->frame_id, p_iocr->provider ? "out" : "in");
+            if (family == 2)
+            {
+               /* Microseconds to seconds */
+               pf_metrics_printf(p_out, "%u.%06u\n",
+                  (unsigned)(value / 1000000), (unsigned)(value % 1000000));
+            }
+            else
+            {
+               pf_metrics_printf(p_out, "%" PRIu32 "\n", value);
+            }
+         }
+      }
+   }
+}
+
+static void pf_metrics_scheduler(
+   pnet_t                  *net,
+   pf_metrics_out_t        *p_out)
+{
+   uint16_t                ix;
+   uint32_t                count = 0;
+   uint32_t                bound;
+
+   pf_metrics_family(p_out, "pnet_scheduler_lateness_seconds", "histogram",
+      "Time from when a scheduler call-back was due until it was called.");
+   for (ix = 0; ix < PF_SCHEDULER_LATENESS_BUCKETS; ix++)
+   {
+      count += CC_ATOMIC_GET32(&net->scheduler_lateness[ix]);
+      if (ix < NELEMENTS(pf_scheduler_lateness_bounds))
+      {
+         bound = pf_scheduler_lateness_bounds[ix];
+         pf_metrics_printf(p_out, "pnet_scheduler_lateness_seconds_bucket{le=\"%u.%06u\"} %" PRIu32 "\n",
+            (unsigned)(bound / 1000000), (unsigned)(bound % 1000000), count);
+      }
+      else
+      {
+         pf_metrics_printf(p_out, "pnet_scheduler_lateness_seconds_bucket{le=\"+Inf\"} %" PRIu32 "\n",
+            count);
+      }
+   }
+   bound = CC_ATOMIC_GET32(&net->scheduler_lateness_sum);
+   pf_metrics_printf(p_out, "pnet_scheduler_lateness_seconds_sum %u.%06u\n",
+      (unsigned)(bound / 1000000), (unsigned)(bound % 1000000));
+   pf_metrics_printf(p_out, "pnet_scheduler_lateness_seconds_count %" PRIu32 "\n", count);
+}
+
+static void pf_metrics_alarm(
+   pnet_t                  *net,
+   pf_metrics_out_t        *p_out)
+{
+   static const char       *prio_names[] = { "low", "high" };
+   uint16_t                ar_ix;
+   uint16_t                ix;
+   const pf_metrics_ar_t   *p_ar;
+
+   pf_metrics_family(p_out, "pnet_alarm_queue_depth", "gauge",
+      "Received alarm frames waiting for pnet_handle_periodic().");
+   for (ar_ix = 0; (net->metrics_ars != NULL) && (ar_ix < net->max_ar); ar_ix++)
+   {
+      p_ar = &net->metrics_ars[ar_ix];
+      for (ix = 0; (p_ar->in_use == true) && (ix < NELEMENTS(p_ar->alarm_depth)); ix++)
+      {
+         pf_metrics_printf(p_out, "pnet_alarm_queue_depth{ar=\"%u\",priority=\"%s\"} %" PRIu32 "\n",
+            (unsigned)ar_ix, prio_names[ix], p_ar->alarm_depth[ix]);
+      }
+   }
+
+   pf_metrics_family(p_out, "pnet_alarm_queue_lost_total", "counter",
+      "Received alarm frames dropped because the queue was full.");
+   for (ar_ix = 0; (net->metrics_ars != NULL) && (ar_ix < net->max_ar); ar_ix++)
+   {
+      p_ar = &net->metrics_ars[ar_ix];
+      for (ix = 0; (p_ar->in_use == true) && (ix < NELEMENTS(p_ar->alarm_lost)); ix++)
+      {
+         pf_metrics_printf(p_out, "pnet_alarm_queue_lost_total{ar=\"%u\",priority=\"%s\"} %" PRIu32 "\n",
+            (unsigned)ar_ix, prio_names[ix], p_ar->alarm_lost[ix]);
+      }
+   }
+}
+
+static void pf_metrics_resources(
+   pnet_t                  *net,
+   pf_metrics_out_t        *p_out)
+{
+   uint16_t                ix;
+   unsigned                ars = 0;
+   unsigned                sessions = net->metrics_sessions;
+   int                     buffers;
+
+   for (ix = 0; (net->metrics_ars != NULL) && (ix < net->max_ar); ix++)
+   {
+      if (net->metrics_ars[ix].in_use == true)
+      {
+         ars++;
+      }
+   }
+
+   pf_metrics_family(p_out, "pnet_ars", "gauge", "Application relations in use.");
+   pf_metrics_printf(p_out, "pnet_ars %u\n", ars);
+   pf_metrics_family(p_out, "pnet_ars_max", "gauge", "Application relations available (pnet_cfg_t.max_ar).");
+   pf_metrics_printf(p_out, "pnet_ars_max %u\n", (unsigned)net->max_ar);
+   pf_metrics_family(p_out, "pnet_rpc_sessions", "gauge", "RPC sessions in use.");
+   pf_metrics_printf(p_out, "pnet_rpc_sessions %u\n", sessions);
+   pf_metrics_family(p_out, "pnet_rpc_sessions_max", "gauge", "RPC sessions available.");
+   pf_metrics_printf(p_out, "pnet_rpc_sessions_max %u\n", (unsigned)net->cmrpc_max_session);
+
+   buffers = os_buf_count();
+   if (buffers >= 0)
+   {
+      pf_metrics_family(p_out, "pnet_buffers_allocated", "gauge",
+         "Frame buffers allocated and not yet freed.");
+      pf_metrics_printf(p_out, "pnet_buffers_allocated %d\n", buffers);
+   }
+}
+
+void pf_metrics_snapshot(
+   pnet_t                  *net)
+{
+   uint32_t                seq = net->metrics_seq;    /* Only written here */
+   uint16_t                ar_ix;
+   uint16_t                cr_ix;
+   uint16_t                ix;
+   pf_ar_t                 *p_ar;
+   pf_iocr_t               *p_iocr;
+   pf_metrics_ar_t         *p_snap;
+   pf_metrics_iocr_t       *p_snap_iocr;
+   uint16_t                sessions = 0;
+
+   if (net->metrics_ars == NULL)
+   {
+      return;
+   }
+
+   __atomic_store_n(&net->metrics_seq, seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   for (ar_ix = 0; ar_ix < net->max_ar; ar_ix++)
+   {
+      p_ar = &net->cmrpc_ar[ar_ix];
+      p_snap = &net->metrics_ars[ar_ix];
+      memset(p_snap, 0, sizeof(*p_snap));
+      if (p_ar->in_use == false)
+      {
+         continue;
+      }
+
+      p_snap->in_use = true;
+      for (cr_ix = 0; (cr_ix < p_ar->nbr_iocrs) && (cr_ix < PF_MAX_IOCR); cr_ix++)
+      {
+         p_iocr = &p_ar->iocrs[cr_ix];
+         p_snap_iocr = &p_snap->iocrs[cr_ix];
+         p_snap_iocr->frame_id = p_iocr->param.frame_id;
+         p_snap_iocr->provider = pf_metrics_iocr_is_provider(p_iocr);
+         if (p_snap_iocr->provider)
+         {
+            p_snap_iocr->frames = CC_ATOMIC_GET32(&p_iocr->ppm.trx_cnt);
+            p_snap_iocr->errors = CC_ATOMIC_GET32(&p_iocr->ppm.errcnt);
+            p_snap_iocr->cycle_us = p_iocr->ppm.control_interval;
+         }
+         else
+         {
+            p_snap_iocr->frames = CC_ATOMIC_GET32(&p_iocr->cpm.recv_cnt);
+            p_snap_iocr->errors = CC_ATOMIC_GET32(&p_iocr->cpm.errcnt);
+            p_snap_iocr->cycle_us = p_iocr->cpm.control_interval;
+            p_snap_iocr->dht = p_iocr->cpm.dht;
+         }
+      }
+      p_snap->nbr_iocrs = cr_ix;
+
+      for (ix = 0; ix < NELEMENTS(p_snap->alarm_depth); ix++)
+      {
+         p_snap->alarm_depth[ix] = CC_ATOMIC_GET32(&p_ar->apmx[ix].alarm_q_posted) -
+            CC_ATOMIC_GET32(&p_ar->apmx[ix].alarm_q_fetched);
+         p_snap->alarm_lost[ix] = CC_ATOMIC_GET32(&p_ar->apmx[ix].alarm_q_lost);
+      }
+   }
+
+   for (ix = 0; ix < net->cmrpc_max_session; ix++)
+   {
+      if (net->cmrpc_session_info[ix].in_use == true)
+      {
+         sessions++;
+      }
+   }
+   net->metrics_sessions = sessions;
+
+   __atomic_store_n(&net->metrics_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void pf_metrics_periodic(
+   pnet_t                  *net)
+{
+   if (__atomic_load_n(&net->metrics_req, __ATOMIC_ACQUIRE) == true)
+   {
+      pf_metrics_snapshot(net);
+      __atomic_store_n(&net->metrics_req, false, __ATOMIC_RELEASE);
+   }
+}
+
+int pf_metrics_format(
+   pnet_t                  *net,
+   char                    *p_buf,
+   size_t                  size)
+{
+   pf_metrics_out_t        out;
+   uint32_t                seq;
+   uint16_t                tries = 0;
+   bool                    consistent = false;
+
+   /* Formatted again if the snapshot was written meanwhile */
+   while ((consistent == false) && (tries < PF_METRICS_READ_TRIES))
+   {
+      out.p_buf = p_buf;
+      out.size = size;
+      out.pos = 0;
+      out.overflow = (size == 0);
+
+      seq = __atomic_load_n(&net->metrics_seq, __ATOMIC_ACQUIRE);
+      pf_metrics_interface(net, &out);
+      pf_metrics_iocr(net, &out);
+      pf_metrics_scheduler(net, &out);
+      pf_metrics_alarm(net, &out);
+      pf_metrics_resources(net, &out);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      consistent = ((seq & 1) == 0) &&
+                   (seq == __atomic_load_n(&net->metrics_seq, __ATOMIC_RELAXED));
+      tries++;
+   }
+
+   return ((out.overflow == true) || (consistent == false)) ? -1 : (int)out.pos;
+}
+
+/**
+ * @internal
+ * Ask for a new snapshot, and wait a while for pf_metrics_periodic().
+ *
+ * The previous snapshot is used if the application does not call
+ * pnet_handle_periodic() in time.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_metrics_request_snapshot(
+   pnet_t                  *net)
+{
+   os_poll_t               *p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+   uint32_t                waited = 0;
+
+   __atomic_store_n(&net->metrics_req, true, __ATOMIC_RELEASE);
+   if (p_poll != NULL)
+   {
+      os_poll_wake(p_poll);   /* See pnet_process() */
+   }
+
+   while ((__atomic_load_n(&net->metrics_req, __ATOMIC_ACQUIRE) == true) &&
+          (waited < PF_METRICS_SNAPSHOT_TIMEOUT))
+   {
+      os_usleep(1000);
+      waited++;
+   }
+}
+
+/**
+ * @internal
+ * Answer one HTTP request.
+ * @param net              InOut: The p-net stack instance
+ * @param sock             In:   The connected socket.
+ */
+static void pf_metrics_serve(
+   pnet_t                  *net,
+   int                     sock)
+{
+   char                    request[PF_METRICS_REQUEST_SIZE];
+   char                    header[128];
+   int                     received = 0;
+   int                     len;
+   int                     body_len;
+   bool                    found;
+
+   /* Read the request head. The body, if any, is ignored. */
+   do
+   {
+      len = os_tcp_recv(sock, (uint8_t *)&request[received],
+         sizeof(request) - 1 - received, PF_METRICS_TIMEOUT);
+      if (len <= 0)
+      {
+         return;
+      }
+      received += len;
+      request[received] = '\0';
+   } while ((strstr(request, "\r\n\r\n") == NULL) &&
+            (received < (int)sizeof(request) - 1));
+
+   found = (strncmp(request, "GET /metrics ", 13) == 0) ||
+           (strncmp(request, "GET / ", 6) == 0);
+   body_len = 0;
+   if (found)
+   {
+      pf_metrics_request_snapshot(net);
+      body_len = pf_metrics_format(net, net->metrics_buffer, sizeof(net->metrics_buffer));
+   }
+   if (body_len < 0)
+   {
+      LOG_ERROR(PNET_LOG, "METRICS(%d): PF_METRICS_BUFFER_SIZE is too small, or the snapshot kept changing\n", __LINE__);
+      len = snprintf(header, sizeof(header),
+         "HTTP/1.0 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n");
+      body_len = 0;
+   }
+   else if (found)
+   {
+      len = snprintf(header, sizeof(header),
+         "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+         "Content-Length: %d\r\n\r\n", body_len);
+   }
+   else
+   {
+      len = snprintf(header, sizeof(header),
+         "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+   }
+
+   if (os_tcp_send(sock, (const uint8_t *)header, len, PF_METRICS_TIMEOUT) == len)
+   {
+      (void)os_tcp_send(sock, (const uint8_t *)net->metrics_buffer, body_len, PF_METRICS_TIMEOUT);
+   }
+}
+
+/**
+ * @internal
+ * Serve metrics requests, one connection at a time, until pf_metrics_exit().
+ *
+ * This is a function to be passed into os_thread_create()
+ * Do not change the argument types.
+ *
+ * @param arg              InOut: The p-net stack instance
+ */
+static void pf_metrics_thread(
+   void                    *arg)
+{
+   pnet_t                  *net = arg;
+   int                     listen_sock;
+   int                     sock;
+
+   listen_sock = os_tcp_listen(OS_MAKEU32(127, 0, 0, 1), net->fspm_cfg.metrics_port);
+   if (listen_sock < 0)
+   {
+      LOG_ERROR(PNET_LOG, "METRICS(%d): Could not listen on port %u\n", __LINE__,
+         (unsigned)net->fspm_cfg.metrics_port);
+      return;
+   }
+
+   while (__atomic_load_n(&net->metrics_running, __ATOMIC_ACQUIRE) == true)
+   {
+      sock = os_tcp_accept(listen_sock, PF_METRICS_ACCEPT_TIMEOUT);
+      if (sock >= 0)
+      {
+         pf_metrics_serve(net, sock);
+         os_tcp_close(sock);
+      }
+   }
+
+   os_tcp_close(listen_sock);
+}
+
+void pf_metrics_init(
+   pnet_t                  *net)
+{
+   os_thread_cfg_t         thread_cfg;
+
+   if (net->metrics_ars == NULL)
+   {
+      net->metrics_ars = os_malloc(net->max_ar * sizeof(*net->metrics_ars));
+      if (net->metrics_ars == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "METRICS(%d): Out of memory for the AR snapshot\n", __LINE__);
+         return;
+      }
+      memset(net->metrics_ars, 0, net->max_ar * sizeof(*net->metrics_ars));
+   }
+
+   if ((net->fspm_cfg.metrics_port != 0) && (net->metrics_thread == NULL))
+   {
+      pf_fspm_get_thread_cfg(net, PNET_THREAD_BACKGROUND,
+         PF_METRICS_THREAD_PRIO, PF_METRICS_THREAD_STACKSIZE, &thread_cfg);
+      __atomic_store_n(&net->metrics_running, true, __ATOMIC_RELEASE);
+      net->metrics_thread = os_thread_create_cfg("pn_metrics",
+         &thread_cfg, pf_metrics_thread, net);
+      if (net->metrics_thread == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "METRICS(%d): Could not create metrics thread\n", __LINE__);
+      }
+   }
+}
+
+void pf_metrics_exit(
+   pnet_t                  *net)
+{
+   if (net->metrics_thread != NULL)
+   {
+      __atomic_store_n(&net->metrics_running, false, __ATOMIC_RELEASE);
+      os_thread_join(net->metrics_thread);
+      net->metrics_thread = NULL;
+   }
+
+   os_free(net->metrics_ars);
+   net->metrics_ars = NULL;
+}
+
+#else
+
+void pf_metrics_init(
+   pnet_t                  *net)
+{
+}
+
+void pf_metrics_exit(
+   pnet_t                  *net)
+{
+}
+
+void pf_metrics_snapshot(
+   pnet_t                  *net)
+{
+}
+
+void pf_metrics_periodic(
+   pnet_t                  *net)
+{
+}
+
+int pf_metrics_format(
+   pnet_t                  *net,
+   char                    *p_buf,
+   size_t                  size)
+{
+   return -1;
+}
+
+#endif /* PNET_OPTION_METRICS */
@@ -0,0 +1,101 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Stack metrics in Prometheus text format.
+ *
+ * A low-priority thread serves the metrics over HTTP on a TCP port of the
+ * loopback interface. It reads the counters of the other threads without
+ * locking. Each counter is a single 32-bit word that is only written by
+ * one thread, so a scrape may be one update behind but never disturbs the
+ * cyclic data path. The counters wrap around, which Prometheus handles
+ * as a counter reset.
+ *
+ * The ARs and RPC sessions come and go, so they are not read by the
+ * metrics thread. For each scrape it asks pnet_handle_periodic() for a
+ * snapshot, which is written with a sequence counter like the PTCP clock,
+ * and formats the text again if the snapshot changed meanwhile.
+ */
+
+#ifndef PF_METRICS_H
+#define PF_METRICS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Start the metrics thread, if enabled by pnet_cfg_t.metrics_port.
+ *
+ * Must be called after the configuration has been saved by pf_fspm_init().
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_metrics_init(
+   pnet_t                  *net);
+
+/**
+ * Stop the metrics thread and free the snapshot.
+ *
+ * Waits for the thread to finish the request it is serving.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_metrics_exit(
+   pnet_t                  *net);
+
+/**
+ * Copy the ARs and RPC sessions for pf_metrics_format().
+ *
+ * Must be called by the thread that runs the AR state machines.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_metrics_snapshot(
+   pnet_t                  *net);
+
+/**
+ * Take a snapshot, if the metrics thread asked for one.
+ *
+ * Called by pnet_handle_periodic().
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_metrics_periodic(
+   pnet_t                  *net);
+
+/**
+ * Write the metrics in Prometheus text format.
+ *
+ * The ARs and RPC sessions are taken from the last snapshot.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_buf            Out:  Buffer for the text.
+ * @param size             In:   Size of the buffer.
+ * @return  The length of the text (excluding the terminating null), or
+ *          -1 if the buffer is too small, or the snapshot kept changing.
+ */
+int pf_metrics_format(
+   pnet_t                  *net,
+   char                    *p_buf,
+   size_t                  size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_METRICS_H */
@@ -0,0 +1,502 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifdef UNIT_TEST
+#define os_save_nvram_instance      mock_os_save_nvram_instance
+#endif
+
+#include <string.h>
+#include "pf_includes.h"
+
+#define PF_NVS_MAGIC                0x53564e50     /* "PNVS" */
+#define PF_NVS_COMPACT_SLACK        (64 * 1024)    /* Outdated entries allowed in the journal, in bytes */
+
+/* Entry header in the journal file. The record data follows directly. */
+typedef struct pf_nvs_entry_header
+{
+   uint32_t                magic;
+   uint16_t                key;        /* pf_nvs_key_t */
+   uint16_t                reserved;
+   uint32_t                len;        /* Of the record data */
+   uint32_t                crc;        /* Of the header (with crc = 0) and the data */
+} pf_nvs_entry_header_t;
+
+static uint32_t            pf_nvs_crc_table[256];
+
+/**
+ * @internal
+ * Create the lookup table for the CRC-32 (IEEE 802.3) calculation.
+ */
+static void pf_nvs_crc_init(void)
+{
+   uint32_t                ix;
+   uint32_t                bit;
+   uint32_t                crc;
+
+   for (ix = 0; ix < NELEMENTS(pf_nvs_crc_table); ix++)
+   {
+      crc = ix;
+      for (bit = 0; bit < 8; bit++)
+      {
+         crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : (crc >> 1);
+      }
+      pf_nvs_crc_table[ix] = crc;
+   }
+}
+
+/**
+ * @internal
+ * Calculate a CRC-32 over a buffer.
+ *
+ * Use the returned value as start value to continue the calculation
+ * over the next buffer.
+ *
+ * @param crc              In:   Start value (0 for a new calculation).
+ * @param p_data           In:   The data.
+ * @param len              In:   Number of bytes.
+ * @return the CRC.
+ */
+static uint32_t pf_nvs_crc32(
+   uint32_t                crc,
+   const void              *p_data,
+   uint32_t                len)
+{
+   const uint8_t           *p = p_data;
+
+   crc = ~crc;
+   while (len-- > 0)
+   {
+      crc = pf_nvs_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+   }
+
+   return ~crc;
+}
+
+/**
+ * @internal
+ * Return the individual file used for a record, when no journal is used.
+ * @param net              InOut: The p-net stack instance
+ * @param key              In:   The record key.
+ * @return the file name, or NULL if there is none.
+ */
+static const char *pf_nvs_legacy_path(
+   pnet_t                  *net,
+   pf_nvs_key_t            key)
+{
+   const char              *p_path = NULL;
+
+   switch (key)
+   {
+   case PF_NVS_KEY_IM:     p_path = net->p_fspm_default_cfg->IM_NonvolFilePath; break;
+   case PF_NVS_KEY_DIAG:   p_path = net->p_fspm_default_cfg->diagNonvolFilePath; break;
+   case PF_NVS_KEY_PDEV:   p_path = net->p_fspm_default_cfg->PDev_NonvolFilePath; break;
+   default: break;
+   }
+
+   return p_path;
+}
+
+/**
+ * @internal
+ * Return the journal file name, or NULL if no journal is used.
+ * @param net              InOut: The p-net stack instance
+ * @return the file name.
+ */
+static const char *pf_nvs_journal_path(
+   pnet_t                  *net)
+{
+   const char              *p_path = net->p_fspm_default_cfg->Journal_NonvolFilePath;
+
+   return (p_path[0] != '\0') ? p_path : NULL;
+}
+
+/**
+ * @internal
+ * Read and check the journal entry at a given position.
+ *
+ * The header and the data are read and the CRC is verified. If p_data is
+ * NULL then the data is read in pieces via net->nvs_buffer.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_path           In:   The journal file.
+ * @param offset           In:   Position of the entry header.
+ * @param p_header         Out:  The entry header.
+ * @param p_data           Out:  The record data, or NULL.
+ * @param len              In:   Size of p_data (ignored if p_data is NULL).
+ * @return  0  if a valid entry was read.
+ *          -1 if there is no valid entry at the position.
+ */
+static int pf_nvs_read_entry(
+   pnet_t                  *net,
+   const char              *p_path,
+   uint32_t                offset,
+   pf_nvs_entry_header_t   *p_header,
+   void                    *p_data,
+   uint32_t                len)
+{
+   pf_nvs_entry_header_t   header;
+   uint32_t                crc;
+   uint32_t                pos;
+   uint32_t                chunk;
+
+   if (os_file_read(p_path, offset, p_header, sizeof(*p_header)) != sizeof(*p_header))
+   {
+      return -1;
+   }
+   if ((p_header->magic != PF_NVS_MAGIC) ||
+       (p_header->key >= PF_NVS_KEY_MAX) ||
+       ((p_data != NULL) && (p_header->len != len)))
+   {
+      return -1;
+   }
+
+   header = *p_header;
+   header.crc = 0;
+   crc = pf_nvs_crc32(0, &header, sizeof(header));
+   offset += sizeof(header);
+
+   if (p_data != NULL)
+   {
+      if (os_file_read(p_path, offset, p_data, len) != (int)len)
+      {
+         return -1;
+      }
+      crc = pf_nvs_crc32(crc, p_data, len);
+   }
+   else
+   {
+      for (pos = 0; pos < p_header->len; pos += chunk)
+      {
+         chunk = MIN(p_header->len - pos, sizeof(net->nvs_buffer));
+         if (os_file_read(p_path, offset + pos, net->nvs_buffer, chunk) != (int)chunk)
+         {
+            return -1;
+         }
+         crc = pf_nvs_crc32(crc, net->nvs_buffer, chunk);
+      }
+   }
+
+   return (crc == p_header->crc) ? 0 : -1;
+}
+
+/**
+ * @internal
+ * Check if the data of a journal entry is equal to a buffer.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_path           In:   The journal file.
+ * @param p_record         In:   The journal entry.
+ * @param p_data           In:   The data to compare with.
+ * @param len              In:   Size of p_data.
+ * @return  true  if the stored data is equal to p_data.
+ *          false if not, or if it could not be read.
+ */
+static bool pf_nvs_is_equal(
+   pnet_t                  *net,
+   const char              *p_path,
+   const pf_nvs_record_t   *p_record,
+   const void              *p_data,
+   uint32_t                len)
+{
+   const uint8_t           *p = p_data;
+   uint32_t                offset = p_record->offset + sizeof(pf_nvs_entry_header_t);
+   uint32_t                pos;
+   uint32_t                chunk;
+
+   if ((p_record->valid == false) || (p_record->len != len))
+   {
+      return false;
+   }
+
+   for (pos = 0; pos < len; pos += chunk)
+   {
+      chunk = MIN(len - pos, sizeof(net->nvs_buffer));
+      if ((os_file_read(p_path, offset + pos, net->nvs_buffer, chunk) != (int)chunk) ||
+          (memcmp(net->nvs_buffer, &p[pos], chunk) != 0))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/**
+ * @internal
+ * Rewrite the journal with only the latest entry of each record.
+ *
+ * The new journal is written to a temporary file which then atomically
+ * replaces the old one. A power loss during compaction leaves the old
+ * journal intact.
+ *
+ * The caller must hold the nvs_mutex.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+static int pf_nvs_compact(
+   pnet_t                  *net)
+{
+   int                     ret = 0;
+   const char              *p_path = pf_nvs_journal_path(net);
+   char                    tmp_path[MAX_NONVOL_FILE_PATH_LENGTH + 4];
+   pf_nvs_record_t         records[PF_NVS_KEY_MAX];
+   uint32_t                size = 0;
+   uint32_t                entry_len;
+   uint32_t                pos;
+   uint32_t                chunk;
+   uint16_t                key;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", p_path);
+   (void)os_file_remove(tmp_path);
+
+   memcpy(records, net->nvs_records, sizeof(records));
+   for (key = 0; (key < PF_NVS_KEY_MAX) && (ret == 0); key++)
+   {
+      if (records[key].valid == true)
+      {
+         entry_len = sizeof(pf_nvs_entry_header_t) + records[key].len;
+         for (pos = 0; (pos < entry_len) && (ret == 0); pos += chunk)
+         {
+            chunk = MIN(entry_len - pos, sizeof(net->nvs_buffer));
+            if ((os_file_read(p_path, records[key].offset + pos, net->nvs_buffer, chunk) != (int)chunk) ||
+                (os_file_append(tmp_path, net->nvs_buffer, chunk) != 0))
+            {
+               ret = -1;
+            }
+         }
+         records[key].offset = size;
+         size += entry_len;
+      }
+   }
+
+   if (size == 0)
+   {
+      /* Nothing to keep */
+      (void)os_file_remove(tmp_path);
+      (void)os_file_remove(p_path);
+   }
+   else if ((ret != 0) ||
+            (os_file_sync(tmp_path) != 0) ||
+            (os_file_rename(tmp_path, p_path) != 0))
+   {
+      LOG_ERROR(PNET_LOG, "NVS(%d): Compaction of %s failed\n", __LINE__, p_path);
+      (void)os_file_remove(tmp_path);
+      ret = -1;
+   }
+
+   if (ret == 0)
+   {
+      memcpy(net->nvs_records, records, sizeof(records));
+      net->nvs_file_size = size;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Return the number of bytes in the journal used by the latest entries.
+ * @param net              InOut: The p-net stack instance
+ * @return the number of bytes.
+ */
+static uint32_t pf_nvs_live_size(
+   pnet_t                  *net)
+{
+   uint32_t                size = 0;
+   uint16_t                key;
+
+   for (key = 0; key < PF_NVS_KEY_MAX; key++)
+   {
+      if (net->nvs_records[key].valid == true)
+      {
+         size += sizeof(pf_nvs_entry_header_t) + net->nvs_records[key].len;
+      }
+   }
+
+   return size;
+}
+
+void pf_nvs_init(
+   pnet_t                  *net)
+{
+   const char              *p_path = pf_nvs_journal_path(net);
+   pf_nvs_entry_header_t   header;
+   uint32_t                offset = 0;
+   uint8_t                 dummy;
+
+   if (net->nvs_mutex == NULL)
+   {
+      net->nvs_mutex = os_mutex_create();
+   }
+   pf_nvs_crc_init();
+
+   memset(net->nvs_records, 0, sizeof(net->nvs_records));
+   net->nvs_file_size = 0;
+
+   if (p_path != NULL)
+   {
+      /* Later entries of a record replace earlier ones */
+      while (pf_nvs_read_entry(net, p_path, offset, &header, NULL, 0) == 0)
+      {
+         net->nvs_records[header.key].valid = true;
+         net->nvs_records[header.key].offset = offset;
+         net->nvs_records[header.key].len = header.len;
+         net->nvs_records[header.key].crc = header.crc;
+         offset += sizeof(header) + header.len;
+      }
+      net->nvs_file_size = offset;
+
+      if (os_file_read(p_path, offset, &dummy, sizeof(dummy)) > 0)
+      {
+         /* Interrupted write. Get rid of the torn entry before appending. */
+         LOG_WARNING(PNET_LOG, "NVS(%d): Discarding invalid data at offset %u in %s\n", __LINE__,
+            (unsigned)offset, p_path);
+         (void)pf_nvs_compact(net);
+      }
+   }
+}
+
+int pf_nvs_save(
+   pnet_t                  *net,
+   pf_nvs_key_t            key,
+   const void              *p_data,
+   uint32_t                len)
+{
+   int                     ret = -1;
+   const char              *p_path = pf_nvs_journal_path(net);
+   const char              *p_write_path;
+   char                    tmp_path[MAX_NONVOL_FILE_PATH_LENGTH + 4];
+   pf_nvs_entry_header_t   header;
+   pf_nvs_record_t         *p_record;
+
+   if (key >= PF_NVS_KEY_MAX)
+   {
+      LOG_ERROR(PNET_LOG, "NVS(%d): Bad key %u\n", __LINE__, (unsigned)key);
+   }
+   else if (p_path == NULL)
+   {
+      if ((pf_nvs_legacy_path(net, key) != NULL) &&
+          os_save_nvram_instance((char*)pf_nvs_legacy_path(net, key), (void*)p_data, len))
+      {
+         ret = 0;
+      }
+   }
+   else
+   {
+      header.magic = PF_NVS_MAGIC;
+      header.key = key;
+      header.reserved = 0;
+      header.len = len;
+      header.crc = 0;
+      header.crc = pf_nvs_crc32(pf_nvs_crc32(0, &header, sizeof(header)), p_data, len);
+
+      os_mutex_lock(net->nvs_mutex);
+      p_record = &net->nvs_records[key];
+
+      /* A new journal is written to a temporary file and renamed, so that
+         also its directory entry is on the media */
+      p_write_path = p_path;
+      if (net->nvs_file_size == 0)
+      {
+         snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", p_path);
+         (void)os_file_remove(tmp_path);
+         p_write_path = tmp_path;
+      }
+
+      if ((p_record->crc == header.crc) &&
+          (pf_nvs_is_equal(net, p_path, p_record, p_data, len) == true))
+      {
+         /* Unchanged */
+         ret = 0;
+      }
+      else if ((os_file_append(p_write_path, &header, sizeof(header)) == 0) &&
+               (os_file_append(p_write_path, p_data, len) == 0) &&
+               (os_file_sync(p_write_path) == 0) &&
+               ((p_write_path == p_path) || (os_file_rename(p_write_path, p_path) == 0)))
+      {
+         p_record->valid = true;
+         p_record->offset = net->nvs_file_size;
+         p_record->len = len;
+         p_record->crc = header.crc;
+         net->nvs_file_size += sizeof(header) + len;
+         ret = 0;
+
+         if (net->nvs_file_size > pf_nvs_live_size(net) + PF_NVS_COMPACT_SLACK)
+         {
+            (void)pf_nvs_compact(net);
+         }
+      }
+      else
+      {
+         /* A torn entry may be left at the end. Do not append after it. */
+         LOG_ERROR(PNET_LOG, "NVS(%d): Failed to save record %u\n", __LINE__, (unsigned)key);
+         (void)pf_nvs_compact(net);
+      }
+      os_mutex_unlock(net->nvs_mutex);
+   }
+
+   return ret;
+}
+
+int pf_nvs_load(
+   pnet_t                  *net,
+   pf_nvs_key_t            key,
+   void                    *p_data,
+   uint32_t                len)
+{
+   int                     ret = -1;
+   const char              *p_path = pf_nvs_journal_path(net);
+   const char              *p_legacy_path;
+   pf_nvs_entry_header_t   header;
+   bool                    found = false;
+
+   if (key >= PF_NVS_KEY_MAX)
+   {
+      LOG_ERROR(PNET_LOG, "NVS(%d): Bad key %u\n", __LINE__, (unsigned)key);
+      return -1;
+   }
+
+   p_legacy_path = pf_nvs_legacy_path(net, key);
+   if (p_path != NULL)
+   {
+      os_mutex_lock(net->nvs_mutex);
+      found = net->nvs_records[key].valid;
+      if ((found == true) &&
+          (pf_nvs_read_entry(net, p_path, net->nvs_records[key].offset, &header, p_data, len) == 0))
+      {
+         ret = 0;
+      }
+      os_mutex_unlock(net->nvs_mutex);
+   }
+
+   if ((ret != 0) && (found == false) && (p_legacy_path != NULL) &&
+       ((p_path == NULL) || (p_legacy_path[0] != '\0')))
+   {
+      if (os_restore_nvram_instance((char*)p_legacy_path, p_data, len))
+      {
+         ret = 0;
+         if (p_path != NULL)
+         {
+            /* Move it into the journal */
+            LOG_INFO(PNET_LOG, "NVS(%d): Moving %s into %s\n", __LINE__, p_legacy_path, p_path);
+            (void)pf_nvs_save(net, key, p_data, len);
+         }
+      }
+   }
+
+   return ret;
+}
@@ -0,0 +1,90 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Journaled nonvolatile store for I&M, diagnosis and PDev records.
+ *
+ * All records are kept in one append-only journal file. Each entry holds
+ * one version of one record, protected by a CRC. Saving a record appends
+ * a new entry, so only the changed record is written. The journal is
+ * compacted (rewritten with only the latest entries and atomically renamed)
+ * when it has grown too much, and at startup if a torn entry is found.
+ *
+ * If no journal file is configured the records are stored in the
+ * individual files given by the configuration, one file per record.
+ */
+
+#ifndef PF_NVS_H
+#define PF_NVS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Initialize the nonvolatile store.
+ *
+ * Read the journal file, if any, and recover from an interrupted write.
+ * Must be called after the configuration has been saved by pf_fspm_init().
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_nvs_init(
+   pnet_t                  *net);
+
+/**
+ * Save a record.
+ *
+ * Nothing is written if the record is unchanged.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param key              In:    The record key.
+ * @param p_data           In:    The record data.
+ * @param len              In:    The record size in bytes.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int pf_nvs_save(
+   pnet_t                  *net,
+   pf_nvs_key_t            key,
+   const void              *p_data,
+   uint32_t                len);
+
+/**
+ * Load a record.
+ *
+ * A record not yet in the journal is read from its individual file,
+ * if it exists, and is then moved into the journal.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param key              In:    The record key.
+ * @param p_data           Out:   The record data.
+ * @param len              In:    The expected record size in bytes.
+ * @return  0  if the record was found with the expected size.
+ *          -1 if not found or an error occurred.
+ */
+int pf_nvs_load(
+   pnet_t                  *net,
+   pf_nvs_key_t            key,
+   void                    *p_data,
+   uint32_t                len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_NVS_H */
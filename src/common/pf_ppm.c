@@ -162,13 +162,14 @@ static void pf_ppm_init_buf(
  * @internal
  * Finalize a PPM transmit message in the send buffer.
  *
- * Insert data, cycle counter, data status and transfer status.
+ * Insert data, cycle counter, data status and transfer status. The data of
+ * a DFP IOCR goes into its subframe.
  *
  * @param net              InOut: The p-net stack instance
  * @param p_ppm            In:   The PPM instance.
  * @param data_length      In:   The length of the message.
  */
-static void pf_ppm_finish_buffer(
+void pf_ppm_finish_buffer(
    pnet_t                  *net,
    pf_ppm_t                *p_ppm,
    uint16_t                data_length)
@@ -177,9 +178,12 @@ static void pf_ppm_finish_buffer(
    uint16_t                u16;
    uint16_t				   _remainder = 0,
 		   	   	   	   	   _ratio = 0;
-   int32_t                 cycle_tmp = os_get_current_time_us()*4;
+   uint64_t                cycle_tmp = os_get_current_time_ns();
 
-   cycle_tmp	= cycle_tmp/125;           /* Cycle counter. Get 4/125 = 31.25us tics */
+   /* Count the cycles of the sync master when synchronized */
+   (void)pf_ptcp_get_time(net, cycle_tmp, &cycle_tmp);
+
+   cycle_tmp	= cycle_tmp/31250;         /* Cycle counter. Get 31.25us tics */
    _ratio 		= p_ppm->send_clock_factor * p_ppm->reduction_ratio;
    _remainder	= cycle_tmp%_ratio;
    
@@ -191,16 +195,29 @@ static void pf_ppm_finish_buffer(
    else
 	   cycle_tmp = cycle_tmp - _remainder; 
    
-   p_ppm->cycle = cycle_tmp;           /* Cycle counter corrected! */
+   p_ppm->cycle = (uint16_t)cycle_tmp; /* Cycle counter corrected! */
 
    /*logMsg("Inteval: %u \n\r", p_ppm->control_interval,2,3,4,5,6);*/
    
    u16 = htons(p_ppm->cycle);
 
    /* Insert data */
-   os_mutex_lock(net->ppm_buf_lock);
-   memcpy(&p_payload[p_ppm->buffer_pos], p_ppm->buffer_data, data_length);
-   os_mutex_unlock(net->ppm_buf_lock);
+   if (p_ppm->dfp.active == true)
+   {
+      /* Into the subframe of this device. The rest of the packed frame is not touched. */
+      os_mutex_lock(net->ppm_buf_lock);
+      memcpy(&p_payload[pf_dfp_data_pos(&p_ppm->dfp, p_ppm->buffer_pos - sizeof(uint16_t))],
+         p_ppm->buffer_data, p_ppm->dfp.length);
+      os_mutex_unlock(net->ppm_buf_lock);
+      pf_dfp_put_subframe(&p_ppm->dfp, p_payload, p_ppm->buffer_pos - sizeof(uint16_t),
+         p_ppm->cycle, p_ppm->data_status);
+   }
+   else
+   {
+      os_mutex_lock(net->ppm_buf_lock);
+      memcpy(&p_payload[p_ppm->buffer_pos], p_ppm->buffer_data, data_length);
+      os_mutex_unlock(net->ppm_buf_lock);
+   }
 
    /* Insert cycle counter */
    memcpy(&p_payload[p_ppm->cycle_counter_offset], &u16, sizeof(u16));
@@ -265,6 +282,33 @@ uint32_t pf_ppm_calculate_compensated_delay(
 #endif
 }
 
+/**
+ * @internal
+ * Calculate the delay to the next send.
+ *
+ * When synchronized to a PTCP master, the frames are sent at the start of
+ * the cycles of the master. Otherwise the control interval is used.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_ppm            In:    The PPM instance.
+ * @param current_time     In:    The current time (system time in nanoseconds).
+ * @return Number of microseconds of delay to use with the scheduler.
+ */
+static uint32_t pf_ppm_next_delay(
+   pnet_t                  *net,
+   const pf_ppm_t          *p_ppm,
+   uint64_t                current_time)
+{
+   uint32_t                delay = p_ppm->compensated_control_interval;
+
+   if (pf_ptcp_phase_delay(net, current_time, p_ppm->control_interval, 0, &delay) == 0)
+   {
+      delay = pf_ppm_calculate_compensated_delay(delay, net->scheduler_tick_interval);
+   }
+
+   return delay;
+}
+
 /**
  * @internal
  * Send the PPM data message to the controller.
@@ -276,15 +320,16 @@ uint32_t pf_ppm_calculate_compensated_delay(
  *
  * @param net              InOut: The p-net stack instance
  * @param arg              In:    The IOCR instance.
- * @param current_time     In:    The current time (system time in microseconds).
+ * @param current_time     In:    The current time (system time in nanoseconds).
  */
 static void pf_ppm_send(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    pf_iocr_t               *p_arg = (pf_iocr_t *)arg;
    int                     ret = -1;
+   int                     sent;
    p_arg->ppm.ci_timer = UINT32_MAX;
    if (p_arg->ppm.ci_running == true)
    {
@@ -293,14 +338,18 @@ static void pf_ppm_send(
 
       /* Send the Ethernet frame */
       /* ToDo: Handle RT_CLASS_UDP */
-      if (os_eth_send(p_arg->p_ar->p_sess->eth_handle, p_arg->ppm.p_send_buffer) <= 0)
+      PF_TRACE2(ppm_send_start, p_arg->param.frame_id, p_arg->ppm.cycle);
+      sent = os_eth_send(p_arg->p_ar->p_sess->eth_handle, p_arg->ppm.p_send_buffer);
+      PF_TRACE2(ppm_send_done, p_arg->param.frame_id, sent);
+      if (sent <= 0)
       {
-    	  net->interface_statistics.ifOutErrors++;
+         pf_stats_out_error(net, PF_STATS_CTX_CYCLIC, PNET_TRAFFIC_CLASS_RT);
+         p_arg->ppm.errcnt++;
          LOG_ERROR(PF_PPM_LOG, "PPM(%d): Error from os_eth_send(ppm)\n", __LINE__);
       }
       else
       {
-    	  net->interface_statistics.ifOutOctects++;
+         pf_stats_out(net, PF_STATS_CTX_CYCLIC, PNET_TRAFFIC_CLASS_RT, ((os_buf_t *)p_arg->ppm.p_send_buffer)->len);
 #if PNET_OS_RTOS_SUPPORTED
       /*Santiy Check*/
       if(NULL != p_arg->ppm.rt_args->rt_timer)
@@ -311,7 +360,7 @@ static void pf_ppm_send(
       }
 #else
       /* Schedule next execution */
- 	  ret = pf_scheduler_add(net, p_arg->ppm.compensated_control_interval, ppm_sync_name, pf_ppm_send, arg, &p_arg->ppm.ci_timer);
+ 	  ret = pf_scheduler_add(net, pf_ppm_next_delay(net, &p_arg->ppm, current_time), ppm_sync_name, pf_ppm_send, arg, &p_arg->ppm.ci_timer);
 #endif
          if(ret == 0)
          {
@@ -337,7 +386,7 @@ static void pf_ppm_wdtimer_event(os_timer_t *timer)
 	pf_ppm_t			*p_ppm 			= (pf_ppm_t*)timer->arg;
 	pf_ppm_rt_args_t 	*p_ppm_rt_args	= p_ppm->rt_args;
 	
-	p_ppm_rt_args->cb( p_ppm_rt_args->net, p_ppm_rt_args->arg, p_ppm->ci_timer);
+	p_ppm_rt_args->cb( p_ppm_rt_args->net, p_ppm_rt_args->arg, os_get_current_time_ns());
 }
 #endif
 
@@ -369,7 +418,15 @@ int pf_ppm_activate_req(
       p_ppm->first_transmit = false;
 
       memcpy(&p_ppm->sa, &p_ar->ar_result.cm_responder_mac_add, sizeof(p_ppm->sa));
-      memcpy(&p_ppm->da, &p_ar->ar_param.cm_initiator_mac_add, sizeof(p_ppm->da));
+      if (p_iocr->param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER)
+      {
+         /* One frame per cycle for all consumers */
+         memcpy(&p_ppm->da, &p_iocr->param.iocr_multicast_mac_add, sizeof(p_ppm->da));
+      }
+      else
+      {
+         memcpy(&p_ppm->da, &p_ar->ar_param.cm_initiator_mac_add, sizeof(p_ppm->da));
+      }
 
       p_ppm->buffer_pos = 2*sizeof(pnet_ethaddr_t) + vlan_size + sizeof(uint16_t) + sizeof(uint16_t);
       p_ppm->cycle = 0;
@@ -394,9 +451,12 @@ int pf_ppm_activate_req(
             1 +                                                   /* data status */
             1;                                                    /* transfer status */
 
-      p_ppm->data_status = BIT(PNET_DATA_STATUS_BIT_STATE) +                 /* PRIMARY */
-                      BIT(PNET_DATA_STATUS_BIT_DATA_VALID) +
+      p_ppm->data_status = BIT(PNET_DATA_STATUS_BIT_DATA_VALID) +
                       BIT(PNET_DATA_STATUS_BIT_STATION_PROBLEM_INDICATOR);   /* Normal */
+      if (p_ar->ar_state != PF_AR_STATE_BACKUP)
+      {
+         p_ppm->data_status |= BIT(PNET_DATA_STATUS_BIT_STATE);             /* PRIMARY */
+      }
 
       /* Get the buffer to store the outgoing frame into. */
       p_ppm->p_send_buffer = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
@@ -407,6 +467,13 @@ int pf_ppm_activate_req(
          p_iocr->param.frame_id,
          &p_iocr->param.iocr_tag_header);
 
+      pf_dfp_get_subframe(p_ar, p_iocr->param.iocr_reference, &p_ppm->dfp);
+      if (p_ppm->dfp.active == true)
+      {
+         pf_dfp_put_header(((os_buf_t *)p_ppm->p_send_buffer)->payload,
+            p_ppm->buffer_pos - sizeof(uint16_t));
+      }
+
       p_ppm->control_interval = ((uint32_t)p_iocr->param.send_clock_factor *
             (uint32_t)p_iocr->param.reduction_ratio * 1000U) / 32U;   /* us */
       
@@ -452,7 +519,7 @@ int pf_ppm_activate_req(
     	  ret = -1;
       }
 #else
-      ret = pf_scheduler_add(net, p_ppm->compensated_control_interval,
+      ret = pf_scheduler_add(net, pf_ppm_next_delay(net, p_ppm, os_get_current_time_ns()),
          ppm_sync_name, pf_ppm_send, p_iocr, &p_ppm->ci_timer);
 #endif
       if (ret != 0)
@@ -508,6 +575,60 @@ int pf_ppm_close_req(
    return 0;
 }
 
+/**
+ * @internal
+ * Find the input IOCR and IODATA object instances for the specified sub-slot
+ * in an AR.
+ * @param p_ar             In:   The AR instance.
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param pp_iocr          Out:  The IOCR instance.
+ * @param pp_iodata        Out:  The IODATA object instance.
+ * @return  0  If the information has been found.
+ *          -1 If the information was not found.
+ */
+static int pf_ppm_find_iodata(
+   pf_ar_t                 *p_ar,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   pf_iocr_t               **pp_iocr,
+   pf_iodata_object_t      **pp_iodata)
+{
+   int                     ret = -1;
+   uint32_t                crep;
+   uint16_t                iodata_ix;
+   pf_iocr_t               *p_iocr = NULL;
+
+   /*
+    * Search the AR for an INPUT CR or an MC provider CR containing the
+    * sub-slot.
+    */
+   for (crep = 0; ((ret != 0) && (crep < p_ar->nbr_iocrs)); crep++)
+   {
+      if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+          (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
+      {
+         p_iocr = &p_ar->iocrs[crep];
+         for (iodata_ix = 0; ((ret != 0) && (iodata_ix < p_iocr->nbr_data_desc)); iodata_ix++)
+         {
+            if ((p_iocr->data_desc[iodata_ix].in_use == true) &&
+                (p_iocr->data_desc[iodata_ix].api_id == api_id) &&
+                (p_iocr->data_desc[iodata_ix].slot_nbr == slot_nbr) &&
+                (p_iocr->data_desc[iodata_ix].subslot_nbr == subslot_nbr))
+            {
+               *pp_iodata = &p_iocr->data_desc[iodata_ix];
+               *pp_iocr = p_iocr;
+               ret = 0;
+            }
+         }
+      }
+   }
+
+   return ret;
+}
+
 /**
  * @internal
  * Find the AR, input IOCR and IODATA object instances for the specified sub-slot.
@@ -531,12 +652,8 @@ static int pf_ppm_get_ar_iocr_desc(
    pf_iodata_object_t      **pp_iodata)
 {
    int                     ret = -1;
-   uint32_t                crep;
-   uint16_t                iodata_ix;
    pf_subslot_t            *p_subslot = NULL;
    pf_ar_t                 *p_ar = NULL;
-   pf_iocr_t               *p_iocr = NULL;
-   bool                    found = false;
 
    if (pf_cmdev_get_subslot_full(net, api_id, slot_nbr, subslot_nbr, &p_subslot) == 0)
    {
@@ -547,42 +664,76 @@ static int pf_ppm_get_ar_iocr_desc(
    {
       LOG_DEBUG(PF_PPM_LOG, "PPM(%d): No AR set in sub-slot\n", __LINE__);
    }
-   else
+   else if (pf_ppm_find_iodata(p_ar, api_id, slot_nbr, subslot_nbr, pp_iocr, pp_iodata) == 0)
    {
-      /*
-       * Search the AR for an INPUT CR or an MC provider CR containing the
-       * sub-slot.
-       */
-      for (crep = 0; ((found == false) && (crep < p_ar->nbr_iocrs)); crep++)
+      *pp_ar = p_ar;
+      ret = 0;
+   }
+
+   return ret;
+}
+
+#if PNET_OPTION_SR
+/**
+ * @internal
+ * Copy the inputs of a sub-slot to the backup ARs of its AR set.
+ *
+ * This keeps the backup PPMs ready to take over. Only the ARs with a
+ * running PPM and the same data lengths are updated.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR owning the sub-slot.
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param p_data           In:   The data, or NULL.
+ * @param data_len         In:   The length of the data.
+ * @param p_iops           In:   The IOPS, or NULL.
+ * @param iops_len         In:   The length of the IOPS.
+ * @param p_iocs           In:   The IOCS, or NULL.
+ * @param iocs_len         In:   The length of the IOCS.
+ */
+static void pf_ppm_set_backup_data(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   const uint8_t           *p_data,
+   uint16_t                data_len,
+   const uint8_t           *p_iops,
+   uint8_t                 iops_len,
+   const uint8_t           *p_iocs,
+   uint8_t                 iocs_len)
+{
+   pf_ar_t                 *p_backup = NULL;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   uint16_t                ix = 0;
+
+   while ((p_backup = pf_cmsr_get_next(net, p_ar, &ix)) != NULL)
+   {
+      if ((pf_ppm_find_iodata(p_backup, api_id, slot_nbr, subslot_nbr, &p_iocr, &p_iodata) == 0) &&
+          (p_iocr->ppm.state == PF_PPM_STATE_RUN))
       {
-         if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
-             (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
+         os_mutex_lock(net->ppm_buf_lock);
+         if ((p_data != NULL) && (data_len > 0) && (data_len == p_iodata->data_length))
          {
-            p_iocr = &p_ar->iocrs[crep];
-            for (iodata_ix = 0; ((found == false) && (iodata_ix < p_iocr->nbr_data_desc)); iodata_ix++)
-            {
-               if ((p_iocr->data_desc[iodata_ix].in_use == true) &&
-                   (p_iocr->data_desc[iodata_ix].api_id == api_id) &&
-                   (p_iocr->data_desc[iodata_ix].slot_nbr == slot_nbr) &&
-                   (p_iocr->data_desc[iodata_ix].subslot_nbr == subslot_nbr))
-               {
-                  *pp_iodata = &p_iocr->data_desc[iodata_ix];
-                  *pp_iocr = p_iocr;
-                  *pp_ar = p_ar;
-                  found = true;
-               }
-            }
+            memcpy(&p_iocr->ppm.buffer_data[p_iodata->data_offset], p_data, data_len);
+            p_iodata->data_avail = true;
+         }
+         if ((p_iops != NULL) && (iops_len > 0) && (iops_len == p_iodata->iops_length))
+         {
+            memcpy(&p_iocr->ppm.buffer_data[p_iodata->iops_offset], p_iops, iops_len);
          }
+         if ((p_iocs != NULL) && (iocs_len > 0) && (iocs_len == p_iodata->iocs_length))
+         {
+            memcpy(&p_iocr->ppm.buffer_data[p_iodata->iocs_offset], p_iocs, iocs_len);
+         }
+         os_mutex_unlock(net->ppm_buf_lock);
       }
    }
-
-   if (found == true)
-   {
-      ret = 0;
-   }
-
-   return ret;
 }
+#endif
 
 /**************** Set and get data, IOPS and IOCS ****************************/
 
@@ -626,6 +777,10 @@ int pf_ppm_set_data_and_iops(
             os_mutex_unlock(net->ppm_buf_lock);
 
             p_iodata->data_avail = true;
+#if PNET_OPTION_SR
+            pf_ppm_set_backup_data(net, p_ar, api_id, slot_nbr, subslot_nbr,
+               p_data, data_len, p_iops, iops_len, NULL, 0);
+#endif
             ret = 0;
          }
          else
@@ -677,6 +832,10 @@ int pf_ppm_set_iocs(
             os_mutex_lock(net->ppm_buf_lock);
             memcpy(&p_iocr->ppm.buffer_data[p_iodata->iocs_offset], p_iocs, iocs_len);
             os_mutex_unlock(net->ppm_buf_lock);
+#if PNET_OPTION_SR
+            pf_ppm_set_backup_data(net, p_ar, api_id, slot_nbr, subslot_nbr,
+               NULL, 0, NULL, 0, p_iocs, iocs_len);
+#endif
 
             ret = 0;
          }
@@ -762,6 +921,29 @@ int pf_ppm_get_data_and_iops(
    return ret;
 }
 
+int pf_ppm_get_data_and_iops_len(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops_len)
+{
+   int                     ret = -1;
+   pf_iocr_t               *p_iocr = NULL;
+   pf_iodata_object_t      *p_iodata = NULL;
+   pf_ar_t                 *p_ar = NULL;
+
+   if (pf_ppm_get_ar_iocr_desc(net, api_id, slot_nbr, subslot_nbr, &p_ar, &p_iocr, &p_iodata) == 0)
+   {
+      *p_data_len = p_iodata->data_length;
+      *p_iops_len = (uint8_t)p_iodata->iops_length;
+      ret = 0;
+   }
+
+   return ret;
+}
+
 /**
  * Retrieve IOCS for a sub-module.
  * @param net              InOut: The p-net stack instance
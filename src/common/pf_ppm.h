@@ -122,6 +122,27 @@ int pf_ppm_get_data_and_iops(
    uint8_t                 *p_iops,
    uint8_t                 *p_iops_len);
 
+/**
+ * Retrieve the data and IOPS lengths of a sub-module.
+ *
+ * Lets a caller reserve room for the data and IOPS before retrieving them.
+ * @param net              InOut: The p-net stack instance
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
+ * @param p_data_len       Out:  Length of the sub-module data.
+ * @param p_iops_len       Out:  Length of the IOPS.
+ * @return  0  if the lengths could be retrieved.
+ *          -1 if an error occurred.
+ */
+int pf_ppm_get_data_and_iops_len(
+   pnet_t                  *net,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   uint16_t                *p_data_len,
+   uint8_t                 *p_iops_len);
+
 /**
  * Retrieve IOCS for a sub-module.
  * @param net              InOut: The p-net stack instance
@@ -216,6 +237,11 @@ uint32_t pf_ppm_calculate_compensated_delay(
    uint32_t                stack_cycle_time
 );
 
+void pf_ppm_finish_buffer(
+   pnet_t                  *net,
+   pf_ppm_t                *p_ppm,
+   uint16_t                data_length);
+
 
 #ifdef __cplusplus
 }
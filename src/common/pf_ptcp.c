@@ -14,10 +14,901 @@
  ********************************************************************/
 
 #ifdef UNIT_TEST
-
+#define os_eth_send           mock_os_eth_send
+#define os_eth_rx_timestamp   mock_os_eth_rx_timestamp
 #endif
 
+#include <string.h>
 #include "pf_includes.h"
 
+#define PF_PTCP_NSEC                      1000000000LL
+#define PF_PTCP_SYNC_TIMEOUT              (1000LL * 1000 * 1000)  /* ns without sync frames before the master is lost */
+#define PF_PTCP_DELAY_INTERVAL            (200 * 1000)            /* us between delay requests */
+#define PF_PTCP_STEP_LIMIT                (1000 * 1000)           /* ns. Larger offsets step the clock */
+#define PF_PTCP_LOCK_LIMIT                (20 * 1000)             /* ns */
+#define PF_PTCP_UNLOCK_LIMIT              (100 * 1000)            /* ns */
+#define PF_PTCP_LOCK_COUNT                8                       /* Sync frames within PF_PTCP_LOCK_LIMIT */
+#define PF_PTCP_MAX_RATE                  (500 * 1000)            /* ppb */
+
+/*
+ * Gains of the servo, per sync frame. The proportional part corrects 1/8 of
+ * the offset until the next sync frame, which filters the jitter of software
+ * timestamps. With the integral part, the servo settles within about 100
+ * sync frames whatever the sync interval.
+ */
+#define PF_PTCP_KP_DIV                    8
+#define PF_PTCP_KI_DIV                    128
+
+#define PF_PTCP_DELAY_FILTER_DIV          8                       /* Weight of a new line delay sample */
+#define PF_PTCP_MIN_FRAME_SIZE            60
+#define PF_PTCP_READ_TRIES                4                       /* Of pf_ptcp_get_time() while the clock is written */
+
+static const char          *ptcp_delay_name = "ptcp_delay";
+static const pnet_ethaddr_t ptcp_delay_mc_addr = { { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e } };
+
+/**
+ * @internal
+ * Read a big-endian 16 bit value.
+ *
+ * @param p_data           In:   The data.
+ * @return the value.
+ */
+static uint16_t pf_ptcp_get_u16(
+   const uint8_t           *p_data)
+{
+   return (uint16_t)((p_data[0] << 8) | p_data[1]);
+}
+
+/**
+ * @internal
+ * Read a big-endian 32 bit value.
+ *
+ * @param p_data           In:   The data.
+ * @return the value.
+ */
+static uint32_t pf_ptcp_get_u32(
+   const uint8_t           *p_data)
+{
+   return ((uint32_t)p_data[0] << 24) | ((uint32_t)p_data[1] << 16) |
+          ((uint32_t)p_data[2] << 8) | p_data[3];
+}
+
+/**
+ * @internal
+ * Write a big-endian 16 bit value.
+ *
+ * @param value            In:   The value.
+ * @param p_data           Out:  The data.
+ */
+static void pf_ptcp_put_u16(
+   uint16_t                value,
+   uint8_t                 *p_data)
+{
+   p_data[0] = (uint8_t)(value >> 8);
+   p_data[1] = (uint8_t)value;
+}
+
+/**
+ * @internal
+ * Write a big-endian 32 bit value.
+ *
+ * @param value            In:   The value.
+ * @param p_data           Out:  The data.
+ */
+static void pf_ptcp_put_u32(
+   uint32_t                value,
+   uint8_t                 *p_data)
+{
+   p_data[0] = (uint8_t)(value >> 24);
+   p_data[1] = (uint8_t)(value >> 16);
+   p_data[2] = (uint8_t)(value >> 8);
+   p_data[3] = (uint8_t)value;
+}
+
+/**
+ * @internal
+ * Read the PTCP header.
+ *
+ * @param p_frame          In:   The frame.
+ * @param len              In:   Length of the frame.
+ * @param pos              In:   Position of the header.
+ * @param p_sequence       Out:  The SequenceID.
+ * @param p_delay          Out:  The delay, in nanoseconds.
+ * @return  0  if the header is within the frame.
+ *          -1 if not.
+ */
+static int pf_ptcp_get_header(
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint16_t                pos,
+   uint16_t                *p_sequence,
+   uint32_t                *p_delay)
+{
+   int                     ret = -1;
+
+   if ((uint32_t)pos + PF_PTCP_HEADER_SIZE <= len)
+   {
+      *p_sequence = pf_ptcp_get_u16(&p_frame[pos + 12]);
+      *p_delay = pf_ptcp_get_u32(&p_frame[pos + 8]) * 10 +
+                 p_frame[pos + 14] +
+                 pf_ptcp_get_u32(&p_frame[pos + 16]);
+      ret = 0;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Write the PTCP header.
+ *
+ * @param sequence         In:   The SequenceID.
+ * @param delay            In:   The delay, in nanoseconds.
+ * @param p_data           Out:  The header.
+ */
+static void pf_ptcp_put_header(
+   uint16_t                sequence,
+   uint32_t                delay,
+   uint8_t                 *p_data)
+{
+   memset(p_data, 0, PF_PTCP_HEADER_SIZE);
+   pf_ptcp_put_u32(delay / 10, &p_data[8]);
+   pf_ptcp_put_u16(sequence, &p_data[12]);
+   p_data[14] = (uint8_t)(delay % 10);
+}
+
+/**
+ * @internal
+ * Find a TLV.
+ *
+ * @param p_frame          In:   The frame.
+ * @param len              In:   Length of the frame.
+ * @param pos              In:   Position of the first TLV.
+ * @param type             In:   The type to look for.
+ * @param size             In:   The expected length of the value.
+ * @return  the position of the value, or 0 if not found.
+ */
+static uint16_t pf_ptcp_find_tlv(
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint16_t                pos,
+   uint8_t                 type,
+   uint16_t                size)
+{
+   uint16_t                ret = 0;
+   uint16_t                tlv;
+   bool                    done = false;
+
+   while ((done == false) && ((uint32_t)pos + PF_PTCP_TLV_HEADER_SIZE <= len))
+   {
+      tlv = pf_ptcp_get_u16(&p_frame[pos]);
+      pos += PF_PTCP_TLV_HEADER_SIZE;
+      if (((uint32_t)pos + (tlv & 0x1ff) > len) ||
+          ((tlv >> 9) == PF_PTCP_TLV_END))
+      {
+         done = true;
+      }
+      else if ((tlv >> 9) == type)
+      {
+         if ((tlv & 0x1ff) >= size)
+         {
+            ret = pos;
+         }
+         done = true;
+      }
+      else
+      {
+         pos += tlv & 0x1ff;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Write a TLV header.
+ *
+ * @param type             In:   The type.
+ * @param size             In:   The length of the value.
+ * @param p_data           Out:  The TLV header.
+ */
+static void pf_ptcp_put_tlv(
+   uint8_t                 type,
+   uint16_t                size,
+   uint8_t                 *p_data)
+{
+   pf_ptcp_put_u16((uint16_t)((type << 9) | (size & 0x1ff)), p_data);
+}
+
+/**
+ * @internal
+ * Read the time of the master from the Time TLV.
+ *
+ * @param p_frame          In:   The frame.
+ * @param len              In:   Length of the frame.
+ * @param pos              In:   Position of the first TLV.
+ * @param p_time           Out:  The time, in nanoseconds since the PTCP epoch.
+ * @return  0  if the frame has a Time TLV.
+ *          -1 if not.
+ */
+static int pf_ptcp_get_time_tlv(
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint16_t                pos,
+   int64_t                 *p_time)
+{
+   int                     ret = -1;
+
+   pos = pf_ptcp_find_tlv(p_frame, len, pos, PF_PTCP_TLV_TIME, PF_PTCP_TIME_SIZE);
+   if (pos != 0)
+   {
+      *p_time = (int64_t)pf_ptcp_get_u32(&p_frame[pos + 2]) * PF_PTCP_NSEC +
+                pf_ptcp_get_u32(&p_frame[pos + 6]);
+      ret = 0;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Set the state of the sync slave.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param state            In:   The new state.
+ */
+static void pf_ptcp_set_state(
+   pnet_t                  *net,
+   pnet_ptcp_state_t       state)
+{
+   if (net->ptcp.state != state)
+   {
+      LOG_INFO(PNET_LOG, "PTCP(%d): State %u -> %u\n", __LINE__,
+         (unsigned)net->ptcp.state, (unsigned)state);
+      __atomic_store_n(&net->ptcp.state, state, __ATOMIC_RELEASE);
+   }
+}
+
+/**
+ * @internal
+ * Get the time of the synchronized clock.
+ *
+ * @param p_clock          In:   The clock.
+ * @param local_time       In:   The local time, in nanoseconds.
+ * @return the time of the master, in nanoseconds.
+ */
+static int64_t pf_ptcp_clock(
+   const pf_ptcp_clock_t   *p_clock,
+   uint64_t                local_time)
+{
+   int64_t                 dt = (int64_t)(local_time - p_clock->local_ref);
+
+   return p_clock->master_ref + dt + (dt * p_clock->rate) / PF_PTCP_NSEC;
+}
+
+/**
+ * @internal
+ * Copy the clock for pf_ptcp_get_time(). The mutex must be held.
+ *
+ * clock_seq is odd while the copy is written, so that a reader can detect
+ * a copy that changed while it was read.
+ *
+ * @param p_ptcp           InOut: The sync slave.
+ */
+static void pf_ptcp_publish(
+   pf_ptcp_t               *p_ptcp)
+{
+   uint32_t                seq = p_ptcp->clock_seq;      /* Only written here */
+
+   __atomic_store_n(&p_ptcp->clock_seq, seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   p_ptcp->clock_copy = p_ptcp->clock;
+   __atomic_store_n(&p_ptcp->clock_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @internal
+ * Limit a frequency correction.
+ *
+ * @param rate             In:   The correction, in ppb.
+ * @return the limited correction.
+ */
+static int64_t pf_ptcp_limit_rate(
+   int64_t                 rate)
+{
+   if (rate > PF_PTCP_MAX_RATE)
+   {
+      rate = PF_PTCP_MAX_RATE;
+   }
+   else if (rate < -PF_PTCP_MAX_RATE)
+   {
+      rate = -PF_PTCP_MAX_RATE;
+   }
+
+   return rate;
+}
+
+/**
+ * @internal
+ * Adjust the synchronized clock to a sync frame. The mutex must be held.
+ *
+ * The offset is corrected by changing the rate of the clock until the next
+ * sync frame, so the time never jumps unless the offset is too large.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param master_time      In:   The time of the master when the frame was received.
+ * @param local_time       In:   The local time when the frame was received.
+ */
+static void pf_ptcp_servo(
+   pnet_t                  *net,
+   int64_t                 master_time,
+   uint64_t                local_time)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   int64_t                 interval = (int64_t)(local_time - p_ptcp->clock.local_ref);
+   int64_t                 error = 0;
+   int64_t                 predicted = 0;
+
+   if (p_ptcp->clock_valid == true)
+   {
+      predicted = pf_ptcp_clock(&p_ptcp->clock, local_time);
+      error = master_time - predicted;
+   }
+
+   if ((p_ptcp->clock_valid == false) ||
+       (interval <= 0) ||
+       (interval > PF_PTCP_SYNC_TIMEOUT) ||
+       (error > PF_PTCP_STEP_LIMIT) ||
+       (error < -PF_PTCP_STEP_LIMIT))
+   {
+      /* Step. The rate found so far is kept */
+      p_ptcp->clock.master_ref = master_time;
+      p_ptcp->clock.local_ref = local_time;
+      p_ptcp->clock_valid = true;
+      p_ptcp->offset = error;
+      p_ptcp->lock_count = 0;
+      p_ptcp->step_count++;
+      pf_ptcp_set_state(net, PNET_PTCP_STATE_LOCKING);
+   }
+   else
+   {
+      p_ptcp->integral = pf_ptcp_limit_rate(p_ptcp->integral +
+         (error * PF_PTCP_NSEC) / (interval * PF_PTCP_KI_DIV));
+      p_ptcp->clock.rate = pf_ptcp_limit_rate(p_ptcp->integral +
+         (error * PF_PTCP_NSEC) / (interval * PF_PTCP_KP_DIV));
+      p_ptcp->clock.master_ref = predicted;
+      p_ptcp->clock.local_ref = local_time;
+      p_ptcp->offset = error;
+
+      if ((error < PF_PTCP_LOCK_LIMIT) && (error > -PF_PTCP_LOCK_LIMIT))
+      {
+         if (p_ptcp->lock_count < PF_PTCP_LOCK_COUNT)
+         {
+            p_ptcp->lock_count++;
+         }
+         if (p_ptcp->lock_count >= PF_PTCP_LOCK_COUNT)
+         {
+            pf_ptcp_set_state(net, PNET_PTCP_STATE_SYNC);
+         }
+      }
+      else
+      {
+         p_ptcp->lock_count = 0;
+         if ((error > PF_PTCP_UNLOCK_LIMIT) || (error < -PF_PTCP_UNLOCK_LIMIT))
+         {
+            pf_ptcp_set_state(net, PNET_PTCP_STATE_LOCKING);
+         }
+      }
+   }
+}
+
+/**
+ * @internal
+ * Send a DelayReq frame and schedule the next one.
+ *
+ * Stops when the master is lost.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   Not used.
+ * @param current_time     In:   The current time, in nanoseconds.
+ */
+static void pf_ptcp_delay_timeout(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   os_buf_t                *p_buf = NULL;
+   uint8_t                 *p_frame;
+   const pnet_cfg_t        *p_cfg = NULL;
+   uint16_t                pos = 0;
+   bool                    running;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   os_mutex_lock(p_ptcp->mutex);
+   p_ptcp->delay_timeout = 0;
+   if ((int64_t)(current_time - p_ptcp->clock.last_sync) > PF_PTCP_SYNC_TIMEOUT)
+   {
+      LOG_INFO(PNET_LOG, "PTCP(%d): Lost the sync master\n", __LINE__);
+      pf_ptcp_set_state(net, PNET_PTCP_STATE_LISTENING);
+      p_ptcp->sync_pending = false;
+      p_ptcp->delay_running = false;
+   }
+   running = p_ptcp->delay_running;
+   os_mutex_unlock(p_ptcp->mutex);
+
+   if (running == true)
+   {
+      p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   }
+   if (p_buf != NULL)
+   {
+      p_frame = (uint8_t *)p_buf->payload;
+      memset(p_frame, 0, PF_PTCP_MIN_FRAME_SIZE);
+      memcpy(&p_frame[pos], ptcp_delay_mc_addr.addr, sizeof(pnet_ethaddr_t));
+      pos += sizeof(pnet_ethaddr_t);
+      memcpy(&p_frame[pos], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t));
+      pos += sizeof(pnet_ethaddr_t);
+      pf_ptcp_put_u16(OS_ETHTYPE_PROFINET, &p_frame[pos]);
+      pos += sizeof(uint16_t);
+      pf_ptcp_put_u16(PF_PTCP_FRAME_ID_DELAY_REQ, &p_frame[pos]);
+      pos += sizeof(uint16_t);
+      pos += PF_PTCP_HEADER_SIZE;            /* Filled in below */
+      pf_ptcp_put_tlv(PF_PTCP_TLV_DELAY_PARAMETER, PF_PTCP_DELAY_PARAMETER_SIZE, &p_frame[pos]);
+      pos += PF_PTCP_TLV_HEADER_SIZE;
+      memcpy(&p_frame[pos], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t));
+      pos += PF_PTCP_DELAY_PARAMETER_SIZE;
+      pf_ptcp_put_tlv(PF_PTCP_TLV_END, 0, &p_frame[pos]);
+      pos += PF_PTCP_TLV_HEADER_SIZE;
+      p_buf->len = (pos < PF_PTCP_MIN_FRAME_SIZE) ? PF_PTCP_MIN_FRAME_SIZE : pos;
+
+      os_mutex_lock(p_ptcp->mutex);
+      p_ptcp->delay_sequence++;
+      pf_ptcp_put_header(p_ptcp->delay_sequence, 0, &p_frame[2 * sizeof(pnet_ethaddr_t) + 2 * sizeof(uint16_t)]);
+      p_ptcp->delay_req_sent = os_get_current_time_ns();
+      os_mutex_unlock(p_ptcp->mutex);
+
+      if (os_eth_send(net->eth_handle, p_buf) <= 0)
+      {
+         pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_OTHER);
+         LOG_ERROR(PNET_LOG, "PTCP(%d): Error from os_eth_send(ptcp)\n", __LINE__);
+      }
+      else
+      {
+         pf_stats_out(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_OTHER, p_buf->len);
+      }
+      os_buf_free(p_buf);
+   }
+
+   if ((running == true) &&
+       (pf_scheduler_add(net, PF_PTCP_DELAY_INTERVAL, ptcp_delay_name,
+          pf_ptcp_delay_timeout, NULL, &p_ptcp->delay_timeout) != 0))
+   {
+      LOG_ERROR(PNET_LOG, "PTCP(%d): Timeout not started\n", __LINE__);
+      os_mutex_lock(p_ptcp->mutex);
+      p_ptcp->delay_running = false;
+      os_mutex_unlock(p_ptcp->mutex);
+   }
+}
+
+/**
+ * @internal
+ * Use a sync frame. The mutex must be held.
+ *
+ * Starts the line delay measurement when a new master is followed.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param master_time      In:   The send time of the master plus the delay on the way.
+ * @param local_time       In:   The receive time.
+ * @return  true  if the line delay measurement shall be started.
+ *          false if not.
+ */
+static bool pf_ptcp_sync(
+   pnet_t                  *net,
+   int64_t                 master_time,
+   uint64_t                local_time)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   bool                    start = false;
+
+   pf_ptcp_servo(net, master_time + p_ptcp->line_delay, local_time);
+   p_ptcp->clock.last_sync = local_time;
+   pf_ptcp_publish(p_ptcp);
+   p_ptcp->sync_count++;
+
+   if (p_ptcp->delay_running == false)
+   {
+      p_ptcp->delay_running = true;
+      start = true;
+   }
+
+   return start;
+}
+
+/**
+ * @internal
+ * Check the master of a sync frame. The mutex must be held.
+ *
+ * A new master is only accepted while no master is followed.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_frame          In:   The frame.
+ * @param len              In:   Length of the frame.
+ * @param pos              In:   Position of the first TLV.
+ * @return  true  if the frame is from the master that is followed.
+ *          false if not.
+ */
+static bool pf_ptcp_check_master(
+   pnet_t                  *net,
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint16_t                pos)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   bool                    ret = false;
+
+   pos = pf_ptcp_find_tlv(p_frame, len, pos, PF_PTCP_TLV_SUBDOMAIN, PF_PTCP_SUBDOMAIN_SIZE);
+   if (pos != 0)
+   {
+      if (p_ptcp->state == PNET_PTCP_STATE_LISTENING)
+      {
+         memcpy(p_ptcp->master_addr.addr, &p_frame[pos], sizeof(pnet_ethaddr_t));
+         p_ptcp->sync_pending = false;
+         LOG_INFO(PNET_LOG, "PTCP(%d): Following sync master %02x:%02x:%02x:%02x:%02x:%02x\n", __LINE__,
+            p_frame[pos], p_frame[pos + 1], p_frame[pos + 2],
+            p_frame[pos + 3], p_frame[pos + 4], p_frame[pos + 5]);
+         pf_ptcp_set_state(net, PNET_PTCP_STATE_LOCKING);
+         ret = true;
+      }
+      else
+      {
+         ret = (memcmp(p_ptcp->master_addr.addr, &p_frame[pos], sizeof(pnet_ethaddr_t)) == 0);
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Handle an RTSync or FollowUp frame.
+ *
+ * This is a callback for the frame handler. Arguments should fulfill pf_eth_frame_handler_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param frame_id         In:   The frame ID.
+ * @param p_buf            In:   The Ethernet frame.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @param p_arg            In:   Not used.
+ * @return  1  The frame was handled and the buffer freed.
+ */
+static int pf_ptcp_sync_ind(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   uint64_t                rx_time = os_eth_rx_timestamp(net->eth_handle);
+   const uint8_t           *p_frame = (const uint8_t *)p_buf->payload;
+   uint16_t                pos = frame_id_pos + sizeof(uint16_t);
+   uint16_t                sequence = 0;
+   uint32_t                delay = 0;
+   int64_t                 master_time = 0;
+   bool                    start = false;
+
+   if (pf_ptcp_get_header(p_frame, p_buf->len, pos, &sequence, &delay) == 0)
+   {
+      pos += PF_PTCP_HEADER_SIZE;
+      os_mutex_lock(p_ptcp->mutex);
+      if (pf_ptcp_check_master(net, p_frame, p_buf->len, pos) == true)
+      {
+         if (frame_id == PF_PTCP_FRAME_ID_RTSYNC_FU)
+         {
+            p_ptcp->sync_pending = true;
+            p_ptcp->sync_sequence = sequence;
+            p_ptcp->sync_rx = rx_time;
+            p_ptcp->sync_delay = delay;
+         }
+         else if (pf_ptcp_get_time_tlv(p_frame, p_buf->len, pos, &master_time) == 0)
+         {
+            if (frame_id == PF_PTCP_FRAME_ID_RTSYNC)
+            {
+               start = pf_ptcp_sync(net, master_time + delay, rx_time);
+            }
+            else if ((p_ptcp->sync_pending == true) && (p_ptcp->sync_sequence == sequence))
+            {
+               /* The follow up has the delays of its own way too */
+               p_ptcp->sync_pending = false;
+               start = pf_ptcp_sync(net, master_time + p_ptcp->sync_delay + delay, p_ptcp->sync_rx);
+            }
+         }
+      }
+      os_mutex_unlock(p_ptcp->mutex);
+   }
+
+   /* Sent from the thread of the scheduler, which counts it */
+   if ((start == true) &&
+       (pf_scheduler_add(net, 0, ptcp_delay_name,
+          pf_ptcp_delay_timeout, NULL, &p_ptcp->delay_timeout) != 0))
+   {
+      LOG_ERROR(PNET_LOG, "PTCP(%d): Timeout not started\n", __LINE__);
+      os_mutex_lock(p_ptcp->mutex);
+      p_ptcp->delay_running = false;
+      os_mutex_unlock(p_ptcp->mutex);
+   }
+
+   os_buf_free(p_buf);
+   return 1;
+}
+
+/**
+ * @internal
+ * Answer a DelayReq frame from a neighbour.
+ *
+ * This is a callback for the frame handler. Arguments should fulfill pf_eth_frame_handler_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param frame_id         In:   The frame ID.
+ * @param p_buf            In:   The Ethernet frame.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @param p_arg            In:   Not used.
+ * @return  1  The frame was handled and the buffer freed.
+ */
+static int pf_ptcp_delay_req_ind(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg)
+{
+   uint64_t                rx_time = os_eth_rx_timestamp(net->eth_handle);
+   const uint8_t           *p_req = (const uint8_t *)p_buf->payload;
+   os_buf_t                *p_rsp = NULL;
+   uint8_t                 *p_frame;
+   const pnet_cfg_t        *p_cfg = NULL;
+   uint16_t                sequence = 0;
+   uint32_t                delay = 0;
+   uint16_t                header_pos;
+   uint16_t                pos = 0;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   if (pf_ptcp_get_header(p_req, p_buf->len, frame_id_pos + sizeof(uint16_t), &sequence, &delay) == 0)
+   {
+      p_rsp = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   }
+   if (p_rsp != NULL)
+   {
+      p_frame = (uint8_t *)p_rsp->payload;
+      memset(p_frame, 0, PF_PTCP_MIN_FRAME_SIZE);
+      memcpy(&p_frame[pos], ptcp_delay_mc_addr.addr, sizeof(pnet_ethaddr_t));
+      pos += sizeof(pnet_ethaddr_t);
+      memcpy(&p_frame[pos], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t));
+      pos += sizeof(pnet_ethaddr_t);
+      pf_ptcp_put_u16(OS_ETHTYPE_PROFINET, &p_frame[pos]);
+      pos += sizeof(uint16_t);
+      pf_ptcp_put_u16(PF_PTCP_FRAME_ID_DELAY_RES, &p_frame[pos]);
+      pos += sizeof(uint16_t);
+      header_pos = pos;
+      pos += PF_PTCP_HEADER_SIZE;
+      pf_ptcp_put_tlv(PF_PTCP_TLV_DELAY_PARAMETER, PF_PTCP_DELAY_PARAMETER_SIZE, &p_frame[pos]);
+      pos += PF_PTCP_TLV_HEADER_SIZE;
+      memcpy(&p_frame[pos], &p_req[sizeof(pnet_ethaddr_t)], sizeof(pnet_ethaddr_t));   /* The source address */
+      pos += PF_PTCP_DELAY_PARAMETER_SIZE;
+      pf_ptcp_put_tlv(PF_PTCP_TLV_END, 0, &p_frame[pos]);
+      pos += PF_PTCP_TLV_HEADER_SIZE;
+      p_rsp->len = (pos < PF_PTCP_MIN_FRAME_SIZE) ? PF_PTCP_MIN_FRAME_SIZE : pos;
+
+      /* The time we took to answer */
+      pf_ptcp_put_header(sequence, (uint32_t)(os_get_current_time_ns() - rx_time), &p_frame[header_pos]);
+      if (os_eth_send(net->eth_handle, p_rsp) <= 0)
+      {
+         pf_stats_out_error(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_OTHER);
+         LOG_ERROR(PNET_LOG, "PTCP(%d): Error from os_eth_send(ptcp)\n", __LINE__);
+      }
+      else
+      {
+         pf_stats_out(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_OTHER, p_rsp->len);
+      }
+      os_buf_free(p_rsp);
+   }
+
+   os_buf_free(p_buf);
+   return 1;
+}
+
+/**
+ * @internal
+ * Measure the line delay from a DelayRes frame.
+ *
+ * This is a callback for the frame handler. Arguments should fulfill pf_eth_frame_handler_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param frame_id         In:   The frame ID.
+ * @param p_buf            In:   The Ethernet frame.
+ * @param frame_id_pos     In:   Position of the frame ID in the frame.
+ * @param p_arg            In:   Not used.
+ * @return  1  The frame was handled and the buffer freed.
+ */
+static int pf_ptcp_delay_res_ind(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg)
+{
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   uint64_t                rx_time = os_eth_rx_timestamp(net->eth_handle);
+   const uint8_t           *p_frame = (const uint8_t *)p_buf->payload;
+   const pnet_cfg_t        *p_cfg = NULL;
+   uint16_t                pos = frame_id_pos + sizeof(uint16_t);
+   uint16_t                sequence = 0;
+   uint32_t                delay = 0;
+   uint64_t                round_trip;
+   uint32_t                line_delay;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   if (pf_ptcp_get_header(p_frame, p_buf->len, pos, &sequence, &delay) == 0)
+   {
+      pos = pf_ptcp_find_tlv(p_frame, p_buf->len, pos + PF_PTCP_HEADER_SIZE,
+         PF_PTCP_TLV_DELAY_PARAMETER, PF_PTCP_DELAY_PARAMETER_SIZE);
+      os_mutex_lock(p_ptcp->mutex);
+      if ((pos != 0) &&
+          (memcmp(&p_frame[pos], p_cfg->eth_addr.addr, sizeof(pnet_ethaddr_t)) == 0) &&
+          (p_ptcp->delay_req_sent != 0) &&
+          (p_ptcp->delay_sequence == sequence))
+      {
+         round_trip = rx_time - p_ptcp->delay_req_sent;
+         if ((rx_time > p_ptcp->delay_req_sent) && (round_trip >= delay))
+         {
+            line_delay = (uint32_t)((round_trip - delay) / 2);
+            if (p_ptcp->line_delay_valid == false)
+            {
+               p_ptcp->line_delay = line_delay;
+               p_ptcp->line_delay_valid = true;
+            }
+            else
+            {
+               p_ptcp->line_delay = (uint32_t)((int64_t)p_ptcp->line_delay +
+                  ((int64_t)line_delay - p_ptcp->line_delay) / PF_PTCP_DELAY_FILTER_DIV);
+            }
+         }
+         p_ptcp->delay_req_sent = 0;
+      }
+      os_mutex_unlock(p_ptcp->mutex);
+   }
+
+   os_buf_free(p_buf);
+   return 1;
+}
+
+void pf_ptcp_init(
+   pnet_t                  *net)
+{
+#if PNET_OPTION_PTCP
+   if (net->ptcp.mutex == NULL)
+   {
+      net->ptcp.mutex = os_mutex_create();
+   }
+
+   if (net->ptcp.mutex != NULL)
+   {
+      pf_eth_frame_id_map_add(net, PF_PTCP_FRAME_ID_RTSYNC_FU, pf_ptcp_sync_ind, NULL);
+      pf_eth_frame_id_map_add(net, PF_PTCP_FRAME_ID_RTSYNC, pf_ptcp_sync_ind, NULL);
+      pf_eth_frame_id_map_add(net, PF_PTCP_FRAME_ID_FOLLOW_UP, pf_ptcp_sync_ind, NULL);
+      pf_eth_frame_id_map_add(net, PF_PTCP_FRAME_ID_DELAY_REQ, pf_ptcp_delay_req_ind, NULL);
+      pf_eth_frame_id_map_add(net, PF_PTCP_FRAME_ID_DELAY_RES, pf_ptcp_delay_res_ind, NULL);
+   }
+   else
+   {
+      LOG_ERROR(PNET_LOG, "PTCP(%d): Could not create mutex\n", __LINE__);
+   }
+#endif
+}
+
+void pf_ptcp_exit(
+   pnet_t                  *net)
+{
+   if (net->ptcp.mutex != NULL)
+   {
+      os_mutex_destroy(net->ptcp.mutex);
+      net->ptcp.mutex = NULL;
+   }
+}
+
+int pf_ptcp_get_time(
+   pnet_t                  *net,
+   uint64_t                local_time,
+   uint64_t                *p_sync_time)
+{
+   int                     ret = -1;
+   pf_ptcp_t               *p_ptcp = &net->ptcp;
+   pf_ptcp_clock_t         clock;
+   uint32_t                seq;
+   uint16_t                tries = 0;
+   bool                    consistent = false;
+
+   /* Never locked, as the PPM asks twice every cycle */
+   if (__atomic_load_n(&p_ptcp->state, __ATOMIC_ACQUIRE) == PNET_PTCP_STATE_SYNC)
+   {
+      /* Limited, as the writer may be preempted by this thread */
+      while ((consistent == false) && (tries < PF_PTCP_READ_TRIES))
+      {
+         seq = __atomic_load_n(&p_ptcp->clock_seq, __ATOMIC_ACQUIRE);
+         clock = p_ptcp->clock_copy;
+         __atomic_thread_fence(__ATOMIC_ACQUIRE);
+         consistent = ((seq & 1) == 0) &&
+                      (seq == __atomic_load_n(&p_ptcp->clock_seq, __ATOMIC_RELAXED));
+         tries++;
+      }
+
+      if ((consistent == true) &&
+          ((int64_t)(local_time - clock.last_sync) < PF_PTCP_SYNC_TIMEOUT))
+      {
+         *p_sync_time = (uint64_t)pf_ptcp_clock(&clock, local_time);
+         ret = 0;
+      }
+   }
+
+   return ret;
+}
+
+int pf_ptcp_phase_delay(
+   pnet_t                  *net,
+   uint64_t                current_time,
+   uint32_t                period,
+   uint32_t                phase,
+   uint32_t                *p_delay)
+{
+   int                     ret = -1;
+   uint64_t                sync_time = 0;
+   uint64_t                period_ns = (uint64_t)period * 1000;
+   uint64_t                phase_ns = ((uint64_t)phase * 1000) % period_ns;
+   uint64_t                to_go;
+
+   if (pf_ptcp_get_time(net, current_time, &sync_time) == 0)
+   {
+      to_go = period_ns - ((sync_time + period_ns - phase_ns) % period_ns);
+      if (to_go < period_ns / 2)
+      {
+         to_go += period_ns;
+      }
+
+      /* The rate differs by less than PF_PTCP_MAX_RATE, so master and local time are the same here */
+      *p_delay = (uint32_t)((to_go + 500) / 1000);
+      ret = 0;
+   }
+
+   return ret;
+}
+
+int pf_ptcp_get_status(
+   pnet_t                  *net,
+   pnet_ptcp_status_t      *p_status)
+{
+   int                     ret = -1;
 
+   memset(p_status, 0, sizeof(*p_status));
+   if (net->ptcp.mutex != NULL)
+   {
+      os_mutex_lock(net->ptcp.mutex);
+      p_status->state = net->ptcp.state;
+      p_status->master_addr = net->ptcp.master_addr;
+      p_status->offset = (int32_t)net->ptcp.offset;
+      p_status->rate = (int32_t)net->ptcp.clock.rate;
+      p_status->line_delay = net->ptcp.line_delay;
+      p_status->sync_count = net->ptcp.sync_count;
+      p_status->step_count = net->ptcp.step_count;
+      os_mutex_unlock(net->ptcp.mutex);
+      ret = 0;
+   }
 
+   return ret;
+}
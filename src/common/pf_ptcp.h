@@ -13,6 +13,41 @@
  * full license information.
  ********************************************************************/
 
+/**
+ * @file
+ * @brief PTCP sync slave.
+ *
+ * The Precision Transparent Clock Protocol synchronizes the time of the
+ * devices to a sync master, normally the IO-controller. This is a slave
+ * for the clock synchronization (SyncID 0). It follows the first master it
+ * hears, and keeps a local clock that the PPM and CPM use to align their
+ * cycles with the controller.
+ *
+ * All PTCP frames start with a header after the frame ID:
+ *
+ *    Reserved (4) Reserved (4) Delay10ns (4) SequenceID (2)
+ *    Delay1ns_Byte (1) Padding (1) Delay1ns (4)
+ *
+ * followed by TLVs, each with a 16 bit header holding the type (7 bits) and
+ * the length (9 bits), ended by an End TLV (type 0). The delay fields,
+ * in 10 ns and 1 ns units, are added together.
+ *
+ * A sync frame (RTSync) holds a Subdomain TLV with the MAC address of the
+ * master and a Time TLV with its send time. With a follow up, the RTSync
+ * frame has no Time TLV and the FollowUp frame with the same SequenceID
+ * carries it. The delay fields hold the delay accumulated on the way, and
+ * the line delay to the neighbour is added to it.
+ *
+ * The line delay is measured with DelayReq and DelayRes frames. The delay
+ * fields of DelayRes hold the time the responder took to answer. The stack
+ * answers the DelayReq frames of its neighbours.
+ *
+ * The local clock is adjusted by a PI servo on the offset at each sync
+ * frame. Receive timestamps are taken by the network interface if it can,
+ * see os_eth_rx_timestamp(). Send times are read just before the frame is
+ * handed to the driver.
+ */
+
 #ifndef PF_PTCP_H
 #define PF_PTCP_H
 
@@ -21,7 +56,92 @@ extern "C"
 {
 #endif
 
+#define PF_PTCP_FRAME_ID_RTSYNC_FU     0x0020   /* Time in a follow up */
+#define PF_PTCP_FRAME_ID_RTSYNC        0x0080
+#define PF_PTCP_FRAME_ID_FOLLOW_UP     0xff20
+#define PF_PTCP_FRAME_ID_DELAY_REQ     0xff40
+#define PF_PTCP_FRAME_ID_DELAY_RES     0xff43
+
+#define PF_PTCP_HEADER_SIZE            20
+#define PF_PTCP_TLV_HEADER_SIZE        2
+
+#define PF_PTCP_TLV_END                0x00
+#define PF_PTCP_TLV_SUBDOMAIN          0x01     /* MasterSourceAddress (6), SubdomainUUID (16) */
+#define PF_PTCP_TLV_TIME               0x02     /* EpochNumber (2), Seconds (4), NanoSeconds (4) */
+#define PF_PTCP_TLV_DELAY_PARAMETER    0x06     /* RequestSourceAddress (6) */
+
+#define PF_PTCP_SUBDOMAIN_SIZE         22
+#define PF_PTCP_TIME_SIZE              10
+#define PF_PTCP_DELAY_PARAMETER_SIZE   6
 
+/**
+ * Register the PTCP frame handlers.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_ptcp_init(
+   pnet_t                  *net);
+
+/**
+ * Free the resources of the sync slave. No frame may be received and no
+ * timeout may run after this.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_ptcp_exit(
+   pnet_t                  *net);
+
+/**
+ * Get the synchronized time.
+ *
+ * Does not take the mutex, so it may be called every cycle. Reads a copy
+ * of the clock that is updated once per sync frame.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param local_time       In:   Time on the clock of os_get_current_time_ns().
+ * @param p_sync_time      Out:  The time of the master at local_time, in
+ *                               nanoseconds since the PTCP epoch.
+ * @return  0  if synchronized.
+ *          -1 if not, or if the clock was updated during every try.
+ */
+int pf_ptcp_get_time(
+   pnet_t                  *net,
+   uint64_t                local_time,
+   uint64_t                *p_sync_time);
+
+/**
+ * Calculate the delay to the next cycle of the master.
+ *
+ * The cycles of the master start when its time is a multiple of the period.
+ * The returned delay is to the next time that is phase after the start of
+ * a cycle, and at least half a period away.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param current_time     In:   The current time, in nanoseconds.
+ * @param period           In:   The cycle time in microseconds. Must be larger than 0.
+ * @param phase            In:   Phase in microseconds.
+ * @param p_delay          Out:  The delay in microseconds.
+ * @return  0  if synchronized.
+ *          -1 if not, and *p_delay is not changed.
+ */
+int pf_ptcp_phase_delay(
+   pnet_t                  *net,
+   uint64_t                current_time,
+   uint32_t                period,
+   uint32_t                phase,
+   uint32_t                *p_delay);
+
+/**
+ * Read the status of the sync slave.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_status         Out:  The status.
+ * @return  0  if the operation succeeded.
+ *          -1 if PTCP is not supported.
+ */
+int pf_ptcp_get_status(
+   pnet_t                  *net,
+   pnet_ptcp_status_t      *p_status);
 
 #ifdef __cplusplus
 }
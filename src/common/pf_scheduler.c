@@ -20,29 +20,63 @@
 #include <string.h>
 #include "pf_includes.h"
 
-
-static bool pf_scheduler_is_linked(
+const uint32_t pf_scheduler_lateness_bounds[PF_SCHEDULER_LATENESS_BUCKETS - 1] =
+{
+   50, 100, 250, 500, 1000, 2000, 5000, 10000
+};
+
+/**
+ * @internal
+ * Add a call-back to the lateness histogram.
+ * @param net              InOut: The p-net stack instance
+ * @param lateness         In:    Time since the call-back was due, in microseconds.
+ */
+static void pf_scheduler_count_lateness(
    pnet_t                  *net,
-   uint32_t                first,
-   uint32_t                ix)
+   uint32_t                lateness)
 {
-   bool                    ret = false;
-   uint32_t                cnt = 0;
+   uint16_t                ix = 0;
 
-   if (ix < PF_MAX_TIMEOUTS)
+   while ((ix < NELEMENTS(pf_scheduler_lateness_bounds)) &&
+          (lateness > pf_scheduler_lateness_bounds[ix]))
    {
-      while ((first < PF_MAX_TIMEOUTS) && (cnt < 20))
-      {
-         if (first == ix)
-         {
-            ret = true;
-         }
-         first = net->scheduler_timeouts[first].next;
-         cnt++;
-      }
+      ix++;
    }
+   net->scheduler_lateness[ix]++;
+   net->scheduler_lateness_sum += lateness;
+}
 
-   return ret;
+/**
+ * @internal
+ * Get the number of microseconds from now until a timeout is due.
+ *
+ * Rounded up, so that a timer armed with the result does not expire before
+ * the timeout is due.
+ * @param when             In:    When the timeout is due, in nanoseconds.
+ * @param now              In:    The current time, in nanoseconds.
+ * @return Microseconds until due, or 0 if already due.
+ */
+static uint32_t pf_scheduler_delay_us(
+   uint64_t                when,
+   uint64_t                now)
+{
+   uint64_t                delay = 0;
+
+   if (when > now)
+   {
+      delay = (when - now + 999) / 1000;
+   }
+
+   return (delay > UINT32_MAX) ? UINT32_MAX : (uint32_t)delay;
+}
+
+static bool pf_scheduler_is_linked(
+   pnet_t                  *net,
+   volatile uint32_t       *p_q,
+   uint32_t                ix)
+{
+   return (ix < net->scheduler_max_timeouts) &&
+          (net->scheduler_timeouts[ix].p_q == p_q);
 }
 
 static void pf_scheduler_unlink(
@@ -54,11 +88,11 @@ static void pf_scheduler_unlink(
    uint32_t                prev_ix;
    uint32_t                next_ix;
 
-   if (ix >= PF_MAX_TIMEOUTS)
+   if (ix >= net->scheduler_max_timeouts)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
-   else if (pf_scheduler_is_linked(net, *p_q, ix) == false)
+   else if (pf_scheduler_is_linked(net, p_q, ix) == false)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is not in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
@@ -66,21 +100,46 @@ static void pf_scheduler_unlink(
    {
       prev_ix = net->scheduler_timeouts[ix].prev;
       next_ix = net->scheduler_timeouts[ix].next;
+      net->scheduler_timeouts[ix].p_q = NULL;
       if (*p_q == ix)
       {
          *p_q = next_ix;
       }
-      if (next_ix < PF_MAX_TIMEOUTS)
+      if ((p_q == &net->scheduler_timeout_first) && (net->scheduler_timeout_last == ix))
+      {
+         net->scheduler_timeout_last = prev_ix;
+      }
+      if (next_ix < net->scheduler_max_timeouts)
       {
          net->scheduler_timeouts[next_ix].prev = prev_ix;
       }
-      if (prev_ix < PF_MAX_TIMEOUTS)
+      if (prev_ix < net->scheduler_max_timeouts)
       {
          net->scheduler_timeouts[prev_ix].next = next_ix;
       }
    }
 }
 
+/**
+ * @internal
+ * Record that an entry has been linked into a list.
+ * @param net              InOut: The p-net stack instance
+ * @param p_q              In:    The list.
+ * @param ix               In:    The entry.
+ */
+static void pf_scheduler_set_linked(
+   pnet_t                  *net,
+   volatile uint32_t       *p_q,
+   uint32_t                ix)
+{
+   net->scheduler_timeouts[ix].p_q = p_q;
+   if ((p_q == &net->scheduler_timeout_first) &&
+       (net->scheduler_timeouts[ix].next >= net->scheduler_max_timeouts))
+   {
+      net->scheduler_timeout_last = ix;
+   }
+}
+
 static void pf_scheduler_link_after(
    pnet_t                  *net,
    volatile uint32_t       *p_q,
@@ -89,46 +148,51 @@ static void pf_scheduler_link_after(
 {
    uint32_t                next_ix;
 
-   if (ix >= PF_MAX_TIMEOUTS)
+   if (ix >= net->scheduler_max_timeouts)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
-   else if (pf_scheduler_is_linked(net, *p_q, ix) == true)
+   else if (net->scheduler_timeouts[ix].p_q != NULL)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is already in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
-   else if (pos >= PF_MAX_TIMEOUTS)
+   else
    {
-      /* Put first in possible non-empty Q */
-      net->scheduler_timeouts[ix].prev = PF_MAX_TIMEOUTS;
-      net->scheduler_timeouts[ix].next = *p_q;
-      if (*p_q < PF_MAX_TIMEOUTS)
+      if (pos >= net->scheduler_max_timeouts)
       {
-         net->scheduler_timeouts[*p_q].prev = ix;
+         /* Put first in possible non-empty Q */
+         net->scheduler_timeouts[ix].prev = net->scheduler_max_timeouts;
+         net->scheduler_timeouts[ix].next = *p_q;
+         if (*p_q < net->scheduler_max_timeouts)
+         {
+            net->scheduler_timeouts[*p_q].prev = ix;
+         }
+
+         *p_q = ix;
       }
+      else if (*p_q >= net->scheduler_max_timeouts)
+      {
+         /* Q is empty - insert first in Q */
+         net->scheduler_timeouts[ix].prev = net->scheduler_max_timeouts;
+         net->scheduler_timeouts[ix].next = net->scheduler_max_timeouts;
 
-      *p_q = ix;
-   }
-   else if (*p_q >= PF_MAX_TIMEOUTS)
-   {
-      /* Q is empty - insert first in Q */
-      net->scheduler_timeouts[ix].prev = PF_MAX_TIMEOUTS;
-      net->scheduler_timeouts[ix].next = PF_MAX_TIMEOUTS;
+         *p_q = ix;
+      }
+      else
+      {
+         next_ix = net->scheduler_timeouts[pos].next;
 
-      *p_q = ix;
-   }
-   else
-   {
-      next_ix = net->scheduler_timeouts[pos].next;
+         if (next_ix < net->scheduler_max_timeouts)
+         {
+            net->scheduler_timeouts[next_ix].prev = ix;
+         }
+         net->scheduler_timeouts[pos].next = ix;
 
-      if (next_ix < PF_MAX_TIMEOUTS)
-      {
-         net->scheduler_timeouts[next_ix].prev = ix;
+         net->scheduler_timeouts[ix].prev = pos;
+         net->scheduler_timeouts[ix].next = next_ix;
       }
-      net->scheduler_timeouts[pos].next = ix;
 
-      net->scheduler_timeouts[ix].prev = pos;
-      net->scheduler_timeouts[ix].next = next_ix;
+      pf_scheduler_set_linked(net, p_q, ix);
    }
 }
 
@@ -140,79 +204,111 @@ static void pf_scheduler_link_before(
 {
    uint32_t                prev_ix;
 
-   if (ix >= PF_MAX_TIMEOUTS)
+   if (ix >= net->scheduler_max_timeouts)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): ix (%u) is invalid\n", __LINE__, (unsigned)ix);
    }
-   else if (pf_scheduler_is_linked(net, *p_q, ix) == true)
+   else if (net->scheduler_timeouts[ix].p_q != NULL)
    {
       LOG_ERROR(PNET_LOG, "Sched(%d): %s is already in Q\n", __LINE__, net->scheduler_timeouts[ix].p_name);
    }
-   else if (pos >= PF_MAX_TIMEOUTS)
-   {
-      /* Put first in possible non-empty Q */
-      net->scheduler_timeouts[ix].prev = PF_MAX_TIMEOUTS;
-      net->scheduler_timeouts[ix].next = *p_q;
-      if (*p_q < PF_MAX_TIMEOUTS)
-      {
-         net->scheduler_timeouts[*p_q].prev = ix;
-      }
-
-      *p_q = ix;
-   }
-   else if (*p_q >= PF_MAX_TIMEOUTS)
-   {
-      /* Q is empty - insert first in Q */
-      net->scheduler_timeouts[ix].prev = PF_MAX_TIMEOUTS;
-      net->scheduler_timeouts[ix].next = PF_MAX_TIMEOUTS;
-
-      *p_q = ix;
-   }
    else
    {
-      prev_ix = net->scheduler_timeouts[pos].prev;
+      if (pos >= net->scheduler_max_timeouts)
+      {
+         /* Put first in possible non-empty Q */
+         net->scheduler_timeouts[ix].prev = net->scheduler_max_timeouts;
+         net->scheduler_timeouts[ix].next = *p_q;
+         if (*p_q < net->scheduler_max_timeouts)
+         {
+            net->scheduler_timeouts[*p_q].prev = ix;
+         }
 
-      if (prev_ix < PF_MAX_TIMEOUTS)
+         *p_q = ix;
+      }
+      else if (*p_q >= net->scheduler_max_timeouts)
       {
-         net->scheduler_timeouts[prev_ix].next = ix;
+         /* Q is empty - insert first in Q */
+         net->scheduler_timeouts[ix].prev = net->scheduler_max_timeouts;
+         net->scheduler_timeouts[ix].next = net->scheduler_max_timeouts;
+
+         *p_q = ix;
       }
-      net->scheduler_timeouts[pos].prev = ix;
+      else
+      {
+         prev_ix = net->scheduler_timeouts[pos].prev;
 
-      net->scheduler_timeouts[ix].next = pos;
-      net->scheduler_timeouts[ix].prev = prev_ix;
+         if (prev_ix < net->scheduler_max_timeouts)
+         {
+            net->scheduler_timeouts[prev_ix].next = ix;
+         }
+         net->scheduler_timeouts[pos].prev = ix;
 
-      if (*p_q == pos)
-      {
-         /* ix is now first in the Q */
-         *p_q = ix;
+         net->scheduler_timeouts[ix].next = pos;
+         net->scheduler_timeouts[ix].prev = prev_ix;
+
+         if (*p_q == pos)
+         {
+            /* ix is now first in the Q */
+            *p_q = ix;
+         }
       }
+
+      pf_scheduler_set_linked(net, p_q, ix);
    }
 }
 
-void pf_scheduler_init(
+int pf_scheduler_init(
    pnet_t                  *net,
    uint32_t                tick_interval)
 {
    uint32_t ix;
 
-   net->scheduler_timeout_first = PF_MAX_TIMEOUTS; /* Nothing in queue */
-   net->scheduler_timeout_free = PF_MAX_TIMEOUTS;  /* Nothing in queue. */
+   if (net->scheduler_timeouts == NULL)
+   {
+      net->scheduler_max_timeouts = PF_MAX_TIMEOUTS(net->max_ar);
+      net->scheduler_timeouts = os_malloc(net->scheduler_max_timeouts * sizeof(net->scheduler_timeouts[0]));
+      if (net->scheduler_timeouts == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Could not allocate %u timeouts\n", __LINE__, (unsigned)net->scheduler_max_timeouts);
+         return -1;
+      }
+   }
+
+   net->scheduler_timeout_first = net->scheduler_max_timeouts; /* Nothing in queue */
+   net->scheduler_timeout_last = net->scheduler_max_timeouts;
+   net->scheduler_timeout_free = net->scheduler_max_timeouts;  /* Nothing in queue. */
 
    if (net->scheduler_timeout_mutex == NULL)
    {
       net->scheduler_timeout_mutex = os_mutex_create();
    }
-   memset((void *)net->scheduler_timeouts, 0, sizeof(net->scheduler_timeouts));
+   memset((void *)net->scheduler_timeouts, 0, net->scheduler_max_timeouts * sizeof(net->scheduler_timeouts[0]));
 
    net->scheduler_tick_interval = tick_interval;  /* Cannot be zero */
 
    /* Link all entries into a list and put them into the free queue. */
-   for (ix = PF_MAX_TIMEOUTS; ix > 0; ix--)
+   for (ix = net->scheduler_max_timeouts; ix > 0; ix--)
    {
       net->scheduler_timeouts[ix - 1].p_name = "<free>";
       net->scheduler_timeouts[ix - 1].in_use = false;
       pf_scheduler_link_before(net, &net->scheduler_timeout_free, ix - 1, net->scheduler_timeout_free);
    }
+
+   return 0;
+}
+
+void pf_scheduler_exit(
+   pnet_t                  *net)
+{
+   if (net->scheduler_timeout_mutex != NULL)
+   {
+      os_mutex_destroy(net->scheduler_timeout_mutex);
+      net->scheduler_timeout_mutex = NULL;
+   }
+   os_free((void *)net->scheduler_timeouts);
+   net->scheduler_timeouts = NULL;
+   net->scheduler_max_timeouts = 0;
 }
 
 int pf_scheduler_add(
@@ -223,10 +319,10 @@ int pf_scheduler_add(
    void                    *arg,
    uint32_t                *p_timeout)
 {
-   uint32_t                ix_this;
    uint32_t                ix_prev;
    uint32_t                ix_free;
-   uint32_t                now = os_get_current_time_us();
+   uint64_t                now = os_get_current_time_ns();
+   os_poll_t               *p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
 
    if (delay > 0x80000000)  /* Make sure it is reasonable */
    {
@@ -240,7 +336,7 @@ int pf_scheduler_add(
    pf_scheduler_unlink(net, &net->scheduler_timeout_free, ix_free);
    os_mutex_unlock(net->scheduler_timeout_mutex);
 
-   if (ix_free >= PF_MAX_TIMEOUTS)
+   if (ix_free >= net->scheduler_max_timeouts)
    {
       LOG_ERROR(PNET_LOG, "SCHEDULER(%d): Out of timeout resources!!\n", __LINE__);
       return -1;
@@ -250,34 +346,46 @@ int pf_scheduler_add(
    net->scheduler_timeouts[ix_free].p_name = p_name;
    net->scheduler_timeouts[ix_free].cb = cb;
    net->scheduler_timeouts[ix_free].arg = arg;
-   net->scheduler_timeouts[ix_free].when = now + delay;
+   net->scheduler_timeouts[ix_free].when = now + (uint64_t)delay * 1000;
 
    os_mutex_lock(net->scheduler_timeout_mutex);
-   if (net->scheduler_timeout_first >= PF_MAX_TIMEOUTS)
+   if (net->scheduler_timeout_first >= net->scheduler_max_timeouts)
    {
       /* Put into empty q */
-      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix_free, PF_MAX_TIMEOUTS);
+      pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix_free, net->scheduler_max_timeouts);
    }
-   else if (((int32_t)(net->scheduler_timeouts[ix_free].when - net->scheduler_timeouts[net->scheduler_timeout_first].when)) <= 0)
+   else if (net->scheduler_timeouts[ix_free].when < net->scheduler_timeouts[net->scheduler_timeout_first].when)
    {
       /* Put first in non-empty q */
       pf_scheduler_link_before(net, &net->scheduler_timeout_first, ix_free, net->scheduler_timeout_first);
    }
    else
    {
-      /* Find pos in non-empty q */
-      ix_prev = net->scheduler_timeout_first;
-      ix_this = net->scheduler_timeouts[net->scheduler_timeout_first].next;
-      while ((ix_this < PF_MAX_TIMEOUTS) &&
-             (((int32_t)(net->scheduler_timeouts[ix_free].when - net->scheduler_timeouts[ix_this].when)) > 0))
+      /*
+       * Find pos in non-empty q, from the end. A periodic timeout is usually
+       * due after the others, so this is short also with many ARs.
+       * Stops at the first entry at the latest.
+       */
+      ix_prev = net->scheduler_timeout_last;
+      while ((ix_prev < net->scheduler_max_timeouts) &&
+             (net->scheduler_timeouts[ix_free].when < net->scheduler_timeouts[ix_prev].when))
       {
-         ix_prev = ix_this;
-         ix_this = net->scheduler_timeouts[ix_this].next;
+         ix_prev = net->scheduler_timeouts[ix_prev].prev;
       }
 
       /* Put after ix_prev */
       pf_scheduler_link_after(net, &net->scheduler_timeout_first, ix_free, ix_prev);
    }
+
+   if ((p_poll != NULL) &&
+       ((net->scheduler_poll_armed == false) ||
+        (net->scheduler_timeouts[ix_free].when < net->scheduler_poll_when)))
+   {
+      /* Due before the event loop would wake up, see pnet_get_fd() */
+      os_poll_arm(p_poll, delay);
+      net->scheduler_poll_armed = true;
+      net->scheduler_poll_when = net->scheduler_timeouts[ix_free].when;
+   }
    os_mutex_unlock(net->scheduler_timeout_mutex);
 
    *p_timeout = ix_free + 1;  /* Make sure 0 is invalid. */
@@ -324,14 +432,15 @@ void pf_scheduler_tick(
    uint32_t                ix;
    pf_scheduler_timeout_ftn_t ftn;
    void                    *arg;
-   uint32_t                pf_current_time = os_get_current_time_us();
+   uint64_t                pf_current_time = os_get_current_time_ns();
+   uint32_t                lateness;
    uint32_t                cnt = 0x10000000;
 
    os_mutex_lock(net->scheduler_timeout_mutex);
 
    /* Send event to all expired delay entries. */
-   while ((net->scheduler_timeout_first < PF_MAX_TIMEOUTS) &&
-          ((int32_t)(pf_current_time - net->scheduler_timeouts[net->scheduler_timeout_first].when) >= 0))
+   while ((net->scheduler_timeout_first < net->scheduler_max_timeouts) &&
+          (pf_current_time >= net->scheduler_timeouts[net->scheduler_timeout_first].when))
    {
       /* Unlink from busy list */
       ix = net->scheduler_timeout_first;
@@ -339,6 +448,9 @@ void pf_scheduler_tick(
 
       ftn = net->scheduler_timeouts[ix].cb;
       arg = net->scheduler_timeouts[ix].arg;
+      lateness = (uint32_t)((pf_current_time - net->scheduler_timeouts[ix].when) / 1000);
+      pf_scheduler_count_lateness(net, lateness);
+      PF_TRACE2(sched_dispatch, net->scheduler_timeouts[ix].p_name, lateness);
 
       /* Insert into free list. */
       net->scheduler_timeouts[ix].in_use = false;
@@ -355,13 +467,55 @@ void pf_scheduler_tick(
    os_mutex_unlock(net->scheduler_timeout_mutex);
 }
 
+int pf_scheduler_next_delay(
+   pnet_t                  *net,
+   uint32_t                *p_delay)
+{
+   int                     ret = -1;
+   uint64_t                now = os_get_current_time_ns();
+
+   os_mutex_lock(net->scheduler_timeout_mutex);
+   if (net->scheduler_timeout_first < net->scheduler_max_timeouts)
+   {
+      *p_delay = pf_scheduler_delay_us(net->scheduler_timeouts[net->scheduler_timeout_first].when, now);
+      ret = 0;
+   }
+   os_mutex_unlock(net->scheduler_timeout_mutex);
+
+   return ret;
+}
+
+void pf_scheduler_arm_poll(
+   pnet_t                  *net)
+{
+   uint64_t                now = os_get_current_time_ns();
+   os_poll_t               *p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+
+   if (p_poll != NULL)
+   {
+      os_mutex_lock(net->scheduler_timeout_mutex);
+      if (net->scheduler_timeout_first < net->scheduler_max_timeouts)
+      {
+         net->scheduler_poll_when = net->scheduler_timeouts[net->scheduler_timeout_first].when;
+         os_poll_arm(p_poll, pf_scheduler_delay_us(net->scheduler_poll_when, now));
+         net->scheduler_poll_armed = true;
+      }
+      else
+      {
+         os_poll_disarm(p_poll);
+         net->scheduler_poll_armed = false;
+      }
+      os_mutex_unlock(net->scheduler_timeout_mutex);
+   }
+}
+
 void pf_scheduler_show(
    pnet_t                  *net)
 {
    uint32_t                ix;
    uint32_t                cnt;
 
-   printf("Scheduler (time now=%u):\n", (unsigned)os_get_current_time_us());
+   printf("Scheduler (time now=%llu ns):\n", (unsigned long long)os_get_current_time_ns());
 
    if (net->scheduler_timeout_mutex != NULL)
    {
@@ -369,12 +523,12 @@ void pf_scheduler_show(
    }
 
    printf("%-4s  %-8s  %-6s  %-6s  %-6s  %s\n", "idx", "owner", "in_use", "next", "prev", "when");
-   for (ix = 0; ix < PF_MAX_TIMEOUTS; ix++)
+   for (ix = 0; ix < net->scheduler_max_timeouts; ix++)
    {
-      printf("[%02u]  %-8s  %-6s  %-6u  %-6u  %u\n", (unsigned)ix,
+      printf("[%02u]  %-8s  %-6s  %-6u  %-6u  %llu\n", (unsigned)ix,
          net->scheduler_timeouts[ix].p_name, net->scheduler_timeouts[ix].in_use?"true":"false",
          (unsigned)net->scheduler_timeouts[ix].next, (unsigned)net->scheduler_timeouts[ix].prev,
-         (unsigned)net->scheduler_timeouts[ix].when);
+         (unsigned long long)net->scheduler_timeouts[ix].when);
    }
 
    if (net->scheduler_timeout_mutex != NULL)
@@ -382,7 +536,7 @@ void pf_scheduler_show(
       printf("Free list:\n");
       ix = net->scheduler_timeout_free;
       cnt = 0;
-      while ((ix < PF_MAX_TIMEOUTS) && (cnt++ < 20))
+      while ((ix < net->scheduler_max_timeouts) && (cnt++ < 20))
       {
          printf("%u  ", (unsigned)ix);
          ix = net->scheduler_timeouts[ix].next;
@@ -391,9 +545,9 @@ void pf_scheduler_show(
       printf("\nBusy list:\n");
       ix = net->scheduler_timeout_first;
       cnt = 0;
-      while ((ix < PF_MAX_TIMEOUTS) && (cnt++ < 20))
+      while ((ix < net->scheduler_max_timeouts) && (cnt++ < 20))
       {
-         printf("%u  (%u)  ", (unsigned)ix, (unsigned)net->scheduler_timeouts[ix].when);
+         printf("%u  (%llu)  ", (unsigned)ix, (unsigned long long)net->scheduler_timeouts[ix].when);
          ix = net->scheduler_timeouts[ix].next;
       }
 
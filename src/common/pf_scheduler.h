@@ -21,16 +21,33 @@ extern "C"
 {
 #endif
 
+/**
+ * Upper bounds of the scheduler lateness histogram buckets, in microseconds.
+ * The last bucket, net->scheduler_lateness[PF_SCHEDULER_LATENESS_BUCKETS - 1],
+ * counts all later call-backs.
+ */
+extern const uint32_t pf_scheduler_lateness_bounds[PF_SCHEDULER_LATENESS_BUCKETS - 1];
 
 /**
  * Initialize the scheduler.
+ *
+ * The timeouts are allocated for net->max_ar ARs the first time.
  * @param net              InOut: The p-net stack instance
  * @param tick_interval    In:    System calls the tick function at these intervals, in microseconds.
+ * @return  0  if the scheduler was initialized.
+ *          -1 if the timeouts could not be allocated.
  */
-void pf_scheduler_init(
+int pf_scheduler_init(
    pnet_t                     *net,
    uint32_t                   tick_interval);
 
+/**
+ * Free the timeouts. Pending call-backs are not called.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_scheduler_exit(
+   pnet_t                     *net);
+
 /**
  * Schedule a call-back at a specific time.
  *
@@ -70,6 +87,26 @@ void pf_scheduler_remove(
 void pf_scheduler_tick(
    pnet_t                  *net);
 
+/**
+ * Get the time until the next call-back is due.
+ * @param net              InOut: The p-net stack instance
+ * @param p_delay          Out:   The delay in microseconds, rounded up. 0 if it is already due.
+ * @return  0  if a call-back is scheduled.
+ *          -1 if none is scheduled.
+ */
+int pf_scheduler_next_delay(
+   pnet_t                  *net,
+   uint32_t                *p_delay);
+
+/**
+ * Set the timeout of net->poll to when the next call-back is due, or cancel
+ * it if none is scheduled. Call-backs added later that are due earlier
+ * re-arm the timeout themselves.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_scheduler_arm_poll(
+   pnet_t                  *net);
+
 /**
  * Show scheduler (busy and free) instances.
  * @param net              InOut: The p-net stack instance
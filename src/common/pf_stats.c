@@ -0,0 +1,106 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+void pf_stats_in(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc,
+   uint32_t                len)
+{
+   pnet_traffic_stats_t    *p_cnt = &net->stats[ctx].traffic[tc];
+
+   p_cnt->in_packets++;
+   p_cnt->in_octets += len;
+}
+
+void pf_stats_in_discard(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc)
+{
+   net->stats[ctx].traffic[tc].in_discards++;
+}
+
+void pf_stats_out(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc,
+   uint32_t                len)
+{
+   pnet_traffic_stats_t    *p_cnt = &net->stats[ctx].traffic[tc];
+
+   p_cnt->out_packets++;
+   p_cnt->out_octets += len;
+}
+
+void pf_stats_out_discard(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc)
+{
+   net->stats[ctx].traffic[tc].out_discards++;
+}
+
+void pf_stats_out_error(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc)
+{
+   net->stats[ctx].traffic[tc].out_errors++;
+}
+
+void pf_stats_get(
+   pnet_t                  *net,
+   pnet_interface_stats_t  *p_stats)
+{
+   uint16_t                ctx;
+   uint16_t                tc;
+   pnet_traffic_stats_t    *p_src;
+   pnet_traffic_stats_t    *p_dst;
+
+   memset(p_stats, 0, sizeof(*p_stats));
+
+   for (ctx = 0; ctx < PF_STATS_CTX_MAX; ctx++)
+   {
+      for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+      {
+         /* The owning thread may be writing. Read each counter once. */
+         p_src = &net->stats[ctx].traffic[tc];
+         p_dst = &p_stats->traffic[tc];
+         p_dst->in_packets += CC_ATOMIC_GET32(&p_src->in_packets);
+         p_dst->in_octets += CC_ATOMIC_GET32(&p_src->in_octets);
+         p_dst->in_discards += CC_ATOMIC_GET32(&p_src->in_discards);
+         p_dst->in_errors += CC_ATOMIC_GET32(&p_src->in_errors);
+         p_dst->out_packets += CC_ATOMIC_GET32(&p_src->out_packets);
+         p_dst->out_octets += CC_ATOMIC_GET32(&p_src->out_octets);
+         p_dst->out_discards += CC_ATOMIC_GET32(&p_src->out_discards);
+         p_dst->out_errors += CC_ATOMIC_GET32(&p_src->out_errors);
+      }
+   }
+
+   for (tc = 0; tc < PNET_TRAFFIC_CLASS_MAX; tc++)
+   {
+      p_dst = &p_stats->traffic[tc];
+      p_stats->ifInOctets += p_dst->in_octets;
+      p_stats->ifOutOctets += p_dst->out_octets;
+      p_stats->ifInDiscards += p_dst->in_discards;
+      p_stats->ifOutDiscards += p_dst->out_discards;
+      p_stats->ifInErrors += p_dst->in_errors;
+      p_stats->ifOutErrors += p_dst->out_errors;
+   }
+}
@@ -0,0 +1,118 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Interface and protocol counters.
+ *
+ * Each thread that sends or receives counts in its own slot of the pnet
+ * struct, so the counters are updated without locks or atomic operations
+ * and without bouncing cache lines between threads. A reader sums all
+ * slots.
+ *
+ * Exactly one thread may write a slot. Functions that are called from more
+ * than one thread take the slot as a parameter from their caller. The counters are 32 bits, so a reader never sees a torn value.
+ */
+
+#ifndef PF_STATS_H
+#define PF_STATS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Count a received frame.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread.
+ * @param tc               In:   The traffic class.
+ * @param len              In:   The frame length, in octets.
+ */
+void pf_stats_in(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc,
+   uint32_t                len);
+
+/**
+ * Count a received frame that was dropped.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread.
+ * @param tc               In:   The traffic class.
+ */
+void pf_stats_in_discard(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc);
+
+/**
+ * Count a sent frame.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread.
+ * @param tc               In:   The traffic class.
+ * @param len              In:   The frame length, in octets.
+ */
+void pf_stats_out(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc,
+   uint32_t                len);
+
+/**
+ * Count a frame that was not sent, because there was nothing to send or
+ * no socket to send it on.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread.
+ * @param tc               In:   The traffic class.
+ */
+void pf_stats_out_discard(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc);
+
+/**
+ * Count a frame that could not be sent.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ctx              In:   The calling thread.
+ * @param tc               In:   The traffic class.
+ */
+void pf_stats_out_error(
+   pnet_t                  *net,
+   pf_stats_ctx_t          ctx,
+   pnet_traffic_class_t    tc);
+
+/**
+ * Sum the counters of all threads.
+ *
+ * May be called from any thread.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_stats          Out:  The statistics.
+ */
+void pf_stats_get(
+   pnet_t                  *net,
+   pnet_interface_stats_t  *p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_STATS_H */
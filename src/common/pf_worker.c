@@ -0,0 +1,181 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+#define PF_WORKER_EVENT_DONE              BIT(0)
+
+#define PF_WORKER_THREAD_PRIO             5        /* Below the receive thread */
+#define PF_WORKER_THREAD_STACKSIZE        4096
+
+/**
+ * @internal
+ * The worker thread.
+ *
+ * Runs the queued jobs until it fetches a NULL job.
+ *
+ * This is a function to be passed into os_thread_create()
+ *
+ * @param arg              InOut: The p-net stack instance
+ */
+static void pf_worker_thread(
+   void                    *arg)
+{
+   pnet_t                  *net = (pnet_t *)arg;
+   pf_worker_job_t         *p_job = NULL;
+   bool                    running = true;
+
+   while (running == true)
+   {
+      if (os_mbox_fetch(net->worker_q, (void **)&p_job, OS_WAIT_FOREVER) == 0)
+      {
+         if (p_job == NULL)
+         {
+            running = false;
+         }
+         else
+         {
+            p_job->ftn(net, p_job->arg);
+            (void)os_mbox_post(net->worker_free, p_job, 0);
+         }
+      }
+   }
+
+   os_event_set(net->worker_events, PF_WORKER_EVENT_DONE);
+}
+
+int pf_worker_init(
+   pnet_t                  *net)
+{
+   uint16_t                ix;
+   os_thread_cfg_t         thread_cfg;
+
+   if (net->worker_mutex == NULL)
+   {
+      net->worker_mutex = os_mutex_create();
+   }
+
+   if (net->worker_events == NULL)
+   {
+      net->worker_events = os_event_create();
+   }
+
+   if ((net->worker_q == NULL) && (net->worker_free == NULL))
+   {
+      /* Room for all jobs and the NULL job of pf_worker_exit() */
+      net->worker_q = os_mbox_create(PF_WORKER_JOBS + 1);
+      net->worker_free = os_mbox_create(PF_WORKER_JOBS);
+      if (net->worker_free != NULL)
+      {
+         for (ix = 0; ix < NELEMENTS(net->worker_jobs); ix++)
+         {
+            (void)os_mbox_post(net->worker_free, &net->worker_jobs[ix], 0);
+         }
+      }
+   }
+
+   if ((net->worker_thread == NULL) &&
+       (net->worker_mutex != NULL) &&
+       (net->worker_events != NULL) &&
+       (net->worker_q != NULL) &&
+       (net->worker_free != NULL))
+   {
+      pf_fspm_get_thread_cfg(net, PNET_THREAD_CONTROL,
+         PF_WORKER_THREAD_PRIO, PF_WORKER_THREAD_STACKSIZE, &thread_cfg);
+      net->worker_thread = os_thread_create_cfg("pn_worker",
+         &thread_cfg, pf_worker_thread, net);
+   }
+
+   if (net->worker_thread == NULL)
+   {
+      LOG_ERROR(PNET_LOG, "WORKER(%d): Could not create worker thread\n", __LINE__);
+   }
+
+   return 0;
+}
+
+void pf_worker_exit(
+   pnet_t                  *net)
+{
+   os_thread_t             *p_thread = NULL;
+   uint32_t                flags = 0;
+
+   if (net->worker_mutex != NULL)
+   {
+      /* New jobs are run by the caller from now on */
+      os_mutex_lock(net->worker_mutex);
+      p_thread = net->worker_thread;
+      net->worker_thread = NULL;
+      os_mutex_unlock(net->worker_mutex);
+   }
+
+   if (p_thread != NULL)
+   {
+      (void)os_mbox_post(net->worker_q, NULL, OS_WAIT_FOREVER);
+      (void)os_event_wait(net->worker_events, PF_WORKER_EVENT_DONE, &flags, OS_WAIT_FOREVER);
+      os_event_clr(net->worker_events, PF_WORKER_EVENT_DONE);
+      os_thread_join(p_thread);
+   }
+
+   if (net->worker_q != NULL)
+   {
+      os_mbox_destroy(net->worker_q);
+      net->worker_q = NULL;
+   }
+   if (net->worker_free != NULL)
+   {
+      os_mbox_destroy(net->worker_free);
+      net->worker_free = NULL;
+   }
+   if (net->worker_events != NULL)
+   {
+      os_event_destroy(net->worker_events);
+      net->worker_events = NULL;
+   }
+}
+
+void pf_worker_post(
+   pnet_t                  *net,
+   pf_worker_ftn_t         ftn,
+   void                    *arg)
+{
+   pf_worker_job_t         *p_job = NULL;
+   bool                    running = false;
+
+   /* The queues are not used once pf_worker_exit() has cleared the thread */
+   if (net->worker_mutex != NULL)
+   {
+      os_mutex_lock(net->worker_mutex);
+      running = (net->worker_thread != NULL);
+      if ((running == true) &&
+          (os_mbox_fetch(net->worker_free, (void **)&p_job, 0) == 0))
+      {
+         p_job->ftn = ftn;
+         p_job->arg = arg;
+         (void)os_mbox_post(net->worker_q, p_job, 0);
+      }
+      os_mutex_unlock(net->worker_mutex);
+   }
+
+   if (p_job == NULL)
+   {
+      if (running == true)
+      {
+         LOG_WARNING(PNET_LOG, "WORKER(%d): All jobs in use. Running the job in the caller.\n", __LINE__);
+      }
+      ftn(net, arg);
+   }
+}
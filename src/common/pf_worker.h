@@ -0,0 +1,82 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Control-plane work queue.
+ *
+ * Frame handlers run in the receive thread, and scheduler call-backs in the
+ * thread that calls pnet_handle_periodic(), which also sends the cyclic
+ * data. Work that may block, such as changing the IP settings, writing to
+ * nonvolatile memory or calling the application, is posted to this queue
+ * instead and done by a thread of its own. Jobs are run one at a time, in
+ * the order they were posted.
+ *
+ * The jobs are preallocated, so posting a job never allocates nor waits.
+ * If there is no worker thread, or all jobs are in use, the job is run at
+ * once by the caller.
+ */
+
+#ifndef PF_WORKER_H
+#define PF_WORKER_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Start the worker thread.
+ *
+ * Must be called after the configuration has been saved by pf_fspm_init().
+ *
+ * @param net              InOut: The p-net stack instance
+ * @return  0  always.
+ */
+int pf_worker_init(
+   pnet_t                  *net);
+
+/**
+ * Stop the worker thread and free its queues.
+ *
+ * Jobs that are already posted are run before the thread terminates.
+ * Jobs posted afterwards, also by other threads while this runs, are run
+ * by their caller. The mutex is kept for those, until the instance is
+ * freed.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_worker_exit(
+   pnet_t                  *net);
+
+/**
+ * Post a job to the worker thread.
+ *
+ * Never waits for the worker thread, only for a concurrent post.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param ftn              In:   The function to run.
+ * @param arg              In:   Argument of the function (may be NULL).
+ */
+void pf_worker_post(
+   pnet_t                  *net,
+   pf_worker_ftn_t         ftn,
+   void                    *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_WORKER_H */
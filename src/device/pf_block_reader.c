@@ -35,6 +35,18 @@
 #include "pf_includes.h"
 #include "pf_block_reader.h"
 
+/* Sizes on the wire of the fixed parts that are decoded in one go */
+#define PF_UUID_SIZE                      16
+#define PF_FRAME_DESCRIPTOR_SIZE          6     /* Slot, subslot, frame offset */
+#define PF_DATA_DESCRIPTOR_SIZE           6
+#define PF_EXP_SUBMODULE_SIZE             (8 + PF_DATA_DESCRIPTOR_SIZE)
+#define PF_EXP_MODULE_SIZE                14    /* API to number of submodules */
+#define PF_IOCR_PARAM_SIZE                40    /* IOCR type to number of APIs */
+#define PF_BLOCK_HEADER_SIZE              6
+#define PF_CONTROL_SIZE                   26
+#define PF_NDR_DATA_SIZE                  20
+#define PF_DCE_RPC_HEADER_SIZE            80
+
 /**
  * @internal
  * Extract a sequence of bytes from a buffer.
@@ -74,81 +86,151 @@ static void pf_get_mem(
    }
 }
 
-uint8_t pf_get_byte(
+/**
+ * @internal
+ * Claim a fixed size part of a buffer, checking the bounds once.
+ *
+ * The fields of the part are then decoded with the pf_load_* functions.
+ * If the part is not available, then the error is set as by pf_get_byte()
+ * and the bytes that are left are copied to a zero padded scratch buffer,
+ * so the fields get the same values as if they were read one by one.
+ * @param p_info           In:   The parser state.
+ * @param p_pos            InOut:Position in the buffer.
+ * @param len              In:   Length of the part.
+ * @param p_scratch        Out:  Scratch buffer of at least len bytes.
+ * @return  Pointer to the part, or to p_scratch if an error occurred.
+ */
+static const uint8_t *pf_get_span(
    pf_get_info_t           *p_info,
-   uint16_t                *p_pos)
+   uint16_t                *p_pos,
+   uint16_t                len,
+   uint8_t                 *p_scratch)
 {
-   uint8_t res = 0;
+   const uint8_t           *p_span = p_scratch;
 
    if (p_info->result != PF_PARSE_OK)
    {
       /* Preserve first error */
+      memset(p_scratch, 0, len);
    }
-   else if (*p_pos >= p_info->len)
+   else if (((uint32_t)(*p_pos) + len) > p_info->len)
    {
-      /* Reached end of buffer */
-      LOG_DEBUG(PNET_LOG, "BR(%d): End of buffer reached when looking for a byte\n", __LINE__);
+      LOG_DEBUG(PNET_LOG, "BR(%d): Unexpected end of input data\n", __LINE__);
+      memset(p_scratch, 0, len);
+      if ((p_info->p_buf != NULL) && (*p_pos < p_info->len))
+      {
+         memcpy(p_scratch, &p_info->p_buf[*p_pos], p_info->len - *p_pos);
+      }
       p_info->result = PF_PARSE_END_OF_INPUT;
    }
    else if (p_info->p_buf == NULL)
    {
+      memset(p_scratch, 0, len);
       p_info->result = PF_PARSE_NULL_POINTER;
    }
    else
    {
-      res = p_info->p_buf[*p_pos];
-      (*p_pos)++;
+      p_span = &p_info->p_buf[*p_pos];
+      (*p_pos) += len;
    }
 
-   return res;
+   return p_span;
 }
 
-uint16_t pf_get_uint16(
+/*
+ * Load integers from a part claimed by pf_get_span(). The byte shifts are
+ * recognized by the compiler, which emits one unaligned load and, if the
+ * wire order differs from the CPU, one byte swap.
+ */
+static inline uint16_t pf_load_uint16(
+   bool                    is_big_endian,
+   const uint8_t           *p)
+{
+   if (is_big_endian)
+   {
+      return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+   }
+   return (uint16_t)(((uint16_t)p[1] << 8) | p[0]);
+}
+
+static inline uint32_t pf_load_uint32(
+   bool                    is_big_endian,
+   const uint8_t           *p)
+{
+   if (is_big_endian)
+   {
+      return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+             ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+   }
+   return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+          ((uint32_t)p[1] << 8) | (uint32_t)p[0];
+}
+
+/**
+ * @internal
+ * Load a UUID from a part claimed by pf_get_span().
+ * @param is_big_endian    In:   Endianness of the first three fields.
+ * @param p                In:   The 16 bytes of the UUID.
+ * @param p_dest           Out:  Destination buffer.
+ */
+static void pf_load_uuid(
+   bool                    is_big_endian,
+   const uint8_t           *p,
+   pf_uuid_t               *p_dest)
+{
+   p_dest->data1 = pf_load_uint32(is_big_endian, &p[0]);
+   p_dest->data2 = pf_load_uint16(is_big_endian, &p[4]);
+   p_dest->data3 = pf_load_uint16(is_big_endian, &p[6]);
+   memcpy(p_dest->data4, &p[8], sizeof(p_dest->data4));
+}
+
+uint8_t pf_get_byte(
    pf_get_info_t           *p_info,
    uint16_t                *p_pos)
 {
-   uint16_t res = 0;
+   uint8_t res = 0;
 
    if (p_info->result != PF_PARSE_OK)
    {
-      /* Keep first error */
+      /* Preserve first error */
    }
-   else if (p_info->is_big_endian)
+   else if (*p_pos >= p_info->len)
    {
-      res = ((uint16_t)pf_get_byte(p_info, p_pos) << 8) +
-            (uint16_t)pf_get_byte(p_info, p_pos);
+      /* Reached end of buffer */
+      LOG_DEBUG(PNET_LOG, "BR(%d): End of buffer reached when looking for a byte\n", __LINE__);
+      p_info->result = PF_PARSE_END_OF_INPUT;
+   }
+   else if (p_info->p_buf == NULL)
+   {
+      p_info->result = PF_PARSE_NULL_POINTER;
    }
    else
    {
-      res = (uint16_t)pf_get_byte(p_info, p_pos) +
-            ((uint16_t)pf_get_byte(p_info, p_pos) << 8);
+      res = p_info->p_buf[*p_pos];
+      (*p_pos)++;
    }
 
    return res;
 }
 
-uint32_t pf_get_uint32(
+uint16_t pf_get_uint16(
    pf_get_info_t           *p_info,
    uint16_t                *p_pos)
 {
-   uint32_t res = 0;
+   uint8_t                 scratch[sizeof(uint16_t)];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(uint16_t), scratch);
 
-   if (p_info->is_big_endian)
-   {
-      res = ((uint32_t)pf_get_byte(p_info, p_pos) << 24) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 16) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 8) +
-            (uint32_t)pf_get_byte(p_info, p_pos);
-   }
-   else
-   {
-      res = (uint32_t)pf_get_byte(p_info, p_pos) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 8) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 16) +
-            ((uint32_t)pf_get_byte(p_info, p_pos) << 24);
-   }
+   return pf_load_uint16(p_info->is_big_endian, p);
+}
 
-   return res;
+uint32_t pf_get_uint32(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos)
+{
+   uint8_t                 scratch[sizeof(uint32_t)];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(uint32_t), scratch);
+
+   return pf_load_uint32(p_info->is_big_endian, p);
 }
 
 /**
@@ -163,10 +245,10 @@ static void pf_get_uuid(
    uint16_t                *p_pos,
    pf_uuid_t               *p_dest)
 {
-   p_dest->data1 = pf_get_uint32(p_info, p_pos);
-   p_dest->data2 = pf_get_uint16(p_info, p_pos);
-   p_dest->data3 = pf_get_uint16(p_info, p_pos);
-   pf_get_mem(p_info, p_pos, sizeof(p_dest->data4), p_dest->data4);
+   uint8_t                 scratch[PF_UUID_SIZE];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
+
+   pf_load_uuid(p_info->is_big_endian, p, p_dest);
 }
 
 /**
@@ -233,19 +315,46 @@ uint32_t pf_get_bits(
 
 /**
  * @internal
- * Extract a frame descriptor from a buffer.
+ * Extract an array of frame descriptors from a buffer.
  * @param p_info           In:   The parser state.
  * @param p_pos            InOut:Position in the buffer.
- * @param p_fd             Out:  Destination buffer.
+ * @param nbr              In:   Number of frame descriptors.
+ * @param p_fd             Out:  Destination array.
  */
-static void pf_get_frame_descriptor(
+static void pf_get_frame_descriptors(
    pf_get_info_t           *p_info,
    uint16_t                *p_pos,
+   uint16_t                nbr,
    pf_frame_descriptor_t   *p_fd)
 {
-   p_fd->slot_number = pf_get_uint16(p_info, p_pos);
-   p_fd->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_fd->frame_offset = pf_get_uint16(p_info, p_pos);
+   uint8_t                 scratch[PF_FRAME_DESCRIPTOR_SIZE];
+   const uint8_t           *p_array = NULL;
+   const uint8_t           *p;
+   uint16_t                ix;
+
+   /* One bounds check for the whole array, if it is all there */
+   if ((p_info->result == PF_PARSE_OK) &&
+       (p_info->p_buf != NULL) &&
+       (((uint32_t)(*p_pos) + (uint32_t)nbr * PF_FRAME_DESCRIPTOR_SIZE) <= p_info->len))
+   {
+      p_array = &p_info->p_buf[*p_pos];
+      (*p_pos) += nbr * PF_FRAME_DESCRIPTOR_SIZE;
+   }
+
+   for (ix = 0; ix < nbr; ix++)
+   {
+      if (p_array != NULL)
+      {
+         p = &p_array[ix * PF_FRAME_DESCRIPTOR_SIZE];
+      }
+      else
+      {
+         p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
+      }
+      p_fd[ix].slot_number = pf_load_uint16(p_info->is_big_endian, &p[0]);
+      p_fd[ix].subslot_number = pf_load_uint16(p_info->is_big_endian, &p[2]);
+      p_fd[ix].frame_offset = pf_load_uint16(p_info->is_big_endian, &p[4]);
+   }
 }
 
 /**
@@ -260,21 +369,33 @@ static void pf_get_iocr_api_entry(
    uint16_t                *p_pos,
    pf_api_entry_t          *p_ae)
 {
-   uint16_t ix;
-
    p_ae->api = pf_get_uint32(p_info, p_pos);
 
    p_ae->nbr_io_data = pf_get_uint16(p_info, p_pos);
-   for (ix = 0; ix < p_ae->nbr_io_data; ix++)
+   if (p_ae->nbr_io_data > NELEMENTS(p_ae->io_data))
    {
-      pf_get_frame_descriptor(p_info, p_pos, &p_ae->io_data[ix]);
+      LOG_ERROR(PNET_LOG, "BR(%d): Too many IO data objects (%u)\n", __LINE__, (unsigned)p_ae->nbr_io_data);
+      p_ae->nbr_io_data = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         /* Preserve first error */
+         p_info->result = PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES;
+      }
    }
+   pf_get_frame_descriptors(p_info, p_pos, p_ae->nbr_io_data, p_ae->io_data);
 
    p_ae->nbr_iocs = pf_get_uint16(p_info, p_pos);
-   for (ix = 0; ix < p_ae->nbr_iocs; ix++)
+   if (p_ae->nbr_iocs > NELEMENTS(p_ae->iocs))
    {
-      pf_get_frame_descriptor(p_info, p_pos, &p_ae->iocs[ix]);
+      LOG_ERROR(PNET_LOG, "BR(%d): Too many IOCS (%u)\n", __LINE__, (unsigned)p_ae->nbr_iocs);
+      p_ae->nbr_iocs = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         /* Preserve first error */
+         p_info->result = PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES;
+      }
    }
+   pf_get_frame_descriptors(p_info, p_pos, p_ae->nbr_iocs, p_ae->iocs);
 }
 
 /**
@@ -289,12 +410,16 @@ static void pf_get_exp_submodule(
    uint16_t                *p_pos,
    pf_exp_submodule_t      *p_sub)
 {
+   uint8_t                 scratch[PF_EXP_SUBMODULE_SIZE];
+   const uint8_t           *p;
+   bool                    be = p_info->is_big_endian;
    uint16_t                temp_u16;
 
-   p_sub->subslot_number = pf_get_uint16(p_info, p_pos);
-   p_sub->submodule_ident_number = pf_get_uint32(p_info, p_pos);
+   p = pf_get_span(p_info, p_pos, PF_EXP_SUBMODULE_SIZE, scratch);
+   p_sub->subslot_number = pf_load_uint16(be, &p[0]);
+   p_sub->submodule_ident_number = pf_load_uint32(be, &p[2]);
    /* subslot_properties */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
+   temp_u16 = pf_load_uint16(be, &p[6]);
    p_sub->submodule_properties.type = pf_get_bits(temp_u16, 0, 2);
    p_sub->submodule_properties.sharedInput = (pf_get_bits(temp_u16, 2, 1) != 0);
    p_sub->submodule_properties.reduce_input_submodule_data_length = (pf_get_bits(temp_u16, 3, 1) != 0);
@@ -302,18 +427,20 @@ static void pf_get_exp_submodule(
    p_sub->submodule_properties.discard_ioxs = (pf_get_bits(temp_u16, 5, 1) != 0);
 
    /* At least one submodule data descriptor */
-   p_sub->data_descriptor[0].data_direction = pf_get_uint16(p_info, p_pos);
-   p_sub->data_descriptor[0].submodule_data_length = pf_get_uint16(p_info, p_pos);
-   p_sub->data_descriptor[0].length_iocs = pf_get_byte(p_info, p_pos);
-   p_sub->data_descriptor[0].length_iops = pf_get_byte(p_info, p_pos);
+   p += 8;
+   p_sub->data_descriptor[0].data_direction = pf_load_uint16(be, &p[0]);
+   p_sub->data_descriptor[0].submodule_data_length = pf_load_uint16(be, &p[2]);
+   p_sub->data_descriptor[0].length_iocs = p[4];
+   p_sub->data_descriptor[0].length_iops = p[5];
    p_sub->nbr_data_descriptors = 1;
    /* May have one more */
    if (p_sub->submodule_properties.type == PNET_DIR_IO)
    {
-      p_sub->data_descriptor[1].data_direction = pf_get_uint16(p_info, p_pos);
-      p_sub->data_descriptor[1].submodule_data_length = pf_get_uint16(p_info, p_pos);
-      p_sub->data_descriptor[1].length_iocs = pf_get_byte(p_info, p_pos);
-      p_sub->data_descriptor[1].length_iops = pf_get_byte(p_info, p_pos);
+      p = pf_get_span(p_info, p_pos, PF_DATA_DESCRIPTOR_SIZE, scratch);
+      p_sub->data_descriptor[1].data_direction = pf_load_uint16(be, &p[0]);
+      p_sub->data_descriptor[1].submodule_data_length = pf_load_uint16(be, &p[2]);
+      p_sub->data_descriptor[1].length_iocs = p[4];
+      p_sub->data_descriptor[1].length_iops = p[5];
       p_sub->nbr_data_descriptors = 2;
    }
 }
@@ -325,10 +452,13 @@ void pf_get_block_header(
    uint16_t                *p_pos,
    pf_block_header_t       *p_hdr)
 {
-   p_hdr->block_type = pf_get_uint16(p_info, p_pos);
-   p_hdr->block_length = pf_get_uint16(p_info, p_pos);
-   p_hdr->block_version_high = pf_get_byte(p_info, p_pos);
-   p_hdr->block_version_low = pf_get_byte(p_info, p_pos);
+   uint8_t                 scratch[PF_BLOCK_HEADER_SIZE];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
+
+   p_hdr->block_type = pf_load_uint16(p_info->is_big_endian, &p[0]);
+   p_hdr->block_length = pf_load_uint16(p_info->is_big_endian, &p[2]);
+   p_hdr->block_version_high = p[4];
+   p_hdr->block_version_low = p[5];
 }
 
 void pf_get_ar_param(
@@ -376,41 +506,55 @@ void pf_get_iocr_param(
    uint16_t                ix,
    pf_ar_t                 *p_ar)
 {
+   pf_iocr_param_t         *p_param = &p_ar->iocrs[ix].param;
+   uint8_t                 scratch[PF_IOCR_PARAM_SIZE];
+   const uint8_t           *p;
+   bool                    be = p_info->is_big_endian;
    uint32_t                temp_u32;
    uint16_t                temp_u16;
    uint16_t                iy;
 
-   p_ar->iocrs[ix].param.iocr_type = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.iocr_reference = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.lt_field = pf_get_uint16(p_info, p_pos);
+   p = pf_get_span(p_info, p_pos, PF_IOCR_PARAM_SIZE, scratch);
+   p_param->iocr_type = pf_load_uint16(be, &p[0]);
+   p_param->iocr_reference = pf_load_uint16(be, &p[2]);
+   p_param->lt_field = pf_load_uint16(be, &p[4]);
    /* iocr_Properties */
-   temp_u32 = pf_get_uint32(p_info, p_pos);
-   p_ar->iocrs[ix].param.iocr_properties.rt_class = pf_get_bits(temp_u32, 0, 4);
-   p_ar->iocrs[ix].param.iocr_properties.reserved_1 = (pf_get_bits(temp_u32,4,9) != 0);
-   p_ar->iocrs[ix].param.iocr_properties.reserved_2 = (pf_get_bits(temp_u32,13,11) != 0);
-   p_ar->iocrs[ix].param.iocr_properties.reserved_3 = (pf_get_bits(temp_u32,24,8) != 0);
-
-   p_ar->iocrs[ix].param.c_sdu_length = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.frame_id = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.send_clock_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.reduction_ratio = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.phase = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.sequence = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.frame_send_offset = pf_get_uint32(p_info, p_pos);
-   p_ar->iocrs[ix].param.watchdog_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.data_hold_factor = pf_get_uint16(p_info, p_pos);
+   temp_u32 = pf_load_uint32(be, &p[6]);
+   p_param->iocr_properties.rt_class = pf_get_bits(temp_u32, 0, 4);
+   p_param->iocr_properties.reserved_1 = (pf_get_bits(temp_u32,4,9) != 0);
+   p_param->iocr_properties.reserved_2 = (pf_get_bits(temp_u32,13,11) != 0);
+   p_param->iocr_properties.reserved_3 = (pf_get_bits(temp_u32,24,8) != 0);
+
+   p_param->c_sdu_length = pf_load_uint16(be, &p[10]);
+   p_param->frame_id = pf_load_uint16(be, &p[12]);
+   p_param->send_clock_factor = pf_load_uint16(be, &p[14]);
+   p_param->reduction_ratio = pf_load_uint16(be, &p[16]);
+   p_param->phase = pf_load_uint16(be, &p[18]);
+   p_param->sequence = pf_load_uint16(be, &p[20]);
+   p_param->frame_send_offset = pf_load_uint32(be, &p[22]);
+   p_param->watchdog_factor = pf_load_uint16(be, &p[26]);
+   p_param->data_hold_factor = pf_load_uint16(be, &p[28]);
    /* iocr_tag_header */
-   temp_u16 = pf_get_uint16(p_info, p_pos);
-   p_ar->iocrs[ix].param.iocr_tag_header.vlan_id = pf_get_bits(temp_u16, 0, 11);
-   p_ar->iocrs[ix].param.iocr_tag_header.iocr_user_priority = pf_get_bits(temp_u16, 13, 3);
+   temp_u16 = pf_load_uint16(be, &p[30]);
+   p_param->iocr_tag_header.vlan_id = pf_get_bits(temp_u16, 0, 11);
+   p_param->iocr_tag_header.iocr_user_priority = pf_get_bits(temp_u16, 13, 3);
 
-   pf_get_mem(p_info, p_pos,
-      sizeof(p_ar->iocrs[ix].param.iocr_multicast_mac_add), &p_ar->iocrs[ix].param.iocr_multicast_mac_add);
+   memcpy(&p_param->iocr_multicast_mac_add, &p[32], sizeof(p_param->iocr_multicast_mac_add));
 
-   p_ar->iocrs[ix].param.nbr_apis = pf_get_uint16(p_info, p_pos);
-   for (iy = 0; iy < p_ar->iocrs[ix].param.nbr_apis; iy++)
+   p_param->nbr_apis = pf_load_uint16(be, &p[38]);
+   if (p_param->nbr_apis > NELEMENTS(p_param->apis))
+   {
+      LOG_ERROR(PNET_LOG, "BR(%d): Too many APIs in IOCR (%u)\n", __LINE__, (unsigned)p_param->nbr_apis);
+      p_param->nbr_apis = 0;
+      if (p_info->result == PF_PARSE_OK)
+      {
+         /* Preserve first error */
+         p_info->result = PF_PARSE_OUT_OF_API_RESOURCES;
+      }
+   }
+   for (iy = 0; iy < p_param->nbr_apis; iy++)
    {
-      pf_get_iocr_api_entry(p_info, p_pos, &p_ar->iocrs[ix].param.apis[iy]);
+      pf_get_iocr_api_entry(p_info, p_pos, &p_param->apis[iy]);
    }
 }
 
@@ -422,16 +566,19 @@ void pf_get_exp_api_module(
    uint16_t                ix;
    uint16_t                iy;
    uint32_t                api;
-   uint16_t                slot_number;
    pf_exp_api_t            *p_api = NULL;
    pf_exp_module_t         *p_mod = NULL;
    uint16_t                nbr_exp_api;
+   uint8_t                 scratch[PF_EXP_MODULE_SIZE];
+   const uint8_t           *p;
+   bool                    be = p_info->is_big_endian;
 
    nbr_exp_api = pf_get_uint16(p_info, p_pos);  /* In this block */
    for (ix = 0; ix < nbr_exp_api; ix++)
    {
       /* Get one module description */
-      api = pf_get_uint32(p_info, p_pos);
+      p = pf_get_span(p_info, p_pos, PF_EXP_MODULE_SIZE, scratch);
+      api = pf_load_uint32(be, &p[0]);
 
       /* Find the API if we are augmenting it */
       for (iy = 0; iy < p_ar->nbr_exp_apis; iy++)
@@ -461,32 +608,28 @@ void pf_get_exp_api_module(
          p_info->result = PF_PARSE_OUT_OF_API_RESOURCES;
          LOG_DEBUG(PNET_LOG, "BR(%d): Out of expected API resources\n", __LINE__);
       }
-      else
+      else if ((p_api->nbr_modules < PNET_MAX_MODULES) &&
+               (pf_load_uint16(be, &p[12]) <= PNET_MAX_SUBMODULES))
       {
-         slot_number = pf_get_uint16(p_info, p_pos);
-
          /* Get a new module. */
-         if (p_api->nbr_modules < PNET_MAX_MODULES)
-         {
-            p_mod = &p_api->modules[p_api->nbr_modules];
-            p_api->nbr_modules++;
-
-            p_mod->slot_number = slot_number;
-            p_mod->module_ident_number = pf_get_uint32(p_info, p_pos);
-            p_mod->module_properties = pf_get_uint16(p_info, p_pos);
-            p_mod->nbr_submodules = pf_get_uint16(p_info, p_pos);
-            for (iy = 0; iy < p_mod->nbr_submodules; iy++)
-            {
-               pf_get_exp_submodule(p_info, p_pos, &p_mod->submodules[iy]);
-            }
-            p_api->valid = true;
-         }
-         else
+         p_mod = &p_api->modules[p_api->nbr_modules];
+         p_api->nbr_modules++;
+
+         p_mod->slot_number = pf_load_uint16(be, &p[4]);
+         p_mod->module_ident_number = pf_load_uint32(be, &p[6]);
+         p_mod->module_properties = pf_load_uint16(be, &p[10]);
+         p_mod->nbr_submodules = pf_load_uint16(be, &p[12]);
+         for (iy = 0; iy < p_mod->nbr_submodules; iy++)
          {
-            /* This error condition is reported by caller. */
-            p_info->result = PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES;
-            LOG_ERROR(PNET_LOG, "BR(%d): Too many modules used (not enough slots). Out of expected module resources.\n", __LINE__);
+            pf_get_exp_submodule(p_info, p_pos, &p_mod->submodules[iy]);
          }
+         p_api->valid = true;
+      }
+      else
+      {
+         /* This error condition is reported by caller. */
+         p_info->result = PF_PARSE_OUT_OF_EXP_SUBMODULE_RESOURCES;
+         LOG_ERROR(PNET_LOG, "BR(%d): Too many modules or submodules used. Out of expected module resources.\n", __LINE__);
       }
    }
 }
@@ -544,11 +687,15 @@ static void pf_get_dfp_iocr(
    uint16_t                *p_pos,
    pf_dfp_iocr_t           *p_dfp_iocr)
 {
+   uint32_t                subframe_data;
+
    p_dfp_iocr->iocr_reference = pf_get_uint16(p_info, p_pos);
    p_dfp_iocr->subframe_offset = pf_get_uint16(p_info, p_pos);
 
-   p_dfp_iocr->subframe_data.subframe_position = pf_get_byte(p_info, p_pos);
-   p_dfp_iocr->subframe_data.subframe_length = pf_get_byte(p_info, p_pos);
+   /* Bits 0-6: Position, bits 8-15: DataLength. The others are reserved. */
+   subframe_data = pf_get_uint32(p_info, p_pos);
+   p_dfp_iocr->subframe_data.subframe_position = (uint8_t)(subframe_data & 0x7f);
+   p_dfp_iocr->subframe_data.subframe_length = (uint8_t)((subframe_data >> 8) & 0xff);
 }
 
 void pf_get_ir_info_request(
@@ -556,18 +703,46 @@ void pf_get_ir_info_request(
    uint16_t                *p_pos,
    pf_ar_t                 *p_ar)
 {
-   uint16_t ix;
+   uint16_t                ix;
+   pf_dfp_iocr_t           scratch;
 
+   (void)pf_get_uint16(p_info, p_pos);       /* Padding */
    pf_get_uuid(p_info, p_pos, &p_ar->ir_info.ir_data_uuid);
+   (void)pf_get_uint16(p_info, p_pos);       /* Padding */
    p_ar->ir_info.nbr_iocrs = pf_get_uint16(p_info, p_pos);
 
    for (ix = 0; ix < p_ar->ir_info.nbr_iocrs; ix++)
    {
-      pf_get_dfp_iocr(p_info, p_pos, &p_ar->ir_info.dfp_iocrs[ix]);
+      if (ix < NELEMENTS(p_ar->ir_info.dfp_iocrs))
+      {
+         pf_get_dfp_iocr(p_info, p_pos, &p_ar->ir_info.dfp_iocrs[ix]);
+      }
+      else
+      {
+         /* Too many. Rejected by the connect check. */
+         pf_get_dfp_iocr(p_info, p_pos, &scratch);
+      }
    }
 }
 #endif
 
+#if PNET_OPTION_SR
+void pf_get_sr_info_request(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos,
+   pf_ar_t                 *p_ar)
+{
+   uint32_t                sr_properties;
+
+   p_ar->sr_info.redundancy_data_hold_factor = pf_get_uint16(p_info, p_pos);
+
+   /* Bit 0: InputValidOnBackupAR, bit 2: Mode. The others are reserved. */
+   sr_properties = pf_get_uint32(p_info, p_pos);
+   p_ar->sr_info.sr_properties.input_valid_on_backup = (uint8_t)(sr_properties & 0x01);
+   p_ar->sr_info.sr_properties.mode = (uint8_t)((sr_properties >> 2) & 0x01);
+}
+#endif
+
 #if PNET_OPTION_MC_CR
 void pf_get_mcr_request(
    pf_get_info_t           *p_info,
@@ -575,15 +750,21 @@ void pf_get_mcr_request(
    uint16_t                ix,
    pf_ar_t                 *p_ar)
 {
+   uint16_t                str_len;
+
    p_ar->mcr_request[ix].iocr_reference = pf_get_uint16(p_info, p_pos);
    p_ar->mcr_request[ix].address_resolution_properties.protocol = pf_get_byte(p_info, p_pos);
    p_ar->mcr_request[ix].address_resolution_properties.resolution_factor = pf_get_byte(p_info, p_pos);
    p_ar->mcr_request[ix].mci_timeout_factor = pf_get_uint16(p_info, p_pos);
-   p_ar->mcr_request[ix].length_provider_station_name = pf_get_uint16(p_info, p_pos);
+   str_len = pf_get_uint16(p_info, p_pos);
+   p_ar->mcr_request[ix].length_provider_station_name = str_len;
+   if (str_len > sizeof(p_ar->mcr_request[ix].provider_station_name) - 1)
+   {
+      str_len = sizeof(p_ar->mcr_request[ix].provider_station_name) - 1;
+   }
 
-   pf_get_mem(p_info, p_pos,
-      p_ar->mcr_request[ix].length_provider_station_name, p_ar->mcr_request[ix].provider_station_name);
-   p_ar->mcr_request[ix].provider_station_name[p_ar->mcr_request[ix].length_provider_station_name] = '\0';
+   pf_get_mem(p_info, p_pos, str_len, p_ar->mcr_request[ix].provider_station_name);
+   p_ar->mcr_request[ix].provider_station_name[str_len] = '\0';
 }
 #endif
 
@@ -615,16 +796,19 @@ void pf_get_control(
    uint16_t                *p_pos,
    pf_control_block_t      *p_req)
 {
+   uint8_t                 scratch[PF_CONTROL_SIZE];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
+   bool                    be = p_info->is_big_endian;
+
    /* 2 padding bytes */
-   (void)pf_get_uint16(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_req->ar_uuid);
-   p_req->session_key = pf_get_uint16(p_info, p_pos);
+   pf_load_uuid(be, &p[2], &p_req->ar_uuid);
+   p_req->session_key = pf_load_uint16(be, &p[18]);
 
-   p_req->alarm_sequence_number = pf_get_uint16(p_info, p_pos);
+   p_req->alarm_sequence_number = pf_load_uint16(be, &p[20]);
 
    /* Command and properties are always Big-Endian on the wire!! */
-   p_req->control_command = pf_get_uint16(p_info, p_pos);
-   p_req->control_block_properties = pf_get_uint16(p_info, p_pos);
+   p_req->control_command = pf_load_uint16(be, &p[22]);
+   p_req->control_block_properties = pf_load_uint16(be, &p[24]);
 }
 
 void pf_get_ndr_data(
@@ -632,11 +816,15 @@ void pf_get_ndr_data(
    uint16_t                *p_pos,
    pf_ndr_data_t           *p_ndr)
 {
-   p_ndr->args_maximum = pf_get_uint32(p_info, p_pos);
-   p_ndr->args_length = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.maximum_count = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.offset = pf_get_uint32(p_info, p_pos);
-   p_ndr->array.actual_count = pf_get_uint32(p_info, p_pos);
+   uint8_t                 scratch[PF_NDR_DATA_SIZE];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
+   bool                    be = p_info->is_big_endian;
+
+   p_ndr->args_maximum = pf_load_uint32(be, &p[0]);
+   p_ndr->args_length = pf_load_uint32(be, &p[4]);
+   p_ndr->array.maximum_count = pf_load_uint32(be, &p[8]);
+   p_ndr->array.offset = pf_load_uint32(be, &p[12]);
+   p_ndr->array.actual_count = pf_load_uint32(be, &p[16]);
 }
 
 void pf_get_dce_rpc_header(
@@ -644,13 +832,16 @@ void pf_get_dce_rpc_header(
    uint16_t                *p_pos,
    pf_rpc_header_t         *p_rpc)
 {
+   uint8_t                 scratch[PF_DCE_RPC_HEADER_SIZE];
+   const uint8_t           *p = pf_get_span(p_info, p_pos, sizeof(scratch), scratch);
    uint8_t                 temp_uint8;
+   bool                    be;
 
-   p_rpc->version = pf_get_byte(p_info, p_pos);
-   p_rpc->packet_type = pf_get_byte(p_info, p_pos) & 0x1f;  /* Only 5 LSB according to spec */
+   p_rpc->version = p[0];
+   p_rpc->packet_type = p[1] & 0x1f;  /* Only 5 LSB according to spec */
 
    /* flags */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = p[2];
    p_rpc->flags.last_fragment = pf_get_bits(temp_uint8, PF_RPC_F_LAST_FRAGMENT, 1);
    p_rpc->flags.fragment = pf_get_bits(temp_uint8, PF_RPC_F_FRAGMENT, 1);
    p_rpc->flags.no_fack = pf_get_bits(temp_uint8, PF_RPC_F_NO_FACK, 1);
@@ -659,35 +850,35 @@ void pf_get_dce_rpc_header(
    p_rpc->flags.broadcast = pf_get_bits(temp_uint8, PF_RPC_F_BROADCAST, 1);
 
    /* flags2 */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   temp_uint8 = p[3];
    p_rpc->flags2.cancel_pending = pf_get_bits(temp_uint8, PF_RPC_F2_CANCEL_PENDING, 1);
 
-   /* Data repr */
-   temp_uint8 = pf_get_byte(p_info, p_pos);
+   /* Data repr. The rest of the header is decoded with this byte order. */
+   temp_uint8 = p[4];
    p_rpc->is_big_endian = (pf_get_bits(temp_uint8, 4, 4) == 0);
    p_info->is_big_endian = p_rpc->is_big_endian;
+   be = p_rpc->is_big_endian;
 
    /* Float repr  - Assume IEEE */
-   (void)pf_get_byte(p_info, p_pos);
    p_rpc->float_repr = 0;
 
    /* Reserved */
-   p_rpc->reserved = pf_get_byte(p_info, p_pos);
-
-   p_rpc->serial_high = pf_get_byte(p_info, p_pos);
-   pf_get_uuid(p_info, p_pos, &p_rpc->object_uuid);
-   pf_get_uuid(p_info, p_pos, &p_rpc->interface_uuid);
-   pf_get_uuid(p_info, p_pos, &p_rpc->activity_uuid);
-   p_rpc->server_boot_time = pf_get_uint32(p_info, p_pos);
-   p_rpc->interface_version = pf_get_uint32(p_info, p_pos);
-   p_rpc->sequence_nmb = pf_get_uint32(p_info, p_pos);
-   p_rpc->opnum = pf_get_uint16(p_info, p_pos);
-   p_rpc->interface_hint = pf_get_uint16(p_info, p_pos);
-   p_rpc->activity_hint = pf_get_uint16(p_info, p_pos);
-   p_rpc->length_of_body = pf_get_uint16(p_info, p_pos);
-   p_rpc->fragment_nmb = pf_get_uint16(p_info, p_pos);
-   p_rpc->auth_protocol = pf_get_byte(p_info, p_pos);
-   p_rpc->serial_low = pf_get_byte(p_info, p_pos);
+   p_rpc->reserved = p[6];
+
+   p_rpc->serial_high = p[7];
+   pf_load_uuid(be, &p[8], &p_rpc->object_uuid);
+   pf_load_uuid(be, &p[24], &p_rpc->interface_uuid);
+   pf_load_uuid(be, &p[40], &p_rpc->activity_uuid);
+   p_rpc->server_boot_time = pf_load_uint32(be, &p[56]);
+   p_rpc->interface_version = pf_load_uint32(be, &p[60]);
+   p_rpc->sequence_nmb = pf_load_uint32(be, &p[64]);
+   p_rpc->opnum = pf_load_uint16(be, &p[68]);
+   p_rpc->interface_hint = pf_load_uint16(be, &p[70]);
+   p_rpc->activity_hint = pf_load_uint16(be, &p[72]);
+   p_rpc->length_of_body = pf_load_uint16(be, &p[74]);
+   p_rpc->fragment_nmb = pf_load_uint16(be, &p[76]);
+   p_rpc->auth_protocol = p[78];
+   p_rpc->serial_low = p[79];
 }
 
 void pf_get_read_request(
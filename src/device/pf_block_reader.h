@@ -198,6 +198,19 @@ void pf_get_ir_info_request(
    pf_ar_t                 *p_ar);
 #endif
 
+#if PNET_OPTION_SR
+/**
+ * Extract an SR info request block from a buffer.
+ * @param p_info           In:   The parser state.
+ * @param p_pos            InOut:Position in the buffer.
+ * @param p_ar             Out:  Contains the destination structure.
+ */
+void pf_get_sr_info_request(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos,
+   pf_ar_t                 *p_ar);
+#endif
+
 /**
  * Extract a DCE RPC header from a raw UDP data buffer.
  * @param p_info           InOut:The parser information. Sets p_info->is_big_endian
@@ -199,7 +199,25 @@ void pf_put_uint16(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (is_big_endian)
+   uint8_t                 *p_dst;
+
+   if ((uint32_t)(*p_pos) + 2 <= res_len)
+   {
+      /* Common case: One bounds check for the whole value */
+      p_dst = &p_bytes[*p_pos];
+      if (is_big_endian)
+      {
+         p_dst[0] = (uint8_t)(val >> 8);
+         p_dst[1] = (uint8_t)val;
+      }
+      else
+      {
+         p_dst[0] = (uint8_t)val;
+         p_dst[1] = (uint8_t)(val >> 8);
+      }
+      (*p_pos) += 2;
+   }
+   else if (is_big_endian)
    {
       pf_put_byte((val >> 8) & 0xff, res_len, p_bytes, p_pos);
       pf_put_byte(val & 0xff, res_len, p_bytes, p_pos);
@@ -218,7 +236,29 @@ void pf_put_uint32(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   if (is_big_endian)
+   uint8_t                 *p_dst;
+
+   if ((uint32_t)(*p_pos) + 4 <= res_len)
+   {
+      /* Common case: One bounds check for the whole value */
+      p_dst = &p_bytes[*p_pos];
+      if (is_big_endian)
+      {
+         p_dst[0] = (uint8_t)(val >> 24);
+         p_dst[1] = (uint8_t)(val >> 16);
+         p_dst[2] = (uint8_t)(val >> 8);
+         p_dst[3] = (uint8_t)val;
+      }
+      else
+      {
+         p_dst[0] = (uint8_t)val;
+         p_dst[1] = (uint8_t)(val >> 8);
+         p_dst[2] = (uint8_t)(val >> 16);
+         p_dst[3] = (uint8_t)(val >> 24);
+      }
+      (*p_pos) += 4;
+   }
+   else if (is_big_endian)
    {
       pf_put_byte((val >> 24) & 0xff, res_len, p_bytes, p_pos);
       pf_put_byte((val >> 16) & 0xff, res_len, p_bytes, p_pos);
@@ -234,6 +274,38 @@ void pf_put_uint32(
    }
 }
 
+uint16_t pf_put_block_begin(
+   bool                    is_big_endian,
+   pf_block_type_values_t  bh_type,
+   uint8_t                 bh_ver_high,
+   uint8_t                 bh_ver_low,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   uint16_t                block_pos = *p_pos;
+
+   pf_put_block_header(is_big_endian, bh_type,
+      0,                      /* Patched by pf_put_block_end() */
+      bh_ver_high, bh_ver_low,
+      res_len, p_bytes, p_pos);
+
+   return block_pos;
+}
+
+void pf_put_block_end(
+   bool                    is_big_endian,
+   uint16_t                block_pos,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                pos)
+{
+   uint16_t                block_len = pos - (block_pos + 4);
+
+   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
+   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+}
+
 void pf_put_time_timestamp(
    bool                    is_big_endian,
    pf_log_book_ts_t        *p_time_ts,
@@ -253,11 +325,9 @@ void pf_put_ar_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_AR_BLOCK_RES, 0,                             /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_AR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -269,9 +339,7 @@ void pf_put_ar_result(
    pf_put_uint16(is_big_endian, p_ar->ar_result.responder_udp_rt_port, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_iocr_result(
@@ -282,11 +350,9 @@ void pf_put_iocr_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_IOCR_BLOCK_RES, 0,                           /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_IOCR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -295,9 +361,7 @@ void pf_put_iocr_result(
    pf_put_uint16(is_big_endian, p_ar->iocrs[ix].result.frame_id, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_alarm_cr_result(
@@ -307,11 +371,9 @@ void pf_put_alarm_cr_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_ALARM_CR_BLOCK_RES, 0,                       /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_ALARM_CR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -320,9 +382,7 @@ void pf_put_alarm_cr_result(
    pf_put_uint16(is_big_endian, p_ar->alarm_cr_result.max_alarm_data_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 /**
@@ -463,14 +523,12 @@ void pf_put_ar_diff(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
    uint16_t                api_ix;
 
    if ((p_ar != NULL) && (p_ar->nbr_api_diffs > 0))
    {
-      pf_put_block_header(is_big_endian,
-         PF_BT_MODULE_DIFF_BLOCK, 0,                        /* Dont know block_len yet */
+      block_pos = pf_put_block_begin(is_big_endian, PF_BT_MODULE_DIFF_BLOCK,
          PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
          res_len, p_bytes, p_pos);
 
@@ -482,9 +540,7 @@ void pf_put_ar_diff(
       }
 
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
    }
 }
 
@@ -495,20 +551,16 @@ void pf_put_ar_rpc_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_AR_RPC_BLOCK_RES, 0,                         /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_AR_RPC_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_uint16(is_big_endian, p_ar->ar_rpc_result.responder_rpc_server_port, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_ar_server_result(
@@ -518,11 +570,9 @@ void pf_put_ar_server_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_AR_SERVER_BLOCK, 0,                          /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_AR_SERVER_BLOCK,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -537,9 +587,7 @@ void pf_put_ar_server_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 #if PNET_OPTION_AR_VENDOR_BLOCKS
@@ -551,11 +599,9 @@ void pf_put_ar_vendor_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_AR_VENDOR_BLOCK_RES, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_AR_VENDOR_BLOCK_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -571,9 +617,7 @@ void pf_put_ar_vendor_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 #endif
 
@@ -638,7 +682,19 @@ static void pf_put_sr_info(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   /* ToDo: Not yet implemented */
+   uint16_t                block_pos = 0;
+   uint32_t                sr_properties = 0;
+
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_SR_INFO_BLOCK_REQ,
+      PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
+      res_len, p_bytes, p_pos);
+
+   pf_put_uint16(is_big_endian, p_ar->sr_info.redundancy_data_hold_factor, res_len, p_bytes, p_pos);
+   pf_put_bits(p_ar->sr_info.sr_properties.input_valid_on_backup, 1, 0, &sr_properties);
+   pf_put_bits(p_ar->sr_info.sr_properties.mode, 1, 2, &sr_properties);
+   pf_put_uint32(is_big_endian, sr_properties, res_len, p_bytes, p_pos);
+
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 #endif
 
@@ -883,16 +939,14 @@ void pf_put_ar_data(
    /*
    BlockHeader, NumberOfARs, (AR)*
    */
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
    uint16_t                data_pos;
    pf_device_t             *p_device = NULL;
    uint16_t                cnt;
    uint16_t                ix;
    pf_ar_t                 *p_ar_tmp = NULL;
 
-   pf_put_block_header(is_big_endian,
-      PF_BT_AR_DATA, 0,                   /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_AR_DATA,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW_1,
       res_len, p_bytes, p_pos);
 
@@ -905,7 +959,7 @@ void pf_put_ar_data(
       {
 
          /* Count the number of ARs */
-         for (ix = 0; ix < PNET_MAX_AR; ix++)
+         for (ix = 0; ix < net->max_ar; ix++)
          {
              p_ar_tmp = pf_ar_find_by_index(net, ix);
              if (p_ar_tmp != NULL)
@@ -938,7 +992,7 @@ void pf_put_ar_data(
       if (p_ar == NULL)
       {
          /* Insert the ARs */
-         for (ix = 0; ix < PNET_MAX_AR; ix++)
+         for (ix = 0; ix < net->max_ar; ix++)
          {
             p_ar_tmp = pf_ar_find_by_index(net, ix);
             if (p_ar_tmp != NULL)
@@ -969,9 +1023,7 @@ void pf_put_ar_data(
    if (data_pos < *p_pos)
    {
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
    }
    else
    {
@@ -988,11 +1040,9 @@ void pf_put_control(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
-   pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1008,9 +1058,7 @@ void pf_put_control(
    pf_put_uint16(is_big_endian, p_res->control_block_properties, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_pnet_status(
@@ -1094,21 +1142,17 @@ void pf_put_record_data_read(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_mem(p_raw_data, raw_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_read_result(
@@ -1119,13 +1163,11 @@ void pf_put_read_result(
    uint16_t                *p_pos,
    uint16_t                *p_data_length_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
    uint16_t ix;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_READ_RES, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_READ_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1147,9 +1189,7 @@ void pf_put_read_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 /**
@@ -1214,7 +1254,8 @@ static void pf_put_ident_slot(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                cnt;
+   uint16_t                cnt = 0;
+   uint16_t                cnt_pos;
    uint16_t                ix;
    pf_subslot_t            *p_subslot;
 
@@ -1228,64 +1269,32 @@ static void pf_put_ident_slot(
       pf_put_uint32(is_big_endian, p_slot->module_ident_number, res_len, p_bytes, p_pos);
    }
 
-   /* Count the number of active sub-slots */
-   cnt = 0;
+   /* Number of subslots in use is inserted when known */
+   cnt_pos = *p_pos;
+   pf_put_uint16(is_big_endian, 0, res_len, p_bytes, p_pos);
+
+   /* Count the active sub-slots and add their info - if requested */
    for (ix = 0; ix < NELEMENTS(p_slot->subslots); ix++)
    {
       p_subslot = &p_slot->subslots[ix];
-      if (p_subslot->in_use == true)
+      if ((p_subslot->in_use == true) &&
+          ((p_ar == NULL) || (p_ar == p_subslot->p_ar)) &&
+          ((filter_level < PF_DEV_FILTER_LEVEL_SUBSLOT) || (p_subslot->subslot_nbr == subslot_nbr)))
       {
-         if ((p_ar == NULL) || (p_ar == p_subslot->p_ar))
+         cnt++;
+         if (stop_level > PF_DEV_FILTER_LEVEL_SLOT)
          {
-            if (filter_level >= PF_DEV_FILTER_LEVEL_SUBSLOT)
-            {
-               if (p_subslot->subslot_nbr == subslot_nbr)
-               {
-                  cnt++;
-               }
-            }
-            else
-            {
-               cnt++;
-            }
+            pf_put_ident_subslot(is_big_endian, block_type,
+               p_subslot, res_len, p_bytes, p_pos);
          }
       }
    }
 
    /* Insert number of subslots in use, even if there are none */
-   pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, p_pos);
-
-   /* Now add the actual subslot info - if requested */
-   if (stop_level > PF_DEV_FILTER_LEVEL_SLOT)
-   {
-      for (ix = 0; ix < NELEMENTS(p_slot->subslots); ix++)
-      {
-         p_subslot = &p_slot->subslots[ix];
-         if (p_subslot->in_use == true)
-         {
-            if ((p_ar == NULL) || (p_ar == p_subslot->p_ar))
-            {
-               if (filter_level >= PF_DEV_FILTER_LEVEL_SUBSLOT)
-               {
-                  if (p_subslot->subslot_nbr == subslot_nbr)
-                  {
-                     /* Call only for the matching subslot_nbr */
-                     pf_put_ident_subslot(is_big_endian, block_type,
-                        p_subslot, res_len, p_bytes, p_pos);
-                  }
-               }
-               else
-               {
-                  /* No filter: Call for all sub-slots that are in use */
-                  pf_put_ident_subslot(is_big_endian, block_type,
-                     p_subslot, res_len, p_bytes, p_pos);
-               }
-            }
-         }
-      }
-   }
+   pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, &cnt_pos);
 }
 
+
 /**
  * @internal
  * Insert the API information into a buffer, with filter.
@@ -1318,7 +1327,8 @@ static void pf_put_ident_api(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                cnt;
+   uint16_t                cnt = 0;
+   uint16_t                cnt_pos;
    uint16_t                ix;
    pf_slot_t               *p_slot;
 
@@ -1326,64 +1336,33 @@ static void pf_put_ident_api(
 
    if (stop_level > PF_DEV_FILTER_LEVEL_API_ID)
    {
-      /* Count the number of active slots */
-      cnt = 0;
+      /* Number of slots in use is inserted when known */
+      cnt_pos = *p_pos;
+      pf_put_uint16(is_big_endian, 0, res_len, p_bytes, p_pos);
+
+      /* Count the active slots and add slot (module) information - if requested */
       for (ix = 0; ix < NELEMENTS(p_api->slots); ix++)
       {
          p_slot = &p_api->slots[ix];
-         if (p_slot->in_use == true)
+         if ((p_slot->in_use == true) &&
+             ((p_ar == NULL) || (p_ar == p_slot->p_ar)) &&
+             ((filter_level < PF_DEV_FILTER_LEVEL_SLOT) || (p_slot->slot_nbr == slot_nbr)))
          {
-            if ((p_ar == NULL) || (p_ar == p_slot->p_ar))
+            cnt++;
+            if (stop_level > PF_DEV_FILTER_LEVEL_API)
             {
-               if (filter_level >= PF_DEV_FILTER_LEVEL_SLOT)
-               {
-                  if (p_slot->slot_nbr == slot_nbr)
-                  {
-                     cnt++;
-                  }
-               }
-               else
-               {
-                  cnt++;
-               }
+               pf_put_ident_slot(is_big_endian, block_type, filter_level, stop_level,
+                  p_ar, p_slot, subslot_nbr, res_len, p_bytes, p_pos);
             }
          }
       }
-      /* Insert number of slots in use, even if there are none */
-      pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, p_pos);
 
-      if (stop_level > PF_DEV_FILTER_LEVEL_API)
-      {
-         /* Include slot (module) information */
-         for (ix = 0; ix < NELEMENTS(p_api->slots); ix++)
-         {
-            p_slot = &p_api->slots[ix];
-            if (p_slot->in_use == true)
-            {
-               if ((p_ar == NULL) || (p_ar == p_slot->p_ar))
-               {
-                  if (filter_level >= PF_DEV_FILTER_LEVEL_SLOT)
-                  {
-                     if (p_slot->slot_nbr == slot_nbr)
-                     {
-                        /* No filter: Call for all slots that are in use */
-                        pf_put_ident_slot(is_big_endian, block_type, filter_level, stop_level,
-                           p_ar, p_slot, subslot_nbr, res_len, p_bytes, p_pos);
-                     }
-                  }
-                  else
-                  {
-                     /* No filter: Call for all slots that are in use */
-                     pf_put_ident_slot(is_big_endian, block_type, filter_level, stop_level,
-                        p_ar, p_slot, subslot_nbr, res_len, p_bytes, p_pos);
-                  }
-               }
-            }
-         }
-      }
+      /* Insert number of slots in use, even if there are none */
+      pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, &cnt_pos);
    }
 }
 
+
 /**
  * @internal
  * Put requested ident information into a buffer, with filter.
@@ -1419,68 +1398,164 @@ static void pf_put_ident_device(
    uint16_t                *p_pos)
 {
    uint16_t                ix;
-   uint16_t                cnt;
+   uint16_t                cnt = 0;
+   uint16_t                cnt_pos;
    pf_api_t                *p_api = NULL;
 
-   /* Count the number of active APIs */
-   cnt = 0;
+   /* Number of APIs in use is inserted when known */
+   cnt_pos = *p_pos;
+   pf_put_uint16(is_big_endian, 0, res_len, p_bytes, p_pos);
+
+   /* Count the active APIs and add at least API ID information - if requested */
    for (ix = 0; ix < NELEMENTS(p_device->apis); ix++)
    {
       p_api = &p_device->apis[ix];
-      if (p_api->in_use == true)
+      if ((p_api->in_use == true) &&
+          ((p_ar == NULL) || (p_ar == p_api->p_ar)) &&
+          ((filter_level < PF_DEV_FILTER_LEVEL_API) || (p_api->api_id == api_id)))
       {
-         if ((p_ar == NULL) || (p_ar == p_api->p_ar))
+         cnt++;
+         if (stop_level > PF_DEV_FILTER_LEVEL_DEVICE)
          {
-            if (filter_level >= PF_DEV_FILTER_LEVEL_API)
-            {
-               if (p_api->api_id == api_id)
-               {
-                  cnt++;
-               }
-            }
-            else
-            {
-               cnt++;
-            }
+            pf_put_ident_api(is_big_endian, block_type, filter_level, stop_level,
+               p_ar, p_api, slot_nbr, subslot_nbr, res_len, p_bytes, p_pos);
          }
       }
    }
 
-   /*Do not append if there is not existing API*/
-   if(0 == cnt)
-	   return;
-   
-   /* Insert number of APIs in use, even if there are none */
-   pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, p_pos);
-   
-   if (stop_level > PF_DEV_FILTER_LEVEL_DEVICE)
+   if (cnt > 0)
+   {
+      pf_put_uint16(is_big_endian, cnt, res_len, p_bytes, &cnt_pos);
+   }
+   else
+   {
+      /* Do not append anything if there is no matching API */
+      *p_pos = cnt_pos;
+   }
+}
+
+
+/**
+ * @internal
+ * Compare the request parameters of two identification responses.
+ * @param p_a              In:   The first key.
+ * @param p_b              In:   The second key.
+ * @return  true if the keys are equal.
+ */
+static bool pf_ident_cache_key_equal(
+   const pf_ident_cache_key_t *p_a,
+   const pf_ident_cache_key_t *p_b)
+{
+   return (p_a->p_ar == p_b->p_ar) &&
+          (p_a->api_id == p_b->api_id) &&
+          (p_a->slot_nbr == p_b->slot_nbr) &&
+          (p_a->subslot_nbr == p_b->subslot_nbr) &&
+          (p_a->block_type == p_b->block_type) &&
+          (p_a->block_version_low == p_b->block_version_low) &&
+          (p_a->filter_level == p_b->filter_level) &&
+          (p_a->stop_level == p_b->stop_level) &&
+          (p_a->is_big_endian == p_b->is_big_endian);
+}
+
+/**
+ * @internal
+ * Insert a cached identification response into a buffer.
+ *
+ * An entry is only used if it was serialized from the current device tree
+ * and if it fits completely, so that a hit produces exactly the same bytes
+ * as serializing the response again.
+ *
+ * @param p_device         In:   The device instance.
+ * @param p_key            In:   The request parameters.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ * @return  true if the cached response was inserted.
+ *          false if the response must be serialized.
+ */
+static bool pf_ident_cache_get(
+   pf_device_t             *p_device,
+   const pf_ident_cache_key_t *p_key,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   bool                    ret = false;
+   uint16_t                ix;
+   pf_ident_cache_entry_t  *p_entry;
+
+   for (ix = 0; ix < NELEMENTS(p_device->ident_cache); ix++)
    {
-      /* Include at least API ID information */
-      for (ix = 0; ix < NELEMENTS(p_device->apis); ix++)
+      p_entry = &p_device->ident_cache[ix];
+      if ((p_entry->valid == true) &&
+          (p_entry->generation == p_device->ident_generation) &&
+          (pf_ident_cache_key_equal(&p_entry->key, p_key) == true))
       {
-         p_api = &p_device->apis[ix];
-         if (p_api->in_use == true)
+         if (((uint32_t)(*p_pos) + p_entry->len) < res_len)
          {
-            if ((p_ar == NULL) || (p_ar == p_api->p_ar))
-            {
-               if (filter_level >= PF_DEV_FILTER_LEVEL_API)
-               {
-                  if (p_api->api_id == api_id)
-                  {
-                     /* Call only for the matching API_id */
-                     pf_put_ident_api(is_big_endian, block_type, filter_level, stop_level,
-                        p_ar, p_api, slot_nbr, subslot_nbr, res_len, p_bytes, p_pos);
-                  }
-               }
-               else
-               {
-                  /* No filter: Call for all APIs that are in use */
-                  pf_put_ident_api(is_big_endian, block_type, filter_level, stop_level,
-                     p_ar, p_api, slot_nbr, subslot_nbr, res_len, p_bytes, p_pos);
-               }
-            }
+            memcpy(&p_bytes[*p_pos], p_entry->data, p_entry->len);
+            (*p_pos) += p_entry->len;
+            p_device->ident_cache_hits++;
+            ret = true;
+         }
+         break;
+      }
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Remember a serialized identification response.
+ *
+ * The writers silently drop anything that does not fit in the buffer, so the
+ * response is only known to be complete if the position is still inside the
+ * buffer. Incomplete or too large responses are not cached.
+ *
+ * @param p_device         InOut: The device instance.
+ * @param p_key            In:   The request parameters.
+ * @param generation       In:   The device tree generation before serializing.
+ * @param start_pos        In:   Position of the response in the buffer.
+ * @param res_len          In:   Size of the buffer.
+ * @param p_bytes          In:   The buffer.
+ * @param pos              In:   Position after the response.
+ */
+static void pf_ident_cache_put(
+   pf_device_t             *p_device,
+   const pf_ident_cache_key_t *p_key,
+   uint32_t                generation,
+   uint16_t                start_pos,
+   uint16_t                res_len,
+   const uint8_t           *p_bytes,
+   uint16_t                pos)
+{
+   uint16_t                ix;
+   pf_ident_cache_entry_t  *p_entry = NULL;
+
+   if ((pos < res_len) && ((pos - start_pos) <= PF_IDENT_CACHE_DATA_SIZE))
+   {
+      /* Prefer to replace an outdated response to the same request */
+      for (ix = 0; ix < NELEMENTS(p_device->ident_cache); ix++)
+      {
+         if ((p_device->ident_cache[ix].valid == true) &&
+             (pf_ident_cache_key_equal(&p_device->ident_cache[ix].key, p_key) == true))
+         {
+            p_entry = &p_device->ident_cache[ix];
+            break;
          }
       }
+      if (p_entry == NULL)
+      {
+         p_entry = &p_device->ident_cache[p_device->ident_cache_next];
+         p_device->ident_cache_next = (p_device->ident_cache_next + 1) % NELEMENTS(p_device->ident_cache);
+      }
+
+      memcpy(&p_entry->key, p_key, sizeof(p_entry->key));
+      p_entry->generation = generation;
+      p_entry->len = pos - start_pos;
+      memcpy(p_entry->data, &p_bytes[start_pos], p_entry->len);
+      p_entry->valid = true;
    }
 }
 
@@ -1500,34 +1575,48 @@ void pf_put_ident_data(
    uint16_t                *p_pos)
 {
    uint16_t                block_pos;
-   uint16_t                block_len = 0;
    uint16_t                data_pos;
+   uint32_t                generation;
    pf_device_t             *p_device = NULL;
+   pf_ident_cache_key_t    key;
 
-   block_pos = *p_pos;
-   pf_put_block_header(is_big_endian,
-      block_type, 0,                  /* Dont know block_len yet */
-      PNET_BLOCK_VERSION_HIGH, block_version_low,
-      res_len, p_bytes, p_pos);
+   (void)pf_cmdev_get_device(net, &p_device);
 
-   data_pos = *p_pos;
-   if (pf_cmdev_get_device(net, &p_device) == 0)
+   memset(&key, 0, sizeof(key));
+   key.p_ar = p_ar;
+   key.api_id = api_id;
+   key.slot_nbr = slot_nbr;
+   key.subslot_nbr = subslot_nbr;
+   key.block_type = block_type;
+   key.block_version_low = block_version_low;
+   key.filter_level = filter_level;
+   key.stop_level = stop_level;
+   key.is_big_endian = is_big_endian;
+
+   if (pf_ident_cache_get(p_device, &key, res_len, p_bytes, p_pos) == false)
    {
+      generation = p_device->ident_generation;
+
+      block_pos = pf_put_block_begin(is_big_endian, block_type,
+         PNET_BLOCK_VERSION_HIGH, block_version_low,
+         res_len, p_bytes, p_pos);
+
+      data_pos = *p_pos;
       pf_put_ident_device(is_big_endian, block_type, filter_level, stop_level,
          p_ar, p_device, api_id, slot_nbr, subslot_nbr, res_len, p_bytes, p_pos);
-   }
 
-   if (data_pos < *p_pos)
-   {
-      /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
-   }
-   else
-   {
-      /* Nothing was inserted!! Report a NULL record */
-      *p_pos = block_pos;
+      if (data_pos < *p_pos)
+      {
+         /* Finally insert the block length into the block header */
+         pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+      }
+      else
+      {
+         /* Nothing was inserted!! Report a NULL record */
+         *p_pos = block_pos;
+      }
+
+      pf_ident_cache_put(p_device, &key, generation, block_pos, res_len, p_bytes, *p_pos);
    }
 }
 
@@ -1538,51 +1627,58 @@ void pf_put_im_0_filter_data(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                start_pos;
+   uint16_t                block_pos = 0;
+   uint32_t                generation;
    pf_device_t             *p_device = NULL;
+   pf_ident_cache_key_t    key;
 
-   /* Insert block header for the read operation */
-   block_pos = *p_pos;
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_0_FILTER_DATA_SUBMODULE, 0,    /* Dont know block_len yet */
-      PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
-      res_len, p_bytes, p_pos);
+   (void)pf_cmdev_get_device(net, &p_device);
 
-   pf_cmdev_get_device(net, &p_device);
-   /*
-    * ToDo: Walk the device tree:
-    * If we encounter a sub-slot that contains I&M data then add it here.
-    */
-   pf_put_ident_device(is_big_endian, PF_BT_REAL_IDENTIFICATION_DATA,
-      PF_DEV_FILTER_LEVEL_SUBSLOT, PF_DEV_FILTER_LEVEL_SUBSLOT,
-      NULL, p_device,
-      0, 0, 1,
-      res_len, p_bytes, p_pos);
+   memset(&key, 0, sizeof(key));
+   key.block_type = PF_BT_IM_0_FILTER_DATA_SUBMODULE;
+   key.is_big_endian = is_big_endian;
 
-   /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   if (pf_ident_cache_get(p_device, &key, res_len, p_bytes, p_pos) == false)
+   {
+      generation = p_device->ident_generation;
+      start_pos = *p_pos;
 
-   /* I&M0FilterDataDevice - insert only the first submodule of the DAP. */
-   block_pos = *p_pos;
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_0_FILTER_DATA_DEVICE, 0,   /* Dont know block_len yet */
-      PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
-      res_len, p_bytes, p_pos);
+      /* Insert block header for the read operation */
+      block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_0_FILTER_DATA_SUBMODULE,
+         PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
+         res_len, p_bytes, p_pos);
 
-   /* ToDo: Find the DAP and then insert it. */
-   pf_put_ident_device(is_big_endian, PF_BT_REAL_IDENTIFICATION_DATA,
-      PF_DEV_FILTER_LEVEL_SUBSLOT, PF_DEV_FILTER_LEVEL_SUBSLOT,
-      NULL, p_device,
-      0, 0, 1,
-      res_len, p_bytes, p_pos);
+      /*
+       * ToDo: Walk the device tree:
+       * If we encounter a sub-slot that contains I&M data then add it here.
+       */
+      pf_put_ident_device(is_big_endian, PF_BT_REAL_IDENTIFICATION_DATA,
+         PF_DEV_FILTER_LEVEL_SUBSLOT, PF_DEV_FILTER_LEVEL_SUBSLOT,
+         NULL, p_device,
+         0, 0, 1,
+         res_len, p_bytes, p_pos);
 
-   /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      /* Finally insert the block length into the block header */
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+
+      /* I&M0FilterDataDevice - insert only the first submodule of the DAP. */
+      block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_0_FILTER_DATA_DEVICE,
+         PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
+         res_len, p_bytes, p_pos);
+
+      /* ToDo: Find the DAP and then insert it. */
+      pf_put_ident_device(is_big_endian, PF_BT_REAL_IDENTIFICATION_DATA,
+         PF_DEV_FILTER_LEVEL_SUBSLOT, PF_DEV_FILTER_LEVEL_SUBSLOT,
+         NULL, p_device,
+         0, 0, 1,
+         res_len, p_bytes, p_pos);
+
+      /* Finally insert the block length into the block header */
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+
+      pf_ident_cache_put(p_device, &key, generation, start_pos, res_len, p_bytes, *p_pos);
+   }
 }
 
 void pf_put_im_0(
@@ -1592,12 +1688,10 @@ void pf_put_im_0(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_0, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_0,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1618,9 +1712,7 @@ void pf_put_im_0(
    pf_put_uint16(is_big_endian, p_im_0->im_supported, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_im_1(
@@ -1630,12 +1722,10 @@ void pf_put_im_1(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_1, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_1,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1643,9 +1733,7 @@ void pf_put_im_1(
    pf_put_str(p_im_1->im_tag_location, sizeof(p_im_1->im_tag_location), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_im_2(
@@ -1655,21 +1743,17 @@ void pf_put_im_2(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_2, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_2,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_str(p_im_2, sizeof(pnet_im_2_t), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_im_3(
@@ -1679,21 +1763,17 @@ void pf_put_im_3(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_IM_3, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_IM_3,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_str(p_im_3, sizeof(pnet_im_3_t), res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_record_data_write(
@@ -1705,21 +1785,17 @@ void pf_put_record_data_write(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
 
    /* Insert block header for the read operation */
-   pf_put_block_header(is_big_endian,
-      block_type, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, block_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
    pf_put_mem(p_raw_data, raw_length, res_len, p_bytes, p_pos);
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_write_result(
@@ -1729,13 +1805,11 @@ void pf_put_write_result(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
    uint16_t ix;
 
    /* Insert block header for the write operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_WRITE_RES, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_WRITE_RES,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1757,9 +1831,7 @@ void pf_put_write_result(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 
    if (*p_pos >= res_len)
    {
@@ -1774,14 +1846,12 @@ void pf_put_log_book_data(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
-   uint16_t block_len = 0;
+   uint16_t block_pos = 0;
    uint16_t ix;
    uint16_t cnt = 0;
 
    /* Insert block header for the write operation */
-   pf_put_block_header(is_big_endian,
-      PF_BT_LOG_BOOK_DATA, 0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_LOG_BOOK_DATA,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -1818,9 +1888,7 @@ void pf_put_log_book_data(
    }
 
    /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 /**
@@ -2143,14 +2211,12 @@ void pf_put_diag_data(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
    uint16_t                data_pos;
    pf_device_t             *p_device = NULL;
 
    /* Insert block header for the output block */
-   pf_put_block_header(is_big_endian, PF_BT_DIAGNOSIS_DATA,
-      0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_DIAGNOSIS_DATA,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW_1,
       res_len, p_bytes, p_pos);
 
@@ -2166,9 +2232,7 @@ void pf_put_diag_data(
    /* Finally insert the block length into the block header */
    if (*p_pos > data_pos)
    {
-      block_len = *p_pos - (block_pos + 4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
    }
    else
    {
@@ -2219,7 +2283,7 @@ void pf_put_alarm_block(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t block_pos = *p_pos;
+   uint16_t block_pos = 0;
    uint16_t block_len = 0;
    uint32_t temp_u16;
    uint32_t temp_u32;
@@ -2233,8 +2297,7 @@ void pf_put_alarm_block(
    }
    
    /* Insert block header for the alarm block */
-   pf_put_block_header(is_big_endian, bh_type,
-      0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, bh_type,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2274,9 +2337,7 @@ void pf_put_alarm_block(
       {
          pf_put_uint16(is_big_endian, PF_USI_MAINTENANCE, res_len, p_bytes, p_pos);
 
-         block_pos_2 = *p_pos;
-         pf_put_block_header(is_big_endian, PF_BT_MAINTENANCE_ITEM,
-            0,                      /* Dont know block_len yet */
+         block_pos_2 = pf_put_block_begin(is_big_endian, PF_BT_MAINTENANCE_ITEM,
             PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
             res_len, p_bytes, p_pos);
 
@@ -2286,18 +2347,14 @@ void pf_put_alarm_block(
          pf_put_uint32(is_big_endian, maint_status, res_len, p_bytes, p_pos);
 
          /* Finally insert the block length into the block header */
-         block_len = *p_pos - (block_pos_2 + 4);
-         block_pos_2 += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-         pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos_2);
+         pf_put_block_end(is_big_endian, block_pos_2, res_len, p_bytes, *p_pos);
       }
 
       if(NULL != p_payload)
     	  pf_put_diag_item(is_big_endian, (pf_diag_item_t *)p_payload, res_len, p_bytes, p_pos);
       
       /* Finally insert the block length into the block header */
-      block_len = *p_pos - (block_pos+4);
-      block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-      pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
       return;
       
       break;
@@ -2330,12 +2387,10 @@ void pf_put_substitute_data(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
+   uint16_t                block_pos = 0;
 
    /* Now the substitution data - this is an inner block (ToDo: Make own function) */
-   pf_put_block_header(is_big_endian, PF_BT_SUBSTITUTE_VALUE,
-      0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_SUBSTITUTE_VALUE,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
@@ -2345,94 +2400,180 @@ void pf_put_substitute_data(
    pf_put_mem(p_iops, iops_len, res_len, p_bytes, p_pos);
 
    /* Insert the block length into the substitution data block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+}
+
+/**
+ * @internal
+ * Return the number of bytes left in a buffer, limited to a maximum.
+ * @param max_len          In:   The maximum number of bytes needed.
+ * @param res_len          In:   Size of destination buffer.
+ * @param pos              In:   Position in destination buffer.
+ * @return  The number of bytes that may be written at pos.
+ */
+static uint16_t pf_put_room(
+   uint16_t                max_len,
+   uint16_t                res_len,
+   uint16_t                pos)
+{
+   uint16_t                room = 0;
+
+   if (pos < res_len)
+   {
+      room = res_len - pos;
+   }
+
+   return (room < max_len) ? room : max_len;
 }
 
 void pf_put_output_data(
+   pnet_t                  *net,
    bool                    is_big_endian,
-   bool                    sub_active,
-   uint8_t                 iocs_len,
-   uint8_t                 *p_iocs,
-   uint8_t                 iops_len,
-   uint8_t                 *p_iops,
-   uint16_t                data_len,
-   uint8_t                 *p_data,
-   uint16_t                sub_mode,
-   const uint8_t           *p_sub_data,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
    uint16_t                res_len,
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
-   uint16_t                substitute_active_flag = sub_active ? 1 : 0;
+   uint16_t                block_pos;
+   uint16_t                len_pos;
+   uint16_t                iocs_pos;
+   uint16_t                data_pos;
+   uint16_t                data_len = 0;
+   uint16_t                sub_len;
+   uint8_t                 iocs_len = 0;
+   uint8_t                 iops_len = 0;
+   bool                    new_flag = false;
 
    /* Insert block header for the output block */
-   pf_put_block_header(is_big_endian, PF_BT_RECORD_OUTPUT_DATA_OBJECT,
-      0,                      /* Dont know block_len yet */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_RECORD_OUTPUT_DATA_OBJECT,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
-   pf_put_uint16(is_big_endian, substitute_active_flag, res_len, p_bytes, p_pos);
+   /* SubstituteActiveFlag. The output data is always the received data. */
+   pf_put_uint16(is_big_endian, 0, res_len, p_bytes, p_pos);
 
-   pf_put_byte(iocs_len, res_len, p_bytes, p_pos);
-   pf_put_byte(iops_len, res_len, p_bytes, p_pos);
-   pf_put_uint16(is_big_endian, data_len, res_len, p_bytes, p_pos);
+   /* The lengths are inserted when the IOCS, data and IOPS are in place */
+   len_pos = *p_pos;
+   pf_put_uint32(is_big_endian, 0, res_len, p_bytes, p_pos);
 
-   pf_put_mem(p_iocs, iocs_len, res_len, p_bytes, p_pos);
-   pf_put_mem(p_data, data_len, res_len, p_bytes, p_pos);
-   pf_put_mem(p_iops, iops_len, res_len, p_bytes, p_pos);
+   /* The IOCS, data and IOPS are copied directly into the buffer */
+   iocs_pos = *p_pos;
+   iocs_len = (uint8_t)pf_put_room(UINT8_MAX, res_len, iocs_pos);
+   if (pf_ppm_get_iocs(net, api_id, slot_nbr, subslot_nbr, &p_bytes[iocs_pos], &iocs_len) != 0)
+   {
+      LOG_DEBUG(PNET_LOG, "BW(%d): Could not get PPM IOCS\n", __LINE__);
+      iocs_len = 0;
+   }
 
-   /* -------------- */
-   if (p_sub_data != NULL)
+   data_pos = iocs_pos + iocs_len;
+   if (pf_cpm_get_data_and_iops_len(net, api_id, slot_nbr, subslot_nbr, &data_len, &iops_len) != 0)
    {
-      pf_put_substitute_data(is_big_endian, sub_mode, iocs_len, p_iocs, iops_len, p_iops,
-         data_len, p_sub_data, res_len, p_bytes, p_pos);
+      data_len = 0;
+      iops_len = 0;
    }
-   /* -------------- */
 
-   /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+   /* The rest of the block: The data and IOPS, and the SubstituteValue block with all three again */
+   sub_len = sizeof(pf_block_header_t) + sizeof(uint16_t) + iocs_len + data_len + iops_len;
+   if (pf_put_room(UINT16_MAX, res_len, data_pos) < data_len + iops_len + sub_len)
+   {
+      LOG_ERROR(PNET_LOG, "BW(%d): No room for output data of slot %u subslot 0x%04x\n", __LINE__,
+         (unsigned)slot_nbr, (unsigned)subslot_nbr);
+      iocs_len = 0;
+      data_len = 0;
+      iops_len = 0;
+   }
+   else if (pf_cpm_get_data_and_iops(net, api_id, slot_nbr, subslot_nbr,
+               &new_flag, &p_bytes[data_pos], &data_len, &p_bytes[data_pos + data_len], &iops_len) != 0)
+   {
+      LOG_DEBUG(PNET_LOG, "BW(%d): Could not get CPM data and IOPS\n", __LINE__);
+      data_len = 0;
+      iops_len = 0;
+   }
+
+   if ((data_len + iops_len + iocs_len) > 0)
+   {
+      *p_pos = data_pos + data_len + iops_len;
+
+      pf_put_byte(iocs_len, res_len, p_bytes, &len_pos);
+      pf_put_byte(iops_len, res_len, p_bytes, &len_pos);
+      pf_put_uint16(is_big_endian, data_len, res_len, p_bytes, &len_pos);
+
+      /* The substitution values are (for now) the same as the output data */
+      pf_put_substitute_data(is_big_endian, 0, iocs_len, &p_bytes[iocs_pos], iops_len, &p_bytes[data_pos + data_len],
+         data_len, &p_bytes[data_pos], res_len, p_bytes, p_pos);
+
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+   }
+   else
+   {
+      /* Nothing to report */
+      *p_pos = block_pos;
+   }
 }
 
 void pf_put_input_data(
+   pnet_t                  *net,
    bool                    is_big_endian,
-   uint8_t                 iocs_len,
-   uint8_t                 *p_iocs,
-   uint8_t                 iops_len,
-   uint8_t                 *p_iops,
-   uint16_t                data_len,
-   uint8_t                 *p_data,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
    uint16_t                res_len,
    uint8_t                 *p_bytes,
    uint16_t                *p_pos)
 {
-   uint16_t                block_pos = *p_pos;
-   uint16_t                block_len = 0;
-
-   /* Insert block header for the output block */
-   pf_put_block_header(is_big_endian, PF_BT_RECORD_INPUT_DATA_OBJECT,
-      0,                      /* Dont know block_len yet */
+   uint16_t                block_pos;
+   uint16_t                iocs_pos;
+   uint16_t                iops_pos;
+   uint16_t                data_len = 0;
+   uint8_t                 iocs_len = 0;
+   uint8_t                 iops_len = 0;
+
+   /* Insert block header for the input block */
+   block_pos = pf_put_block_begin(is_big_endian, PF_BT_RECORD_INPUT_DATA_OBJECT,
       PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
       res_len, p_bytes, p_pos);
 
-   pf_put_byte(iocs_len, res_len, p_bytes, p_pos);
-   pf_put_mem(p_iocs, iocs_len, res_len, p_bytes, p_pos);
+   /*
+    * The IOCS, IOPS and data are copied directly into the buffer.
+    * Each is preceded by its length, which is inserted when known.
+    */
+   iocs_pos = *p_pos + 1;
+   iocs_len = (uint8_t)pf_put_room(UINT8_MAX, res_len, iocs_pos);
+   if (pf_cpm_get_iocs(net, api_id, slot_nbr, subslot_nbr, &p_bytes[iocs_pos], &iocs_len) != 0)
+   {
+      LOG_DEBUG(PNET_LOG, "BW(%d): Could not get CPM IOCS\n", __LINE__);
+      iocs_len = 0;
+   }
 
-   pf_put_byte(iops_len, res_len, p_bytes, p_pos);
-   pf_put_mem(p_iops, iops_len, res_len, p_bytes, p_pos);
+   iops_pos = iocs_pos + iocs_len + 1;
+   if ((pf_ppm_get_data_and_iops_len(net, api_id, slot_nbr, subslot_nbr, &data_len, &iops_len) != 0) ||
+       (pf_put_room(iops_len + 2 + data_len, res_len, iops_pos) < iops_len + 2 + data_len) ||
+       (pf_ppm_get_data_and_iops(net, api_id, slot_nbr, subslot_nbr,
+          &p_bytes[iops_pos + iops_len + 2], &data_len, &p_bytes[iops_pos], &iops_len) != 0))
+   {
+      LOG_DEBUG(PNET_LOG, "BW(%d): Could not get PPM data and IOPS\n", __LINE__);
+      data_len = 0;
+      iops_len = 0;
+   }
 
-   pf_put_uint16(is_big_endian, data_len, res_len, p_bytes, p_pos);
-   pf_put_mem(p_data, data_len, res_len, p_bytes, p_pos);
+   if ((data_len + iops_len + iocs_len) > 0)
+   {
+      pf_put_byte(iocs_len, res_len, p_bytes, p_pos);
+      *p_pos += iocs_len;
+      pf_put_byte(iops_len, res_len, p_bytes, p_pos);
+      *p_pos += iops_len;
+      pf_put_uint16(is_big_endian, data_len, res_len, p_bytes, p_pos);
+      *p_pos += data_len;
 
-   /* Finally insert the block length into the block header */
-   block_len = *p_pos - (block_pos + 4);
-   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+      pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
+   }
+   else
+   {
+      /* Nothing to report */
+      *p_pos = block_pos;
+   }
 }
 
 void pf_put_pdport_data_check(
@@ -2443,8 +2584,7 @@ void pf_put_pdport_data_check(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
 	   uint8_t				numPeers = net->fspm_cfg.lldp_peer_req.TTL ? 1:0;
 	   
@@ -2452,8 +2592,7 @@ void pf_put_pdport_data_check(
 	   if(0 == numPeers)
 		   return;
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_PDPORTCHECK, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_PDPORTCHECK,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -2487,9 +2626,7 @@ void pf_put_pdport_data_check(
 	   pf_put_uint16(is_big_endian, temp_u16, res_len, p_bytes, p_pos);
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_portcheck(
@@ -2500,8 +2637,7 @@ void pf_put_portcheck(
 		uint8_t                 *p_bytes,
 		uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
 	   uint8_t				numPeers = net->fspm_cfg.lldp_peer_req.TTL ? 1:0;
 	   
@@ -2509,8 +2645,7 @@ void pf_put_portcheck(
 	   if(0 == numPeers)
 		   return;
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_PDPORTCHECK, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_PDPORTCHECK,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -2544,9 +2679,7 @@ void pf_put_portcheck(
 	   pf_put_uint16(is_big_endian, temp_u16, res_len, p_bytes, p_pos);
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_pdport_data_real(
@@ -2557,15 +2690,13 @@ void pf_put_pdport_data_real(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
 	   uint8_t				numPeers = net->fspm_cfg.lldp_peer_cfg.TTL ? 1:0;
 	   uint8_t				temp_u8	= 0;
 
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_PDPORTDATAREAL, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_PDPORTDATAREAL,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -2670,9 +2801,7 @@ void pf_put_pdport_data_real(
 	   }
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 
 }
 
@@ -2685,42 +2814,41 @@ void pf_put_pdport_statistics(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
+	   pnet_interface_stats_t stats;
+
+	   pf_stats_get(net, &stats);
 
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_PORT_STATISTICS, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_PORT_STATISTICS,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
 	   /* Two bytes padding */
 	   pf_put_uint16(is_big_endian, temp_u16, res_len, p_bytes, p_pos);
 	   
-	   /* ifInOctects */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifInOctects, res_len, p_bytes, p_pos);
+	   /* ifInOctets */
+	   pf_put_uint32(is_big_endian,stats.ifInOctets, res_len, p_bytes, p_pos);
 	   
-	   /* ifOutOctects */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifOutOctects, res_len, p_bytes, p_pos);
+	   /* ifOutOctets */
+	   pf_put_uint32(is_big_endian,stats.ifOutOctets, res_len, p_bytes, p_pos);
 	   
 	   /* ifInDiscards */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifInDiscards, res_len, p_bytes, p_pos);
+	   pf_put_uint32(is_big_endian,stats.ifInDiscards, res_len, p_bytes, p_pos);
 	   
 	   /* ifOutDiscards */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifOutDiscards, res_len, p_bytes, p_pos);
+	   pf_put_uint32(is_big_endian,stats.ifOutDiscards, res_len, p_bytes, p_pos);
 	   
 	   /* ifInErrors */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifInErrors, res_len, p_bytes, p_pos);
+	   pf_put_uint32(is_big_endian,stats.ifInErrors, res_len, p_bytes, p_pos);
 	   
 	   /* ifOutErrors */
-	   pf_put_uint32(is_big_endian,net->interface_statistics.ifOutErrors, res_len, p_bytes, p_pos);
+	   pf_put_uint32(is_big_endian,stats.ifOutErrors, res_len, p_bytes, p_pos);
 	   
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_pdinterface_data_real(
@@ -2731,13 +2859,11 @@ void pf_put_pdinterface_data_real(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
 	   
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_INTERFACE_REAL_DATA, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_INTERFACE_REAL_DATA,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -2779,9 +2905,7 @@ void pf_put_pdinterface_data_real(
 
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 static void pf_put_pd_multiblock_interface_and_statistics(
@@ -2792,13 +2916,11 @@ static void pf_put_pd_multiblock_interface_and_statistics(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t temp16 = 0;
 
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_MULTIPLEBLOCK_HEADER, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_MULTIPLEBLOCK_HEADER,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 	   /*2 byte padding*/
@@ -2817,9 +2939,7 @@ static void pf_put_pd_multiblock_interface_and_statistics(
 	   pf_put_pdport_statistics(net,is_big_endian,p_res,res_len,p_bytes,p_pos);
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 
 }
 
@@ -2831,13 +2951,11 @@ static void pf_put_pd_multiblock_port_and_statistics(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t temp16 = 0;
 	   
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_MULTIPLEBLOCK_HEADER, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_MULTIPLEBLOCK_HEADER,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -2857,9 +2975,7 @@ static void pf_put_pd_multiblock_port_and_statistics(
 	   pf_put_pdport_statistics(net,is_big_endian,p_res,res_len,p_bytes,p_pos);
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
 
 void pf_put_pd_real_data(
@@ -3104,8 +3220,7 @@ void pf_put_peer_to_peer_boundary(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-	   uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+	   uint16_t block_pos = 0;
 	   uint16_t             temp_u16 	= 0;
 	   uint32_t				temp_u32 = 0;
 
@@ -3118,8 +3233,7 @@ void pf_put_peer_to_peer_boundary(
 	   }
 	   
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_PEER_TO_PEER_BOUNDARY, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_PEER_TO_PEER_BOUNDARY,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 
@@ -3141,9 +3255,7 @@ void pf_put_peer_to_peer_boundary(
 	   pf_put_uint16(is_big_endian, temp_u16, res_len, p_bytes, p_pos);
 	   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 
 }
 
@@ -3156,8 +3268,7 @@ void pf_put_pdport_data_adj(
 	uint8_t                 *p_bytes,
 	uint16_t                *p_pos)
 {
-		uint16_t block_pos = *p_pos;
-	   uint16_t block_len = 0;
+		uint16_t block_pos = 0;
 	   uint16_t temp16 = 0;
 	   
 	   /*Check if this has been adjusted first*/
@@ -3169,8 +3280,7 @@ void pf_put_pdport_data_adj(
 	   }
 	   
 	   /* Block header first */
-	   pf_put_block_header(is_big_endian,
-			   PF_BT_BOUNDARY_ADJUST, 0,                      /* Dont know block_len yet */
+	   block_pos = pf_put_block_begin(is_big_endian, PF_BT_BOUNDARY_ADJUST,
 			   PNET_BLOCK_VERSION_HIGH, PNET_BLOCK_VERSION_LOW,
 			   res_len, p_bytes, p_pos);
 	
@@ -3189,7 +3299,5 @@ void pf_put_pdport_data_adj(
 	   pf_put_peer_to_peer_boundary(net,is_big_endian,p_res,res_len,p_bytes,p_pos);
   
 	   /* Finally insert the block length into the block header */
-	   block_len = *p_pos - (block_pos + 4);
-	   block_pos += offsetof(pf_block_header_t, block_length);   /* Point to correct place */
-	   pf_put_uint16(is_big_endian, block_len, res_len, p_bytes, &block_pos);
+	   pf_put_block_end(is_big_endian, block_pos, res_len, p_bytes, *p_pos);
 }
@@ -79,6 +79,48 @@ void pf_put_uint32(
    uint8_t                 *p_bytes,
    uint16_t                *p_pos);
 
+/**
+ * Open a block by inserting a block header with a dummy block length.
+ *
+ * The block contents are then written directly after the header, and the
+ * block is closed with \a pf_put_block_end(), which back-patches the length.
+ * Blocks may be nested: Each open block is identified only by the position
+ * returned here.
+ * @param is_big_endian    In:   Endianness of the destination buffer.
+ * @param bh_type          In:   Block type.
+ * @param bh_ver_high      In:   Block version high.
+ * @param bh_ver_low       In:   Block version low.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ * @return  The position of the block header, to be given to \a pf_put_block_end().
+ */
+uint16_t pf_put_block_begin(
+   bool                    is_big_endian,
+   pf_block_type_values_t  bh_type,
+   uint8_t                 bh_ver_high,
+   uint8_t                 bh_ver_low,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos);
+
+/**
+ * Close a block opened by \a pf_put_block_begin().
+ *
+ * Inserts the final block length into the block header.
+ * @param is_big_endian    In:   Endianness of the destination buffer.
+ * @param block_pos        In:   Position returned by \a pf_put_block_begin().
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param pos              In:   Position in destination buffer after the block contents.
+ */
+void pf_put_block_end(
+   bool                    is_big_endian,
+   uint16_t                block_pos,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                pos);
+
 /**
  * Insert an AR result block into a buffer.
  * @param is_big_endian    In:   Endianness of the destination buffer.
@@ -524,36 +566,27 @@ void pf_put_substitute_data(
 /**
  * Insert a RecordOutputDataObjectElement block into a buffer.
  *
- * This block inserts a complete RecordOutputDataObjectElement block into a buffer.
- * It includes the substitution data block if p_sub_data != NULL.
- * The IOCS and IOPS of the substitution data value is the same as the ordinary IOCS and IOPS.
- * The length of the substitution data is the same as data_len.
+ * This block inserts a complete RecordOutputDataObjectElement block into a buffer,
+ * including the substitution data block.
+ * The IOCS, output data and IOPS of the sub-slot are copied directly into
+ * the buffer. The substitution values are the same as the output data.
+ * Nothing is inserted if there is neither IOCS, data nor IOPS.
  *
+ * @param net              InOut: The p-net stack instance
  * @param is_big_endian    In:   Endianness of the destination buffer.
- * @param sub_active       In:   true if the substitution data are used.
- * @param iocs_len         In:   Length of IOCS data.
- * @param p_iocs           In:   The IOCS data.
- * @param iops_len         In:   Length of IOPS data.
- * @param p_iops           In:   IOPS data.
- * @param data_len         In:   Length of output data.
- * @param p_data           In:   Output data.
- * @param sub_mode         In:   The substitution mode.
- * @param p_sub_data       In:   The substitution data.
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
  * @param res_len          In:   Size of destination buffer.
  * @param p_bytes          Out:  Destination buffer.
  * @param p_pos            InOut:Position in destination buffer.
  */
 void pf_put_output_data(
+   pnet_t                  *net,
    bool                    is_big_endian,
-   bool                    sub_active,
-   uint8_t                 iocs_len,
-   uint8_t                 *p_iocs,
-   uint8_t                 iops_len,
-   uint8_t                 *p_iops,
-   uint16_t                data_len,
-   uint8_t                 *p_data,
-   uint16_t                sub_mode,
-   const uint8_t           *p_sub_data,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
    uint16_t                res_len,
    uint8_t                 *p_bytes,
    uint16_t                *p_pos);
@@ -562,26 +595,25 @@ void pf_put_output_data(
  * Insert a RecordInputDataObjectElement block into a buffer.
  *
  * This block inserts a complete RecordInputDataObjectElement block into a buffer.
+ * The IOCS, input data and IOPS of the sub-slot are copied directly into
+ * the buffer.
+ * Nothing is inserted if there is neither IOCS, data nor IOPS.
  *
+ * @param net              InOut: The p-net stack instance
  * @param is_big_endian    In:   Endianness of the destination buffer.
- * @param iocs_len         In:   Length of IOCS data.
- * @param p_iocs           In:   The IOCS data.
- * @param iops_len         In:   Length of IOPS data.
- * @param p_iops           In:   IOPS data.
- * @param data_len         In:   Length of output data.
- * @param p_data           In:   Output data.
+ * @param api_id           In:   The API id.
+ * @param slot_nbr         In:   The slot number.
+ * @param subslot_nbr      In:   The sub-slot number.
  * @param res_len          In:   Size of destination buffer.
  * @param p_bytes          Out:  Destination buffer.
  * @param p_pos            InOut:Position in destination buffer.
  */
 void pf_put_input_data(
+   pnet_t                  *net,
    bool                    is_big_endian,
-   uint8_t                 iocs_len,
-   uint8_t                 *p_iocs,
-   uint8_t                 iops_len,
-   uint8_t                 *p_iops,
-   uint16_t                data_len,
-   uint8_t                 *p_data,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
    uint16_t                res_len,
    uint8_t                 *p_bytes,
    uint16_t                *p_pos);
@@ -125,6 +125,12 @@ int pf_cmdev_get_device(
    return 0;
 }
 
+void pf_cmdev_ident_changed(
+   pnet_t                  *net)
+{
+   net->cmdev_device.ident_generation++;
+}
+
 int pf_cmdev_get_api(
    pnet_t                  *net,
    uint32_t                api_id,
@@ -566,6 +572,8 @@ int pf_cmdev_plug_module(
       ret = 0;
    }
 
+   pf_cmdev_ident_changed(net);
+
    return ret;
 }
 
@@ -600,6 +608,8 @@ int pf_cmdev_pull_submodule(
       ret = pf_alarm_send_pull(net, p_subslot->p_ar, api_id, slot_nbr, subslot_nbr);
    }
 
+   pf_cmdev_ident_changed(net);
+
    return ret;
 }
 
@@ -713,6 +723,8 @@ int pf_cmdev_plug_submodule(
       LOG_ERROR(PNET_LOG, "CMDEV(%d): Out of subslot resources for api %u slot %u\n", __LINE__, (unsigned)api_id, (unsigned)slot_nbr);
    }
 
+   pf_cmdev_ident_changed(net);
+
    return ret;
 }
 
@@ -760,18 +772,15 @@ int pf_cmdev_pull_module(
       }
    }
 
+   pf_cmdev_ident_changed(net);
+
    return ret;
 }
 
-/**
- * @internal
- * Remove all entries that refer to the AR.
- * @param net              InOut: The p-net stack instance
- * @param p_ar             In:   The AR entries to remove.
- */
-static void pf_device_clear(
+void pf_cmdev_set_owner(
    pnet_t                  *net,
-   pf_ar_t                 *p_ar)
+   pf_ar_t                 *p_ar,
+   pf_ar_t                 *p_new_ar)
 {
    uint16_t                api_ix;
    uint16_t                slot_ix;
@@ -785,19 +794,21 @@ static void pf_device_clear(
          {
             if (net->cmdev_device.apis[api_ix].slots[slot_ix].subslots[sub_ix].p_ar == p_ar)
             {
-               net->cmdev_device.apis[api_ix].slots[slot_ix].subslots[sub_ix].p_ar = NULL;
+               net->cmdev_device.apis[api_ix].slots[slot_ix].subslots[sub_ix].p_ar = p_new_ar;
             }
          }
          if (net->cmdev_device.apis[api_ix].slots[slot_ix].p_ar == p_ar)
          {
-            net->cmdev_device.apis[api_ix].slots[slot_ix].p_ar = NULL;
+            net->cmdev_device.apis[api_ix].slots[slot_ix].p_ar = p_new_ar;
          }
       }
       if (net->cmdev_device.apis[api_ix].p_ar == p_ar)
       {
-         net->cmdev_device.apis[api_ix].p_ar = NULL;
+         net->cmdev_device.apis[api_ix].p_ar = p_new_ar;
       }
    }
+
+   pf_cmdev_ident_changed(net);
 }
 
 /*************** Diagnostic strings ****************************************/
@@ -1012,7 +1023,7 @@ void pf_cmdev_exit(
 {
    if (net->cmdev_initialized == true)
    {
-      (void)pf_diag_exit();
+      (void)pf_diag_exit(net);
       os_mutex_destroy(net->cmdev_device.diag_mutex);
       memset(&net->cmdev_device, 0, sizeof(net->cmdev_device));
       net->cmdev_initialized = false;
@@ -1085,7 +1096,10 @@ static int pf_cmdev_set_state(
       pf_cmdev_state_ind(net, p_ar, PNET_EVENT_ABORT);
       LOG_DEBUG(PNET_LOG, "CMDEV(%d): New state: %s\n", __LINE__, pf_cmdev_state_to_string(PF_CMDEV_STATE_W_CIND));
 
-      pf_device_clear(net, p_ar);
+#if PNET_OPTION_SR
+      pf_cmsr_ar_abort(net, p_ar);
+#endif
+      pf_cmdev_set_owner(net, p_ar, NULL);
       break;
    default:
       /* Nothing (yet) */
@@ -1113,6 +1127,14 @@ int pf_cmdev_state_ind(
       pf_cmsm_cmdev_state_ind(net, p_ar, state);
       pf_cmpbe_cmdev_state_ind(p_ar, state);
       pf_cmrpc_cmdev_state_ind(net, p_ar, state);
+
+      if ((state == PNET_EVENT_PRMEND) && (net->fspm_cfg.rt_startup == true))
+      {
+         /* Everything needed for data exchange is allocated by now */
+         __atomic_store_n(&net->rt_alloc_count_prmend, os_alloc_count(), __ATOMIC_RELAXED);
+         __atomic_store_n(&net->rt_alloc_reported, false, __ATOMIC_RELAXED);
+         __atomic_store_n(&net->rt_prmend_seen, true, __ATOMIC_RELEASE);
+      }
    }
    else
    {
@@ -1324,7 +1346,8 @@ int pf_cmdev_check_visible_string(
  * @internal
  * Check if the Specified AR type is supported.
  *
- * ToDo: Currently only IOCAR_SINGLE and PF_ART_IOSAR is supported.
+ * ToDo: Currently only IOCAR_SINGLE, PF_ART_IOSAR and (with PNET_OPTION_SR)
+ * IOCAR_SR are supported.
  * @param ar_type          In:   The AR type to check.
  * @return  0  if the AR type is supported.
  *          -1 if the AR type is not supported.
@@ -1339,6 +1362,12 @@ int pf_cmdev_check_ar_type(
    {
       ret = 0;
    }
+#if PNET_OPTION_SR
+   else if (ar_type == PF_ART_IOCAR_SR)
+   {
+      ret = 0;
+   }
+#endif
 
    return ret;
 }
@@ -1395,6 +1424,19 @@ static int pf_cmdev_check_ar_param(
       pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_AR_BLOCK_REQ, 9);
       ret = -1;
    }
+#if PNET_OPTION_SR
+   else if ((p_ar->ar_param.ar_type == PF_ART_IOCAR_SR) && (p_ar->sr_info.valid == false))
+   {
+      /* An SR AR must have an SRInfoBlock */
+      pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_AR_BLOCK_REQ, 4);
+      ret = -1;
+   }
+   else if ((p_ar->sr_info.valid == true) && (p_ar->sr_info.redundancy_data_hold_factor == 0))
+   {
+      pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_SR_INFO, 4);
+      ret = -1;
+   }
+#endif
    else if (p_ar->ar_param.ar_properties.companion_ar == 3)
    {
       pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_AR_BLOCK_REQ, 9);
@@ -2967,7 +3009,11 @@ static int pf_cmdev_exp_apis_configure(
             if ((pf_cmdev_get_api(net, p_exp_api->api, &p_cfg_api) == 0) ||
                 (pf_cmdev_new_api(net, p_exp_api->api, &p_cfg_api) == 0))
             {
-               p_cfg_api->p_ar = p_ar;
+               /* The backup ARs of an AR set leave the submodules to the primary AR */
+               if ((p_cfg_api->p_ar == NULL) || (p_ar->ar_state != PF_AR_STATE_BACKUP))
+               {
+                  p_cfg_api->p_ar = p_ar;
+               }
 
                ret = pf_cmdev_exp_modules_configure(net, p_exp_api, p_cfg_api, p_stat);
                p_exp_api->valid = (ret == 0);
@@ -2976,6 +3022,8 @@ static int pf_cmdev_exp_apis_configure(
       }
    }
 
+   pf_cmdev_ident_changed(net);
+
    return ret;
 }
 
@@ -3086,6 +3134,72 @@ static int pf_cmdev_check_ar_rpc(
    return ret;
 }
 
+#if PNET_OPTION_IR
+/**
+ * @internal
+ * Check the IR info block for errors.
+ *
+ * Each subframe must belong to an IOCR of the AR, and fit in its C-SDU
+ * after the SFCRC16 of the packed frame.
+ *
+ * @param p_ar             In:   The AR instance.
+ * @param p_stat           Out:  Detailed error information.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+static int pf_cmdev_check_ir_info(
+   pf_ar_t                 *p_ar,
+   pnet_result_t           *p_stat)
+{
+   int                     ret = 0;    /* OK until we discover an error. */
+   uint16_t                ix;
+   uint16_t                cr_ix;
+   const pf_dfp_iocr_t     *p_dfp;
+   const pf_iocr_t         *p_iocr;
+
+   if (p_ar->ir_info.nbr_iocrs > NELEMENTS(p_ar->ir_info.dfp_iocrs))
+   {
+      pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IR_INFO, 7);
+      ret = -1;
+   }
+
+   ix = 0;
+   while ((ret == 0) && (ix < p_ar->ir_info.nbr_iocrs))
+   {
+      p_dfp = &p_ar->ir_info.dfp_iocrs[ix];
+      p_iocr = NULL;
+      for (cr_ix = 0; cr_ix < p_ar->nbr_iocrs; cr_ix++)
+      {
+         if (p_ar->iocrs[cr_ix].param.iocr_reference == p_dfp->iocr_reference)
+         {
+            p_iocr = &p_ar->iocrs[cr_ix];
+         }
+      }
+
+      if (p_iocr == NULL)
+      {
+         pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IR_INFO, 8);
+         ret = -1;
+      }
+      else if ((p_dfp->subframe_offset < PF_DFP_HEADER_SIZE) ||
+               ((uint32_t)p_dfp->subframe_offset + PF_DFP_SUBFRAME_HEADER_SIZE +
+                p_dfp->subframe_data.subframe_length + PF_DFP_SUBFRAME_CRC_SIZE > p_iocr->param.c_sdu_length))
+      {
+         pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IR_INFO, 9);
+         ret = -1;
+      }
+      else if (p_dfp->subframe_data.subframe_position == 0)
+      {
+         pf_set_error(p_stat, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CONN_FAULTY_IR_INFO, 10);
+         ret = -1;
+      }
+      ix++;
+   }
+
+   return ret;
+}
+#endif
+
 /**
  * @internal
  * Check the AR for errors.
@@ -3094,6 +3208,9 @@ static int pf_cmdev_check_ar_rpc(
  *
  * Triggers the user call-back \a pnet_exp_module_ind() and \a pnet_exp_submodule_ind().
  *
+ * If the request is in the fast-startup cache, the IOCR layouts are
+ * restored from it instead of being checked and built again.
+ *
  * @param net              InOut: The p-net stack instance
  * @param p_ar             In:   The AR instance.
  * @param p_stat           Out:  Detailed error information.
@@ -3108,6 +3225,18 @@ static int pf_cmdev_check_apdu(
    int                     ret = -1;
    uint16_t                ix;
 
+#if PNET_OPTION_FAST_STARTUP
+   if ((p_ar != NULL) && (p_ar->p_fsu_entry != NULL))
+   {
+      /* The same request has passed the checks before */
+      ret = pf_cmdev_exp_apis_configure(net, p_ar, p_stat);
+      if (ret == 0)
+      {
+         ret = pf_fsu_restore(p_ar->p_fsu_entry, p_ar);
+      }
+   }
+   else
+#endif
    if (p_ar != NULL)
    {
       if (p_ar->nbr_ar_param > 0)
@@ -3174,18 +3303,26 @@ static int pf_cmdev_check_apdu(
             ret = -1;
          }
       }
+   }
 
-      if ((ret == 0) && (p_ar->nbr_alarm_cr > 0))
-      {
-         ret = pf_cmdev_check_alarm_cr(p_ar, p_stat);
-      }
+   /* Also for a cached request, as these mark the blocks valid for the response */
+   if ((ret == 0) && (p_ar->nbr_alarm_cr > 0))
+   {
+      ret = pf_cmdev_check_alarm_cr(p_ar, p_stat);
+   }
 
-      if ((ret == 0) && (p_ar->nbr_rpc_server > 0))
-      {
-         ret = pf_cmdev_check_ar_rpc(p_ar, p_stat);
-      }
+   if ((ret == 0) && (p_ar->nbr_rpc_server > 0))
+   {
+      ret = pf_cmdev_check_ar_rpc(p_ar, p_stat);
    }
 
+#if PNET_OPTION_IR
+   if ((ret == 0) && (p_ar->nbr_ir_info > 0))
+   {
+      ret = pf_cmdev_check_ir_info(p_ar, p_stat);
+   }
+#endif
+
    return ret;
 }
 
@@ -3755,7 +3892,8 @@ int pf_cmdev_cm_ccontrol_req(
          if (data_avail == true)
          {
             pf_cmdev_state_ind(net, p_ar, PNET_EVENT_APPLRDY);
-            if (pf_cmrpc_rm_ccontrol_req(net, p_ar) == 0)
+            /* From pnet_application_ready(), in the thread of pnet_handle_periodic() */
+            if (pf_cmrpc_rm_ccontrol_req(net, p_ar, PF_STATS_CTX_PERIODIC) == 0)
             {
                ret = pf_cmdev_set_state(net, p_ar, PF_CMDEV_STATE_W_ARDYCNF);
             }
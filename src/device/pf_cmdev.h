@@ -180,6 +180,16 @@ int pf_cmdev_get_device(
    pnet_t                  *net,
    pf_device_t             **pp_device);
 
+/**
+ * Invalidate the cached identification and I&M0 filter responses.
+ *
+ * Call this whenever a module or sub-module is plugged or pulled, when the
+ * AR ownership of the device tree changes and when I&M data is written.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmdev_ident_changed(
+   pnet_t                  *net);
+
 /**
  * Get an API instance by its API id.
  * @param net              InOut: The p-net stack instance
@@ -210,6 +220,19 @@ int pf_cmdev_get_subslot_full(
    uint16_t                subslot_nbr,
    pf_subslot_t            **pp_subslot);
 
+/**
+ * Move all API, slot and sub-slot references from one AR to another.
+ *
+ * Used to remove the references to an aborted AR, and to hand over the
+ * submodules between the ARs of a system redundancy AR set.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR to remove.
+ * @param p_new_ar         In:   The new AR, or NULL.
+ */
+void pf_cmdev_set_owner(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   pf_ar_t                 *p_new_ar);
 
 /* Not used */
 /**
@@ -13,29 +13,269 @@
  * full license information.
  ********************************************************************/
 
+/**
+ * @file
+ * @brief Implements the Context Management Device Multicast protocol machine (CMDMC)
+ *
+ * The CMDMC component supervises the multicast consumer CRs of an AR.
+ * The data itself is received by the CPM, and a multicast provider CR is
+ * sent by the PPM to its multicast address.
+ *
+ * When the AR starts, the MCI timer of each multicast consumer CR is
+ * started. The first valid frame from the provider (CPM start indication)
+ * stops it. If the timer times out the AR is aborted.
+ *
+ * The provider is not resolved by its station name. Its frames are instead
+ * identified by the frame ID and multicast address of the CR.
+ *
+ * The CPM indications come from the thread receiving the frames, while the
+ * MCI timeout is run by the scheduler and the AR is started and closed by
+ * the RPC handling. The CMDMC state and timer of all CRs are protected by
+ * net->cmdmc_mutex.
+ */
+
 #ifdef UNIT_TEST
 
 #endif
 
 #include "pf_includes.h"
 
+static const char          *cmdmc_sync_name = "cmdmc";
+
+/**
+ * @internal
+ * Return a string representation of the CMDMC state.
+ * @param state            In:   The CMDMC state
+ * @return  A string representing the CMDMC state.
+ */
+static const char *pf_cmdmc_state_to_string(
+   pf_cmdmc_state_values_t state)
+{
+   const char              *s = "<unknown>";
+
+   switch (state)
+   {
+   case PF_CMDMC_STATE_IDLE:     s = "PF_CMDMC_STATE_IDLE"; break;
+   case PF_CMDMC_STATE_W_FRAME:  s = "PF_CMDMC_STATE_W_FRAME"; break;
+   case PF_CMDMC_STATE_RUN:      s = "PF_CMDMC_STATE_RUN"; break;
+   }
+
+   return s;
+}
+
+/**
+ * @internal
+ * Set the CMDMC state of an IOCR.
+ * @param p_iocr           InOut: The IOCR instance.
+ * @param state            In:   The new state.
+ */
+static void pf_cmdmc_set_state(
+   pf_iocr_t               *p_iocr,
+   pf_cmdmc_state_values_t state)
+{
+   if (state != p_iocr->cmdmc_state)
+   {
+      LOG_INFO(PNET_LOG, "CMDMC(%d): New state %s for CREP %u\n", __LINE__,
+         pf_cmdmc_state_to_string(state), (unsigned)p_iocr->crep);
+      p_iocr->cmdmc_state = state;
+   }
+}
+
+/**
+ * @internal
+ * Stop the MCI timer of an IOCR, if running.
+ * @param net              InOut: The p-net stack instance
+ * @param p_iocr           InOut: The IOCR instance.
+ */
+static void pf_cmdmc_stop_timer(
+   pnet_t                  *net,
+   pf_iocr_t               *p_iocr)
+{
+   if (p_iocr->cmdmc_timer != UINT32_MAX)
+   {
+      pf_scheduler_remove(net, cmdmc_sync_name, p_iocr->cmdmc_timer);
+      p_iocr->cmdmc_timer = UINT32_MAX;
+   }
+}
+
+/**
+ * @internal
+ * The MCI timer has expired before the first frame from the provider.
+ *
+ * This is a callback for the scheduler. Arguments should fulfill pf_scheduler_timeout_ftn_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   The IOCR instance.
+ * @param current_time     In:   The current time.
+ */
+static void pf_cmdmc_mci_timeout(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   pf_iocr_t               *p_iocr = (pf_iocr_t *)arg;
+   bool                    expired = false;
+
+   os_mutex_lock(net->cmdmc_mutex);
+   p_iocr->cmdmc_timer = UINT32_MAX;
+   if (p_iocr->cmdmc_state == PF_CMDMC_STATE_W_FRAME)
+   {
+      pf_cmdmc_set_state(p_iocr, PF_CMDMC_STATE_IDLE);
+      expired = true;
+   }
+   os_mutex_unlock(net->cmdmc_mutex);
+
+   /* Not under the mutex. The abort closes the CMDMC of the AR. */
+   if (expired == true)
+   {
+      LOG_ERROR(PNET_LOG, "CMDMC(%d): No frame from the provider of CREP %u\n", __LINE__, (unsigned)p_iocr->crep);
+      /* The provider of the MCR could not be found */
+      (void)pf_cmsu_cmdmc_error_ind(net, p_iocr->p_ar,
+         PNET_ERROR_CODE_1_RTA_ERR_CLS_PROTOCOL, PNET_ERROR_CODE_2_ABORT_AR_NAME_RESOLUTION_ERROR);
+   }
+}
+
+/**
+ * @internal
+ * Find the MCR request block of a multicast consumer CR.
+ * @param p_ar             In:   The AR instance.
+ * @param p_iocr           In:   The IOCR instance.
+ * @return  The MCR request, or NULL if not found.
+ */
+static const pf_multicast_cr_t *pf_cmdmc_find_mcr(
+   const pf_ar_t           *p_ar,
+   const pf_iocr_t         *p_iocr)
+{
+   const pf_multicast_cr_t *p_mcr = NULL;
+#if PNET_OPTION_MC_CR
+   uint16_t                ix;
+
+   for (ix = 0; (ix < p_ar->nbr_mcr) && (p_mcr == NULL); ix++)
+   {
+      if (p_ar->mcr_request[ix].iocr_reference == p_iocr->param.iocr_reference)
+      {
+         p_mcr = &p_ar->mcr_request[ix];
+      }
+   }
+#endif
+
+   return p_mcr;
+}
+
+void pf_cmdmc_init(
+   pnet_t                  *net)
+{
+   if (net->cmdmc_mutex == NULL)
+   {
+      net->cmdmc_mutex = os_mutex_create();
+   }
+}
+
+void pf_cmdmc_exit(
+   pnet_t                  *net)
+{
+   if (net->cmdmc_mutex != NULL)
+   {
+      os_mutex_destroy(net->cmdmc_mutex);
+      net->cmdmc_mutex = NULL;
+   }
+}
+
 int pf_cmdmc_activate_req(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar)
 {
-   return 0;
+   int                     ret = 0;
+   const pf_multicast_cr_t *p_mcr;
+   pf_iocr_t               *p_iocr;
+   uint32_t                crep;
+
+   os_mutex_lock(net->cmdmc_mutex);
+   for (crep = 0; crep < p_ar->nbr_iocrs; crep++)
+   {
+      p_iocr = &p_ar->iocrs[crep];
+      p_iocr->cmdmc_timer = UINT32_MAX;
+      p_iocr->cmdmc_state = PF_CMDMC_STATE_IDLE;
+      if ((ret == 0) && (p_iocr->param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER))
+      {
+         p_mcr = pf_cmdmc_find_mcr(p_ar, p_iocr);
+         if (p_mcr == NULL)
+         {
+            LOG_ERROR(PNET_LOG, "CMDMC(%d): No MCR block for CREP %u\n", __LINE__, (unsigned)crep);
+            ret = -1;
+         }
+         else
+         {
+            pf_cmdmc_set_state(p_iocr, PF_CMDMC_STATE_W_FRAME);
+            if ((p_mcr->mci_timeout_factor > 0) &&
+                (pf_scheduler_add(net, (uint32_t)p_mcr->mci_timeout_factor * 100 * 1000,   /* time in us */
+                   cmdmc_sync_name, pf_cmdmc_mci_timeout, p_iocr, &p_iocr->cmdmc_timer) != 0))
+            {
+               p_iocr->cmdmc_timer = UINT32_MAX;
+               ret = -1;
+            }
+         }
+      }
+   }
+   os_mutex_unlock(net->cmdmc_mutex);
+
+   return ret;
 }
 
 int pf_cmdmc_close_req(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar)
 {
+   uint32_t                crep;
+
+   os_mutex_lock(net->cmdmc_mutex);
+   for (crep = 0; crep < p_ar->nbr_iocrs; crep++)
+   {
+      if (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER)
+      {
+         pf_cmdmc_stop_timer(net, &p_ar->iocrs[crep]);
+         pf_cmdmc_set_state(&p_ar->iocrs[crep], PF_CMDMC_STATE_IDLE);
+      }
+   }
+   os_mutex_unlock(net->cmdmc_mutex);
+
    return 0;
 }
 
 int pf_cmdmc_cpm_state_ind(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar,
    uint16_t                ix,
    bool                    start)
 {
+   pf_iocr_t               *p_iocr;
+
+   if ((ix < p_ar->nbr_iocrs) &&
+       (p_ar->iocrs[ix].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER))
+   {
+      p_iocr = &p_ar->iocrs[ix];
+      os_mutex_lock(net->cmdmc_mutex);
+      switch (p_iocr->cmdmc_state)
+      {
+      case PF_CMDMC_STATE_W_FRAME:
+         if (start == true)
+         {
+            pf_cmdmc_stop_timer(net, p_iocr);
+            pf_cmdmc_set_state(p_iocr, PF_CMDMC_STATE_RUN);
+         }
+         break;
+      case PF_CMDMC_STATE_RUN:
+         if (start == false)
+         {
+            /* The CPM reports the error */
+            pf_cmdmc_set_state(p_iocr, PF_CMDMC_STATE_IDLE);
+         }
+         break;
+      case PF_CMDMC_STATE_IDLE:
+         break;
+      }
+      os_mutex_unlock(net->cmdmc_mutex);
+   }
+
    return 0;
 }
-
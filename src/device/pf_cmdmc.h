@@ -21,14 +21,53 @@ extern "C"
 {
 #endif
 
+/**
+ * Initialize the CMDMC component.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmdmc_init(
+   pnet_t                  *net);
 
+/**
+ * Free the resources of the CMDMC component.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmdmc_exit(
+   pnet_t                  *net);
+
+/**
+ * Start the supervision of the multicast consumer CRs of an AR.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
 int pf_cmdmc_activate_req(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar);
 
+/**
+ * Stop the supervision of the multicast consumer CRs of an AR.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ * @return  0  always.
+ */
 int pf_cmdmc_close_req(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar);
 
+/**
+ * Handle CPM start and stop indications.
+ * A start of a multicast consumer CR stops its MCI timer.
+ * May be called from the thread receiving the frames.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ * @param ix               In:   The IOCR index.
+ * @param start            In:   true when the CPM has received its first valid frame.
+ * @return  0  always.
+ */
 int pf_cmdmc_cpm_state_ind(
+   pnet_t                  *net,
    pf_ar_t                 *p_ar,
    uint16_t                ix,
    bool                    start);
@@ -36,6 +36,11 @@
 static const char             *hello_sync_name = "hello";
 static const char             *cmina_alarm_name = "cmina_alarm";
 
+/* Argument of pf_cmina_reset_job(). The reset mode is in the low 16 bits. */
+#define PF_CMINA_RESET_JOB_SAVE_IM        BIT(16)
+#define PF_CMINA_RESET_JOB_SAVE_PDEV      BIT(17)
+#define PF_CMINA_RESET_JOB_APPLICATION    BIT(18)
+
 
 /**
  * @internal
@@ -52,7 +57,7 @@ static const char             *cmina_alarm_name = "cmina_alarm";
 static void pf_cmina_send_hello(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    if ((net->cmina_state == PF_CMINA_STATE_W_CONNECT) &&
        (net->cmina_hello_count > 0))
@@ -90,12 +95,12 @@ static void pf_cmina_send_hello(
 static void pf_cmina_send_alarm(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
 	   pf_ar_t *p_ar = NULL;
 	   int ix = 0;
 	   
-       for (ix = 0; ix < PNET_MAX_AR; ix++)
+       for (ix = 0; ix < net->max_ar; ix++)
        {
           p_ar = pf_ar_find_by_index(net, ix);
           if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -107,6 +112,43 @@ static void pf_cmina_send_alarm(
 
        
 
+}
+
+/**
+ * @internal
+ * Save the data cleared by a reset, and tell the application.
+ *
+ * This is a job for the worker thread. Arguments should fulfill pf_worker_ftn_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   The reset mode and PF_CMINA_RESET_JOB_xxx flags.
+ */
+static void pf_cmina_reset_job(
+   pnet_t                  *net,
+   void                    *arg)
+{
+   uint32_t                job = (uint32_t)(uintptr_t)arg;
+   NVRAM_IM_SAVE           im;
+   pnet_lldp_peer_cfg_t    lldp_peer_req;
+
+   /* Copied by pf_cmina_set_default_cfg(), as fspm_cfg may change meanwhile */
+   os_mutex_lock(net->cmina_commit_mutex);
+   im = net->cmina_commit.im;
+   lldp_peer_req = net->cmina_commit.lldp_peer_req;
+   os_mutex_unlock(net->cmina_commit_mutex);
+
+   if ((job & PF_CMINA_RESET_JOB_SAVE_IM) != 0)
+   {
+      pf_fspm_nonvol_write(net, &im);
+   }
+   if ((job & PF_CMINA_RESET_JOB_SAVE_PDEV) != 0)
+   {
+      pf_cmwrr_save_records(net, &lldp_peer_req);
+   }
+
+   /* User callback */
+   (void) pf_fspm_reset_ind(net, (job & PF_CMINA_RESET_JOB_APPLICATION) != 0,
+      (uint16_t)(job & 0xffff));
 }
 
 /**
@@ -114,7 +156,8 @@ static void pf_cmina_send_alarm(
  * Reset the configuration to default values.
  *
  * Triggers the application callback \a pnet_reset_ind() for some \a reset_mode
- * values.
+ * values. The callback and the nonvolatile writes are done by the worker
+ * thread.
  *
  * Reset modes:
  *
@@ -136,6 +179,7 @@ int pf_cmina_set_default_cfg(
    const pnet_cfg_t        *p_cfg = NULL;
    uint16_t                ix;
    bool                    should_reset_user_application = false;
+   uint32_t                job = reset_mode;
 
    LOG_DEBUG(PF_DCP_LOG,"CMINA(%d): Setting default configuration. Reset mode: %u\n", __LINE__, reset_mode);
 
@@ -186,6 +230,7 @@ int pf_cmina_set_default_cfg(
       {
           /* Reset I&M data */
           ret = pf_fspm_clear_im_data(net);
+          job |= PF_CMINA_RESET_JOB_SAVE_IM;
       }
       
       if( (PNET_RESET_BIT_HIGH(reset_mode, pnet_reset_factory_reset))				||	/* Reset_To_Factory */
@@ -211,7 +256,7 @@ int pf_cmina_set_default_cfg(
     		  (PNET_RESET_BIT_HIGH(reset_mode, pnet_reset_communication_parameter)))	/* mode 2*/
       {
     	  memset(&net->fspm_cfg.lldp_peer_req, 0, sizeof(net->fspm_cfg.lldp_peer_req));
-    	  pf_cmwrr_update_records(net);
+    	  job |= PF_CMINA_RESET_JOB_SAVE_PDEV;
       }
       
 
@@ -229,8 +274,16 @@ int pf_cmina_set_default_cfg(
 
       if (reset_mode > 0)
       {
-         /* User callback */
-         (void) pf_fspm_reset_ind(net, should_reset_user_application, reset_mode);
+         /* Nonvolatile memory and user callback, by the worker thread */
+         if (should_reset_user_application == true)
+         {
+            job |= PF_CMINA_RESET_JOB_APPLICATION;
+         }
+         os_mutex_lock(net->cmina_commit_mutex);
+         pf_fspm_nonvol_get(net, &net->cmina_commit.im);
+         net->cmina_commit.lldp_peer_req = net->fspm_cfg.lldp_peer_req;
+         os_mutex_unlock(net->cmina_commit_mutex);
+         pf_worker_post(net, pf_cmina_reset_job, (void *)(uintptr_t)job);
       }
 
       net->cmina_perm_dcp_ase.standard_gw_value = 0;         /* Means: OwnIP is treated as no gateway */
@@ -258,26 +311,65 @@ int pf_cmina_set_default_cfg(
    return ret;
 }
 
-void pf_cmina_dcp_set_commit(
+/**
+ * @internal
+ * Copy the IP suite to set for pf_cmina_dcp_set_commit(), which is run by
+ * the worker thread while the RX thread may handle the next DCP set.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_cmina_commit_copy(
    pnet_t                  *net)
 {
    if (net->cmina_commit_ip_suite == true)
+   {
+      net->cmina_commit_ip_suite = false;
+
+      os_mutex_lock(net->cmina_commit_mutex);
+      net->cmina_commit.ip_suite_pending = true;
+      net->cmina_commit.dhcp_enable = net->cmina_temp_dcp_ase.dhcp_enable;
+      net->cmina_commit.ip_suite = net->cmina_temp_dcp_ase.full_ip_suite.ip_suite;
+      strcpy(net->cmina_commit.name_of_station, net->cmina_temp_dcp_ase.name_of_station);   /* It always fits */
+      net->cmina_commit.block_qualifier = net->dcp_global_block_qualifier;
+      os_mutex_unlock(net->cmina_commit_mutex);
+   }
+}
+
+void pf_cmina_dcp_set_commit(
+   pnet_t                  *net)
+{
+   bool                    pending;
+   bool                    dhcp_enable;
+   pf_ip_suite_t           ip_suite;
+   char                    name_of_station[sizeof(net->cmina_commit.name_of_station)];
+   uint16_t                block_qualifier;
+
+   /* Only the latest copy is set, if there were several DCP sets meanwhile */
+   os_mutex_lock(net->cmina_commit_mutex);
+   pending = net->cmina_commit.ip_suite_pending;
+   dhcp_enable = net->cmina_commit.dhcp_enable;
+   ip_suite = net->cmina_commit.ip_suite;
+   strcpy(name_of_station, net->cmina_commit.name_of_station);
+   block_qualifier = net->cmina_commit.block_qualifier;
+   net->cmina_commit.ip_suite_pending = false;
+   os_mutex_unlock(net->cmina_commit_mutex);
+
+   if (pending == true)
    {
       LOG_DEBUG(PF_DCP_LOG,"CMINA(%d): Setting IP address: %u.%u.%u.%u  Station name: %s\n",
          __LINE__,
-         (unsigned)((net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_addr >> 24) & 0xFF),
-         (unsigned)((net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_addr >> 16) & 0xFF),
-         (unsigned)((net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_addr >> 8) & 0xFF),
-         (unsigned)(net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_addr & 0xFF),
-         net->cmina_temp_dcp_ase.name_of_station);
-      net->cmina_commit_ip_suite = false;
+         (unsigned)((ip_suite.ip_addr >> 24) & 0xFF),
+         (unsigned)((ip_suite.ip_addr >> 16) & 0xFF),
+         (unsigned)((ip_suite.ip_addr >> 8) & 0xFF),
+         (unsigned)(ip_suite.ip_addr & 0xFF),
+         name_of_station);
       os_set_ip_suite(net->interface_name,
-    		  	  	  net->cmina_temp_dcp_ase.dhcp_enable,
-                      &net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_addr,
-                      &net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_mask,
-                      &net->cmina_temp_dcp_ase.full_ip_suite.ip_suite.ip_gateway,
-                      net->cmina_temp_dcp_ase.name_of_station,
-                      net->dcp_global_block_qualifier);
+    		  	  	  dhcp_enable,
+                      &ip_suite.ip_addr,
+                      &ip_suite.ip_mask,
+                      &ip_suite.ip_gateway,
+                      name_of_station,
+                      block_qualifier);
    }
 }
 
@@ -286,6 +378,12 @@ int pf_cmina_init(
 {
    int                     ret = 0;
 
+   if (net->cmina_commit_mutex == NULL)
+   {
+      net->cmina_commit_mutex = os_mutex_create();
+   }
+   memset(&net->cmina_commit, 0, sizeof(net->cmina_commit));
+
    net->cmina_hello_count = 0;
    net->cmina_hello_timeout = UINT32_MAX;
    net->cmina_error_decode = 0;
@@ -362,11 +460,22 @@ int pf_cmina_init(
    }
 
    /* Change IP address if necessary */
+   pf_cmina_commit_copy(net);
    pf_cmina_dcp_set_commit(net);
 
    return ret;
 }
 
+void pf_cmina_exit(
+   pnet_t                  *net)
+{
+   if (net->cmina_commit_mutex != NULL)
+   {
+      os_mutex_destroy(net->cmina_commit_mutex);
+      net->cmina_commit_mutex = NULL;
+   }
+}
+
 int pf_cmina_dcp_set_ind(
    pnet_t                  *net,
    uint8_t                 opt,
@@ -631,7 +740,7 @@ int pf_cmina_dcp_set_ind(
          {
              /* Any connection active ? */
              found = false;
-             for (ix = 0; ix < PNET_MAX_AR; ix++)
+             for (ix = 0; ix < net->max_ar; ix++)
              {
                 p_ar = pf_ar_find_by_index(net, ix);
                 if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -661,7 +770,7 @@ int pf_cmina_dcp_set_ind(
          {
              /* Any connection active ?? */
              found = false;
-             for (ix = 0; ix < PNET_MAX_AR; ix++)
+             for (ix = 0; ix < net->max_ar; ix++)
              {
                 p_ar = pf_ar_find_by_index(net, ix);
                 if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -694,7 +803,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -716,7 +825,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -741,7 +850,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ?? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -770,7 +879,7 @@ int pf_cmina_dcp_set_ind(
          {
             /* Any connection active ?? */
             found = false;
-            for (ix = 0; ix < PNET_MAX_AR; ix++)
+            for (ix = 0; ix < net->max_ar; ix++)
             {
                p_ar = pf_ar_find_by_index(net, ix);
                if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -815,6 +924,8 @@ int pf_cmina_dcp_set_ind(
 			   &net->cmina_timeout);
    }
 
+   /* For the commit after the response */
+   pf_cmina_commit_copy(net);
 
    return ret;
 }
@@ -33,6 +33,14 @@ extern "C"
 int pf_cmina_init(
    pnet_t                  *net);
 
+/**
+ * Free the resources of the CMINA component.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmina_exit(
+   pnet_t                  *net);
+
 /**
  * Show the CMINA status.
  * @param net              InOut: The p-net stack instance
@@ -111,7 +119,9 @@ int pf_cmina_set_default_cfg(
 /**
  * Commit changes to the IP-suite.
  *
- * This shall be done _after_ the answer to DCP set has been sent.
+ * This shall be done _after_ the answer to DCP set has been sent. Sets the
+ * IP suite copied at the end of the last pf_cmina_dcp_set_ind(), so it may
+ * run in another thread than the DCP set.
  * @param net              InOut: The p-net stack instance
  */
 void pf_cmina_dcp_set_commit(
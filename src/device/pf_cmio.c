@@ -98,7 +98,7 @@ static void pf_cmio_set_state(
 static void pf_cmio_timer_expired(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    pf_ar_t                 *p_ar = (pf_ar_t *)arg;
    uint16_t                crep;
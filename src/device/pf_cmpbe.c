@@ -244,7 +244,7 @@ int pf_cmpbe_cm_ccontrol_req(
       /* Control block is always APPLRDY here */
       if (pf_alarm_pending(p_ar) == false)
       {
-         ret = pf_cmrpc_rm_ccontrol_req(net, p_ar);
+         ret = pf_cmrpc_rm_ccontrol_req(net, p_ar, PF_STATS_CTX_PERIODIC);
          pf_cmpbe_set_state(p_ar, PF_CMPBE_STATE_WFCNF);
       }
    }
@@ -49,13 +49,7 @@ int pf_cmrdr_rm_read_ind(
    uint8_t                 *p_data = NULL;
    uint16_t                data_length_pos = 0;
    uint16_t                start_pos = 0;
-   uint8_t                 iocs[255];              /* Max possible array size */
-   uint8_t                 iops[255];              /* Max possible array size */
-   uint8_t                 subslot_data[PF_FRAME_BUFFER_SIZE];     /* Max possible array size */
-   uint8_t                 iocs_len = 0;
-   uint8_t                 iops_len = 0;
    uint16_t                data_len = 0;
-   bool                    new_flag = false;
 
    read_result.sequence_number = p_read_request->sequence_number;
    read_result.ar_uuid = p_read_request->ar_uuid;
@@ -236,52 +230,22 @@ int pf_cmrdr_rm_read_ind(
          ret = 0;
          break;
 
+      /* Block-writer fetches the sub-module data directly into the answer. */
       case PF_IDX_SUB_INPUT_DATA:
          /* Sub-module data to the controller */
-         data_len = sizeof(subslot_data);
-         iops_len = sizeof(iops);
-         iocs_len = sizeof(iocs);
-         if (pf_ppm_get_data_and_iops(net, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number,
-            subslot_data, &data_len, iops, &iops_len) != 0)
-         {
-            LOG_DEBUG(PNET_LOG, "CMRDR(%d): Could not get PPM data and IOPS\n", __LINE__);
-            data_len = 0;
-            iops_len = 0;
-         }
-         if (pf_cpm_get_iocs(net, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number, iocs, &iocs_len) != 0)
-         {
-            LOG_DEBUG(PNET_LOG, "CMRDR(%d): Could not get CPM IOCS\n", __LINE__);
-            iocs_len = 0;
-         }
-         if ((data_len + iops_len + iocs_len) > 0)
+         pf_put_input_data(net, true, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number,
+            res_size, p_res, p_pos);
+         if (*p_pos > start_pos)
          {
-            /* Have all data */
-            pf_put_input_data(true, iocs_len, iocs, iops_len, iops, data_len, subslot_data, res_size, p_res, p_pos);
             ret = 0;
          }
          break;
       case PF_IDX_SUB_OUTPUT_DATA:
          /* Sub-module data from the controller. */
-         data_len = sizeof(subslot_data);
-         iops_len = sizeof(iops);
-         iocs_len = sizeof(iocs);
-         if (pf_cpm_get_data_and_iops(net, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number,
-            &new_flag, subslot_data, &data_len, iops, &iops_len) != 0)
-         {
-            LOG_DEBUG(PNET_LOG, "CMRDR(%d): Could not get CPM data and IOPS\n", __LINE__);
-            data_len = 0;
-            iops_len = 0;
-         }
-         if (pf_ppm_get_iocs(net, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number, iocs, &iocs_len) != 0)
-         {
-            LOG_DEBUG(PNET_LOG, "CMRDR(%d): Could not get PPM IOCS\n", __LINE__);
-            iocs_len = 0;
-         }
-         if ((data_len + iops_len + iocs_len) > 0)
+         pf_put_output_data(net, true, p_read_request->api, p_read_request->slot_number, p_read_request->subslot_number,
+            res_size, p_res, p_pos);
+         if (*p_pos > start_pos)
          {
-            /* Have all data */
-            /* ToDo: Support substitution values, mode and active flag */
-            pf_put_output_data(true, false, iocs_len, iocs, iops_len, iops, data_len, subslot_data, 0, subslot_data, res_size, p_res, p_pos);
             ret = 0;
          }
          break;
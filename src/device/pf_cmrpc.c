@@ -41,11 +41,13 @@
 #define os_udp_open mock_os_udp_open
 #define os_udp_close mock_os_udp_close
 #define os_udp_recvfrom mock_os_udp_recvfrom
+#define os_poll_add mock_os_poll_add
 #define pf_generate_uuid mock_pf_generate_uuid
 #endif
 
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <ctype.h>
 
 #include "pf_includes.h"
@@ -178,7 +180,7 @@ void pf_cmrpc_show(
 
    if (level & 0x0800)
    {
-      for (ix = 0; ix < PF_MAX_SESSION; ix++)
+      for (ix = 0; ix < net->cmrpc_max_session; ix++)
       {
          p_sess = &net->cmrpc_session_info[ix];
          printf("Session index         = %u\n", ix);
@@ -220,7 +222,7 @@ void pf_cmrpc_show(
 
    if (level & 0x1000)
    {
-      for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+      for (ar_ix = 0; ar_ix < net->max_ar; ar_ix++)
       {
          p_ar = pf_ar_find_by_index(net, ar_ix);
          printf("AR index              = %u\n", (unsigned)ar_ix);
@@ -293,6 +295,43 @@ void pf_cmrpc_show(
    }
 }
 
+/**
+ * @internal
+ * Watch a newly opened socket for input, if an event loop waits on the
+ * descriptor of the stack. See pnet_get_fd().
+ * @param net              InOut: The p-net stack instance
+ * @param socket           In:   The socket.
+ */
+static void pf_cmrpc_poll_add(
+   pnet_t                  *net,
+   uint32_t                socket)
+{
+   os_poll_t               *p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+
+   if ((p_poll != NULL) && ((int32_t)socket > 0))
+   {
+      if (os_poll_add(p_poll, socket) != 0)
+      {
+         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Could not watch socket %" PRIu32 "\n", __LINE__, socket);
+      }
+   }
+}
+
+void pf_cmrpc_poll_init(
+   pnet_t                  *net)
+{
+   uint16_t                ix;
+
+   pf_cmrpc_poll_add(net, net->cmrpc_rpcreq_socket);
+   for (ix = 0; ix < net->cmrpc_max_session; ix++)
+   {
+      if ((net->cmrpc_session_info[ix].in_use == true) && (net->cmrpc_session_info[ix].from_me == true))
+      {
+         pf_cmrpc_poll_add(net, net->cmrpc_session_info[ix].socket);
+      }
+   }
+}
+
 /*********************** Sessions and ARs ************************************/
 
 /**
@@ -312,13 +351,13 @@ static int pf_session_allocate(
    pf_session_info_t       *p_sess = NULL;
 
    os_mutex_lock(net->p_cmrpc_rpc_mutex);
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
          (net->cmrpc_session_info[ix].in_use == true))
    {
       ix++;
    }
 
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       p_sess = &net->cmrpc_session_info[ix];
       memset(p_sess, 0, sizeof(*p_sess));
@@ -394,13 +433,13 @@ static int pf_session_locate_by_uuid(
    uint16_t ix;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
           ((net->cmrpc_session_info[ix].in_use == false) ||
            (memcmp(p_uuid, &net->cmrpc_session_info[ix].activity_uuid, sizeof(*p_uuid)) != 0)))
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       *pp_sess = &net->cmrpc_session_info[ix];
       ret = 0;
@@ -429,14 +468,14 @@ static int pf_session_locate_by_ar(
    uint16_t ix;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_session_info)) &&
+   while ((ix < net->cmrpc_max_session) &&
           ((net->cmrpc_session_info[ix].in_use == false) ||
            (net->cmrpc_session_info[ix].from_me == false) ||
            (net->cmrpc_session_info[ix].p_ar != p_ar)))
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_session_info))
+   if (ix < net->cmrpc_max_session)
    {
       *pp_sess = &net->cmrpc_session_info[ix];
       ret = 0;
@@ -460,13 +499,13 @@ static int pf_ar_allocate(
    int                     ret = -1;
    uint16_t                ix = 0;
    os_mutex_lock(net->p_cmrpc_rpc_mutex);
-   while ((ix < NELEMENTS(net->cmrpc_ar)) &&
+   while ((ix < net->max_ar) &&
          (net->cmrpc_ar[ix].in_use == true))
    {
       ix++;
    }
 
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->max_ar)
    {
       memset(&net->cmrpc_ar[ix], 0, sizeof(net->cmrpc_ar[ix]));
       net->cmrpc_ar[ix].in_use = true;
@@ -477,7 +516,7 @@ static int pf_ar_allocate(
    }
    os_mutex_unlock(net->p_cmrpc_rpc_mutex);
 
-   if (ix < PNET_MAX_AR)
+   if (ix < net->max_ar)
    {
       net->cmrpc_ar[ix].arep = ix + 1;      /* Avoid AREP == 0 */
       LOG_INFO(PF_RPC_LOG, "RPC(%d): Allocate AR %u\n", __LINE__, ix);
@@ -531,7 +570,7 @@ static int pf_ar_find_by_uuid(
    pf_cmdev_state_values_t cmdev_state;
 
    ix = 0;
-   while ((ix < NELEMENTS(net->cmrpc_ar)) &&
+   while ((ix < net->max_ar) &&
           ((net->cmrpc_ar[ix].in_use == false) ||
            ((pf_cmdev_get_state(&net->cmrpc_ar[ix], &cmdev_state) == 0) &&
             (cmdev_state == PF_CMDEV_STATE_POWER_ON)) ||
@@ -539,7 +578,7 @@ static int pf_ar_find_by_uuid(
    {
       ix++;
    }
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->max_ar)
    {
       *pp_ar = &net->cmrpc_ar[ix];
       ret = 0;
@@ -552,7 +591,7 @@ pf_ar_t *pf_ar_find_by_index(
    pnet_t                  *net,
    uint16_t                ix)
 {
-   if (ix < NELEMENTS(net->cmrpc_ar))
+   if (ix < net->max_ar)
    {
       return &net->cmrpc_ar[ix];
    }
@@ -571,7 +610,7 @@ int pf_ar_find_by_arep(
    if (arep > 0)
    {
       ix = arep - 1;    /* Convert to index */
-      if ((ix < NELEMENTS(net->cmrpc_ar)) &&
+      if ((ix < net->max_ar) &&
           (net->cmrpc_ar[ix].in_use == true))
       {
          *pp_ar = &net->cmrpc_ar[ix];
@@ -689,37 +728,46 @@ static int pf_cmrpc_rm_connect_interpret_ind(
             }
             break;
          case PF_BT_IOCR_BLOCK_REQ:
-            pf_get_iocr_param(&p_sess->get_info, p_pos, p_ar->nbr_iocrs, p_ar);
-
-            /* Count the types for error discovery */
-            if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_INPUT)
-            {
-               p_ar->input_cr_cnt++;
-            }
-            if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_OUTPUT)
+            if (p_ar->nbr_iocrs >= NELEMENTS(p_ar->iocrs))
             {
-               p_ar->output_cr_cnt++;
-            }
-            if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER)
-            {
-               p_ar->mcr_cons_cnt++;
-            }
-            if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_properties.rt_class == PF_RT_CLASS_3)
-            {
-               p_ar->rtc3_present = true;
-            }
-
-            if (p_ar->ar_param.ar_properties.device_access == true)
-            {
-               pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_UNKNOWN_BLOCKS);
+               /* Too many blocks of this type */
+               pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_WRONG_BLOCK_COUNT);
                ret = -1;
             }
             else
             {
-               ret = pf_check_block_header((*p_pos - data_pos) + 2, &block_header, PNET_ERROR_CODE_1_CONN_FAULTY_IOCR_BLOCK_REQ, &p_sess->rpc_result);
-               if (ret == 0)
+               pf_get_iocr_param(&p_sess->get_info, p_pos, p_ar->nbr_iocrs, p_ar);
+
+               /* Count the types for error discovery */
+               if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_INPUT)
                {
-                  p_ar->nbr_iocrs++;
+                  p_ar->input_cr_cnt++;
+               }
+               if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_OUTPUT)
+               {
+                  p_ar->output_cr_cnt++;
+               }
+               if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER)
+               {
+                  p_ar->mcr_cons_cnt++;
+               }
+               if (p_ar->iocrs[p_ar->nbr_iocrs].param.iocr_properties.rt_class == PF_RT_CLASS_3)
+               {
+                  p_ar->rtc3_present = true;
+               }
+
+               if (p_ar->ar_param.ar_properties.device_access == true)
+               {
+                  pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_UNKNOWN_BLOCKS);
+                  ret = -1;
+               }
+               else
+               {
+                  ret = pf_check_block_header((*p_pos - data_pos) + 2, &block_header, PNET_ERROR_CODE_1_CONN_FAULTY_IOCR_BLOCK_REQ, &p_sess->rpc_result);
+                  if (ret == 0)
+                  {
+                     p_ar->nbr_iocrs++;
+                  }
                }
             }
             break;
@@ -803,18 +851,27 @@ static int pf_cmrpc_rm_connect_interpret_ind(
 #endif
 #if PNET_OPTION_MC_CR
          case PF_BT_MCR_REQ:
-            pf_get_mcr_request(&p_sess->get_info, p_pos, p_ar->nbr_mcr, p_ar);
-            if (p_ar->ar_param.ar_properties.device_access == true)
+            if (p_ar->nbr_mcr >= NELEMENTS(p_ar->mcr_request))
             {
-               pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_UNKNOWN_BLOCKS);
+               /* Too many blocks of this type */
+               pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_WRONG_BLOCK_COUNT);
                ret = -1;
             }
             else
             {
-               ret = pf_check_block_header((*p_pos - data_pos) + 2, &block_header, PNET_ERROR_CODE_1_CONN_FAULTY_MCR_BLOCK_REQ, &p_sess->rpc_result);
-               if (ret == 0)
+               pf_get_mcr_request(&p_sess->get_info, p_pos, p_ar->nbr_mcr, p_ar);
+               if (p_ar->ar_param.ar_properties.device_access == true)
+               {
+                  pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_UNKNOWN_BLOCKS);
+                  ret = -1;
+               }
+               else
                {
-                  p_ar->nbr_mcr++;
+                  ret = pf_check_block_header((*p_pos - data_pos) + 2, &block_header, PNET_ERROR_CODE_1_CONN_FAULTY_MCR_BLOCK_REQ, &p_sess->rpc_result);
+                  if (ret == 0)
+                  {
+                     p_ar->nbr_mcr++;
+                  }
                }
             }
             break;
@@ -870,6 +927,26 @@ static int pf_cmrpc_rm_connect_interpret_ind(
                if (ret == 0)
                {
                   p_ar->nbr_ir_info++;
+                  p_ar->ir_info.valid = true;
+               }
+            }
+            break;
+#endif
+#if PNET_OPTION_SR
+         case PF_BT_SR_INFO_BLOCK_REQ:
+            pf_get_sr_info_request(&p_sess->get_info, p_pos, p_ar);
+
+            if (p_ar->ar_param.ar_properties.device_access == true)
+            {
+               pf_set_error(&p_sess->rpc_result, PNET_ERROR_CODE_CONNECT, PNET_ERROR_DECODE_PNIO, PNET_ERROR_CODE_1_CMRPC, PNET_ERROR_CODE_2_CMRPC_UNKNOWN_BLOCKS);
+               ret = -1;
+            }
+            else
+            {
+               ret = pf_check_block_header((*p_pos - data_pos) + 2, &block_header, PNET_ERROR_CODE_1_CONN_FAULTY_SR_INFO, &p_sess->rpc_result);
+               if (ret == 0)
+               {
+                  p_ar->sr_info.valid = true;
                }
             }
             break;
@@ -1050,6 +1127,9 @@ static int pf_cmrpc_rm_connect_ind(
    int                     ret = -1;
    pf_ar_t                 *p_ar = NULL;
    pf_ar_t                 *p_ar_2 = NULL;
+#if PNET_OPTION_FAST_STARTUP
+   const uint16_t          start_pos = req_pos;          /* Of the AR block */
+#endif
 
    if (p_sess->rpc_result.pnio_status.error_code != 0)
    {
@@ -1063,16 +1143,34 @@ static int pf_cmrpc_rm_connect_ind(
       p_ar->p_sess = p_sess;
       p_sess->p_ar = p_ar;
 
-      /* Check_RPC - No support for ArSet (yet) */
+      /* Check_RPC */
       if (pf_cmrpc_rm_connect_interpret_ind(p_sess, &req_pos, p_ar) == 0)
       {
          if (pf_ar_find_by_uuid(net, &p_ar->ar_param.ar_uuid, &p_ar_2) != 0)
          {
-            /* Valid, unknown AR, NoArSet */
+            /* Valid, unknown AR */
             p_ar->ar_state = PF_AR_STATE_PRIMARY;
             p_ar->sync_state = PF_SYNC_STATE_NOT_AVAILABLE;
+#if PNET_OPTION_SR
+            pf_cmsr_connect_ind(net, p_ar);     /* Backup if it joins an AR set */
+#endif
+#if PNET_OPTION_FAST_STARTUP
+            p_ar->p_fsu_entry = pf_fsu_find(net, &p_sess->get_info.p_buf[start_pos],
+               p_sess->get_info.len - start_pos, p_sess->get_info.is_big_endian);
+#endif
 
             ret = pf_cmdev_rm_connect_ind(net, p_ar, &p_sess->rpc_result);
+
+#if PNET_OPTION_FAST_STARTUP
+            if ((ret == 0) &&
+                (p_sess->rpc_result.pnio_status.error_code == 0) &&
+                (p_ar->p_fsu_entry == NULL))
+            {
+               pf_fsu_save(net, p_ar, &p_sess->get_info.p_buf[start_pos],
+                  p_sess->get_info.len - start_pos, p_sess->get_info.is_big_endian);
+            }
+            p_ar->p_fsu_entry = NULL;
+#endif
          }
          else
          {
@@ -1149,7 +1247,7 @@ static int pf_cmrpc_rm_connect_ind(
 			net->fspm_cfg.lldp_peer_req.peerBoundary.properites = 0;
 			
 			/* Send an LLDP Packet */
-			pf_lldp_send(net);
+			pf_lldp_send(net, PF_STATS_CTX_RPC);
 			
 			/*Startup LLDP timer again*/
 			os_timer_start(net->eth_handle->lldpBroadcastTimer);
@@ -2132,7 +2230,8 @@ static int pf_cmrpc_rpc_request(
 
 int pf_cmrpc_rm_ccontrol_req(
    pnet_t                  *net,
-   pf_ar_t                 *p_ar)
+   pf_ar_t                 *p_ar,
+   pf_stats_ctx_t          ctx)
 {
    int                     ret = -1;
    pf_rpc_header_t         rpc_req;
@@ -2279,23 +2378,24 @@ int pf_cmrpc_rm_ccontrol_req(
       pf_put_uint32(rpc_req.is_big_endian, ndr_data.array.actual_count, max_req_len, p_sess->out_buffer, &start_pos);
 
       p_sess->socket = os_udp_open(OS_IPADDR_ANY, PF_RPC_CCONTROL_EPHEMERAL_PORT);
+      pf_cmrpc_poll_add(net, p_sess->socket);
       if (p_sess->socket > 0)
       {
          if (os_udp_sendto(p_sess->socket, p_sess->ip_addr, p_sess->port, p_sess->out_buffer, p_sess->out_buf_sent_len) == p_sess->out_buf_sent_len)
          {
-        	 net->interface_statistics.ifOutOctects++;
+            pf_stats_out(net, ctx, PNET_TRAFFIC_CLASS_RPC, p_sess->out_buf_sent_len);
             LOG_INFO(PF_RPC_LOG, "Sent ccontrol request (with APPL_READY) to controller. size = %u. socket %" PRIu32 "\n", p_sess->out_buf_sent_len, p_sess->socket);
             ret = 0;
          }
          else
          {
-        	 net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, ctx, PNET_TRAFFIC_CLASS_RPC);
             LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_sendto failed\n", __LINE__);
          }
       }
       else
       {
-    	  net->interface_statistics.ifOutDiscards++;
+         pf_stats_out_discard(net, ctx, PNET_TRAFFIC_CLASS_RPC);
          LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): os_udp_open failed: %d\n", __LINE__, (int)p_sess->socket);
       }
    }
@@ -2977,7 +3077,7 @@ void pf_cmrpc_periodic(
    int                     sent_len = 0;
 
    /* Poll for RPC session confirmations */
-   for (ix = 0; ix < NELEMENTS(net->cmrpc_session_info); ix++)
+   for (ix = 0; ix < net->cmrpc_max_session; ix++)
    {
       if ((net->cmrpc_session_info[ix].in_use == true) && (net->cmrpc_session_info[ix].from_me == true))
       {
@@ -2985,11 +3085,13 @@ void pf_cmrpc_periodic(
          dcerpc_req_len = os_udp_recvfrom(net->cmrpc_session_info[ix].socket, &dcerpc_addr, &dcerpc_port, net->cmrpc_dcerpc_req_frame, sizeof(net->cmrpc_dcerpc_req_frame));
          if (dcerpc_req_len > 0)
          {
-        	net->interface_statistics.ifInOctects++;
+            pf_stats_in(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC, dcerpc_req_len);
             dcerpc_resp_len = PF_MAX_UDP_PAYLOAD_SIZE;
             LOG_INFO(PF_RPC_LOG, "CMRPC(%d): Received %u bytes UDP payload from remote port %u, on a socket used in session with index %u\n", __LINE__, dcerpc_req_len, dcerpc_port, ix);
             is_release = false;
+            PF_TRACE2(rpc_req_start, dcerpc_req_len, dcerpc_port);
             (void)pf_cmrpc_dce_packet(net, dcerpc_addr, dcerpc_port, net->cmrpc_dcerpc_req_frame, dcerpc_req_len, net->cmrpc_dcerpc_rsp_frame, &dcerpc_resp_len, &is_release);
+            PF_TRACE1(rpc_req_end, dcerpc_resp_len);
             if (dcerpc_resp_len != 0)
             {
                LOG_INFO(PF_RPC_LOG, "CMRPC(%d): Sending %u bytes UDP payload to remote port %u, on the socket in session with index %u.\n", __LINE__, dcerpc_resp_len, dcerpc_port, ix);
@@ -2997,17 +3099,16 @@ void pf_cmrpc_periodic(
                if (sent_len != dcerpc_resp_len)
                {
                    is_release = true;
-            	   net->interface_statistics.ifOutErrors++;
+                  pf_stats_out_error(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC);
                   LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Failed to send %u UDP bytes payload on socket used in session with index %u\n", __LINE__, dcerpc_resp_len, ix);
                }
                else
                {
-            	   net->interface_statistics.ifOutOctects++;
+                  pf_stats_out(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC, dcerpc_resp_len);
                }
             }
             else
             {
-            	 net->interface_statistics.ifOutErrors++;
                LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): No UDP data to send on socket used in session with index %u\n", __LINE__, ix);
             }
             if (is_release == true)
@@ -3015,6 +3116,7 @@ void pf_cmrpc_periodic(
                LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): Closing and reopening socket used in session with index %u\n", __LINE__, ix);
                os_udp_close(net->cmrpc_session_info[ix].socket);
                net->cmrpc_session_info[ix].socket = os_udp_open(OS_IPADDR_ANY, PF_RPC_CCONTROL_EPHEMERAL_PORT);
+               pf_cmrpc_poll_add(net, net->cmrpc_session_info[ix].socket);
             }
          }
       }
@@ -3024,11 +3126,13 @@ void pf_cmrpc_periodic(
    dcerpc_req_len = os_udp_recvfrom(net->cmrpc_rpcreq_socket, &dcerpc_addr, &dcerpc_port, net->cmrpc_dcerpc_req_frame, sizeof(net->cmrpc_dcerpc_req_frame));
    if (dcerpc_req_len > 0)
    {
-	   net->interface_statistics.ifInOctects++;
+      pf_stats_in(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC, dcerpc_req_len);
       dcerpc_resp_len = PF_MAX_UDP_PAYLOAD_SIZE;
       LOG_INFO(PF_RPC_LOG, "CMRPC(%d): Received %u bytes UDP payload from remote port %u, on the socket for incoming DCE RPC requests.\n", __LINE__, dcerpc_req_len, dcerpc_port);
       is_release = false;
+      PF_TRACE2(rpc_req_start, dcerpc_req_len, dcerpc_port);
       (void)pf_cmrpc_dce_packet(net, dcerpc_addr, dcerpc_port, net->cmrpc_dcerpc_req_frame, dcerpc_req_len, net->cmrpc_dcerpc_rsp_frame, &dcerpc_resp_len, &is_release);
+      PF_TRACE1(rpc_req_end, dcerpc_resp_len);
       if (dcerpc_resp_len != 0)
       {
          LOG_INFO(PF_RPC_LOG, "CMRPC(%d): Sending %u bytes UDP payload to remote port %u, on the socket used for incoming DCE RPC requests.\n", __LINE__, dcerpc_resp_len, dcerpc_port);
@@ -3036,17 +3140,17 @@ void pf_cmrpc_periodic(
          if (sent_len != dcerpc_resp_len)
          {
         	  is_release = true;
-        	 net->interface_statistics.ifOutErrors++;
+            pf_stats_out_error(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC);
             LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Failed to send %u UDP bytes payload on the socket for incoming DCE RPC requests.\n", __LINE__, dcerpc_resp_len);
          }
          else
          {
-        	 net->interface_statistics.ifOutOctects++;
+            pf_stats_out(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC, dcerpc_resp_len);
          }
       }
       else
       {
-    	  net->interface_statistics.ifOutDiscards++;
+         /* Nothing was dropped, so this is not counted as a discard */
          LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): No UDP data to send on the socket for incoming DCE RPC requests.\n", __LINE__);
       }
       if (is_release == true)
@@ -3054,6 +3158,7 @@ void pf_cmrpc_periodic(
          LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): Closing and reopening socket used for incoming DCE RPC requests.\n", __LINE__);
          os_udp_close(net->cmrpc_rpcreq_socket);
          net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, PF_RPC_SERVER_PORT);
+         pf_cmrpc_poll_add(net, net->cmrpc_rpcreq_socket);
       }
    }
 }
@@ -3098,33 +3203,73 @@ void pf_cmrpc_thread(
 	}
 }
 
+int pf_cmrpc_alloc(
+   pnet_t                  *net)
+{
+   if (net->cmrpc_ar == NULL)
+   {
+      /* Sized for pnet_cfg_t.max_ar */
+      net->cmrpc_max_session = PF_MAX_SESSION(net->max_ar);
+      net->cmrpc_ar = os_malloc(net->max_ar * sizeof(net->cmrpc_ar[0]));
+      net->cmrpc_session_info = os_malloc(net->cmrpc_max_session * sizeof(net->cmrpc_session_info[0]));
+      if ((net->cmrpc_ar == NULL) || (net->cmrpc_session_info == NULL))
+      {
+         LOG_ERROR(PF_RPC_LOG, "CMRPC(%d): Could not allocate %u ARs\n", __LINE__, (unsigned)net->max_ar);
+         pf_cmrpc_free(net);
+         return -1;
+      }
+   }
+
+   memset(net->cmrpc_ar, 0, net->max_ar * sizeof(net->cmrpc_ar[0]));
+   memset(net->cmrpc_session_info, 0, net->cmrpc_max_session * sizeof(net->cmrpc_session_info[0]));
+
+   return 0;
+}
+
+void pf_cmrpc_free(
+   pnet_t                  *net)
+{
+   os_free(net->cmrpc_ar);
+   os_free(net->cmrpc_session_info);
+   net->cmrpc_ar = NULL;
+   net->cmrpc_session_info = NULL;
+   net->cmrpc_max_session = 0;
+}
+
 os_thread_t* pf_cmrpc_init(
    pnet_t                  *net)
 {
 	os_thread_t             *udpThread;
+#if OS_USE_UDP_THREAD
+	os_thread_cfg_t         thread_cfg;
+#endif
 	
-	udpThread = malloc(sizeof(os_thread_t));
+	/* Only a non-NULL result, unless the RPC thread replaces it below */
+	udpThread = os_malloc(sizeof(os_thread_t));
    if (udpThread == NULL)
    {
 	  return NULL;
    }
 	   
+   /* The AR and session tables are allocated by pf_cmrpc_alloc() */
    if (net->p_cmrpc_rpc_mutex == NULL)
    {
       net->p_cmrpc_rpc_mutex = os_mutex_create();
-      memset(net->cmrpc_ar, 0, sizeof(net->cmrpc_ar));
-      memset(net->cmrpc_session_info, 0, sizeof(net->cmrpc_session_info));
-
       net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, PF_RPC_SERVER_PORT);
+      pf_cmrpc_poll_add(net, net->cmrpc_rpcreq_socket);
    }
 
    /* Save for later (put it into each session */
    net->cmrpc_session_number = 0x12345678;     /* Starting number */
    
 #if OS_USE_UDP_THREAD
-   udpThread = os_thread_create (os_task_table[UDP_TABLE_INDEX].taskName,
- 		  	  	  	  	  	  	  	  os_task_table[UDP_TABLE_INDEX].priority,
- 		  	  	  	  	  	  	  	  os_task_table[UDP_TABLE_INDEX].stackSize,
+   os_free(udpThread);
+   pf_fspm_get_thread_cfg(net, PNET_THREAD_RPC,
+      os_task_table[UDP_TABLE_INDEX].priority,
+      os_task_table[UDP_TABLE_INDEX].stackSize,
+      &thread_cfg);
+   udpThread = os_thread_create_cfg (os_task_table[UDP_TABLE_INDEX].taskName,
+ 		  	  	  	  	  	  	  	  &thread_cfg,
  		  	  	  	  	  	          pf_cmrpc_thread, net);
 #endif
    
@@ -3132,15 +3277,17 @@ os_thread_t* pf_cmrpc_init(
 }
 
 
-/* Not used */
 void pf_cmrpc_exit(
    pnet_t                  *net)
 {
    if (net->p_cmrpc_rpc_mutex != NULL)
    {
+      os_udp_close(net->cmrpc_rpcreq_socket);
+      net->cmrpc_rpcreq_socket = 0;
       os_mutex_destroy(net->p_cmrpc_rpc_mutex);
-      memset(net->cmrpc_ar, 0, sizeof(net->cmrpc_ar));
-      memset(net->cmrpc_session_info, 0, sizeof(net->cmrpc_session_info));
+      net->p_cmrpc_rpc_mutex = NULL;
+      memset(net->cmrpc_ar, 0, net->max_ar * sizeof(net->cmrpc_ar[0]));
+      memset(net->cmrpc_session_info, 0, net->cmrpc_max_session * sizeof(net->cmrpc_session_info[0]));
    }
 }
 
@@ -3176,6 +3323,7 @@ int pf_cmrpc_cmdev_state_ind(
                LOG_DEBUG(PF_RPC_LOG, "CMRPC(%d): Closing and reopening socket used for incoming DCE RPC requests.\n", __LINE__);
                os_udp_close(net->cmrpc_rpcreq_socket);
                net->cmrpc_rpcreq_socket = os_udp_open(OS_IPADDR_ANY, PF_RPC_SERVER_PORT);
+               pf_cmrpc_poll_add(net, net->cmrpc_rpcreq_socket);
             }
          }
          else
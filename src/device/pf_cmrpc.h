@@ -25,6 +25,25 @@ extern "C"
  *       Local primitives
  */
 
+/**
+ * Allocate the AR and session tables, sized for net->max_ar.
+ *
+ * The tables are read by the Ethernet RX thread, so this must be done
+ * before os_eth_init().
+ * @param net              InOut: The p-net stack instance
+ * @return  0  if the tables were allocated.
+ *          -1 if not. Nothing is left allocated.
+ */
+int pf_cmrpc_alloc(
+   pnet_t                  *net);
+
+/**
+ * Free the AR and session tables.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmrpc_free(
+   pnet_t                  *net);
+
 /**
  * Initialize the CMRPC component.
  * @param net              InOut: The p-net stack instance
@@ -33,12 +52,20 @@ os_thread_t *pf_cmrpc_init(
    pnet_t                  *net);
 
 /**
- * Cleanup the CMRPC component.
+ * Cleanup the CMRPC component. The RPC thread must not run.
  * @param net              InOut: The p-net stack instance
  */
 void pf_cmrpc_exit(
    pnet_t                  *net);
 
+/**
+ * Watch the RPC sockets with net->poll. Sockets opened later are added
+ * when they are opened.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmrpc_poll_init(
+   pnet_t                  *net);
+
 /**
  * Handle periodic RPC tasks.
  * Check for DCE RPC requests.
@@ -107,12 +134,14 @@ int pf_cmrpc_cmdev_state_ind(
  *
  * @param net              InOut: The p-net stack instance
  * @param p_ar             In:   The AR instance.
+ * @param ctx              In:   The calling thread, for the counters.
  * @return  0  if operation succeeded.
  *          -1 if an error occurred.
  */
 int pf_cmrpc_rm_ccontrol_req(
    pnet_t                  *net,
-   pf_ar_t                 *p_ar);
+   pf_ar_t                 *p_ar,
+   pf_stats_ctx_t          ctx);
 
 /**
  * Show AR and session information.
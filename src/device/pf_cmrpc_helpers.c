@@ -435,13 +435,14 @@ int pf_cmrpc_lookup_request(
 {
     int                     ret = -1;
     pf_rpc_lookup_rsp_t 	rsp_lookup;
+    pf_rpc_entry_t          rpc_entry;
     
     
     memset(&rsp_lookup, 0, sizeof(rsp_lookup));
     
-    /*Assign a blank entry point*/
-    rsp_lookup.rpc_entries = (pf_rpc_entry_t*)malloc(sizeof(pf_rpc_entry_t));
-	memset( rsp_lookup.rpc_entries,0,sizeof(pf_rpc_entry_t));
+    /*Assign a blank entry point. Only one entry is ever returned.*/
+    memset(&rpc_entry, 0, sizeof(rpc_entry));
+    rsp_lookup.rpc_entries = &rpc_entry;
 	rsp_lookup.rpc_entries->next_entry = NULL;
 	
 	/*Max Count is always 1 */
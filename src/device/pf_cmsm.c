@@ -119,7 +119,7 @@ static void pf_cmsm_set_state(
 static void pf_cmsm_timeout(
    pnet_t                  *net,
    void                    *arg,
-   uint32_t                current_time)
+   uint64_t                current_time)
 {
    CC_ASSERT(arg != NULL);
    pf_ar_t                 *p_ar = (pf_ar_t *)arg;
@@ -0,0 +1,228 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+/* The ARUUID.Selector is in data4[2..7] of the ARUUID of an SR AR */
+#define PF_CMSR_SELECTOR_POS     2
+
+static const char *cmsr_sched_name = "cmsr";
+
+void pf_cmsr_init(
+   pnet_t                  *net)
+{
+   memset(&net->cmsr, 0, sizeof(net->cmsr));
+}
+
+/**
+ * @internal
+ * Check if two ARs belong to the same AR set.
+ *
+ * The ARUUIDs of the ARs of a set differ only in the ARUUID.Selector.
+ * The CMInitiatorObjectUUID can not be used, as it is the same for all
+ * controllers.
+ * @param p_ar             In:   The AR instance.
+ * @param p_other          In:   The other AR instance.
+ * @return  true if both are SR ARs of the same controller pair.
+ */
+static bool pf_cmsr_same_set(
+   const pf_ar_t           *p_ar,
+   const pf_ar_t           *p_other)
+{
+   const pf_uuid_t         *p_uuid = &p_ar->ar_param.ar_uuid;
+   const pf_uuid_t         *p_other_uuid = &p_other->ar_param.ar_uuid;
+
+   return (p_other != p_ar) &&
+      (p_other->in_use == true) &&
+      (p_ar->ar_param.ar_type == PF_ART_IOCAR_SR) &&
+      (p_other->ar_param.ar_type == PF_ART_IOCAR_SR) &&
+      (p_ar->sr_info.valid == true) &&
+      (p_other->sr_info.valid == true) &&
+      (p_other_uuid->data1 == p_uuid->data1) &&
+      (p_other_uuid->data2 == p_uuid->data2) &&
+      (p_other_uuid->data3 == p_uuid->data3) &&
+      (memcmp(p_other_uuid->data4, p_uuid->data4, PF_CMSR_SELECTOR_POS) == 0);
+}
+
+pf_ar_t *pf_cmsr_get_next(
+   pnet_t                  *net,
+   const pf_ar_t           *p_ar,
+   uint16_t                *p_ix)
+{
+   pf_ar_t                 *p_other = NULL;
+   pf_ar_t                 *p_found = NULL;
+
+   while ((p_found == NULL) && (*p_ix < net->max_ar))
+   {
+      p_other = pf_ar_find_by_index(net, *p_ix);
+      (*p_ix)++;
+      if ((p_other != NULL) && (pf_cmsr_same_set(p_ar, p_other) == true))
+      {
+         p_found = p_other;
+      }
+   }
+
+   return p_found;
+}
+
+/**
+ * @internal
+ * Set the AR state, and the State bit of the data status of its input CRs.
+ * @param p_ar             InOut: The AR instance.
+ * @param ar_state         In:   PF_AR_STATE_PRIMARY or PF_AR_STATE_BACKUP.
+ */
+static void pf_cmsr_set_ar_state(
+   pf_ar_t                 *p_ar,
+   pf_ar_state_values_t    ar_state)
+{
+   uint32_t                crep;
+
+   p_ar->ar_state = ar_state;
+
+   for (crep = 0; crep < p_ar->nbr_iocrs; crep++)
+   {
+      if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+          (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
+      {
+         (void)pf_ppm_set_data_status_state(p_ar, crep, ar_state == PF_AR_STATE_PRIMARY);
+      }
+   }
+}
+
+void pf_cmsr_connect_ind(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar)
+{
+   uint16_t                ix = 0;
+
+   if (pf_cmsr_get_next(net, p_ar, &ix) != NULL)
+   {
+      /* The primary AR keeps the submodules until a controller says otherwise */
+      p_ar->ar_state = PF_AR_STATE_BACKUP;
+      LOG_INFO(PNET_LOG, "CMSR(%d): AREP %u joins an AR set as backup\n", __LINE__, (unsigned)p_ar->arep);
+   }
+}
+
+/**
+ * @internal
+ * Act on the last State bit from the CPM of an SR AR.
+ *
+ * Runs in the scheduler, on the thread calling pnet_handle_periodic(), like
+ * the other AR timeouts. The RX thread must not change the AR states and
+ * submodule owners in the middle of a pnet_output_get_data_and_iops().
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   The AR instance.
+ * @param current_time     In:   The current time.
+ */
+static void pf_cmsr_state_job(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   pf_ar_t                 *p_ar = (pf_ar_t *)arg;
+   pf_ar_t                 *p_other = NULL;
+   uint16_t                ix = 0;
+   bool                    primary;
+
+   /* Clear first, so a State bit that arrives from now on posts again */
+   p_ar->sr_timer = UINT32_MAX;
+   __atomic_store_n(&p_ar->sr_state_posted, false, __ATOMIC_SEQ_CST);
+   primary = __atomic_load_n(&p_ar->sr_primary_ind, __ATOMIC_SEQ_CST);
+
+   if ((p_ar->in_use == false) || (p_ar->ar_param.ar_type != PF_ART_IOCAR_SR))
+   {
+      /* Aborted before the job ran */
+   }
+   else if ((primary == true) && (p_ar->ar_state != PF_AR_STATE_PRIMARY))
+   {
+      /* Switchover. The outputs of the new primary AR are already buffered. */
+      pf_cmsr_set_ar_state(p_ar, PF_AR_STATE_PRIMARY);
+      while ((p_other = pf_cmsr_get_next(net, p_ar, &ix)) != NULL)
+      {
+         pf_cmsr_set_ar_state(p_other, PF_AR_STATE_BACKUP);
+         pf_cmdev_set_owner(net, p_other, p_ar);
+      }
+
+      net->cmsr.switchovers++;
+      net->cmsr.primary_arep = p_ar->arep;
+      net->cmsr.last_switchover = os_get_current_time_ns();
+      LOG_INFO(PNET_LOG, "CMSR(%d): AREP %u is primary\n", __LINE__, (unsigned)p_ar->arep);
+   }
+   else if ((primary == false) && (p_ar->ar_state == PF_AR_STATE_PRIMARY))
+   {
+      /* The submodules stay with this AR until another AR becomes primary */
+      pf_cmsr_set_ar_state(p_ar, PF_AR_STATE_BACKUP);
+      LOG_INFO(PNET_LOG, "CMSR(%d): AREP %u is backup\n", __LINE__, (unsigned)p_ar->arep);
+   }
+}
+
+void pf_cmsr_cpm_state_ind(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   bool                    primary)
+{
+   __atomic_store_n(&p_ar->sr_primary_ind, primary, __ATOMIC_SEQ_CST);
+
+   /* ar_state is only a hint here. The job checks it again. */
+   if ((primary == (p_ar->ar_state != PF_AR_STATE_PRIMARY)) &&
+       (__atomic_exchange_n(&p_ar->sr_state_posted, true, __ATOMIC_SEQ_CST) == false))
+   {
+      if (pf_scheduler_add(net, 0, cmsr_sched_name, pf_cmsr_state_job, p_ar, &p_ar->sr_timer) != 0)
+      {
+         /* Try again with the next frame */
+         __atomic_store_n(&p_ar->sr_state_posted, false, __ATOMIC_SEQ_CST);
+      }
+   }
+}
+
+void pf_cmsr_ar_abort(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar)
+{
+   pf_ar_t                 *p_other = NULL;
+   pf_ar_t                 *p_new_ar = NULL;
+   uint16_t                ix = 0;
+
+   /* Prefer an AR that a controller has already made primary */
+   while ((p_other = pf_cmsr_get_next(net, p_ar, &ix)) != NULL)
+   {
+      if ((p_new_ar == NULL) || (p_other->ar_state == PF_AR_STATE_PRIMARY))
+      {
+         p_new_ar = p_other;
+      }
+   }
+
+   if (p_new_ar != NULL)
+   {
+      if (p_ar->ar_state == PF_AR_STATE_PRIMARY)
+      {
+         net->cmsr.primary_losses++;
+         LOG_INFO(PNET_LOG, "CMSR(%d): Primary AREP %u lost. Waiting for AREP %u to become primary.\n", __LINE__,
+            (unsigned)p_ar->arep, (unsigned)p_new_ar->arep);
+      }
+      pf_cmdev_set_owner(net, p_ar, p_new_ar);
+   }
+}
+
+void pf_cmsr_get_status(
+   pnet_t                  *net,
+   pnet_sr_status_t        *p_status)
+{
+   p_status->switchovers = net->cmsr.switchovers;
+   p_status->primary_losses = net->cmsr.primary_losses;
+   p_status->primary_arep = net->cmsr.primary_arep;
+   p_status->last_switchover = net->cmsr.last_switchover;
+}
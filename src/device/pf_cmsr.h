@@ -0,0 +1,120 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief System redundancy (SR) AR sets.
+ *
+ * The ARs of type IOCARSR with an SRInfoBlock, and with ARUUIDs that differ
+ * only in the ARUUID.Selector, form an AR set, one AR from each controller
+ * of a redundant pair. They expect the
+ * same submodules. One AR of the set is primary and owns the submodules, so
+ * the application reads the outputs from its CPM. The backup ARs are kept
+ * warm: their CPMs receive and buffer the outputs of the backup controller,
+ * and their PPMs are given the same inputs as the primary AR.
+ *
+ * The controllers decide which AR is primary, with the State bit in the
+ * data status of the output CR. The CPM calls pf_cmsr_cpm_state_ind() for
+ * each accepted frame of an SR AR, and a change of the State bit is posted
+ * to the scheduler. The switchover is done there, with the State bits of
+ * the PPMs, so the controllers see it in the next frame after the next
+ * pnet_handle_periodic().
+ *
+ * When the primary AR is aborted, the submodules are handed over to a
+ * backup AR of the set. Its outputs are used until a controller makes one
+ * of the remaining ARs primary.
+ */
+
+#ifndef PF_CMSR_H
+#define PF_CMSR_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Reset the switchover statistics.
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_cmsr_init(
+   pnet_t                  *net);
+
+/**
+ * Set the initial state of a new AR.
+ *
+ * The first AR of an AR set starts as primary, the others as backup.
+ * Must be called before the submodules are configured for the AR.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The new AR instance.
+ */
+void pf_cmsr_connect_ind(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar);
+
+/**
+ * Find the next of the other ARs in the AR set of an AR.
+ *
+ * Start with *p_ix set to 0.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR instance.
+ * @param p_ix             InOut: Where to continue the search.
+ * @return the next AR of the set, or NULL if there are no more.
+ */
+pf_ar_t *pf_cmsr_get_next(
+   pnet_t                  *net,
+   const pf_ar_t           *p_ar,
+   uint16_t                *p_ix);
+
+/**
+ * Handle the State bit of an accepted frame of an SR AR.
+ *
+ * Makes the AR primary, and the other ARs of its set backup, when the
+ * controller says primary for the first time. Called by the RX thread.
+ * The change is done later, by the scheduler.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             InOut: The AR instance.
+ * @param primary          In:   The State bit of the data status.
+ */
+void pf_cmsr_cpm_state_ind(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   bool                    primary);
+
+/**
+ * Hand over the submodules of an aborted AR to another AR of its set.
+ *
+ * Does nothing if the AR is not an SR AR, or is the last AR of its set.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The aborted AR instance.
+ */
+void pf_cmsr_ar_abort(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar);
+
+/**
+ * Read the switchover statistics.
+ * @param net              InOut: The p-net stack instance
+ * @param p_status         Out:  The statistics.
+ */
+void pf_cmsr_get_status(
+   pnet_t                  *net,
+   pnet_sr_status_t        *p_status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_CMSR_H */
@@ -61,11 +61,13 @@ int pf_cmsu_cmdev_state_ind(
       {
          for (crep = 0; crep < p_ar->nbr_iocrs; crep++)
          {
-            if (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT)
+            if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+                (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
             {
                pf_ppm_close_req(net, p_ar, crep);
             }
-            if (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_OUTPUT)
+            if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_OUTPUT) ||
+                (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER))
             {
                pf_cpm_close_req(net, p_ar, crep);
             }
@@ -73,7 +75,7 @@ int pf_cmsu_cmdev_state_ind(
 
          pf_alarm_close(net, p_ar);
 
-         pf_cmdmc_close_req(p_ar);
+         pf_cmdmc_close_req(net, p_ar);
 
          /* ToDo: Cleanup static ARP cache entry */
          /* ACCM_req(Command: REMOVE, ip_address) */
@@ -106,7 +108,8 @@ int pf_cmsu_start_req(
       {
          if (ret == 0)
          {
-            if (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_OUTPUT)
+            if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_OUTPUT) ||
+                (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_CONSUMER))
             {
                if (pf_cpm_create(net, p_ar, crep) != 0)
                {
@@ -122,7 +125,8 @@ int pf_cmsu_start_req(
          }
          if (ret == 0)
          {
-            if (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT)
+            if ((p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_INPUT) ||
+                (p_ar->iocrs[crep].param.iocr_type == PF_IOCR_TYPE_MC_PROVIDER))
             {
                if (pf_ppm_activate_req(net, p_ar, crep) != 0)
                {
@@ -138,7 +142,7 @@ int pf_cmsu_start_req(
          p_stat->pnio_status.error_code_2 = PNET_ERROR_CODE_2_CMSU_AR_ALARM_OPEN_FAILED;
          ret = -1;
       }
-      if ((ret == 0) && (pf_cmdmc_activate_req(p_ar) != 0))
+      if ((ret == 0) && (pf_cmdmc_activate_req(net, p_ar) != 0))
       {
          p_stat->pnio_status.error_code_2 = PNET_ERROR_CODE_2_CMDEV_STATE_CONFLICT;
          ret = -1;
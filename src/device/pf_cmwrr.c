@@ -32,24 +32,27 @@ void pf_cmwrr_restore_records(pnet_t *net)
 	memset(&pRecords,0,recordSize);
 	
 	/* Restore Pdev Data */
-	if(os_restore_nvram_instance((char*)net->p_fspm_default_cfg->PDev_NonvolFilePath, &pRecords, recordSize))
+	if(pf_nvs_load(net, PF_NVS_KEY_PDEV, &pRecords, recordSize) == 0)
 	{
 		net->fspm_cfg.lldp_peer_req = pRecords.peerRequested;
 	}
 	
 }
 
-void pf_cmwrr_update_records(pnet_t *net)
+void pf_cmwrr_save_records(pnet_t *net, const pnet_lldp_peer_cfg_t *p_peer_req)
 {
 	pdev_record_t pRecords;
-	pRecords.peerRequested = net->fspm_cfg.lldp_peer_req;
+	pRecords.peerRequested = *p_peer_req;
 	
-	os_save_nvram_instance((char*)net->p_fspm_default_cfg->PDev_NonvolFilePath,
-							  &pRecords,
-			                 sizeof(pdev_record_t));
+	(void)pf_nvs_save(net, PF_NVS_KEY_PDEV, &pRecords, sizeof(pdev_record_t));
 	
 }
 
+void pf_cmwrr_update_records(pnet_t *net)
+{
+	pf_cmwrr_save_records(net, &net->fspm_cfg.lldp_peer_req);
+}
+
 
 void pf_cmwrr_init(
    pnet_t                  *net)
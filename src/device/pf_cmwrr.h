@@ -81,6 +81,9 @@ void pf_cmwrr_restore_records(pnet_t *net);
 
 void pf_cmwrr_update_records(pnet_t *net);
 
+/* As pf_cmwrr_update_records(), for a copy of fspm_cfg.lldp_peer_req */
+void pf_cmwrr_save_records(pnet_t *net, const pnet_lldp_peer_cfg_t *p_peer_req);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,22 +27,166 @@
 #include "pf_block_reader.h"
 #include "pf_block_writer.h"
 
+#define PF_DIAG_NONVOL_EVENT_DIRTY        BIT(0)
+#define PF_DIAG_NONVOL_EVENT_EXIT         BIT(1)
+#define PF_DIAG_NONVOL_EVENT_DONE         BIT(2)
+#define PF_DIAG_NONVOL_EVENT_FLUSH        BIT(3)
 
+#define PF_DIAG_NONVOL_WINDOW_MS          1000     /* Default, if not configured */
+#define PF_DIAG_NONVOL_THREAD_PRIO        2        /* Background work */
+#define PF_DIAG_NONVOL_THREAD_STACKSIZE   4096
+
+
+/**
+ * @internal
+ * Write a snapshot of all diag items to nonvolatile memory.
+ *
+ * The diag_mutex is only held while copying the items, not during
+ * the (slow) write itself.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+static void pf_diag_nonvol_write(
+   pnet_t                  *net)
+{
+   pf_device_t             *p_dev = NULL;
+
+   if (pf_cmdev_get_device(net, &p_dev) == 0)
+   {
+      os_mutex_lock(p_dev->diag_mutex);
+      memcpy(net->diag_nonvol_snapshot, p_dev->diag_items, sizeof(net->diag_nonvol_snapshot));
+      os_mutex_unlock(p_dev->diag_mutex);
+
+      if (pf_nvs_save(net, PF_NVS_KEY_DIAG, net->diag_nonvol_snapshot,
+                      sizeof(net->diag_nonvol_snapshot)) != 0)
+      {
+         LOG_ERROR(PNET_LOG, "DIAG(%d): Failed to save diag items\n", __LINE__);
+      }
+   }
+}
+
+/**
+ * @internal
+ * Background thread writing diag items to nonvolatile memory.
+ *
+ * The first change after a write opens a window during which further
+ * changes are accumulated. All of them are then written at once, so at
+ * most one write is done per window and the last state is stored within
+ * one window (plus the write time). A flush or exit request ends the
+ * window early.
+ *
+ * This is a function to be passed into os_thread_create()
+ * Do not change the argument types.
+ *
+ * @param arg              InOut: The p-net stack instance
+ */
+static void pf_diag_nonvol_thread(
+   void                    *arg)
+{
+   pnet_t                  *net = arg;
+   uint32_t                window_ms = PF_DIAG_NONVOL_WINDOW_MS;
+   uint32_t                flags = 0;
+
+   if (net->fspm_cfg.diag_nonvol_window_ms > 0)
+   {
+      window_ms = net->fspm_cfg.diag_nonvol_window_ms;
+   }
+
+   while ((flags & PF_DIAG_NONVOL_EVENT_EXIT) == 0)
+   {
+      (void)os_event_wait(net->diag_nonvol_events,
+         PF_DIAG_NONVOL_EVENT_DIRTY | PF_DIAG_NONVOL_EVENT_EXIT | PF_DIAG_NONVOL_EVENT_FLUSH,
+         &flags, OS_WAIT_FOREVER);
+      if ((flags & PF_DIAG_NONVOL_EVENT_DIRTY) != 0)
+      {
+         if ((flags & (PF_DIAG_NONVOL_EVENT_EXIT | PF_DIAG_NONVOL_EVENT_FLUSH)) == 0)
+         {
+            /* Coalesce. Returns early only on a flush or exit request. */
+            (void)os_event_wait(net->diag_nonvol_events,
+               PF_DIAG_NONVOL_EVENT_EXIT | PF_DIAG_NONVOL_EVENT_FLUSH, &flags, window_ms);
+         }
+
+         /* Changes made after this point trigger a new write */
+         os_event_clr(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DIRTY);
+         pf_diag_nonvol_write(net);
+      }
+
+      if ((flags & PF_DIAG_NONVOL_EVENT_FLUSH) != 0)
+      {
+         os_event_clr(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_FLUSH);
+         os_event_set(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE);
+      }
+   }
+
+   os_event_clr(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_EXIT);
+   os_event_set(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE);
+}
 
 int pf_diag_init(pnet_t *net)
 {
+   uint16_t                ix;
+   os_thread_cfg_t         thread_cfg;
+
+   for (ix = 0; ix < NELEMENTS(net->cmdev_device.diag_hash); ix++)
+   {
+      net->cmdev_device.diag_hash[ix] = PF_DIAG_IX_NULL;
+   }
+
+   if (net->diag_nonvol_events == NULL)
+   {
+      net->diag_nonvol_events = os_event_create();
+   }
+
+   if (net->diag_nonvol_thread == NULL)
+   {
+      pf_fspm_get_thread_cfg(net, PNET_THREAD_BACKGROUND,
+         PF_DIAG_NONVOL_THREAD_PRIO, PF_DIAG_NONVOL_THREAD_STACKSIZE, &thread_cfg);
+      net->diag_nonvol_thread = os_thread_create_cfg("pn_diag_nonvol",
+         &thread_cfg, pf_diag_nonvol_thread, net);
+      if (net->diag_nonvol_thread == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "DIAG(%d): Could not create nonvol thread\n", __LINE__);
+      }
+   }
 
    return 0;
 }
 
+void pf_diag_nonvol_mark_dirty(
+   pnet_t                  *net)
+{
+   if (net->diag_nonvol_thread != NULL)
+   {
+      os_event_set(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DIRTY);
+   }
+   else
+   {
+      /* No background thread. Write synchronously, as the caller may hold the diag_mutex. */
+      (void)pf_nvs_save(net, PF_NVS_KEY_DIAG, net->cmdev_device.diag_items,
+                        sizeof(net->cmdev_device.diag_items));
+   }
+}
+
+void pf_diag_nonvol_flush(
+   pnet_t                  *net)
+{
+   uint32_t                flags = 0;
+
+   if (net->diag_nonvol_thread != NULL)
+   {
+      os_event_set(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_FLUSH);
+      (void)os_event_wait(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE, &flags, OS_WAIT_FOREVER);
+      os_event_clr(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE);
+   }
+}
+
 int pf_diag_restore(pnet_t *net)
 {
    /* Restore nonvol diag data and add to diag list */
    pf_diag_item_t 	temp_diag_items[PNET_MAX_DIAG_ITEMS];
    
-   if(os_restore_nvram_instance((char*)net->p_fspm_default_cfg->diagNonvolFilePath,
-							   temp_diag_items,
-							   sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS))
+   if(pf_nvs_load(net, PF_NVS_KEY_DIAG, temp_diag_items,
+							   sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS) == 0)
    {
 	   for(int i = 0; i<PNET_MAX_DIAG_ITEMS; i++)
 	   {
@@ -77,8 +221,26 @@ int pf_diag_restore(pnet_t *net)
    return 0;
 }
 
-int pf_diag_exit(void)
+int pf_diag_exit(pnet_t *net)
 {
+   uint32_t                flags = 0;
+
+   if (net->diag_nonvol_thread != NULL)
+   {
+      /* The thread writes any pending changes before it terminates */
+      os_event_set(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_EXIT);
+      (void)os_event_wait(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE, &flags, OS_WAIT_FOREVER);
+      os_event_clr(net->diag_nonvol_events, PF_DIAG_NONVOL_EVENT_DONE);
+      os_thread_join(net->diag_nonvol_thread);
+      net->diag_nonvol_thread = NULL;
+   }
+
+   if (net->diag_nonvol_events != NULL)
+   {
+      os_event_destroy(net->diag_nonvol_events);
+      net->diag_nonvol_events = NULL;
+   }
+
    return 0;
 }
 
@@ -94,31 +256,167 @@ static void pf_diag_update_station_problem_indicator(
    pf_ar_t                 *p_ar,
    pf_subslot_t            *p_subslot)
 {
-   bool                    is_problem = false;
-   pf_device_t             *p_dev = NULL;
-   uint16_t                ix;
-   pf_diag_item_t          *p_item;
+   /* A problem is indicated if at least one FAULT diagnosis exists. */
+   pf_ppm_set_problem_indicator(p_ar, p_subslot->diag_fault_count > 0);
+}
 
-   if (pf_cmdev_get_device(net, &p_dev) == 0)
+/**
+ * @internal
+ * Calculate the index chain of a diag item key.
+ *
+ * Items with USI in the manufacturer-specified range are keyed on the USI.
+ * Other items are keyed on the channel number, direction and error type.
+ *
+ * @param p_subslot        In:   The sub-slot instance.
+ * @param ch_nbr           In:   The channel number.
+ * @param ch_properties    In:   The channel properties.
+ * @param ch_error_type    In:   The error type.
+ * @param usi              In:   The USI.
+ * @return the chain index.
+ */
+static uint16_t pf_diag_hash(
+   const pf_subslot_t      *p_subslot,
+   uint16_t                ch_nbr,
+   uint16_t                ch_properties,
+   uint16_t                ch_error_type,
+   uint16_t                usi)
+{
+   uint32_t                h = (uint32_t)((uintptr_t)p_subslot / sizeof(pf_subslot_t));
+
+   if (usi < PF_USI_CHANNEL_DIAGNOSIS)
    {
-      /* A problem is indicated if at least one FAULT diagnosis exists. */
-      ix = p_subslot->diag_list;
-      pf_cmdev_get_diag_item(net, ix, &p_item);
-      while (p_item != NULL)
-      {
-         if ((p_item->in_use == true) &&
-             ((p_item->usi < PF_USI_CHANNEL_DIAGNOSIS) ||
-              (PNET_DIAG_CH_PROP_MAINT_GET(p_item->fmt.std.ch_properties) == PNET_DIAG_CH_PROP_MAINT_FAULT)))
-         {
-            is_problem = true;
-         }
+      h = h * 31 + usi;
+   }
+   else
+   {
+      h = h * 31 + ch_nbr;
+      h = h * 31 + PNET_DIAG_CH_PROP_DIR_GET(ch_properties);
+      h = h * 31 + ch_error_type;
+   }
+   h ^= h >> 16;
+   h *= 0x45d9f3b;
+   h ^= h >> 16;
 
-         ix = p_item->next;
-         pf_cmdev_get_diag_item(net, ix, &p_item);
-      }
+   return h & (PF_DIAG_HASH_SIZE - 1);
+}
+
+/**
+ * @internal
+ * Calculate the index chain of a diag item.
+ * @param p_subslot        In:   The sub-slot instance.
+ * @param p_item           In:   The diag item.
+ * @return the chain index.
+ */
+static uint16_t pf_diag_item_hash(
+   const pf_subslot_t      *p_subslot,
+   const pf_diag_item_t    *p_item)
+{
+   if (p_item->usi < PF_USI_CHANNEL_DIAGNOSIS)
+   {
+      return pf_diag_hash(p_subslot, 0, 0, 0, p_item->usi);
    }
 
-   pf_ppm_set_problem_indicator(p_ar, is_problem);
+   return pf_diag_hash(p_subslot, p_item->fmt.std.ch_nbr, p_item->fmt.std.ch_properties,
+      p_item->fmt.std.ch_error_type, p_item->usi);
+}
+
+/**
+ * @internal
+ * Return true if a diag item is a FAULT.
+ * @param p_item           In:   The diag item.
+ * @return  true if the item is a FAULT.
+ */
+static bool pf_diag_is_fault(
+   const pf_diag_item_t    *p_item)
+{
+   return (p_item->usi < PF_USI_CHANNEL_DIAGNOSIS) ||
+          (PNET_DIAG_CH_PROP_MAINT_GET(p_item->fmt.std.ch_properties) == PNET_DIAG_CH_PROP_MAINT_FAULT);
+}
+
+/**
+ * @internal
+ * Link a diag item first in the reported list of a sub-slot, and into the index.
+ *
+ * The item must not be modified while it is linked.
+ * The caller must hold the diag_mutex.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param p_subslot        InOut: The sub-slot instance.
+ * @param item_ix          In:   The diag item index.
+ */
+static void pf_diag_link(
+   pnet_t                  *net,
+   pf_subslot_t            *p_subslot,
+   uint16_t                item_ix)
+{
+   pf_device_t             *p_dev = &net->cmdev_device;
+   pf_diag_item_t          *p_item = &p_dev->diag_items[item_ix];
+   uint16_t                hash = pf_diag_item_hash(p_subslot, p_item);
+
+   p_item->next = p_subslot->diag_list;
+   p_dev->diag_prev[item_ix] = PF_DIAG_IX_NULL;
+   if (p_subslot->diag_list != PF_DIAG_IX_NULL)
+   {
+      p_dev->diag_prev[p_subslot->diag_list] = item_ix;
+   }
+   p_subslot->diag_list = item_ix;
+   p_dev->diag_subslot[item_ix] = p_subslot;
+
+   p_dev->diag_hash_next[item_ix] = p_dev->diag_hash[hash];
+   p_dev->diag_hash[hash] = item_ix;
+
+   if (pf_diag_is_fault(p_item) == true)
+   {
+      p_subslot->diag_fault_count++;
+   }
+}
+
+/**
+ * @internal
+ * Unlink a diag item from the reported list of its sub-slot, and from the index.
+ *
+ * The caller must hold the diag_mutex.
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param item_ix          In:   The diag item index. Must be linked.
+ */
+static void pf_diag_unlink(
+   pnet_t                  *net,
+   uint16_t                item_ix)
+{
+   pf_device_t             *p_dev = &net->cmdev_device;
+   pf_diag_item_t          *p_item = &p_dev->diag_items[item_ix];
+   pf_subslot_t            *p_subslot = p_dev->diag_subslot[item_ix];
+   uint16_t                prev_ix = p_dev->diag_prev[item_ix];
+   uint16_t                *p_ix;
+
+   if (prev_ix != PF_DIAG_IX_NULL)
+   {
+      p_dev->diag_items[prev_ix].next = p_item->next;
+   }
+   else
+   {
+      p_subslot->diag_list = p_item->next;
+   }
+   if (p_item->next != PF_DIAG_IX_NULL)
+   {
+      p_dev->diag_prev[p_item->next] = prev_ix;
+   }
+
+   /* The chains are short, so this is not a search of the whole index */
+   p_ix = &p_dev->diag_hash[pf_diag_item_hash(p_subslot, p_item)];
+   while (*p_ix != item_ix)
+   {
+      p_ix = &p_dev->diag_hash_next[*p_ix];
+   }
+   *p_ix = p_dev->diag_hash_next[item_ix];
+
+   if (pf_diag_is_fault(p_item) == true)
+   {
+      p_subslot->diag_fault_count--;
+   }
+   p_dev->diag_subslot[item_ix] = NULL;
+   p_item->next = PF_DIAG_IX_NULL;
 }
 
 /**
@@ -157,12 +455,10 @@ static void pf_diag_find_entry(
    pf_subslot_t            **pp_subslot,
    uint16_t                *p_diag_ix)
 {
-   pf_diag_item_t          *p_item = NULL;
-   pf_diag_item_t          *p_prev = NULL;
-   uint16_t                prev_ix;
+   pf_device_t             *p_dev = &net->cmdev_device;
+   pf_diag_item_t          *p_item;
    uint16_t                item_ix;
 
-
    *p_diag_ix = PF_DIAG_IX_NULL;
    *pp_subslot = NULL;
    if (pf_cmdev_get_subslot_full(net, api_id, slot_nbr, subslot_nbr, pp_subslot) == 0)
@@ -173,61 +469,35 @@ static void pf_diag_find_entry(
           (((*pp_subslot)->submodule_state.ar_info == PF_SUBMOD_AR_INFO_OWN) ||
            ((*pp_subslot)->submodule_state.ar_info == PF_SUBMOD_AR_INFO_APPLICATION_READY_PENDING)))
       {
-         prev_ix = PF_DIAG_IX_NULL;
-         item_ix = (*pp_subslot)->diag_list;
-         pf_cmdev_get_diag_item(net, item_ix, &p_item);
-         while ((p_item != NULL) && (*p_diag_ix == PF_DIAG_IX_NULL))
+         item_ix = p_dev->diag_hash[pf_diag_hash(*pp_subslot, ch_nbr, ch_properties, ch_error_type, usi)];
+         while ((item_ix != PF_DIAG_IX_NULL) && (*p_diag_ix == PF_DIAG_IX_NULL))
          {
-            /* Found a match if all of:
-             *    format is STD.
-             *    ch_nbr matches.
-             *    direction matches.
-             *    ch_error_type matches.
-             * ToDo: How do we find manuf_data diag entries??
-             */
-            if (p_item->usi >= PF_USI_CHANNEL_DIAGNOSIS)
+            p_item = &p_dev->diag_items[item_ix];
+            if (p_dev->diag_subslot[item_ix] == *pp_subslot)
             {
-               if ((p_item->fmt.std.ch_nbr == ch_nbr) &&
-                   (p_item->fmt.std.ch_error_type == ch_error_type) &&
-                   (PNET_DIAG_CH_PROP_DIR_GET(p_item->fmt.std.ch_properties) == PNET_DIAG_CH_PROP_DIR_GET(ch_properties)))
+               if (usi < PF_USI_CHANNEL_DIAGNOSIS)
                {
-                  *p_diag_ix = item_ix;
-
-                  /* Unlink it from the list so it can be updated. */
-                  if (prev_ix != PF_DIAG_IX_NULL)
+                  if (p_item->usi == usi)
                   {
-                     /* Not first in list */
-                     pf_cmdev_get_diag_item(net, prev_ix, &p_prev);
-                     p_prev->next = p_item->next;
+                     *p_diag_ix = item_ix;
                   }
-                  else
-                  {
-                     /* Unlink the first item in the list */
-                     (*pp_subslot)->diag_list = p_item->next;
-                  }
-               }
-            }
-            else if (p_item->usi == usi)
-            {
-               *p_diag_ix = item_ix;
-
-               /* Unlink it from the list so it can be updated. */
-               if (prev_ix != PF_DIAG_IX_NULL)
-               {
-                  /* Not first in list */
-                  pf_cmdev_get_diag_item(net, prev_ix, &p_prev);
-                  p_prev->next = p_item->next;
                }
-               else
+               else if ((p_item->usi >= PF_USI_CHANNEL_DIAGNOSIS) &&
+                        (p_item->fmt.std.ch_nbr == ch_nbr) &&
+                        (p_item->fmt.std.ch_error_type == ch_error_type) &&
+                        (PNET_DIAG_CH_PROP_DIR_GET(p_item->fmt.std.ch_properties) == PNET_DIAG_CH_PROP_DIR_GET(ch_properties)))
                {
-                  /* Unlink the first item in the list */
-                  (*pp_subslot)->diag_list = p_item->next;
+                  *p_diag_ix = item_ix;
                }
             }
 
-            prev_ix = item_ix;
-            item_ix = p_item->next;
-            pf_cmdev_get_diag_item(net, item_ix, &p_item);
+            item_ix = p_dev->diag_hash_next[item_ix];
+         }
+
+         if (*p_diag_ix != PF_DIAG_IX_NULL)
+         {
+            /* Unlink it from the list so it can be updated. */
+            pf_diag_unlink(net, *p_diag_ix);
          }
       }
       else
@@ -336,18 +606,15 @@ int pf_diag_add(
                 p_item->alarm_spec.ar_diagnosis = p_alarm_spec->ar_diagnosis;
                 
                 /* Link it into the sub-slot reported list */
-                p_item->next = p_subslot->diag_list;
-                p_subslot->diag_list = item_ix;
+                pf_diag_link(net, p_subslot, item_ix);
                 
                 set_problem_indicator = p_alarm_spec->channel_diagnosis ? true:false;
 
 				/*Set the problem indictor*/
 				pf_ppm_set_problem_indicator(p_ar,  set_problem_indicator);
 
-                /*Write to NVRAM */
-				os_save_nvram_instance((char*)net->p_fspm_default_cfg->diagNonvolFilePath,
-						                 net->cmdev_device.diag_items,
-						                 sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS);
+                /* Schedule write to NVRAM */
+				pf_diag_nonvol_mark_dirty(net);
 				
 				
 				
@@ -381,8 +648,7 @@ int pf_diag_add(
             if (ret == 0)
             {
                /* Link it into the sub-slot reported list */
-               p_item->next = p_subslot->diag_list;
-               p_subslot->diag_list = item_ix;
+               pf_diag_link(net, p_subslot, item_ix);
 
                if (overwrite == true)
                {
@@ -470,16 +736,13 @@ int pf_diag_update(
 				p_item->alarm_spec.ar_diagnosis = ((pnet_alarm_spec_t*)p_manuf_data)->ar_diagnosis;
 				
 				/* Link it into the sub-slot reported list */
-				p_item->next = p_subslot->diag_list;
-				p_subslot->diag_list = item_ix;
+				pf_diag_link(net, p_subslot, item_ix);
 				
 				/*Set the problem indictor*/
 				pf_ppm_set_problem_indicator(p_ar, ((pnet_alarm_spec_t*)p_manuf_data)->channel_diagnosis);
 				
-				/*ToDo: Write to NVRAM */
-				os_save_nvram_instance((char*)net->p_fspm_default_cfg->diagNonvolFilePath,
-						                 net->cmdev_device.diag_items,
-						                 sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS);
+				/* Schedule write to NVRAM */
+				pf_diag_nonvol_mark_dirty(net);
 				
 				os_mutex_unlock(p_dev->diag_mutex);
 				return 0;
@@ -494,8 +757,7 @@ int pf_diag_update(
             if (ret == 0)
             {
                /* Link it into the sub-slot diag list */
-               p_item->next = p_subslot->diag_list;
-               p_subslot->diag_list = item_ix;
+               pf_diag_link(net, p_subslot, item_ix);
 
                if (old_item.usi >= PF_USI_CHANNEL_DIAGNOSIS)
                {
@@ -583,10 +845,8 @@ int pf_diag_remove(
 		         /* Free diag entry */
 		         pf_cmdev_free_diag(net, item_ix);
 		         
-				/*Write to NVRAM */
-				os_save_nvram_instance((char*)net->p_fspm_default_cfg->diagNonvolFilePath,
-										 net->cmdev_device.diag_items,
-										 sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS);
+				/* Schedule write to NVRAM */
+				pf_diag_nonvol_mark_dirty(net);
 					
 				ret = 0;
 				return ret;
@@ -608,10 +868,8 @@ int pf_diag_remove(
 
          pf_diag_update_station_problem_indicator(net, p_ar, p_subslot);
          
-		/*Write to NVRAM */
-		os_save_nvram_instance((char*)net->p_fspm_default_cfg->diagNonvolFilePath,
-								 net->cmdev_device.diag_items,
-								 sizeof(pf_diag_item_t)*PNET_MAX_DIAG_ITEMS);
+		/* Schedule write to NVRAM */
+		pf_diag_nonvol_mark_dirty(net);
       }
       else
       {
@@ -663,8 +921,7 @@ int pf_diag_get(
 			 *p_diag_item = *p_item;
 			 
              /* Link it back into the sub-slot reported list */
-             p_item->next = p_subslot->diag_list;
-             p_subslot->diag_list = item_ix;
+             pf_diag_link(net, p_subslot, item_ix);
 		 }
 	  }
 	  else
@@ -776,8 +1033,7 @@ int pf_diag_restore_item(
 				p_item->alarm_spec.ar_diagnosis = p_alarm_spec->ar_diagnosis;
 				
 				/* Link it into the sub-slot reported list */
-				p_item->next = p_subslot->diag_list;
-				p_subslot->diag_list = item_ix;
+				pf_diag_link(net, p_subslot, item_ix);
 
 				os_mutex_unlock(p_dev->diag_mutex);
 				return 0;
@@ -805,8 +1061,7 @@ int pf_diag_restore_item(
 			if (ret == 0)
 			{
 			   /* Link it into the sub-slot reported list */
-			   p_item->next = p_subslot->diag_list;
-			   p_subslot->diag_list = item_ix;
+			   pf_diag_link(net, p_subslot, item_ix);
 
 			}
 		 }
@@ -41,9 +41,40 @@ int pf_diag_init(pnet_t *net);
 /**
  * Reset the diag component.
  *
+ * Pending diag changes are written to nonvolatile memory before
+ * this function returns.
+ *
+ * @param net              InOut: The p-net stack instance
  * @return  0  Always
  */
-int pf_diag_exit(void);
+int pf_diag_exit(pnet_t *net);
+
+/**
+ * Schedule the diag items for writing to nonvolatile memory.
+ *
+ * The write is done by a background thread. All changes made within
+ * the window given by pnet_cfg_t.diag_nonvol_window_ms are coalesced
+ * into a single write, so this function returns immediately.
+ *
+ * May be called with or without the device diag_mutex held.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_diag_nonvol_mark_dirty(
+   pnet_t                  *net);
+
+/**
+ * Write pending diag changes to nonvolatile memory now.
+ *
+ * Ends the current coalescing window, if any, and returns when the
+ * write is done. Nothing is written if there are no pending changes.
+ *
+ * Must not be called with the device diag_mutex held.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_diag_nonvol_flush(
+   pnet_t                  *net);
 
 /**
  * Add a diagnosis entry.
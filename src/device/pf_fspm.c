@@ -60,6 +60,8 @@ int pf_fspm_init(
       LOG_ERROR(PNET_LOG, "FSPM(%d): Could not turn signal LED off\n", __LINE__);
    }
 
+   pf_nvs_init(net);
+
    /* ToDo Restore I&M data from Nonvol*/
    pf_fspm_nonvol_restore(net);
 
@@ -386,6 +388,8 @@ int pf_fspm_cm_write_ind(
          p_write_status->pnio_status.error_code_2 = 0;
          break;
       }
+
+      pf_cmdev_ident_changed(net);
    }
    else
    {
@@ -408,7 +412,7 @@ int pf_fspm_clear_im_data(
    net->fspm_cfg.im_3_data.im_descriptor[sizeof(net->fspm_cfg.im_3_data.im_descriptor) - 1] = '\0';
    memset(net->fspm_cfg.im_4_data.im_signature, 0, sizeof(net->fspm_cfg.im_4_data.im_signature));
 
-   pf_fspm_nonvol_save(net);
+   pf_cmdev_ident_changed(net);
    
    return 0;
 }
@@ -423,6 +427,24 @@ void pf_fspm_get_cfg(
    }
 }
 
+void pf_fspm_get_thread_cfg(
+   pnet_t                  *net,
+   pnet_thread_t           thread,
+   int                     priority,
+   size_t                  stack_size,
+   os_thread_cfg_t         *p_thread_cfg)
+{
+   *p_thread_cfg = net->fspm_cfg.thread_cfg[thread];
+   if (p_thread_cfg->priority == 0)
+   {
+      p_thread_cfg->priority = priority;
+   }
+   if (p_thread_cfg->stack_size == 0)
+   {
+      p_thread_cfg->stack_size = stack_size;
+   }
+}
+
 void pf_fspm_get_default_cfg(
    pnet_t                  *net,
    const pnet_cfg_t        **pp_cfg)
@@ -599,36 +621,31 @@ int pf_fspm_signal_led_ind(
    return ret;
 }
 
+void pf_fspm_nonvol_get(pnet_t* net, NVRAM_IM_SAVE *p_im)
+{
+	 memcpy(&p_im->im_1_data, &net->fspm_cfg.im_1_data, sizeof(pnet_im_1_t));
+	 memcpy(&p_im->im_2_data, &net->fspm_cfg.im_2_data, sizeof(pnet_im_2_t));
+	 memcpy(&p_im->im_3_data, &net->fspm_cfg.im_3_data, sizeof(pnet_im_3_t));
+	 memcpy(&p_im->im_4_data, &net->fspm_cfg.im_4_data, sizeof(pnet_im_4_t));
+}
 
-typedef struct nvramIMSave
+void pf_fspm_nonvol_write(pnet_t* net, const NVRAM_IM_SAVE *p_im)
 {
-	pnet_im_1_t	im_1_data;
-	pnet_im_2_t im_2_data;
-	pnet_im_3_t im_3_data;
-	pnet_im_4_t im_4_data;	
-}NVRAM_IM_SAVE;
+	 (void)pf_nvs_save(net, PF_NVS_KEY_IM, p_im, sizeof(NVRAM_IM_SAVE));
+}
 
 void pf_fspm_nonvol_save(pnet_t* net)
 {
 	 NVRAM_IM_SAVE temp;
-	 memcpy(&temp.im_1_data, &net->fspm_cfg.im_1_data, sizeof(pnet_im_1_t));
-	 memcpy(&temp.im_2_data, &net->fspm_cfg.im_2_data, sizeof(pnet_im_2_t));
-	 memcpy(&temp.im_3_data, &net->fspm_cfg.im_3_data, sizeof(pnet_im_3_t));
-	 memcpy(&temp.im_4_data, &net->fspm_cfg.im_4_data, sizeof(pnet_im_4_t));
-	 
-	 os_save_nvram_instance((char*)net->p_fspm_default_cfg->IM_NonvolFilePath,
-			 	 	 	 	 &temp,
-	 						 sizeof(NVRAM_IM_SAVE));	
 
+	 pf_fspm_nonvol_get(net, &temp);
+	 pf_fspm_nonvol_write(net, &temp);
 }
 
 void pf_fspm_nonvol_restore(pnet_t* net)
 {
 	NVRAM_IM_SAVE temp;
-	BOOL status = os_restore_nvram_instance((char*)net->p_fspm_default_cfg->IM_NonvolFilePath,
-	      	   	              	   	        &temp,
-	      	   	   	                        sizeof(NVRAM_IM_SAVE));
-	if(status == TRUE)
+	if(pf_nvs_load(net, PF_NVS_KEY_IM, &temp, sizeof(NVRAM_IM_SAVE)) == 0)
 	{
 		memcpy(&net->fspm_cfg.im_1_data, &temp.im_1_data, sizeof(pnet_im_1_t));
 		memcpy(&net->fspm_cfg.im_2_data, &temp.im_2_data, sizeof(pnet_im_2_t));
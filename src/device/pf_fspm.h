@@ -302,6 +302,23 @@ int pf_fspm_signal_led_ind(
    pnet_t                  *net,
    bool                    led_state);
 
+/**
+ * Get the placement of one of the stack threads.
+ *
+ * Members that are 0 in the configuration are replaced by the defaults.
+ * @param net              InOut: The p-net stack instance
+ * @param thread           In:   The thread.
+ * @param priority         In:   The default priority of the thread.
+ * @param stack_size       In:   The default stack size of the thread.
+ * @param p_thread_cfg     Out:  The placement of the thread.
+ */
+void pf_fspm_get_thread_cfg(
+   pnet_t                  *net,
+   pnet_thread_t           thread,
+   int                     priority,
+   size_t                  stack_size,
+   os_thread_cfg_t         *p_thread_cfg);
+
 /**
  * Retrieve a pointer to the current configuration data.
  * @param net              InOut: The p-net stack instance
@@ -322,6 +339,8 @@ void pf_fspm_get_default_cfg(
 
 /**
  * Clear the I&M data records 1-4.
+ *
+ * They are not saved. See pf_fspm_nonvol_save().
  * @param net              InOut: The p-net stack instance
  * @return  0  if operation succeeded.
  *          -1 if an error occurred.
@@ -345,6 +364,24 @@ void pf_fspm_nonvol_restore(
 void pf_fspm_nonvol_save(
    pnet_t                  *net);
 
+/**
+ * Copy the I&M data that pf_fspm_nonvol_save() saves.
+ * @param net              In:   The p-net stack instance
+ * @param p_im             Out:  The I&M data.
+ */
+void pf_fspm_nonvol_get(
+   pnet_t                  *net,
+   NVRAM_IM_SAVE           *p_im);
+
+/**
+ * Save a copy of I&M Data to Nonvolatile Storage
+ * @param net              InOut: The p-net stack instance
+ * @param p_im             In:   The I&M data, from pf_fspm_nonvol_get().
+ */
+void pf_fspm_nonvol_write(
+   pnet_t                  *net,
+   const NVRAM_IM_SAVE     *p_im);
+
 #ifdef __cplusplus
 }
 #endif
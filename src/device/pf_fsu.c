@@ -0,0 +1,361 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+/* Positions in the ARBlockReq, which is the first block of the request */
+#define PF_FSU_AR_UUID_POS                8
+#define PF_FSU_SESSION_KEY_POS            24
+#define PF_FSU_MASK_END                   26
+
+#define PF_FSU_FNV_OFFSET                 2166136261u
+#define PF_FSU_FNV_PRIME                  16777619u
+
+/**
+ * @internal
+ * Check if the cache is kept in the nonvolatile store.
+ * @param net              InOut: The p-net stack instance
+ * @return  true if it is.
+ */
+static bool pf_fsu_nonvol(
+   pnet_t                  *net)
+{
+   const pnet_cfg_t        *p_cfg = NULL;
+
+   pf_fspm_get_default_cfg(net, &p_cfg);
+
+   return (p_cfg->fast_startup_nonvol == true) &&
+      (p_cfg->Journal_NonvolFilePath[0] != '\0');
+}
+
+/**
+ * @internal
+ * Check the bounds of an entry read from the nonvolatile store.
+ * @param p_entry          In:   The entry.
+ * @return  true if the entry can be used.
+ */
+static bool pf_fsu_entry_ok(
+   const pf_fsu_entry_t    *p_entry)
+{
+   uint16_t                ix;
+   uint32_t                nbr_desc = 0;
+
+   if ((p_entry->req_len > sizeof(p_entry->req)) ||
+       (p_entry->nbr_iocrs > NELEMENTS(p_entry->iocrs)) ||
+       (p_entry->nbr_desc > NELEMENTS(p_entry->desc)))
+   {
+      return false;
+   }
+   for (ix = 0; ix < p_entry->nbr_iocrs; ix++)
+   {
+      nbr_desc += p_entry->iocrs[ix].nbr_data_desc;
+   }
+
+   return nbr_desc == p_entry->nbr_desc;
+}
+
+void pf_fsu_init(
+   pnet_t                  *net)
+{
+   uint16_t                ix;
+
+   if (net->fsu.mutex == NULL)
+   {
+      net->fsu.mutex = os_mutex_create();
+   }
+   if (net->fsu.save_mutex == NULL)
+   {
+      net->fsu.save_mutex = os_mutex_create();
+   }
+   net->fsu.hits = 0;
+   net->fsu.misses = 0;
+
+   if ((pf_fsu_nonvol(net) == true) &&
+       (pf_nvs_load(net, PF_NVS_KEY_FSU, &net->fsu.cache, sizeof(net->fsu.cache)) == 0) &&
+       (net->fsu.cache.version == PF_FSU_VERSION))
+   {
+      net->fsu.cache.next %= PF_FSU_CACHE_ENTRIES;
+      for (ix = 0; ix < PF_FSU_CACHE_ENTRIES; ix++)
+      {
+         if (pf_fsu_entry_ok(&net->fsu.cache.entries[ix]) == false)
+         {
+            net->fsu.cache.entries[ix].valid = false;
+         }
+      }
+      LOG_INFO(PNET_LOG, "FSU(%d): Loaded the fast-startup cache\n", __LINE__);
+   }
+   else
+   {
+      memset(&net->fsu.cache, 0, sizeof(net->fsu.cache));
+      net->fsu.cache.version = PF_FSU_VERSION;
+   }
+}
+
+/**
+ * @internal
+ * Check if a request can be cached.
+ * @param p_req            In:   The blocks of the connect request.
+ * @param len              In:   The size of the blocks.
+ * @return  true if it can.
+ */
+static bool pf_fsu_cacheable(
+   const uint8_t           *p_req,
+   uint16_t                len)
+{
+   uint16_t                ix;
+   bool                    zero_uuid = true;
+
+   if ((len < PF_FSU_MASK_END) || (len > PF_FSU_REQUEST_SIZE))
+   {
+      return false;
+   }
+
+   /* A zero ARUUID is rejected by the checks, which must then not be skipped */
+   for (ix = PF_FSU_AR_UUID_POS; ix < PF_FSU_SESSION_KEY_POS; ix++)
+   {
+      if (p_req[ix] != 0)
+      {
+         zero_uuid = false;
+      }
+   }
+
+   return zero_uuid == false;
+}
+
+/**
+ * @internal
+ * Calculate the FNV-1a hash of a request, with the ARUUID and the
+ * SessionKey taken as zero.
+ * @param p_req            In:   The blocks of the connect request.
+ * @param len              In:   The size of the blocks.
+ * @return the hash.
+ */
+static uint32_t pf_fsu_fingerprint(
+   const uint8_t           *p_req,
+   uint16_t                len)
+{
+   uint32_t                hash = PF_FSU_FNV_OFFSET;
+   uint16_t                ix;
+
+   for (ix = 0; ix < len; ix++)
+   {
+      if ((ix < PF_FSU_AR_UUID_POS) || (ix >= PF_FSU_MASK_END))
+      {
+         hash ^= p_req[ix];
+      }
+      hash *= PF_FSU_FNV_PRIME;
+   }
+
+   return hash;
+}
+
+const pf_fsu_entry_t *pf_fsu_find(
+   pnet_t                  *net,
+   const uint8_t           *p_req,
+   uint16_t                len,
+   bool                    is_big_endian)
+{
+   const pf_fsu_entry_t    *p_found = NULL;
+   const pf_fsu_entry_t    *p_entry;
+   uint32_t                fingerprint;
+   uint16_t                ix;
+
+   if (pf_fsu_cacheable(p_req, len) == true)
+   {
+      fingerprint = pf_fsu_fingerprint(p_req, len);
+      for (ix = 0; (p_found == NULL) && (ix < PF_FSU_CACHE_ENTRIES); ix++)
+      {
+         p_entry = &net->fsu.cache.entries[ix];
+         if ((p_entry->valid == true) &&
+             (p_entry->fingerprint == fingerprint) &&
+             (p_entry->req_len == len) &&
+             (p_entry->is_big_endian == is_big_endian) &&
+             (memcmp(p_entry->req, p_req, PF_FSU_AR_UUID_POS) == 0) &&
+             (memcmp(&p_entry->req[PF_FSU_MASK_END], &p_req[PF_FSU_MASK_END], len - PF_FSU_MASK_END) == 0))
+         {
+            p_found = p_entry;
+         }
+      }
+   }
+
+   if (p_found != NULL)
+   {
+      net->fsu.hits++;
+      LOG_INFO(PNET_LOG, "FSU(%d): Known connect request. Using the cached AR configuration.\n", __LINE__);
+   }
+   else
+   {
+      net->fsu.misses++;
+   }
+
+   return p_found;
+}
+
+/**
+ * @internal
+ * Write the cache to the nonvolatile store.
+ *
+ * This is a job for the worker thread. Arguments should fulfill
+ * pf_worker_ftn_t
+ *
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   Not used.
+ */
+static void pf_fsu_save_nonvol(
+   pnet_t                  *net,
+   void                    *arg)
+{
+   /* A connect must not wait for the disk, only for the copy */
+   os_mutex_lock(net->fsu.save_mutex);
+   os_mutex_lock(net->fsu.mutex);
+   net->fsu.save_copy = net->fsu.cache;
+   os_mutex_unlock(net->fsu.mutex);
+
+   if (pf_nvs_save(net, PF_NVS_KEY_FSU, &net->fsu.save_copy, sizeof(net->fsu.save_copy)) != 0)
+   {
+      LOG_ERROR(PNET_LOG, "FSU(%d): Failed to save the fast-startup cache\n", __LINE__);
+   }
+   os_mutex_unlock(net->fsu.save_mutex);
+}
+
+void pf_fsu_save(
+   pnet_t                  *net,
+   const pf_ar_t           *p_ar,
+   const uint8_t           *p_req,
+   uint16_t                len,
+   bool                    is_big_endian)
+{
+   pf_fsu_entry_t          *p_entry;
+   const pf_iocr_t         *p_iocr;
+   const pf_iodata_object_t *p_iodata;
+   pf_fsu_desc_t           *p_desc;
+   uint16_t                nbr_desc = 0;
+   uint16_t                ix;
+   uint16_t                iy;
+
+   for (ix = 0; ix < p_ar->nbr_iocrs; ix++)
+   {
+      nbr_desc += p_ar->iocrs[ix].nbr_data_desc;
+   }
+
+   if ((pf_fsu_cacheable(p_req, len) == false) ||
+       (p_ar->nbr_iocrs > PF_MAX_IOCR) ||
+       (nbr_desc > PF_FSU_MAX_DESC))
+   {
+      LOG_DEBUG(PNET_LOG, "FSU(%d): Connect request too large to cache\n", __LINE__);
+      return;
+   }
+
+   os_mutex_lock(net->fsu.mutex);
+   p_entry = &net->fsu.cache.entries[net->fsu.cache.next];
+   net->fsu.cache.next = (net->fsu.cache.next + 1) % PF_FSU_CACHE_ENTRIES;
+
+   memset(p_entry, 0, sizeof(*p_entry));
+   memcpy(p_entry->req, p_req, len);
+   memset(&p_entry->req[PF_FSU_AR_UUID_POS], 0, PF_FSU_MASK_END - PF_FSU_AR_UUID_POS);
+   p_entry->req_len = len;
+   p_entry->is_big_endian = is_big_endian;
+   p_entry->fingerprint = pf_fsu_fingerprint(p_req, len);
+
+   p_entry->nbr_iocrs = p_ar->nbr_iocrs;
+   p_desc = p_entry->desc;
+   for (ix = 0; ix < p_ar->nbr_iocrs; ix++)
+   {
+      p_iocr = &p_ar->iocrs[ix];
+      p_entry->iocrs[ix].frame_id = p_iocr->param.frame_id;
+      p_entry->iocrs[ix].in_length = p_iocr->in_length;
+      p_entry->iocrs[ix].out_length = p_iocr->out_length;
+      p_entry->iocrs[ix].nbr_data_desc = p_iocr->nbr_data_desc;
+
+      for (iy = 0; iy < p_iocr->nbr_data_desc; iy++)
+      {
+         p_iodata = &p_iocr->data_desc[iy];
+         p_desc->api_id = p_iodata->api_id;
+         p_desc->slot_nbr = p_iodata->slot_nbr;
+         p_desc->subslot_nbr = p_iodata->subslot_nbr;
+         p_desc->data_offset = p_iodata->data_offset;
+         p_desc->data_length = p_iodata->data_length;
+         p_desc->iops_offset = p_iodata->iops_offset;
+         p_desc->iops_length = p_iodata->iops_length;
+         p_desc->iocs_offset = p_iodata->iocs_offset;
+         p_desc->iocs_length = p_iodata->iocs_length;
+         p_desc++;
+      }
+   }
+   p_entry->nbr_desc = nbr_desc;
+   p_entry->valid = true;
+   os_mutex_unlock(net->fsu.mutex);
+
+   if (pf_fsu_nonvol(net) == true)
+   {
+      pf_worker_post(net, pf_fsu_save_nonvol, NULL);
+   }
+}
+
+int pf_fsu_restore(
+   const pf_fsu_entry_t    *p_entry,
+   pf_ar_t                 *p_ar)
+{
+   pf_iocr_t               *p_iocr;
+   pf_iodata_object_t      *p_iodata;
+   const pf_fsu_desc_t     *p_desc = p_entry->desc;
+   uint16_t                ix;
+   uint16_t                iy;
+
+   if (p_entry->nbr_iocrs != p_ar->nbr_iocrs)
+   {
+      LOG_ERROR(PNET_LOG, "FSU(%d): Cached entry has %u IOCRs, not %u\n", __LINE__,
+         (unsigned)p_entry->nbr_iocrs, (unsigned)p_ar->nbr_iocrs);
+      return -1;
+   }
+
+   /* Done by the checks that are skipped */
+   if (p_ar->nbr_ar_param > 0)
+   {
+      p_ar->ar_param.valid = true;
+   }
+
+   for (ix = 0; ix < p_ar->nbr_iocrs; ix++)
+   {
+      p_iocr = &p_ar->iocrs[ix];
+      p_iocr->p_ar = p_ar;
+      p_iocr->crep = ix;
+      p_iocr->param.valid = true;
+      p_iocr->param.frame_id = p_entry->iocrs[ix].frame_id;
+      p_iocr->in_length = p_entry->iocrs[ix].in_length;
+      p_iocr->out_length = p_entry->iocrs[ix].out_length;
+      p_iocr->nbr_data_desc = p_entry->iocrs[ix].nbr_data_desc;
+
+      for (iy = 0; iy < p_iocr->nbr_data_desc; iy++)
+      {
+         p_iodata = &p_iocr->data_desc[iy];
+         memset(p_iodata, 0, sizeof(*p_iodata));
+         p_iodata->in_use = true;
+         p_iodata->api_id = p_desc->api_id;
+         p_iodata->slot_nbr = p_desc->slot_nbr;
+         p_iodata->subslot_nbr = p_desc->subslot_nbr;
+         p_iodata->data_offset = p_desc->data_offset;
+         p_iodata->data_length = p_desc->data_length;
+         p_iodata->iops_offset = p_desc->iops_offset;
+         p_iodata->iops_length = p_desc->iops_length;
+         p_iodata->iocs_offset = p_desc->iocs_offset;
+         p_iodata->iocs_length = p_desc->iocs_length;
+         p_desc++;
+      }
+   }
+
+   return 0;
+}
@@ -0,0 +1,107 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Fast-startup cache of connect requests.
+ *
+ * An IO-controller that reconnects, for example after a tool change, sends
+ * the same connect request each time, except for the ARUUID and the
+ * SessionKey. The checks of the request and the layout of the IOCR frames
+ * depend on the request only, so they are done once. The accepted request
+ * is kept with the derived IOCR layouts and frame IDs, and the next time
+ * the same request is received they are restored instead.
+ *
+ * The expected (sub-)modules are still configured for every connect, as the
+ * application is called to plug them, and the module diff is generated from
+ * the real configuration of the device.
+ *
+ * A request is identified by a hash of its blocks, and then compared in
+ * full, so a hash collision can never skip the checks.
+ *
+ * The cache can also be kept in the journal of the nonvolatile store, see
+ * pnet_cfg_t.fast_startup_nonvol.
+ */
+
+#ifndef PF_FSU_H
+#define PF_FSU_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * Clear the cache, or load it from the nonvolatile store.
+ *
+ * Must be called after pf_fspm_init().
+ * @param net              InOut: The p-net stack instance
+ */
+void pf_fsu_init(
+   pnet_t                  *net);
+
+/**
+ * Find a connect request that has been accepted before.
+ *
+ * The request must start with the AR block.
+ * @param net              InOut: The p-net stack instance
+ * @param p_req            In:   The blocks of the connect request.
+ * @param len              In:   The size of the blocks.
+ * @param is_big_endian    In:   The byte order of the request.
+ * @return the cached entry, or NULL if not found.
+ */
+const pf_fsu_entry_t *pf_fsu_find(
+   pnet_t                  *net,
+   const uint8_t           *p_req,
+   uint16_t                len,
+   bool                    is_big_endian);
+
+/**
+ * Remember an accepted connect request, with the IOCR layouts of its AR.
+ *
+ * Must be called after pf_cmdev_rm_connect_ind() has succeeded. Replaces
+ * the oldest entry. Requests larger than PF_FSU_REQUEST_SIZE are not
+ * cached.
+ * @param net              InOut: The p-net stack instance
+ * @param p_ar             In:   The AR instance.
+ * @param p_req            In:   The blocks of the connect request.
+ * @param len              In:   The size of the blocks.
+ * @param is_big_endian    In:   The byte order of the request.
+ */
+void pf_fsu_save(
+   pnet_t                  *net,
+   const pf_ar_t           *p_ar,
+   const uint8_t           *p_req,
+   uint16_t                len,
+   bool                    is_big_endian);
+
+/**
+ * Restore the IOCR layouts and frame IDs of an AR from the cache.
+ *
+ * Replaces the checks of the request and pf_cmdev_iocr_setup_desc().
+ * @param p_entry          In:   The entry found by pf_fsu_find().
+ * @param p_ar             InOut: The AR instance.
+ * @return  0  if the operation succeeded.
+ *          -1 if the entry does not fit the AR.
+ */
+int pf_fsu_restore(
+   const pf_fsu_entry_t    *p_entry,
+   pf_ar_t                 *p_ar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PF_FSU_H */
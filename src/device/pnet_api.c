@@ -20,6 +20,7 @@
 #define os_udp_close mock_os_udp_close
 
 #define os_eth_init mock_os_eth_init
+#define os_eth_destroy mock_os_eth_destroy
 #endif
 
 #include <stdlib.h>
@@ -28,12 +29,93 @@
 #include "pf_includes.h"
 #include "pf_block_reader.h"
 
+#define PNET_RX_THREAD_PRIO               10
+#define PNET_RX_THREAD_STACKSIZE          4096
+
+#define PNET_RT_FRAME_BUFFERS             32
+#define PNET_RT_HEAP_SIZE                 (256 * 1024)
+
+/* The public levels and modules are used as they are */
+CC_STATIC_ASSERT(PNET_LOG_LEVEL_DEBUG == LOG_LEVEL_DEBUG);
+CC_STATIC_ASSERT(PNET_LOG_LEVEL_INFO == LOG_LEVEL_INFO);
+CC_STATIC_ASSERT(PNET_LOG_LEVEL_WARNING == LOG_LEVEL_WARNING);
+CC_STATIC_ASSERT(PNET_LOG_LEVEL_ERROR == LOG_LEVEL_ERROR);
+CC_STATIC_ASSERT(PNET_LOG_LEVEL_OFF == LOG_LEVEL_OFF);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_ETH_LOG) == PNET_LOG_MODULE_ETH);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_CPM_LOG) == PNET_LOG_MODULE_CPM);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_PPM_LOG) == PNET_LOG_MODULE_PPM);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_DCP_LOG) == PNET_LOG_MODULE_DCP);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_RPC_LOG) == PNET_LOG_MODULE_RPC);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_ALARM_LOG) == PNET_LOG_MODULE_ALARM);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PF_AL_BUF_LOG) == PNET_LOG_MODULE_AL_BUF);
+CC_STATIC_ASSERT(LOG_MODULE_GET(PNET_LOG) == PNET_LOG_MODULE_PNET);
+CC_STATIC_ASSERT(PNET_LOG_MODULE_ALL <= LOG_MODULE_COUNT);
+
+uint8_t pf_log_module_level[LOG_MODULE_COUNT] =
+{
+   LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL,
+   LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL,
+   LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL,
+   LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL, LOG_RUNTIME_LEVEL,
+};
+
+/**
+ * @internal
+ * Stop and free an instance that pnet_init() could not complete.
+ *
+ * Every thread started so far is stopped before anything is freed. The
+ * RPC thread must not have been started.
+ * @param net              InOut: The p-net stack instance
+ */
+static void pnet_free(
+   pnet_t                  *net)
+{
+   /* No more frames may be handled once net is freed */
+   if (net->eth_handle != NULL)
+   {
+      os_eth_destroy(net->eth_handle);
+      net->eth_handle = NULL;
+   }
+   pf_metrics_exit(net);
+   pf_worker_exit(net);
+   pf_cmdev_exit(net);     /* Joins the diag nonvol thread */
+   pf_cmrpc_exit(net);
+   pf_cmina_exit(net);
+   pf_ptcp_exit(net);
+   if (net->worker_mutex != NULL)
+   {
+      os_mutex_destroy(net->worker_mutex);   /* Kept by pf_worker_exit() */
+   }
+
+   pf_cmrpc_free(net);
+   pf_cmdmc_exit(net);
+   pf_scheduler_exit(net);
+   pf_eth_exit(net);
+   os_free(net);
+}
+
 pnet_t* pnet_init(
    const char              *netif,
    uint32_t                tick_us,
    const pnet_cfg_t        *p_cfg)
 {
    pnet_t                  *net;
+   os_thread_cfg_t         thread_cfg;
+   uint16_t                frame_buffers;
+
+   if ((p_cfg != NULL) && (p_cfg->rt_startup == true))
+   {
+      /* Before anything is allocated, so that later pages are locked too */
+      if (os_mem_lock(PNET_RT_HEAP_SIZE) != 0)
+      {
+         LOG_WARNING(PNET_LOG, "API(%d): Could not lock memory. Check the memlock limit.\n", __LINE__);
+      }
+      frame_buffers = (p_cfg->rt_frame_buffers > 0) ? p_cfg->rt_frame_buffers : PNET_RT_FRAME_BUFFERS;
+      if (os_buf_pool_init(frame_buffers) != 0)
+      {
+         LOG_WARNING(PNET_LOG, "API(%d): Could not preallocate %u frame buffers\n", __LINE__, (unsigned)frame_buffers);
+      }
+   }
 
    net = os_malloc(sizeof(*net));
    if (net == NULL)
@@ -41,11 +123,24 @@ pnet_t* pnet_init(
       return NULL;
    }
 
-   memset(net, 0, sizeof(*net));
+   memset(net, 0, sizeof(*net));    /* Also faults in all of the instance */
+
+   net->max_ar = PNET_MAX_AR;
+   if ((p_cfg != NULL) && (p_cfg->max_ar > 0))
+   {
+      net->max_ar = p_cfg->max_ar;
+   }
+   if (net->max_ar > PNET_MAX_AR_LIMIT)
+   {
+      LOG_ERROR(PNET_LOG, "API(%d): max_ar %u is above %u\n", __LINE__, (unsigned)net->max_ar, (unsigned)PNET_MAX_AR_LIMIT);
+      pnet_free(net);
+      return NULL;
+   }
 
    if (strlen(netif) > PNET_MAX_INTERFACE_NAME_LENGTH)
    {
       LOG_ERROR(PNET_LOG, "Too long interface name\n");
+      pnet_free(net);
       return NULL;
    }
    strcpy(net->interface_name, netif);
@@ -53,40 +148,83 @@ pnet_t* pnet_init(
    net->cmdev_initialized = false;  /* TODO How to handle that pf_cmdev_exit() is used before pf_cmdev_init()? */
 
    pf_cmsu_init(net);
+   pf_cmdmc_init(net);
    pf_cmwrr_init(net);
    pf_cpm_init(net);
    pf_ppm_init(net);
-   pf_alarm_init(net);
+   pf_dfp_init();
 
    /* pnet_cm_init_req */
    pf_fspm_init(net, p_cfg);    /* Init cfg */
 
+   /* The frame handlers, timeouts and ARs are sized for max_ar */
+   if ((pf_eth_init(net) != 0) ||
+       (pf_scheduler_init(net, tick_us) != 0) ||
+       (pf_cmrpc_alloc(net) != 0))
+   {
+      LOG_ERROR(PNET_LOG, "API(%d): Could not allocate for %u ARs\n", __LINE__, (unsigned)net->max_ar);
+      pnet_free(net);
+      return NULL;
+   }
+   pf_alarm_init(net);
+   pf_worker_init(net);    /* Before any frame can arrive */
+
    /* Initialize everything (and the DCP protocol) */
    /* First initialize the network interface */
-   net->eth_handle = os_eth_init(netif, pf_eth_recv, (void*)net);
+   pf_fspm_get_thread_cfg(net, PNET_THREAD_RX,
+      PNET_RX_THREAD_PRIO, PNET_RX_THREAD_STACKSIZE, &thread_cfg);
+   net->eth_handle = os_eth_init(netif, pf_eth_recv, (void*)net, &thread_cfg);
    if (net->eth_handle == NULL)
    {
-	   if(net)
-		   free(net);
-       return NULL;
+      pnet_free(net);
+      return NULL;
    }
 
-   pf_eth_init(net);
-   pf_scheduler_init(net, tick_us);
    pf_cmina_init(net);  /* Read from permanent pool */
 
    pf_dcp_exit(net);    /* Prepare for re-init. */
    pf_dcp_init(net);    /* Start DCP */
    pf_lldp_init(net);   /* Send the LLDP frame */
+   pf_ptcp_init(net);
+   pf_cmsr_init(net);
+   pf_fsu_init(net);
 
    pf_cmdev_exit(net);     /* Prepare for re-init */
    pf_cmdev_init(net);
 
    net->udpThread = pf_cmrpc_init(net);
+   if (net->udpThread == NULL)
+   {
+      LOG_ERROR(PNET_LOG, "Could not create the RPC thread\n");
+      pnet_free(net);
+      return NULL;
+   }
+
+   pf_metrics_init(net);
 
    return net;
 }
 
+/**
+ * @internal
+ * Warn once per PRMEND if anything was allocated after it.
+ *
+ * @param net              InOut: The p-net stack instance
+ */
+static void pnet_check_rt_allocations(
+   pnet_t                  *net)
+{
+   uint32_t                count = 0;
+
+   if ((__atomic_load_n(&net->rt_alloc_reported, __ATOMIC_RELAXED) == false) &&
+       (pnet_get_rt_allocations(net, &count) == 0) &&
+       (count > 0))
+   {
+      LOG_WARNING(PNET_LOG, "API(%d): %u heap allocation(s) after PRMEND\n", __LINE__, (unsigned)count);
+      __atomic_store_n(&net->rt_alloc_reported, true, __ATOMIC_RELAXED);
+   }
+}
+
 void pnet_handle_periodic(
    pnet_t                  *net)
 {
@@ -97,6 +235,72 @@ void pnet_handle_periodic(
 
    /* Handle expired timeout events */
    pf_scheduler_tick(net);
+
+   pf_metrics_periodic(net);
+
+   pnet_check_rt_allocations(net);
+}
+
+int pnet_get_fd(
+   pnet_t                  *net)
+{
+   os_poll_t               *p_poll = NULL;
+
+   if (net == NULL)
+   {
+      return -1;
+   }
+
+   p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+   if (p_poll == NULL)
+   {
+      p_poll = os_poll_create();
+      if (p_poll == NULL)
+      {
+         LOG_ERROR(PNET_LOG, "API(%d): Could not create the event loop descriptor\n", __LINE__);
+         return -1;
+      }
+
+      /* Timeouts now run when due, so there is no tick to compensate for */
+      net->scheduler_tick_interval = 1;
+
+      /* Read by the receive and RPC threads */
+      __atomic_store_n(&net->poll, p_poll, __ATOMIC_RELEASE);
+
+      pf_cmrpc_poll_init(net);
+      pf_scheduler_arm_poll(net);
+      os_poll_wake(p_poll);   /* Handle anything that is already pending */
+   }
+
+   return os_poll_fd(p_poll);
+}
+
+int pnet_next_deadline(
+   pnet_t                  *net,
+   uint32_t                *p_delay_us)
+{
+   if ((net == NULL) || (p_delay_us == NULL))
+   {
+      return -1;
+   }
+
+   return pf_scheduler_next_delay(net, p_delay_us);
+}
+
+void pnet_process(
+   pnet_t                  *net)
+{
+   os_poll_t               *p_poll = __atomic_load_n(&net->poll, __ATOMIC_ACQUIRE);
+
+   if (p_poll != NULL)
+   {
+      /* Before the work, so that new events make the descriptor readable */
+      os_poll_clear(p_poll);
+   }
+
+   pnet_handle_periodic(net);
+
+   pf_scheduler_arm_poll(net);
 }
 
 void pnet_show(
@@ -249,7 +453,7 @@ int pnet_set_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -276,7 +480,7 @@ int pnet_set_redundancy_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -303,7 +507,7 @@ int pnet_set_provider_state(
    uint16_t                cr_ix;
    pf_ar_t                 *p_ar = NULL;
 
-   for (ar_ix = 0; ar_ix < PNET_MAX_AR; ar_ix++)
+   for (ar_ix = 0; ar_ix < net->max_ar; ar_ix++)
    {
       p_ar = pf_ar_find_by_index(net, ar_ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -358,7 +562,7 @@ int pnet_factory_reset(
    pf_ar_t                 *p_ar = NULL;
 
    /* Look for active connections */
-   for (ix = 0; ix < PNET_MAX_AR; ix++)
+   for (ix = 0; ix < net->max_ar; ix++)
    {
       p_ar = pf_ar_find_by_index(net, ix);
       if ((p_ar != NULL) && (p_ar->in_use == true))
@@ -506,6 +710,111 @@ int pnet_diag_remove(
    return ret;
 }
 
+int pnet_set_log_level(
+   pnet_t                  *net,
+   pnet_log_module_t       module,
+   uint8_t                 level)
+{
+   uint16_t                ix;
+
+   if (level > LOG_LEVEL_OFF)
+   {
+      return -1;
+   }
+
+   if (module == PNET_LOG_MODULE_ALL)
+   {
+      for (ix = 0; ix < NELEMENTS(pf_log_module_level); ix++)
+      {
+         PF_LOG_LEVEL_SET(ix, level);
+      }
+   }
+   else if ((unsigned)module < PNET_LOG_MODULE_ALL)
+   {
+      PF_LOG_LEVEL_SET(module, level);
+   }
+   else
+   {
+      return -1;
+   }
+
+   return 0;
+}
+
+int pnet_get_log_level(
+   pnet_t                  *net,
+   pnet_log_module_t       module,
+   uint8_t                 *p_level)
+{
+   if ((unsigned)module >= PNET_LOG_MODULE_ALL)
+   {
+      return -1;
+   }
+
+   *p_level = PF_LOG_LEVEL_GET(module);
+
+   return 0;
+}
+
+int pnet_get_interface_statistics(
+   pnet_t                  *net,
+   pnet_interface_stats_t  *p_stats)
+{
+   if ((net == NULL) || (p_stats == NULL))
+   {
+      return -1;
+   }
+
+   pf_stats_get(net, p_stats);
+
+   return 0;
+}
+
+int pnet_get_ptcp_status(
+   pnet_t                  *net,
+   pnet_ptcp_status_t      *p_status)
+{
+   if ((net == NULL) || (p_status == NULL))
+   {
+      return -1;
+   }
+
+   return pf_ptcp_get_status(net, p_status);
+}
+
+int pnet_get_sr_status(
+   pnet_t                  *net,
+   pnet_sr_status_t        *p_status)
+{
+   int                     ret = -1;
+
+   if ((net != NULL) && (p_status != NULL))
+   {
+#if PNET_OPTION_SR
+      pf_cmsr_get_status(net, p_status);
+      ret = 0;
+#endif
+   }
+
+   return ret;
+}
+
+int pnet_get_rt_allocations(
+   pnet_t                  *net,
+   uint32_t                *p_count)
+{
+   if ((net == NULL) || (p_count == NULL) ||
+       (net->fspm_cfg.rt_startup == false) ||
+       (__atomic_load_n(&net->rt_prmend_seen, __ATOMIC_ACQUIRE) == false))
+   {
+      return -1;
+   }
+
+   *p_count = os_alloc_count() - __atomic_load_n(&net->rt_alloc_count_prmend, __ATOMIC_RELAXED);
+
+   return 0;
+}
+
 PNET_EXPORT void pnet_restore_diag(
    pnet_t                  *net)
 {
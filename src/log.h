@@ -37,19 +37,45 @@ extern "C"
 #define LOG_LEVEL_MASK    0x03
 #define LOG_LEVEL_GET(t)  (t & LOG_LEVEL_MASK)
 
+/* Runtime level that disables all messages of a module */
+#define LOG_LEVEL_OFF     0x04
+
 /* Log states */
 #define LOG_STATE_ON      0x80
 #define LOG_STATE_OFF     0x00
 
-/** Log a message if it is enabled */
-#define LOG(type, ...)                          \
-do                                              \
-{                                               \
-   if ((LOG_LEVEL_GET (type) >= LOG_LEVEL) &&   \
-       (type & LOG_STATE_ON))                   \
-      {                                         \
-         os_log (type, __VA_ARGS__);            \
-      }                                         \
+/* Log modules. The module is used to look up its runtime level. */
+#define LOG_MODULE_SHIFT  2
+#define LOG_MODULE_MASK   0x3c
+#define LOG_MODULE_COUNT  16
+#define LOG_MODULE(n)     ((n) << LOG_MODULE_SHIFT)
+#define LOG_MODULE_GET(t) ((t & LOG_MODULE_MASK) >> LOG_MODULE_SHIFT)
+
+/**
+ * Runtime log level of each module, see pnet_set_log_level().
+ * Shared by all stack instances. Only use PF_LOG_LEVEL_GET() and
+ * PF_LOG_LEVEL_SET(), as any thread may change the levels.
+ */
+extern uint8_t pf_log_module_level[LOG_MODULE_COUNT];
+
+#define PF_LOG_LEVEL_GET(m)      __atomic_load_n (&pf_log_module_level[m], __ATOMIC_RELAXED)
+#define PF_LOG_LEVEL_SET(m, l)   __atomic_store_n (&pf_log_module_level[m], (l), __ATOMIC_RELAXED)
+
+/**
+ * Log a message if it is enabled.
+ *
+ * Messages below LOG_LEVEL are removed at compile time. The others
+ * cost one byte load and compare while disabled at runtime.
+ */
+#define LOG(type, ...)                                                  \
+do                                                                      \
+{                                                                       \
+   if ((LOG_LEVEL_GET (type) >= LOG_LEVEL) &&                           \
+       (type & LOG_STATE_ON) &&                                         \
+       (LOG_LEVEL_GET (type) >= PF_LOG_LEVEL_GET (LOG_MODULE_GET (type)))) \
+      {                                                                 \
+         os_log (type, __VA_ARGS__);                                    \
+      }                                                                 \
 } while(0)
 
 /** Log debug messages */
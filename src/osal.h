@@ -129,14 +129,116 @@ typedef struct os_ethaddr
 
 int os_snprintf (char * str, size_t size, const char * fmt, ...) CC_FORMAT (3,4);
 void os_log (int type, const char * fmt, ...) CC_FORMAT (2,3);
+
+/**
+ * Write all pending log messages before returning.
+ *
+ * os_log() may write its messages later, from a background thread.
+ */
+void os_log_flush (void);
 void * os_malloc (size_t size);
+void os_free (void * ptr);
+
+/**
+ * Get the number of heap allocations made so far by os_malloc(), by the
+ * OSAL itself and by os_buf_alloc() when its pool was empty.
+ *
+ * The stack and the OSAL allocate only with os_malloc(). This includes the
+ * thread handles and the per-thread log rings of os_thread_create().
+ *
+ * Compare two readings to find out whether anything was allocated in
+ * between.
+ *
+ * @return  The number of allocations since start-up. It wraps at 2^32.
+ */
+uint32_t os_alloc_count (void);
+
+/**
+ * Keep the memory of the process resident, so that first use of a page
+ * does not cause a page fault in a time-critical path.
+ *
+ * All present and future pages are locked, memory freed to the heap is
+ * kept there, and \a heap_size bytes of heap are touched once. The stacks of
+ * threads created afterwards are touched before the threads start running.
+ *
+ * @param heap_size        In:   Bytes of heap to fault in. May be 0.
+ * @return  0 on success, or -1 if the memory could not be locked (for
+ *          example when the memory lock limit is too low). The other steps
+ *          are done anyway.
+ */
+int os_mem_lock (size_t heap_size);
 
 void os_usleep (uint32_t us);
 uint32_t os_get_current_time_us (void);
 
+/**
+ * Get the current monotonic time in nanoseconds.
+ *
+ * Unlike os_get_current_time_us() this does not wrap during the lifetime of
+ * the device, so values can be compared directly.
+ *
+ * Ports that extend a narrower counter, such as the 32-bit tick of
+ * rt-kernel, count its wraps here. They must then be called at least once
+ * per counter period, which the scheduler of the stack does.
+ *
+ * @return  Nanoseconds since an arbitrary starting point.
+ */
+uint64_t os_get_current_time_ns (void);
+
 os_thread_t * os_thread_create (const char * name, int priority,
         int stacksize, void (*entry) (void * arg), void * arg);
 
+/** Scheduling policy of a thread, see os_thread_cfg_t */
+typedef enum os_sched_policy
+{
+   OS_SCHED_DEFAULT = 0,   /**< As os_thread_create() */
+   OS_SCHED_OTHER,         /**< Time sharing. The priority is not used */
+   OS_SCHED_FIFO,
+   OS_SCHED_RR,
+} os_sched_policy_t;
+
+/**
+ * Placement of a thread. All members zero gives the same thread as
+ * os_thread_create() with priority 0 and the default stack size.
+ */
+typedef struct os_thread_cfg
+{
+   uint64_t                cpu_mask;   /**< Bit n allows CPU n. 0 allows all CPUs */
+   os_sched_policy_t       policy;
+   int                     priority;
+   size_t                  stack_size; /**< Bytes, as for os_thread_create(). */
+} os_thread_cfg_t;
+
+/**
+ * Create a thread with the given placement.
+ *
+ * The new thread checks its CPU affinity, scheduling policy, priority and
+ * stack size before \a entry is called. If any of them did not take effect
+ * then the thread exits without calling \a entry.
+ *
+ * Ports that do not support a setting ignore it.
+ *
+ * @param name          In: Name of the thread
+ * @param p_cfg         In: Placement of the thread
+ * @param entry         In: Thread function
+ * @param arg           InOut: Argument to the thread function
+ * @return  the thread, or NULL if it could not be created with the given
+ *          placement.
+ */
+os_thread_t * os_thread_create_cfg (const char * name,
+        const os_thread_cfg_t * p_cfg, void (*entry) (void * arg), void * arg);
+
+/**
+ * Wait for a thread to return from its thread function and release it.
+ *
+ * The caller must first make the thread return. \a thread is not valid
+ * afterwards.
+ *
+ * @param thread        In: Thread from os_thread_create() or
+ *                          os_thread_create_cfg()
+ */
+void os_thread_join (os_thread_t * thread);
+
 os_mutex_t * os_mutex_create (void);
 void os_mutex_lock (os_mutex_t * mutex);
 void os_mutex_unlock (os_mutex_t * mutex);
@@ -160,6 +262,13 @@ void os_mbox_destroy (os_mbox_t * mbox);
 
 #if PNET_OS_RTOS_SUPPORTED == 0
 os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t * timer), void * arg, bool oneshot);
+
+/**
+ * Create a timer whose callback thread, if any, has the given placement.
+ * See os_thread_create_cfg().
+ */
+os_timer_t * os_timer_create_cfg (uint32_t us, void (*fn) (os_timer_t * timer, void * arg), void * arg, bool oneshot,
+                                  const os_thread_cfg_t * p_thread_cfg);
 void os_timer_start (os_timer_t * timer);
 void os_timer_stop (os_timer_t * timer);
 void os_timer_destroy (os_timer_t * timer);
@@ -176,10 +285,30 @@ void os_timer_stop (os_timer_t * timer);
 void os_timer_destroy (os_timer_t * timer);
 void os_timer_thread_destroy(os_timer_handle_t * timerHandle);
 #endif
+/**
+ * Preallocate buffers for os_buf_alloc().
+ *
+ * Requests of up to OS_BUF_MAX_SIZE bytes are then served from the pool,
+ * and os_buf_free() returns the buffers to it. When the pool is empty,
+ * os_buf_alloc() falls back to the heap, which os_alloc_count() shows.
+ *
+ * @param count            In:   Number of buffers.
+ * @return  0 on success, or -1 if the pool could not be allocated or
+ *          already exists.
+ */
+int os_buf_pool_init (uint16_t count);
 os_buf_t * os_buf_alloc(uint16_t length);
 void os_buf_free(os_buf_t *p);
 uint8_t os_buf_header(os_buf_t *p, int16_t header_size_increment);
 
+/**
+ * Get the number of allocated buffers.
+ *
+ * @return  The number of buffers allocated with os_buf_alloc() and not
+ *          yet freed, or -1 if not known.
+ */
+int os_buf_count (void);
+
 /**
  * Send raw Ethernet data
  *
@@ -191,6 +320,20 @@ int os_eth_send(
    os_eth_handle_t         *handle,
    os_buf_t                *buf);
 
+/**
+ * Get the receive time of the frame being handled.
+ *
+ * Only valid in the reception call-back, for the frame it was called with.
+ * The time is taken by the network interface if it supports hardware
+ * timestamps, else by the network driver when the frame arrived, else when
+ * the frame was read.
+ *
+ * @param handle        In: Ethernet handle
+ * @return  The receive time, on the clock of os_get_current_time_ns().
+ */
+uint64_t os_eth_rx_timestamp(
+   os_eth_handle_t         *handle);
+
 /**
  * Send LLDP data
  *
@@ -208,13 +351,16 @@ int os_eth_lldp_send(
  * @param if_name       In: Ethernet interface name
  * @param callback      In: Callback for received raw Ethernet frames
  * @param arg           InOut: User argument passed to the callback
+ * @param p_thread_cfg  In: Placement of the receive thread, if any.
+ *                          NULL selects the default.
  *
  * @return  the Ethernet handle, or NULL if an error occurred.
  */
 os_eth_handle_t* os_eth_init(
    const char              *if_name,
    os_eth_callback_t       *callback,
-   void                    *arg);
+   void                    *arg,
+   const os_thread_cfg_t   *p_thread_cfg);
 
 int os_udp_open(os_ipaddr_t addr, os_ipport_t port);
 int os_udp_sendto(uint32_t id,
@@ -229,6 +375,112 @@ int os_udp_recvfrom(uint32_t id,
       int size);
 void os_udp_close(uint32_t id);
 
+/**
+ * Open a TCP socket listening for connections.
+ *
+ * @param addr          In: Local IP address, e.g. OS_MAKEU32(127,0,0,1)
+ * @param port          In: Local port
+ * @return  The socket, or -1 if an error occurred.
+ */
+int os_tcp_listen (os_ipaddr_t addr, os_ipport_t port);
+
+/**
+ * Accept a connection on a listening TCP socket.
+ *
+ * @param id            In: Listening socket
+ * @param tmo           In: Timeout in milliseconds
+ * @return  The connected socket, or -1 on timeout or error.
+ */
+int os_tcp_accept (uint32_t id, uint32_t tmo);
+
+/**
+ * Receive data on a connected TCP socket.
+ *
+ * @param id            In: Connected socket
+ * @param data          Out: Received data
+ * @param size          In: Size of data buffer
+ * @param tmo           In: Timeout in milliseconds
+ * @return  The number of bytes received, 0 if the peer closed the
+ *          connection, or -1 on timeout or error.
+ */
+int os_tcp_recv (uint32_t id, uint8_t * data, int size, uint32_t tmo);
+
+/**
+ * Send all data on a connected TCP socket.
+ *
+ * @param id            In: Connected socket
+ * @param data          In: Data to send
+ * @param size          In: Number of bytes to send
+ * @param tmo           In: Timeout in milliseconds, each time the peer
+ *                          does not read
+ * @return  The number of bytes sent, or -1 on timeout or error.
+ */
+int os_tcp_send (uint32_t id, const uint8_t * data, int size, uint32_t tmo);
+
+void os_tcp_close (uint32_t id);
+
+/**
+ * Create a descriptor that an event loop can wait on with poll(), epoll or
+ * similar. It becomes readable when a watched socket is readable, when
+ * os_poll_wake() is called or when the timeout set by os_poll_arm()
+ * expires.
+ *
+ * @return  The poll instance, or NULL if an error occurred or the platform
+ *          has no file descriptors.
+ */
+os_poll_t * os_poll_create (void);
+
+/**
+ * Get the descriptor of a poll instance.
+ *
+ * @param poll          In: Poll instance
+ * @return  The descriptor.
+ */
+int os_poll_fd (os_poll_t * poll);
+
+/**
+ * Watch a socket for input. A closed socket is no longer watched.
+ *
+ * @param poll          In: Poll instance
+ * @param id            In: Socket
+ * @return  0 on success, or -1 if an error occurred.
+ */
+int os_poll_add (os_poll_t * poll, uint32_t id);
+
+/**
+ * Make the descriptor readable. May be called from any thread.
+ *
+ * @param poll          In: Poll instance
+ */
+void os_poll_wake (os_poll_t * poll);
+
+/**
+ * Make the descriptor readable after a delay. Replaces an earlier timeout.
+ * May be called from any thread.
+ *
+ * @param poll          In: Poll instance
+ * @param delay         In: Delay in microseconds. 0 means now.
+ */
+void os_poll_arm (os_poll_t * poll, uint32_t delay);
+
+/**
+ * Cancel the timeout set by os_poll_arm().
+ *
+ * @param poll          In: Poll instance
+ */
+void os_poll_disarm (os_poll_t * poll);
+
+/**
+ * Acknowledge wake-ups and an expired timeout, so that the descriptor is
+ * readable again only on new events. Readable sockets still make it
+ * readable until their data is read.
+ *
+ * @param poll          In: Poll instance
+ */
+void os_poll_clear (os_poll_t * poll);
+
+void os_poll_destroy (os_poll_t * poll);
+
 /**
  * Get network parameters (IP address, netmask etc)
  *
@@ -357,6 +609,14 @@ void os_get_button(
 */
 void os_stack_to_app_event(uint32_t value);
 void os_stack_set_ip_suite(bool bSavePermanent);
+
+/**
+ * Stop receiving raw Ethernet frames. Waits for the receive thread, if any,
+ * to return, and closes the interface.
+ *
+ * @param handle        In: Ethernet handle from os_eth_init(). Not valid
+ *                          afterwards.
+ */
 void os_eth_destroy(os_eth_handle_t *handle);
 
 /* Nonvolatile file storage */
@@ -364,6 +624,77 @@ BOOL os_init_nvram_instance(char* filePath);
 BOOL os_save_nvram_instance(char* filePath, void* data, int len);
 BOOL os_restore_nvram_instance(char* filePath, void* data, int len);
 
+/**
+ * Read from a file.
+ *
+ * @param path          In: File name
+ * @param offset        In: Position in the file to start reading from
+ * @param data          Out: Buffer for the data
+ * @param size          In: Max number of bytes to read
+ * @return  The number of bytes read (0 at end of file), or -1 if an error
+ *          occurred. A file that does not exist is an error.
+ */
+int os_file_read(
+   const char              *path,
+   uint32_t                offset,
+   void                    *data,
+   uint32_t                size);
+
+/**
+ * Append data to a file, creating it if it does not exist.
+ *
+ * The data may be cached. Call os_file_sync() to write it to the
+ * storage media.
+ *
+ * @param path          In: File name
+ * @param data          In: Data to append
+ * @param size          In: Number of bytes to append
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int os_file_append(
+   const char              *path,
+   const void              *data,
+   uint32_t                size);
+
+/**
+ * Write the cached data of a file to the storage media.
+ *
+ * The data shall be on the storage media when this function returns.
+ *
+ * @param path          In: File name
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int os_file_sync(
+   const char              *path);
+
+/**
+ * Remove a file.
+ *
+ * @param path          In: File name
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int os_file_remove(
+   const char              *path);
+
+/**
+ * Rename a file, replacing any existing file with the new name.
+ *
+ * The replacement must be atomic. After a power loss either the old
+ * or the new file is found, never a mix. The new name shall be on the
+ * storage media when this function returns.
+ *
+ * @param old_path      In: Current file name
+ * @param new_path      In: New file name
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int os_file_rename(
+   const char              *old_path,
+   const char              *new_path);
+
 #ifdef __cplusplus
 }
 #endif
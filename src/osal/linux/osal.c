@@ -20,9 +20,17 @@
 #include <log.h>
 #include <options.h>
 
+#include <alloca.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <malloc.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 
 #include <assert.h>
@@ -40,45 +48,204 @@
 /* Priority of timer callback thread (if USE_SCHED_FIFO is set) */
 #define TIMER_PRIO        5
 
+/* Stack of the thread calling os_mem_lock() that is touched in advance */
+#define OS_STACK_PREFAULT_SIZE   (64 * 1024)
+
 #define USECS_PER_SEC     (1 * 1000 * 1000)
 #define NSECS_PER_SEC     (1 * 1000 * 1000 * 1000)
 
-void os_log (int type, const char * fmt, ...)
+static uint32_t os_alloc_cnt = 0;     /* Heap allocations made by the OSAL */
+static bool os_stack_prefault_enabled = false;
+
+void * os_malloc (size_t size)
+{
+   __atomic_add_fetch (&os_alloc_cnt, 1, __ATOMIC_RELAXED);
+   return malloc (size);
+}
+
+void os_free (void * ptr)
+{
+   free (ptr);
+}
+
+uint32_t os_alloc_count (void)
+{
+   return __atomic_load_n (&os_alloc_cnt, __ATOMIC_RELAXED);
+}
+
+/* Touch size bytes of the calling thread's stack, one page at a time */
+static void __attribute__((noinline)) os_stack_prefault (size_t size)
+{
+   volatile uint8_t * stack = alloca (size);
+   size_t page = (size_t)sysconf (_SC_PAGESIZE);
+   size_t ix;
+
+   for (ix = 0; ix < size; ix += page)
+   {
+      stack[ix] = 0;
+   }
+}
+
+int os_mem_lock (size_t heap_size)
 {
-   va_list                 list;
-   time_t                   rawtime;
-   struct tm                *timestruct;
-   char                     timestamp[10];
+   int ret = 0;
+   uint8_t * heap;
 
-   time(&rawtime);
-   timestruct = localtime(&rawtime);
-   strftime(timestamp, sizeof(timestamp), "%H:%M:%S", timestruct);
+   if (mlockall (MCL_CURRENT | MCL_FUTURE) != 0)
+   {
+      ret = -1;
+   }
+
+   /* Keep freed memory in the heap, and do not serve large blocks from
+    * separate mappings that are returned to the system when freed.
+    */
+   mallopt (M_TRIM_THRESHOLD, -1);
+   mallopt (M_MMAP_MAX, 0);
 
-   switch(LOG_LEVEL_GET (type))
+   if (heap_size > 0)
    {
-   case LOG_LEVEL_DEBUG:   printf ("[%s DEBUG] ", timestamp); break;
-   case LOG_LEVEL_INFO:    printf ("[%s INFO ] ", timestamp); break;
-   case LOG_LEVEL_WARNING: printf ("[%s WARN ] ", timestamp); break;
-   case LOG_LEVEL_ERROR:   printf ("[%s ERROR] ", timestamp); break;
-   default: break;
+      heap = os_malloc (heap_size);
+      if (heap == NULL)
+      {
+         ret = -1;
+      }
+      else
+      {
+         memset (heap, 0, heap_size);
+         free (heap);
+      }
    }
 
-   va_start (list, fmt);
-   vprintf (fmt, list);
-   va_end (list);
-   fflush (stdout);
+   os_stack_prefault (OS_STACK_PREFAULT_SIZE);
+   __atomic_store_n (&os_stack_prefault_enabled, true, __ATOMIC_RELAXED);
+
+   return ret;
 }
 
-void * os_malloc (size_t size)
+/* Handed over from os_thread_create_cfg() to the new thread */
+typedef struct os_thread_start
 {
-   return malloc (size);
+   void (*entry) (void * arg);
+   void * arg;
+   const os_thread_cfg_t * cfg;
+   size_t stack_size;
+   sem_t started;
+   bool ok;
+} os_thread_start_t;
+
+static int os_thread_policy (const os_thread_cfg_t * cfg)
+{
+   switch (cfg->policy)
+   {
+   case OS_SCHED_OTHER:
+      return SCHED_OTHER;
+   case OS_SCHED_FIFO:
+      return SCHED_FIFO;
+   case OS_SCHED_RR:
+      return SCHED_RR;
+   case OS_SCHED_DEFAULT:
+   default:
+#if defined (USE_SCHED_FIFO)
+      return SCHED_FIFO;
+#else
+      return -1;              /* Inherited from the creating thread */
+#endif
+   }
 }
 
-os_thread_t * os_thread_create (const char * name, int priority,
-        int stacksize, void (*entry) (void * arg), void * arg)
+/* Check that the placement of the calling thread took effect */
+static bool os_thread_check (const os_thread_start_t * start)
+{
+   const os_thread_cfg_t * cfg = start->cfg;
+   int policy = os_thread_policy (cfg);
+   int actual_policy;
+   struct sched_param param;
+   pthread_attr_t attr;
+   size_t stack_size = 0;
+   cpu_set_t cpus;
+   int cpu;
+   bool ok = true;
+
+   if (cfg->cpu_mask != 0)
+   {
+      CPU_ZERO (&cpus);
+      if (pthread_getaffinity_np (pthread_self(), sizeof(cpus), &cpus) != 0)
+      {
+         ok = false;
+      }
+      for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      {
+         bool wanted = (cpu < 64) && ((cfg->cpu_mask & (1ULL << cpu)) != 0);
+         if ((CPU_ISSET (cpu, &cpus) != 0) != wanted)
+         {
+            ok = false;
+         }
+      }
+   }
+
+   if (policy >= 0)
+   {
+      if ((pthread_getschedparam (pthread_self(), &actual_policy, &param) != 0) ||
+          (actual_policy != policy) ||
+          ((policy != SCHED_OTHER) && (param.sched_priority != cfg->priority)))
+      {
+         ok = false;
+      }
+   }
+
+   if ((pthread_getattr_np (pthread_self(), &attr) != 0))
+   {
+      ok = false;
+   }
+   else
+   {
+      pthread_attr_getstacksize (&attr, &stack_size);
+      pthread_attr_destroy (&attr);
+      if (stack_size < start->stack_size)
+      {
+         ok = false;
+      }
+   }
+
+   return ok;
+}
+
+static void * os_thread_start (void * arg)
+{
+   os_thread_start_t * start = arg;
+   void (*entry) (void * arg) = start->entry;
+   void * entry_arg = start->arg;
+   bool ok;
+
+   ok = os_thread_check (start);
+   if (ok && __atomic_load_n (&os_stack_prefault_enabled, __ATOMIC_RELAXED))
+   {
+      os_stack_prefault (start->cfg->stack_size);
+   }
+   if (ok)
+   {
+      os_log_thread_init();
+   }
+   start->ok = ok;
+   sem_post (&start->started);   /* start is gone after this */
+
+   if (ok)
+   {
+      entry (entry_arg);
+   }
+
+   return NULL;
+}
+
+os_thread_t * os_thread_create_cfg (const char * name,
+        const os_thread_cfg_t * cfg, void (*entry) (void * arg), void * arg)
 {
    int result;
-   pthread_t * thread = malloc (sizeof(*thread));
+   int policy = os_thread_policy (cfg);
+   int cpu;
+   cpu_set_t cpus;
+   os_thread_start_t start;
+   pthread_t * thread = os_malloc (sizeof(*thread));
    if (thread == NULL)
    {
       return NULL;
@@ -86,20 +253,57 @@ os_thread_t * os_thread_create (const char * name, int priority,
 
    pthread_attr_t attr;
 
+   start.entry = entry;
+   start.arg = arg;
+   start.cfg = cfg;
+   start.stack_size = PTHREAD_STACK_MIN + cfg->stack_size;
+   start.ok = false;
+   sem_init (&start.started, 0, 0);
+
    pthread_attr_init (&attr);
-   pthread_attr_setstacksize (&attr, PTHREAD_STACK_MIN + stacksize);
+   pthread_attr_setstacksize (&attr, start.stack_size);
 
-#if defined (USE_SCHED_FIFO)
-   CC_STATIC_ASSERT (_POSIX_THREAD_PRIORITY_SCHEDULING > 0);
-   struct sched_param param = { .sched_priority = priority };
-   pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED);
-   pthread_attr_setschedpolicy (&attr, SCHED_FIFO);
-   pthread_attr_setschedparam (&attr, &param);
-#endif
+   if (cfg->cpu_mask != 0)
+   {
+      CPU_ZERO (&cpus);
+      for (cpu = 0; (cpu < 64) && (cpu < CPU_SETSIZE); cpu++)
+      {
+         if ((cfg->cpu_mask & (1ULL << cpu)) != 0)
+         {
+            CPU_SET (cpu, &cpus);
+         }
+      }
+      pthread_attr_setaffinity_np (&attr, sizeof(cpus), &cpus);
+   }
 
-   result = pthread_create (thread, &attr, (void *)entry, arg);
+   if (policy >= 0)
+   {
+      CC_STATIC_ASSERT (_POSIX_THREAD_PRIORITY_SCHEDULING > 0);
+      struct sched_param param = {
+         .sched_priority = (policy == SCHED_OTHER) ? 0 : cfg->priority };
+      pthread_attr_setinheritsched (&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_setschedpolicy (&attr, policy);
+      pthread_attr_setschedparam (&attr, &param);
+   }
+
+   result = pthread_create (thread, &attr, os_thread_start, &start);
+   pthread_attr_destroy (&attr);
    if (result != 0)
    {
+      sem_destroy (&start.started);
+      free(thread);
+      return NULL;
+   }
+
+   while (sem_wait (&start.started) != 0)
+   {
+      /* Interrupted by a signal */
+   }
+   sem_destroy (&start.started);
+
+   if (!start.ok)
+   {
+      pthread_join (*thread, NULL);
       free(thread);
       return NULL;
    }
@@ -108,10 +312,64 @@ os_thread_t * os_thread_create (const char * name, int priority,
    return thread;
 }
 
+os_thread_t * os_thread_create (const char * name, int priority,
+        int stacksize, void (*entry) (void * arg), void * arg)
+{
+   os_thread_cfg_t cfg;
+
+   memset (&cfg, 0, sizeof(cfg));
+   cfg.policy = OS_SCHED_DEFAULT;
+   cfg.priority = priority;
+   cfg.stack_size = stacksize;
+
+   return os_thread_create_cfg (name, &cfg, entry, arg);
+}
+
+void os_thread_join (os_thread_t * thread)
+{
+   pthread_join (*thread, NULL);
+   free (thread);
+}
+
+/* Absolute CLOCK_MONOTONIC time, time milliseconds from now */
+static void os_deadline (uint32_t time, struct timespec * ts)
+{
+   uint64_t nsec = (uint64_t)time * 1000 * 1000;
+
+   clock_gettime (CLOCK_MONOTONIC, ts);
+   nsec += ts->tv_nsec;
+   ts->tv_sec += nsec / NSECS_PER_SEC;
+   ts->tv_nsec = nsec % NSECS_PER_SEC;
+}
+
+/*
+ * Sleep while *addr is expected, until woken by os_futex_wake() or until
+ * the deadline (NULL waits forever).
+ *
+ * @return  ETIMEDOUT at the deadline, otherwise 0.
+ */
+static int os_futex_wait (uint32_t * addr, uint32_t expected, const struct timespec * deadline)
+{
+   /* With a bitset the time is absolute, on CLOCK_MONOTONIC */
+   if ((syscall (SYS_futex, addr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, expected,
+                 deadline, NULL, FUTEX_BITSET_MATCH_ANY) != 0) &&
+       (errno == ETIMEDOUT))
+   {
+      return ETIMEDOUT;
+   }
+
+   return 0;
+}
+
+static void os_futex_wake (uint32_t * addr, int count)
+{
+   syscall (SYS_futex, addr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, NULL, NULL, 0);
+}
+
 os_mutex_t * os_mutex_create (void)
 {
    int result;
-   pthread_mutex_t * mutex = malloc (sizeof(*mutex));
+   pthread_mutex_t * mutex = os_malloc (sizeof(*mutex));
    if (mutex == NULL)
    {
       return NULL;
@@ -155,19 +413,15 @@ void os_mutex_destroy (os_mutex_t * _mutex)
 os_sem_t * os_sem_create (size_t count)
 {
    os_sem_t * sem;
-   pthread_mutexattr_t attr;
 
-   sem = (os_sem_t *)malloc (sizeof(*sem));
+   sem = (os_sem_t *)os_malloc (sizeof(*sem));
    if (sem == NULL)
    {
       return NULL;
    }
 
-   pthread_cond_init (&sem->cond, NULL);
-   pthread_mutexattr_init (&attr);
-   pthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
-   pthread_mutex_init (&sem->mutex, &attr);
-   sem->count = count;
+   sem->count = (uint32_t)count;
+   sem->waiters = 0;
 
    return sem;
 }
@@ -175,56 +429,53 @@ os_sem_t * os_sem_create (size_t count)
 int os_sem_wait (os_sem_t * sem, uint32_t time)
 {
    struct timespec ts;
-   int error = 0;
-   uint64_t nsec = (uint64_t)time * 1000 * 1000;
+   bool has_deadline = false;
+   uint32_t count;
 
-   clock_gettime (CLOCK_MONOTONIC, &ts);
-   nsec += ts.tv_nsec;
-   if (nsec > NSECS_PER_SEC)
+   for (;;)
    {
-      ts.tv_sec += nsec / NSECS_PER_SEC;
-      nsec %= NSECS_PER_SEC;
-   }
-   ts.tv_nsec = nsec;
-
-   pthread_mutex_lock (&sem->mutex);
-   while (sem->count == 0)
-   {
-      if (time != OS_WAIT_FOREVER)
+      count = __atomic_load_n (&sem->count, __ATOMIC_ACQUIRE);
+      if (count > 0)
       {
-         error = pthread_cond_timedwait (&sem->cond, &sem->mutex, &ts);
-         assert (error != EINVAL);
-         if (error)
+         if (__atomic_compare_exchange_n (&sem->count, &count, count - 1, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
          {
-            goto timeout;
+            return 0;
          }
       }
+      else if (time == 0)
+      {
+         return 1;
+      }
       else
       {
-         error = pthread_cond_wait (&sem->cond, &sem->mutex);
-         assert (error != EINVAL);
+         if ((time != OS_WAIT_FOREVER) && !has_deadline)
+         {
+            os_deadline (time, &ts);
+            has_deadline = true;
+         }
+
+         __atomic_add_fetch (&sem->waiters, 1, __ATOMIC_SEQ_CST);
+         if (os_futex_wait (&sem->count, 0, has_deadline ? &ts : NULL) == ETIMEDOUT)
+         {
+            time = 0;   /* One more try, then give up */
+         }
+         __atomic_sub_fetch (&sem->waiters, 1, __ATOMIC_RELAXED);
       }
    }
-
-   sem->count--;
-
- timeout:
-   pthread_mutex_unlock (&sem->mutex);
-   return (error) ? 1 : 0;
 }
 
 void os_sem_signal (os_sem_t * sem)
 {
-   pthread_mutex_lock (&sem->mutex);
-   sem->count++;
-   pthread_mutex_unlock (&sem->mutex);
-   pthread_cond_signal (&sem->cond);
+   __atomic_add_fetch (&sem->count, 1, __ATOMIC_SEQ_CST);
+   if (__atomic_load_n (&sem->waiters, __ATOMIC_SEQ_CST) > 0)
+   {
+      os_futex_wake (&sem->count, 1);
+   }
 }
 
 void os_sem_destroy (os_sem_t * sem)
 {
-   pthread_cond_destroy (&sem->cond);
-   pthread_mutex_destroy (&sem->mutex);
    free (sem);
 }
 
@@ -242,29 +493,30 @@ void os_usleep (uint32_t usec)
 }
 
 uint32_t os_get_current_time_us (void)
+{
+   return (uint32_t)(os_get_current_time_ns() / 1000);
+}
+
+uint64_t os_get_current_time_ns (void)
 {
    struct timespec ts;
 
    clock_gettime (CLOCK_MONOTONIC, &ts);
-   return ts.tv_sec * 1000 * 1000 + ts.tv_nsec / 1000;
+   return (uint64_t)ts.tv_sec * 1000 * 1000 * 1000 + ts.tv_nsec;
 }
 
 os_event_t * os_event_create (void)
 {
    os_event_t * event;
-   pthread_mutexattr_t attr;
 
-   event = (os_event_t *)malloc (sizeof(*event));
+   event = (os_event_t *)os_malloc (sizeof(*event));
    if (event == NULL)
    {
       return NULL;
    }
 
-   pthread_cond_init (&event->cond, NULL);
-   pthread_mutexattr_init (&attr);
-   pthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
-   pthread_mutex_init (&event->mutex, &attr);
    event->flags = 0;
+   event->waiters = 0;
 
    return event;
 }
@@ -272,64 +524,53 @@ os_event_t * os_event_create (void)
 int os_event_wait (os_event_t * event, uint32_t mask, uint32_t * value, uint32_t time)
 {
    struct timespec ts;
-   int error = 0;
-   uint64_t nsec = (uint64_t)time * 1000 * 1000;
+   bool has_deadline = false;
+   uint32_t flags;
 
-   if (time != OS_WAIT_FOREVER)
+   for (;;)
    {
-      clock_gettime (CLOCK_MONOTONIC, &ts);
-      nsec += ts.tv_nsec;
-
-      ts.tv_sec += nsec / NSECS_PER_SEC;
-      ts.tv_nsec = nsec % NSECS_PER_SEC;
-   }
-
-   pthread_mutex_lock (&event->mutex);
+      flags = __atomic_load_n (&event->flags, __ATOMIC_ACQUIRE);
+      if (((flags & mask) != 0) || (time == 0))
+      {
+         *value = flags & mask;
+         return (*value != 0) ? 0 : 1;
+      }
 
-   while ((event->flags & mask) == 0)
-   {
-      if (time != OS_WAIT_FOREVER)
+      if ((time != OS_WAIT_FOREVER) && !has_deadline)
       {
-         error = pthread_cond_timedwait (&event->cond, &event->mutex, &ts);
-         assert (error != EINVAL);
-         if (error)
-         {
-            goto timeout;
-         }
+         os_deadline (time, &ts);
+         has_deadline = true;
       }
-      else
+
+      __atomic_add_fetch (&event->waiters, 1, __ATOMIC_SEQ_CST);
+      if (os_futex_wait (&event->flags, flags, has_deadline ? &ts : NULL) == ETIMEDOUT)
       {
-         error = pthread_cond_wait (&event->cond, &event->mutex);
-         assert (error != EINVAL);
+         time = 0;   /* Report the flags once more, then give up */
       }
+      __atomic_sub_fetch (&event->waiters, 1, __ATOMIC_RELAXED);
    }
-
- timeout:
-   *value = event->flags & mask;
-   pthread_mutex_unlock (&event->mutex);
-   return (error) ? 1 : 0;
 }
 
 void os_event_set (os_event_t * event, uint32_t value)
 {
-   pthread_mutex_lock (&event->mutex);
-   event->flags |= value;
-   pthread_mutex_unlock (&event->mutex);
-   pthread_cond_signal (&event->cond);
+   uint32_t old = __atomic_fetch_or (&event->flags, value, __ATOMIC_SEQ_CST);
+
+   /* Waiters may wait for different flags, so wake all of them */
+   if (((old | value) != old) &&
+       (__atomic_load_n (&event->waiters, __ATOMIC_SEQ_CST) > 0))
+   {
+      os_futex_wake (&event->flags, INT_MAX);
+   }
 }
 
 void os_event_clr (os_event_t * event, uint32_t value)
 {
-   pthread_mutex_lock (&event->mutex);
-   event->flags &= ~value;
-   pthread_mutex_unlock (&event->mutex);
-   pthread_cond_signal (&event->cond);
+   /* Clearing flags never ends a wait */
+   __atomic_fetch_and (&event->flags, ~value, __ATOMIC_SEQ_CST);
 }
 
 void os_event_destroy (os_event_t * event)
 {
-   pthread_cond_destroy (&event->cond);
-   pthread_mutex_destroy (&event->mutex);
    free (event);
 }
 
@@ -338,13 +579,12 @@ os_mbox_t * os_mbox_create (size_t size)
    os_mbox_t * mbox;
    pthread_mutexattr_t attr;
 
-   mbox = (os_mbox_t *)malloc (sizeof(*mbox) + size * sizeof(void *));
+   mbox = (os_mbox_t *)os_malloc (sizeof(*mbox) + size * sizeof(void *));
    if (mbox == NULL)
    {
       return NULL;
    }
 
-   pthread_cond_init (&mbox->cond, NULL);
    pthread_mutexattr_init (&attr);
    pthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
    pthread_mutex_init (&mbox->mutex, &attr);
@@ -352,6 +592,9 @@ os_mbox_t * os_mbox_create (size_t size)
    mbox->r     = 0;
    mbox->w     = 0;
    mbox->count = 0;
+   mbox->space = (uint32_t)size;
+   mbox->fetch_waiters = 0;
+   mbox->post_waiters = 0;
    mbox->size  = size;
 
    return mbox;
@@ -360,102 +603,104 @@ os_mbox_t * os_mbox_create (size_t size)
 int os_mbox_fetch (os_mbox_t * mbox, void ** msg, uint32_t time)
 {
    struct timespec ts;
-   int error = 0;
-   uint64_t nsec = (uint64_t)time * 1000 * 1000;
-
-   if (time != OS_WAIT_FOREVER)
-   {
-      clock_gettime (CLOCK_MONOTONIC, &ts);
-      nsec += ts.tv_nsec;
-
-      ts.tv_sec += nsec / NSECS_PER_SEC;
-      ts.tv_nsec = nsec % NSECS_PER_SEC;
-   }
+   bool has_deadline = false;
+   bool wake;
 
    pthread_mutex_lock (&mbox->mutex);
 
    while (mbox->count == 0)
    {
-      if (time != OS_WAIT_FOREVER)
+      if (time == 0)
       {
-         error = pthread_cond_timedwait (&mbox->cond, &mbox->mutex, &ts);
-         assert (error != EINVAL);
-         if (error)
-         {
-            goto timeout;
-         }
+         pthread_mutex_unlock (&mbox->mutex);
+         return 1;
       }
-      else
+
+      if ((time != OS_WAIT_FOREVER) && !has_deadline)
       {
-         error = pthread_cond_wait (&mbox->cond, &mbox->mutex);
-         assert (error != EINVAL);
+         os_deadline (time, &ts);
+         has_deadline = true;
       }
+
+      /* A post after the unlock changes count, so the wait returns at once */
+      mbox->fetch_waiters++;
+      pthread_mutex_unlock (&mbox->mutex);
+      if (os_futex_wait (&mbox->count, 0, has_deadline ? &ts : NULL) == ETIMEDOUT)
+      {
+         time = 0;
+      }
+      pthread_mutex_lock (&mbox->mutex);
+      mbox->fetch_waiters--;
    }
 
    *msg = mbox->msg[mbox->r++];
    if (mbox->r == mbox->size)
       mbox->r = 0;
 
-   mbox->count--;
+   __atomic_store_n (&mbox->count, mbox->count - 1, __ATOMIC_RELAXED);
+   __atomic_store_n (&mbox->space, mbox->space + 1, __ATOMIC_RELAXED);
+   wake = (mbox->post_waiters > 0);
 
- timeout:
    pthread_mutex_unlock (&mbox->mutex);
-   pthread_cond_signal (&mbox->cond);
+   if (wake)
+   {
+      os_futex_wake (&mbox->space, 1);
+   }
 
-   return (error) ? 1 : 0;
+   return 0;
 }
 
 int os_mbox_post (os_mbox_t * mbox, void * msg, uint32_t time)
 {
    struct timespec ts;
-   int error = 0;
-   uint64_t nsec = (uint64_t)time * 1000 * 1000;
-
-   if (time != OS_WAIT_FOREVER)
-   {
-      clock_gettime (CLOCK_MONOTONIC, &ts);
-      nsec += ts.tv_nsec;
-
-      ts.tv_sec += nsec / NSECS_PER_SEC;
-      ts.tv_nsec = nsec % NSECS_PER_SEC;
-   }
+   bool has_deadline = false;
+   bool wake;
 
    pthread_mutex_lock (&mbox->mutex);
 
-   while (mbox->count == mbox->size)
+   while (mbox->space == 0)
    {
-      if (time != OS_WAIT_FOREVER)
+      if (time == 0)
       {
-         error = pthread_cond_timedwait (&mbox->cond, &mbox->mutex, &ts);
-         assert (error != EINVAL);
-         if (error)
-         {
-            goto timeout;
-         }
+         pthread_mutex_unlock (&mbox->mutex);
+         return 1;
       }
-      else
+
+      if ((time != OS_WAIT_FOREVER) && !has_deadline)
       {
-         error = pthread_cond_wait (&mbox->cond, &mbox->mutex);
-         assert (error != EINVAL);
+         os_deadline (time, &ts);
+         has_deadline = true;
       }
+
+      mbox->post_waiters++;
+      pthread_mutex_unlock (&mbox->mutex);
+      if (os_futex_wait (&mbox->space, 0, has_deadline ? &ts : NULL) == ETIMEDOUT)
+      {
+         time = 0;
+      }
+      pthread_mutex_lock (&mbox->mutex);
+      mbox->post_waiters--;
    }
 
    mbox->msg[mbox->w++] = msg;
    if (mbox->w == mbox->size)
       mbox->w = 0;
 
-   mbox->count++;
+   __atomic_store_n (&mbox->count, mbox->count + 1, __ATOMIC_RELAXED);
+   __atomic_store_n (&mbox->space, mbox->space - 1, __ATOMIC_RELAXED);
+   wake = (mbox->fetch_waiters > 0);
 
- timeout:
    pthread_mutex_unlock (&mbox->mutex);
-   pthread_cond_signal (&mbox->cond);
+   if (wake)
+   {
+      os_futex_wake (&mbox->count, 1);
+   }
 
-   return (error) ? 1 : 0;
+   return 0;
 }
 
 void os_mbox_destroy (os_mbox_t * mbox)
 {
-   pthread_cond_destroy (&mbox->cond);
    pthread_mutex_destroy (&mbox->mutex);
    free (mbox);
 }
@@ -488,8 +733,9 @@ static void os_timer_thread (void * arg)
    }
 }
 
-os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg),
-                              void * arg, bool oneshot)
+os_timer_t * os_timer_create_cfg (uint32_t us, void (*fn) (os_timer_t *, void * arg),
+                                  void * arg, bool oneshot,
+                                  const os_thread_cfg_t * p_thread_cfg)
 {
    os_timer_t * timer;
    struct sigevent sev;
@@ -500,7 +746,7 @@ os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg)
    sigaddset (&sigset, SIGALRM);
    sigprocmask (SIG_BLOCK, &sigset, NULL);
 
-   timer = (os_timer_t *)malloc (sizeof(*timer));
+   timer = (os_timer_t *)os_malloc (sizeof(*timer));
    if (timer == NULL)
    {
       return NULL;
@@ -514,8 +760,16 @@ os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg)
    timer->oneshot   = oneshot;
 
    /* Create timer thread */
-   timer->thread = os_thread_create ("os_timer", TIMER_PRIO, 1024,
-                                     os_timer_thread,timer);
+   if (p_thread_cfg != NULL)
+   {
+      timer->thread = os_thread_create_cfg ("os_timer", p_thread_cfg,
+                                            os_timer_thread, timer);
+   }
+   else
+   {
+      timer->thread = os_thread_create ("os_timer", TIMER_PRIO, 1024,
+                                        os_timer_thread,timer);
+   }
    if (timer->thread == NULL)
    {
       free(timer);
@@ -544,6 +798,12 @@ os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg)
    return timer;
 }
 
+os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg),
+                              void * arg, bool oneshot)
+{
+   return os_timer_create_cfg (us, fn, arg, oneshot, NULL);
+}
+
 void os_timer_set (os_timer_t * timer, uint32_t us)
 {
    timer->us = us;
@@ -583,15 +843,86 @@ void os_timer_destroy (os_timer_t * timer)
 
 uint32_t    os_buf_alloc_cnt = 0; /* Count outstanding buffers */
 
+/* Preallocated buffers of OS_BUF_MAX_SIZE bytes, see os_buf_pool_init().
+ * os_buf_pool is published last, and the mutex is only used if it is set. */
+static uint8_t * os_buf_pool = NULL;
+static size_t os_buf_pool_size = 0;
+static os_buf_t * os_buf_pool_free = NULL;   /* Linked through the payload */
+static pthread_mutex_t os_buf_pool_mutex;
+static pthread_once_t os_buf_pool_once = PTHREAD_ONCE_INIT;
+
+#define OS_BUF_POOL_ENTRY_SIZE   (((sizeof(os_buf_t) + OS_BUF_MAX_SIZE + sizeof(void *) - 1) / \
+                                   sizeof(void *)) * sizeof(void *))
+
+/* The RX, timer and application threads share the pool, as for os_mutex_create() */
+static void os_buf_pool_mutex_init (void)
+{
+   pthread_mutexattr_t attr;
+
+   pthread_mutexattr_init (&attr);
+   pthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
+   pthread_mutex_init (&os_buf_pool_mutex, &attr);
+   pthread_mutexattr_destroy (&attr);
+}
+
+int os_buf_pool_init (uint16_t count)
+{
+   int ret = -1;
+   uint16_t ix;
+   os_buf_t * p;
+   uint8_t * pool;
+
+   pthread_once (&os_buf_pool_once, os_buf_pool_mutex_init);
+   pthread_mutex_lock (&os_buf_pool_mutex);
+   if (os_buf_pool == NULL)
+   {
+      pool = os_malloc ((size_t)count * OS_BUF_POOL_ENTRY_SIZE);
+      if (pool != NULL)
+      {
+         os_buf_pool_size = (size_t)count * OS_BUF_POOL_ENTRY_SIZE;
+         memset (pool, 0, os_buf_pool_size);
+         for (ix = 0; ix < count; ix++)
+         {
+            p = (os_buf_t *)(pool + (size_t)ix * OS_BUF_POOL_ENTRY_SIZE);
+            p->payload = (uint8_t *)p + sizeof(os_buf_t);
+            *(os_buf_t **)p->payload = os_buf_pool_free;
+            os_buf_pool_free = p;
+         }
+         __atomic_store_n (&os_buf_pool, pool, __ATOMIC_RELEASE);
+         ret = 0;
+      }
+   }
+   pthread_mutex_unlock (&os_buf_pool_mutex);
+
+   return ret;
+}
+
 os_buf_t * os_buf_alloc(uint16_t length)
 {
-   os_buf_t *p = malloc(sizeof(os_buf_t) + length);
+   os_buf_t *p = NULL;
+
+   if ((length <= OS_BUF_MAX_SIZE) &&
+       (__atomic_load_n (&os_buf_pool, __ATOMIC_ACQUIRE) != NULL))
+   {
+      pthread_mutex_lock (&os_buf_pool_mutex);
+      p = os_buf_pool_free;
+      if (p != NULL)
+      {
+         os_buf_pool_free = *(os_buf_t **)p->payload;
+      }
+      pthread_mutex_unlock (&os_buf_pool_mutex);
+   }
+
+   if (p == NULL)
+   {
+      p = os_malloc(sizeof(os_buf_t) + length);
+   }
 
    if (p != NULL)
    {
       p->payload = (void *)((uint8_t *)p + sizeof(os_buf_t));  /* Payload follows header struct */
       p->len = length;
-      os_buf_alloc_cnt++;
+      __atomic_add_fetch (&os_buf_alloc_cnt, 1, __ATOMIC_RELAXED);
    }
    else
    {
@@ -603,11 +934,31 @@ os_buf_t * os_buf_alloc(uint16_t length)
 
 void os_buf_free(os_buf_t *p)
 {
-   free(p);
-   os_buf_alloc_cnt--;
+   uint8_t * pool = __atomic_load_n (&os_buf_pool, __ATOMIC_ACQUIRE);
+
+   if ((pool != NULL) &&
+       ((uint8_t *)p >= pool) &&
+       ((uint8_t *)p < pool + os_buf_pool_size))
+   {
+      p->payload = (uint8_t *)p + sizeof(os_buf_t);
+      pthread_mutex_lock (&os_buf_pool_mutex);
+      *(os_buf_t **)p->payload = os_buf_pool_free;
+      os_buf_pool_free = p;
+      pthread_mutex_unlock (&os_buf_pool_mutex);
+   }
+   else
+   {
+      free(p);
+   }
+   __atomic_sub_fetch (&os_buf_alloc_cnt, 1, __ATOMIC_RELAXED);
    return;
 }
 
+int os_buf_count (void)
+{
+   return (int)__atomic_load_n (&os_buf_alloc_cnt, __ATOMIC_RELAXED);
+}
+
 uint8_t os_buf_header(os_buf_t *p, int16_t header_size_increment)
 {
    return 255;
@@ -684,3 +1035,137 @@ int os_set_ip_suite(
    }
    return 0;
 }
+
+int os_file_read(
+   const char              *path,
+   uint32_t                offset,
+   void                    *data,
+   uint32_t                size)
+{
+   int                     fd;
+   ssize_t                 len;
+
+   fd = open(path, O_RDONLY);
+   if (fd < 0)
+   {
+      return -1;
+   }
+
+   len = pread(fd, data, size, offset);
+   close(fd);
+
+   return (len < 0) ? -1 : (int)len;
+}
+
+int os_file_append(
+   const char              *path,
+   const void              *data,
+   uint32_t                size)
+{
+   int                     fd;
+   int                     ret = 0;
+   ssize_t                 len;
+   const uint8_t           *p = data;
+
+   fd = open(path, O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+   if (fd < 0)
+   {
+      return -1;
+   }
+
+   while ((size > 0) && (ret == 0))
+   {
+      len = write(fd, p, size);
+      if (len < 0)
+      {
+         if (errno != EINTR)
+         {
+            ret = -1;
+         }
+      }
+      else
+      {
+         p += len;
+         size -= len;
+      }
+   }
+
+   close(fd);
+
+   return ret;
+}
+
+int os_file_sync(
+   const char              *path)
+{
+   int                     fd;
+   int                     ret = 0;
+
+   fd = open(path, O_WRONLY);
+   if (fd < 0)
+   {
+      return -1;
+   }
+
+   if (fdatasync(fd) != 0)
+   {
+      ret = -1;
+   }
+   close(fd);
+
+   return ret;
+}
+
+int os_file_remove(
+   const char              *path)
+{
+   return (unlink(path) == 0) ? 0 : -1;
+}
+
+int os_file_rename(
+   const char              *old_path,
+   const char              *new_path)
+{
+   char                    dir_path[PATH_MAX];
+   const char              *p_slash;
+   size_t                  len;
+   int                     fd;
+   int                     ret = 0;
+
+   /* rename() atomically replaces new_path */
+   if (rename(old_path, new_path) != 0)
+   {
+      return -1;
+   }
+
+   /* The new directory entry is on the media only after the directory
+      itself has been synced */
+   p_slash = strrchr(new_path, '/');
+   if (p_slash == NULL)
+   {
+      strcpy(dir_path, ".");
+   }
+   else
+   {
+      len = (p_slash == new_path) ? 1 : (size_t)(p_slash - new_path);
+      if (len >= sizeof(dir_path))
+      {
+         return -1;
+      }
+      memcpy(dir_path, new_path, len);
+      dir_path[len] = '\0';
+   }
+
+   fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+   if (fd < 0)
+   {
+      return -1;
+   }
+   if (fsync(fd) != 0)
+   {
+      ret = -1;
+   }
+   close(fd);
+
+   return ret;
+}
@@ -13,15 +13,190 @@
  * full license information.
  ********************************************************************/
 
+#include <fcntl.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <linux/ethtool.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
 #include <net/if.h>
 #include <netpacket/packet.h>
 #include <sys/ioctl.h>
+#include <unistd.h>
 
 #include "osal.h"
 
+#define OS_ETH_FD_TO_CLOCKID(fd)       ((~(clockid_t)(fd) << 3) | 3)
+#define OS_ETH_MAX_TIMESTAMP_AGE       (1000 * 1000 * 1000)    /* ns */
+#define OS_ETH_RX_TIMEOUT_US           (100 * 1000)   /* How often an idle thread checks for os_eth_destroy() */
+
+/**
+ * @internal
+ * Convert a timespec to nanoseconds.
+ *
+ * @param p_ts           In: The time.
+ * @return  The time in nanoseconds. 0 if not set.
+ */
+static uint64_t os_eth_ts_to_ns(
+   const struct timespec   *p_ts)
+{
+   return (uint64_t)p_ts->tv_sec * 1000 * 1000 * 1000 + p_ts->tv_nsec;
+}
+
+/**
+ * @internal
+ * Read the hardware timestamp configuration of the network interface.
+ *
+ * @param handle         In: The Ethernet handle.
+ * @param p_ifr          Out: The request, for a following SIOCSHWTSTAMP.
+ * @param p_hw_cfg       Out: The configuration.
+ * @return  0 if the configuration was read.
+ *          -1 if the interface can not tell.
+ */
+static int os_eth_get_hw_cfg(
+   os_eth_handle_t         *handle,
+   struct ifreq            *p_ifr,
+   struct hwtstamp_config  *p_hw_cfg)
+{
+   memset(p_hw_cfg, 0, sizeof(*p_hw_cfg));
+   memset(p_ifr, 0, sizeof(*p_ifr));
+   strncpy(p_ifr->ifr_name, handle->if_name, sizeof(p_ifr->ifr_name) - 1);
+   p_ifr->ifr_data = (void *)p_hw_cfg;
+
+   return ioctl(handle->socket, SIOCGHWTSTAMP, p_ifr);
+}
+
+/**
+ * @internal
+ * Enable receive timestamps on the socket.
+ *
+ * Hardware timestamps are used if the network interface can timestamp all
+ * frames and has a clock that can be read. Else the kernel timestamps the
+ * frames in software.
+ *
+ * The hardware configuration is shared with other users of the interface,
+ * for example a PTP daemon. Only the receive filter is changed, if it does
+ * not already cover all frames, and it is restored by os_eth_destroy().
+ *
+ * @param handle         InOut: The Ethernet handle.
+ * @param if_name        In: Ethernet interface name
+ */
+static void os_eth_init_timestamps(
+   os_eth_handle_t         *handle,
+   const char              *if_name)
+{
+   struct ifreq            ifr;
+   struct hwtstamp_config  hw_cfg;
+   struct ethtool_ts_info  ts_info;
+   char                    phc_name[20];
+   int                     flags;
+   int                     rx_filter;
+   bool                    hw_ok = false;
+
+   handle->phc_fd = -1;
+   handle->saved_rx_filter = -1;
+   memset(handle->if_name, 0, sizeof(handle->if_name));
+   strncpy(handle->if_name, if_name, sizeof(handle->if_name) - 1);
+
+   if (os_eth_get_hw_cfg(handle, &ifr, &hw_cfg) == 0)
+   {
+      if (hw_cfg.rx_filter == HWTSTAMP_FILTER_ALL)
+      {
+         hw_ok = true;
+      }
+      else
+      {
+         /* Keep the tx_type of the other users */
+         rx_filter = hw_cfg.rx_filter;
+         hw_cfg.rx_filter = HWTSTAMP_FILTER_ALL;
+         if ((ioctl(handle->socket, SIOCSHWTSTAMP, &ifr) == 0) &&
+             (hw_cfg.rx_filter == HWTSTAMP_FILTER_ALL))
+         {
+            handle->saved_rx_filter = rx_filter;
+            hw_ok = true;
+         }
+      }
+   }
+
+   if (hw_ok == true)
+   {
+      memset(&ts_info, 0, sizeof(ts_info));
+      ts_info.cmd = ETHTOOL_GET_TS_INFO;
+      ifr.ifr_data = (void *)&ts_info;
+      if ((ioctl(handle->socket, SIOCETHTOOL, &ifr) == 0) &&
+          (ts_info.phc_index >= 0))
+      {
+         snprintf(phc_name, sizeof(phc_name), "/dev/ptp%d", ts_info.phc_index);
+         handle->phc_fd = open(phc_name, O_RDONLY);
+      }
+   }
+
+   flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+   if (handle->phc_fd >= 0)
+   {
+      flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+   }
+   setsockopt(handle->socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+}
+
+/**
+ * @internal
+ * Undo os_eth_init_timestamps().
+ *
+ * @param handle         InOut: The Ethernet handle.
+ */
+static void os_eth_exit_timestamps(
+   os_eth_handle_t         *handle)
+{
+   struct ifreq            ifr;
+   struct hwtstamp_config  hw_cfg;
+
+   if ((handle->saved_rx_filter >= 0) &&
+       (os_eth_get_hw_cfg(handle, &ifr, &hw_cfg) == 0))
+   {
+      hw_cfg.rx_filter = handle->saved_rx_filter;
+      (void)ioctl(handle->socket, SIOCSHWTSTAMP, &ifr);
+   }
+   handle->saved_rx_filter = -1;
+
+   if (handle->phc_fd >= 0)
+   {
+      close(handle->phc_fd);
+      handle->phc_fd = -1;
+   }
+}
+
+/**
+ * @internal
+ * Save the timestamps of a received frame.
+ *
+ * They are converted to the monotonic clock in os_eth_rx_timestamp(), only
+ * for the frames that need it.
+ *
+ * @param handle         InOut: The Ethernet handle.
+ * @param p_msg          In: The received message.
+ */
+static void os_eth_save_timestamps(
+   os_eth_handle_t         *handle,
+   struct msghdr           *p_msg)
+{
+   struct cmsghdr          *p_cmsg;
+
+   handle->rx_read = os_get_current_time_ns();
+   memset(handle->rx_ts, 0, sizeof(handle->rx_ts));
+   for (p_cmsg = CMSG_FIRSTHDR(p_msg); p_cmsg != NULL; p_cmsg = CMSG_NXTHDR(p_msg, p_cmsg))
+   {
+      if ((p_cmsg->cmsg_level == SOL_SOCKET) &&
+          (p_cmsg->cmsg_type == SO_TIMESTAMPING) &&
+          (p_cmsg->cmsg_len >= CMSG_LEN(sizeof(handle->rx_ts))))
+      {
+         memcpy(handle->rx_ts, CMSG_DATA(p_cmsg), sizeof(handle->rx_ts));
+      }
+   }
+}
+
 /**
  * @internal
  * Run a thread that listens to incoming raw Ethernet sockets.
@@ -38,16 +213,32 @@ static void os_eth_task(
    os_eth_handle_t         *eth_handle = thread_arg;
    ssize_t                 readlen;
    int                     handled = 0;
+   struct msghdr           msg;
+   struct iovec            iov;
+   union
+   {
+      struct cmsghdr       align;
+      uint8_t              buf[CMSG_SPACE(sizeof(eth_handle->rx_ts))];
+   } control;
 
    os_buf_t *p = os_buf_alloc(OS_BUF_MAX_SIZE);
    assert(p != NULL);
 
-   while (1)
+   while (__atomic_load_n(&eth_handle->running, __ATOMIC_ACQUIRE))
    {
-      readlen = recv(eth_handle->socket, p->payload, p->len, 0);
+      iov.iov_base = p->payload;
+      iov.iov_len = OS_BUF_MAX_SIZE;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof(control.buf);
+
+      readlen = recvmsg(eth_handle->socket, &msg, 0);
       if(readlen == -1)
          continue;
       p->len = readlen;
+      os_eth_save_timestamps(eth_handle, &msg);
 
       if (eth_handle->callback != NULL)
       {
@@ -64,12 +255,15 @@ static void os_eth_task(
          assert(p != NULL);
       }
    }
+
+   os_buf_free(p);
 }
 
 os_eth_handle_t* os_eth_init(
    const char              *if_name,
    os_eth_callback_t       *callback,
-   void                    *arg)
+   void                    *arg,
+   const os_thread_cfg_t   *p_thread_cfg)
 {
    os_eth_handle_t         *handle;
    int                     i;
@@ -78,7 +272,7 @@ os_eth_handle_t* os_eth_init(
    int                     ifindex;
    struct timeval          timeout;
 
-   handle = malloc(sizeof(os_eth_handle_t));
+   handle = os_malloc(sizeof(os_eth_handle_t));
    if (handle == NULL)
    {
       return NULL;
@@ -92,6 +286,9 @@ os_eth_handle_t* os_eth_init(
    timeout.tv_usec = 1;
    setsockopt(handle->socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
 
+   timeout.tv_usec = OS_ETH_RX_TIMEOUT_US;
+   setsockopt(handle->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
    i = 1;
    setsockopt(handle->socket, SOL_SOCKET, SO_DONTROUTE, &i, sizeof(i));
 
@@ -108,6 +305,8 @@ os_eth_handle_t* os_eth_init(
    ifr.ifr_flags = ifr.ifr_flags | IFF_PROMISC | IFF_BROADCAST;
    ioctl(handle->socket, SIOCSIFFLAGS, &ifr);
 
+   os_eth_init_timestamps(handle, if_name);
+
    /* bind socket to protocol, in this case Profinet */
    sll.sll_family = AF_PACKET;
    sll.sll_ifindex = ifindex;
@@ -116,8 +315,24 @@ os_eth_handle_t* os_eth_init(
 
    if (handle->socket > -1)
    {
-      handle->thread = os_thread_create ("os_eth_task", 10,
-              4096, os_eth_task, handle);
+      handle->running = true;
+      if (p_thread_cfg != NULL)
+      {
+         handle->thread = os_thread_create_cfg ("os_eth_task", p_thread_cfg,
+                 os_eth_task, handle);
+      }
+      else
+      {
+         handle->thread = os_thread_create ("os_eth_task", 10,
+                 4096, os_eth_task, handle);
+      }
+      if (handle->thread == NULL)
+      {
+         os_eth_exit_timestamps(handle);
+         close(handle->socket);
+         free(handle);
+         return NULL;
+      }
       return handle;
    }
    else
@@ -127,6 +342,17 @@ os_eth_handle_t* os_eth_init(
    }
 }
 
+void os_eth_destroy(
+   os_eth_handle_t         *handle)
+{
+   __atomic_store_n(&handle->running, false, __ATOMIC_RELEASE);
+   os_thread_join(handle->thread);
+
+   os_eth_exit_timestamps(handle);
+   close(handle->socket);
+   free(handle);
+}
+
 int os_eth_send(
    os_eth_handle_t      *handle,
    os_buf_t             *buf)
@@ -135,3 +361,37 @@ int os_eth_send(
 
    return ret;
 }
+
+uint64_t os_eth_rx_timestamp(
+   os_eth_handle_t      *handle)
+{
+   uint64_t             now = os_get_current_time_ns();
+   uint64_t             stamp = 0;
+   struct timespec      ts;
+   uint64_t             age;
+
+   /* Measure the age on the clock of the timestamp */
+   if ((handle->phc_fd >= 0) &&
+       (os_eth_ts_to_ns(&handle->rx_ts[2]) != 0) &&
+       (clock_gettime(OS_ETH_FD_TO_CLOCKID(handle->phc_fd), &ts) == 0))
+   {
+      stamp = os_eth_ts_to_ns(&handle->rx_ts[2]);
+   }
+   else if ((os_eth_ts_to_ns(&handle->rx_ts[0]) != 0) &&
+            (clock_gettime(CLOCK_REALTIME, &ts) == 0))
+   {
+      stamp = os_eth_ts_to_ns(&handle->rx_ts[0]);
+   }
+
+   if ((stamp != 0) && (os_eth_ts_to_ns(&ts) >= stamp))
+   {
+      age = os_eth_ts_to_ns(&ts) - stamp;
+      if ((age < OS_ETH_MAX_TIMESTAMP_AGE) && (now > age))
+      {
+         return now - age;
+      }
+   }
+
+   /* The clock was stepped, or no timestamp */
+   return handle->rx_read;
+}
@@ -0,0 +1,753 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Asynchronous logging for Linux
+ *
+ * os_log() does not format anything. It stores the format string pointer,
+ * a timestamp and the raw arguments in a fixed-size record in a ring
+ * owned by the calling thread. A background thread formats the records
+ * and writes them to stdout. It sleeps on an eventfd while all rings are
+ * empty, and the first record logged after that wakes it.
+ *
+ * Each ring has a single producer (its thread) and a single consumer
+ * (whoever holds log_format_mutex), so no locks are taken when logging.
+ * If a ring is full the record is dropped, and the number of dropped
+ * records is reported later.
+ *
+ * Nothing is allocated when logging. Threads created by the OSAL get their
+ * ring before they start. Other threads take one of a few static rings at
+ * their first log call. If none is left they share a ring, protected by a
+ * mutex.
+ *
+ * Each ring holds LOG_RING_SIZE records of about 200 bytes, which is about
+ * 200 kB per thread with the default size. Set LOG_RING_SIZE in CMake to
+ * change it.
+ *
+ * The format string must remain valid after the call, which is the case
+ * for string literals. String arguments are copied into the record.
+ */
+
+#define _GNU_SOURCE
+
+#include <osal.h>
+
+#include <log.h>
+#include <options.h>
+
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE        1024      /* Records per ring. Must be a power of 2. */
+#endif
+#ifndef LOG_STATIC_RINGS
+#define LOG_STATIC_RINGS     2         /* Rings for threads not created by the OSAL */
+#endif
+#define LOG_MAX_ARGS         8         /* Max number of arguments in a record */
+#define LOG_TEXT_SIZE        96        /* Room for copies of string arguments */
+#define LOG_LINE_SIZE        512
+
+CC_STATIC_ASSERT ((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0);
+
+typedef enum log_arg_type
+{
+   LOG_ARG_INT,
+   LOG_ARG_DOUBLE,
+   LOG_ARG_STRING,
+   LOG_ARG_POINTER,
+   LOG_ARG_CHAR,
+} log_arg_type_t;
+
+typedef enum log_arg_length
+{
+   LOG_LENGTH_NONE,
+   LOG_LENGTH_HH,
+   LOG_LENGTH_H,
+   LOG_LENGTH_L,
+   LOG_LENGTH_LL,
+   LOG_LENGTH_Z,
+   LOG_LENGTH_J,
+   LOG_LENGTH_T,
+} log_arg_length_t;
+
+/* A parsed conversion specification, e.g. "%-08lx" */
+typedef struct log_spec
+{
+   const char              *start;     /* The '%' */
+   const char              *end;       /* After the conversion character */
+   const char              *length;    /* The length modifier, if any */
+   int                     stars;      /* Number of '*' for width and precision */
+   int                     precision;  /* -1 if none, -2 if given by an argument */
+   log_arg_length_t        length_type;
+   log_arg_type_t          type;
+   char                    conversion;
+} log_spec_t;
+
+typedef union log_arg
+{
+   long long               i;
+   double                  d;
+   const void              *p;
+   uint32_t                text_offset;
+} log_arg_t;
+
+typedef struct log_record
+{
+   struct timespec         timestamp;
+   const char              *fmt;       /* NULL if text holds the formatted message */
+   int                     type;
+   log_arg_t               args[LOG_MAX_ARGS];
+   char                    text[LOG_TEXT_SIZE];
+} log_record_t;
+
+typedef struct log_ring
+{
+   uint32_t                head;       /* Only written by the owning thread */
+   uint32_t                tail;       /* Only written by the consumer */
+   uint32_t                dropped;    /* Only written by the owning thread */
+   uint32_t                dropped_reported;
+   bool                    exited;     /* The owning thread has terminated */
+   bool                    is_static;  /* From log_static_rings, not the heap */
+   bool                    is_shared;  /* log_shared_ring, producers hold log_shared_mutex */
+   struct log_ring         *next;
+   log_record_t            records[LOG_RING_SIZE];
+} log_ring_t;
+
+static pthread_once_t      log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t       log_key;
+static pthread_mutex_t     log_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t     log_format_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t     log_shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int                 log_event_fd = -1;
+static bool                log_waiting;   /* The formatter may sleep on log_event_fd */
+static log_ring_t          *log_rings;
+static __thread log_ring_t *log_thread_ring;
+static log_ring_t          log_static_rings[LOG_STATIC_RINGS];
+static bool                log_static_used[LOG_STATIC_RINGS];   /* Under log_rings_mutex */
+static log_ring_t          log_shared_ring;
+
+/**
+ * Parse the conversion specification at p, which points to a '%'.
+ *
+ * @param p                In:   The conversion specification.
+ * @param spec             Out:  The parsed specification.
+ * @return  0  if the specification is supported.
+ *          -1 if not.
+ */
+static int log_parse_spec (const char * p, log_spec_t * spec)
+{
+   memset (spec, 0, sizeof(*spec));
+   spec->start = p++;
+   spec->precision = -1;
+
+   while (*p != '\0' && strchr ("-+ #0'", *p) != NULL)
+   {
+      p++;
+   }
+   if (*p == '*')
+   {
+      spec->stars++;
+      p++;
+   }
+   while (*p >= '0' && *p <= '9')
+   {
+      p++;
+   }
+   if (*p == '.')
+   {
+      p++;
+      spec->precision = 0;
+      if (*p == '*')
+      {
+         spec->stars++;
+         spec->precision = -2;
+         p++;
+      }
+      while (*p >= '0' && *p <= '9')
+      {
+         spec->precision = spec->precision * 10 + (*p - '0');
+         p++;
+      }
+   }
+
+   spec->length = p;
+   switch (*p)
+   {
+   case 'h':
+      p++;
+      spec->length_type = LOG_LENGTH_H;
+      if (*p == 'h')
+      {
+         p++;
+         spec->length_type = LOG_LENGTH_HH;
+      }
+      break;
+   case 'l':
+      p++;
+      spec->length_type = LOG_LENGTH_L;
+      if (*p == 'l')
+      {
+         p++;
+         spec->length_type = LOG_LENGTH_LL;
+      }
+      break;
+   case 'z': p++; spec->length_type = LOG_LENGTH_Z; break;
+   case 'j': p++; spec->length_type = LOG_LENGTH_J; break;
+   case 't': p++; spec->length_type = LOG_LENGTH_T; break;
+   default: break;
+   }
+
+   spec->conversion = *p;
+   switch (*p)
+   {
+   case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+      spec->type = LOG_ARG_INT;
+      break;
+   case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+      spec->type = LOG_ARG_DOUBLE;
+      break;
+   case 'c':
+      spec->type = LOG_ARG_CHAR;
+      break;
+   case 's':
+      spec->type = LOG_ARG_STRING;
+      break;
+   case 'p':
+      spec->type = LOG_ARG_POINTER;
+      break;
+   default:
+      /* Unsupported, e.g. %n, %ls or long double */
+      return -1;
+   }
+   if (spec->type != LOG_ARG_INT && spec->length_type != LOG_LENGTH_NONE)
+   {
+      return -1;
+   }
+
+   spec->end = p + 1;
+   return 0;
+}
+
+/**
+ * Fetch an integer argument, truncated as printf would do.
+ */
+static long long log_get_int (const log_spec_t * spec, va_list * list)
+{
+   bool is_signed = (spec->conversion == 'd' || spec->conversion == 'i');
+
+   switch (spec->length_type)
+   {
+   case LOG_LENGTH_HH:
+      return is_signed ? (signed char)va_arg (*list, int) : (unsigned char)va_arg (*list, int);
+   case LOG_LENGTH_H:
+      return is_signed ? (short)va_arg (*list, int) : (unsigned short)va_arg (*list, int);
+   case LOG_LENGTH_L:
+      return is_signed ? va_arg (*list, long) : (long long)va_arg (*list, unsigned long);
+   case LOG_LENGTH_LL:
+      return va_arg (*list, long long);
+   case LOG_LENGTH_Z:
+      return (long long)va_arg (*list, size_t);
+   case LOG_LENGTH_J:
+      return (long long)va_arg (*list, intmax_t);
+   case LOG_LENGTH_T:
+      return (long long)va_arg (*list, ptrdiff_t);
+   default:
+      return is_signed ? va_arg (*list, int) : (long long)va_arg (*list, unsigned int);
+   }
+}
+
+/**
+ * Store the arguments of a message in a record, without formatting it.
+ *
+ * @return  0  if all arguments could be stored.
+ *          -1 if the message must be formatted directly.
+ */
+static int log_store_args (log_record_t * record, const char * fmt, va_list * list)
+{
+   const char * p = fmt;
+   const char * s;
+   log_spec_t spec;
+   uint32_t nargs = 0;
+   uint32_t text_pos = 0;
+   uint32_t len;
+   int precision = -1;
+   int ix;
+
+   while ((p = strchr (p, '%')) != NULL)
+   {
+      if (p[1] == '%')
+      {
+         p += 2;
+         continue;
+      }
+      if (log_parse_spec (p, &spec) != 0 || nargs + spec.stars + 1 > LOG_MAX_ARGS)
+      {
+         return -1;
+      }
+
+      for (ix = 0; ix < spec.stars; ix++)
+      {
+         record->args[nargs++].i = va_arg (*list, int);
+      }
+      precision = (spec.precision == -2) ? (int)record->args[nargs - 1].i : spec.precision;
+
+      switch (spec.type)
+      {
+      case LOG_ARG_INT:
+         record->args[nargs++].i = log_get_int (&spec, list);
+         break;
+      case LOG_ARG_CHAR:
+         record->args[nargs++].i = va_arg (*list, int);
+         break;
+      case LOG_ARG_DOUBLE:
+         record->args[nargs++].d = va_arg (*list, double);
+         break;
+      case LOG_ARG_POINTER:
+         record->args[nargs++].p = va_arg (*list, void *);
+         break;
+      case LOG_ARG_STRING:
+         /* Copy the string, it may not live until it is formatted */
+         s = va_arg (*list, const char *);
+         if (s == NULL)
+         {
+            s = "(null)";
+         }
+         /* With a precision the string need not be terminated */
+         len = strnlen (s, (precision >= 0 && precision < LOG_TEXT_SIZE) ? (size_t)precision : LOG_TEXT_SIZE);
+         if (text_pos + len + 1 > LOG_TEXT_SIZE)
+         {
+            return -1;
+         }
+         memcpy (&record->text[text_pos], s, len);
+         record->text[text_pos + len] = '\0';
+         record->args[nargs++].text_offset = text_pos;
+         text_pos += len + 1;
+         break;
+      }
+
+      p = spec.end;
+   }
+
+   return 0;
+}
+
+/**
+ * Format a record into a line of text.
+ */
+static void log_format_record (const log_record_t * record, char * line, size_t size)
+{
+   const char * p = record->fmt;
+   char spec_fmt[32];
+   size_t pos = 0;
+   size_t len;
+   uint32_t nargs = 0;
+   int width = 0;
+   int precision = 0;
+   int n = 0;
+   log_spec_t spec;
+   struct tm timestruct;
+   char timestamp[10];
+   const char * level = "";
+
+   localtime_r (&record->timestamp.tv_sec, &timestruct);
+   strftime (timestamp, sizeof(timestamp), "%H:%M:%S", &timestruct);
+
+   switch (LOG_LEVEL_GET (record->type))
+   {
+   case LOG_LEVEL_DEBUG:   level = "DEBUG"; break;
+   case LOG_LEVEL_INFO:    level = "INFO "; break;
+   case LOG_LEVEL_WARNING: level = "WARN "; break;
+   case LOG_LEVEL_ERROR:   level = "ERROR"; break;
+   default: break;
+   }
+   pos = snprintf (line, size, "[%s %s] ", timestamp, level);
+
+   if (p == NULL)
+   {
+      snprintf (&line[pos], size - pos, "%s", record->text);
+      return;
+   }
+
+   while (*p != '\0' && pos < size - 1)
+   {
+      if (*p != '%')
+      {
+         line[pos++] = *p++;
+         continue;
+      }
+      if (p[1] == '%')
+      {
+         line[pos++] = '%';
+         p += 2;
+         continue;
+      }
+
+      /* Already checked when the record was stored */
+      (void)log_parse_spec (p, &spec);
+
+      /* Rebuild the specification with "ll" for all integer lengths */
+      len = spec.length - spec.start;
+      if (len + 4 > sizeof(spec_fmt))
+      {
+         break;
+      }
+      memcpy (spec_fmt, spec.start, len);
+      if (spec.type == LOG_ARG_INT)
+      {
+         spec_fmt[len++] = 'l';
+         spec_fmt[len++] = 'l';
+      }
+      spec_fmt[len++] = spec.conversion;
+      spec_fmt[len] = '\0';
+
+      if (spec.stars > 0)
+      {
+         width = (int)record->args[nargs++].i;
+      }
+      if (spec.stars > 1)
+      {
+         precision = (int)record->args[nargs++].i;
+      }
+
+#define LOG_SNPRINTF(value)                                                   \
+      (spec.stars == 0 ? snprintf (&line[pos], size - pos, spec_fmt, value) : \
+       spec.stars == 1 ? snprintf (&line[pos], size - pos, spec_fmt, width, value) : \
+       snprintf (&line[pos], size - pos, spec_fmt, width, precision, value))
+
+      switch (spec.type)
+      {
+      case LOG_ARG_INT:     n = LOG_SNPRINTF (record->args[nargs].i); break;
+      case LOG_ARG_CHAR:    n = LOG_SNPRINTF ((int)record->args[nargs].i); break;
+      case LOG_ARG_DOUBLE:  n = LOG_SNPRINTF (record->args[nargs].d); break;
+      case LOG_ARG_POINTER: n = LOG_SNPRINTF (record->args[nargs].p); break;
+      case LOG_ARG_STRING:  n = LOG_SNPRINTF (&record->text[record->args[nargs].text_offset]); break;
+      }
+#undef LOG_SNPRINTF
+      nargs++;
+
+      if (n > 0)
+      {
+         pos += n;
+         if (pos > size - 1)
+         {
+            pos = size - 1;
+         }
+      }
+      p = spec.end;
+   }
+   line[pos] = '\0';
+}
+
+/**
+ * Format all pending records, in timestamp order, and write them to stdout.
+ *
+ * Also reports dropped records, and frees the rings of terminated threads.
+ */
+static void log_drain (void)
+{
+   log_ring_t * ring;
+   log_ring_t * oldest;
+   log_ring_t ** pp;
+   const log_record_t * record;
+   const log_record_t * oldest_record = NULL;
+   uint32_t dropped;
+   char line[LOG_LINE_SIZE];
+   bool output = false;
+
+   pthread_mutex_lock (&log_format_mutex);
+   do
+   {
+      /* Find the oldest pending record of all threads */
+      oldest = NULL;
+      pthread_mutex_lock (&log_rings_mutex);
+      for (ring = log_rings; ring != NULL; ring = ring->next)
+      {
+         if (__atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) != ring->tail)
+         {
+            record = &ring->records[ring->tail & (LOG_RING_SIZE - 1)];
+            if (oldest == NULL ||
+                record->timestamp.tv_sec < oldest_record->timestamp.tv_sec ||
+                (record->timestamp.tv_sec == oldest_record->timestamp.tv_sec &&
+                 record->timestamp.tv_nsec < oldest_record->timestamp.tv_nsec))
+            {
+               oldest = ring;
+               oldest_record = record;
+            }
+         }
+      }
+      pthread_mutex_unlock (&log_rings_mutex);
+
+      if (oldest != NULL)
+      {
+         log_format_record (oldest_record, line, sizeof(line));
+         fputs (line, stdout);
+         output = true;
+         __atomic_store_n (&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+      }
+   } while (oldest != NULL);
+
+   pthread_mutex_lock (&log_rings_mutex);
+   pp = &log_rings;
+   while (*pp != NULL)
+   {
+      ring = *pp;
+      dropped = __atomic_load_n (&ring->dropped, __ATOMIC_RELAXED);
+      if (dropped != ring->dropped_reported)
+      {
+         printf ("[log] %u messages dropped\n", (unsigned)(dropped - ring->dropped_reported));
+         ring->dropped_reported = dropped;
+         output = true;
+      }
+
+      if (__atomic_load_n (&ring->exited, __ATOMIC_ACQUIRE) &&
+          __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE) == ring->tail)
+      {
+         *pp = ring->next;
+         if (ring->is_static)
+         {
+            log_static_used[ring - log_static_rings] = false;
+         }
+         else
+         {
+            free (ring);
+         }
+      }
+      else
+      {
+         pp = &ring->next;
+      }
+   }
+   pthread_mutex_unlock (&log_rings_mutex);
+
+   if (output)
+   {
+      fflush (stdout);
+   }
+   pthread_mutex_unlock (&log_format_mutex);
+}
+
+static void * log_formatter (void * arg)
+{
+   uint64_t value;
+
+   for (;;)
+   {
+      /* Announce the sleep before the last drain, so that a record
+         stored after the drain is followed by a wakeup */
+      __atomic_store_n (&log_waiting, true, __ATOMIC_SEQ_CST);
+      log_drain();
+      if (read (log_event_fd, &value, sizeof(value)) < 0)
+      {
+         /* Interrupted. Drain again. */
+      }
+   }
+
+   return NULL;
+}
+
+/**
+ * Wake the formatter, if it may be sleeping. Only the first record after
+ * the formatter went to sleep costs a system call.
+ */
+static void log_wake (void)
+{
+   uint64_t value = 1;
+
+   if (__atomic_load_n (&log_waiting, __ATOMIC_SEQ_CST) &&
+       __atomic_exchange_n (&log_waiting, false, __ATOMIC_SEQ_CST))
+   {
+      if (write (log_event_fd, &value, sizeof(value)) < 0)
+      {
+         /* Counter overflow, the formatter is awake anyway */
+      }
+   }
+}
+
+static void log_thread_exit (void * arg)
+{
+   log_ring_t * ring = arg;
+
+   __atomic_store_n (&ring->exited, true, __ATOMIC_RELEASE);
+}
+
+static void log_init (void)
+{
+   pthread_t thread;
+   pthread_attr_t attr;
+
+   pthread_key_create (&log_key, log_thread_exit);
+
+   log_shared_ring.is_shared = true;
+   log_shared_ring.next = log_rings;
+   log_rings = &log_shared_ring;
+
+   /* The formatter runs with default (non real-time) scheduling. Without
+      an eventfd it does not run, and records are written at exit and by
+      os_log_flush() only. */
+   log_event_fd = eventfd (0, EFD_CLOEXEC);
+   if (log_event_fd >= 0)
+   {
+      pthread_attr_init (&attr);
+      pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+      pthread_create (&thread, &attr, log_formatter, NULL);
+      pthread_attr_destroy (&attr);
+   }
+
+   atexit (log_drain);
+}
+
+/**
+ * Make ring the log ring of the calling thread.
+ */
+static void log_set_ring (log_ring_t * ring)
+{
+   ring->next = log_rings;
+   log_rings = ring;
+   pthread_setspecific (log_key, ring);
+   log_thread_ring = ring;
+}
+
+void os_log_thread_init (void)
+{
+   log_ring_t * ring;
+
+   pthread_once (&log_once, log_init);
+
+   ring = os_malloc (sizeof(*ring));
+   if (ring != NULL)
+   {
+      memset (ring, 0, sizeof(*ring));    /* Also faults in the ring */
+      pthread_mutex_lock (&log_rings_mutex);
+      log_set_ring (ring);
+      pthread_mutex_unlock (&log_rings_mutex);
+   }
+}
+
+/**
+ * Return the log ring of the calling thread. A thread not created by the
+ * OSAL takes a free static ring at first use, or the shared ring if all
+ * static rings are taken.
+ *
+ * @return  The ring.
+ */
+static log_ring_t * log_get_ring (void)
+{
+   log_ring_t * ring = log_thread_ring;
+   size_t ix;
+
+   if (ring == NULL)
+   {
+      pthread_once (&log_once, log_init);
+
+      pthread_mutex_lock (&log_rings_mutex);
+      for (ix = 0; (ix < LOG_STATIC_RINGS) && (ring == NULL); ix++)
+      {
+         if (!log_static_used[ix])
+         {
+            log_static_used[ix] = true;
+            ring = &log_static_rings[ix];
+            memset (ring, 0, sizeof(*ring));
+            ring->is_static = true;
+            log_set_ring (ring);
+         }
+      }
+      pthread_mutex_unlock (&log_rings_mutex);
+
+      if (ring == NULL)
+      {
+         /* Never marked as exited, so no thread-specific value */
+         ring = &log_shared_ring;
+         log_thread_ring = ring;
+      }
+   }
+
+   return ring;
+}
+
+void os_log (int type, const char * fmt, ...)
+{
+   va_list list;
+   va_list copy;
+   log_ring_t * ring = log_get_ring();
+   log_record_t * record;
+   uint32_t head;
+   size_t len;
+
+   if (ring->is_shared)
+   {
+      pthread_mutex_lock (&log_shared_mutex);
+   }
+
+   head = ring->head;
+   if (head - __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE)
+   {
+      __atomic_store_n (&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+      if (ring->is_shared)
+      {
+         pthread_mutex_unlock (&log_shared_mutex);
+      }
+      return;
+   }
+
+   record = &ring->records[head & (LOG_RING_SIZE - 1)];
+   clock_gettime (CLOCK_REALTIME, &record->timestamp);
+   record->type = type;
+   record->fmt = fmt;
+
+   va_start (list, fmt);
+   va_copy (copy, list);
+   if (log_store_args (record, fmt, &copy) != 0)
+   {
+      /* Too complex for a record. Store the (possibly truncated) text. */
+      record->fmt = NULL;
+      if (vsnprintf (record->text, sizeof(record->text), fmt, list) >= (int)sizeof(record->text))
+      {
+         /* Truncated. Keep the line break. */
+         len = strlen (fmt);
+         if ((len > 0) && (fmt[len - 1] == '\n'))
+         {
+            record->text[sizeof(record->text) - 2] = '\n';
+         }
+      }
+   }
+   va_end (copy);
+   va_end (list);
+
+   __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+   if (ring->is_shared)
+   {
+      pthread_mutex_unlock (&log_shared_mutex);
+   }
+
+   log_wake();
+}
+
+void os_log_flush (void)
+{
+   log_drain();
+}
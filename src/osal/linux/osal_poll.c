@@ -0,0 +1,133 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <osal.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+static int os_poll_watch (int epoll_fd, int fd)
+{
+   struct epoll_event event;
+
+   memset (&event, 0, sizeof(event));
+   event.events = EPOLLIN;
+   event.data.fd = fd;
+
+   return epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd, &event);
+}
+
+os_poll_t * os_poll_create (void)
+{
+   os_poll_t * poll = os_malloc (sizeof(*poll));
+
+   if (poll == NULL)
+   {
+      return NULL;
+   }
+
+   poll->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+   poll->event_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+   poll->timer_fd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+   if ((poll->epoll_fd < 0) || (poll->event_fd < 0) || (poll->timer_fd < 0) ||
+       (os_poll_watch (poll->epoll_fd, poll->event_fd) != 0) ||
+       (os_poll_watch (poll->epoll_fd, poll->timer_fd) != 0))
+   {
+      os_poll_destroy (poll);
+      return NULL;
+   }
+
+   return poll;
+}
+
+int os_poll_fd (os_poll_t * poll)
+{
+   return poll->epoll_fd;
+}
+
+int os_poll_add (os_poll_t * poll, uint32_t id)
+{
+   return (os_poll_watch (poll->epoll_fd, (int)id) == 0) ? 0 : -1;
+}
+
+void os_poll_wake (os_poll_t * poll)
+{
+   uint64_t one = 1;
+
+   if (write (poll->event_fd, &one, sizeof(one)) != sizeof(one))
+   {
+      /* The counter is full, so the descriptor is readable anyway */
+   }
+}
+
+void os_poll_arm (os_poll_t * poll, uint32_t delay)
+{
+   struct itimerspec its;
+
+   memset (&its, 0, sizeof(its));
+   its.it_value.tv_sec = delay / 1000000;
+   its.it_value.tv_nsec = (delay % 1000000) * 1000;
+   if (delay == 0)
+   {
+      its.it_value.tv_nsec = 1;  /* All zero would disarm */
+   }
+
+   timerfd_settime (poll->timer_fd, 0, &its, NULL);
+}
+
+void os_poll_disarm (os_poll_t * poll)
+{
+   struct itimerspec its;
+
+   memset (&its, 0, sizeof(its));
+   timerfd_settime (poll->timer_fd, 0, &its, NULL);
+}
+
+void os_poll_clear (os_poll_t * poll)
+{
+   uint64_t count;
+
+   /* Non-blocking. Nothing to read is not an error here */
+   if (read (poll->event_fd, &count, sizeof(count)) < 0)
+   {
+      count = 0;
+   }
+   if (read (poll->timer_fd, &count, sizeof(count)) < 0)
+   {
+      count = 0;
+   }
+}
+
+void os_poll_destroy (os_poll_t * poll)
+{
+   if (poll->timer_fd >= 0)
+   {
+      close (poll->timer_fd);
+   }
+   if (poll->event_fd >= 0)
+   {
+      close (poll->event_fd);
+   }
+   if (poll->epoll_fd >= 0)
+   {
+      close (poll->epoll_fd);
+   }
+   free (poll);
+}
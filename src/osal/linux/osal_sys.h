@@ -25,6 +25,7 @@ extern "C"
 #include <time.h>
 #include <netinet/in.h>
 #include <inttypes.h>
+#include <stdbool.h>
 
 #define OS_THREAD
 #define OS_MUTEX
@@ -38,27 +39,29 @@ extern "C"
 typedef pthread_t os_thread_t;
 typedef pthread_mutex_t os_mutex_t;
 
+/* The futex words are only changed with atomic operations */
+
 typedef struct os_sem
 {
-   pthread_cond_t cond;
-   pthread_mutex_t mutex;
-   size_t count;
+   uint32_t count;               /* Futex word */
+   uint32_t waiters;
 } os_sem_t;
 
 typedef struct os_event
 {
-   pthread_cond_t cond;
-   pthread_mutex_t mutex;
-   uint32_t flags;
+   uint32_t flags;               /* Futex word */
+   uint32_t waiters;
 } os_event_t;
 
 typedef struct os_mbox
 {
-   pthread_cond_t cond;
-   pthread_mutex_t mutex;
+   pthread_mutex_t mutex;        /* Priority inheritance */
+   uint32_t count;               /* Futex word for fetchers */
+   uint32_t space;               /* Futex word for posters */
+   uint32_t fetch_waiters;
+   uint32_t post_waiters;
    size_t r;
    size_t w;
-   size_t count;
    size_t size;
    void * msg[];
 } os_mbox_t;
@@ -81,6 +84,13 @@ typedef struct os_buf
    uint16_t len;
 } os_buf_t;
 
+typedef struct os_poll
+{
+   int epoll_fd;           /* The descriptor given to the application */
+   int event_fd;           /* Readable after os_poll_wake() */
+   int timer_fd;           /* Readable when the timeout expires */
+} os_poll_t;
+
 /**
  * The prototype of raw Ethernet reception call-back functions.
  * *
@@ -100,8 +110,20 @@ typedef struct os_eth_handle
    void                    *arg;
    int                     socket;
    os_thread_t             *thread;
+   bool                    running;          /* Cleared by os_eth_destroy() */
+   int                     phc_fd;           /* Clock of the hardware timestamps, or -1 */
+   int                     saved_rx_filter;  /* Restored by os_eth_destroy(), or -1 */
+   char                    if_name[16];      /* IFNAMSIZ */
+   uint64_t                rx_read;          /* When the frame being handled was read */
+   struct timespec         rx_ts[3];         /* Its software and raw hardware timestamps, if any */
 } os_eth_handle_t;
 
+/**
+ * Give the calling thread its own log ring, so that os_log() does not need
+ * to allocate one. Called by the OSAL for the threads that it creates.
+ */
+void os_log_thread_init (void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,25 +46,25 @@ extern "C"
 #define CC_FROM_LE64(x)       __builtin_bswap64 (x)
 #endif
 
-#define CC_ATOMIC_GET8(p)     (*p)
-#define CC_ATOMIC_GET16(p)    (*p)
-#define CC_ATOMIC_GET32(p)    (*p)
+#define CC_ATOMIC_GET8(p)     (*(p))
+#define CC_ATOMIC_GET16(p)    (*(p))
+#define CC_ATOMIC_GET32(p)    (*(p))
 #define CC_ATOMIC_GET64(p)                      \
 ({                                              \
    uint64_t v;                                  \
    int_lock();                                  \
-   v = *p;                                      \
+   v = *(p);                                    \
    int_unlock();                                \
    v;                                           \
 })
 
-#define CC_ATOMIC_SET8(p, v)  ((*p) = (v))
-#define CC_ATOMIC_SET16(p, v) ((*p) = (v))
-#define CC_ATOMIC_SET32(p, v) ((*p) = (v))
+#define CC_ATOMIC_SET8(p, v)  ((*(p)) = (v))
+#define CC_ATOMIC_SET16(p, v) ((*(p)) = (v))
+#define CC_ATOMIC_SET32(p, v) ((*(p)) = (v))
 #define CC_ATOMIC_SET64(p, v)                   \
 ({                                              \
    int_lock();                                  \
-   *p = v;                                      \
+   *(p) = (v);                                  \
    int_unlock();                                \
 })
 
@@ -165,17 +165,61 @@ void os_log (int type, const char * fmt, ...)
    va_end (list);
 }
 
+void os_log_flush (void)
+{
+   /* os_log() writes directly */
+}
+
+static uint32_t os_alloc_cnt = 0;     /* Heap allocations made by the OSAL */
+
 void * os_malloc (size_t size)
 {
+   os_alloc_cnt++;
    return malloc (size);
 }
 
+void os_free (void * ptr)
+{
+   free (ptr);
+}
+
+uint32_t os_alloc_count (void)
+{
+   return os_alloc_cnt;
+}
+
+int os_mem_lock (size_t heap_size)
+{
+   /* No virtual memory, so nothing is paged in later */
+   return 0;
+}
+
 os_thread_t * os_thread_create (const char * name, int priority,
         int stacksize, void (*entry) (void * arg), void * arg)
 {
    return task_spawn (name, entry, priority, stacksize, arg);
 }
 
+os_thread_t * os_thread_create_cfg (const char * name,
+        const os_thread_cfg_t * p_cfg, void (*entry) (void * arg), void * arg)
+{
+   /* Single core with fixed priority scheduling. Only priority and stack
+      size apply */
+   if ((p_cfg->cpu_mask & ~1ULL) != 0)
+   {
+      return NULL;
+   }
+   return task_spawn (name, entry, p_cfg->priority, p_cfg->stack_size, arg);
+}
+
+void os_thread_join (os_thread_t * thread)
+{
+   /* A task is reclaimed by the kernel when its entry function returns.
+      The caller has already waited for the thread to signal that it is
+      returning. */
+   (void)thread;
+}
+
 os_mutex_t * os_mutex_create (void)
 {
    return mtx_create();
@@ -206,6 +250,31 @@ uint32_t os_get_current_time_us (void)
    return 1000 * tick_to_ms (tick_get());
 }
 
+/* The 32-bit kernel tick, extended to 64 bits. Updated with interrupts
+   locked, as it may be read from timer callbacks */
+static uint32_t os_tick_last = 0;
+static uint64_t os_tick_wraps = 0;     /* Ticks counted by earlier wraps */
+
+uint64_t os_get_current_time_ns (void)
+{
+   uint32_t tick;
+   uint64_t ticks;
+   uint64_t ticks_per_second = tick_from_ms (1000);
+
+   int_lock();
+   tick = tick_get();
+   if (tick < os_tick_last)
+   {
+      os_tick_wraps += (uint64_t)1 << 32;
+   }
+   os_tick_last = tick;
+   ticks = os_tick_wraps + tick;
+   int_unlock();
+
+   return (ticks / ticks_per_second) * 1000 * 1000 * 1000 +
+          (ticks % ticks_per_second) * 1000 * 1000 * 1000 / ticks_per_second;
+}
+
 os_sem_t * os_sem_create (size_t count)
 {
    return sem_create (count);
@@ -323,6 +392,15 @@ os_timer_t * os_timer_create (uint32_t us, void (*fn) (os_timer_t *, void * arg)
                       (oneshot) ? TMR_ONCE : TMR_CYCL);
 }
 
+os_timer_t * os_timer_create_cfg (uint32_t us, void (*fn) (os_timer_t *, void * arg),
+                                  void * arg, bool oneshot,
+                                  const os_thread_cfg_t * p_thread_cfg)
+{
+   /* Timer callbacks run in the rt-kernel timer task */
+   (void)p_thread_cfg;
+   return os_timer_create (us, fn, arg, oneshot);
+}
+
 void os_timer_set (os_timer_t * timer, uint32_t us)
 {
    tmr_set (timer, tick_from_ms (us / 1000));
@@ -355,6 +433,54 @@ void os_buf_free(os_buf_t *p)
    }
 }
 
+os_poll_t * os_poll_create (void)
+{
+   /* No file descriptors to wait on */
+   return NULL;
+}
+
+int os_poll_fd (os_poll_t * poll)
+{
+   return -1;
+}
+
+int os_poll_add (os_poll_t * poll, uint32_t id)
+{
+   return -1;
+}
+
+void os_poll_wake (os_poll_t * poll)
+{
+}
+
+void os_poll_arm (os_poll_t * poll, uint32_t delay)
+{
+}
+
+void os_poll_disarm (os_poll_t * poll)
+{
+}
+
+void os_poll_clear (os_poll_t * poll)
+{
+}
+
+void os_poll_destroy (os_poll_t * poll)
+{
+}
+
+int os_buf_pool_init (uint16_t count)
+{
+   /* Buffers always come from the lwIP pbuf pool */
+   return 0;
+}
+
+int os_buf_count (void)
+{
+   /* Buffers come from the lwIP pbuf pool, which keeps its own statistics */
+   return -1;
+}
+
 uint8_t os_buf_header(os_buf_t *p, int16_t header_size_increment)
 {
    return pbuf_header(p, header_size_increment);
@@ -28,13 +28,14 @@ static int nic_index = 0;
 os_eth_handle_t* os_eth_init(
    const char              *if_name,
    os_eth_callback_t       *callback,
-   void                    *arg)
+   void                    *arg,
+   const os_thread_cfg_t   *p_thread_cfg)
 {
    os_eth_handle_t         *handle;
    struct netif            *found_if;
    drv_t                   *drv;
 
-   handle = malloc(sizeof(os_eth_handle_t));
+   handle = os_malloc(sizeof(os_eth_handle_t));
    UASSERT (handle != NULL, EMEM);
 
    handle->arg = arg;
@@ -76,6 +77,21 @@ os_eth_handle_t* os_eth_init(
    }
 }
 
+void os_eth_destroy(
+   os_eth_handle_t         *handle)
+{
+   drv_t                   *drv = dev_find_driver (NET_DRIVER_NAME);
+
+   /* The frames are received in the driver, there is no thread to stop */
+   if (drv != NULL)
+   {
+      eth_ioctl(drv, handle->arg, IOCTL_NET_SET_RX_HOOK, NULL);
+   }
+   interface[handle->if_id] = NULL;
+   nic_index--;
+   free(handle);
+}
+
 int os_eth_send(
    os_eth_handle_t   *handle,
    os_buf_t          *buf)
@@ -95,3 +111,10 @@ int os_eth_send(
    }
    return ret;
 }
+
+uint64_t os_eth_rx_timestamp(
+   os_eth_handle_t   *handle)
+{
+   /* The receive hook is called by the driver as the frame arrives */
+   return os_get_current_time_ns();
+}
@@ -83,6 +83,9 @@ typedef struct os_eth_handle
    int if_id;
 } os_eth_handle_t;
 
+/* No file descriptors, os_poll_create() always fails */
+typedef struct os_poll os_poll_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,112 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include <string.h>
+#include "pf_includes.h"
+
+/* Wait until the socket is readable or writable, or the timeout expires */
+static int os_tcp_wait (uint32_t id, bool write, uint32_t tmo)
+{
+   fd_set fds;
+   struct timeval tv;
+
+   if (id >= FD_SETSIZE)
+   {
+      return -1;
+   }
+
+   FD_ZERO (&fds);
+   FD_SET (id, &fds);
+   tv.tv_sec = tmo / 1000;
+   tv.tv_usec = (tmo % 1000) * 1000;
+
+   return select (id + 1, write ? NULL : &fds, write ? &fds : NULL, NULL, &tv) > 0 ? 0 : -1;
+}
+
+int os_tcp_listen (os_ipaddr_t addr, os_ipport_t port)
+{
+   struct sockaddr_in local;
+   int id;
+   int one = 1;
+
+   id = socket (PF_INET, SOCK_STREAM, IPPROTO_TCP);
+   if (id < 0)
+   {
+      return -1;
+   }
+
+   (void)setsockopt (id, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+   local = (struct sockaddr_in) {
+      .sin_family = AF_INET,
+      .sin_addr.s_addr = htonl(addr),
+      .sin_port = htons(port),
+   };
+   if ((bind (id, (struct sockaddr *)&local, sizeof(local)) != 0) ||
+       (listen (id, 4) != 0))
+   {
+      close (id);
+      return -1;
+   }
+
+   return id;
+}
+
+int os_tcp_accept (uint32_t id, uint32_t tmo)
+{
+   if (os_tcp_wait (id, false, tmo) != 0)
+   {
+      return -1;
+   }
+
+   return accept (id, NULL, NULL);
+}
+
+int os_tcp_recv (uint32_t id, uint8_t * data, int size, uint32_t tmo)
+{
+   if (os_tcp_wait (id, false, tmo) != 0)
+   {
+      return -1;
+   }
+
+   return recv (id, data, size, 0);
+}
+
+int os_tcp_send (uint32_t id, const uint8_t * data, int size, uint32_t tmo)
+{
+   int sent = 0;
+   int len;
+
+   while (sent < size)
+   {
+      if (os_tcp_wait (id, true, tmo) != 0)
+      {
+         return -1;
+      }
+      len = send (id, &data[sent], size - sent, MSG_DONTWAIT);
+      if (len <= 0)
+      {
+         return -1;
+      }
+      sent += len;
+   }
+
+   return sent;
+}
+
+void os_tcp_close (uint32_t id)
+{
+   close (id);
+}
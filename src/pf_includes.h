@@ -29,6 +29,7 @@ extern "C"
 #include "options.h"
 #include "osal.h"
 #include "log.h"
+#include "pf_trace.h"
 
 #include "pnet_api.h"
 
@@ -38,11 +39,16 @@ extern "C"
 #include "pf_alarm.h"
 #include "pf_cpm.h"
 #include "pf_dcp.h"
+#include "pf_dfp.h"
 #include "pf_eth.h"
 #include "pf_lldp.h"
+#include "pf_metrics.h"
+#include "pf_nvs.h"
+#include "pf_stats.h"
 #include "pf_ppm.h"
 #include "pf_ptcp.h"
 #include "pf_scheduler.h"
+#include "pf_worker.h"
 
 /* device */
 #include "pf_cmdev.h"
@@ -54,6 +60,8 @@ extern "C"
 #include "pf_cmrpc.h"
 #include "pf_cmrpc_helpers.h"
 #include "pf_cmrs.h"
+#include "pf_cmsr.h"
+#include "pf_fsu.h"
 #include "pf_cmsm.h"
 #include "pf_cmsu.h"
 #include "pf_cmwrr.h"
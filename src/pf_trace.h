@@ -0,0 +1,62 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Static tracepoints on the cyclic and acyclic paths.
+ *
+ * With USE_USDT the tracepoints are USDT probes in the "pnet" provider.
+ * An unused probe is a single nop instruction, so they may be left in
+ * production builds. List and attach them with for example:
+ *
+ *     bpftrace -l 'usdt:./pn_dev:pnet:*'
+ *     bpftrace -e 'usdt:./pn_dev:pnet:ppm_send_done { @[arg0] = count(); }'
+ *
+ * Without USE_USDT the macros expand to nothing and the arguments are
+ * not evaluated.
+ *
+ * Probes and arguments:
+ *   eth_recv          Ethertype, frame ID, frame length
+ *   cpm_accept        Frame ID, cycle counter
+ *   cpm_reject        Frame ID, cycle counter, reason (bit 0: frame
+ *                     structure, bit 1: cycle counter, bit 2: data valid,
+ *                     bit 3: wrong state; set if the check failed)
+ *   ppm_send_start    Frame ID, cycle counter
+ *   ppm_send_done     Frame ID, bytes sent or -1
+ *   sched_dispatch    Owner name (string), lateness in microseconds
+ *   alarm_send        Frame ID, PDU type, sequence number
+ *   alarm_ack         Frame ID, acknowledged sequence number
+ *   rpc_req_start     Request length, remote port
+ *   rpc_req_end       Response length
+ */
+
+#ifndef PF_TRACE_H
+#define PF_TRACE_H
+
+#if defined(USE_USDT)
+#include <sys/sdt.h>
+
+#define PF_TRACE1(name, a1)                  DTRACE_PROBE1(pnet, name, a1)
+#define PF_TRACE2(name, a1, a2)              DTRACE_PROBE2(pnet, name, a1, a2)
+#define PF_TRACE3(name, a1, a2, a3)          DTRACE_PROBE3(pnet, name, a1, a2, a3)
+#define PF_TRACE4(name, a1, a2, a3, a4)      DTRACE_PROBE4(pnet, name, a1, a2, a3, a4)
+#else
+#define PF_TRACE1(name, a1)                  do { } while (0)
+#define PF_TRACE2(name, a1, a2)              do { } while (0)
+#define PF_TRACE3(name, a1, a2, a3)          do { } while (0)
+#define PF_TRACE4(name, a1, a2, a3, a4)      do { } while (0)
+#endif
+
+#endif /* PF_TRACE_H */
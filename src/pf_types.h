@@ -772,24 +772,47 @@ typedef struct pf_alarm_err
     */
 } pf_alarm_err_t;
 
-#define PF_MAX_SESSION                    (2*(PNET_MAX_AR) + 1)               /* 2 per ar, and one spare. */
+/*
+ * The tables below are allocated by pnet_init() for net->max_ar ARs,
+ * see pnet_cfg_t.max_ar.
+ */
+#define PF_MAX_SESSION(nbr_ar)            (2*(nbr_ar) + 1)                    /* 2 per ar, and one spare. */
+
+/*
+ * Number of IOCRs per AR: the input and output CRs, and the multicast
+ * provider and consumer CRs.
+ */
+#if PNET_OPTION_MC_CR
+#define PF_MAX_MC_CR                      (PNET_MAX_MC_CR)
+#else
+#define PF_MAX_MC_CR                      0
+#endif
+#define PF_MAX_IOCR                       ((PNET_MAX_CR) + (PF_MAX_MC_CR))
 
 /*
- * Keep this value small as it define the number of entries in the
- * frame id map and all entries are probed until a match is found.
+ * Number of frame ids in the frame id map. The map is a hash table with at
+ * least twice as many entries, so the frame handler is found in a few probes
+ * whatever the number of ARs.
  *
  * Each input CR may have 2 frameIds (for RTC3)
  * Add space for DCP:     0xfefc..0xfeff.
  * Add space for alarms:  0xfc01, 0xfe01.
+ * Add space for PTCP:    0x0020, 0x0080, 0xff20, 0xff40, 0xff43.
  */
-#define PF_ETH_MAX_MAP                    ((PNET_MAX_API) * (PNET_MAX_AR) * (PNET_MAX_CR) * 2 + 4 + 2)
+#define PF_ETH_MAX_MAP(nbr_ar)            ((PNET_MAX_API) * (nbr_ar) * (PF_MAX_IOCR) * 2 + 4 + 2 + 5)
 
 /**
  * The scheduler is used by both the CPM and PPM machines.
  * The DCP uses the scheduler for responding to multi-cast messages.
  * pf_cmsm uses it to supervise the startup sequence.
+ * Per AR: one per CR, two for the alarm transmitters, and pf_cmsm and pf_cmio.
+ * pf_cmdmc supervises each multicast CR.
+ * PTCP measures the line delay periodically.
  */
-#define PF_MAX_TIMEOUTS                   (2 * (PNET_MAX_AR) * (PNET_MAX_CR) + 10)
+#define PF_MAX_TIMEOUTS(nbr_ar)           ((nbr_ar) * ((PF_MAX_IOCR) + (PF_MAX_MC_CR) + 4) + 11)
+#define PF_SCHEDULER_LATENESS_BUCKETS     9                                   /* See pf_scheduler_lateness_bounds */
+
+#define PF_METRICS_BUFFER_SIZE            16384                               /* One metrics response */
 
 #define PF_CMINA_FS_HELLO_RETRY           3
 #define PF_CMINA_FS_HELLO_INTERVAL        (3*1000)     /* milliseconds. Default is 30 ms */
@@ -823,12 +846,12 @@ typedef enum pf_cmwrr_state_values
  * The prototype of the externally supplied call-back functions.
  * @param net              InOut: The p-net stack instance
  * @param arg              In:   User-defined (may be NULL).
- * @param current_time     In:   The current system time in microseconds.
+ * @param current_time     In:   The current system time in nanoseconds.
  */
 typedef void (*pf_scheduler_timeout_ftn_t)(
    pnet_t                     *net,
    void                       *arg,
-   uint32_t                   current_time);
+   uint64_t                   current_time);
 
 
 typedef struct pf_scheduler_timeouts
@@ -836,14 +859,103 @@ typedef struct pf_scheduler_timeouts
    const char                    *p_name; /* For debugging only */
    bool                          in_use;  /* For debugging only */
 
-   uint32_t                      when;    /* absolute time of timeout */
+   uint64_t                      when;    /* absolute time of timeout, in nanoseconds */
    uint32_t                      next;    /* Next in list */
    uint32_t                      prev;    /* Previous in list */
+   volatile uint32_t             *p_q;    /* The list it is in, or NULL */
 
    pf_scheduler_timeout_ftn_t    cb;      /* Call-back to call on timeout */
    void                          *arg;    /* call-back argument */
 } pf_scheduler_timeouts_t;
 
+#define PF_WORKER_JOBS                 16
+
+/**
+ * The prototype of the jobs of the control-plane worker thread.
+ * @param net              InOut: The p-net stack instance
+ * @param arg              In:   User-defined (may be NULL).
+ */
+typedef void (*pf_worker_ftn_t)(
+   pnet_t                     *net,
+   void                       *arg);
+
+typedef struct pf_worker_job
+{
+   pf_worker_ftn_t               ftn;
+   void                          *arg;
+} pf_worker_job_t;
+
+/* The synchronized clock: master time = master_ref + (t - local_ref) * (1 + rate) */
+typedef struct pf_ptcp_clock
+{
+   int64_t                 master_ref;                   /* Nanoseconds */
+   uint64_t                local_ref;                    /* Nanoseconds */
+   int64_t                 rate;                         /* ppb */
+   uint64_t                last_sync;                    /* Receive time of the last sync frame. Nanoseconds */
+} pf_ptcp_clock_t;
+
+/* The PTCP sync slave, see pf_ptcp.h */
+typedef struct pf_ptcp
+{
+   os_mutex_t              *mutex;                       /* Not taken by the PPM and CPM, see clock_seq */
+   pnet_ptcp_state_t       state;
+   pnet_ethaddr_t          master_addr;
+   bool                    sync_pending;                 /* A sync frame waits for its follow up */
+   uint16_t                sync_sequence;                /* Of the pending sync frame */
+   uint64_t                sync_rx;                      /* Its receive time */
+   uint32_t                sync_delay;                   /* Its accumulated delay */
+
+   bool                    clock_valid;
+   pf_ptcp_clock_t         clock;
+   int64_t                 integral;                     /* ppb */
+   int64_t                 offset;                       /* At the last sync frame. Nanoseconds */
+   uint16_t                lock_count;
+   uint32_t                sync_count;
+   uint32_t                step_count;
+
+   /* Line delay measurement */
+   uint32_t                line_delay;                   /* Nanoseconds */
+   bool                    line_delay_valid;
+   uint16_t                delay_sequence;
+   uint64_t                delay_req_sent;               /* 0 if no request is outstanding */
+   bool                    delay_running;                /* Requests are sent while a master is followed */
+   uint32_t                delay_timeout;
+
+   /* Copy of clock for the cyclic path, which does not take the mutex */
+   uint32_t                clock_seq;                    /* Odd while clock_copy is written */
+   pf_ptcp_clock_t         clock_copy;
+} pf_ptcp_t;
+
+/* System redundancy AR sets, see pf_cmsr.h */
+typedef struct pf_cmsr
+{
+   uint32_t                switchovers;
+   uint32_t                primary_losses;
+   uint16_t                primary_arep;                 /* Of the last switchover */
+   uint64_t                last_switchover;              /* Nanoseconds */
+} pf_cmsr_t;
+
+/* The metrics of an IOCR, copied by pf_metrics_periodic() */
+typedef struct pf_metrics_iocr
+{
+   uint16_t                frame_id;
+   bool                    provider;                     /* Input IOCR, sent by the PPM */
+   uint32_t                frames;
+   uint32_t                errors;
+   uint32_t                cycle_us;
+   uint32_t                dht;                          /* Output IOCRs only */
+} pf_metrics_iocr_t;
+
+/* The metrics of an AR, copied by pf_metrics_periodic() */
+typedef struct pf_metrics_ar
+{
+   bool                    in_use;
+   uint16_t                nbr_iocrs;
+   pf_metrics_iocr_t       iocrs[PF_MAX_IOCR];
+   uint32_t                alarm_depth[2];               /* Low and high priority */
+   uint32_t                alarm_lost[2];
+} pf_metrics_ar_t;
+
 /**
  * This is the prototype for the Profinet frame handler.
  *
@@ -864,6 +976,7 @@ typedef int (*pf_eth_frame_handler_t)(
 typedef struct pf_eth_frame_id_map
 {
    bool                    in_use;
+   bool                    probed;              /* Has been in use. Lookups continue past it */
    uint16_t                frame_id;
    pf_eth_frame_handler_t  frame_handler;
    void                    *p_arg;
@@ -909,6 +1022,29 @@ typedef struct pf_cmina_dcp_ase
    } dhcp_info;
 } pf_cmina_dcp_ase_t;
 
+typedef struct nvramIMSave
+{
+	pnet_im_1_t	im_1_data;
+	pnet_im_2_t im_2_data;
+	pnet_im_3_t im_3_data;
+	pnet_im_4_t im_4_data;	
+}NVRAM_IM_SAVE;
+
+/*
+ * Copied by the RX thread for the jobs of the worker thread, which must not
+ * read cmina_temp_dcp_ase or fspm_cfg while they change.
+ */
+typedef struct pf_cmina_commit
+{
+   bool                    ip_suite_pending;             /* Set the IP suite below */
+   bool                    dhcp_enable;
+   pf_ip_suite_t           ip_suite;
+   char                    name_of_station[240 + 1];     /* Terminated */
+   uint16_t                block_qualifier;
+   NVRAM_IM_SAVE           im;                           /* Saved by a reset */
+   pnet_lldp_peer_cfg_t    lldp_peer_req;                /* Saved by a reset */
+} pf_cmina_commit_t;
+
 
 /* ====== AR typedefs ============== */
 
@@ -1285,6 +1421,15 @@ typedef struct pf_dfp_iocr
    pf_subframe_data_t      subframe_data;
 } pf_dfp_iocr_t;
 
+/* The subframe of a DFP IOCR, see pf_dfp.h */
+typedef struct pf_dfp_subframe
+{
+   bool                    active;
+   uint16_t                offset;                       /* In the C-SDU of the packed frame */
+   uint8_t                 position;
+   uint8_t                 length;                       /* Of the data of the subframe */
+} pf_dfp_subframe_t;
+
 typedef struct pf_ir_info
 {
    bool                    valid;
@@ -1393,7 +1538,7 @@ typedef struct pf_ppm
    pf_ppm_state_values_t   state;
 
    int                     errline;                      /* Not yet used */
-   uint32_t                errcnt;                       /* Not yet used */
+   uint32_t                errcnt;                       /* Send errors */
 
    pnet_ethaddr_t          sa;                           /* Source MAC address */
    pnet_ethaddr_t          da;                           /* Destination MAC address (IO-controller) */
@@ -1411,6 +1556,7 @@ typedef struct pf_ppm
    uint16_t                cycle_counter_offset;         /* Start position of cycle counter in frame */
    uint16_t                data_status_offset;           /* Start position of data status in frame */
    uint16_t                transfer_status_offset;       /* Start position of transfer status in frame */
+   pf_dfp_subframe_t       dfp;                          /* Data goes into this subframe, if active */
 
    uint8_t                 buffer_data[PF_FRAME_BUFFER_SIZE];   /* Max */
 
@@ -1431,7 +1577,7 @@ typedef struct pf_ppm
 typedef struct pf_cpm
 {
    pf_cpm_state_values_t   state;
-   uint32_t                max_exec;
+   uint32_t                max_exec;                     /* Longest control interval handling, in microseconds */
 
    int                     errline;
    uint32_t                errcnt;
@@ -1440,6 +1586,8 @@ typedef struct pf_cpm
    uint32_t                free_cnt;
 
    pnet_ethaddr_t          sa;                  /* Mac of the controller */
+   bool                    mc_consumer;         /* Check da instead of sa */
+   pnet_ethaddr_t          mc_da;               /* Multicast address of an MC consumer CR */
 
    uint16_t                nbr_frame_id;        /* 1 or 2 */
    uint16_t                frame_id[2];         /* 2 needed for some instances of RT_CLASS_3 */
@@ -1453,6 +1601,7 @@ typedef struct pf_cpm
    uint8_t                 data_status;
    uint16_t                buffer_length;
    uint16_t                buffer_pos;          /* Start of PROFINET data in frame */
+   pf_dfp_subframe_t       dfp;                 /* Data is taken from this subframe, if active */
 
    uint16_t                dht;
    bool                    new_data;
@@ -1496,6 +1645,13 @@ struct pf_ar;
 struct pf_alpmx;
 
 /* IOCR = IO Communication Relation */
+typedef enum pf_cmdmc_state_values
+{
+   PF_CMDMC_STATE_IDLE,
+   PF_CMDMC_STATE_W_FRAME,                       /* Waiting for the first frame from the provider */
+   PF_CMDMC_STATE_RUN
+} pf_cmdmc_state_values_t;
+
 typedef struct pf_iocr
 {
    struct pf_ar            *p_ar;
@@ -1505,7 +1661,8 @@ typedef struct pf_iocr
    pf_ppm_t                ppm;                          /* Handles input  */
 
    uint16_t                mppm;
-   uint16_t                cmdmc;
+   pf_cmdmc_state_values_t cmdmc_state;                  /* MC consumer CRs only */
+   uint32_t                cmdmc_timer;
    uint16_t                dfp;
 
    /* Total frame content (data, IOCS and IOPS) length after L2 header (buffer_pos) */
@@ -1519,6 +1676,70 @@ typedef struct pf_iocr
    pf_iocr_result_t        result;                       /* From connect.ind */
 } pf_iocr_t;
 
+#define PF_FSU_CACHE_ENTRIES              2
+#define PF_FSU_REQUEST_SIZE               1500
+#define PF_FSU_MAX_DESC                   64
+#define PF_FSU_VERSION                    1        /* Bump when the cached layout changes */
+
+/* The layout of one sub-slot in an IOCR frame, see pf_iodata_object_t */
+typedef struct pf_fsu_desc
+{
+   uint32_t                api_id;
+   uint16_t                slot_nbr;
+   uint16_t                subslot_nbr;
+   uint16_t                data_offset;
+   uint16_t                data_length;
+   uint16_t                iops_offset;
+   uint16_t                iops_length;
+   uint16_t                iocs_offset;
+   uint16_t                iocs_length;
+} pf_fsu_desc_t;
+
+typedef struct pf_fsu_iocr
+{
+   uint16_t                frame_id;                     /* After pf_cmdev_fix_frame_id() */
+   uint16_t                in_length;
+   uint16_t                out_length;
+   uint16_t                nbr_data_desc;
+} pf_fsu_iocr_t;
+
+/*
+ * A connect request that has been accepted, with the IOCR layouts derived
+ * from it. The ARUUID and SessionKey of the request are cleared, as they
+ * change on every connect.
+ */
+typedef struct pf_fsu_entry
+{
+   bool                    valid;
+   bool                    is_big_endian;
+   uint32_t                fingerprint;
+   uint16_t                req_len;
+   uint8_t                 req[PF_FSU_REQUEST_SIZE];
+   uint16_t                nbr_iocrs;
+   pf_fsu_iocr_t           iocrs[PF_MAX_IOCR];
+   uint16_t                nbr_desc;                     /* Of all IOCRs, in order */
+   pf_fsu_desc_t           desc[PF_FSU_MAX_DESC];
+} pf_fsu_entry_t;
+
+/* The fast-startup cache, as saved in the nonvolatile store */
+typedef struct pf_fsu_cache
+{
+   uint32_t                version;                      /* PF_FSU_VERSION */
+   uint16_t                next;                         /* Entry to replace next */
+   pf_fsu_entry_t          entries[PF_FSU_CACHE_ENTRIES];
+} pf_fsu_cache_t;
+
+/* Fast-startup cache of connect requests, see pf_fsu.h */
+typedef struct pf_fsu
+{
+   os_mutex_t              *mutex;                       /* Protects cache against the nonvolatile save */
+   os_mutex_t              *save_mutex;                  /* Protects save_copy */
+   uint32_t                hits;
+   uint32_t                misses;
+   pf_fsu_cache_t          cache;
+   pf_fsu_cache_t          save_copy;                    /* Written without holding mutex */
+} pf_fsu_t;
+
 typedef enum pf_cmsm_state_values
 {
    PF_CMSM_STATE_IDLE,
@@ -1590,6 +1811,9 @@ typedef struct pf_apmx
    uint16_t					alarm_seq_num;
    /* The receive queue */
    os_mbox_t               *p_alarm_q;
+   uint32_t                alarm_q_posted;               /* Only written by the receive thread */
+   uint32_t                alarm_q_lost;                 /* Only written by the receive thread */
+   uint32_t                alarm_q_fetched;              /* Only written by pf_alarm_periodic() */
    /* The messages sent via the mailbox */
    pf_apmr_msg_t           apmr_msg[PNET_MAX_ALARMS];
    uint16_t                apmr_msg_nbr;
@@ -1739,7 +1963,7 @@ typedef struct pf_ar
    pf_ar_rpc_result_t      ar_rpc_result;                /* From connect.ind */
 
    uint16_t                nbr_iocrs;                    /* From connect.req */
-   pf_iocr_t               iocrs[PNET_MAX_CR];
+   pf_iocr_t               iocrs[PF_MAX_IOCR];
 
    uint16_t                nbr_exp_apis;
    pf_exp_api_t            exp_apis[PNET_MAX_API];       /* From connect.req */
@@ -1790,6 +2014,9 @@ typedef struct pf_ar
 #endif
 #if PNET_OPTION_SR
    pf_sr_info_t            sr_info;
+   bool                    sr_primary_ind;               /* Last State bit from the CPM. Written by the RX thread */
+   bool                    sr_state_posted;              /* pf_cmsr_state_job() is scheduled */
+   uint32_t                sr_timer;
 #endif
 #if PNET_OPTION_REDUNDANCY
    struct
@@ -1808,6 +2035,7 @@ typedef struct pf_ar
 #endif
 #if PNET_OPTION_FAST_STARTUP
    pf_ar_fsu_t             fast_startup_data;
+   const pf_fsu_entry_t    *p_fsu_entry;                 /* Cached layout of this connect, or NULL */
 #endif
 } pf_ar_t;
 
@@ -1925,6 +2153,9 @@ typedef struct pf_diag_usi
 /* This is the end of list designator. */
 #define PF_DIAG_IX_NULL    UINT16_MAX
 
+/* Number of chains in the diag item index. Must be a power of 2. */
+#define PF_DIAG_HASH_SIZE  64
+
 typedef struct pf_diag_item
 {
    /* The selector is the usi member (0x0000..0x7fff => usi, else std) */
@@ -1965,6 +2196,7 @@ typedef struct pf_subslot
     * It points to the list of reported diag alarms for this specific sub-slot.
     */
    uint16_t                diag_list;
+   uint16_t                diag_fault_count; /* Number of FAULT items in diag_list */
 } pf_subslot_t;
 
 typedef struct pf_slot
@@ -1991,6 +2223,38 @@ typedef struct pf_api
    pf_ar_t                 *p_ar;
 } pf_api_t;
 
+#define PF_IDENT_CACHE_ENTRIES            4
+#define PF_IDENT_CACHE_DATA_SIZE          1024
+
+/*
+ * The request parameters that a cached identification response depends on.
+ */
+typedef struct pf_ident_cache_key
+{
+   pf_ar_t                 *p_ar;
+   uint32_t                api_id;
+   uint16_t                slot_nbr;
+   uint16_t                subslot_nbr;
+   uint16_t                block_type;
+   uint8_t                 block_version_low;
+   uint8_t                 filter_level;
+   uint8_t                 stop_level;
+   bool                    is_big_endian;
+} pf_ident_cache_key_t;
+
+/*
+ * A serialized identification or I&M0 filter response, including its
+ * block header(s).
+ */
+typedef struct pf_ident_cache_entry
+{
+   bool                    valid;
+   uint32_t                generation; /* Of the device tree when serialized */
+   pf_ident_cache_key_t    key;
+   uint16_t                len;
+   uint8_t                 data[PF_IDENT_CACHE_DATA_SIZE];
+} pf_ident_cache_entry_t;
+
 /*
  * The device struct contains information about the configured API's.
  * The api member contains a hierarchy which may be traversed using
@@ -2010,6 +2274,27 @@ typedef struct pf_device
    os_mutex_t              *diag_mutex;      /* Protect the diag items */
    pf_diag_item_t          diag_items[PNET_MAX_DIAG_ITEMS];
    uint16_t                diag_items_free;  /* Head of the unused list */
+
+   /*
+    * Index of the reported diag items, so that an item can be found and
+    * unlinked without walking the sub-slot lists. Protected by diag_mutex.
+    * Except for diag_hash, the arrays are indexed like diag_items[].
+    */
+   uint16_t                diag_hash[PF_DIAG_HASH_SIZE];       /* Head of each chain */
+   uint16_t                diag_hash_next[PNET_MAX_DIAG_ITEMS]; /* Next in the same chain */
+   uint16_t                diag_prev[PNET_MAX_DIAG_ITEMS];      /* Previous in the sub-slot list */
+   pf_subslot_t            *diag_subslot[PNET_MAX_DIAG_ITEMS];  /* Sub-slot of a linked item */
+
+   /*
+    * Identification responses that have already been serialized.
+    * An entry is only used while its generation equals ident_generation,
+    * which is bumped by pf_cmdev_ident_changed() whenever the device tree,
+    * the AR ownership or the I&M data changes.
+    */
+   uint32_t                ident_generation;
+   uint32_t                ident_cache_hits;    /* Responses taken from the cache */
+   uint16_t                ident_cache_next;    /* Entry to replace next */
+   pf_ident_cache_entry_t  ident_cache[PF_IDENT_CACHE_ENTRIES];
 } pf_device_t;
 
 /*
@@ -2120,15 +2405,56 @@ typedef struct pf_log_book
    bool                    wrap;       /* All entries valid */
 } pf_log_book_t;
 
-typedef struct pf_interface_stats
+/* ============= Nonvolatile store typedefs ================== */
+
+/* Keys of the records in the nonvolatile store. */
+typedef enum pf_nvs_key
 {
-	uint32_t ifInOctects;
-	uint32_t ifOutOctects;
-	uint32_t ifInDiscards;
-	uint32_t ifOutDiscards;
-	uint32_t ifInErrors;
-	uint32_t ifOutErrors;
-}pnet_interface_stats_t;
+   PF_NVS_KEY_IM = 0,            /* I&M1-4 data */
+   PF_NVS_KEY_DIAG,              /* Diagnosis items */
+   PF_NVS_KEY_PDEV,              /* PDev records */
+   PF_NVS_KEY_FSU,               /* Fast-startup cache. Journal only. */
+   PF_NVS_KEY_MAX
+} pf_nvs_key_t;
+
+#define PF_NVS_BUFFER_SIZE                1024     /* Used for CRC check and compaction */
+
+/* Location of the latest version of a record in the journal file. */
+typedef struct pf_nvs_record
+{
+   bool                    valid;
+   uint32_t                offset;     /* Of the entry header */
+   uint32_t                len;        /* Of the record data */
+   uint32_t                crc;        /* Of the entry */
+} pf_nvs_record_t;
+
+/* The threads that update the interface counters. Each has its own slot. */
+typedef enum pf_stats_ctx
+{
+   PF_STATS_CTX_RX = 0,       /* Ethernet receive thread */
+   PF_STATS_CTX_PERIODIC,     /* pnet_handle_periodic() and API calls from its thread */
+   PF_STATS_CTX_RPC,          /* pf_cmrpc_periodic(): the UDP thread, if used */
+   PF_STATS_CTX_CYCLIC,       /* PPM transmission, possibly from a RT timer */
+   PF_STATS_CTX_WORKER,       /* The control-plane worker thread */
+   PF_STATS_CTX_TIMER,        /* The LLDP timer, if PNET_OS_RTOS_SUPPORTED */
+   PF_STATS_CTX_MAX
+} pf_stats_ctx_t;
+
+#define PF_CACHE_LINE_SIZE                64
+
+/*
+ * A slot is padded with one spare cache line, so that two slots never share
+ * a line even if the pnet struct itself is not cache line aligned.
+ */
+#define PF_STATS_SLOT_SIZE                                                    \
+   ((((sizeof(pnet_traffic_stats_t) * PNET_TRAFFIC_CLASS_MAX) +               \
+      PF_CACHE_LINE_SIZE - 1) / PF_CACHE_LINE_SIZE + 1) * PF_CACHE_LINE_SIZE)
+
+typedef union pf_stats_slot
+{
+   pnet_traffic_stats_t    traffic[PNET_TRAFFIC_CLASS_MAX];
+   uint8_t                 pad[PF_STATS_SLOT_SIZE];
+} pf_stats_slot_t;
 
 struct pnet
 {
@@ -2146,14 +2472,36 @@ struct pnet
    uint32_t                            dcp_sam_timeout; /* Handle to the SAM timeout instance */
    os_eth_handle_t                     *eth_handle;
    os_thread_t             				*udpThread;
-   pf_eth_frame_id_map_t               eth_id_map[PF_ETH_MAX_MAP];
-   volatile pf_scheduler_timeouts_t    scheduler_timeouts[PF_MAX_TIMEOUTS];
+   uint16_t                            max_ar;                   /* See pnet_cfg_t.max_ar */
+   pf_eth_frame_id_map_t               *eth_id_map;              /* Hash table, see pf_eth_frame_id_map_add() */
+   uint16_t                            eth_id_map_size;          /* Power of 2 */
+   volatile pf_scheduler_timeouts_t    *scheduler_timeouts;
+   uint32_t                            scheduler_max_timeouts;   /* Also the "none" index of the lists */
    volatile uint32_t                   scheduler_timeout_first;
+   volatile uint32_t                   scheduler_timeout_last;
    volatile uint32_t                   scheduler_timeout_free;
    os_mutex_t                          *scheduler_timeout_mutex;
    uint32_t                            scheduler_tick_interval;  /* microseconds */
+   uint32_t                            scheduler_lateness[PF_SCHEDULER_LATENESS_BUCKETS];  /* Only written by pf_scheduler_tick() */
+   uint32_t                            scheduler_lateness_sum;   /* microseconds */
+   bool                                scheduler_poll_armed;     /* Protected by scheduler_timeout_mutex */
+   uint64_t                            scheduler_poll_when;      /* When the poll timeout expires, if armed. Nanoseconds */
+   os_poll_t                           *poll;                    /* NULL until pnet_get_fd(). Published atomically */
    bool                                cmdev_initialized;
    pf_device_t                         cmdev_device;
+   os_mutex_t                          *cmdmc_mutex;           /* Protects the CMDMC state and timer of all IOCRs */
+   os_thread_t                         *diag_nonvol_thread;
+   os_event_t                          *diag_nonvol_events;
+   pf_diag_item_t                      diag_nonvol_snapshot[PNET_MAX_DIAG_ITEMS]; /* Only used by diag_nonvol_thread */
+   os_mutex_t                          *worker_mutex;          /* Kept by pf_worker_exit() */
+   os_thread_t                         *worker_thread;         /* NULL if jobs are run by the caller. Protected by worker_mutex */
+   os_mbox_t                           *worker_q;              /* Posted jobs */
+   os_mbox_t                           *worker_free;           /* Free jobs */
+   os_event_t                          *worker_events;
+   pf_worker_job_t                     worker_jobs[PF_WORKER_JOBS];
+   pf_ptcp_t                           ptcp;
+   pf_cmsr_t                           cmsr;
+   pf_fsu_t                            fsu;
    pf_cmina_dcp_ase_t                  cmina_perm_dcp_ase;
    pf_cmina_dcp_ase_t                  cmina_temp_dcp_ase;
    pf_cmina_state_values_t             cmina_state;
@@ -2162,11 +2510,14 @@ struct pnet
    uint16_t                            cmina_hello_count;
    uint32_t                            cmina_hello_timeout;
    uint32_t							   cmina_timeout;
-   bool                                cmina_commit_ip_suite;
+   bool                                cmina_commit_ip_suite;    /* Only used by the RX thread. See cmina_commit */
+   os_mutex_t                          *cmina_commit_mutex;
+   pf_cmina_commit_t                   cmina_commit;             /* Protected by cmina_commit_mutex */
    os_mutex_t                          *p_cmrpc_rpc_mutex;
    uint32_t                            cmrpc_session_number;
-   pf_ar_t                             cmrpc_ar[PNET_MAX_AR];
-   pf_session_info_t                   cmrpc_session_info[PF_MAX_SESSION];
+   pf_ar_t                             *cmrpc_ar;                /* net->max_ar entries */
+   pf_session_info_t                   *cmrpc_session_info;
+   uint16_t                            cmrpc_max_session;
    int                                 cmrpc_rpcreq_socket;
    bool								   cmrpc_keepAlive;
    uint8_t                             cmrpc_dcerpc_req_frame[PF_FRAME_BUFFER_SIZE];
@@ -2177,8 +2528,24 @@ struct pnet
    pnet_cfg_t                          fspm_cfg;
    pf_log_book_t                       fspm_log_book;
    os_mutex_t                          *fspm_log_book_mutex;
-   pnet_interface_stats_t			   interface_statistics;
+   os_mutex_t                          *nvs_mutex;
+   pf_nvs_record_t                     nvs_records[PF_NVS_KEY_MAX];
+   uint32_t                            nvs_file_size;
+   uint8_t                             nvs_buffer[PF_NVS_BUFFER_SIZE];
+   pf_stats_slot_t                     stats[PF_STATS_CTX_MAX];  /* Only written by the owning thread */
+#if PNET_OPTION_METRICS
+   os_thread_t                         *metrics_thread;
+   bool                                metrics_running;          /* Cleared by pf_metrics_exit() */
+   bool                                metrics_req;              /* Set by metrics_thread, cleared by pf_metrics_periodic() */
+   uint32_t                            metrics_seq;              /* Odd while the snapshot is written */
+   uint16_t                            metrics_sessions;
+   pf_metrics_ar_t                     *metrics_ars;             /* Snapshot of the max_ar ARs. NULL if not allocated. */
+   char                                metrics_buffer[PF_METRICS_BUFFER_SIZE]; /* Only used by metrics_thread */
+#endif
    os_timer_handle_t				   *interrupt_timer_handle;
+   bool                                rt_prmend_seen;           /* Only with fspm_cfg.rt_startup */
+   bool                                rt_alloc_reported;
+   uint32_t                            rt_alloc_count_prmend;    /* os_alloc_count() at the last PRMEND */
 };
 
 typedef struct pdev_record
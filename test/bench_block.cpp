@@ -0,0 +1,309 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_block_reader.h"
+#include "pf_block_writer.h"
+#include "pf_includes.h"
+
+#include <string.h>
+
+static pf_ar_t             bench_ar;
+static uint8_t             bench_res[PF_MAX_UDP_PAYLOAD_SIZE];
+
+/* The DCE RPC header, NDR data and AR block of a connect request */
+static void BlockGetConnectHeader(benchmark::State& state)
+{
+   pf_get_info_t           get_info;
+   pf_rpc_header_t         rpc_req;
+   pf_ndr_data_t           ndr_data;
+   pf_block_header_t       block_header;
+   uint16_t                pos;
+
+   for (auto _ : state)
+   {
+      get_info.result = PF_PARSE_OK;
+      get_info.is_big_endian = false;
+      get_info.p_buf = bench_connect_req;
+      get_info.len = bench_connect_req_len;
+      pos = 0;
+
+      pf_get_dce_rpc_header(&get_info, &pos, &rpc_req);
+      pf_get_ndr_data(&get_info, &pos, &ndr_data);
+      get_info.is_big_endian = true;
+      pf_get_block_header(&get_info, &pos, &block_header);
+      pf_get_ar_param(&get_info, &pos, &bench_ar);
+      benchmark::DoNotOptimize(pos);
+   }
+
+   if (get_info.result != PF_PARSE_OK)
+   {
+      state.SkipWithError("Parse error");
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+BENCHMARK(BlockGetConnectHeader);
+
+/*
+ * A large connect request: one expected module per slot, each with
+ * PNET_MAX_SUBMODULES IO submodules, and an IOCR with one frame descriptor
+ * per submodule. The argument is the number of modules.
+ */
+static uint16_t bench_put_exp_modules(
+   uint16_t                nbr_modules,
+   uint8_t                 *p_buf)
+{
+   uint16_t                pos = 0;
+   uint16_t                ix;
+   uint16_t                iy;
+
+   pf_put_uint16(true, nbr_modules, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+   for (ix = 0; ix < nbr_modules; ix++)
+   {
+      pf_put_uint32(true, 0, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);            /* API */
+      pf_put_uint16(true, ix + 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);       /* Slot */
+      pf_put_uint32(true, 0x32, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);         /* Module ident */
+      pf_put_uint16(true, 0, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);            /* Properties */
+      pf_put_uint16(true, PNET_MAX_SUBMODULES, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+      for (iy = 0; iy < PNET_MAX_SUBMODULES; iy++)
+      {
+         pf_put_uint16(true, iy + 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);    /* Subslot */
+         pf_put_uint32(true, 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);         /* Submodule ident */
+         pf_put_uint16(true, PNET_DIR_IO, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_uint16(true, 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);         /* Input */
+         pf_put_uint16(true, 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_byte(1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_byte(1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_uint16(true, 2, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);         /* Output */
+         pf_put_uint16(true, 1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_byte(1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+         pf_put_byte(1, PF_MAX_UDP_PAYLOAD_SIZE, p_buf, &pos);
+      }
+   }
+
+   return pos;
+}
+
+static void BlockGetExpectedSubmodules(benchmark::State& state)
+{
+   static uint8_t          req[PF_MAX_UDP_PAYLOAD_SIZE];
+   pf_get_info_t           get_info;
+   uint16_t                len = bench_put_exp_modules((uint16_t)state.range(0), req);
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      get_info.result = PF_PARSE_OK;
+      get_info.is_big_endian = true;
+      get_info.p_buf = req;
+      get_info.len = len;
+      pos = 0;
+      bench_ar.nbr_exp_apis = 0;
+      memset(bench_ar.exp_apis, 0, sizeof(bench_ar.exp_apis));
+
+      pf_get_exp_api_module(&get_info, &pos, &bench_ar);
+      benchmark::DoNotOptimize(pos);
+   }
+
+   if ((get_info.result != PF_PARSE_OK) || (pos != len))
+   {
+      state.SkipWithError("Parse error");
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+   state.SetItemsProcessed(state.iterations() * state.range(0) * PNET_MAX_SUBMODULES);
+}
+BENCHMARK(BlockGetExpectedSubmodules)->DenseRange(1, PNET_MAX_MODULES);
+
+static void BlockGetIocrParam(benchmark::State& state)
+{
+   static uint8_t          req[PF_MAX_UDP_PAYLOAD_SIZE];
+   pf_get_info_t           get_info;
+   uint16_t                nbr_objects = (uint16_t)state.range(0) * PNET_MAX_SUBMODULES;
+   uint16_t                len = 0;
+   uint16_t                pos = 0;
+   uint16_t                ix;
+   uint16_t                iy;
+
+   pf_put_uint16(true, PF_IOCR_TYPE_INPUT, sizeof(req), req, &len);
+   pf_put_uint16(true, 1, sizeof(req), req, &len);                         /* Reference */
+   pf_put_uint16(true, 0x8892, sizeof(req), req, &len);                    /* LT */
+   pf_put_uint32(true, 2, sizeof(req), req, &len);                         /* RT_CLASS_2 */
+   pf_put_uint16(true, 40, sizeof(req), req, &len);                        /* Data length */
+   pf_put_uint16(true, 0x8001, sizeof(req), req, &len);                    /* Frame ID */
+   pf_put_uint16(true, 32, sizeof(req), req, &len);                        /* SCF */
+   pf_put_uint16(true, 1, sizeof(req), req, &len);                         /* RR */
+   pf_put_uint16(true, 1, sizeof(req), req, &len);                         /* Phase */
+   pf_put_uint16(true, 0, sizeof(req), req, &len);                         /* Sequence */
+   pf_put_uint32(true, 0xffffffff, sizeof(req), req, &len);                /* Frame send offset */
+   pf_put_uint16(true, 3, sizeof(req), req, &len);                         /* Watchdog factor */
+   pf_put_uint16(true, 3, sizeof(req), req, &len);                         /* Data hold factor */
+   pf_put_uint16(true, 0xc000, sizeof(req), req, &len);                    /* Tag header */
+   len += sizeof(pnet_ethaddr_t);                                          /* Multicast MAC */
+   pf_put_uint16(true, 1, sizeof(req), req, &len);                         /* Number of APIs */
+   pf_put_uint32(true, 0, sizeof(req), req, &len);                         /* API */
+   for (ix = 0; ix < 2; ix++)                                              /* IO data, then IOCS */
+   {
+      pf_put_uint16(true, nbr_objects, sizeof(req), req, &len);
+      for (iy = 0; iy < nbr_objects; iy++)
+      {
+         pf_put_uint16(true, 1 + iy / PNET_MAX_SUBMODULES, sizeof(req), req, &len);
+         pf_put_uint16(true, 1 + iy % PNET_MAX_SUBMODULES, sizeof(req), req, &len);
+         pf_put_uint16(true, iy, sizeof(req), req, &len);
+      }
+   }
+
+   for (auto _ : state)
+   {
+      get_info.result = PF_PARSE_OK;
+      get_info.is_big_endian = true;
+      get_info.p_buf = req;
+      get_info.len = len;
+      pos = 0;
+
+      pf_get_iocr_param(&get_info, &pos, 0, &bench_ar);
+      benchmark::DoNotOptimize(pos);
+   }
+
+   if ((get_info.result != PF_PARSE_OK) || (pos != len))
+   {
+      state.SkipWithError("Parse error");
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+BENCHMARK(BlockGetIocrParam)->DenseRange(1, PNET_MAX_MODULES);
+
+static void BlockPutDceRpcHeader(benchmark::State& state)
+{
+   pf_get_info_t           get_info;
+   pf_rpc_header_t         rpc_req;
+   uint16_t                pos = 0;
+   uint16_t                pos_body_len;
+   uint16_t                pos_lkup_len;
+
+   get_info.result = PF_PARSE_OK;
+   get_info.is_big_endian = false;
+   get_info.p_buf = bench_connect_req;
+   get_info.len = bench_connect_req_len;
+   pf_get_dce_rpc_header(&get_info, &pos, &rpc_req);
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_dce_rpc_header(&rpc_req, sizeof(bench_res), bench_res, &pos,
+         &pos_body_len, &pos_lkup_len);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+BENCHMARK(BlockPutDceRpcHeader);
+
+static void BlockPutArResult(benchmark::State& state)
+{
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_ar_result(true, &bench_ar, sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+BENCHMARK(BlockPutArResult);
+
+static void BlockPutIm0(benchmark::State& state)
+{
+   pnet_im_0_t             im_0;
+   uint16_t                pos = 0;
+
+   memset(&im_0, 0, sizeof(im_0));
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_im_0(true, &im_0, sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+BENCHMARK(BlockPutIm0);
+
+/* RealIdentificationData of the whole device, as read by the controller */
+BENCHMARK_F (PnetConnectedBench, BlockPutRealIdentData)(benchmark::State& state)
+{
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_ident_data(stack.net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+         PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+         sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+
+/* As above, but the device tree changes before each read */
+BENCHMARK_F (PnetConnectedBench, BlockPutRealIdentDataUncached)(benchmark::State& state)
+{
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_cmdev_ident_changed(stack.net);
+      pf_put_ident_data(stack.net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+         PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+         sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+
+/* I&M0FilterData, as read by the controller at startup */
+BENCHMARK_F (PnetConnectedBench, BlockPutIm0FilterData)(benchmark::State& state)
+{
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_im_0_filter_data(stack.net, true, sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+}
+
+/* RecordInputDataObjectElement, fetched directly from the PPM buffer */
+BENCHMARK_F (PnetConnectedBench, BlockPutInputData)(benchmark::State& state)
+{
+   uint16_t                pos = 0;
+
+   for (auto _ : state)
+   {
+      pos = 0;
+      pf_put_input_data(stack.net, true, TEST_API_IDENT, 1, TEST_SUBMOD_CUSTOM_IDENT,
+         sizeof(bench_res), bench_res, &pos);
+      benchmark::DoNotOptimize(bench_res);
+   }
+   state.SetBytesProcessed(state.iterations() * pos);
+
+   if ((connected == false) || (pos == 0))
+   {
+      state.SkipWithError("No input data in the connected AR");
+   }
+}
@@ -0,0 +1,47 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+
+/*
+ * Full processing of a connect request: DCE RPC, block decoding, AR and
+ * CR allocation, expected configuration callbacks and the response.
+ * The AR is released between iterations, outside of the timing.
+ */
+BENCHMARK_F (PnetBench, CmrpcConnect)(benchmark::State& state)
+{
+   bool                    ok = true;
+
+   for (auto _ : state)
+   {
+      stack.rpc(bench_connect_req, bench_connect_req_len);
+
+      state.PauseTiming();
+      ok = ok && (stack.appdata.call_counters.connect_calls == 1);
+      stack.rpc(bench_release_req, bench_release_req_len);
+      stack.appdata.call_counters.connect_calls = 0;
+      mock_clear();
+      state.ResumeTiming();
+   }
+
+   if (ok == false)
+   {
+      state.SkipWithError("Connect request not accepted");
+   }
+}
@@ -0,0 +1,73 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <string.h>
+
+
+/* Accept path: valid frame with a new cycle counter, data copied to the CPM */
+BENCHMARK_F (PnetConnectedBench, CpmDataInd)(benchmark::State& state)
+{
+   pf_iocr_t               *p_iocr = NULL;
+   os_buf_t                *p_buf;
+
+   if (connected == true)
+   {
+      p_iocr = stack.find_iocr(PF_IOCR_TYPE_OUTPUT);
+   }
+   if (p_iocr == NULL)
+   {
+      state.SkipWithError("No output CR");
+   }
+
+   for (auto _ : state)
+   {
+      p_buf = stack.data_frame();
+      (void)pf_cpm_c_data_ind(stack.net, BENCH_DATA_FRAME_ID, p_buf, BENCH_FRAME_ID_POS, p_iocr);
+   }
+
+   if ((p_iocr != NULL) && (p_iocr->cpm.state != PF_CPM_STATE_RUN))
+   {
+      state.SkipWithError("CPM not running");
+   }
+}
+
+/* Reject path: the recorded cycle counter over and over */
+BENCHMARK_F (PnetConnectedBench, CpmDataIndStaleCycle)(benchmark::State& state)
+{
+   pf_iocr_t               *p_iocr = NULL;
+   os_buf_t                *p_buf;
+
+   if (connected == true)
+   {
+      p_iocr = stack.find_iocr(PF_IOCR_TYPE_OUTPUT);
+   }
+   if (p_iocr == NULL)
+   {
+      state.SkipWithError("No output CR");
+   }
+
+   for (auto _ : state)
+   {
+      p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+      memcpy(p_buf->payload, bench_data_packet, bench_data_packet_len);
+      p_buf->len = bench_data_packet_len;
+      (void)pf_cpm_c_data_ind(stack.net, BENCH_DATA_FRAME_ID, p_buf, BENCH_FRAME_ID_POS, p_iocr);
+   }
+}
@@ -0,0 +1,81 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <string.h>
+
+
+/*
+ * Baseline for the benchmarks that feed a fresh frame per iteration.
+ * Subtract this from their timings to get the cost of the stack itself.
+ */
+BENCHMARK_F (PnetBench, BufAllocCopyFree)(benchmark::State& state)
+{
+   os_buf_t                *p_buf;
+
+   for (auto _ : state)
+   {
+      p_buf = stack.data_frame();
+      benchmark::DoNotOptimize(p_buf);
+      os_buf_free(p_buf);
+   }
+}
+
+/* Frame id lookup of a frame that no handler claims */
+BENCHMARK_F (PnetBench, EthRecvUnknownFrameId)(benchmark::State& state)
+{
+   os_buf_t                *p_buf;
+   int                     handled = 0;
+
+   p_buf = stack.data_frame();
+   ((uint8_t *)p_buf->payload)[BENCH_FRAME_ID_POS] = 0x7f;   /* Not registered */
+   ((uint8_t *)p_buf->payload)[BENCH_FRAME_ID_POS + 1] = 0x00;
+
+   for (auto _ : state)
+   {
+      handled += pf_eth_recv(stack.net, p_buf);
+   }
+
+   os_buf_free(p_buf);
+   if (handled != 0)
+   {
+      state.SkipWithError("Frame unexpectedly handled");
+   }
+}
+
+/* Frame id lookup and CPM of a cyclic data frame */
+BENCHMARK_F (PnetConnectedBench, EthRecvCyclicData)(benchmark::State& state)
+{
+   os_buf_t                *p_buf;
+
+   if (connected == false)
+   {
+      state.SkipWithError("Connect failed");
+   }
+
+   for (auto _ : state)
+   {
+      p_buf = stack.data_frame();
+      if (pf_eth_recv(stack.net, p_buf) == 0)
+      {
+         os_buf_free(p_buf);
+      }
+   }
+   state.SetBytesProcessed(state.iterations() * bench_data_packet_len);
+}
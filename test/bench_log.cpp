@@ -0,0 +1,88 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Logging overhead in the cyclic data path
+ *
+ * state.range(0) is the runtime log level of all modules. The messages of
+ * the stack below the compile-time LOG_LEVEL are not in the build, so build
+ * with LOG_LEVEL DEBUG (the default) to measure all of them.
+ */
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BENCH_LOG_BATCH                            128   /* Frames. Their messages fit in the log ring of a thread */
+
+/*
+ * Frame id lookup and CPM of a cyclic data frame, as EthRecvCyclicData, at
+ * each runtime log level. The rings are drained outside of the timing, with
+ * the output discarded.
+ */
+BENCHMARK_DEFINE_F (PnetConnectedBench, LogCyclicPath)(benchmark::State& state)
+{
+   os_buf_t                *p_buf;
+   uint32_t                frame = 0;
+   int                     saved_stdout;
+   int                     null_fd;
+
+   if (connected == false)
+   {
+      state.SkipWithError("Connect failed");
+   }
+
+   os_log_flush();
+   fflush(stdout);
+   saved_stdout = dup(STDOUT_FILENO);
+   null_fd = open("/dev/null", O_WRONLY);
+   dup2(null_fd, STDOUT_FILENO);
+
+   (void)pnet_set_log_level(NULL, PNET_LOG_MODULE_ALL, (uint8_t)state.range(0));
+
+   for (auto _ : state)
+   {
+      p_buf = stack.data_frame();
+      if (pf_eth_recv(stack.net, p_buf) == 0)
+      {
+         os_buf_free(p_buf);
+      }
+
+      if (++frame % BENCH_LOG_BATCH == 0)
+      {
+         state.PauseTiming();
+         os_log_flush();
+         state.ResumeTiming();
+      }
+   }
+   state.SetBytesProcessed(state.iterations() * bench_data_packet_len);
+
+   (void)pnet_set_log_level(NULL, PNET_LOG_MODULE_ALL, LOG_RUNTIME_LEVEL);
+   os_log_flush();
+   fflush(stdout);
+   dup2(saved_stdout, STDOUT_FILENO);
+   close(saved_stdout);
+   close(null_fd);
+}
+
+BENCHMARK_REGISTER_F (PnetConnectedBench, LogCyclicPath)
+   ->Arg(PNET_LOG_LEVEL_OFF)
+   ->Arg(PNET_LOG_LEVEL_ERROR)
+   ->Arg(PNET_LOG_LEVEL_DEBUG);
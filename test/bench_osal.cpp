@@ -0,0 +1,337 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Latency of the OSAL synchronization primitives
+ *
+ * The Osal variants use the OSAL of the platform. The Condvar variants use a
+ * copy of the earlier Linux implementation, a priority inheritance mutex and
+ * a condition variable per object, for comparison.
+ */
+
+#include "utils_for_benchmark.h"
+
+#include "pf_includes.h"
+
+#include <pthread.h>
+
+/************************ Earlier implementation ****************************/
+
+typedef struct bench_cv_sem
+{
+   pthread_cond_t          cond;
+   pthread_mutex_t         mutex;
+   size_t                  count;
+} bench_cv_sem_t;
+
+typedef struct bench_cv_mbox
+{
+   pthread_cond_t          cond;
+   pthread_mutex_t         mutex;
+   size_t                  r;
+   size_t                  w;
+   size_t                  count;
+   size_t                  size;
+   void                    *msg[16];
+} bench_cv_mbox_t;
+
+static void bench_cv_mutex_init(
+   pthread_mutex_t         *mutex)
+{
+   pthread_mutexattr_t     attr;
+
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+   pthread_mutex_init(mutex, &attr);
+}
+
+/* Only OS_WAIT_FOREVER and 0 are used here */
+static int bench_cv_sem_wait(
+   bench_cv_sem_t          *sem,
+   uint32_t                time)
+{
+   int                     ret = 0;
+
+   pthread_mutex_lock(&sem->mutex);
+   while ((sem->count == 0) && (time != 0))
+   {
+      pthread_cond_wait(&sem->cond, &sem->mutex);
+   }
+   if (sem->count > 0)
+   {
+      sem->count--;
+   }
+   else
+   {
+      ret = 1;
+   }
+   pthread_mutex_unlock(&sem->mutex);
+
+   return ret;
+}
+
+static void bench_cv_sem_signal(
+   bench_cv_sem_t          *sem)
+{
+   pthread_mutex_lock(&sem->mutex);
+   sem->count++;
+   pthread_mutex_unlock(&sem->mutex);
+   pthread_cond_signal(&sem->cond);
+}
+
+static int bench_cv_mbox_fetch(
+   bench_cv_mbox_t         *mbox,
+   void                    **msg,
+   uint32_t                time)
+{
+   int                     ret = 0;
+
+   pthread_mutex_lock(&mbox->mutex);
+   while ((mbox->count == 0) && (time != 0))
+   {
+      pthread_cond_wait(&mbox->cond, &mbox->mutex);
+   }
+   if (mbox->count > 0)
+   {
+      *msg = mbox->msg[mbox->r++];
+      if (mbox->r == mbox->size)
+         mbox->r = 0;
+      mbox->count--;
+   }
+   else
+   {
+      ret = 1;
+   }
+   pthread_mutex_unlock(&mbox->mutex);
+   pthread_cond_signal(&mbox->cond);      /* Also on timeout, as before */
+
+   return ret;
+}
+
+static int bench_cv_mbox_post(
+   bench_cv_mbox_t         *mbox,
+   void                    *msg,
+   uint32_t                time)
+{
+   pthread_mutex_lock(&mbox->mutex);
+   while (mbox->count == mbox->size)
+   {
+      pthread_cond_wait(&mbox->cond, &mbox->mutex);
+   }
+   mbox->msg[mbox->w++] = msg;
+   if (mbox->w == mbox->size)
+      mbox->w = 0;
+   mbox->count++;
+   pthread_mutex_unlock(&mbox->mutex);
+   pthread_cond_signal(&mbox->cond);
+
+   return 0;
+}
+
+/************************ Implementations under test ************************/
+
+struct BenchOsal
+{
+   typedef os_sem_t sem_t;
+   typedef os_mbox_t mbox_t;
+
+   static sem_t *sem_create() { return os_sem_create(0); }
+   static void sem_destroy(sem_t *sem) { os_sem_destroy(sem); }
+   static int sem_wait(sem_t *sem, uint32_t time) { return os_sem_wait(sem, time); }
+   static void sem_signal(sem_t *sem) { os_sem_signal(sem); }
+
+   static mbox_t *mbox_create() { return os_mbox_create(16); }
+   static void mbox_destroy(mbox_t *mbox) { os_mbox_destroy(mbox); }
+   static int mbox_fetch(mbox_t *mbox, void **msg, uint32_t time) { return os_mbox_fetch(mbox, msg, time); }
+   static int mbox_post(mbox_t *mbox, void *msg) { return os_mbox_post(mbox, msg, OS_WAIT_FOREVER); }
+};
+
+struct BenchCondvar
+{
+   typedef bench_cv_sem_t sem_t;
+   typedef bench_cv_mbox_t mbox_t;
+
+   static sem_t *sem_create()
+   {
+      sem_t *sem = new sem_t();
+      pthread_cond_init(&sem->cond, NULL);
+      bench_cv_mutex_init(&sem->mutex);
+      return sem;
+   }
+   static void sem_destroy(sem_t *sem)
+   {
+      pthread_cond_destroy(&sem->cond);
+      pthread_mutex_destroy(&sem->mutex);
+      delete sem;
+   }
+   static int sem_wait(sem_t *sem, uint32_t time) { return bench_cv_sem_wait(sem, time); }
+   static void sem_signal(sem_t *sem) { bench_cv_sem_signal(sem); }
+
+   static mbox_t *mbox_create()
+   {
+      mbox_t *mbox = new mbox_t();
+      pthread_cond_init(&mbox->cond, NULL);
+      bench_cv_mutex_init(&mbox->mutex);
+      mbox->size = NELEMENTS(mbox->msg);
+      return mbox;
+   }
+   static void mbox_destroy(mbox_t *mbox)
+   {
+      pthread_cond_destroy(&mbox->cond);
+      pthread_mutex_destroy(&mbox->mutex);
+      delete mbox;
+   }
+   static int mbox_fetch(mbox_t *mbox, void **msg, uint32_t time) { return bench_cv_mbox_fetch(mbox, msg, time); }
+   static int mbox_post(mbox_t *mbox, void *msg) { return bench_cv_mbox_post(mbox, msg, OS_WAIT_FOREVER); }
+};
+
+/******************************* Benchmarks *********************************/
+
+/* The echo thread of the ping-pong benchmarks */
+template <class T>
+struct BenchEcho
+{
+   typename T::sem_t       *ping;
+   typename T::sem_t       *pong;
+   typename T::mbox_t      *ping_q;
+   typename T::mbox_t      *pong_q;
+   bool                    use_mbox;
+   bool                    stop;
+
+   static void *run(void *arg)
+   {
+      BenchEcho<T>         *echo = (BenchEcho<T> *)arg;
+      void                 *msg;
+
+      for (;;)
+      {
+         if (echo->use_mbox)
+         {
+            (void)T::mbox_fetch(echo->ping_q, &msg, OS_WAIT_FOREVER);
+         }
+         else
+         {
+            (void)T::sem_wait(echo->ping, OS_WAIT_FOREVER);
+         }
+         if (__atomic_load_n(&echo->stop, __ATOMIC_ACQUIRE))
+         {
+            return NULL;
+         }
+         if (echo->use_mbox)
+         {
+            (void)T::mbox_post(echo->pong_q, msg);
+         }
+         else
+         {
+            T::sem_signal(echo->pong);
+         }
+      }
+   }
+};
+
+/* Round trip to another thread and back, for example a frame handed over
+ * from the receive thread and an answer */
+template <class T>
+static void BM_OsalSemPingPong(benchmark::State& state)
+{
+   BenchEcho<T>            echo;
+   pthread_t               thread;
+
+   echo.ping = T::sem_create();
+   echo.pong = T::sem_create();
+   echo.use_mbox = false;
+   echo.stop = false;
+   pthread_create(&thread, NULL, BenchEcho<T>::run, &echo);
+
+   for (auto _ : state)
+   {
+      T::sem_signal(echo.ping);
+      (void)T::sem_wait(echo.pong, OS_WAIT_FOREVER);
+   }
+
+   __atomic_store_n(&echo.stop, true, __ATOMIC_RELEASE);
+   T::sem_signal(echo.ping);
+   pthread_join(thread, NULL);
+   T::sem_destroy(echo.ping);
+   T::sem_destroy(echo.pong);
+}
+
+template <class T>
+static void BM_OsalMboxPingPong(benchmark::State& state)
+{
+   BenchEcho<T>            echo;
+   pthread_t               thread;
+   void                    *msg = NULL;
+
+   echo.ping_q = T::mbox_create();
+   echo.pong_q = T::mbox_create();
+   echo.use_mbox = true;
+   echo.stop = false;
+   pthread_create(&thread, NULL, BenchEcho<T>::run, &echo);
+
+   for (auto _ : state)
+   {
+      (void)T::mbox_post(echo.ping_q, &echo);
+      (void)T::mbox_fetch(echo.pong_q, &msg, OS_WAIT_FOREVER);
+   }
+
+   __atomic_store_n(&echo.stop, true, __ATOMIC_RELEASE);
+   (void)T::mbox_post(echo.ping_q, &echo);
+   pthread_join(thread, NULL);
+   T::mbox_destroy(echo.ping_q);
+   T::mbox_destroy(echo.pong_q);
+}
+
+/* Uncontended post and fetch in the same thread */
+template <class T>
+static void BM_OsalMboxPostFetch(benchmark::State& state)
+{
+   typename T::mbox_t      *mbox = T::mbox_create();
+   void                    *msg = NULL;
+
+   for (auto _ : state)
+   {
+      (void)T::mbox_post(mbox, mbox);
+      (void)T::mbox_fetch(mbox, &msg, 0);
+   }
+   benchmark::DoNotOptimize(msg);
+
+   T::mbox_destroy(mbox);
+}
+
+/* Polling an empty queue, as pnet_handle_periodic() does for alarms */
+template <class T>
+static void BM_OsalMboxFetchEmpty(benchmark::State& state)
+{
+   typename T::mbox_t      *mbox = T::mbox_create();
+   void                    *msg = NULL;
+
+   for (auto _ : state)
+   {
+      benchmark::DoNotOptimize(T::mbox_fetch(mbox, &msg, 0));
+   }
+
+   T::mbox_destroy(mbox);
+}
+
+BENCHMARK_TEMPLATE (BM_OsalSemPingPong, BenchOsal)->UseRealTime();
+BENCHMARK_TEMPLATE (BM_OsalSemPingPong, BenchCondvar)->UseRealTime();
+BENCHMARK_TEMPLATE (BM_OsalMboxPingPong, BenchOsal)->UseRealTime();
+BENCHMARK_TEMPLATE (BM_OsalMboxPingPong, BenchCondvar)->UseRealTime();
+BENCHMARK_TEMPLATE (BM_OsalMboxPostFetch, BenchOsal);
+BENCHMARK_TEMPLATE (BM_OsalMboxPostFetch, BenchCondvar);
+BENCHMARK_TEMPLATE (BM_OsalMboxFetchEmpty, BenchOsal);
+BENCHMARK_TEMPLATE (BM_OsalMboxFetchEmpty, BenchCondvar);
@@ -0,0 +1,166 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+/* Slot 0 is the DAP and slot 1 is used by bench_connect_req */
+#define BENCH_FIRST_EXTRA_SLOT                     2
+#define BENCH_MAX_SUBSLOTS                         ((PNET_MAX_MODULES - BENCH_FIRST_EXTRA_SLOT) * PNET_MAX_SUBMODULES)
+
+/**
+ * Benchmark fixture with state.range(0) extra input sub-slots in the AR.
+ *
+ * The recorded connect request only has one I/O sub-slot. Extra sub-slots
+ * are plugged before the connect, and added to the input CR afterwards by
+ * copying the data descriptor of the recorded one. They share its position
+ * in the frame, which does not matter for the lookup being measured.
+ */
+class PnetSubslotBench : public PnetBench
+{
+public:
+   void SetUp(const benchmark::State& state) override
+   {
+      uint16_t             ix;
+      uint16_t             slot;
+      uint16_t             subslot;
+
+      stack.init();
+      nbr_subslots = 0;
+
+      for (slot = BENCH_FIRST_EXTRA_SLOT; slot < PNET_MAX_MODULES; slot++)
+      {
+         (void)pnet_plug_module(stack.net, TEST_API_IDENT, slot, TEST_MOD_8_8_IDENT);
+         for (subslot = 1; subslot <= PNET_MAX_SUBMODULES; subslot++)
+         {
+            (void)pnet_plug_submodule(stack.net, TEST_API_IDENT, slot, subslot,
+               TEST_MOD_8_8_IDENT, TEST_SUBMOD_CUSTOM_IDENT, PNET_DIR_IO,
+               TEST_DATASIZE_INPUT, TEST_DATASIZE_OUTPUT);
+         }
+      }
+
+      if (stack.connect() == 0)
+      {
+         for (ix = 0; ix < state.range(0); ix++)
+         {
+            slot = BENCH_FIRST_EXTRA_SLOT + ix / PNET_MAX_SUBMODULES;
+            subslot = 1 + ix % PNET_MAX_SUBMODULES;
+            if (add_subslot(slot, subslot) == 0)
+            {
+               slots[nbr_subslots] = slot;
+               subslots[nbr_subslots] = subslot;
+               nbr_subslots++;
+            }
+         }
+      }
+   };
+
+protected:
+   uint16_t                nbr_subslots = 0;
+   uint16_t                slots[BENCH_MAX_SUBSLOTS];
+   uint16_t                subslots[BENCH_MAX_SUBSLOTS];
+
+private:
+   int add_subslot(
+      uint16_t             slot,
+      uint16_t             subslot)
+   {
+      int                  ret = -1;
+      pf_iocr_t            *p_iocr = stack.find_iocr(PF_IOCR_TYPE_INPUT);
+      pf_iodata_object_t   *p_template = NULL;
+      pf_subslot_t         *p_subslot = NULL;
+      uint16_t             ix;
+
+      if (p_iocr != NULL)
+      {
+         for (ix = 0; (p_template == NULL) && (ix < p_iocr->nbr_data_desc); ix++)
+         {
+            if ((p_iocr->data_desc[ix].slot_nbr == 1) &&
+                (p_iocr->data_desc[ix].subslot_nbr == TEST_SUBMOD_CUSTOM_IDENT))
+            {
+               p_template = &p_iocr->data_desc[ix];
+            }
+         }
+      }
+
+      if ((p_template != NULL) &&
+          (p_iocr->nbr_data_desc < NELEMENTS(p_iocr->data_desc)) &&
+          (pf_cmdev_get_subslot_full(stack.net, TEST_API_IDENT, slot, subslot, &p_subslot) == 0))
+      {
+         p_subslot->p_ar = p_iocr->p_ar;
+         p_iocr->data_desc[p_iocr->nbr_data_desc] = *p_template;
+         p_iocr->data_desc[p_iocr->nbr_data_desc].slot_nbr = slot;
+         p_iocr->data_desc[p_iocr->nbr_data_desc].subslot_nbr = subslot;
+         p_iocr->nbr_data_desc++;
+         ret = 0;
+      }
+
+      return ret;
+   }
+};
+
+
+/* Insert data, cycle counter and status into the frame about to be sent */
+BENCHMARK_F (PnetConnectedBench, PpmFinishBuffer)(benchmark::State& state)
+{
+   pf_iocr_t               *p_iocr = NULL;
+
+   if (connected == true)
+   {
+      p_iocr = stack.find_iocr(PF_IOCR_TYPE_INPUT);
+   }
+   if (p_iocr == NULL)
+   {
+      state.SkipWithError("No input CR");
+   }
+
+   for (auto _ : state)
+   {
+      pf_ppm_finish_buffer(stack.net, &p_iocr->ppm, p_iocr->in_length);
+   }
+}
+
+/* The application setting input data for all its sub-slots, once per cycle */
+BENCHMARK_DEFINE_F (PnetSubslotBench, InputSetDataAndIops)(benchmark::State& state)
+{
+   uint8_t                 data[TEST_DATASIZE_INPUT] = { 0 };
+   uint16_t                ix;
+   int                     errors = 0;
+
+   if (nbr_subslots != state.range(0))
+   {
+      state.SkipWithError("Could not add sub-slots to the AR");
+   }
+
+   for (auto _ : state)
+   {
+      data[0]++;
+      for (ix = 0; ix < nbr_subslots; ix++)
+      {
+         errors -= pnet_input_set_data_and_iops(stack.net, TEST_API_IDENT,
+            slots[ix], subslots[ix], data, sizeof(data), PNET_IOXS_GOOD);
+      }
+   }
+
+   if (errors != 0)
+   {
+      state.SkipWithError("pnet_input_set_data_and_iops() failed");
+   }
+   state.SetItemsProcessed(state.iterations() * nbr_subslots);
+}
+BENCHMARK_REGISTER_F (PnetSubslotBench, InputSetDataAndIops)
+   ->RangeMultiplier(2)->Range(1, BENCH_MAX_SUBSLOTS);
@@ -0,0 +1,128 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_benchmark.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#define BENCH_FAR_FUTURE                           (1000*1000*1000)  /* us */
+
+static const char          *bench_scheduler_name = "bench";
+
+static void bench_scheduler_cb(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   (*(uint32_t *)arg)++;
+}
+
+/**
+ * Benchmark fixture with state.range(0) timeouts queued, in addition to the
+ * ones of the stack itself. None of them expire during the benchmark.
+ */
+class PnetSchedulerBench : public PnetBench
+{
+public:
+   void SetUp(const benchmark::State& state) override
+   {
+      uint32_t             timeout;
+      uint16_t             ix;
+
+      stack.init();
+
+      /* Let the initial timeouts of the stack expire and reschedule */
+      pf_scheduler_tick(stack.net);
+
+      queued = 0;
+      for (ix = 0; ix < state.range(0); ix++)
+      {
+         if (pf_scheduler_add(stack.net, BENCH_FAR_FUTURE, bench_scheduler_name,
+               bench_scheduler_cb, &calls, &timeout) == 0)
+         {
+            queued++;
+         }
+      }
+   };
+
+protected:
+   uint32_t                calls = 0;
+   uint16_t                queued = 0;
+};
+
+
+/* Insert into a sorted queue, at the end, and remove again */
+BENCHMARK_DEFINE_F (PnetSchedulerBench, AddRemove)(benchmark::State& state)
+{
+   uint32_t                timeout = UINT32_MAX;
+
+   if (queued != state.range(0))
+   {
+      state.SkipWithError("Scheduler full");
+   }
+
+   for (auto _ : state)
+   {
+      (void)pf_scheduler_add(stack.net, BENCH_FAR_FUTURE + 1, bench_scheduler_name,
+         bench_scheduler_cb, &calls, &timeout);
+      pf_scheduler_remove(stack.net, bench_scheduler_name, timeout);
+   }
+}
+
+/* The common case: nothing has expired */
+BENCHMARK_DEFINE_F (PnetSchedulerBench, TickIdle)(benchmark::State& state)
+{
+   if (queued != state.range(0))
+   {
+      state.SkipWithError("Scheduler full");
+   }
+
+   for (auto _ : state)
+   {
+      pf_scheduler_tick(stack.net);
+   }
+}
+
+/* Insert at the head, then expire and call it */
+BENCHMARK_DEFINE_F (PnetSchedulerBench, AddTickExpire)(benchmark::State& state)
+{
+   uint32_t                timeout;
+
+   if (queued != state.range(0))
+   {
+      state.SkipWithError("Scheduler full");
+   }
+
+   calls = 0;
+   for (auto _ : state)
+   {
+      (void)pf_scheduler_add(stack.net, 0, bench_scheduler_name,
+         bench_scheduler_cb, &calls, &timeout);
+      pf_scheduler_tick(stack.net);
+   }
+
+   if (calls != (uint32_t)state.iterations())
+   {
+      state.SkipWithError("Timeout did not expire");
+   }
+}
+
+BENCHMARK_REGISTER_F (PnetSchedulerBench, AddRemove)
+   ->DenseRange(0, PF_MAX_TIMEOUTS(PNET_MAX_AR) / 2, 2);
+BENCHMARK_REGISTER_F (PnetSchedulerBench, TickIdle)
+   ->DenseRange(0, PF_MAX_TIMEOUTS(PNET_MAX_AR) / 2, 2);
+BENCHMARK_REGISTER_F (PnetSchedulerBench, AddTickExpire)
+   ->DenseRange(0, PF_MAX_TIMEOUTS(PNET_MAX_AR) / 2, 2);
@@ -37,7 +37,8 @@ void mock_init(void)
 os_eth_handle_t* mock_os_eth_init(
    const char *if_name,
    os_eth_callback_t *callback,
-   void *arg)
+   void *arg,
+   const os_thread_cfg_t *p_thread_cfg)
 {
    os_eth_handle_t         *handle;
 
@@ -46,6 +47,12 @@ os_eth_handle_t* mock_os_eth_init(
    return handle;
 }
 
+void mock_os_eth_destroy(
+   os_eth_handle_t *handle)
+{
+   free(handle);
+}
+
 int mock_os_get_ip_suite(
    const char              *interface_name,
    os_ipaddr_t             *p_ipaddr,
@@ -79,6 +86,19 @@ int mock_os_eth_send(
    return p_buf->len;
 }
 
+uint64_t mock_os_eth_rx_timestamp(
+   os_eth_handle_t         *handle)
+{
+   uint64_t                ret = mock_os_data.eth_rx_timestamp;
+
+   if (ret == 0)
+   {
+      ret = os_get_current_time_ns();
+   }
+
+   return ret;
+}
+
 int mock_os_udp_open(
    os_ipaddr_t             addr,
    os_ipport_t             port)
@@ -94,6 +114,10 @@ int mock_os_udp_sendto(
    const uint8_t           *data,
    int                     size)
 {
+   if ((size > 0) && ((size_t)size <= sizeof(mock_os_data.udp_sendto_copy)))
+   {
+      memcpy(mock_os_data.udp_sendto_copy, data, size);
+   }
    mock_os_data.udp_sendto_len = size;
    mock_os_data.udp_sendto_count++;
 
@@ -138,6 +162,23 @@ void mock_os_udp_close(
 {
 }
 
+int mock_os_poll_add(
+   os_poll_t               *poll,
+   uint32_t                id)
+{
+   /* The mocked sockets are not real descriptors */
+   return 0;
+}
+
+BOOL mock_os_save_nvram_instance(
+   char                    *filePath,
+   void                    *data,
+   int                     len)
+{
+   mock_os_data.nvram_save_count++;
+   return TRUE;
+}
+
 int mock_pf_alarm_send_diagnosis(
    pf_ar_t                 *p_ar,
    uint32_t                api_id,
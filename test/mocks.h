@@ -33,7 +33,9 @@ typedef struct mock_os_data_obj
    uint8_t     eth_send_copy[PF_FRAME_BUFFER_SIZE];
    uint16_t    eth_send_len;
    uint16_t    eth_send_count;
+   uint64_t    eth_rx_timestamp;       /* 0 for the current time */
 
+   uint8_t     udp_sendto_copy[PF_FRAME_BUFFER_SIZE];
    uint16_t    udp_sendto_len;
    uint16_t    udp_sendto_count;
 
@@ -42,6 +44,8 @@ typedef struct mock_os_data_obj
    uint16_t    udp_recvfrom_count;
 
    uint16_t    set_ip_suite_count;
+
+   uint16_t    nvram_save_count;
 } mock_os_data_t;
 
 extern mock_os_data_t mock_os_data;
@@ -53,8 +57,11 @@ void mock_set_os_udp_recvfrom_buffer(uint8_t *p_src, uint16_t len);
 os_eth_handle_t* mock_os_eth_init(
    const char *if_name,
    os_eth_callback_t *callback,
-   void *arg);
+   void *arg,
+   const os_thread_cfg_t *p_thread_cfg);
+void mock_os_eth_destroy(os_eth_handle_t *handle);
 int mock_os_eth_send(os_eth_handle_t *handle, os_buf_t * buf);
+uint64_t mock_os_eth_rx_timestamp(os_eth_handle_t *handle);
 void mock_os_cpy_mac_addr(uint8_t * mac_addr);
 int mock_os_udp_open(os_ipaddr_t addr, os_ipport_t port);
 int mock_os_udp_sendto(uint32_t id,
@@ -68,6 +75,7 @@ int mock_os_udp_recvfrom(uint32_t id,
       uint8_t * data,
       int size);
 void mock_os_udp_close(uint32_t id);
+int mock_os_poll_add(os_poll_t * poll, uint32_t id);
 int mock_os_set_ip_suite(
    const char              *interface_name,
    os_ipaddr_t             *p_ipaddr,
@@ -75,6 +83,10 @@ int mock_os_set_ip_suite(
    os_ipaddr_t             *p_gw,
    const char              *hostname,
    bool                    permanent);
+BOOL mock_os_save_nvram_instance(
+   char                    *filePath,
+   void                    *data,
+   int                     len);
 int mock_pf_alarm_send_diagnosis(
    pf_ar_t                 *p_ar,
    uint32_t                api_id,
@@ -0,0 +1,920 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * pf_soak: end-to-end soak and jitter harness.
+ *
+ * Runs the stack against the simulated IO-controller in soak_controller.cpp
+ * over an in-process link, then reports percentiles of the cycle jitter,
+ * the data hold timer margin and the latency of the acyclic services.
+ * With -s the controller is also a PTCP sync master, and the offset of the
+ * synchronized clock of the device is reported.
+ * With -f the ARs are connected in pairs as system redundancy AR sets, and
+ * the primary controller of a pair fails at the given interval. The latency
+ * of the switchover to the backup AR is reported.
+ * Exits with 1 if any AR was aborted or never reached data exchange, if
+ * the device never synchronized, or did not follow a failover, so it can
+ * be used as a test.
+ *
+ * Usage: pf_soak [-a ars] [-c cycle_us] [-d duration_s] [-r report_s]
+ *                [-l alarm_interval_ms] [-q read_interval_ms] [-p priority]
+ *                [-s drift_ppm] [-f failover_interval_ms]
+ */
+
+#include "soak_controller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SOAK_DEFAULT_CYCLE_US                   1000
+#define SOAK_DEFAULT_DURATION_S                 60
+#define SOAK_DEFAULT_REPORT_S                   10
+#define SOAK_DEFAULT_ALARM_INTERVAL_MS          500
+#define SOAK_DEFAULT_READ_INTERVAL_MS           100
+#define SOAK_DEFAULT_PRIORITY                   15
+#define SOAK_ALARM_TIMEOUT_NS                   (5ULL * 1000 * 1000 * 1000)
+#define SOAK_DATA_TIMEOUT_NS                    (5ULL * 1000 * 1000 * 1000)
+#define SOAK_SR_SETTLE_NS                       (2ULL * 1000 * 1000 * 1000)   /* No failover at the end */
+#define SOAK_DIAG_CH_ERROR_TYPE                 0x0005   /* Temperature */
+
+typedef struct soak_args
+{
+   uint16_t                nbr_ars;
+   uint32_t                cycle_us;
+   uint32_t                duration_s;
+   uint32_t                report_s;
+   uint32_t                alarm_interval_ms;
+   uint32_t                read_interval_ms;
+   int                     priority;
+   bool                    ptcp;
+   int32_t                 ptcp_drift_ppm;
+   uint32_t                failover_interval_ms;   /* 0 if not SR */
+} soak_args_t;
+
+typedef struct soak_device_ar
+{
+   volatile bool           connected;
+   volatile bool           appl_ready_pending;
+   volatile bool           aborted;
+   uint32_t                arep;
+} soak_device_ar_t;
+
+typedef struct soak_app
+{
+   soak_args_t             args;
+   pnet_t                  *net;
+   pnet_cfg_t              cfg;
+   soak_controller_t       ctrl;
+   soak_device_ar_t        ars[SOAK_MAX_ARS];
+   uint32_t                tick_us;
+
+   /* Diagnosis alarms, on AR 0 */
+   bool                    diag_active;
+   volatile bool           alarm_in_flight;
+   uint64_t                alarm_sent_ns;
+   uint64_t                next_alarm_ns;
+   uint32_t                alarms_sent;
+   uint32_t                alarm_timeouts;
+   soak_hist_t             alarm_rtt;
+
+   uint32_t                aborts;
+   uint32_t                primary_losses;      /* Expected aborts of failed SR primary ARs */
+   uint32_t                reconnects;
+   uint32_t                read_errors;
+   soak_hist_t             periodic_wakeup;
+   soak_hist_t             ptcp_offset;         /* Synchronized clock against the master */
+} soak_app_t;
+
+static soak_app_t soak_app;
+
+static void soak_show_usage(void)
+{
+   printf("\nEnd-to-end soak and jitter harness for the p-net stack.\n");
+   printf("\n");
+   printf("Options:\n");
+   printf("   -h                 Show this help text and exit\n");
+   printf("   -a ars             Number of ARs, 1..%u. Default 1\n", SOAK_MAX_ARS);
+   printf("   -c cycle_us        Cycle time in microseconds, multiple of 250. Default %u\n", SOAK_DEFAULT_CYCLE_US);
+   printf("   -d duration_s      Duration in seconds. Default %u\n", SOAK_DEFAULT_DURATION_S);
+   printf("   -r report_s        Report interval in seconds, 0 for summary only. Default %u\n", SOAK_DEFAULT_REPORT_S);
+   printf("   -l interval_ms     Diagnosis alarm interval, 0 to disable. Default %u\n", SOAK_DEFAULT_ALARM_INTERVAL_MS);
+   printf("   -q interval_ms     I&M0 read interval, 0 to disable. Default %u\n", SOAK_DEFAULT_READ_INTERVAL_MS);
+   printf("   -p priority        Priority of the cyclic threads. Default %u\n", SOAK_DEFAULT_PRIORITY);
+   printf("   -s drift_ppm       Run a PTCP sync master, drifting drift_ppm from the local clock\n");
+   printf("   -f interval_ms     Connect the ARs in pairs as SR AR sets, fail the primary every interval_ms\n");
+}
+
+/**
+ * @internal
+ * Parse command line arguments.
+ * @param argc             In:   Number of arguments.
+ * @param argv             In:   Arguments.
+ * @param p_args           Out:  Parsed arguments.
+ */
+static void soak_parse_args(
+   int                     argc,
+   char                    *argv[],
+   soak_args_t             *p_args)
+{
+   int                     option;
+
+   p_args->nbr_ars = 1;
+   p_args->cycle_us = SOAK_DEFAULT_CYCLE_US;
+   p_args->duration_s = SOAK_DEFAULT_DURATION_S;
+   p_args->report_s = SOAK_DEFAULT_REPORT_S;
+   p_args->alarm_interval_ms = SOAK_DEFAULT_ALARM_INTERVAL_MS;
+   p_args->read_interval_ms = SOAK_DEFAULT_READ_INTERVAL_MS;
+   p_args->priority = SOAK_DEFAULT_PRIORITY;
+
+   while ((option = getopt(argc, argv, "ha:c:d:r:l:q:p:s:f:")) != -1)
+   {
+      switch (option)
+      {
+      case 'a':
+         p_args->nbr_ars = (uint16_t)atoi(optarg);
+         break;
+      case 'c':
+         p_args->cycle_us = (uint32_t)atoi(optarg);
+         break;
+      case 'd':
+         p_args->duration_s = (uint32_t)atoi(optarg);
+         break;
+      case 'r':
+         p_args->report_s = (uint32_t)atoi(optarg);
+         break;
+      case 'l':
+         p_args->alarm_interval_ms = (uint32_t)atoi(optarg);
+         break;
+      case 'q':
+         p_args->read_interval_ms = (uint32_t)atoi(optarg);
+         break;
+      case 'p':
+         p_args->priority = atoi(optarg);
+         break;
+      case 's':
+         p_args->ptcp = true;
+         p_args->ptcp_drift_ppm = atoi(optarg);
+         break;
+      case 'f':
+         p_args->failover_interval_ms = (uint32_t)atoi(optarg);
+         break;
+      case 'h':
+         /* fallthrough */
+      case '?':
+         /* fallthrough */
+      default:
+         soak_show_usage();
+         exit(EXIT_FAILURE);
+      }
+   }
+
+   if ((p_args->nbr_ars < 1) || (p_args->nbr_ars > SOAK_MAX_ARS))
+   {
+      printf("Number of ARs must be 1..%u\n", SOAK_MAX_ARS);
+      exit(EXIT_FAILURE);
+   }
+   if ((p_args->cycle_us < 250) || ((p_args->cycle_us % 250) != 0))
+   {
+      printf("Cycle time must be a multiple of 250 us\n");
+      exit(EXIT_FAILURE);
+   }
+   if ((p_args->failover_interval_ms != 0) && ((p_args->nbr_ars % 2) != 0))
+   {
+      printf("Number of ARs must be even with -f\n");
+      exit(EXIT_FAILURE);
+   }
+   if (p_args->failover_interval_ms != 0)
+   {
+      /* The primary AR of the alarms would keep failing */
+      p_args->alarm_interval_ms = 0;
+   }
+}
+
+/**
+ * @internal
+ * Find the index of the controller AR that a device AR belongs to.
+ * @param arep             In:   The device AREP.
+ * @return  The AR index, or -1 if not found.
+ */
+static int soak_ar_ix(
+   uint32_t                arep)
+{
+   pf_ar_t                 *p_ar = NULL;
+   int                     ix;
+
+   if (pf_ar_find_by_arep(soak_app.net, arep, &p_ar) == 0)
+   {
+      for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+      {
+         if (memcmp(&p_ar->ar_param.ar_uuid, &soak_app.ctrl.ars[ix].ar_uuid,
+            sizeof(pf_uuid_t)) == 0)
+         {
+            return ix;
+         }
+      }
+   }
+
+   return -1;
+}
+
+/*************************** Stack callbacks *********************************/
+
+static int soak_connect_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_result_t           *p_result)
+{
+   int                     ix = soak_ar_ix(arep);
+
+   if (ix >= 0)
+   {
+      soak_app.ars[ix].arep = arep;
+      soak_app.ars[ix].aborted = false;
+      soak_app.ars[ix].connected = true;
+   }
+
+   return 0;
+}
+
+static int soak_release_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_result_t           *p_result)
+{
+   return 0;
+}
+
+static int soak_dcontrol_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_control_command_t  control_command,
+   pnet_result_t           *p_result)
+{
+   return 0;
+}
+
+static int soak_ccontrol_cnf(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_result_t           *p_result)
+{
+   return 0;
+}
+
+static int soak_state_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_event_values_t     state)
+{
+   uint16_t                ix;
+
+   for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+   {
+      if (soak_app.ars[ix].connected && (soak_app.ars[ix].arep == arep))
+      {
+         if (state == PNET_EVENT_ABORT)
+         {
+            soak_app.ars[ix].connected = false;
+            soak_app.ars[ix].appl_ready_pending = false;
+            soak_app.ars[ix].aborted = true;
+            if (ix == 0)
+            {
+               soak_app.alarm_in_flight = false;
+            }
+         }
+         else if (state == PNET_EVENT_PRMEND)
+         {
+            soak_app.ars[ix].appl_ready_pending = true;
+         }
+      }
+   }
+
+   return 0;
+}
+
+static int soak_read_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   uint32_t                api,
+   uint16_t                slot,
+   uint16_t                subslot,
+   uint16_t                idx,
+   uint16_t                sequence_number,
+   uint8_t                 **pp_read_data,
+   uint16_t                *p_read_length,
+   pnet_result_t           *p_result)
+{
+   /* I&M is handled by the stack */
+   return -1;
+}
+
+static int soak_write_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   uint32_t                api,
+   uint16_t                slot,
+   uint16_t                subslot,
+   uint16_t                idx,
+   uint16_t                sequence_number,
+   uint16_t                write_length,
+   uint8_t                 *p_write_data,
+   pnet_result_t           *p_result)
+{
+   return -1;
+}
+
+static int soak_exp_module_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                api,
+   uint16_t                slot,
+   uint32_t                module_ident)
+{
+   return pnet_plug_module(net, api, slot, module_ident);
+}
+
+static int soak_exp_submodule_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                api,
+   uint16_t                slot,
+   uint16_t                subslot,
+   uint32_t                module_ident,
+   uint32_t                submodule_ident)
+{
+   return pnet_plug_submodule(net, api, slot, subslot, module_ident,
+      submodule_ident, PNET_DIR_IO, 1, 1);
+}
+
+static int soak_new_data_status_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   uint32_t                crep,
+   uint8_t                 changes,
+   uint8_t                 data_status)
+{
+   return 0;
+}
+
+static int soak_alarm_ind(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   uint16_t                data_len,
+   uint16_t                data_usi,
+   uint8_t                 *p_data)
+{
+   return 0;
+}
+
+static int soak_alarm_cnf(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   pnet_pnio_status_t      *p_pnio_status)
+{
+   if (soak_app.alarm_in_flight)
+   {
+      soak_hist_record(&soak_app.alarm_rtt, soak_now_ns() - soak_app.alarm_sent_ns);
+      soak_app.alarm_in_flight = false;
+   }
+
+   return 0;
+}
+
+static int soak_alarm_ack_cnf(
+   pnet_t                  *net,
+   void                    *arg,
+   uint32_t                arep,
+   int                     res)
+{
+   return 0;
+}
+
+/**
+ * @internal
+ * Build the device configuration.
+ * @param p_cfg            Out:  The configuration.
+ */
+static void soak_device_cfg(
+   pnet_cfg_t              *p_cfg)
+{
+   const pnet_ethaddr_t    mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+
+   memset(p_cfg, 0, sizeof(*p_cfg));
+
+   p_cfg->state_cb = soak_state_ind;
+   p_cfg->connect_cb = soak_connect_ind;
+   p_cfg->release_cb = soak_release_ind;
+   p_cfg->dcontrol_cb = soak_dcontrol_ind;
+   p_cfg->ccontrol_cb = soak_ccontrol_cnf;
+   p_cfg->read_cb = soak_read_ind;
+   p_cfg->write_cb = soak_write_ind;
+   p_cfg->exp_module_cb = soak_exp_module_ind;
+   p_cfg->exp_submodule_cb = soak_exp_submodule_ind;
+   p_cfg->new_data_status_cb = soak_new_data_status_ind;
+   p_cfg->alarm_ind_cb = soak_alarm_ind;
+   p_cfg->alarm_cnf_cb = soak_alarm_cnf;
+   p_cfg->alarm_ack_cnf_cb = soak_alarm_ack_cnf;
+
+   p_cfg->im_0_data.vendor_id_hi = 0xfe;
+   p_cfg->im_0_data.vendor_id_lo = 0xed;
+   strcpy(p_cfg->im_0_data.order_id, "pf_soak");
+   strcpy(p_cfg->im_0_data.im_serial_number, "00000001");
+   p_cfg->im_0_data.im_hardware_revision = 1;
+   p_cfg->im_0_data.sw_revision_prefix = 'P';
+   p_cfg->im_0_data.im_version_major = 1;
+   p_cfg->im_0_data.im_version_minor = 1;
+   p_cfg->im_0_data.im_supported = 0x001e;
+
+   p_cfg->device_id.vendor_id_hi = 0xfe;
+   p_cfg->device_id.vendor_id_lo = 0xed;
+   p_cfg->device_id.device_id_hi = 0xbe;
+   p_cfg->device_id.device_id_lo = 0xef;
+   p_cfg->oem_device_id = p_cfg->device_id;
+   strcpy(p_cfg->device_vendor, "rt-labs");
+   strcpy(p_cfg->manufacturer_specific_string, "pf_soak");
+
+   p_cfg->lldp_cfg.port_addr = mac;
+   p_cfg->ip_addr.a = 192;
+   p_cfg->ip_addr.b = 168;
+   p_cfg->ip_addr.c = 1;
+   p_cfg->ip_addr.d = 171;
+   p_cfg->ip_mask.a = 255;
+   p_cfg->ip_mask.b = 255;
+   p_cfg->ip_mask.c = 255;
+   p_cfg->eth_addr = mac;
+}
+
+/*************************** Device application ******************************/
+
+/**
+ * @internal
+ * Toggle a diagnosis on the module of AR 0, so that the stack sends a
+ * diagnosis alarm that the controller must acknowledge. Only one alarm is
+ * in flight at a time.
+ * @param now              In:   The current time.
+ */
+static void soak_alarm_periodic(
+   uint64_t                now)
+{
+   soak_device_ar_t        *p_ar = &soak_app.ars[0];
+   uint16_t                ch_properties = 0;
+   int                     ret;
+
+   if ((soak_app.args.alarm_interval_ms == 0) ||
+       (p_ar->connected == false) ||
+       (soak_app.ctrl.ars[0].phase != SOAK_AR_DATA))
+   {
+      return;
+   }
+
+   if (soak_app.alarm_in_flight)
+   {
+      if (now - soak_app.alarm_sent_ns > SOAK_ALARM_TIMEOUT_NS)
+      {
+         soak_app.alarm_timeouts++;
+         soak_app.alarm_in_flight = false;
+      }
+      return;
+   }
+
+   if (now < soak_app.next_alarm_ns)
+   {
+      return;
+   }
+   soak_app.next_alarm_ns = now + soak_app.args.alarm_interval_ms * 1000000ULL;
+
+   PNET_DIAG_CH_PROP_TYPE_SET(ch_properties, PNET_DIAG_CH_PROP_TYPE_8_BIT);
+   PNET_DIAG_CH_PROP_DIR_SET(ch_properties, PNET_DIAG_CH_PROP_DIR_INPUT);
+
+   soak_app.alarm_sent_ns = now;
+   soak_app.alarm_in_flight = true;
+   if (soak_app.diag_active == false)
+   {
+      ret = pnet_diag_add(soak_app.net, p_ar->arep, 0, soak_app.ctrl.ars[0].slot, 1,
+         0, ch_properties, SOAK_DIAG_CH_ERROR_TYPE, 0, 0, 0, PNET_DIAG_USI_STD, NULL, NULL);
+   }
+   else
+   {
+      ret = pnet_diag_remove(soak_app.net, p_ar->arep, 0, soak_app.ctrl.ars[0].slot, 1,
+         0, ch_properties, SOAK_DIAG_CH_ERROR_TYPE, PNET_DIAG_USI_STD);
+   }
+
+   if (ret == 0)
+   {
+      soak_app.diag_active = !soak_app.diag_active;
+      soak_app.alarms_sent++;
+   }
+   else
+   {
+      soak_app.alarm_in_flight = false;
+   }
+}
+
+/**
+ * @internal
+ * Run the stack, like the main loop of an application.
+ * @param thread_arg       In:   Not used.
+ */
+static void soak_periodic_task(
+   void                    *thread_arg)
+{
+   uint64_t                period = soak_app.tick_us * 1000ULL;
+   uint64_t                next = soak_now_ns() + period;
+   uint64_t                now;
+   uint8_t                 input = 0;
+   uint16_t                ix;
+
+   for (;;)
+   {
+      soak_sleep_until(next);
+      now = soak_now_ns();
+      soak_hist_record(&soak_app.periodic_wakeup, now - next);
+      next += period;
+      if (now > next + 100 * period)
+      {
+         next = now + period;
+      }
+
+      input++;
+      for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+      {
+         if (soak_app.ars[ix].connected)
+         {
+            (void)pnet_input_set_data_and_iops(soak_app.net, 0, soak_app.ctrl.ars[ix].slot, 1,
+               &input, sizeof(input), PNET_IOXS_GOOD);
+            (void)pnet_output_set_iocs(soak_app.net, 0, soak_app.ctrl.ars[ix].slot, 1,
+               PNET_IOXS_GOOD);
+         }
+         if (soak_app.ars[ix].appl_ready_pending)
+         {
+            soak_app.ars[ix].appl_ready_pending = false;
+            (void)pnet_application_ready(soak_app.net, soak_app.ars[ix].arep);
+         }
+      }
+
+      soak_alarm_periodic(now);
+      pnet_handle_periodic(soak_app.net);
+   }
+}
+
+/**
+ * @internal
+ * Plug the DAP, as the sample application does.
+ * @param net              InOut: The p-net stack instance.
+ */
+static void soak_plug_dap(
+   pnet_t                  *net)
+{
+   (void)pnet_plug_module(net, 0, PNET_SLOT_DAP_IDENT, PNET_MOD_DAP_IDENT);
+   (void)pnet_plug_submodule(net, 0, PNET_SLOT_DAP_IDENT, PNET_SUBMOD_DAP_IDENT,
+      PNET_MOD_DAP_IDENT, PNET_SUBMOD_DAP_IDENT, PNET_DIR_NO_IO, 0, 0);
+   (void)pnet_plug_submodule(net, 0, PNET_SLOT_DAP_IDENT, PNET_SUBMOD_DAP_INTERFACE_1_IDENT,
+      PNET_MOD_DAP_IDENT, PNET_SUBMOD_DAP_INTERFACE_1_IDENT, PNET_DIR_NO_IO, 0, 0);
+   (void)pnet_plug_submodule(net, 0, PNET_SLOT_DAP_IDENT, PNET_SUBMOD_DAP_INTERFACE_1_PORT_0_IDENT,
+      PNET_MOD_DAP_IDENT, PNET_SUBMOD_DAP_INTERFACE_1_PORT_0_IDENT, PNET_DIR_NO_IO, 0, 0);
+}
+
+/*************************** Reporting ***************************************/
+
+static void soak_device_rx_hook(
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint64_t                t_ns)
+{
+   soak_controller_device_rx(&soak_app.ctrl, p_frame, len, t_ns);
+}
+
+/**
+ * @internal
+ * Get the data hold timer margin: the time left on the data hold timer
+ * when the longest gap between two frames ended.
+ * @param p_gap            In:   Gaps between frames.
+ * @return  The margin in cycles. Negative if the timer would have expired.
+ */
+static double soak_dht_margin(
+   const soak_hist_t       *p_gap)
+{
+   double                  cycle = (double)soak_cycle_ns(&soak_app.ctrl.cfg);
+   double                  dht = cycle * soak_app.ctrl.cfg.data_hold_factor;
+
+   return (dht - (double)p_gap->max) / cycle;
+}
+
+static void soak_report_ptcp(
+   FILE                    *p_out)
+{
+   pnet_ptcp_status_t      status;
+
+   if (pnet_get_ptcp_status(soak_app.net, &status) == 0)
+   {
+      fprintf(p_out, "PTCP: state %u, %u syncs, %u steps, offset %d ns, rate %d ppb, "
+         "line delay %u ns, %u delay requests\n",
+         (unsigned)status.state, (unsigned)status.sync_count, (unsigned)status.step_count,
+         (int)status.offset, (int)status.rate, (unsigned)status.line_delay,
+         (unsigned)soak_app.ctrl.ptcp_delay_reqs);
+   }
+   soak_hist_print(p_out, "PTCP offset", &soak_app.ptcp_offset);
+}
+
+static void soak_report_sr(
+   FILE                    *p_out)
+{
+   pnet_sr_status_t        status;
+
+   if (pnet_get_sr_status(soak_app.net, &status) == 0)
+   {
+      fprintf(p_out, "SR: %u failovers, %u followed, device %u switchovers, "
+         "%u primary losses (%u seen by the device), primary AREP %u\n",
+         (unsigned)soak_app.ctrl.sr_failovers, (unsigned)soak_app.ctrl.sr_switchovers,
+         (unsigned)status.switchovers, (unsigned)soak_app.primary_losses,
+         (unsigned)status.primary_losses, (unsigned)status.primary_arep);
+   }
+   soak_hist_print(p_out, "SR switchover", &soak_app.ctrl.sr_switchover);
+}
+
+static void soak_report(
+   FILE                    *p_out,
+   uint64_t                elapsed_ns)
+{
+   soak_controller_t       *p_ctrl = &soak_app.ctrl;
+   soak_ar_t               *p_ar;
+   char                    name[40];
+   uint16_t                ix;
+
+   fprintf(p_out, "--- %.1f s, cycle %u us, %u AR(s)\n",
+      elapsed_ns / 1e9, soak_app.args.cycle_us, soak_app.args.nbr_ars);
+   for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+   {
+      p_ar = &p_ctrl->ars[ix];
+      fprintf(p_out, "AR %u: phase %u, %llu in, %llu out, %u alarms acked, "
+         "DHT margin %.2f cycles (device), %.2f cycles (controller)\n",
+         ix, (unsigned)p_ar->phase,
+         (unsigned long long)p_ar->input_frames,
+         (unsigned long long)p_ar->output_frames,
+         (unsigned)p_ar->alarms_acked,
+         soak_dht_margin(&p_ar->output_gap), soak_dht_margin(&p_ar->input_gap));
+      snprintf(name, sizeof(name), "AR %u input jitter", ix);
+      soak_hist_print(p_out, name, &p_ar->input_jitter);
+      snprintf(name, sizeof(name), "AR %u input gap", ix);
+      soak_hist_print(p_out, name, &p_ar->input_gap);
+      snprintf(name, sizeof(name), "AR %u output gap", ix);
+      soak_hist_print(p_out, name, &p_ar->output_gap);
+   }
+   soak_hist_print(p_out, "Controller wakeup", &p_ctrl->tx_wakeup);
+   soak_hist_print(p_out, "Device wakeup", &soak_app.periodic_wakeup);
+   soak_hist_print(p_out, "DCP Set", &p_ctrl->dcp_set_latency);
+   soak_hist_print(p_out, "Connect", &p_ctrl->connect_latency);
+   soak_hist_print(p_out, "PrmEnd", &p_ctrl->prm_end_latency);
+   soak_hist_print(p_out, "ApplicationReady", &p_ctrl->appl_rdy_latency);
+   soak_hist_print(p_out, "Read I&M0", &p_ctrl->read_latency);
+   soak_hist_print(p_out, "Alarm round trip", &soak_app.alarm_rtt);
+   if (soak_app.args.ptcp == true)
+   {
+      soak_report_ptcp(p_out);
+   }
+   if (soak_app.args.failover_interval_ms != 0)
+   {
+      soak_report_sr(p_out);
+   }
+   fprintf(p_out, "Aborts %u, reconnects %u, alarms %u (%u timed out), "
+      "RPC timeouts %u, RPC errors %u, read errors %u, link drops %u, unknown frames %u\n",
+      (unsigned)soak_app.aborts, (unsigned)soak_app.reconnects,
+      (unsigned)soak_app.alarms_sent, (unsigned)soak_app.alarm_timeouts,
+      (unsigned)p_ctrl->rpc_timeouts, (unsigned)p_ctrl->rpc_errors,
+      (unsigned)soak_app.read_errors, (unsigned)soak_link_drops(),
+      (unsigned)p_ctrl->unknown_frames);
+   fflush(p_out);
+}
+
+/**
+ * @internal
+ * Connect an AR and wait until it reaches data exchange.
+ * @param ix               In:   The AR index.
+ * @return  0  if the AR is in data exchange.
+ *          -1 if an error occurred.
+ */
+static int soak_connect(
+   uint16_t                ix)
+{
+   uint64_t                deadline;
+
+   if (soak_controller_connect(&soak_app.ctrl, ix) == 0)
+   {
+      deadline = soak_now_ns() + SOAK_DATA_TIMEOUT_NS;
+      while (soak_now_ns() < deadline)
+      {
+         if (soak_app.ctrl.ars[ix].phase == SOAK_AR_DATA)
+         {
+            return 0;
+         }
+         os_usleep(1000);
+      }
+   }
+
+   printf("AR %u did not reach data exchange\n", ix);
+   return -1;
+}
+
+int main(
+   int                     argc,
+   char                    *argv[])
+{
+   soak_cfg_t              cfg;
+   uint64_t                start;
+   uint64_t                now;
+   uint64_t                end;
+   uint64_t                next_report;
+   uint64_t                next_read;
+   uint64_t                next_failover;
+   uint16_t                ix;
+   uint16_t                read_ix = 0;
+   uint16_t                failover_pair = 0;
+   pnet_sr_status_t        sr_status;
+   uint64_t                sync_time;
+   int64_t                 offset;
+   bool                    failed = false;
+
+   soak_parse_args(argc, argv, &soak_app.args);
+
+   /* SCF up to 4 ms, longer cycles use the reduction ratio */
+   cfg.nbr_ars = soak_app.args.nbr_ars;
+   if (soak_app.args.cycle_us <= 4000)
+   {
+      cfg.send_clock_factor = (uint16_t)(soak_app.args.cycle_us * 32 / 1000);
+      cfg.reduction_ratio = 1;
+   }
+   else
+   {
+      cfg.send_clock_factor = 32;
+      cfg.reduction_ratio = (uint16_t)(soak_app.args.cycle_us / 1000);
+   }
+   cfg.data_hold_factor = 3;
+   cfg.priority = soak_app.args.priority;
+   cfg.ptcp = soak_app.args.ptcp;
+   cfg.ptcp_drift_ppm = soak_app.args.ptcp_drift_ppm;
+   cfg.sr = (soak_app.args.failover_interval_ms != 0);
+   soak_app.tick_us = (soak_app.args.cycle_us < 1000) ? soak_app.args.cycle_us : 1000;
+
+   soak_hist_init(&soak_app.alarm_rtt);
+   soak_hist_init(&soak_app.periodic_wakeup);
+   soak_hist_init(&soak_app.ptcp_offset);
+   soak_device_cfg(&soak_app.cfg);
+   soak_app.cfg.max_ar = soak_app.args.nbr_ars;
+
+   if (soak_link_init(soak_app.args.priority, soak_device_rx_hook) != 0)
+   {
+      printf("Failed to create the link\n");
+      return EXIT_FAILURE;
+   }
+   soak_app.net = pnet_init("soak0", soak_app.tick_us, &soak_app.cfg);
+   if (soak_app.net == NULL)
+   {
+      printf("Failed to initialize p-net\n");
+      return EXIT_FAILURE;
+   }
+   soak_plug_dap(soak_app.net);
+   if (soak_controller_init(&soak_app.ctrl, &cfg, &soak_app.cfg) != 0)
+   {
+      printf("Failed to start the controller\n");
+      return EXIT_FAILURE;
+   }
+   (void)os_thread_create("soak_device", soak_app.args.priority, 8192,
+      soak_periodic_task, NULL);
+
+   if (soak_controller_dcp_set_name(&soak_app.ctrl, SOAK_STATION_NAME) != 0)
+   {
+      printf("DCP Set NameOfStation failed\n");
+      return EXIT_FAILURE;
+   }
+   for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+   {
+      if (soak_connect(ix) != 0)
+      {
+         failed = true;
+      }
+   }
+
+   start = soak_now_ns();
+   end = start + soak_app.args.duration_s * 1000000000ULL;
+   next_report = start + soak_app.args.report_s * 1000000000ULL;
+   next_read = start;
+   next_failover = start + soak_app.args.failover_interval_ms * 1000000ULL;
+   while ((now = soak_now_ns()) < end)
+   {
+      for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+      {
+         if (soak_app.ars[ix].aborted)
+         {
+            soak_app.ars[ix].aborted = false;
+            if (soak_app.ctrl.ars[ix].silent == true)
+            {
+               /* The device has timed out the failed primary AR. It comes back as backup. */
+               soak_app.primary_losses++;
+            }
+            else
+            {
+               soak_app.aborts++;
+            }
+            soak_controller_reset(&soak_app.ctrl, ix);
+            if (soak_connect(ix) == 0)
+            {
+               soak_app.reconnects++;
+            }
+         }
+      }
+
+      if ((soak_app.args.failover_interval_ms != 0) && (now >= next_failover) &&
+          (now + SOAK_SR_SETTLE_NS < end))
+      {
+         next_failover = now + soak_app.args.failover_interval_ms * 1000000ULL;
+         (void)soak_controller_sr_failover(&soak_app.ctrl, failover_pair);
+         failover_pair = (failover_pair + 1) % (soak_app.args.nbr_ars / 2);
+      }
+
+      if ((soak_app.args.read_interval_ms != 0) && (now >= next_read))
+      {
+         next_read = now + soak_app.args.read_interval_ms * 1000000ULL;
+         if ((soak_app.ctrl.ars[read_ix].phase == SOAK_AR_DATA) &&
+             (soak_app.ctrl.ars[read_ix].silent == false) &&
+             (soak_controller_read(&soak_app.ctrl, read_ix) != 0))
+         {
+            soak_app.read_errors++;
+         }
+         read_ix = (read_ix + 1) % soak_app.args.nbr_ars;
+      }
+
+      if ((soak_app.args.ptcp == true) &&
+          (pf_ptcp_get_time(soak_app.net, now, &sync_time) == 0))
+      {
+         offset = (int64_t)(sync_time - soak_controller_ptcp_time(&soak_app.ctrl, now));
+         soak_hist_record(&soak_app.ptcp_offset, (offset < 0) ? -offset : offset);
+      }
+
+      if ((soak_app.args.report_s != 0) && (now >= next_report))
+      {
+         next_report += soak_app.args.report_s * 1000000000ULL;
+         soak_report(stdout, now - start);
+      }
+
+      os_usleep(1000);
+   }
+
+   printf("=== Summary\n");
+   soak_report(stdout, soak_now_ns() - start);
+
+   for (ix = 0; ix < soak_app.args.nbr_ars; ix++)
+   {
+      if (soak_app.ctrl.ars[ix].phase != SOAK_AR_DATA)
+      {
+         failed = true;
+      }
+   }
+   if ((soak_app.args.ptcp == true) && (soak_app.ptcp_offset.count == 0))
+   {
+      printf("Never synchronized to the PTCP master\n");
+      failed = true;
+   }
+   if (soak_app.args.failover_interval_ms != 0)
+   {
+      if ((soak_app.ctrl.sr_failovers == 0) ||
+          (soak_app.ctrl.sr_switchovers != soak_app.ctrl.sr_failovers) ||
+          (pnet_get_sr_status(soak_app.net, &sr_status) != 0) ||
+          (sr_status.switchovers < soak_app.ctrl.sr_failovers))
+      {
+         printf("The device did not follow every failover\n");
+         failed = true;
+      }
+   }
+   if ((soak_app.aborts != 0) || failed)
+   {
+      printf("FAILED\n");
+      return EXIT_FAILURE;
+   }
+
+   printf("PASSED\n");
+   return EXIT_SUCCESS;
+}
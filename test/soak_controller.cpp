@@ -0,0 +1,1424 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * Simulated IO-controller for pf_soak, see soak_controller.h.
+ *
+ * The request layouts follow the frames recorded from a real controller in
+ * test_cmrpc.cpp. Blocks are big-endian, the DCE/RPC header and the NDR
+ * header use the little-endian data representation.
+ */
+
+#include "soak_controller.h"
+
+#include "pf_block_reader.h"
+#include "pf_block_writer.h"
+
+#include <string.h>
+
+#define SOAK_EVENT_RPC                          0x0001
+#define SOAK_EVENT_DCP                          0x0002
+
+#define SOAK_ETH_HDR_LEN                        14
+#define SOAK_MIN_FRAME_LEN                      60
+#define SOAK_RPC_HDR_LEN                        80
+#define SOAK_NDR_HDR_LEN                        20
+#define SOAK_RPC_ARGS_MAX                       4132
+#define SOAK_FRAME_ID_DCP_GET_SET               0xfefd
+#define SOAK_FRAME_ID_ALARM_HIGH                0xfc01
+#define SOAK_FRAME_ID_ALARM_LOW                 0xfe01
+#define SOAK_DCP_SERVICE_SET                    0x04
+#define SOAK_DCP_SERVICE_TYPE_SUCCESS           0x01
+#define SOAK_FRAME_ID_PTCP_SYNC                 0x0080
+#define SOAK_FRAME_ID_PTCP_DELAY_REQ            0xff40
+#define SOAK_FRAME_ID_PTCP_DELAY_RES            0xff43
+#define SOAK_PTCP_SYNC_INTERVAL_NS              (30ULL * 1000 * 1000)
+#define SOAK_PTCP_START_NS                      (1000ULL * 1000 * 1000 * 1000)   /* Master time at start */
+#define SOAK_DATA_STATUS                        0x35     /* Primary, valid, run, no problem */
+#define SOAK_DATA_STATUS_STATE                  0x01     /* Primary */
+#define SOAK_SR_DATA_HOLD_FACTOR                100      /* RedundancyDataHoldFactor, ms */
+#define SOAK_IOXS_GOOD                          0x80
+
+static const pf_uuid_t soak_device_interface_uuid =
+   { 0xdea00001, 0x6c97, 0x11d1, { 0x82, 0x71, 0x00, 0xa0, 0x24, 0x42, 0xdf, 0x7d } };
+static const pf_uuid_t soak_controller_object_uuid =
+   { 0xdea00000, 0x6c97, 0x11d1, { 0x82, 0x71, 0x00, 0x01, 0xf0, 0x00, 0x00, 0x01 } };
+
+static const pnet_ethaddr_t soak_ptcp_sync_addr = { { 0x01, 0x0e, 0xcf, 0x00, 0x04, 0x00 } };
+static const pnet_ethaddr_t soak_ptcp_delay_addr = { { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e } };
+
+/* DAP subslots, owned by AR 0 */
+static const uint16_t soak_dap_subslots[] = { 0x0001, 0x8000, 0x8001 };
+
+/**
+ * @internal
+ * Check if an AR expects the DAP.
+ * @param p_ctrl           In:   The controller.
+ * @param p_ar             In:   The AR.
+ * @return  true for AR 0, and with cfg.sr also for its backup AR 1.
+ */
+static bool soak_expects_dap(
+   const soak_controller_t *p_ctrl,
+   const soak_ar_t         *p_ar)
+{
+   return (p_ar->ix == 0) || ((p_ctrl->cfg.sr == true) && (p_ar->ix == 1));
+}
+
+uint64_t soak_cycle_ns(
+   const soak_cfg_t        *p_cfg)
+{
+   return (uint64_t)p_cfg->send_clock_factor * p_cfg->reduction_ratio * 31250;
+}
+
+/**
+ * @internal
+ * Insert a UUID into a buffer.
+ * @param is_big_endian    In:   Endianness of the destination buffer.
+ * @param p_uuid           In:   The UUID.
+ * @param res_len          In:   Size of destination buffer.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+static void soak_put_uuid(
+   bool                    is_big_endian,
+   const pf_uuid_t         *p_uuid,
+   uint16_t                res_len,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   pf_put_uint32(is_big_endian, p_uuid->data1, res_len, p_bytes, p_pos);
+   pf_put_uint16(is_big_endian, p_uuid->data2, res_len, p_bytes, p_pos);
+   pf_put_uint16(is_big_endian, p_uuid->data3, res_len, p_bytes, p_pos);
+   pf_put_mem(p_uuid->data4, sizeof(p_uuid->data4), res_len, p_bytes, p_pos);
+}
+
+/**
+ * @internal
+ * Extract a UUID from a buffer.
+ * @param p_info           In:   The parser state.
+ * @param p_pos            InOut:Position in the buffer.
+ * @param p_uuid           Out:  The UUID.
+ */
+static void soak_get_uuid(
+   pf_get_info_t           *p_info,
+   uint16_t                *p_pos,
+   pf_uuid_t               *p_uuid)
+{
+   uint16_t                ix;
+
+   p_uuid->data1 = pf_get_uint32(p_info, p_pos);
+   p_uuid->data2 = pf_get_uint16(p_info, p_pos);
+   p_uuid->data3 = pf_get_uint16(p_info, p_pos);
+   for (ix = 0; ix < sizeof(p_uuid->data4); ix++)
+   {
+      p_uuid->data4[ix] = pf_get_byte(p_info, p_pos);
+   }
+}
+
+/**
+ * @internal
+ * Insert a block header with version 1.0. The length is set by
+ * soak_block_end().
+ * @param block_type       In:   The block type.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ * @return  The position of the block header.
+ */
+static uint16_t soak_block_begin(
+   uint16_t                block_type,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   uint16_t                start = *p_pos;
+
+   pf_put_uint16(true, block_type, PF_FRAME_BUFFER_SIZE, p_bytes, p_pos);
+   pf_put_uint16(true, 0, PF_FRAME_BUFFER_SIZE, p_bytes, p_pos);
+   pf_put_byte(1, PF_FRAME_BUFFER_SIZE, p_bytes, p_pos);
+   pf_put_byte(0, PF_FRAME_BUFFER_SIZE, p_bytes, p_pos);
+
+   return start;
+}
+
+/**
+ * @internal
+ * Set the length of a block started with soak_block_begin().
+ * @param start            In:   The position of the block header.
+ * @param p_bytes          InOut:The buffer.
+ * @param pos              In:   The position after the block.
+ */
+static void soak_block_end(
+   uint16_t                start,
+   uint8_t                 *p_bytes,
+   uint16_t                pos)
+{
+   uint16_t                len_pos = start + sizeof(uint16_t);
+
+   /* The block length does not include type and length */
+   pf_put_uint16(true, pos - start - 2 * sizeof(uint16_t), PF_FRAME_BUFFER_SIZE, p_bytes, &len_pos);
+}
+
+/**
+ * @internal
+ * Insert the DCE/RPC header and a blank NDR header of a request.
+ * @param p_ctrl           In:   The controller.
+ * @param p_ar             InOut:The AR. Its sequence number is incremented.
+ * @param opnum            In:   The operation.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            Out:  Position after the NDR header.
+ */
+static void soak_rpc_begin(
+   soak_controller_t       *p_ctrl,
+   soak_ar_t               *p_ar,
+   uint16_t                opnum,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   pf_rpc_header_t         rpc;
+   uint16_t                pos_body_len;
+   uint16_t                pos_lkup_len;
+
+   memset(&rpc, 0, sizeof(rpc));
+   rpc.version = 4;
+   rpc.packet_type = PF_RPC_PT_REQUEST;
+   rpc.flags.idempotent = true;
+   rpc.flags.no_fack = true;
+   rpc.is_big_endian = false;
+   rpc.object_uuid = p_ctrl->device_object_uuid;
+   rpc.interface_uuid = soak_device_interface_uuid;
+   rpc.activity_uuid = p_ar->activity_uuid;
+   rpc.interface_version = 1;
+   rpc.sequence_nmb = p_ar->seq_nbr++;
+   rpc.opnum = opnum;
+   rpc.interface_hint = 0xffff;
+   rpc.activity_hint = 0xffff;
+
+   *p_pos = 0;
+   pf_put_dce_rpc_header(&rpc, PF_FRAME_BUFFER_SIZE, p_bytes, p_pos, &pos_body_len, &pos_lkup_len);
+   memset(&p_bytes[*p_pos], 0, SOAK_NDR_HDR_LEN);
+   *p_pos += SOAK_NDR_HDR_LEN;
+}
+
+/**
+ * @internal
+ * Set the body length in the DCE/RPC header and fill in the NDR header of
+ * a request built with soak_rpc_begin().
+ * @param p_bytes          InOut:The request.
+ * @param len              In:   Total length of the request.
+ * @param args_max         In:   Max size of the response arguments.
+ */
+static void soak_rpc_end(
+   uint8_t                 *p_bytes,
+   uint16_t                len,
+   uint32_t                args_max)
+{
+   uint16_t                pos = SOAK_RPC_HDR_LEN - 6;   /* Fragment length */
+   uint32_t                args_len = len - SOAK_RPC_HDR_LEN - SOAK_NDR_HDR_LEN;
+
+   pf_put_uint16(false, len - SOAK_RPC_HDR_LEN, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);
+
+   pos = SOAK_RPC_HDR_LEN;
+   pf_put_uint32(false, args_max, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);
+   pf_put_uint32(false, args_len, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);
+   pf_put_uint32(false, args_max, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);   /* Max count */
+   pf_put_uint32(false, 0, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);          /* Offset */
+   pf_put_uint32(false, args_len, PF_FRAME_BUFFER_SIZE, p_bytes, &pos);   /* Actual count */
+}
+
+/**
+ * @internal
+ * Send a request to the RPC server of the device and wait for the response,
+ * which is left in p_ctrl->rpc_rsp.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_ar             In:   The AR, used to match the response.
+ * @param p_req            In:   The request.
+ * @param len              In:   Length of the request.
+ * @param p_hist           InOut: Where to record the latency.
+ * @return  0  if the device responded with a good PNIO status.
+ *          -1 if an error occurred.
+ */
+static int soak_rpc_call(
+   soak_controller_t       *p_ctrl,
+   soak_ar_t               *p_ar,
+   const uint8_t           *p_req,
+   uint16_t                len,
+   soak_hist_t             *p_hist)
+{
+   int                     ret = -1;
+   uint32_t                value = 0;
+   uint64_t                t_start;
+
+   os_mutex_lock(p_ctrl->p_mutex);
+   p_ctrl->p_rpc_activity = &p_ar->activity_uuid;
+   p_ctrl->rpc_rsp_len = 0;
+   os_event_clr(p_ctrl->p_events, SOAK_EVENT_RPC);
+   os_mutex_unlock(p_ctrl->p_mutex);
+
+   t_start = soak_now_ns();
+   if (soak_link_udp_to_device(PF_RPC_SERVER_PORT, p_req, len) == 0)
+   {
+      (void)os_event_wait(p_ctrl->p_events, SOAK_EVENT_RPC, &value, SOAK_RPC_TIMEOUT_MS);
+   }
+
+   os_mutex_lock(p_ctrl->p_mutex);
+   p_ctrl->p_rpc_activity = NULL;
+   os_event_clr(p_ctrl->p_events, SOAK_EVENT_RPC);
+   os_mutex_unlock(p_ctrl->p_mutex);
+
+   if ((value & SOAK_EVENT_RPC) == 0)
+   {
+      p_ctrl->rpc_timeouts++;
+   }
+   else if ((p_ctrl->rpc_rsp_len < SOAK_RPC_HDR_LEN + SOAK_NDR_HDR_LEN) ||
+            (p_ctrl->rpc_rsp[SOAK_RPC_HDR_LEN] != 0))  /* PNIO status error code */
+   {
+      p_ctrl->rpc_errors++;
+   }
+   else
+   {
+      soak_hist_record(p_hist, soak_now_ns() - t_start);
+      ret = 0;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Insert an IOCRBlockReq.
+ *
+ * Lays out the IO data of the AR: the DAP subslots (AR 0 only) have no
+ * data, the module in the AR's slot has one byte in each direction.
+ * @param p_ctrl           In:   The controller.
+ * @param p_ar             InOut:The AR. The output frame template is built.
+ * @param iocr_type        In:   1 for the input CR, 2 for the output CR.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+static void soak_put_iocr(
+   soak_controller_t       *p_ctrl,
+   soak_ar_t               *p_ar,
+   uint16_t                iocr_type,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   uint16_t                start;
+   uint16_t                nbr_dap = soak_expects_dap(p_ctrl, p_ar) ? NELEMENTS(soak_dap_subslots) : 0;
+   uint16_t                offset = 0;
+   uint16_t                ix;
+   bool                    input = (iocr_type == 1);
+
+   start = soak_block_begin(PF_BT_IOCR_BLOCK_REQ, p_bytes, p_pos);
+   pf_put_uint16(true, iocr_type, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, iocr_type, res_len, p_bytes, p_pos);          /* IOCR reference */
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, p_bytes, p_pos);
+   pf_put_uint32(true, 0x00000002, res_len, p_bytes, p_pos);         /* RT_CLASS_2 */
+   pf_put_uint16(true, SOAK_IOCR_DATA_LENGTH, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, input ? p_ar->input_frame_id : p_ar->output_frame_id, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, p_ctrl->cfg.send_clock_factor, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, p_ctrl->cfg.reduction_ratio, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, 1, res_len, p_bytes, p_pos);                  /* Phase */
+   pf_put_uint16(true, 0, res_len, p_bytes, p_pos);                  /* Sequence */
+   pf_put_uint32(true, 0xffffffff, res_len, p_bytes, p_pos);         /* Frame send offset */
+   pf_put_uint16(true, p_ctrl->cfg.data_hold_factor, res_len, p_bytes, p_pos);  /* Watchdog */
+   pf_put_uint16(true, p_ctrl->cfg.data_hold_factor, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, 0xc000, res_len, p_bytes, p_pos);             /* VLAN tag header */
+   for (ix = 0; ix < sizeof(pnet_ethaddr_t); ix++)
+   {
+      pf_put_byte(0, res_len, p_bytes, p_pos);                       /* Multicast MAC */
+   }
+   pf_put_uint16(true, 1, res_len, p_bytes, p_pos);                  /* Number of APIs */
+   pf_put_uint32(true, 0, res_len, p_bytes, p_pos);
+
+   if (input)
+   {
+      /* IO data: IOPS of the DAP subslots, then data and IOPS of the module */
+      pf_put_uint16(true, nbr_dap + 1, res_len, p_bytes, p_pos);
+      for (ix = 0; ix < nbr_dap; ix++)
+      {
+         pf_put_uint16(true, 0, res_len, p_bytes, p_pos);
+         pf_put_uint16(true, soak_dap_subslots[ix], res_len, p_bytes, p_pos);
+         pf_put_uint16(true, offset++, res_len, p_bytes, p_pos);
+      }
+      pf_put_uint16(true, p_ar->slot, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, offset, res_len, p_bytes, p_pos);
+      offset += 2;
+
+      /* IOCS of the module output */
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, p_ar->slot, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, offset, res_len, p_bytes, p_pos);
+   }
+   else
+   {
+      /* IO data goes after the IOCS of the DAP subslots and the module input */
+      p_ar->output_data_pos = nbr_dap + 1;
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, p_ar->slot, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, p_ar->output_data_pos, res_len, p_bytes, p_pos);
+
+      pf_put_uint16(true, nbr_dap + 1, res_len, p_bytes, p_pos);
+      for (ix = 0; ix < nbr_dap; ix++)
+      {
+         pf_put_uint16(true, 0, res_len, p_bytes, p_pos);
+         pf_put_uint16(true, soak_dap_subslots[ix], res_len, p_bytes, p_pos);
+         pf_put_uint16(true, offset++, res_len, p_bytes, p_pos);
+      }
+      pf_put_uint16(true, p_ar->slot, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, offset, res_len, p_bytes, p_pos);
+   }
+
+   soak_block_end(start, p_bytes, *p_pos);
+}
+
+/**
+ * @internal
+ * Build the output frame template of an AR: all IOCS and the IOPS good.
+ * @param p_ctrl           In:   The controller.
+ * @param p_ar             InOut:The AR.
+ */
+static void soak_build_output_frame(
+   soak_controller_t       *p_ctrl,
+   soak_ar_t               *p_ar)
+{
+   uint8_t                 *p_frame = p_ar->output_frame;
+   uint16_t                pos = 0;
+   uint16_t                data_start;
+
+   memset(p_frame, 0, sizeof(p_ar->output_frame));
+   pf_put_mem(p_ctrl->device_mac.addr, sizeof(pnet_ethaddr_t), sizeof(p_ar->output_frame), p_frame, &pos);
+   pf_put_mem(p_ar->mac.addr, sizeof(pnet_ethaddr_t), sizeof(p_ar->output_frame), p_frame, &pos);
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, sizeof(p_ar->output_frame), p_frame, &pos);
+   pf_put_uint16(true, p_ar->output_frame_id, sizeof(p_ar->output_frame), p_frame, &pos);
+
+   data_start = pos;
+   memset(&p_frame[data_start], SOAK_IOXS_GOOD, p_ar->output_data_pos);
+   p_frame[data_start + p_ar->output_data_pos + 1] = SOAK_IOXS_GOOD;   /* IOPS */
+   pos += SOAK_IOCR_DATA_LENGTH;
+
+   pos += sizeof(uint16_t);                           /* Cycle counter */
+   p_frame[pos++] = SOAK_DATA_STATUS;
+   p_frame[pos++] = 0;                                /* Transfer status */
+
+   p_ar->output_frame_len = pos;
+   p_ar->output_data_pos += data_start;
+}
+
+/**
+ * @internal
+ * Insert an ExpectedSubmoduleBlockReq for one slot.
+ * @param p_ar             In:   The AR.
+ * @param dap              In:   true for the DAP in slot 0.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+static void soak_put_expected_submodule(
+   soak_ar_t               *p_ar,
+   bool                    dap,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   uint16_t                start;
+   uint16_t                ix;
+
+   start = soak_block_begin(PF_BT_EXPECTED_SUBMODULE_BLOCK, p_bytes, p_pos);
+   pf_put_uint16(true, 1, res_len, p_bytes, p_pos);                  /* Number of APIs */
+   pf_put_uint32(true, 0, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, dap ? 0 : p_ar->slot, res_len, p_bytes, p_pos);
+   pf_put_uint32(true, dap ? PNET_MOD_DAP_IDENT : SOAK_MODULE_IDENT, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, 0, res_len, p_bytes, p_pos);                  /* Module properties */
+
+   if (dap)
+   {
+      pf_put_uint16(true, NELEMENTS(soak_dap_subslots), res_len, p_bytes, p_pos);
+      for (ix = 0; ix < NELEMENTS(soak_dap_subslots); ix++)
+      {
+         pf_put_uint16(true, soak_dap_subslots[ix], res_len, p_bytes, p_pos);
+         pf_put_uint32(true, soak_dap_subslots[ix], res_len, p_bytes, p_pos);  /* PNET_SUBMOD_DAP_* ident */
+         pf_put_uint16(true, 0, res_len, p_bytes, p_pos);            /* No IO */
+         pf_put_uint16(true, 1, res_len, p_bytes, p_pos);            /* Input description */
+         pf_put_uint16(true, 0, res_len, p_bytes, p_pos);
+         pf_put_byte(1, res_len, p_bytes, p_pos);                    /* IOCS length */
+         pf_put_byte(1, res_len, p_bytes, p_pos);                    /* IOPS length */
+      }
+   }
+   else
+   {
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 1, res_len, p_bytes, p_pos);
+      pf_put_uint32(true, SOAK_SUBMODULE_IDENT, res_len, p_bytes, p_pos);
+      pf_put_uint16(true, 3, res_len, p_bytes, p_pos);               /* Input and output */
+      for (ix = 1; ix <= 2; ix++)
+      {
+         pf_put_uint16(true, ix, res_len, p_bytes, p_pos);           /* Input, then output */
+         pf_put_uint16(true, 1, res_len, p_bytes, p_pos);            /* Data length */
+         pf_put_byte(1, res_len, p_bytes, p_pos);
+         pf_put_byte(1, res_len, p_bytes, p_pos);
+      }
+   }
+
+   soak_block_end(start, p_bytes, *p_pos);
+}
+
+/**
+ * @internal
+ * Insert an IODControlReq.
+ * @param block_type       In:   The block type.
+ * @param p_ar             In:   The AR.
+ * @param command          In:   The control command.
+ * @param p_bytes          Out:  Destination buffer.
+ * @param p_pos            InOut:Position in destination buffer.
+ */
+static void soak_put_control(
+   uint16_t                block_type,
+   soak_ar_t               *p_ar,
+   uint16_t                command,
+   uint8_t                 *p_bytes,
+   uint16_t                *p_pos)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   uint16_t                start;
+
+   start = soak_block_begin(block_type, p_bytes, p_pos);
+   pf_put_uint16(true, 0, res_len, p_bytes, p_pos);                  /* Reserved */
+   soak_put_uuid(true, &p_ar->ar_uuid, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, p_ar->session_key, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, 0, res_len, p_bytes, p_pos);                  /* Reserved */
+   pf_put_uint16(true, command, res_len, p_bytes, p_pos);
+   pf_put_uint16(true, 0, res_len, p_bytes, p_pos);                  /* Control block properties */
+   soak_block_end(start, p_bytes, *p_pos);
+}
+
+/**
+ * @internal
+ * Pick up the frame IDs and the alarm reference assigned by the device
+ * from a Connect response.
+ * @param p_ctrl           In:   The controller, holding the response.
+ * @param p_ar             InOut:The AR.
+ * @return  0  if the response was complete.
+ *          -1 if an error occurred.
+ */
+static int soak_parse_connect_rsp(
+   soak_controller_t       *p_ctrl,
+   soak_ar_t               *p_ar)
+{
+   pf_get_info_t           info;
+   pf_block_header_t       header;
+   uint16_t                pos = SOAK_RPC_HDR_LEN + SOAK_NDR_HDR_LEN;
+   uint16_t                block_start;
+   uint16_t                iocr_type;
+   bool                    got_alarm_cr = false;
+
+   info.result = PF_PARSE_OK;
+   info.is_big_endian = true;
+   info.p_buf = p_ctrl->rpc_rsp;
+   info.len = p_ctrl->rpc_rsp_len;
+
+   while ((info.result == PF_PARSE_OK) && (pos + sizeof(pf_block_header_t) <= info.len))
+   {
+      block_start = pos;
+      pf_get_block_header(&info, &pos, &header);
+      switch (header.block_type)
+      {
+      case PF_BT_IOCR_BLOCK_RES:
+         iocr_type = pf_get_uint16(&info, &pos);
+         (void)pf_get_uint16(&info, &pos);                           /* IOCR reference */
+         if (iocr_type == 1)
+         {
+            p_ar->input_frame_id = pf_get_uint16(&info, &pos);
+         }
+         else
+         {
+            p_ar->output_frame_id = pf_get_uint16(&info, &pos);
+         }
+         break;
+      case PF_BT_ALARM_CR_BLOCK_RES:
+         (void)pf_get_uint16(&info, &pos);                           /* Alarm CR type */
+         p_ar->device_alarm_ref = pf_get_uint16(&info, &pos);
+         got_alarm_cr = true;
+         break;
+      default:
+         break;
+      }
+      pos = block_start + 2 * sizeof(uint16_t) + header.block_length;
+   }
+
+   return ((info.result == PF_PARSE_OK) && got_alarm_cr) ? 0 : -1;
+}
+
+int soak_controller_connect(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   soak_ar_t               *p_ar = &p_ctrl->ars[ix];
+   uint8_t                 req[PF_FRAME_BUFFER_SIZE];
+   uint16_t                pos;
+   uint16_t                start;
+   const char              *p_name = "soak-controller";
+   int                     ret = -1;
+
+   p_ar->input_frame_id = 0x8001 + 2 * ix;
+   p_ar->output_frame_id = 0x8000 + 2 * ix;
+   p_ar->activity_uuid.data2 = p_ar->session_key;
+   p_ar->seq_nbr = 0;
+
+   soak_rpc_begin(p_ctrl, p_ar, PF_RPC_DEV_OPNUM_CONNECT, req, &pos);
+
+   start = soak_block_begin(PF_BT_AR_BLOCK_REQ, req, &pos);
+   pf_put_uint16(true, p_ctrl->cfg.sr ? 0x0020 : 0x0001, res_len, req, &pos);   /* IOCARSR or IOCARSingle */
+   soak_put_uuid(true, &p_ar->ar_uuid, res_len, req, &pos);
+   pf_put_uint16(true, p_ar->session_key, res_len, req, &pos);
+   pf_put_mem(p_ar->mac.addr, sizeof(pnet_ethaddr_t), res_len, req, &pos);
+   soak_put_uuid(true, &soak_controller_object_uuid, res_len, req, &pos);
+   pf_put_uint32(true, 0x40000011, res_len, req, &pos);              /* AR properties */
+   pf_put_uint16(true, 600, res_len, req, &pos);                     /* Activity timeout, 100 ms */
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, req, &pos);     /* UDP RT port */
+   pf_put_uint16(true, (uint16_t)strlen(p_name), res_len, req, &pos);
+   pf_put_mem(p_name, (uint16_t)strlen(p_name), res_len, req, &pos);
+   soak_block_end(start, req, pos);
+
+   soak_put_iocr(p_ctrl, p_ar, 1, req, &pos);
+   soak_put_iocr(p_ctrl, p_ar, 2, req, &pos);
+   if (soak_expects_dap(p_ctrl, p_ar) == true)
+   {
+      soak_put_expected_submodule(p_ar, true, req, &pos);
+   }
+   soak_put_expected_submodule(p_ar, false, req, &pos);
+
+   start = soak_block_begin(PF_BT_ALARM_CR_BLOCK_REQ, req, &pos);
+   pf_put_uint16(true, 0x0001, res_len, req, &pos);                  /* Alarm CR type */
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, req, &pos);
+   pf_put_uint32(true, 0, res_len, req, &pos);                       /* Properties */
+   pf_put_uint16(true, 1, res_len, req, &pos);                       /* RTA timeout, 100 ms */
+   pf_put_uint16(true, 3, res_len, req, &pos);                       /* RTA retries */
+   pf_put_uint16(true, p_ar->alarm_ref, res_len, req, &pos);
+   pf_put_uint16(true, 200, res_len, req, &pos);                     /* Max alarm data length */
+   pf_put_uint16(true, 0xc000, res_len, req, &pos);                  /* Tag header high */
+   pf_put_uint16(true, 0xa000, res_len, req, &pos);                  /* Tag header low */
+   soak_block_end(start, req, pos);
+
+   if (p_ctrl->cfg.sr == true)
+   {
+      start = soak_block_begin(PF_BT_SR_INFO_BLOCK_REQ, req, &pos);
+      pf_put_uint16(true, SOAK_SR_DATA_HOLD_FACTOR, res_len, req, &pos);
+      pf_put_uint32(true, 0, res_len, req, &pos);                    /* SR properties */
+      soak_block_end(start, req, pos);
+   }
+
+   soak_rpc_end(req, pos, SOAK_RPC_ARGS_MAX);
+
+   if ((soak_rpc_call(p_ctrl, p_ar, req, pos, &p_ctrl->connect_latency) == 0) &&
+       (soak_parse_connect_rsp(p_ctrl, p_ar) == 0))
+   {
+      soak_build_output_frame(p_ctrl, p_ar);
+      /* An AR that joins a running AR set is backup */
+      p_ar->primary = (p_ctrl->cfg.sr == false) || (p_ctrl->ars[ix ^ 1].primary == false);
+      p_ar->alarm_send_seq = 0xffff;
+      p_ar->last_input_ns = 0;
+      p_ar->last_output_ns = 0;
+      p_ar->phase = SOAK_AR_CONNECTED;     /* Starts the cyclic data */
+
+      /*
+       * The device may send ApplicationReady before this thread sees the
+       * PrmEnd response, so go to the next phase first.
+       */
+      p_ar->phase = SOAK_AR_PRMEND;
+      p_ar->prm_end_ns = soak_now_ns();
+      soak_rpc_begin(p_ctrl, p_ar, PF_RPC_DEV_OPNUM_CONTROL, req, &pos);
+      soak_put_control(PF_BT_PRMEND_REQ, p_ar, BIT(PF_CONTROL_COMMAND_BIT_PRM_END), req, &pos);
+      soak_rpc_end(req, pos, SOAK_RPC_ARGS_MAX);
+      if (soak_rpc_call(p_ctrl, p_ar, req, pos, &p_ctrl->prm_end_latency) == 0)
+      {
+         ret = 0;
+      }
+   }
+
+   return ret;
+}
+
+void soak_controller_reset(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix)
+{
+   soak_ar_t               *p_ar = &p_ctrl->ars[ix];
+
+   p_ar->phase = SOAK_AR_IDLE;
+   p_ar->session_key++;
+   p_ar->last_input_ns = 0;
+   p_ar->last_output_ns = 0;
+   p_ar->primary = false;
+   p_ar->silent = false;
+   p_ar->switch_pending = false;
+   p_ar->switch_ns = 0;
+}
+
+int soak_controller_sr_failover(
+   soak_controller_t       *p_ctrl,
+   uint16_t                pair)
+{
+   soak_ar_t               *p_primary = &p_ctrl->ars[2 * pair];
+   soak_ar_t               *p_backup = &p_ctrl->ars[2 * pair + 1];
+   int                     ret = -1;
+
+   if (p_backup->primary == true)
+   {
+      p_primary = &p_ctrl->ars[2 * pair + 1];
+      p_backup = &p_ctrl->ars[2 * pair];
+   }
+
+   if ((p_primary->phase == SOAK_AR_DATA) && (p_primary->primary == true) &&
+       (p_backup->phase == SOAK_AR_DATA) && (p_backup->switch_ns == 0))
+   {
+      p_primary->silent = true;
+      p_primary->primary = false;
+
+      /* The cyclic thread timestamps the first primary frame */
+      p_backup->switch_pending = true;
+      p_backup->primary = true;
+      p_ctrl->sr_failovers++;
+      ret = 0;
+   }
+
+   return ret;
+}
+
+int soak_controller_read(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   soak_ar_t               *p_ar = &p_ctrl->ars[ix];
+   uint8_t                 req[PF_FRAME_BUFFER_SIZE];
+   uint16_t                pos;
+   uint16_t                start;
+   uint16_t                pad;
+
+   soak_rpc_begin(p_ctrl, p_ar, PF_RPC_DEV_OPNUM_READ, req, &pos);
+
+   start = soak_block_begin(PF_BT_IOD_READ_REQ_HEADER, req, &pos);
+   pf_put_uint16(true, p_ar->read_seq++, res_len, req, &pos);
+   soak_put_uuid(true, &p_ar->ar_uuid, res_len, req, &pos);
+   pf_put_uint32(true, 0, res_len, req, &pos);                       /* API */
+   pf_put_uint16(true, (ix == 0) ? 0 : p_ar->slot, res_len, req, &pos);
+   pf_put_uint16(true, 1, res_len, req, &pos);                       /* Subslot */
+   pf_put_uint16(true, 0, res_len, req, &pos);                       /* Padding */
+   pf_put_uint16(true, PF_IDX_SUB_IM_0, res_len, req, &pos);
+   pf_put_uint32(true, 4096, res_len, req, &pos);                    /* Record data length */
+   for (pad = 0; pad < 24; pad++)
+   {
+      pf_put_byte(0, res_len, req, &pos);                            /* Target AR UUID, padding */
+   }
+   soak_block_end(start, req, pos);
+
+   soak_rpc_end(req, pos, 4096 + 64);
+
+   return soak_rpc_call(p_ctrl, p_ar, req, pos, &p_ctrl->read_latency);
+}
+
+int soak_controller_dcp_set_name(
+   soak_controller_t       *p_ctrl,
+   const char              *p_name)
+{
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   const uint16_t          res_len = sizeof(frame);
+   uint16_t                pos = 0;
+   uint16_t                name_len = (uint16_t)strlen(p_name);
+   uint16_t                block_len = sizeof(uint16_t) + name_len;
+   uint32_t                value = 0;
+   uint64_t                t_start;
+   int                     ret = -1;
+
+   memset(frame, 0, sizeof(frame));
+   pf_put_mem(p_ctrl->device_mac.addr, sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+   pf_put_mem(p_ctrl->mac.addr, sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, frame, &pos);
+   pf_put_uint16(true, SOAK_FRAME_ID_DCP_GET_SET, res_len, frame, &pos);
+   pf_put_byte(SOAK_DCP_SERVICE_SET, res_len, frame, &pos);
+   pf_put_byte(0, res_len, frame, &pos);                             /* Request */
+   pf_put_uint32(true, ++p_ctrl->dcp_xid, res_len, frame, &pos);
+   pf_put_uint16(true, 0, res_len, frame, &pos);                     /* Response delay */
+   pf_put_uint16(true, 4 + block_len + (block_len & 1), res_len, frame, &pos);
+   pf_put_byte(PF_DCP_OPT_DEVICE_PROPERTIES, res_len, frame, &pos);
+   pf_put_byte(PF_DCP_SUB_DEV_PROP_NAME, res_len, frame, &pos);
+   pf_put_uint16(true, block_len, res_len, frame, &pos);
+   pf_put_uint16(true, 0, res_len, frame, &pos);                     /* Qualifier: temporary */
+   pf_put_mem(p_name, name_len, res_len, frame, &pos);
+   pos += (block_len & 1);
+   if (pos < SOAK_MIN_FRAME_LEN)
+   {
+      pos = SOAK_MIN_FRAME_LEN;
+   }
+
+   os_event_clr(p_ctrl->p_events, SOAK_EVENT_DCP);
+   t_start = soak_now_ns();
+   if (soak_link_eth_to_device(frame, pos) == 0)
+   {
+      (void)os_event_wait(p_ctrl->p_events, SOAK_EVENT_DCP, &value, SOAK_RPC_TIMEOUT_MS);
+   }
+   os_event_clr(p_ctrl->p_events, SOAK_EVENT_DCP);
+
+   if ((value & SOAK_EVENT_DCP) != 0)
+   {
+      soak_hist_record(&p_ctrl->dcp_set_latency, soak_now_ns() - t_start);
+      ret = 0;
+   }
+   else
+   {
+      p_ctrl->rpc_timeouts++;
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Answer the ApplicationReady request of the device.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_msg            In:   The request.
+ */
+static void soak_handle_rpc_req(
+   soak_controller_t       *p_ctrl,
+   soak_msg_t              *p_msg)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   pf_get_info_t           info;
+   pf_rpc_header_t         rpc;
+   pf_block_header_t       header;
+   pf_uuid_t               ar_uuid;
+   uint8_t                 rsp[PF_FRAME_BUFFER_SIZE];
+   uint16_t                pos = 0;
+   uint16_t                pos_body_len;
+   uint16_t                pos_lkup_len;
+   uint16_t                pos_ndr;
+   uint16_t                start;
+   uint16_t                ix;
+   soak_ar_t               *p_ar = NULL;
+
+   info.result = PF_PARSE_OK;
+   info.is_big_endian = false;
+   info.p_buf = p_msg->data;
+   info.len = p_msg->len;
+   pf_get_dce_rpc_header(&info, &pos, &rpc);
+   pos += SOAK_NDR_HDR_LEN;
+
+   info.is_big_endian = true;
+   pf_get_block_header(&info, &pos, &header);
+   (void)pf_get_uint16(&info, &pos);                                 /* Reserved */
+   soak_get_uuid(&info, &pos, &ar_uuid);
+   (void)pf_get_uint16(&info, &pos);                                 /* Session key */
+   if ((info.result != PF_PARSE_OK) ||
+       (rpc.opnum != PF_RPC_DEV_OPNUM_CONTROL) ||
+       (header.block_type != PF_BT_APPRDY_REQ))
+   {
+      p_ctrl->unknown_frames++;
+      return;
+   }
+
+   for (ix = 0; ix < p_ctrl->cfg.nbr_ars; ix++)
+   {
+      if (memcmp(&p_ctrl->ars[ix].ar_uuid, &ar_uuid, sizeof(ar_uuid)) == 0)
+      {
+         p_ar = &p_ctrl->ars[ix];
+      }
+   }
+   if (p_ar == NULL)
+   {
+      p_ctrl->unknown_frames++;
+      return;
+   }
+
+   rpc.packet_type = PF_RPC_PT_RESPONSE;
+   memset(&rpc.flags, 0, sizeof(rpc.flags));
+   rpc.flags.last_fragment = true;
+   rpc.flags.no_fack = true;
+   pos = 0;
+   pf_put_dce_rpc_header(&rpc, res_len, rsp, &pos, &pos_body_len, &pos_lkup_len);
+
+   /* NDR response header, PNIO status OK */
+   pos_ndr = pos;
+   pf_put_uint32(rpc.is_big_endian, 0, res_len, rsp, &pos);
+   pos += 4 * sizeof(uint32_t);
+
+   soak_put_control(PF_BT_APPRDY_RES, p_ar, BIT(PF_CONTROL_COMMAND_BIT_DONE), rsp, &pos);
+
+   start = pos;
+   pos = pos_body_len;
+   pf_put_uint16(rpc.is_big_endian, start - pos_lkup_len, res_len, rsp, &pos);
+   pos = pos_ndr + sizeof(uint32_t);
+   pf_put_uint32(rpc.is_big_endian, start - pos_ndr - SOAK_NDR_HDR_LEN, res_len, rsp, &pos);
+   pf_put_uint32(rpc.is_big_endian, PF_FRAME_BUFFER_SIZE, res_len, rsp, &pos);
+   pf_put_uint32(rpc.is_big_endian, 0, res_len, rsp, &pos);
+   pf_put_uint32(rpc.is_big_endian, start - pos_ndr - SOAK_NDR_HDR_LEN, res_len, rsp, &pos);
+
+   if (soak_link_udp_to_device(p_msg->port, rsp, start) == 0)
+   {
+      soak_hist_record(&p_ctrl->appl_rdy_latency, p_msg->t_ns - p_ar->prm_end_ns);
+      p_ar->phase = SOAK_AR_DATA;
+   }
+}
+
+/**
+ * @internal
+ * Acknowledge an alarm notification: an RTA ACK for the notification, then
+ * an AlarmAck DATA PDU.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_msg            In:   The frame from the device.
+ * @param frame_id_pos     In:   Position of the frame ID.
+ */
+static void soak_handle_alarm(
+   soak_controller_t       *p_ctrl,
+   soak_msg_t              *p_msg,
+   uint16_t                frame_id_pos)
+{
+   const uint16_t          res_len = PF_FRAME_BUFFER_SIZE;
+   pf_get_info_t           info;
+   pf_alarm_fixed_t        fixed;
+   pf_alarm_fixed_t        rsp_fixed;
+   pf_block_header_t       header;
+   uint16_t                pos = frame_id_pos;
+   uint16_t                frame_id;
+   uint16_t                var_part_len;
+   uint16_t                alarm_type;
+   uint32_t                api;
+   uint16_t                slot;
+   uint16_t                subslot;
+   uint16_t                specifier;
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                start;
+   uint16_t                var_pos;
+   uint16_t                ix;
+   soak_ar_t               *p_ar = NULL;
+
+   info.result = PF_PARSE_OK;
+   info.is_big_endian = true;
+   info.p_buf = p_msg->data;
+   info.len = p_msg->len;
+   frame_id = pf_get_uint16(&info, &pos);
+   pf_get_alarm_fixed(&info, &pos, &fixed);
+   var_part_len = pf_get_uint16(&info, &pos);
+
+   for (ix = 0; ix < p_ctrl->cfg.nbr_ars; ix++)
+   {
+      if ((p_ctrl->ars[ix].phase != SOAK_AR_IDLE) &&
+          (p_ctrl->ars[ix].alarm_ref == fixed.dst_ref))
+      {
+         p_ar = &p_ctrl->ars[ix];
+      }
+   }
+
+   /* ACK PDUs from the device only confirm our AlarmAck */
+   if ((p_ar == NULL) ||
+       (fixed.pdu_type.type != PF_RTA_PDU_TYPE_DATA) ||
+       (var_part_len == 0))
+   {
+      return;
+   }
+
+   pf_get_block_header(&info, &pos, &header);
+   alarm_type = pf_get_uint16(&info, &pos);
+   api = pf_get_uint32(&info, &pos);
+   slot = pf_get_uint16(&info, &pos);
+   subslot = pf_get_uint16(&info, &pos);
+   (void)pf_get_uint32(&info, &pos);                                 /* Module ident */
+   (void)pf_get_uint32(&info, &pos);                                 /* Submodule ident */
+   specifier = pf_get_uint16(&info, &pos);
+   if (info.result != PF_PARSE_OK)
+   {
+      p_ctrl->unknown_frames++;
+      return;
+   }
+
+   memset(&rsp_fixed, 0, sizeof(rsp_fixed));
+   rsp_fixed.dst_ref = fixed.src_ref;
+   rsp_fixed.src_ref = p_ar->alarm_ref;
+   rsp_fixed.pdu_type.version = 1;
+   rsp_fixed.add_flags.window_size = 1;
+   rsp_fixed.ack_seq_nbr = fixed.send_seq_num;
+
+   /* RTA ACK of the notification */
+   pos = 0;
+   memset(frame, 0, sizeof(frame));
+   pf_put_mem(p_ctrl->device_mac.addr, sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+   pf_put_mem(p_ar->mac.addr, sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, frame, &pos);
+   pf_put_uint16(true, frame_id, res_len, frame, &pos);
+   start = pos;
+   rsp_fixed.pdu_type.type = PF_RTA_PDU_TYPE_ACK;
+   rsp_fixed.send_seq_num = (p_ar->alarm_send_seq == 0xffff) ?
+      0xfffe : ((p_ar->alarm_send_seq - 1) & 0x7fff);
+   pf_put_alarm_fixed(true, &rsp_fixed, res_len, frame, &pos);
+   pf_put_uint16(true, 0, res_len, frame, &pos);                     /* var_part_len */
+   (void)soak_link_eth_to_device(frame, SOAK_MIN_FRAME_LEN);
+
+   /* AlarmAck */
+   pos = start;
+   memset(&frame[start], 0, sizeof(frame) - start);
+   rsp_fixed.pdu_type.type = PF_RTA_PDU_TYPE_DATA;
+   rsp_fixed.add_flags.tack = true;
+   rsp_fixed.send_seq_num = p_ar->alarm_send_seq;
+   p_ar->alarm_send_seq = (p_ar->alarm_send_seq + 1) & 0x7fff;
+   pf_put_alarm_fixed(true, &rsp_fixed, res_len, frame, &pos);
+   var_pos = pos;
+   pf_put_uint16(true, 0, res_len, frame, &pos);
+   start = soak_block_begin((header.block_type == PF_BT_ALARM_NOTIFICATION_HIGH) ?
+      PF_BT_ALARM_ACK_HIGH : PF_BT_ALARM_ACK_LOW, frame, &pos);
+   pf_put_uint16(true, alarm_type, res_len, frame, &pos);
+   pf_put_uint32(true, api, res_len, frame, &pos);
+   pf_put_uint16(true, slot, res_len, frame, &pos);
+   pf_put_uint16(true, subslot, res_len, frame, &pos);
+   pf_put_uint16(true, specifier, res_len, frame, &pos);
+   soak_block_end(start, frame, pos);
+   pf_put_uint32(true, 0, res_len, frame, &pos);                     /* PNIO status OK */
+   pf_put_uint16(true, pos - var_pos - sizeof(uint16_t), res_len, frame, &var_pos);
+   (void)soak_link_eth_to_device(frame, (pos < SOAK_MIN_FRAME_LEN) ? SOAK_MIN_FRAME_LEN : pos);
+
+   p_ar->alarms_acked++;
+}
+
+/**
+ * @internal
+ * Record the arrival of a cyclic frame from the device.
+ * @param p_ctrl           InOut: The controller.
+ * @param frame_id         In:   The frame ID.
+ * @param p_msg            In:   The frame.
+ * @param pos              In:   Position after the frame ID.
+ * @return  true if the frame belongs to an AR.
+ */
+static bool soak_handle_input(
+   soak_controller_t       *p_ctrl,
+   uint16_t                frame_id,
+   const soak_msg_t        *p_msg,
+   uint16_t                pos)
+{
+   uint64_t                cycle = soak_cycle_ns(&p_ctrl->cfg);
+   uint64_t                t_ns = p_msg->t_ns;
+   uint16_t                status_pos = pos + SOAK_IOCR_DATA_LENGTH + sizeof(uint16_t);
+   uint64_t                gap;
+   soak_ar_t               *p_ar;
+   uint16_t                ix;
+
+   for (ix = 0; ix < p_ctrl->cfg.nbr_ars; ix++)
+   {
+      p_ar = &p_ctrl->ars[ix];
+      if ((p_ar->phase != SOAK_AR_IDLE) && (p_ar->input_frame_id == frame_id))
+      {
+         if (p_ar->last_input_ns != 0)
+         {
+            gap = t_ns - p_ar->last_input_ns;
+            soak_hist_record(&p_ar->input_gap, gap);
+            soak_hist_record(&p_ar->input_jitter, (gap > cycle) ? (gap - cycle) : (cycle - gap));
+         }
+         p_ar->last_input_ns = t_ns;
+         p_ar->input_frames++;
+
+         /* The switchover is done when the device reports this AR as primary */
+         if ((p_ar->switch_ns != 0) && (status_pos < p_msg->len) &&
+             ((p_msg->data[status_pos] & SOAK_DATA_STATUS_STATE) != 0))
+         {
+            soak_hist_record(&p_ctrl->sr_switchover, t_ns - p_ar->switch_ns);
+            p_ctrl->sr_switchovers++;
+            p_ar->switch_ns = 0;
+         }
+         return true;
+      }
+   }
+
+   return false;
+}
+
+uint64_t soak_controller_ptcp_time(
+   const soak_controller_t *p_ctrl,
+   uint64_t                t_ns)
+{
+   int64_t                 dt = (int64_t)(t_ns - p_ctrl->ptcp_start_ns);
+
+   return SOAK_PTCP_START_NS + dt + (dt * p_ctrl->cfg.ptcp_drift_ppm) / 1000000;
+}
+
+/**
+ * @internal
+ * Insert the Ethernet header and the PTCP header of a PTCP frame.
+ * @param p_ctrl           In:   The controller.
+ * @param p_dest           In:   Destination MAC address.
+ * @param frame_id         In:   The frame ID.
+ * @param sequence         In:   The SequenceID.
+ * @param delay            In:   The delay in nanoseconds.
+ * @param p_frame          Out:  The frame, SOAK_MIN_FRAME_LEN or larger.
+ * @param p_pos            Out:  Position after the header.
+ */
+static void soak_ptcp_begin(
+   const soak_controller_t *p_ctrl,
+   const pnet_ethaddr_t    *p_dest,
+   uint16_t                frame_id,
+   uint16_t                sequence,
+   uint32_t                delay,
+   uint8_t                 *p_frame,
+   uint16_t                *p_pos)
+{
+   const uint16_t          res_len = SOAK_MIN_FRAME_LEN;
+
+   memset(p_frame, 0, SOAK_MIN_FRAME_LEN);
+   *p_pos = 0;
+   pf_put_mem(p_dest->addr, sizeof(pnet_ethaddr_t), res_len, p_frame, p_pos);
+   pf_put_mem(p_ctrl->mac.addr, sizeof(pnet_ethaddr_t), res_len, p_frame, p_pos);
+   pf_put_uint16(true, OS_ETHTYPE_PROFINET, res_len, p_frame, p_pos);
+   pf_put_uint16(true, frame_id, res_len, p_frame, p_pos);
+   pf_put_uint32(true, 0, res_len, p_frame, p_pos);                  /* Reserved */
+   pf_put_uint32(true, 0, res_len, p_frame, p_pos);                  /* Reserved */
+   pf_put_uint32(true, delay / 10, res_len, p_frame, p_pos);         /* Delay10ns */
+   pf_put_uint16(true, sequence, res_len, p_frame, p_pos);
+   pf_put_byte((uint8_t)(delay % 10), res_len, p_frame, p_pos);      /* Delay1ns_Byte */
+   pf_put_byte(0, res_len, p_frame, p_pos);                          /* Padding */
+   pf_put_uint32(true, 0, res_len, p_frame, p_pos);                  /* Delay1ns */
+}
+
+/**
+ * @internal
+ * Send an RTSync frame with the time of the master.
+ * @param p_ctrl           InOut: The controller.
+ */
+static void soak_ptcp_send_sync(
+   soak_controller_t       *p_ctrl)
+{
+   uint8_t                 frame[128];
+   const uint16_t          res_len = sizeof(frame);
+   uint16_t                pos = 0;
+   uint64_t                master_time;
+
+   memset(frame, 0, sizeof(frame));
+   soak_ptcp_begin(p_ctrl, &soak_ptcp_sync_addr, SOAK_FRAME_ID_PTCP_SYNC,
+      ++p_ctrl->ptcp_sequence, 0, frame, &pos);
+   pf_put_uint16(true, (PF_PTCP_TLV_SUBDOMAIN << 9) | PF_PTCP_SUBDOMAIN_SIZE, res_len, frame, &pos);
+   pf_put_mem(p_ctrl->mac.addr, sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+   pos += PF_PTCP_SUBDOMAIN_SIZE - sizeof(pnet_ethaddr_t);          /* SubdomainUUID */
+   pf_put_uint16(true, (PF_PTCP_TLV_TIME << 9) | PF_PTCP_TIME_SIZE, res_len, frame, &pos);
+   master_time = soak_controller_ptcp_time(p_ctrl, soak_now_ns());
+   pf_put_uint16(true, 0, res_len, frame, &pos);                     /* EpochNumber */
+   pf_put_uint32(true, (uint32_t)(master_time / 1000000000ULL), res_len, frame, &pos);
+   pf_put_uint32(true, (uint32_t)(master_time % 1000000000ULL), res_len, frame, &pos);
+   pf_put_uint16(true, PF_PTCP_TLV_END << 9, res_len, frame, &pos);
+
+   (void)soak_link_eth_to_device(frame, pos);
+}
+
+/**
+ * @internal
+ * Answer a DelayReq frame from the device.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_msg            In:   The request.
+ * @param rx_ns            In:   When the request was received.
+ */
+static void soak_ptcp_delay_rsp(
+   soak_controller_t       *p_ctrl,
+   const soak_msg_t        *p_msg,
+   uint64_t                rx_ns)
+{
+   uint8_t                 frame[SOAK_MIN_FRAME_LEN];
+   const uint16_t          res_len = sizeof(frame);
+   uint16_t                pos = 0;
+   uint16_t                sequence;
+
+   if (p_msg->len >= SOAK_ETH_HDR_LEN + sizeof(uint16_t) + PF_PTCP_HEADER_SIZE)
+   {
+      sequence = (p_msg->data[SOAK_ETH_HDR_LEN + 14] << 8) | p_msg->data[SOAK_ETH_HDR_LEN + 15];
+      p_ctrl->ptcp_delay_reqs++;
+
+      soak_ptcp_begin(p_ctrl, &soak_ptcp_delay_addr, SOAK_FRAME_ID_PTCP_DELAY_RES,
+         sequence, (uint32_t)(soak_now_ns() - rx_ns), frame, &pos);
+      pf_put_uint16(true, (PF_PTCP_TLV_DELAY_PARAMETER << 9) | PF_PTCP_DELAY_PARAMETER_SIZE, res_len, frame, &pos);
+      pf_put_mem(&p_msg->data[sizeof(pnet_ethaddr_t)], sizeof(pnet_ethaddr_t), res_len, frame, &pos);
+      pf_put_uint16(true, PF_PTCP_TLV_END << 9, res_len, frame, &pos);
+
+      (void)soak_link_eth_to_device(frame, SOAK_MIN_FRAME_LEN);
+   }
+}
+
+/**
+ * @internal
+ * Receive frames and datagrams from the device.
+ * @param thread_arg       In:   The controller.
+ */
+static void soak_rx_task(
+   void                    *thread_arg)
+{
+   soak_controller_t       *p_ctrl = (soak_controller_t *)thread_arg;
+   soak_msg_t              *p_msg;
+   pf_get_info_t           info;
+   pf_rpc_header_t         rpc;
+   uint16_t                pos;
+   uint16_t                type;
+   uint16_t                frame_id;
+   uint64_t                rx_ns;
+
+   for (;;)
+   {
+      p_msg = soak_link_from_device(100);
+      if (p_msg == NULL)
+      {
+         continue;
+      }
+      rx_ns = soak_now_ns();
+
+      info.result = PF_PARSE_OK;
+      info.is_big_endian = true;
+      info.p_buf = p_msg->data;
+      info.len = p_msg->len;
+      pos = 0;
+
+      if (p_msg->kind == SOAK_MSG_UDP)
+      {
+         info.is_big_endian = false;
+         pf_get_dce_rpc_header(&info, &pos, &rpc);
+         if (info.result != PF_PARSE_OK)
+         {
+            p_ctrl->unknown_frames++;
+         }
+         else if (rpc.packet_type == PF_RPC_PT_REQUEST)
+         {
+            soak_handle_rpc_req(p_ctrl, p_msg);
+         }
+         else if (rpc.packet_type == PF_RPC_PT_RESPONSE)
+         {
+            os_mutex_lock(p_ctrl->p_mutex);
+            if ((p_ctrl->p_rpc_activity != NULL) &&
+                (memcmp(p_ctrl->p_rpc_activity, &rpc.activity_uuid, sizeof(rpc.activity_uuid)) == 0))
+            {
+               memcpy(p_ctrl->rpc_rsp, p_msg->data, p_msg->len);
+               p_ctrl->rpc_rsp_len = p_msg->len;
+               os_event_set(p_ctrl->p_events, SOAK_EVENT_RPC);
+            }
+            os_mutex_unlock(p_ctrl->p_mutex);
+         }
+      }
+      else
+      {
+         /* Skip VLAN tags */
+         pos = 2 * sizeof(pnet_ethaddr_t);
+         type = pf_get_uint16(&info, &pos);
+         while (type == OS_ETHTYPE_VLAN)
+         {
+            pos += sizeof(uint16_t);
+            type = pf_get_uint16(&info, &pos);
+         }
+         frame_id = pf_get_uint16(&info, &pos);
+
+         if ((info.result != PF_PARSE_OK) || (type != OS_ETHTYPE_PROFINET))
+         {
+            /* LLDP */
+         }
+         else if (frame_id == SOAK_FRAME_ID_DCP_GET_SET)
+         {
+            /* Service ID, service type, xid */
+            if ((pf_get_byte(&info, &pos) == SOAK_DCP_SERVICE_SET) &&
+                (pf_get_byte(&info, &pos) == SOAK_DCP_SERVICE_TYPE_SUCCESS) &&
+                (pf_get_uint32(&info, &pos) == p_ctrl->dcp_xid))
+            {
+               os_event_set(p_ctrl->p_events, SOAK_EVENT_DCP);
+            }
+         }
+         else if ((frame_id == SOAK_FRAME_ID_ALARM_LOW) || (frame_id == SOAK_FRAME_ID_ALARM_HIGH))
+         {
+            soak_handle_alarm(p_ctrl, p_msg, pos - sizeof(uint16_t));
+         }
+         else if (frame_id == SOAK_FRAME_ID_PTCP_DELAY_REQ)
+         {
+            if (p_ctrl->cfg.ptcp == true)
+            {
+               soak_ptcp_delay_rsp(p_ctrl, p_msg, rx_ns);
+            }
+         }
+         else if (soak_handle_input(p_ctrl, frame_id, p_msg, pos) == false)
+         {
+            p_ctrl->unknown_frames++;
+         }
+      }
+
+      soak_link_release(p_msg);
+   }
+}
+
+/**
+ * @internal
+ * Send the output frames of all connected ARs once per cycle.
+ * @param thread_arg       In:   The controller.
+ */
+static void soak_tx_task(
+   void                    *thread_arg)
+{
+   soak_controller_t       *p_ctrl = (soak_controller_t *)thread_arg;
+   uint64_t                cycle = soak_cycle_ns(&p_ctrl->cfg);
+   uint16_t                counter_step = p_ctrl->cfg.send_clock_factor * p_ctrl->cfg.reduction_ratio;
+   uint64_t                next = soak_now_ns() + cycle;
+   uint64_t                next_sync = next;
+   uint64_t                now;
+   soak_ar_t               *p_ar;
+   uint16_t                pos;
+   uint16_t                ix;
+   bool                    primary;
+
+   for (;;)
+   {
+      soak_sleep_until(next);
+      now = soak_now_ns();
+      soak_hist_record(&p_ctrl->tx_wakeup, now - next);
+
+      for (ix = 0; ix < p_ctrl->cfg.nbr_ars; ix++)
+      {
+         p_ar = &p_ctrl->ars[ix];
+         if ((p_ar->phase != SOAK_AR_IDLE) && (p_ar->silent == false))
+         {
+            primary = p_ar->primary;
+            p_ar->cycle_counter += counter_step;
+            p_ar->output_frame[p_ar->output_data_pos] = (uint8_t)(p_ar->cycle_counter >> 5);
+            pos = p_ar->output_frame_len - 2 - sizeof(uint16_t);
+            pf_put_uint16(true, p_ar->cycle_counter, sizeof(p_ar->output_frame), p_ar->output_frame, &pos);
+            p_ar->output_frame[pos] = primary ? SOAK_DATA_STATUS : (SOAK_DATA_STATUS & ~SOAK_DATA_STATUS_STATE);
+            if (primary && p_ar->switch_pending)
+            {
+               p_ar->switch_ns = now;
+               p_ar->switch_pending = false;
+            }
+            (void)soak_link_eth_to_device(p_ar->output_frame, p_ar->output_frame_len);
+         }
+      }
+
+      if ((p_ctrl->cfg.ptcp == true) && (now >= next_sync))
+      {
+         next_sync = now + SOAK_PTCP_SYNC_INTERVAL_NS;
+         soak_ptcp_send_sync(p_ctrl);
+      }
+
+      /* Keep the phase, but do not try to catch up after a long stall */
+      next += cycle;
+      if (now > next + 100 * cycle)
+      {
+         next = now + cycle;
+      }
+   }
+}
+
+void soak_controller_device_rx(
+   soak_controller_t       *p_ctrl,
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint64_t                t_ns)
+{
+   uint16_t                frame_id;
+   soak_ar_t               *p_ar;
+   uint16_t                ix;
+
+   if (len < SOAK_ETH_HDR_LEN + sizeof(uint16_t))
+   {
+      return;
+   }
+
+   /* The controller does not VLAN tag its frames */
+   frame_id = (p_frame[SOAK_ETH_HDR_LEN] << 8) | p_frame[SOAK_ETH_HDR_LEN + 1];
+   for (ix = 0; ix < p_ctrl->cfg.nbr_ars; ix++)
+   {
+      p_ar = &p_ctrl->ars[ix];
+      if ((p_ar->phase != SOAK_AR_IDLE) && (p_ar->output_frame_id == frame_id))
+      {
+         if (p_ar->last_output_ns != 0)
+         {
+            soak_hist_record(&p_ar->output_gap, t_ns - p_ar->last_output_ns);
+         }
+         p_ar->last_output_ns = t_ns;
+         p_ar->output_frames++;
+      }
+   }
+}
+
+int soak_controller_init(
+   soak_controller_t       *p_ctrl,
+   const soak_cfg_t        *p_cfg,
+   const pnet_cfg_t        *p_device_cfg)
+{
+   const pnet_ethaddr_t    mac = { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+   pf_uuid_t               object_uuid =
+      { 0xdea00000, 0x6c97, 0x11d1, { 0x82, 0x71, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 } };
+   soak_ar_t               *p_ar;
+   uint16_t                ix;
+   int                     ret = -1;
+
+   memset(p_ctrl, 0, sizeof(*p_ctrl));
+   p_ctrl->cfg = *p_cfg;
+   p_ctrl->mac = mac;
+   p_ctrl->device_mac = p_device_cfg->eth_addr;
+
+   object_uuid.data4[4] = p_device_cfg->device_id.device_id_hi;
+   object_uuid.data4[5] = p_device_cfg->device_id.device_id_lo;
+   object_uuid.data4[6] = p_device_cfg->device_id.vendor_id_hi;
+   object_uuid.data4[7] = p_device_cfg->device_id.vendor_id_lo;
+   p_ctrl->device_object_uuid = object_uuid;
+
+   for (ix = 0; ix < SOAK_MAX_ARS; ix++)
+   {
+      p_ar = &p_ctrl->ars[ix];
+      p_ar->ix = ix;
+      p_ar->phase = SOAK_AR_IDLE;
+      p_ar->ar_uuid.data1 = 0x30aba9a3 + ix;
+      p_ar->ar_uuid.data2 = 0xf764;
+      p_ar->ar_uuid.data3 = 0xb744;
+      memcpy(p_ar->ar_uuid.data4, "\xb3\xb6\x7e\xe2\x8a\x1a\x02\xcb", sizeof(p_ar->ar_uuid.data4));
+      if (p_cfg->sr == true)
+      {
+         /* The ARUUIDs of an AR set differ only in the ARUUID.Selector */
+         p_ar->ar_uuid.data1 = 0x30aba9a3 + ix / 2;
+         p_ar->ar_uuid.data4[7] = (uint8_t)(ix % 2);
+      }
+      p_ar->activity_uuid = p_ar->ar_uuid;
+      p_ar->activity_uuid.data1 = 0xe297acbb + ix;
+      p_ar->session_key = 1;
+      p_ar->slot = p_cfg->sr ? (ix / 2 + 1) : (ix + 1);
+      p_ar->mac = mac;
+      p_ar->mac.addr[5] = (uint8_t)(0x10 + ix);
+      p_ar->alarm_ref = ix + 1;
+      soak_hist_init(&p_ar->input_jitter);
+      soak_hist_init(&p_ar->input_gap);
+      soak_hist_init(&p_ar->output_gap);
+   }
+
+   soak_hist_init(&p_ctrl->tx_wakeup);
+   soak_hist_init(&p_ctrl->dcp_set_latency);
+   soak_hist_init(&p_ctrl->connect_latency);
+   soak_hist_init(&p_ctrl->prm_end_latency);
+   soak_hist_init(&p_ctrl->appl_rdy_latency);
+   soak_hist_init(&p_ctrl->read_latency);
+   soak_hist_init(&p_ctrl->sr_switchover);
+   p_ctrl->ptcp_start_ns = soak_now_ns();
+
+   p_ctrl->p_mutex = os_mutex_create();
+   p_ctrl->p_events = os_event_create();
+   if ((p_ctrl->p_mutex != NULL) && (p_ctrl->p_events != NULL))
+   {
+      p_ctrl->p_rx_thread = os_thread_create("soak_ctrl_rx", p_cfg->priority,
+         8192, soak_rx_task, p_ctrl);
+      p_ctrl->p_tx_thread = os_thread_create("soak_ctrl_tx", p_cfg->priority,
+         4096, soak_tx_task, p_ctrl);
+      if ((p_ctrl->p_rx_thread != NULL) && (p_ctrl->p_tx_thread != NULL))
+      {
+         ret = 0;
+      }
+   }
+
+   return ret;
+}
@@ -0,0 +1,253 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef SOAK_CONTROLLER_H
+#define SOAK_CONTROLLER_H
+
+#include <stdint.h>
+
+#include "pf_includes.h"
+#include "soak_link.h"
+#include "soak_stats.h"
+
+/*
+ * Simulated IO-controller for pf_soak.
+ *
+ * Talks to the stack over the in-process link: DCP Set NameOfStation,
+ * Connect, PrmEnd, the ApplicationReady handshake, cyclic output data,
+ * acknowledgement of low priority alarms and acyclic Read of I&M0. With
+ * cfg.ptcp it is also the PTCP sync master of the device, sending RTSync
+ * frames and answering DelayReq. Each AR
+ * uses a MAC address of its own, as a separate controller would, and owns
+ * one 8 bit in/out module in slot (AR index + 1); AR 0 also owns the DAP. Every frame and RPC is timestamped so the harness can report jitter
+ * and latency percentiles.
+ *
+ * With cfg.sr the ARs are connected in pairs, as the system redundancy AR
+ * set of a redundant controller pair. Both ARs of pair n expect the module
+ * in slot (n + 1), and pair 0 also the DAP. The AR with the even index starts
+ * as primary. soak_controller_sr_failover() simulates the loss of the
+ * primary controller.
+ */
+
+#define SOAK_MAX_ARS                            16       /* pf_soak is built with PNET_MAX_MODULES 17 */
+#define SOAK_IOCR_DATA_LENGTH                   40       /* Min RT_CLASS_2 payload */
+#define SOAK_RPC_TIMEOUT_MS                     1000
+#define SOAK_STATION_NAME                       "soak-device"
+#define SOAK_MODULE_IDENT                       0x00000032  /* 8 bit in, 8 bit out */
+#define SOAK_SUBMODULE_IDENT                    0x00000001
+
+typedef struct soak_cfg
+{
+   uint16_t                nbr_ars;
+   uint16_t                send_clock_factor;   /* Units of 31.25 us */
+   uint16_t                reduction_ratio;
+   uint16_t                data_hold_factor;    /* Cycles */
+   int                     priority;            /* Of the cyclic thread */
+   bool                    ptcp;                /* Act as PTCP sync master */
+   int32_t                 ptcp_drift_ppm;      /* Of the master clock against the local clock */
+   bool                    sr;                  /* Connect the ARs in pairs as AR sets */
+} soak_cfg_t;
+
+typedef enum soak_ar_phase
+{
+   SOAK_AR_IDLE,
+   SOAK_AR_CONNECTED,      /* Connect accepted, cyclic data is running */
+   SOAK_AR_PRMEND,         /* Waiting for ApplicationReady */
+   SOAK_AR_DATA,           /* ApplicationReady has been confirmed */
+} soak_ar_phase_t;
+
+typedef struct soak_ar
+{
+   uint16_t                ix;
+   volatile soak_ar_phase_t phase;
+   pf_uuid_t               ar_uuid;
+   pf_uuid_t               activity_uuid;
+   uint32_t                seq_nbr;
+   uint16_t                session_key;
+   uint16_t                slot;
+   pnet_ethaddr_t          mac;                 /* Each AR is a controller of its own */
+   uint16_t                input_frame_id;
+   uint16_t                output_frame_id;
+   uint16_t                alarm_ref;           /* Local, sent in AlarmCRBlockReq */
+   uint16_t                device_alarm_ref;    /* From AlarmCRBlockRes */
+   uint16_t                alarm_send_seq;
+   uint16_t                read_seq;
+   uint8_t                 output_frame[64];
+   uint16_t                output_frame_len;
+   uint16_t                output_data_pos;
+   uint16_t                cycle_counter;
+   uint64_t                prm_end_ns;          /* When PrmEnd was confirmed */
+
+   /* Input CR, as seen by the controller */
+   uint64_t                last_input_ns;
+   uint64_t                input_frames;
+   soak_hist_t             input_jitter;
+   soak_hist_t             input_gap;
+
+   /* Output CR, as seen by the device */
+   uint64_t                last_output_ns;
+   uint64_t                output_frames;
+   soak_hist_t             output_gap;
+
+   uint32_t                alarms_acked;
+
+   /* System redundancy */
+   volatile bool           primary;             /* State bit of the output CR */
+   volatile bool           silent;              /* Failed, sends no output frames */
+   volatile bool           switch_pending;      /* Made primary, not sent yet */
+   volatile uint64_t       switch_ns;           /* First primary frame, until the device follows */
+} soak_ar_t;
+
+typedef struct soak_controller
+{
+   soak_cfg_t              cfg;
+   pnet_ethaddr_t          mac;
+   pnet_ethaddr_t          device_mac;
+   pf_uuid_t               device_object_uuid;
+   soak_ar_t               ars[SOAK_MAX_ARS];
+
+   os_mutex_t              *p_mutex;
+   os_event_t              *p_events;
+   const pf_uuid_t         *p_rpc_activity;     /* Outstanding RPC request */
+   uint8_t                 rpc_rsp[PF_FRAME_BUFFER_SIZE];
+   uint16_t                rpc_rsp_len;
+   uint32_t                dcp_xid;             /* Outstanding DCP request */
+
+   os_thread_t             *p_rx_thread;
+   os_thread_t             *p_tx_thread;
+
+   soak_hist_t             tx_wakeup;           /* Lateness of the cyclic thread */
+   soak_hist_t             dcp_set_latency;
+   soak_hist_t             connect_latency;
+   soak_hist_t             prm_end_latency;
+   soak_hist_t             appl_rdy_latency;    /* PrmEnd.cnf to ApplicationReady.ind */
+   soak_hist_t             read_latency;
+   soak_hist_t             sr_switchover;       /* First primary frame to the first primary input */
+
+   uint64_t                ptcp_start_ns;       /* Local time when the master clock started */
+   uint16_t                ptcp_sequence;
+   uint32_t                ptcp_delay_reqs;
+
+   uint32_t                sr_failovers;
+   uint32_t                sr_switchovers;      /* Failovers the device has followed */
+
+   uint32_t                rpc_timeouts;
+   uint32_t                rpc_errors;
+   uint32_t                unknown_frames;
+} soak_controller_t;
+
+/**
+ * Get the nominal cycle time.
+ * @param p_cfg            In:   The configuration.
+ * @return  The cycle time in nanoseconds.
+ */
+uint64_t soak_cycle_ns(
+   const soak_cfg_t        *p_cfg);
+
+/**
+ * Get the time of the PTCP master clock. It runs cfg.ptcp_drift_ppm faster
+ * than the local clock.
+ * @param p_ctrl           In:   The controller.
+ * @param t_ns             In:   Local time, see soak_now_ns().
+ * @return  The time of the master in nanoseconds.
+ */
+uint64_t soak_controller_ptcp_time(
+   const soak_controller_t *p_ctrl,
+   uint64_t                t_ns);
+
+/**
+ * Initialize the controller and start its receive and cyclic threads.
+ * soak_link_init() must have been called.
+ * @param p_ctrl           Out:  The controller.
+ * @param p_cfg            In:   The configuration.
+ * @param p_device_cfg     In:   The configuration of the device under test.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int soak_controller_init(
+   soak_controller_t       *p_ctrl,
+   const soak_cfg_t        *p_cfg,
+   const pnet_cfg_t        *p_device_cfg);
+
+/**
+ * Assign the station name with DCP Set.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_name           In:   The station name.
+ * @return  0  if the device accepted the name.
+ *          -1 if an error occurred.
+ */
+int soak_controller_dcp_set_name(
+   soak_controller_t       *p_ctrl,
+   const char              *p_name);
+
+/**
+ * Connect an AR and send PrmEnd. The ApplicationReady request from the
+ * device is answered by the receive thread.
+ * @param p_ctrl           InOut: The controller.
+ * @param ix               In:   The AR index.
+ * @return  0  if the device accepted Connect and PrmEnd.
+ *          -1 if an error occurred.
+ */
+int soak_controller_connect(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix);
+
+/**
+ * Forget an AR that the device has aborted, so it can be connected again.
+ * @param p_ctrl           InOut: The controller.
+ * @param ix               In:   The AR index.
+ */
+void soak_controller_reset(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix);
+
+/**
+ * Simulate the loss of the primary controller of an AR set. The primary AR
+ * stops sending, and the backup AR is made primary at once. The time until
+ * the device reports the backup AR as primary is recorded in sr_switchover.
+ * @param p_ctrl           InOut: The controller.
+ * @param pair             In:   The AR set, index of the AR divided by 2.
+ * @return  0  if the failover was started.
+ *          -1 if the backup AR is not in data exchange.
+ */
+int soak_controller_sr_failover(
+   soak_controller_t       *p_ctrl,
+   uint16_t                pair);
+
+/**
+ * Read I&M0 of the first submodule of an AR.
+ * @param p_ctrl           InOut: The controller.
+ * @param ix               In:   The AR index.
+ * @return  0  if the read succeeded.
+ *          -1 if an error occurred.
+ */
+int soak_controller_read(
+   soak_controller_t       *p_ctrl,
+   uint16_t                ix);
+
+/**
+ * Account for a frame delivered to the device. Use as link receive hook.
+ * @param p_ctrl           InOut: The controller.
+ * @param p_frame          In:   The frame.
+ * @param len              In:   Length of the frame.
+ * @param t_ns             In:   When the frame was handed to the stack.
+ */
+void soak_controller_device_rx(
+   soak_controller_t       *p_ctrl,
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint64_t                t_ns);
+
+#endif /* SOAK_CONTROLLER_H */
@@ -0,0 +1,528 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/*
+ * In-process link for pf_soak. Implements the OS layer functions that the
+ * stack calls via mock_* names when built with UNIT_TEST, see mocks.cpp for
+ * the unit test variant.
+ */
+
+#include "soak_link.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+typedef struct soak_socket
+{
+   bool                    in_use;
+   uint16_t                port;
+   os_mbox_t               *p_rx;
+} soak_socket_t;
+
+typedef struct soak_link
+{
+   os_mutex_t              *p_mutex;
+   os_mbox_t               *p_free;          /* Pool of unused messages */
+   os_mbox_t               *p_to_device;     /* Ethernet frames to the stack */
+   os_mbox_t               *p_to_controller; /* Frames and datagrams from the stack */
+   soak_msg_t              *p_pool;
+   soak_socket_t           sockets[SOAK_LINK_MAX_SOCKETS];
+   os_eth_handle_t         eth_handle;
+   os_thread_t             *p_rx_thread;
+   int                     rx_priority;
+   soak_rx_hook_t          rx_hook;
+   volatile uint32_t       drops;
+   uint64_t                rx_time;          /* Of the frame given to the stack */
+} soak_link_t;
+
+static soak_link_t         soak_link;
+
+uint64_t soak_now_ns(void)
+{
+   struct timespec         ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void soak_sleep_until(
+   uint64_t                t_ns)
+{
+   struct timespec         ts;
+
+   ts.tv_sec = t_ns / 1000000000ull;
+   ts.tv_nsec = t_ns % 1000000000ull;
+   while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+   {
+      /* Restart */
+   }
+}
+
+/**
+ * @internal
+ * Get a message from the pool.
+ * @return  The message, or NULL if the pool is empty.
+ */
+static soak_msg_t *soak_link_alloc(void)
+{
+   soak_msg_t              *p_msg = NULL;
+
+   if (os_mbox_fetch(soak_link.p_free, (void **)&p_msg, 0) != 0)
+   {
+      soak_link.drops++;
+      p_msg = NULL;
+   }
+
+   return p_msg;
+}
+
+/**
+ * @internal
+ * Post a message to a queue, or give it back to the pool if the queue
+ * is full.
+ * @param p_mbox           In:   The queue.
+ * @param p_msg            In:   The message.
+ * @return  0  if the message was queued.
+ *          -1 if the message was dropped.
+ */
+static int soak_link_post(
+   os_mbox_t               *p_mbox,
+   soak_msg_t              *p_msg)
+{
+   int                     ret = -1;
+
+   if (os_mbox_post(p_mbox, p_msg, 0) == 0)
+   {
+      ret = 0;
+   }
+   else
+   {
+      soak_link.drops++;
+      soak_link_release(p_msg);
+   }
+
+   return ret;
+}
+
+/**
+ * @internal
+ * Deliver frames from the controller to the stack.
+ *
+ * Works like os_eth_task() in the Linux port: the buffer is given to the
+ * stack, which frees it if the frame was handled.
+ * @param thread_arg       In:   Not used.
+ */
+static void soak_link_rx_task(
+   void                    *thread_arg)
+{
+   soak_msg_t              *p_msg;
+   os_buf_t                *p_buf;
+   int                     handled;
+
+   (void)thread_arg;
+   for (;;)
+   {
+      if (os_mbox_fetch(soak_link.p_to_device, (void **)&p_msg, OS_WAIT_FOREVER) != 0)
+      {
+         continue;
+      }
+
+      p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+      if (p_buf != NULL)
+      {
+         memcpy(p_buf->payload, p_msg->data, p_msg->len);
+         p_buf->len = p_msg->len;
+
+         /* Stamped when delivered, like the software stamps of the kernel */
+         soak_link.rx_time = soak_now_ns();
+         if (soak_link.rx_hook != NULL)
+         {
+            soak_link.rx_hook(p_msg->data, p_msg->len, soak_link.rx_time);
+         }
+
+         handled = 0;
+         if (soak_link.eth_handle.callback != NULL)
+         {
+            handled = soak_link.eth_handle.callback(soak_link.eth_handle.arg, p_buf);
+         }
+         if (handled == 0)
+         {
+            os_buf_free(p_buf);
+         }
+      }
+      else
+      {
+         soak_link.drops++;
+      }
+
+      soak_link_release(p_msg);
+   }
+}
+
+int soak_link_init(
+   int                     priority,
+   soak_rx_hook_t          rx_hook)
+{
+   int                     ret = -1;
+   uint16_t                ix;
+
+   memset(&soak_link, 0, sizeof(soak_link));
+   soak_link.rx_priority = priority;
+   soak_link.rx_hook = rx_hook;
+   soak_link.p_mutex = os_mutex_create();
+   soak_link.p_free = os_mbox_create(SOAK_LINK_QUEUE_SIZE);
+   soak_link.p_to_device = os_mbox_create(SOAK_LINK_QUEUE_SIZE);
+   soak_link.p_to_controller = os_mbox_create(SOAK_LINK_QUEUE_SIZE);
+   soak_link.p_pool = (soak_msg_t *)calloc(SOAK_LINK_QUEUE_SIZE, sizeof(soak_msg_t));
+
+   if ((soak_link.p_mutex != NULL) &&
+       (soak_link.p_free != NULL) &&
+       (soak_link.p_to_device != NULL) &&
+       (soak_link.p_to_controller != NULL) &&
+       (soak_link.p_pool != NULL))
+   {
+      for (ix = 0; ix < SOAK_LINK_QUEUE_SIZE; ix++)
+      {
+         (void)os_mbox_post(soak_link.p_free, &soak_link.p_pool[ix], 0);
+      }
+      ret = 0;
+   }
+
+   return ret;
+}
+
+int soak_link_eth_to_device(
+   const uint8_t           *p_frame,
+   uint16_t                len)
+{
+   int                     ret = -1;
+   soak_msg_t              *p_msg;
+
+   p_msg = soak_link_alloc();
+   if (p_msg != NULL)
+   {
+      p_msg->kind = SOAK_MSG_ETH;
+      p_msg->t_ns = soak_now_ns();
+      p_msg->port = 0;
+      p_msg->len = len;
+      memcpy(p_msg->data, p_frame, len);
+      ret = soak_link_post(soak_link.p_to_device, p_msg);
+   }
+
+   return ret;
+}
+
+int soak_link_udp_to_device(
+   uint16_t                port,
+   const uint8_t           *p_data,
+   uint16_t                len)
+{
+   int                     ret = -1;
+   soak_msg_t              *p_msg;
+   uint16_t                ix;
+
+   os_mutex_lock(soak_link.p_mutex);
+   for (ix = 0; ix < SOAK_LINK_MAX_SOCKETS; ix++)
+   {
+      if ((soak_link.sockets[ix].in_use == true) &&
+          (soak_link.sockets[ix].port == port))
+      {
+         p_msg = soak_link_alloc();
+         if (p_msg != NULL)
+         {
+            p_msg->kind = SOAK_MSG_UDP;
+            p_msg->t_ns = soak_now_ns();
+            p_msg->port = port;
+            p_msg->len = len;
+            memcpy(p_msg->data, p_data, len);
+            ret = soak_link_post(soak_link.sockets[ix].p_rx, p_msg);
+         }
+         break;
+      }
+   }
+   os_mutex_unlock(soak_link.p_mutex);
+
+   return ret;
+}
+
+soak_msg_t *soak_link_from_device(
+   uint32_t                timeout_ms)
+{
+   soak_msg_t              *p_msg = NULL;
+
+   if (os_mbox_fetch(soak_link.p_to_controller, (void **)&p_msg, timeout_ms) != 0)
+   {
+      p_msg = NULL;
+   }
+
+   return p_msg;
+}
+
+void soak_link_release(
+   soak_msg_t              *p_msg)
+{
+   if (p_msg != NULL)
+   {
+      (void)os_mbox_post(soak_link.p_free, p_msg, 0);
+   }
+}
+
+uint32_t soak_link_drops(void)
+{
+   return soak_link.drops;
+}
+
+/************************* OS layer used by the stack ************************/
+
+/* The stack calls these by the names given in its UNIT_TEST sections */
+extern "C"
+{
+
+os_eth_handle_t* mock_os_eth_init(
+   const char              *if_name,
+   os_eth_callback_t       *callback,
+   void                    *arg,
+   const os_thread_cfg_t   *p_thread_cfg)
+{
+   os_eth_handle_t         *handle = NULL;
+
+   (void)if_name;
+   (void)p_thread_cfg;
+   soak_link.eth_handle.callback = callback;
+   soak_link.eth_handle.arg = arg;
+
+   if (soak_link.p_rx_thread == NULL)
+   {
+      soak_link.p_rx_thread = os_thread_create("soak_link_rx", soak_link.rx_priority,
+         4096, soak_link_rx_task, NULL);
+   }
+   if (soak_link.p_rx_thread != NULL)
+   {
+      handle = &soak_link.eth_handle;
+   }
+
+   return handle;
+}
+
+void mock_os_eth_destroy(
+   os_eth_handle_t         *handle)
+{
+   /* Frames are no longer handed to the stack. The link thread is kept. */
+   (void)handle;
+   soak_link.eth_handle.callback = NULL;
+}
+
+int mock_os_eth_send(
+   os_eth_handle_t         *handle,
+   os_buf_t                *p_buf)
+{
+   int                     ret = -1;
+   soak_msg_t              *p_msg;
+
+   (void)handle;
+   p_msg = soak_link_alloc();
+   if (p_msg != NULL)
+   {
+      p_msg->kind = SOAK_MSG_ETH;
+      p_msg->t_ns = soak_now_ns();
+      p_msg->port = 0;
+      p_msg->len = p_buf->len;
+      memcpy(p_msg->data, p_buf->payload, p_buf->len);
+      if (soak_link_post(soak_link.p_to_controller, p_msg) == 0)
+      {
+         ret = p_buf->len;
+      }
+   }
+
+   return ret;
+}
+
+uint64_t mock_os_eth_rx_timestamp(
+   os_eth_handle_t         *handle)
+{
+   (void)handle;
+
+   return soak_link.rx_time;
+}
+
+int mock_os_udp_open(
+   os_ipaddr_t             addr,
+   os_ipport_t             port)
+{
+   int                     ret = -1;
+   uint16_t                ix;
+
+   (void)addr;
+   os_mutex_lock(soak_link.p_mutex);
+   for (ix = 0; ix < SOAK_LINK_MAX_SOCKETS; ix++)
+   {
+      if (soak_link.sockets[ix].in_use == false)
+      {
+         if (soak_link.sockets[ix].p_rx == NULL)
+         {
+            soak_link.sockets[ix].p_rx = os_mbox_create(SOAK_LINK_QUEUE_SIZE / 8);
+         }
+         if (soak_link.sockets[ix].p_rx != NULL)
+         {
+            /*
+             * Several sessions open the same ephemeral port. Give each socket
+             * a port of its own so the controller can reply to the right one.
+             */
+            soak_link.sockets[ix].port = (port == PF_RPC_SERVER_PORT) ?
+               port : (SOAK_LINK_EPHEMERAL_PORT_BASE + ix);
+            soak_link.sockets[ix].in_use = true;
+            ret = ix + 1;     /* The stack treats 0 as an invalid socket */
+         }
+         break;
+      }
+   }
+   os_mutex_unlock(soak_link.p_mutex);
+
+   return ret;
+}
+
+int mock_os_udp_sendto(
+   uint32_t                id,
+   os_ipaddr_t             dst_addr,
+   os_ipport_t             dst_port,
+   const uint8_t           *data,
+   int                     size)
+{
+   int                     ret = -1;
+   soak_msg_t              *p_msg;
+
+   (void)dst_addr;
+   (void)dst_port;
+   if ((id >= 1) && (id <= SOAK_LINK_MAX_SOCKETS) &&
+       (soak_link.sockets[id - 1].in_use == true) &&
+       (size > 0) && (size <= PF_FRAME_BUFFER_SIZE))
+   {
+      p_msg = soak_link_alloc();
+      if (p_msg != NULL)
+      {
+         p_msg->kind = SOAK_MSG_UDP;
+         p_msg->t_ns = soak_now_ns();
+         p_msg->port = soak_link.sockets[id - 1].port;
+         p_msg->len = (uint16_t)size;
+         memcpy(p_msg->data, data, size);
+         if (soak_link_post(soak_link.p_to_controller, p_msg) == 0)
+         {
+            ret = size;
+         }
+      }
+   }
+
+   return ret;
+}
+
+int mock_os_udp_recvfrom(
+   uint32_t                id,
+   os_ipaddr_t             *p_src_addr,
+   os_ipport_t             *p_src_port,
+   uint8_t                 *data,
+   int                     size)
+{
+   int                     ret = 0;
+   soak_msg_t              *p_msg = NULL;
+
+   if ((id >= 1) && (id <= SOAK_LINK_MAX_SOCKETS) &&
+       (soak_link.sockets[id - 1].in_use == true) &&
+       (os_mbox_fetch(soak_link.sockets[id - 1].p_rx, (void **)&p_msg, 0) == 0))
+   {
+      if (p_msg->len <= size)
+      {
+         memcpy(data, p_msg->data, p_msg->len);
+         ret = p_msg->len;
+      }
+      *p_src_addr = SOAK_CONTROLLER_IP;
+      *p_src_port = PF_RPC_SERVER_PORT;
+      soak_link_release(p_msg);
+   }
+
+   return ret;
+}
+
+void mock_os_udp_close(
+   uint32_t                id)
+{
+   soak_msg_t              *p_msg;
+
+   if ((id >= 1) && (id <= SOAK_LINK_MAX_SOCKETS))
+   {
+      os_mutex_lock(soak_link.p_mutex);
+      soak_link.sockets[id - 1].in_use = false;
+      while (os_mbox_fetch(soak_link.sockets[id - 1].p_rx, (void **)&p_msg, 0) == 0)
+      {
+         soak_link_release(p_msg);
+      }
+      os_mutex_unlock(soak_link.p_mutex);
+   }
+}
+
+int mock_os_poll_add(
+   os_poll_t               *poll,
+   uint32_t                id)
+{
+   /* The simulated sockets are not descriptors */
+   (void)poll;
+   (void)id;
+   return 0;
+}
+
+int mock_os_set_ip_suite(
+   const char              *interface_name,
+   bool                    dhcp_enable,
+   os_ipaddr_t             *p_ipaddr,
+   os_ipaddr_t             *p_netmask,
+   os_ipaddr_t             *p_gw,
+   const char              *hostname,
+   bool                    permanent)
+{
+   return 0;
+}
+
+BOOL mock_os_save_nvram_instance(
+   char                    *filePath,
+   void                    *data,
+   int                     len)
+{
+   return TRUE;
+}
+
+int mock_pf_alarm_send_diagnosis(
+   pnet_t                  *net,
+   pf_ar_t                 *p_ar,
+   uint32_t                api_id,
+   uint16_t                slot_nbr,
+   uint16_t                subslot_nbr,
+   pf_diag_item_t          *p_item)
+{
+   /* Diagnosis alarms are part of the load, send them for real */
+   return pf_alarm_send_diagnosis(net, p_ar, api_id, slot_nbr, subslot_nbr, p_item);
+}
+
+void mock_pf_generate_uuid(
+   uint32_t                timestamp,
+   uint32_t                session_number,
+   pnet_ethaddr_t          mac_address,
+   pf_uuid_t               *p_uuid)
+{
+   pf_generate_uuid(timestamp, session_number, mac_address, p_uuid);
+}
+
+} /* extern "C" */
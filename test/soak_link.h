@@ -0,0 +1,144 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef SOAK_LINK_H
+#define SOAK_LINK_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include "pf_includes.h"
+
+/*
+ * In-process link between the p-net stack and the simulated IO-controller
+ * used by pf_soak.
+ *
+ * The stack is built with UNIT_TEST set, so its calls to the OS layer for
+ * raw Ethernet and UDP end up in the mock_* functions implemented in
+ * soak_link.cpp. Frames sent by the stack are timestamped and queued to
+ * the controller. Frames sent by the controller are queued to a device
+ * receive thread, which calls the stack like the Linux os_eth thread does.
+ */
+
+#define SOAK_LINK_QUEUE_SIZE                    512
+#define SOAK_LINK_MAX_SOCKETS                   8
+#define SOAK_LINK_EPHEMERAL_PORT_BASE           0xc000
+
+#define SOAK_CONTROLLER_IP                      0xc0a80101     /* 192.168.1.1 */
+#define SOAK_DEVICE_IP                          0xc0a801ab     /* 192.168.1.171 */
+
+typedef enum soak_msg_kind
+{
+   SOAK_MSG_ETH,
+   SOAK_MSG_UDP,
+} soak_msg_kind_t;
+
+typedef struct soak_msg
+{
+   soak_msg_kind_t         kind;
+   uint64_t                t_ns;       /* When it was put on the link */
+   uint16_t                port;       /* UDP: port of the device socket */
+   uint16_t                len;
+   uint8_t                 data[PF_FRAME_BUFFER_SIZE];
+} soak_msg_t;
+
+/**
+ * Called by the device receive thread just before a frame is handed to
+ * the stack.
+ */
+typedef void (*soak_rx_hook_t)(
+   const uint8_t           *p_frame,
+   uint16_t                len,
+   uint64_t                t_ns);
+
+/**
+ * Read the monotonic clock.
+ * @return  The time in nanoseconds.
+ */
+uint64_t soak_now_ns(void);
+
+/**
+ * Sleep until an absolute time on the monotonic clock.
+ * @param t_ns             In:   The time to wake up, in nanoseconds.
+ */
+void soak_sleep_until(
+   uint64_t                t_ns);
+
+/**
+ * Create the queues and the message pool. Call before pnet_init().
+ * @param priority         In:   Priority of the device receive thread.
+ * @param rx_hook          In:   Optional hook for frames to the device.
+ * @return  0  if the operation succeeded.
+ *          -1 if an error occurred.
+ */
+int soak_link_init(
+   int                     priority,
+   soak_rx_hook_t          rx_hook);
+
+/**
+ * Queue a raw Ethernet frame from the controller to the device.
+ * @param p_frame          In:   The frame, starting with the destination MAC.
+ * @param len              In:   Length of the frame.
+ * @return  0  if the frame was queued.
+ *          -1 if the link is congested and the frame was dropped.
+ */
+int soak_link_eth_to_device(
+   const uint8_t           *p_frame,
+   uint16_t                len);
+
+/**
+ * Queue a UDP datagram from the controller to a device socket.
+ * @param port             In:   Port of the device socket.
+ * @param p_data           In:   The UDP payload.
+ * @param len              In:   Length of the payload.
+ * @return  0  if the datagram was queued.
+ *          -1 if there is no such socket or the link is congested.
+ */
+int soak_link_udp_to_device(
+   uint16_t                port,
+   const uint8_t           *p_data,
+   uint16_t                len);
+
+/**
+ * Wait for the next frame or datagram from the device.
+ * The message must be given back with soak_link_release().
+ * @param timeout_ms       In:   Max time to wait.
+ * @return  The message, or NULL on timeout.
+ */
+soak_msg_t *soak_link_from_device(
+   uint32_t                timeout_ms);
+
+/**
+ * Give back a message fetched with soak_link_from_device().
+ * @param p_msg            In:   The message.
+ */
+void soak_link_release(
+   soak_msg_t              *p_msg);
+
+/**
+ * Get the number of messages dropped because the link was congested.
+ * @return  The number of dropped messages.
+ */
+uint32_t soak_link_drops(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOAK_LINK_H */
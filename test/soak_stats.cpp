@@ -0,0 +1,141 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "soak_stats.h"
+
+#include <string.h>
+
+/**
+ * @internal
+ * Get the bucket of a value.
+ * @param value            In:   The value.
+ * @return  The bucket index.
+ */
+static uint32_t soak_hist_index(
+   uint64_t                value)
+{
+   uint32_t                shift;
+
+   if (value < SOAK_HIST_SUB_COUNT)
+   {
+      return (uint32_t)value;
+   }
+
+   shift = (63 - __builtin_clzll(value)) - SOAK_HIST_SUB_BITS;
+
+   return (shift + 1) * SOAK_HIST_SUB_COUNT +
+      (uint32_t)((value >> shift) - SOAK_HIST_SUB_COUNT);
+}
+
+/**
+ * @internal
+ * Get the largest value that goes into a bucket.
+ * @param ix               In:   The bucket index.
+ * @return  The upper bound of the bucket.
+ */
+static uint64_t soak_hist_upper(
+   uint32_t                ix)
+{
+   uint32_t                shift;
+   uint64_t                base;
+
+   if (ix < SOAK_HIST_SUB_COUNT)
+   {
+      return ix;
+   }
+
+   shift = ix / SOAK_HIST_SUB_COUNT - 1;
+   base = (uint64_t)(ix % SOAK_HIST_SUB_COUNT + SOAK_HIST_SUB_COUNT) << shift;
+
+   return base + ((1ull << shift) - 1);
+}
+
+void soak_hist_init(
+   soak_hist_t             *p_hist)
+{
+   memset(p_hist, 0, sizeof(*p_hist));
+   p_hist->min = UINT64_MAX;
+   p_hist->p_mutex = os_mutex_create();
+}
+
+void soak_hist_record(
+   soak_hist_t             *p_hist,
+   uint64_t                value)
+{
+   os_mutex_lock(p_hist->p_mutex);
+   p_hist->buckets[soak_hist_index(value)]++;
+   p_hist->count++;
+   p_hist->sum += value;
+   if (value < p_hist->min)
+   {
+      p_hist->min = value;
+   }
+   if (value > p_hist->max)
+   {
+      p_hist->max = value;
+   }
+   os_mutex_unlock(p_hist->p_mutex);
+}
+
+uint64_t soak_hist_percentile(
+   soak_hist_t             *p_hist,
+   double                  percentile)
+{
+   uint64_t                ret = 0;
+   uint64_t                target;
+   uint64_t                seen = 0;
+   uint32_t                ix;
+
+   os_mutex_lock(p_hist->p_mutex);
+   if (p_hist->count > 0)
+   {
+      target = (uint64_t)((percentile / 100.0) * p_hist->count + 0.5);
+      if (target < 1)
+      {
+         target = 1;
+      }
+      for (ix = 0; ix < SOAK_HIST_BUCKETS; ix++)
+      {
+         seen += p_hist->buckets[ix];
+         if (seen >= target)
+         {
+            ret = soak_hist_upper(ix);
+            break;
+         }
+      }
+      if (ret > p_hist->max)
+      {
+         ret = p_hist->max;
+      }
+   }
+   os_mutex_unlock(p_hist->p_mutex);
+
+   return ret;
+}
+
+void soak_hist_print(
+   FILE                    *p_file,
+   const char              *name,
+   soak_hist_t             *p_hist)
+{
+   fprintf(p_file, "  %-22s n=%-10llu p50=%9.1f p99=%9.1f p99.9=%9.1f p99.99=%9.1f max=%9.1f us\n",
+      name,
+      (unsigned long long)p_hist->count,
+      soak_hist_percentile(p_hist, 50.0) / 1000.0,
+      soak_hist_percentile(p_hist, 99.0) / 1000.0,
+      soak_hist_percentile(p_hist, 99.9) / 1000.0,
+      soak_hist_percentile(p_hist, 99.99) / 1000.0,
+      p_hist->max / 1000.0);
+}
@@ -0,0 +1,83 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef SOAK_STATS_H
+#define SOAK_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "osal.h"
+
+/*
+ * Log-linear histogram for latencies in nanoseconds.
+ *
+ * Each power of two is split into SOAK_HIST_SUB_COUNT buckets, so a
+ * percentile is reported with at most 1/SOAK_HIST_SUB_COUNT relative error
+ * while the histogram stays a fixed size for any run time.
+ */
+#define SOAK_HIST_SUB_BITS                      5
+#define SOAK_HIST_SUB_COUNT                     (1u << SOAK_HIST_SUB_BITS)
+#define SOAK_HIST_BUCKETS                       ((64 - SOAK_HIST_SUB_BITS + 1) * SOAK_HIST_SUB_COUNT)
+
+typedef struct soak_hist
+{
+   os_mutex_t              *p_mutex;
+   uint64_t                count;
+   uint64_t                sum;
+   uint64_t                min;
+   uint64_t                max;
+   uint64_t                buckets[SOAK_HIST_BUCKETS];
+} soak_hist_t;
+
+/**
+ * Initialize a histogram.
+ * @param p_hist           Out:  The histogram.
+ */
+void soak_hist_init(
+   soak_hist_t             *p_hist);
+
+/**
+ * Add a sample. May be called from any thread.
+ * @param p_hist           InOut: The histogram.
+ * @param value            In:   The sample, in nanoseconds.
+ */
+void soak_hist_record(
+   soak_hist_t             *p_hist,
+   uint64_t                value);
+
+/**
+ * Get a percentile.
+ * @param p_hist           In:   The histogram.
+ * @param percentile       In:   0.0 .. 100.0
+ * @return  The upper bound of the bucket holding the percentile, capped
+ *          to the max sample. 0 if there are no samples.
+ */
+uint64_t soak_hist_percentile(
+   soak_hist_t             *p_hist,
+   double                  percentile);
+
+/**
+ * Print count, p50, p99, p99.9, p99.99 and max on one line, in microseconds.
+ * @param p_file           In:   Where to print.
+ * @param name             In:   Label for the line.
+ * @param p_hist           In:   The histogram.
+ */
+void soak_hist_print(
+   FILE                    *p_file,
+   const char              *name,
+   soak_hist_t             *p_hist);
+
+#endif /* SOAK_STATS_H */
@@ -378,7 +378,8 @@ TEST_F (CmdevUnitTest, CmdevCheckArType)
    {
       ret = pf_cmdev_check_ar_type(ar_type);
 
-      if (ar_type == PF_ART_IOCAR_SINGLE || ar_type == PF_ART_IOSAR)
+      if (ar_type == PF_ART_IOCAR_SINGLE || ar_type == PF_ART_IOSAR ||
+          (PNET_OPTION_SR && ar_type == PF_ART_IOCAR_SR))
       {
          EXPECT_EQ (0, ret);
       }
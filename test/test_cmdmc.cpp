@@ -21,9 +21,71 @@
 #include <gtest/gtest.h>
 
 
-class CmdmcTest : public PnetIntegrationTest {};
+class CmdmcTest : public PnetIntegrationTest
+{
+protected:
+   pf_ar_t                 ar;
+
+   /* An AR with an output CR and a multicast consumer CR */
+   void ar_init()
+   {
+      memset(&ar, 0, sizeof(ar));
+      ar.nbr_iocrs = 2;
+      ar.iocrs[0].param.iocr_type = PF_IOCR_TYPE_OUTPUT;
+      ar.iocrs[0].param.iocr_reference = 1;
+      ar.iocrs[1].param.iocr_type = PF_IOCR_TYPE_MC_CONSUMER;
+      ar.iocrs[1].param.iocr_reference = 2;
+      ar.iocrs[1].crep = 1;
+      ar.iocrs[1].p_ar = &ar;
+      ar.nbr_mcr = 1;
+      ar.mcr_request[0].iocr_reference = 2;
+      ar.mcr_request[0].mci_timeout_factor = 100;     /* 10 s */
+   }
+};
 
 
 TEST_F (CmdmcTest, CmdmcRunTest)
 {
 }
+
+TEST_F (CmdmcTest, CmdmcShouldStopMciTimerOnFirstFrame)
+{
+   ar_init();
+
+   ASSERT_EQ(0, pf_cmdmc_activate_req(net, &ar));
+   EXPECT_EQ(PF_CMDMC_STATE_IDLE, ar.iocrs[0].cmdmc_state);
+   EXPECT_EQ(PF_CMDMC_STATE_W_FRAME, ar.iocrs[1].cmdmc_state);
+   EXPECT_NE(UINT32_MAX, ar.iocrs[1].cmdmc_timer);
+
+   /* Only the multicast consumer CR is supervised */
+   EXPECT_EQ(0, pf_cmdmc_cpm_state_ind(net, &ar, 0, true));
+   EXPECT_EQ(PF_CMDMC_STATE_IDLE, ar.iocrs[0].cmdmc_state);
+
+   EXPECT_EQ(0, pf_cmdmc_cpm_state_ind(net, &ar, 1, true));
+   EXPECT_EQ(PF_CMDMC_STATE_RUN, ar.iocrs[1].cmdmc_state);
+   EXPECT_EQ(UINT32_MAX, ar.iocrs[1].cmdmc_timer);
+
+   EXPECT_EQ(0, pf_cmdmc_close_req(net, &ar));
+   EXPECT_EQ(PF_CMDMC_STATE_IDLE, ar.iocrs[1].cmdmc_state);
+}
+
+TEST_F (CmdmcTest, CmdmcShouldStopMciTimerOnClose)
+{
+   ar_init();
+
+   ASSERT_EQ(0, pf_cmdmc_activate_req(net, &ar));
+   EXPECT_NE(UINT32_MAX, ar.iocrs[1].cmdmc_timer);
+
+   EXPECT_EQ(0, pf_cmdmc_close_req(net, &ar));
+   EXPECT_EQ(PF_CMDMC_STATE_IDLE, ar.iocrs[1].cmdmc_state);
+   EXPECT_EQ(UINT32_MAX, ar.iocrs[1].cmdmc_timer);
+}
+
+TEST_F (CmdmcTest, CmdmcShouldRequireMcrBlock)
+{
+   ar_init();
+   ar.mcr_request[0].iocr_reference = 3;
+
+   EXPECT_EQ(-1, pf_cmdmc_activate_req(net, &ar));
+   EXPECT_EQ(UINT32_MAX, ar.iocrs[1].cmdmc_timer);
+}
@@ -32,6 +32,7 @@
 #include "mocks.h"
 
 #include "pf_includes.h"
+#include "pf_block_writer.h"
 
 #include <gtest/gtest.h>
 
@@ -228,6 +229,9 @@ TEST_F (CmrdrTest, CmrdrRunTest)
    uint16_t                ch_properties = 0;
    const uint16_t          slot = 1;
    const uint16_t          subslot = 1;
+   uint8_t                 record[64];
+   uint16_t                pos;
+   uint16_t                full_len;
 
    printf("\nGenerating mock connection request\n");
    mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
@@ -294,6 +298,15 @@ TEST_F (CmrdrTest, CmrdrRunTest)
    /* Send data to avoid timeout */
    send_data(net, &appdata.data_cycle_ctr, data_packet_good_iops_good_iocs, sizeof(data_packet_good_iops_good_iocs));
 
+   printf("\nThe output data record is left out if the whole block does not fit\n");
+   pos = 0;
+   pf_put_output_data(net, true, TEST_API_IDENT, slot, subslot, sizeof(record), record, &pos);
+   EXPECT_GT(pos, 12 + 8);    /* Header, flag, lengths, and the SubstituteValue header and mode */
+   full_len = pos;
+   pos = 0;
+   pf_put_output_data(net, true, TEST_API_IDENT, slot, subslot, full_len - 1, record, &pos);
+   EXPECT_EQ(pos, 0);
+
    printf("\nCreate a logbook entry\n");
    pnet_create_log_book_entry(net, appdata.main_arep, &pnio_status, 0x13245768);
 
@@ -426,3 +439,67 @@ TEST_F (CmrdrTest, CmrdrModDiffTest)
    EXPECT_EQ(appdata.call_counters.state_calls, 5);
    EXPECT_EQ(appdata.cmdev_state, PNET_EVENT_ABORT);
 }
+
+TEST_F (CmrdrTest, CmrdrIdentCacheTest)
+{
+   int                     ret;
+   uint8_t                 res_before[200];
+   uint8_t                 res_plugged[200];
+   uint8_t                 res[200];
+   uint16_t                pos_before = 0;
+   uint16_t                pos_plugged = 0;
+   uint16_t                pos = 0;
+   const uint16_t          slot = 2;
+   uint32_t                hits;
+
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res_before), res_before, &pos_before);
+   hits = net->cmdev_device.ident_cache_hits;
+
+   /* A repeated read gives the same response */
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res), res, &pos);
+   EXPECT_EQ(pos, pos_before);
+   EXPECT_EQ(memcmp(res, res_before, pos), 0);
+   EXPECT_EQ(net->cmdev_device.ident_cache_hits, hits + 1);
+
+   /* Plugging invalidates the cached response */
+   ret = pnet_plug_module(net, TEST_API_IDENT, slot, TEST_MOD_8_8_IDENT);
+   EXPECT_EQ(ret, 0);
+   ret = pnet_plug_submodule(net, TEST_API_IDENT, slot, 1, TEST_MOD_8_8_IDENT,
+      TEST_SUBMOD_CUSTOM_IDENT, PNET_DIR_IO, 1, 1);
+   EXPECT_EQ(ret, 0);
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res_plugged), res_plugged, &pos_plugged);
+   EXPECT_GT(pos_plugged, pos_before);
+   EXPECT_EQ(net->cmdev_device.ident_cache_hits, hits + 1);
+
+   /* Truncated by the end of the buffer. Must not be cached */
+   pos = sizeof(res) - pos_plugged + 1;
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res), res, &pos);
+   EXPECT_EQ(net->cmdev_device.ident_cache_hits, hits + 1);
+
+   pos = 0;
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res), res, &pos);
+   EXPECT_EQ(pos, pos_plugged);
+   EXPECT_EQ(memcmp(res, res_plugged, pos), 0);
+   EXPECT_EQ(net->cmdev_device.ident_cache_hits, hits + 2);
+
+   /* Pulling restores the original response */
+   ret = pnet_pull_module(net, TEST_API_IDENT, slot);
+   EXPECT_EQ(ret, 0);
+   pos = 0;
+   pf_put_ident_data(net, true, PNET_BLOCK_VERSION_LOW_1, PF_BT_REAL_IDENTIFICATION_DATA,
+      PF_DEV_FILTER_LEVEL_DEVICE, PF_DEV_FILTER_LEVEL_SUBSLOT, NULL, 0, 0, 0,
+      sizeof(res), res, &pos);
+   EXPECT_EQ(pos, pos_before);
+   EXPECT_EQ(memcmp(res, res_before, pos), 0);
+   EXPECT_EQ(net->cmdev_device.ident_cache_hits, hits + 2);
+}
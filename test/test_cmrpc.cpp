@@ -76,6 +76,12 @@ static uint8_t connect_req[] =
  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x03, 0x00, 0x02, 0x00, 0xc8, 0xc0, 0x00, 0xa0, 0x00
 };
 
+/* ARRPCBlockReq, with InitiatorRPCServerPort 0x0400. Appended to connect_req. */
+static const uint8_t ar_rpc_block_req[] =
+{
+ 0x01, 0x07, 0x00, 0x04, 0x01, 0x00, 0x04, 0x00
+};
+
 static uint8_t release_req[] =
 {
                                                              0x04, 0x00, 0x28, 0x00, 0x10, 0x00,
@@ -629,6 +635,47 @@ TEST_F (CmrpcTest, CmrpcConnectReleaseIOSAR_DA)
    EXPECT_EQ(appdata.cmdev_state, PNET_EVENT_ABORT);
 }
 
+TEST_F (CmrpcTest, CmrpcCachedConnectShouldGiveSameResponse)
+{
+   uint8_t                 req[sizeof(connect_req) + sizeof(ar_rpc_block_req)];
+   uint8_t                 first_rsp[PF_FRAME_BUFFER_SIZE];
+   uint16_t                first_len;
+   uint16_t                body_len = 390 + sizeof(ar_rpc_block_req);
+   uint16_t                args_len = 370 + sizeof(ar_rpc_block_req);
+
+   /* connect_req with an ARRPCBlockReq, in the fragment and NDR lengths too */
+   memcpy(req, connect_req, sizeof(connect_req));
+   memcpy(&req[sizeof(connect_req)], ar_rpc_block_req, sizeof(ar_rpc_block_req));
+   req[74] = body_len & 0xff;
+   req[75] = body_len >> 8;
+   req[84] = args_len & 0xff;
+   req[85] = args_len >> 8;
+   req[96] = args_len & 0xff;
+   req[97] = args_len >> 8;
+
+   mock_set_os_udp_recvfrom_buffer(req, sizeof(req));
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(appdata.call_counters.connect_calls, 1);
+   EXPECT_EQ(net->fsu.misses, 1u);
+   EXPECT_EQ(net->fsu.hits, 0u);
+   ASSERT_EQ(mock_os_data.udp_sendto_count, 1);
+   first_len = mock_os_data.udp_sendto_len;
+   memcpy(first_rsp, mock_os_data.udp_sendto_copy, first_len);
+
+   mock_set_os_udp_recvfrom_buffer(release_req, sizeof(release_req));
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(appdata.call_counters.release_calls, 1);
+
+   /* The same request again is served from the fast-startup cache */
+   mock_set_os_udp_recvfrom_buffer(req, sizeof(req));
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(appdata.call_counters.connect_calls, 2);
+   EXPECT_EQ(net->fsu.hits, 1u);
+   ASSERT_EQ(mock_os_data.udp_sendto_count, 3);
+   ASSERT_EQ(mock_os_data.udp_sendto_len, first_len);
+   EXPECT_EQ(memcmp(mock_os_data.udp_sendto_copy, first_rsp, first_len), 0);
+}
+
 TEST_F (CmrpcUnitTest, CmrpcCheckGenerateUuid)
 {
    uint32_t                timestamp;
@@ -0,0 +1,201 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+
+#define CMSR_TEST_SLOT           1
+#define CMSR_TEST_SUBSLOT        1
+
+class CmsrTest : public PnetIntegrationTest
+{
+protected:
+   virtual void SetUp() override
+   {
+      PnetIntegrationTest::SetUp();
+
+      /* The ARs below are not known to the rest of the stack */
+      os_timer_stop(appdata.periodic_timer);
+
+      p_ar_a = pf_ar_find_by_index(net, 0);
+      p_ar_b = pf_ar_find_by_index(net, 1);
+      init_ar(p_ar_a, 1);
+      init_ar(p_ar_b, 2);
+
+      ASSERT_EQ(pnet_plug_module(net, 0, CMSR_TEST_SLOT, 0x32), 0);
+      ASSERT_EQ(pnet_plug_submodule(net, 0, CMSR_TEST_SLOT, CMSR_TEST_SUBSLOT, 0x32, 1,
+         PNET_DIR_IO, 1, 1), 0);
+      ASSERT_EQ(pf_cmdev_get_subslot_full(net, 0, CMSR_TEST_SLOT, CMSR_TEST_SUBSLOT, &p_subslot), 0);
+      p_subslot->p_ar = p_ar_a;
+   };
+
+   virtual void TearDown() override
+   {
+      p_subslot->p_ar = NULL;
+      p_ar_a->in_use = false;
+      p_ar_b->in_use = false;
+   };
+
+   /* An SR AR with an input and an output CR. The selector is the AREP. */
+   void init_ar(
+      pf_ar_t              *p_ar,
+      uint32_t             arep)
+   {
+      const pf_uuid_t      object_uuid =
+         { 0xdea00000, 0x6c97, 0x11d1, { 0x82, 0x71, 0x00, 0x01, 0xf0, 0x00, 0x00, 0x01 } };
+      const pf_uuid_t      ar_uuid =
+         { 0x12345678, 0x9abc, 0xdef0, { 0x12, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+
+      memset(p_ar, 0, sizeof(*p_ar));
+      p_ar->in_use = true;
+      p_ar->arep = arep;
+      p_ar->ar_state = PF_AR_STATE_PRIMARY;
+      p_ar->ar_param.ar_type = PF_ART_IOCAR_SR;
+      p_ar->ar_param.cm_initiator_object_uuid = object_uuid;
+      p_ar->ar_param.ar_uuid = ar_uuid;
+      p_ar->ar_param.ar_uuid.data4[7] = (uint8_t)arep;
+      p_ar->sr_info.valid = true;
+      p_ar->nbr_iocrs = 2;
+      p_ar->iocrs[0].param.iocr_type = PF_IOCR_TYPE_INPUT;
+      p_ar->iocrs[1].param.iocr_type = PF_IOCR_TYPE_OUTPUT;
+   };
+
+   /* A frame from the CPM, and the scheduler run that follows */
+   void state_ind(
+      pf_ar_t              *p_ar,
+      bool                 primary)
+   {
+      pf_cmsr_cpm_state_ind(net, p_ar, primary);
+      pf_scheduler_tick(net);
+   };
+
+   pf_ar_t                 *p_ar_a;
+   pf_ar_t                 *p_ar_b;
+   pf_subslot_t            *p_subslot;
+};
+
+
+TEST_F (CmsrTest, CmsrSecondArOfSetIsBackup)
+{
+   pf_ar_t                 *p_other;
+   uint16_t                ix = 0;
+
+   pf_cmsr_connect_ind(net, p_ar_b);
+   EXPECT_EQ(p_ar_b->ar_state, PF_AR_STATE_BACKUP);
+   EXPECT_EQ(p_ar_a->ar_state, PF_AR_STATE_PRIMARY);
+
+   p_other = pf_cmsr_get_next(net, p_ar_a, &ix);
+   EXPECT_EQ(p_other, p_ar_b);
+   EXPECT_EQ(pf_cmsr_get_next(net, p_ar_a, &ix), (pf_ar_t *)NULL);
+}
+
+TEST_F (CmsrTest, CmsrOtherSetIsIgnored)
+{
+   uint16_t                ix = 0;
+
+   /* The same CMInitiatorObjectUUID, but the ARUUID differs outside the selector */
+   p_ar_b->ar_param.ar_uuid.data4[1] = 0x35;
+   pf_cmsr_connect_ind(net, p_ar_b);
+   EXPECT_EQ(p_ar_b->ar_state, PF_AR_STATE_PRIMARY);
+   EXPECT_EQ(pf_cmsr_get_next(net, p_ar_a, &ix), (pf_ar_t *)NULL);
+
+   /* No SRInfoBlock */
+   p_ar_b->ar_param.ar_uuid.data4[1] = p_ar_a->ar_param.ar_uuid.data4[1];
+   p_ar_b->sr_info.valid = false;
+   ix = 0;
+   EXPECT_EQ(pf_cmsr_get_next(net, p_ar_a, &ix), (pf_ar_t *)NULL);
+
+   /* Not an SR AR */
+   p_ar_b->sr_info.valid = true;
+   p_ar_b->ar_param.ar_type = PF_ART_IOCAR_SINGLE;
+   ix = 0;
+   EXPECT_EQ(pf_cmsr_get_next(net, p_ar_a, &ix), (pf_ar_t *)NULL);
+}
+
+TEST_F (CmsrTest, CmsrSwitchoverOnPrimaryState)
+{
+   pnet_sr_status_t        status;
+
+   pf_cmsr_connect_ind(net, p_ar_b);
+
+   /* The backup controller stays backup */
+   state_ind(p_ar_b, false);
+   state_ind(p_ar_a, true);
+   EXPECT_EQ(p_ar_b->ar_state, PF_AR_STATE_BACKUP);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_a);
+   pf_cmsr_get_status(net, &status);
+   EXPECT_EQ(status.switchovers, 0u);
+
+   /* The RX thread only posts the switchover */
+   pf_cmsr_cpm_state_ind(net, p_ar_b, true);
+   pf_cmsr_cpm_state_ind(net, p_ar_b, true);
+   EXPECT_EQ(p_ar_b->ar_state, PF_AR_STATE_BACKUP);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_a);
+
+   pf_scheduler_tick(net);
+   EXPECT_EQ(p_ar_b->ar_state, PF_AR_STATE_PRIMARY);
+   EXPECT_EQ(p_ar_a->ar_state, PF_AR_STATE_BACKUP);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_b);
+   EXPECT_NE(p_ar_b->iocrs[0].ppm.data_status & BIT(PNET_DATA_STATUS_BIT_STATE), 0);
+   EXPECT_EQ(p_ar_a->iocrs[0].ppm.data_status & BIT(PNET_DATA_STATUS_BIT_STATE), 0);
+   EXPECT_EQ(p_ar_b->iocrs[1].ppm.data_status, 0);
+
+   pf_cmsr_get_status(net, &status);
+   EXPECT_EQ(status.switchovers, 1u);
+   EXPECT_EQ(status.primary_arep, 2);
+   EXPECT_NE(status.last_switchover, 0u);
+
+   /* Repeated frames do not switch again */
+   state_ind(p_ar_b, true);
+   pf_cmsr_get_status(net, &status);
+   EXPECT_EQ(status.switchovers, 1u);
+}
+
+TEST_F (CmsrTest, CmsrBackupStateKeepsSubmodules)
+{
+   pf_cmsr_connect_ind(net, p_ar_b);
+
+   state_ind(p_ar_a, false);
+   EXPECT_EQ(p_ar_a->ar_state, PF_AR_STATE_BACKUP);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_a);
+
+   state_ind(p_ar_a, true);
+   EXPECT_EQ(p_ar_a->ar_state, PF_AR_STATE_PRIMARY);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_a);
+}
+
+TEST_F (CmsrTest, CmsrPrimaryLossHandsOver)
+{
+   pnet_sr_status_t        status;
+
+   pf_cmsr_connect_ind(net, p_ar_b);
+
+   pf_cmsr_ar_abort(net, p_ar_a);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_b);
+   pf_cmsr_get_status(net, &status);
+   EXPECT_EQ(status.primary_losses, 1u);
+
+   /* The last AR of the set keeps the submodules until cmdev clears them */
+   p_ar_a->in_use = false;
+   pf_cmsr_ar_abort(net, p_ar_b);
+   EXPECT_EQ(p_subslot->p_ar, p_ar_b);
+   pf_cmsr_get_status(net, &status);
+   EXPECT_EQ(status.primary_losses, 1u);
+}
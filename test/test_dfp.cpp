@@ -0,0 +1,219 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+
+#define DFP_TEST_FRAME_ID_POS    16       /* After the MAC addresses, VLAN tag and EtherType */
+#define DFP_TEST_FRAME_ID        0x0180
+#define DFP_TEST_C_SDU_LENGTH    40
+
+class DfpTest : public PnetIntegrationTest {};
+
+class DfpUnitTest : public PnetUnitTest
+{
+protected:
+   virtual void SetUp() override
+   {
+      pf_dfp_init();
+
+      memset(frame, 0, sizeof(frame));
+      memset(frame, 0x11, 6);                /* Destination */
+      memset(&frame[6], 0x22, 6);            /* Source */
+      frame[12] = 0x81;                      /* VLAN */
+      frame[14] = 0x88;                      /* Profinet */
+      frame[15] = 0x92;
+      frame[DFP_TEST_FRAME_ID_POS] = DFP_TEST_FRAME_ID >> 8;
+      frame[DFP_TEST_FRAME_ID_POS + 1] = DFP_TEST_FRAME_ID & 0xff;
+      frame_len = DFP_TEST_FRAME_ID_POS + 2 + DFP_TEST_C_SDU_LENGTH + 4;
+
+      /* The second subframe, after a subframe with 6 bytes of data */
+      memset(&sf, 0, sizeof(sf));
+      sf.active = true;
+      sf.offset = PF_DFP_HEADER_SIZE + PF_DFP_SUBFRAME_HEADER_SIZE + 6 + PF_DFP_SUBFRAME_CRC_SIZE;
+      sf.position = 2;
+      sf.length = 5;
+   };
+
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                frame_len;
+   pf_dfp_subframe_t       sf;
+};
+
+/* Bit by bit reference */
+static uint16_t dfp_test_crc16(
+   uint16_t                crc,
+   const uint8_t           *p_data,
+   uint16_t                len)
+{
+   uint16_t                bit;
+
+   while (len-- > 0)
+   {
+      crc ^= (uint16_t)(*p_data++) << 8;
+      for (bit = 0; bit < 8; bit++)
+      {
+         crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x755b) : (uint16_t)(crc << 1);
+      }
+   }
+
+   return crc;
+}
+
+TEST_F (DfpUnitTest, DfpCrc16ShouldMatchReference)
+{
+   const uint8_t           check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+   uint8_t                 data[256];
+   uint16_t                ix;
+
+   EXPECT_EQ(pf_dfp_crc16(0, check, sizeof(check)), 0x20fe);
+
+   for (ix = 0; ix < sizeof(data); ix++)
+   {
+      data[ix] = (uint8_t)(ix * 7 + 3);
+   }
+   EXPECT_EQ(pf_dfp_crc16(0, data, sizeof(data)), dfp_test_crc16(0, data, sizeof(data)));
+   EXPECT_EQ(pf_dfp_crc16(0x1234, data, 17), dfp_test_crc16(0x1234, data, 17));
+
+   /* In pieces */
+   EXPECT_EQ(pf_dfp_crc16(pf_dfp_crc16(0, data, 100), &data[100], 156),
+             pf_dfp_crc16(0, data, sizeof(data)));
+}
+
+TEST_F (DfpUnitTest, DfpShouldUnpackPackedSubframe)
+{
+   const uint8_t           data[] = { 0xa1, 0xa2, 0xa3, 0xa4, 0x80 };
+   uint8_t                 data_status = 0;
+   uint16_t                data_pos = pf_dfp_data_pos(&sf, DFP_TEST_FRAME_ID_POS);
+
+   EXPECT_EQ(data_pos, DFP_TEST_FRAME_ID_POS + 2 + sf.offset + PF_DFP_SUBFRAME_HEADER_SIZE);
+
+   pf_dfp_put_header(frame, DFP_TEST_FRAME_ID_POS);
+   memcpy(&frame[data_pos], data, sizeof(data));
+   pf_dfp_put_subframe(&sf, frame, DFP_TEST_FRAME_ID_POS, 0x1234, 0x35);
+
+   EXPECT_EQ(frame[data_pos - 4], 2);       /* Position */
+   EXPECT_EQ(frame[data_pos - 3], 5);       /* Length */
+   EXPECT_EQ(frame[data_pos - 2], 0x34);    /* Cycle counter */
+   EXPECT_EQ(frame[data_pos - 1], 0x35);    /* Data status */
+
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), 0);
+   EXPECT_EQ(data_status, 0x35);
+   EXPECT_EQ(memcmp(&frame[data_pos], data, sizeof(data)), 0);
+
+   /* A frame without SFCRC16 is accepted */
+   frame[DFP_TEST_FRAME_ID_POS + 2] = 0;
+   frame[DFP_TEST_FRAME_ID_POS + 3] = 0;
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), 0);
+}
+
+TEST_F (DfpUnitTest, DfpShouldRejectBadSubframe)
+{
+   uint8_t                 data_status = 0;
+   uint16_t                data_pos = pf_dfp_data_pos(&sf, DFP_TEST_FRAME_ID_POS);
+   pf_dfp_subframe_t       other = sf;
+
+   pf_dfp_put_header(frame, DFP_TEST_FRAME_ID_POS);
+   pf_dfp_put_subframe(&sf, frame, DFP_TEST_FRAME_ID_POS, 1, 0x35);
+   ASSERT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), 0);
+
+   /* Data */
+   frame[data_pos + 1] ^= 0x01;
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), -1);
+   frame[data_pos + 1] ^= 0x01;
+
+   /* Frame header */
+   frame[0] ^= 0x01;
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), -1);
+   frame[0] ^= 0x01;
+
+   /* Position and length */
+   other.position = 3;
+   EXPECT_EQ(pf_dfp_check_frame(&other, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), -1);
+   other = sf;
+   other.length = 4;
+   EXPECT_EQ(pf_dfp_check_frame(&other, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), -1);
+
+   /* Shortened frame */
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS,
+      data_pos + sf.length + PF_DFP_SUBFRAME_CRC_SIZE + 3, &data_status), -1);
+   EXPECT_EQ(pf_dfp_check_frame(&sf, frame, DFP_TEST_FRAME_ID_POS,
+      data_pos + sf.length + PF_DFP_SUBFRAME_CRC_SIZE + 4, &data_status), 0);
+
+   /* Not a DFP IOCR */
+   other = sf;
+   other.active = false;
+   EXPECT_EQ(pf_dfp_check_frame(&other, frame, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), -1);
+}
+
+TEST_F (DfpTest, DfpPpmShouldPackIntoSubframe)
+{
+   pf_ppm_t                ppm;
+   pf_dfp_subframe_t       sf;
+   uint8_t                 *p_payload;
+   uint8_t                 data_status = 0;
+   uint16_t                ix;
+   uint16_t                frame_len;
+
+   memset(&ppm, 0, sizeof(ppm));
+   memset(&sf, 0, sizeof(sf));
+   sf.active = true;
+   sf.offset = PF_DFP_HEADER_SIZE;
+   sf.position = 1;
+   sf.length = 8;
+
+   if (net->ppm_buf_lock == NULL)
+   {
+      net->ppm_buf_lock = os_mutex_create();
+   }
+
+   ppm.dfp = sf;
+   ppm.buffer_pos = DFP_TEST_FRAME_ID_POS + 2;
+   ppm.send_clock_factor = 32;
+   ppm.reduction_ratio = 1;
+   ppm.data_status = 0x35;
+   frame_len = ppm.buffer_pos + DFP_TEST_C_SDU_LENGTH + 4;
+   ppm.cycle_counter_offset = ppm.buffer_pos + DFP_TEST_C_SDU_LENGTH;
+   ppm.data_status_offset = ppm.cycle_counter_offset + 2;
+   ppm.transfer_status_offset = ppm.data_status_offset + 1;
+   for (ix = 0; ix < sf.length; ix++)
+   {
+      ppm.buffer_data[ix] = (uint8_t)(0x40 + ix);
+   }
+
+   ppm.p_send_buffer = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   ASSERT_NE(ppm.p_send_buffer, nullptr);
+   p_payload = (uint8_t *)((os_buf_t *)ppm.p_send_buffer)->payload;
+   memset(p_payload, 0, frame_len);
+   p_payload[DFP_TEST_FRAME_ID_POS] = DFP_TEST_FRAME_ID >> 8;
+   p_payload[DFP_TEST_FRAME_ID_POS + 1] = DFP_TEST_FRAME_ID & 0xff;
+   pf_dfp_put_header(p_payload, DFP_TEST_FRAME_ID_POS);
+
+   pf_ppm_finish_buffer(net, &ppm, DFP_TEST_C_SDU_LENGTH);
+
+   EXPECT_EQ(pf_dfp_check_frame(&sf, p_payload, DFP_TEST_FRAME_ID_POS, frame_len, &data_status), 0);
+   EXPECT_EQ(data_status, 0x35);
+   EXPECT_EQ(memcmp(&p_payload[pf_dfp_data_pos(&sf, DFP_TEST_FRAME_ID_POS)], ppm.buffer_data, sf.length), 0);
+
+   /* Nothing after the subframe */
+   EXPECT_EQ(p_payload[pf_dfp_data_pos(&sf, DFP_TEST_FRAME_ID_POS) + sf.length + PF_DFP_SUBFRAME_CRC_SIZE], 0);
+
+   os_buf_free((os_buf_t *)ppm.p_send_buffer);
+}
@@ -35,6 +35,21 @@
 class DiagTest : public PnetIntegrationTest {};
 
 
+static uint16_t count_free_diag_items(pnet_t *net)
+{
+   uint16_t ix = net->cmdev_device.diag_items_free;
+   uint16_t count = 0;
+
+   while (ix != PF_DIAG_IX_NULL)
+   {
+      count++;
+      ix = net->cmdev_device.diag_items[ix].next;
+   }
+
+   return count;
+}
+
+
 static uint8_t connect_req[] =
 {
                                                              0x04, 0x00, 0x28, 0x00, 0x10, 0x00,
@@ -131,6 +146,9 @@ TEST_F (DiagTest, DiagRunTest)
    uint16_t                ch_properties = 0;
    const uint16_t          slot = 1;
    const uint16_t          subslot = 1;
+   uint16_t                free_items;
+   pnet_alarm_spec_t       alarm_spec = { 0 };
+   pf_diag_item_t          diag_item;
 
    printf("\nGenerating mock connection request\n");
    mock_set_os_udp_recvfrom_buffer(connect_req, sizeof(connect_req));
@@ -298,6 +316,43 @@ TEST_F (DiagTest, DiagRunTest)
    ret = pnet_diag_remove(net, appdata.main_arep, TEST_API_IDENT, slot, subslot, 0, ch_properties, 0x0002, 0x1234);
    EXPECT_EQ(ret, 0);
 
+   printf("Add and remove diag entries on many channels\n");
+   free_items = count_free_diag_items(net);
+   alarm_spec.channel_diagnosis = true;
+   PNET_DIAG_CH_PROP_MAINT_SET(ch_properties, PNET_DIAG_CH_PROP_MAINT_FAULT);
+   for (ix = 0; ix < 50; ix++)
+   {
+      ret = pnet_diag_add(net, appdata.main_arep, TEST_API_IDENT, slot, subslot, ix, ch_properties, 0x0001, 0x0002, ix, 0,
+         PF_USI_EXTENDED_CHANNEL_DIAGNOSIS, &alarm_spec, NULL);
+      EXPECT_EQ(ret, 0);
+   }
+   EXPECT_EQ(count_free_diag_items(net), free_items - 50);
+
+   for (ix = 0; ix < 50; ix++)
+   {
+      ret = pf_diag_get(net, NULL, TEST_API_IDENT, slot, subslot, ix, ch_properties, 0x0001,
+         PF_USI_EXTENDED_CHANNEL_DIAGNOSIS, &diag_item);
+      EXPECT_EQ(ret, 0);
+      EXPECT_EQ(diag_item.fmt.std.ch_nbr, ix);
+      EXPECT_EQ(diag_item.fmt.std.ext_ch_add_value, ix);
+   }
+   ret = pf_diag_get(net, NULL, TEST_API_IDENT, slot, subslot, 50, ch_properties, 0x0001,
+      PF_USI_EXTENDED_CHANNEL_DIAGNOSIS, &diag_item);
+   EXPECT_EQ(ret, -1);
+
+   /* Remove in a different order than added */
+   for (ix = 0; ix < 50; ix += 2)
+   {
+      (void)pnet_diag_remove(net, appdata.main_arep, TEST_API_IDENT, slot, subslot, ix, ch_properties, 0x0001,
+         PF_USI_EXTENDED_CHANNEL_DIAGNOSIS);
+   }
+   for (ix = 1; ix < 50; ix += 2)
+   {
+      (void)pnet_diag_remove(net, appdata.main_arep, TEST_API_IDENT, slot, subslot, ix, ch_properties, 0x0001,
+         PF_USI_EXTENDED_CHANNEL_DIAGNOSIS);
+   }
+   EXPECT_EQ(count_free_diag_items(net), free_items);
+
    printf("\nGenerating mock release request\n");
    mock_set_os_udp_recvfrom_buffer(release_req, sizeof(release_req));
    os_usleep(TEST_UDP_DELAY);
@@ -305,3 +360,29 @@ TEST_F (DiagTest, DiagRunTest)
    EXPECT_EQ(appdata.call_counters.state_calls, 5);
    EXPECT_EQ(appdata.cmdev_state, PNET_EVENT_ABORT);
 }
+
+TEST_F (DiagTest, DiagNonvolWritesAreCoalesced)
+{
+   uint16_t                ix;
+
+   mock_clear();
+
+   /* The test window is much longer than the test, so the flush ends it */
+   for (ix = 0; ix < 100; ix++)
+   {
+      pf_diag_nonvol_mark_dirty(net);
+   }
+   EXPECT_EQ(mock_os_data.nvram_save_count, 0);
+
+   /* All changes are written at once */
+   pf_diag_nonvol_flush(net);
+   EXPECT_EQ(mock_os_data.nvram_save_count, 1);
+
+   /* No change, no write */
+   pf_diag_nonvol_flush(net);
+   EXPECT_EQ(mock_os_data.nvram_save_count, 1);
+
+   pf_diag_nonvol_mark_dirty(net);
+   pf_diag_nonvol_flush(net);
+   EXPECT_EQ(mock_os_data.nvram_save_count, 2);
+}
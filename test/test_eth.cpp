@@ -23,7 +23,69 @@
 
 class EthTest : public PnetIntegrationTest {};
 
+static uint16_t eth_test_frame_id;
+static uint16_t eth_test_calls;
+
+static int eth_test_handler(
+   pnet_t                  *net,
+   uint16_t                frame_id,
+   os_buf_t                *p_buf,
+   uint16_t                frame_id_pos,
+   void                    *p_arg)
+{
+   eth_test_frame_id = frame_id;
+   eth_test_calls++;
+   return 1;
+}
+
+/* Feed a frame with the frame id, and return the number of handler calls */
+static uint16_t eth_test_recv(
+   pnet_t                  *net,
+   uint16_t                frame_id)
+{
+   uint8_t                 frame[60] = { 0 };
+   os_buf_t                buf;
+
+   frame[12] = 0x88;       /* OS_ETHTYPE_PROFINET */
+   frame[13] = 0x92;
+   frame[14] = frame_id >> 8;
+   frame[15] = frame_id & 0xff;
+   buf.payload = frame;
+   buf.len = sizeof(frame);
+
+   eth_test_calls = 0;
+   (void)pf_eth_recv(net, &buf);
+
+   return eth_test_calls;
+}
+
 
 TEST_F (EthTest, EthRunTest)
 {
 }
+
+TEST_F (EthTest, EthFrameIdMapShouldFindCollidingFrameIds)
+{
+   /* All of these hash to the same index */
+   pf_eth_frame_id_map_add(net, 0x8181, eth_test_handler, NULL);
+   pf_eth_frame_id_map_add(net, 0x8282, eth_test_handler, NULL);
+   pf_eth_frame_id_map_add(net, 0x8383, eth_test_handler, NULL);
+
+   EXPECT_EQ(1, eth_test_recv(net, 0x8383));
+   EXPECT_EQ(0x8383, eth_test_frame_id);
+
+   /* Removing one in the middle must not hide the ones after it */
+   pf_eth_frame_id_map_remove(net, 0x8282);
+   EXPECT_EQ(0, eth_test_recv(net, 0x8282));
+   EXPECT_EQ(1, eth_test_recv(net, 0x8181));
+   EXPECT_EQ(1, eth_test_recv(net, 0x8383));
+
+   pf_eth_frame_id_map_remove(net, 0x8383);
+   pf_eth_frame_id_map_remove(net, 0x8181);
+   EXPECT_EQ(0, eth_test_recv(net, 0x8181));
+   EXPECT_EQ(0, eth_test_recv(net, 0x8383));
+
+   pf_eth_frame_id_map_add(net, 0x8383, eth_test_handler, NULL);
+   EXPECT_EQ(1, eth_test_recv(net, 0x8383));
+   pf_eth_frame_id_map_remove(net, 0x8383);
+}
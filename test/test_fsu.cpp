@@ -0,0 +1,216 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_FSU_JOURNAL_PATH "/tmp/pnet_test_fsu.journal"
+#define TEST_FSU_REQ_LEN      200
+
+class FsuUnitTest : public PnetUnitTest
+{
+protected:
+   pnet_cfg_t              cfg;
+   pnet_t                  *net;
+   pf_ar_t                 *p_ar;
+   uint8_t                 req[PF_FSU_REQUEST_SIZE + 1];
+
+   virtual void SetUp() override
+   {
+      uint16_t             ix;
+
+      remove(TEST_FSU_JOURNAL_PATH);
+      memset(&cfg, 0, sizeof(cfg));
+      net = (pnet_t *)calloc(1, sizeof(*net));
+      net->p_fspm_default_cfg = &cfg;
+      pf_nvs_init(net);
+      pf_fsu_init(net);
+
+      for (ix = 0; ix < sizeof(req); ix++)
+      {
+         req[ix] = (uint8_t)(ix + 1);
+      }
+
+      /* An AR with an input CR of two sub-slots, and an output CR */
+      p_ar = (pf_ar_t *)calloc(1, sizeof(*p_ar));
+      p_ar->nbr_ar_param = 1;
+      p_ar->nbr_iocrs = 2;
+      p_ar->iocrs[0].param.frame_id = 0x8000;
+      p_ar->iocrs[0].in_length = 12;
+      p_ar->iocrs[0].nbr_data_desc = 2;
+      p_ar->iocrs[0].data_desc[0].slot_nbr = 1;
+      p_ar->iocrs[0].data_desc[0].subslot_nbr = 1;
+      p_ar->iocrs[0].data_desc[0].data_length = 4;
+      p_ar->iocrs[0].data_desc[0].iops_offset = 4;
+      p_ar->iocrs[0].data_desc[0].iops_length = 1;
+      p_ar->iocrs[0].data_desc[1].slot_nbr = 2;
+      p_ar->iocrs[0].data_desc[1].subslot_nbr = 1;
+      p_ar->iocrs[0].data_desc[1].iocs_offset = 5;
+      p_ar->iocrs[0].data_desc[1].iocs_length = 1;
+      p_ar->iocrs[1].param.frame_id = 0xC000;
+      p_ar->iocrs[1].out_length = 3;
+      p_ar->iocrs[1].nbr_data_desc = 1;
+      p_ar->iocrs[1].data_desc[0].slot_nbr = 2;
+      p_ar->iocrs[1].data_desc[0].subslot_nbr = 1;
+      p_ar->iocrs[1].data_desc[0].data_length = 2;
+      p_ar->iocrs[1].data_desc[0].iops_offset = 2;
+      p_ar->iocrs[1].data_desc[0].iops_length = 1;
+   };
+
+   virtual void TearDown() override
+   {
+      os_mutex_destroy(net->fsu.mutex);
+      os_mutex_destroy(net->nvs_mutex);
+      free(p_ar);
+      free(net);
+      remove(TEST_FSU_JOURNAL_PATH);
+   };
+};
+
+
+TEST_F(FsuUnitTest, FsuReconnectIsHit)
+{
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_EQ(net->fsu.misses, 1u);
+
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+   EXPECT_NE(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+
+   /* New ARUUID and SessionKey */
+   req[8] = 0xAA;
+   req[23] = 0xBB;
+   req[24] = 0xCC;
+   req[25] = 0xDD;
+   EXPECT_NE(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_EQ(net->fsu.hits, 2u);
+   EXPECT_EQ(net->fsu.misses, 1u);
+}
+
+TEST_F(FsuUnitTest, FsuOtherRequestIsMiss)
+{
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN - 1, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, false), (const pf_fsu_entry_t *)NULL);
+
+   req[7] ^= 1;      /* AR type */
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   req[7] ^= 1;
+   req[26] ^= 1;     /* CMInitiatorMacAdd */
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   req[26] ^= 1;
+
+   /* A zero ARUUID must be checked */
+   memset(&req[8], 0, 16);
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_EQ(net->fsu.hits, 0u);
+}
+
+TEST_F(FsuUnitTest, FsuSameHashIsMiss)
+{
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+
+   /* As if another request had the same fingerprint */
+   net->fsu.cache.entries[0].req[100] ^= 1;
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+}
+
+TEST_F(FsuUnitTest, FsuOldestEntryIsReplaced)
+{
+   uint8_t                 other[TEST_FSU_REQ_LEN];
+   uint8_t                 third[TEST_FSU_REQ_LEN];
+
+   memcpy(other, req, sizeof(other));
+   other[100] ^= 1;
+   memcpy(third, req, sizeof(third));
+   third[101] ^= 1;
+
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+   pf_fsu_save(net, p_ar, other, TEST_FSU_REQ_LEN, true);
+   EXPECT_NE(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_NE(pf_fsu_find(net, other, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+
+   pf_fsu_save(net, p_ar, third, TEST_FSU_REQ_LEN, true);
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_NE(pf_fsu_find(net, other, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_NE(pf_fsu_find(net, third, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+}
+
+TEST_F(FsuUnitTest, FsuLargeRequestIsNotCached)
+{
+   pf_fsu_save(net, p_ar, req, PF_FSU_REQUEST_SIZE + 1, true);
+   EXPECT_EQ(pf_fsu_find(net, req, PF_FSU_REQUEST_SIZE + 1, true), (const pf_fsu_entry_t *)NULL);
+   EXPECT_EQ(net->fsu.cache.entries[0].valid, false);
+}
+
+TEST_F(FsuUnitTest, FsuRestoreLayout)
+{
+   const pf_fsu_entry_t    *p_entry;
+   pf_ar_t                 *p_new_ar;
+
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+   p_entry = pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true);
+   ASSERT_NE(p_entry, (const pf_fsu_entry_t *)NULL);
+
+   p_new_ar = (pf_ar_t *)calloc(1, sizeof(*p_new_ar));
+   p_new_ar->nbr_ar_param = 1;
+   p_new_ar->nbr_iocrs = 2;
+   p_new_ar->iocrs[1].param.frame_id = 0xFFFF;
+   EXPECT_EQ(pf_fsu_restore(p_entry, p_new_ar), 0);
+
+   EXPECT_EQ(p_new_ar->ar_param.valid, true);
+   EXPECT_EQ(p_new_ar->iocrs[0].p_ar, p_new_ar);
+   EXPECT_EQ(p_new_ar->iocrs[1].crep, 1u);
+   EXPECT_EQ(p_new_ar->iocrs[1].param.valid, true);
+   EXPECT_EQ(p_new_ar->iocrs[1].param.frame_id, 0xC000);
+   EXPECT_EQ(p_new_ar->iocrs[0].in_length, 12);
+   EXPECT_EQ(p_new_ar->iocrs[1].out_length, 3);
+   EXPECT_EQ(p_new_ar->iocrs[0].nbr_data_desc, 2);
+   EXPECT_EQ(p_new_ar->iocrs[0].data_desc[1].in_use, true);
+   EXPECT_EQ(p_new_ar->iocrs[0].data_desc[1].slot_nbr, 2);
+   EXPECT_EQ(p_new_ar->iocrs[0].data_desc[1].iocs_offset, 5);
+   EXPECT_EQ(p_new_ar->iocrs[1].data_desc[0].iops_offset, 2);
+   EXPECT_EQ(p_new_ar->iocrs[1].data_desc[1].in_use, false);
+
+   /* Not the same request */
+   p_new_ar->nbr_iocrs = 3;
+   EXPECT_EQ(pf_fsu_restore(p_entry, p_new_ar), -1);
+   free(p_new_ar);
+}
+
+TEST_F(FsuUnitTest, FsuNonvolatile)
+{
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+
+   /* Only kept in RAM */
+   pf_fsu_init(net);
+   EXPECT_EQ(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+
+   /* The journal survives a restart */
+   strcpy(cfg.Journal_NonvolFilePath, TEST_FSU_JOURNAL_PATH);
+   cfg.fast_startup_nonvol = true;
+   pf_nvs_init(net);
+   pf_fsu_save(net, p_ar, req, TEST_FSU_REQ_LEN, true);
+   pf_nvs_init(net);
+   pf_fsu_init(net);
+   EXPECT_NE(pf_fsu_find(net, req, TEST_FSU_REQ_LEN, true), (const pf_fsu_entry_t *)NULL);
+}
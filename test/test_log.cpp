@@ -0,0 +1,243 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+/**
+ * @file
+ * @brief Unit tests of the runtime log levels and of the log rings.
+ *
+ * The logging overhead is measured by bench_log.cpp.
+ */
+
+/* Include all messages, so they can be enabled at runtime */
+#define LOG_LEVEL (LOG_LEVEL_DEBUG)
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+#include <pthread.h>
+
+#include <sstream>
+#include <vector>
+
+
+#define LOG_TEST_MESSAGES (4 * LOG_RING_SIZE)  /* More than fits in the log ring of a thread */
+#define LOG_TEST_RAW_THREADS 4  /* More than the static rings */
+
+class LogTest : public PnetUnitTest
+{
+protected:
+   virtual void TearDown() override
+   {
+      (void)pnet_set_log_level(NULL, PNET_LOG_MODULE_ALL, LOG_RUNTIME_LEVEL);
+   };
+};
+
+static os_sem_t *log_test_ping;
+static os_sem_t *log_test_pong;
+
+/* Logs "thread 1" and "thread 3" around the "main 2" of the test */
+static void log_test_thread(void *arg)
+{
+   os_log(LOG_LEVEL_ERROR, "thread 1\n");
+   os_sem_signal(log_test_ping);
+   (void)os_sem_wait(log_test_pong, OS_WAIT_FOREVER);
+   os_log(LOG_LEVEL_ERROR, "thread 3\n");
+   os_sem_signal(log_test_ping);
+}
+
+static pthread_barrier_t log_test_barrier;
+
+/* A thread not created by the OSAL. All of them log while the others are alive. */
+static void *log_test_raw_thread(void *arg)
+{
+   os_log(LOG_LEVEL_ERROR, "raw %d\n", (int)(intptr_t)arg);
+   (void)pthread_barrier_wait(&log_test_barrier);
+   return NULL;
+}
+
+TEST_F (LogTest, LogLevelCanBeChangedAtRuntime)
+{
+   uint8_t level;
+   std::string output;
+
+   EXPECT_EQ(pnet_set_log_level(NULL, PNET_LOG_MODULE_PNET, PNET_LOG_LEVEL_WARNING), 0);
+   EXPECT_EQ(pnet_get_log_level(NULL, PNET_LOG_MODULE_PNET, &level), 0);
+   EXPECT_EQ(level, PNET_LOG_LEVEL_WARNING);
+
+   testing::internal::CaptureStdout();
+   LOG_INFO(PNET_LOG, "Not logged\n");
+   LOG_WARNING(PNET_LOG, "Logged\n");
+   LOG_INFO(PF_DCP_LOG, "Other module\n");
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+   EXPECT_EQ(output.find("Not logged"), std::string::npos);
+   EXPECT_NE(output.find("Logged"), std::string::npos);
+
+   EXPECT_EQ(pnet_set_log_level(NULL, PNET_LOG_MODULE_ALL, PNET_LOG_LEVEL_OFF), 0);
+   testing::internal::CaptureStdout();
+   LOG_ERROR(PNET_LOG, "Not logged\n");
+   LOG_ERROR(PF_DCP_LOG, "Not logged\n");
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+   EXPECT_EQ(output.find("Not logged"), std::string::npos);
+
+   EXPECT_EQ(pnet_set_log_level(NULL, PNET_LOG_MODULE_PNET, PNET_LOG_LEVEL_OFF + 1), -1);
+   EXPECT_EQ(pnet_set_log_level(NULL, (pnet_log_module_t)99, PNET_LOG_LEVEL_ERROR), -1);
+   EXPECT_EQ(pnet_get_log_level(NULL, PNET_LOG_MODULE_ALL, &level), -1);
+}
+
+TEST_F (LogTest, MessagesOfAllThreadsAreWrittenInOrder)
+{
+   os_thread_t *thread;
+   std::string output;
+   size_t first;
+   size_t second;
+   size_t third;
+
+   log_test_ping = os_sem_create(0);
+   log_test_pong = os_sem_create(0);
+
+   testing::internal::CaptureStdout();
+   thread = os_thread_create("test_log", 0, 4096, log_test_thread, NULL);
+   ASSERT_TRUE(thread != NULL);
+   EXPECT_EQ(os_sem_wait(log_test_ping, 1000), 0);
+   os_log(LOG_LEVEL_ERROR, "main 2\n");
+   os_sem_signal(log_test_pong);
+   EXPECT_EQ(os_sem_wait(log_test_ping, 1000), 0);
+   os_thread_join(thread);
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+
+   first = output.find("thread 1\n");
+   second = output.find("main 2\n");
+   third = output.find("thread 3\n");
+   ASSERT_NE(first, std::string::npos);
+   ASSERT_NE(second, std::string::npos);
+   ASSERT_NE(third, std::string::npos);
+   EXPECT_LT(first, second);
+   EXPECT_LT(second, third);
+
+   os_sem_destroy(log_test_ping);
+   os_sem_destroy(log_test_pong);
+}
+
+TEST_F (LogTest, ThreadsWithoutOwnRingAreFormatted)
+{
+   pthread_t threads[LOG_TEST_RAW_THREADS];
+   std::string output;
+   char expected[32];
+   int ix;
+
+   ASSERT_EQ(pthread_barrier_init(&log_test_barrier, NULL, LOG_TEST_RAW_THREADS), 0);
+
+   testing::internal::CaptureStdout();
+   for (ix = 0; ix < LOG_TEST_RAW_THREADS; ix++)
+   {
+      ASSERT_EQ(pthread_create(&threads[ix], NULL, log_test_raw_thread, (void *)(intptr_t)ix), 0);
+   }
+   for (ix = 0; ix < LOG_TEST_RAW_THREADS; ix++)
+   {
+      pthread_join(threads[ix], NULL);
+   }
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+
+   /* Also the threads using the shared ring get the prefix */
+   for (ix = 0; ix < LOG_TEST_RAW_THREADS; ix++)
+   {
+      snprintf(expected, sizeof(expected), "ERROR] raw %d\n", ix);
+      EXPECT_NE(output.find(expected), std::string::npos) << expected;
+   }
+
+   pthread_barrier_destroy(&log_test_barrier);
+}
+
+TEST_F (LogTest, TruncatedMessageKeepsLineBreak)
+{
+   std::string output;
+   std::string line;
+   std::istringstream lines;
+   std::vector<std::string> found;
+
+   testing::internal::CaptureStdout();
+   /* More arguments than fit in a record, so the text is stored instead */
+   os_log(LOG_LEVEL_ERROR, "truncated %d %d %d %d %d %d %d %d %d "
+      "............................................................"
+      "............................................................\n",
+      1, 2, 3, 4, 5, 6, 7, 8, 9);
+   os_log(LOG_LEVEL_ERROR, "next\n");
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+
+   lines.str(output);
+   while (std::getline(lines, line))
+   {
+      if ((line.find("truncated") != std::string::npos) ||
+          (line.find("next") != std::string::npos))
+      {
+         found.push_back(line);
+      }
+   }
+
+   ASSERT_EQ(found.size(), 2u);
+   EXPECT_NE(found[0].find("truncated 1 2 3 4 5 6 7 8 9 ...."), std::string::npos);
+   EXPECT_EQ(found[0].find("next"), std::string::npos);
+   EXPECT_NE(found[1].find("] next"), std::string::npos);
+}
+
+TEST_F (LogTest, DroppedMessagesAreCounted)
+{
+   std::string output;
+   std::string line;
+   std::istringstream lines;
+   uint32_t ix;
+   uint32_t written = 0;
+   uint32_t dropped = 0;
+   unsigned value;
+   long last = -1;
+   size_t pos;
+
+   testing::internal::CaptureStdout();
+   for (ix = 0; ix < LOG_TEST_MESSAGES; ix++)
+   {
+      os_log(LOG_LEVEL_ERROR, "message %u\n", (unsigned)ix);
+   }
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+
+   lines.str(output);
+   while (std::getline(lines, line))
+   {
+      if (sscanf(line.c_str(), "[log] %u messages dropped", &value) == 1)
+      {
+         dropped += value;
+      }
+      else if ((pos = line.find("] message ")) != std::string::npos)
+      {
+         value = (unsigned)strtoul(line.c_str() + pos + 10, NULL, 10);
+         EXPECT_GT((long)value, last);
+         last = value;
+         written++;
+      }
+   }
+
+   /* Messages are either written in order or counted as dropped */
+   EXPECT_GT(written, 0u);
+   EXPECT_EQ(written + dropped, (uint32_t)LOG_TEST_MESSAGES);
+}
@@ -0,0 +1,192 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define METRICS_TEST_PORT        19101
+
+
+class MetricsTest : public PnetIntegrationTest {};
+
+class MetricsHttpTest : public PnetIntegrationTest
+{
+protected:
+   virtual void cfg_init() override
+   {
+      PnetIntegrationTest::cfg_init();
+      pnet_default_cfg.metrics_port = METRICS_TEST_PORT;
+   }
+
+   virtual void TearDown() override
+   {
+      os_timer_stop(appdata.periodic_timer);
+      pf_metrics_exit(net);
+   }
+
+   /* Send a request and read the response until the server closes */
+   std::string http_get(
+      const char           *p_request)
+   {
+      struct sockaddr_in   addr;
+      char                 buf[1024];
+      std::string          response;
+      ssize_t              len;
+      int                  sock;
+      int                  tries = 0;
+      int                  ret = -1;
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(METRICS_TEST_PORT);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+      /* The metrics thread may not listen yet */
+      sock = socket(AF_INET, SOCK_STREAM, 0);
+      while ((ret != 0) && (tries < 100))
+      {
+         ret = connect(sock, (struct sockaddr *)&addr, sizeof(addr));
+         if (ret != 0)
+         {
+            close(sock);
+            os_usleep(10 * 1000);
+            sock = socket(AF_INET, SOCK_STREAM, 0);
+            tries++;
+         }
+      }
+      if (ret != 0)
+      {
+         close(sock);
+         return response;
+      }
+
+      (void)send(sock, p_request, strlen(p_request), 0);
+      while ((len = recv(sock, buf, sizeof(buf), 0)) > 0)
+      {
+         response.append(buf, len);
+      }
+      close(sock);
+
+      return response;
+   }
+};
+
+
+TEST_F (MetricsTest, MetricsFormat)
+{
+   static char             text[PF_METRICS_BUFFER_SIZE];
+   int                     len;
+
+   pf_stats_in(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_LLDP, 123456);
+   net->scheduler_lateness[0] += 3;
+   net->scheduler_lateness[PF_SCHEDULER_LATENESS_BUCKETS - 1] += 1;
+
+   len = pf_metrics_format(net, text, sizeof(text));
+   ASSERT_GT(len, 0);
+   EXPECT_EQ(strlen(text), (size_t)len);
+
+   EXPECT_NE(strstr(text, "# TYPE pnet_interface_octets_total counter\n"), nullptr);
+   EXPECT_NE(strstr(text, "pnet_interface_octets_total{direction=\"in\",class=\"lldp\"} 123456\n"), nullptr);
+   EXPECT_NE(strstr(text, "# TYPE pnet_scheduler_lateness_seconds histogram\n"), nullptr);
+   EXPECT_NE(strstr(text, "pnet_scheduler_lateness_seconds_bucket{le=\"0.000050\"} "), nullptr);
+   EXPECT_NE(strstr(text, "pnet_scheduler_lateness_seconds_bucket{le=\"+Inf\"} "), nullptr);
+   EXPECT_NE(strstr(text, "pnet_scheduler_lateness_seconds_count "), nullptr);
+   EXPECT_NE(strstr(text, "pnet_rpc_sessions "), nullptr);
+   EXPECT_NE(strstr(text, "pnet_ars 0\n"), nullptr);
+   EXPECT_NE(strstr(text, "pnet_buffers_allocated "), nullptr);
+
+   /* Each family is described once */
+   EXPECT_EQ(strstr(strstr(text, "# TYPE pnet_interface_octets_total") + 1,
+                    "# TYPE pnet_interface_octets_total"), nullptr);
+
+   /* A buffer that is too small is reported, not truncated silently */
+   EXPECT_EQ(pf_metrics_format(net, text, 100), -1);
+   EXPECT_EQ(pf_metrics_format(net, text, 0), -1);
+}
+
+TEST_F (MetricsTest, MetricsArsAreReadFromSnapshot)
+{
+   static char             text[PF_METRICS_BUFFER_SIZE];
+   pf_ar_t                 *p_ar = pf_ar_find_by_index(net, 0);
+   uint32_t                seq = net->metrics_seq;
+
+   ASSERT_NE(net->metrics_ars, nullptr);
+   os_timer_stop(appdata.periodic_timer);
+
+   p_ar->in_use = true;
+   p_ar->nbr_iocrs = 1;
+   p_ar->iocrs[0].param.iocr_type = PF_IOCR_TYPE_INPUT;
+   p_ar->iocrs[0].param.frame_id = 0x8001;
+   p_ar->iocrs[0].ppm.trx_cnt = 5;
+
+   /* Only on request from the metrics thread */
+   pf_metrics_periodic(net);
+   EXPECT_EQ(net->metrics_seq, seq);
+   net->metrics_req = true;
+   pf_metrics_periodic(net);
+   EXPECT_EQ(net->metrics_seq, seq + 2);
+   EXPECT_FALSE(net->metrics_req);
+
+   /* Later changes are not seen until the next snapshot */
+   p_ar->iocrs[0].ppm.trx_cnt = 7;
+   p_ar->in_use = false;
+
+   ASSERT_GT(pf_metrics_format(net, text, sizeof(text)), 0);
+   EXPECT_NE(strstr(text, "pnet_iocr_frames_total{ar=\"0\",iocr=\"0\",frame_id=\"0x8001\",direction=\"out\"} 5\n"), nullptr);
+   EXPECT_NE(strstr(text, "pnet_ars 1\n"), nullptr);
+
+   pf_metrics_snapshot(net);
+   ASSERT_GT(pf_metrics_format(net, text, sizeof(text)), 0);
+   EXPECT_EQ(strstr(text, "pnet_iocr_frames_total{ar=\"0\""), nullptr);
+   EXPECT_NE(strstr(text, "pnet_ars 0\n"), nullptr);
+}
+
+TEST_F (MetricsHttpTest, MetricsHttpGet)
+{
+   std::string             response;
+   size_t                  body;
+
+   response = http_get("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+   ASSERT_EQ(response.compare(0, 17, "HTTP/1.0 200 OK\r\n"), 0) << response;
+   EXPECT_NE(response.find("Content-Type: text/plain; version=0.0.4\r\n"), std::string::npos);
+
+   body = response.find("\r\n\r\n");
+   ASSERT_NE(body, std::string::npos);
+   body += 4;
+   EXPECT_NE(response.find("Content-Length: " + std::to_string(response.size() - body) + "\r\n"),
+      std::string::npos);
+   EXPECT_NE(response.find("\npnet_ars 0\n", body - 1), std::string::npos);
+
+   response = http_get("GET /other HTTP/1.1\r\n\r\n");
+   EXPECT_EQ(response, "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+}
+
+TEST_F (MetricsHttpTest, MetricsExitStopsServer)
+{
+   EXPECT_NE(http_get("GET / HTTP/1.0\r\n\r\n"), "");
+
+   pf_metrics_exit(net);
+   EXPECT_EQ(net->metrics_thread, nullptr);
+   EXPECT_EQ(http_get("GET / HTTP/1.0\r\n\r\n"), "");
+}
@@ -0,0 +1,177 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TEST_NVS_JOURNAL_PATH "/tmp/pnet_test_nvs.journal"
+
+class NvsUnitTest : public PnetUnitTest
+{
+protected:
+   pnet_cfg_t              cfg;
+   pnet_t                  *net;
+
+   virtual void SetUp() override
+   {
+      remove(TEST_NVS_JOURNAL_PATH);
+      memset(&cfg, 0, sizeof(cfg));
+      strcpy(cfg.Journal_NonvolFilePath, TEST_NVS_JOURNAL_PATH);
+      net = (pnet_t *)calloc(1, sizeof(*net));
+      net->p_fspm_default_cfg = &cfg;
+      pf_nvs_init(net);
+   };
+
+   virtual void TearDown() override
+   {
+      os_mutex_destroy(net->nvs_mutex);
+      free(net);
+      remove(TEST_NVS_JOURNAL_PATH);
+   };
+
+   long file_size()
+   {
+      struct stat st;
+
+      return (stat(TEST_NVS_JOURNAL_PATH, &st) == 0) ? (long)st.st_size : -1;
+   }
+};
+
+
+TEST_F(NvsUnitTest, NvsSaveAndLoad)
+{
+   uint8_t in[100];
+   uint8_t out[100];
+   uint32_t size;
+
+   memset(in, 0x5a, sizeof(in));
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_IM, out, sizeof(out)), -1);
+
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_IM, out, sizeof(out)), 0);
+   EXPECT_EQ(memcmp(in, out, sizeof(in)), 0);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_DIAG, out, sizeof(out)), -1);
+
+   /* Wrong length */
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_IM, out, sizeof(out) - 1), -1);
+
+   /* Unchanged data is not written again */
+   size = net->nvs_file_size;
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+   EXPECT_EQ(net->nvs_file_size, size);
+   EXPECT_EQ(file_size(), (long)size);
+
+   /* The new journal was renamed into place */
+   EXPECT_NE(access(TEST_NVS_JOURNAL_PATH ".tmp", F_OK), 0);
+}
+
+TEST_F(NvsUnitTest, NvsUnchangedIsDecidedByTheBytes)
+{
+   uint8_t in[100];
+   uint8_t other = 0xa5;
+   uint32_t size;
+   FILE *f;
+
+   memset(in, 0x5a, sizeof(in));
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+   size = net->nvs_file_size;
+
+   /* Change a stored byte behind the back of the store. The cached CRC
+      still matches, but the data does not. */
+   f = fopen(TEST_NVS_JOURNAL_PATH, "r+b");
+   ASSERT_TRUE(f != NULL);
+   ASSERT_EQ(fseek(f, (long)size - 1, SEEK_SET), 0);
+   ASSERT_EQ(fwrite(&other, 1, 1, f), 1u);
+   fclose(f);
+
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+   EXPECT_EQ(net->nvs_file_size, 2 * size);
+   EXPECT_EQ(file_size(), (long)(2 * size));
+}
+
+TEST_F(NvsUnitTest, NvsRestoreAfterRestart)
+{
+   uint8_t in[100];
+   uint8_t out[100];
+
+   memset(in, 1, sizeof(in));
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_PDEV, in, 10), 0);
+   memset(in, 2, sizeof(in));
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_IM, in, sizeof(in)), 0);
+
+   pf_nvs_init(net);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_IM, out, sizeof(out)), 0);
+   EXPECT_EQ(memcmp(in, out, sizeof(in)), 0);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_PDEV, out, 10), 0);
+   EXPECT_EQ(out[0], 1);
+}
+
+TEST_F(NvsUnitTest, NvsRecoverTornWrite)
+{
+   uint8_t in[100];
+   uint8_t out[100];
+   long size;
+
+   memset(in, 3, sizeof(in));
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_DIAG, in, sizeof(in)), 0);
+   size = file_size();
+
+   /* Simulate power loss in the middle of the next entry */
+   memset(in, 4, sizeof(in));
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_DIAG, in, sizeof(in)), 0);
+   ASSERT_EQ(truncate(TEST_NVS_JOURNAL_PATH, size + 30), 0);
+
+   pf_nvs_init(net);
+   EXPECT_EQ(file_size(), size);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_DIAG, out, sizeof(out)), 0);
+   EXPECT_EQ(out[0], 3);
+
+   /* Appending works after recovery */
+   EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_DIAG, in, sizeof(in)), 0);
+   pf_nvs_init(net);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_DIAG, out, sizeof(out)), 0);
+   EXPECT_EQ(out[0], 4);
+}
+
+TEST_F(NvsUnitTest, NvsJournalIsCompacted)
+{
+   uint8_t in[512];
+   uint8_t out[512];
+   uint32_t ix;
+
+   for (ix = 0; ix < 1000; ix++)
+   {
+      memset(in, ix, sizeof(in));
+      in[0] = ix >> 8;
+      EXPECT_EQ(pf_nvs_save(net, PF_NVS_KEY_DIAG, in, sizeof(in)), 0);
+   }
+
+   EXPECT_LT(file_size(), 2 * 64 * 1024);
+   EXPECT_EQ(file_size(), (long)net->nvs_file_size);
+
+   pf_nvs_init(net);
+   EXPECT_EQ(pf_nvs_load(net, PF_NVS_KEY_DIAG, out, sizeof(out)), 0);
+   EXPECT_EQ(memcmp(in, out, sizeof(in)), 0);
+}
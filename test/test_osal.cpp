@@ -20,8 +20,12 @@
  */
 
 #include "osal.h"
+#include "log.h"
 #include <gtest/gtest.h>
 
+#include <sched.h>
+#include <unistd.h>
+
 static int expired_calls;
 static void * expired_arg;
 static void expired (os_timer_t * timer, void * arg)
@@ -128,6 +132,60 @@ TEST (Osal, FetchFromEmptyMboxShouldTimeout)
    os_mbox_destroy (mbox);
 }
 
+TEST (Osal, FetchFromEmptyMboxShouldWaitForTimeout)
+{
+   os_mbox_t * mbox = os_mbox_create(2);
+   void * msg;
+   uint32_t start = os_get_current_time_us();
+
+   EXPECT_EQ (1, os_mbox_fetch (mbox, &msg, 50));
+   EXPECT_GE (os_get_current_time_us() - start, 45000u);
+
+   os_mbox_destroy (mbox);
+}
+
+static os_mbox_t * handover_mbox;
+static int handover_errors;
+static void handover_entry (void * arg)
+{
+   uintptr_t ix;
+
+   for (ix = 1; ix <= 1000; ix++)
+   {
+      if (os_mbox_post (handover_mbox, (void *)ix, 1000) != 0)
+      {
+         handover_errors++;
+      }
+   }
+}
+
+TEST (Osal, MboxShouldHandOverBetweenThreads)
+{
+   os_thread_t * thread;
+   void * msg;
+   uintptr_t ix;
+   uintptr_t sum = 0;
+
+   handover_mbox = os_mbox_create (2);
+   handover_errors = 0;
+   thread = os_thread_create ("test_mbox", 0, 4096, handover_entry, NULL);
+   ASSERT_TRUE (thread != NULL);
+
+   for (ix = 1; ix <= 1000; ix++)
+   {
+      /* Not ASSERT, the thread must be joined before the mbox is destroyed */
+      EXPECT_EQ (0, os_mbox_fetch (handover_mbox, &msg, 1000));
+      EXPECT_EQ (ix, (uintptr_t)msg);
+      sum += (uintptr_t)msg;
+   }
+   EXPECT_EQ (1000u * 1001u / 2u, sum);
+   os_thread_join (thread);
+   EXPECT_EQ (0, handover_errors);
+   EXPECT_EQ (1, os_mbox_fetch (handover_mbox, &msg, 0));
+
+   os_mbox_destroy (handover_mbox);
+}
+
 TEST (Osal, PostToFullMBoxShouldTimeout)
 {
    os_mbox_t * mbox = os_mbox_create(2);
@@ -141,6 +199,22 @@ TEST (Osal, PostToFullMBoxShouldTimeout)
    os_mbox_destroy (mbox);
 }
 
+TEST (Osal, NanosecondClockShouldFollowMicrosecondClock)
+{
+   uint64_t t0_ns = os_get_current_time_ns();
+   uint32_t t0_us = os_get_current_time_us();
+   uint64_t t1_ns;
+   uint32_t t1_us;
+
+   os_usleep (20 * 1000);
+   t1_ns = os_get_current_time_ns();
+   t1_us = os_get_current_time_us();
+
+   EXPECT_GE (t1_ns - t0_ns, 20u * 1000 * 1000);
+   EXPECT_NEAR ((double)(t1_us - t0_us), (double)((t1_ns - t0_ns) / 1000), 1000);
+   EXPECT_LE (t1_ns, os_get_current_time_ns());
+}
+
 TEST (Osal, CyclicTimer)
 {
    int t0, t1;
@@ -183,3 +257,129 @@ TEST (Osal, OneshotTimer)
 
    os_timer_destroy (timer);
 }
+
+static os_sem_t * thread_sem;
+static int thread_cpu;
+static void thread_entry (void * arg)
+{
+   thread_cpu = sched_getcpu();
+   os_sem_signal (thread_sem);
+}
+
+TEST (Osal, ThreadShouldRunOnConfiguredCpu)
+{
+   os_thread_cfg_t cfg;
+   cpu_set_t cpus;
+   int cpu = 0;
+
+   /* Use the last CPU that this process may run on */
+   ASSERT_EQ (0, sched_getaffinity (0, sizeof(cpus), &cpus));
+   for (int ix = 0; ix < 64; ix++)
+   {
+      if (CPU_ISSET (ix, &cpus))
+      {
+         cpu = ix;
+      }
+   }
+
+   memset (&cfg, 0, sizeof(cfg));
+   cfg.cpu_mask = 1ULL << cpu;
+   cfg.policy = OS_SCHED_OTHER;
+   cfg.stack_size = 8192;
+
+   thread_sem = os_sem_create (0);
+   thread_cpu = -1;
+   EXPECT_TRUE (os_thread_create_cfg ("test_cfg", &cfg, thread_entry, NULL) != NULL);
+   EXPECT_EQ (0, os_sem_wait (thread_sem, 1000));
+   EXPECT_EQ (cpu, thread_cpu);
+   os_sem_destroy (thread_sem);
+}
+
+TEST (Osal, ThreadShouldNotStartOnMissingCpu)
+{
+   os_thread_cfg_t cfg;
+
+   if (sysconf (_SC_NPROCESSORS_CONF) >= 64)
+   {
+      GTEST_SKIP();
+   }
+
+   memset (&cfg, 0, sizeof(cfg));
+   cfg.cpu_mask = 1ULL << 63;
+
+   thread_sem = os_sem_create (0);
+   EXPECT_TRUE (os_thread_create_cfg ("test_cfg", &cfg, thread_entry, NULL) == NULL);
+   EXPECT_EQ (1, os_sem_wait (thread_sem, 100));
+   os_sem_destroy (thread_sem);
+}
+
+TEST (Osal, JoinShouldWaitForThreadToReturn)
+{
+   os_thread_t * thread;
+
+   thread_sem = os_sem_create (0);
+   thread_cpu = -1;
+   thread = os_thread_create ("test_join", 0, 4096, thread_entry, NULL);
+   ASSERT_TRUE (thread != NULL);
+   os_thread_join (thread);
+   EXPECT_NE (-1, thread_cpu);
+   os_sem_destroy (thread_sem);
+}
+
+TEST (Osal, LogIsFormattedLater)
+{
+   char buf[16];
+   std::string output;
+
+   strcpy (buf, "hello");
+
+   testing::internal::CaptureStdout();
+   os_log (LOG_LEVEL_WARNING, "log %d %s %5.2f %llx %hhx %c %%\n",
+           42, buf, 3.14159, 0x1234567890ULL, 0x1ff, 'Z');
+
+   // String arguments are copied when logging
+   strcpy (buf, "XXXXX");
+
+   os_log_flush();
+   output = testing::internal::GetCapturedStdout();
+
+   EXPECT_NE (std::string::npos, output.find ("WARN ] log 42 hello  3.14 1234567890 ff Z %\n"));
+}
+
+TEST (Osal, BufShouldComeFromPool)
+{
+   os_buf_t * p[3];
+   uint32_t allocations;
+   int outstanding = os_buf_count();
+
+   ASSERT_EQ (0, os_buf_pool_init (2));
+   EXPECT_EQ (-1, os_buf_pool_init (2));
+
+   allocations = os_alloc_count();
+   p[0] = os_buf_alloc (OS_BUF_MAX_SIZE);
+   p[1] = os_buf_alloc (60);
+   ASSERT_TRUE (p[0] != NULL);
+   ASSERT_TRUE (p[1] != NULL);
+   EXPECT_EQ (allocations, os_alloc_count());
+   EXPECT_EQ (60, p[1]->len);
+   memset (p[0]->payload, 0xAA, OS_BUF_MAX_SIZE);
+
+   /* Pool is empty */
+   p[2] = os_buf_alloc (60);
+   ASSERT_TRUE (p[2] != NULL);
+   EXPECT_EQ (allocations + 1, os_alloc_count());
+   EXPECT_EQ (outstanding + 3, os_buf_count());
+
+   os_buf_free (p[2]);
+   os_buf_free (p[1]);
+   os_buf_free (p[0]);
+   EXPECT_EQ (outstanding, os_buf_count());
+
+   /* Freed pool buffers are reused */
+   allocations = os_alloc_count();
+   p[0] = os_buf_alloc (100);
+   p[1] = os_buf_alloc (100);
+   EXPECT_EQ (allocations, os_alloc_count());
+   os_buf_free (p[0]);
+   os_buf_free (p[1]);
+}
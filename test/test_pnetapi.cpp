@@ -32,9 +32,23 @@
 
 #include <gtest/gtest.h>
 
+#include <poll.h>
+
 
 class PnetapiTest : public PnetIntegrationTest {};
 
+static const char *event_loop_name = "test";
+static const char *event_loop_late_name = "test_late";
+static int event_loop_calls;
+
+static void event_loop_cb(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   event_loop_calls++;
+}
+
 
 static uint8_t connect_req[] =
 {
@@ -356,3 +370,57 @@ TEST_F(PnetapiTest, PnetapiShowTest)
    EXPECT_EQ(appdata.call_counters.state_calls, 2);
    EXPECT_EQ(appdata.cmdev_state, PNET_EVENT_ABORT);
 }
+
+TEST_F(PnetapiTest, PnetapiEventLoopTest)
+{
+   struct pollfd           pfd;
+   uint32_t                delay = 0;
+   uint32_t                timeout = 0;
+   uint32_t                late_timeout = 0;
+   uint32_t                start;
+   uint16_t                ix;
+   int                     fd;
+
+   /* The event loop replaces the periodic timer */
+   os_timer_stop(appdata.periodic_timer);
+
+   fd = pnet_get_fd(net);
+   ASSERT_GE(fd, 0);
+   EXPECT_EQ(fd, pnet_get_fd(net));
+   pfd.fd = fd;
+   pfd.events = POLLIN;
+
+   /* Readable at first, for anything that is already pending */
+   EXPECT_EQ(1, poll(&pfd, 1, 0));
+   pnet_process(net);
+
+   /* An earlier timeout re-arms the descriptor */
+   event_loop_calls = 0;
+   ASSERT_EQ(0, pf_scheduler_add(net, 5000000, event_loop_late_name, event_loop_cb, NULL, &late_timeout));
+   pnet_process(net);
+   ASSERT_EQ(0, pf_scheduler_add(net, 20000, event_loop_name, event_loop_cb, NULL, &timeout));
+   EXPECT_EQ(0, pnet_next_deadline(net, &delay));
+   EXPECT_LE(delay, 20000u);
+
+   start = os_get_current_time_us();
+   for (ix = 0; (ix < 100) && (event_loop_calls == 0); ix++)
+   {
+      ASSERT_EQ(1, poll(&pfd, 1, 1000));
+      pnet_process(net);
+   }
+   EXPECT_EQ(1, event_loop_calls);
+   EXPECT_GE(os_get_current_time_us() - start, 15000u);
+   EXPECT_LT(os_get_current_time_us() - start, 1000000u);
+
+   pf_scheduler_remove(net, event_loop_late_name, late_timeout);
+}
+
+TEST_F(PnetapiTest, PnetapiMaxArTest)
+{
+   /* Zero in the configuration selects the default */
+   EXPECT_EQ(PNET_MAX_AR, net->max_ar);
+   EXPECT_EQ(PF_MAX_SESSION(PNET_MAX_AR), net->cmrpc_max_session);
+
+   pnet_default_cfg.max_ar = PNET_MAX_AR_LIMIT + 1;
+   EXPECT_TRUE(pnet_init(TEST_INTERFACE_NAME, TICK_INTERVAL_US, &pnet_default_cfg) == NULL);
+}
@@ -21,9 +21,312 @@
 #include <gtest/gtest.h>
 
 
-class PtcpTest : public PnetIntegrationTest {};
+#define PTCP_TEST_FRAME_ID_POS   14
+#define PTCP_TEST_HEADER_POS     (PTCP_TEST_FRAME_ID_POS + 2)
+#define PTCP_TEST_SYNC_INTERVAL  (30 * 1000 * 1000)     /* ns */
+#define PTCP_TEST_MASTER_START   (1000ULL * 1000 * 1000 * 1000)
 
+static const uint8_t ptcp_test_master[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static const uint8_t ptcp_test_neighbour[] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 };
 
-TEST_F (PtcpTest, PtcpRunTest)
+class PtcpTest : public PnetIntegrationTest
 {
+protected:
+   virtual void SetUp() override
+   {
+      PnetIntegrationTest::SetUp();
+      pf_fspm_get_default_cfg(net, &p_cfg);
+
+      /* Close to the real time, as the delay timer checks for a lost master */
+      local_start = os_get_current_time_ns();
+   };
+
+   /* Build a PTCP frame with the given header and TLVs */
+   uint16_t build_frame(
+      uint8_t              *p_frame,
+      const uint8_t        *p_src,
+      uint16_t             frame_id,
+      uint16_t             sequence,
+      uint32_t             delay,
+      bool                 subdomain,
+      bool                 time,
+      uint64_t             master_time)
+   {
+      uint16_t             pos = PTCP_TEST_HEADER_POS;
+
+      memset(p_frame, 0, PF_FRAME_BUFFER_SIZE);
+      memset(p_frame, 0x01, 6);
+      memcpy(&p_frame[6], p_src, 6);
+      p_frame[12] = 0x88;
+      p_frame[13] = 0x92;
+      p_frame[PTCP_TEST_FRAME_ID_POS] = frame_id >> 8;
+      p_frame[PTCP_TEST_FRAME_ID_POS + 1] = frame_id & 0xff;
+      put_u32(delay / 10, &p_frame[pos + 8]);
+      p_frame[pos + 12] = sequence >> 8;
+      p_frame[pos + 13] = sequence & 0xff;
+      p_frame[pos + 14] = delay % 10;
+      pos += PF_PTCP_HEADER_SIZE;
+      if (subdomain == true)
+      {
+         p_frame[pos++] = PF_PTCP_TLV_SUBDOMAIN << 1;
+         p_frame[pos++] = PF_PTCP_SUBDOMAIN_SIZE;
+         memcpy(&p_frame[pos], ptcp_test_master, 6);
+         pos += PF_PTCP_SUBDOMAIN_SIZE;
+      }
+      if (time == true)
+      {
+         p_frame[pos++] = PF_PTCP_TLV_TIME << 1;
+         p_frame[pos++] = PF_PTCP_TIME_SIZE;
+         pos += 2;                                    /* Epoch */
+         put_u32((uint32_t)(master_time / 1000000000ULL), &p_frame[pos]);
+         put_u32((uint32_t)(master_time % 1000000000ULL), &p_frame[pos + 4]);
+         pos += 8;
+      }
+      pos += 2;                                       /* End */
+
+      return (pos < 60) ? 60 : pos;
+   }
+
+   /* Deliver a frame with the given receive timestamp */
+   void receive(
+      const uint8_t        *p_frame,
+      uint16_t             len,
+      uint64_t             rx_time)
+   {
+      os_buf_t             *p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+
+      ASSERT_NE(p_buf, nullptr);
+      memcpy(p_buf->payload, p_frame, len);
+      p_buf->len = len;
+      mock_os_data.eth_rx_timestamp = rx_time;
+      EXPECT_EQ(pf_eth_recv(net, p_buf), 1);
+   }
+
+   /* Send sync frames from a master drifting ppm from the local clock */
+   void run_master(
+      int32_t              ppm,
+      uint16_t             first,
+      uint16_t             nbr)
+   {
+      uint8_t              frame[PF_FRAME_BUFFER_SIZE];
+      uint16_t             len;
+      uint16_t             k;
+
+      for (k = first; k < first + nbr; k++)
+      {
+         local_time = local_start + (uint64_t)k * PTCP_TEST_SYNC_INTERVAL;
+         master_time = PTCP_TEST_MASTER_START + (uint64_t)k * PTCP_TEST_SYNC_INTERVAL +
+            ((int64_t)k * PTCP_TEST_SYNC_INTERVAL * ppm) / 1000000;
+         len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_RTSYNC, k, 0, true, true, master_time);
+         receive(frame, len, local_time);
+      }
+   }
+
+   static void put_u32(
+      uint32_t             value,
+      uint8_t              *p_data)
+   {
+      p_data[0] = (uint8_t)(value >> 24);
+      p_data[1] = (uint8_t)(value >> 16);
+      p_data[2] = (uint8_t)(value >> 8);
+      p_data[3] = (uint8_t)value;
+   }
+
+   const pnet_cfg_t        *p_cfg = NULL;
+   uint64_t                local_start;
+   uint64_t                local_time = 0;
+   uint64_t                master_time = 0;
+};
+
+
+TEST_F (PtcpTest, PtcpShouldLockToDriftingMaster)
+{
+   pnet_ptcp_status_t      status;
+   uint64_t                sync_time = 0;
+
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.state, PNET_PTCP_STATE_LISTENING);
+   EXPECT_EQ(pf_ptcp_get_time(net, local_start, &sync_time), -1);
+
+   run_master(100, 0, 100);
+
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.state, PNET_PTCP_STATE_SYNC);
+   EXPECT_EQ(memcmp(status.master_addr.addr, ptcp_test_master, 6), 0);
+   EXPECT_EQ(status.sync_count, 100u);
+   EXPECT_EQ(status.step_count, 1u);
+   EXPECT_NEAR(status.rate, 100000, 1000);
+   EXPECT_NEAR(status.offset, 0, 1000);
+
+   /* Between sync frames */
+   ASSERT_EQ(pf_ptcp_get_time(net, local_time + 10000000, &sync_time), 0);
+   EXPECT_NEAR((double)(int64_t)(sync_time - master_time), 10001000, 1000);
+
+   /* Frames from another master are ignored */
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                len;
+
+   len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_RTSYNC, 0, 0, true, true, 0);
+   frame[PTCP_TEST_HEADER_POS + PF_PTCP_HEADER_SIZE + 2 + 5] = 0x07;
+   receive(frame, len, local_time + 1000);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.sync_count, 100u);
+   EXPECT_EQ(status.step_count, 1u);
+}
+
+TEST_F (PtcpTest, PtcpShouldStepOnLargeOffset)
+{
+   pnet_ptcp_status_t      status;
+   uint64_t                sync_time = 0;
+
+   run_master(0, 0, 20);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.state, PNET_PTCP_STATE_SYNC);
+
+   /* The master jumps 5 ms */
+   local_start -= 5 * 1000 * 1000;
+   run_master(0, 20, 1);
+
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.state, PNET_PTCP_STATE_LOCKING);
+   EXPECT_EQ(status.step_count, 2u);
+   EXPECT_EQ(pf_ptcp_get_time(net, local_time, &sync_time), -1);
+
+   run_master(0, 21, 20);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.state, PNET_PTCP_STATE_SYNC);
+   EXPECT_EQ(status.step_count, 2u);
+   ASSERT_EQ(pf_ptcp_get_time(net, local_time, &sync_time), 0);
+   EXPECT_NEAR((double)(int64_t)(sync_time - master_time), 0, 100);
+}
+
+TEST_F (PtcpTest, PtcpShouldUseFollowUp)
+{
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                len;
+   pnet_ptcp_status_t      status;
+
+   local_time = local_start + 1000;
+
+   /* The follow up must match the sequence of the sync frame */
+   len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_RTSYNC_FU, 7, 1234, true, false, 0);
+   receive(frame, len, local_time);
+   len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_FOLLOW_UP, 8, 0, true, true, PTCP_TEST_MASTER_START);
+   receive(frame, len, local_time + 50000);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.sync_count, 0u);
+
+   len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_FOLLOW_UP, 7, 100, true, true, PTCP_TEST_MASTER_START);
+   receive(frame, len, local_time + 50000);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.sync_count, 1u);
+
+   /* The time of the sync frame, with the delays of both frames */
+   EXPECT_EQ(net->ptcp.clock.local_ref, local_time);
+   EXPECT_EQ(net->ptcp.clock.master_ref, (int64_t)PTCP_TEST_MASTER_START + 1234 + 100);
+}
+
+TEST_F (PtcpTest, PtcpShouldAnswerDelayReq)
+{
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                len;
+   uint32_t                delay;
+   uint16_t                pos = PTCP_TEST_HEADER_POS;
+   const uint8_t           dest[] = { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e };
+
+   len = build_frame(frame, ptcp_test_neighbour, PF_PTCP_FRAME_ID_DELAY_REQ, 0x1234, 0, false, false, 0);
+   mock_clear();
+   receive(frame, len, os_get_current_time_ns() - 10000);
+
+   ASSERT_EQ(mock_os_data.eth_send_count, 1);
+   EXPECT_EQ(mock_os_data.eth_send_len, 60);
+   EXPECT_EQ(memcmp(mock_os_data.eth_send_copy, dest, 6), 0);
+   EXPECT_EQ(memcmp(&mock_os_data.eth_send_copy[6], p_cfg->eth_addr.addr, 6), 0);
+   EXPECT_EQ(mock_os_data.eth_send_copy[PTCP_TEST_FRAME_ID_POS], 0xff);
+   EXPECT_EQ(mock_os_data.eth_send_copy[PTCP_TEST_FRAME_ID_POS + 1], 0x43);
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos + 12], 0x12);
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos + 13], 0x34);
+
+   /* The time from reception to response */
+   delay = ((uint32_t)mock_os_data.eth_send_copy[pos + 8] << 24 |
+            (uint32_t)mock_os_data.eth_send_copy[pos + 9] << 16 |
+            (uint32_t)mock_os_data.eth_send_copy[pos + 10] << 8 |
+            mock_os_data.eth_send_copy[pos + 11]) * 10 +
+           mock_os_data.eth_send_copy[pos + 14];
+   EXPECT_GE(delay, 10000u);
+   EXPECT_LT(delay, 1000000000u);
+
+   /* DelayParameter with the address of the requester, then End */
+   pos += PF_PTCP_HEADER_SIZE;
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos], PF_PTCP_TLV_DELAY_PARAMETER << 1);
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos + 1], PF_PTCP_DELAY_PARAMETER_SIZE);
+   EXPECT_EQ(memcmp(&mock_os_data.eth_send_copy[pos + 2], ptcp_test_neighbour, 6), 0);
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos + 8], 0);
+   EXPECT_EQ(mock_os_data.eth_send_copy[pos + 9], 0);
+}
+
+TEST_F (PtcpTest, PtcpShouldMeasureLineDelay)
+{
+   uint8_t                 frame[PF_FRAME_BUFFER_SIZE];
+   uint16_t                len;
+   uint16_t                sequence;
+   uint64_t                sent;
+   pnet_ptcp_status_t      status;
+
+   /* The first sync frame starts the delay requests, from the scheduler */
+   mock_clear();
+   run_master(0, 0, 1);
+   EXPECT_EQ(mock_os_data.eth_send_count, 0);
+   pf_scheduler_tick(net);
+   ASSERT_EQ(mock_os_data.eth_send_count, 1);
+   EXPECT_EQ(mock_os_data.eth_send_copy[PTCP_TEST_FRAME_ID_POS], 0xff);
+   EXPECT_EQ(mock_os_data.eth_send_copy[PTCP_TEST_FRAME_ID_POS + 1], 0x40);
+   sequence = (uint16_t)(mock_os_data.eth_send_copy[PTCP_TEST_HEADER_POS + 12] << 8 |
+                         mock_os_data.eth_send_copy[PTCP_TEST_HEADER_POS + 13]);
+   sent = net->ptcp.delay_req_sent;
+   ASSERT_NE(sent, 0u);
+
+   /* 500 ns on the line in each direction, 3 us in the master */
+   len = build_frame(frame, ptcp_test_master, PF_PTCP_FRAME_ID_DELAY_RES, sequence, 3000, false, false, 0);
+   frame[PTCP_TEST_HEADER_POS + PF_PTCP_HEADER_SIZE] = PF_PTCP_TLV_DELAY_PARAMETER << 1;
+   frame[PTCP_TEST_HEADER_POS + PF_PTCP_HEADER_SIZE + 1] = PF_PTCP_DELAY_PARAMETER_SIZE;
+   memcpy(&frame[PTCP_TEST_HEADER_POS + PF_PTCP_HEADER_SIZE + 2], p_cfg->eth_addr.addr, 6);
+   receive(frame, len, sent + 4000);
+
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.line_delay, 500u);
+
+   /* A response is only used once */
+   receive(frame, len, sent + 8000);
+   ASSERT_EQ(pnet_get_ptcp_status(net, &status), 0);
+   EXPECT_EQ(status.line_delay, 500u);
+
+   /* And the line delay is added to the time of the master */
+   run_master(0, 1, 1);
+   EXPECT_EQ(net->ptcp.offset, 500);
+}
+
+TEST_F (PtcpTest, PtcpShouldCalculatePhaseDelay)
+{
+   uint32_t                delay = 4711;
+
+   EXPECT_EQ(pf_ptcp_phase_delay(net, local_start, 1000, 0, &delay), -1);
+   EXPECT_EQ(delay, 4711u);
+
+   /* Synchronized, 250 us into a 1 ms cycle of the master */
+   net->ptcp.clock_valid = true;
+   net->ptcp.clock_copy.master_ref = PTCP_TEST_MASTER_START + 250000;
+   net->ptcp.clock_copy.local_ref = local_start;
+   net->ptcp.clock_copy.last_sync = local_start;
+   net->ptcp.clock_copy.rate = 0;
+   net->ptcp.state = PNET_PTCP_STATE_SYNC;
+
+   EXPECT_EQ(pf_ptcp_phase_delay(net, local_start, 1000, 0, &delay), 0);
+   EXPECT_EQ(delay, 750u);
+   EXPECT_EQ(pf_ptcp_phase_delay(net, local_start, 1000, 500, &delay), 0);
+   EXPECT_EQ(delay, 1250u);
+   EXPECT_EQ(pf_ptcp_phase_delay(net, local_start, 1000, 900, &delay), 0);
+   EXPECT_EQ(delay, 650u);
+   EXPECT_EQ(pf_ptcp_phase_delay(net, local_start, 4000, 0, &delay), 0);
+   EXPECT_EQ(delay, 3750u);
 }
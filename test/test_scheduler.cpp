@@ -21,9 +21,120 @@
 #include <gtest/gtest.h>
 
 
-class SchedulerTest : public PnetIntegrationTest {};
+class SchedulerTest : public PnetIntegrationTest
+{
+protected:
+   /* Room for more timeouts than the default number of ARs needs */
+   virtual void cfg_init() override
+   {
+      PnetIntegrationTest::cfg_init();
+      pnet_default_cfg.max_ar = 8;
+   }
+};
+
+static const char *scheduler_test_name = "test";
+static uint32_t scheduler_test_order[3];
+static uint64_t scheduler_test_time[3];
+static uint16_t scheduler_test_calls;
+
+static void scheduler_test_cb(
+   pnet_t                  *net,
+   void                    *arg,
+   uint64_t                current_time)
+{
+   if (scheduler_test_calls < NELEMENTS(scheduler_test_order))
+   {
+      scheduler_test_order[scheduler_test_calls] = (uint32_t)(uintptr_t)arg;
+      scheduler_test_time[scheduler_test_calls] = current_time;
+   }
+   scheduler_test_calls++;
+}
 
 
 TEST_F (SchedulerTest, ShedulerRunTest)
 {
 }
+
+TEST_F (SchedulerTest, SchedulerShouldDispatchInTimeOrder)
+{
+   uint32_t                timeout[3];
+   uint64_t                start = os_get_current_time_ns();
+
+   scheduler_test_calls = 0;
+   ASSERT_EQ(0, pf_scheduler_add(net, 3000, scheduler_test_name, scheduler_test_cb, (void *)3, &timeout[0]));
+   ASSERT_EQ(0, pf_scheduler_add(net, 1000, scheduler_test_name, scheduler_test_cb, (void *)1, &timeout[1]));
+   ASSERT_EQ(0, pf_scheduler_add(net, 2000, scheduler_test_name, scheduler_test_cb, (void *)2, &timeout[2]));
+
+   os_usleep(5000);
+   pf_scheduler_tick(net);
+
+   ASSERT_EQ(3, scheduler_test_calls);
+   EXPECT_EQ(1u, scheduler_test_order[0]);
+   EXPECT_EQ(2u, scheduler_test_order[1]);
+   EXPECT_EQ(3u, scheduler_test_order[2]);
+   EXPECT_GE(scheduler_test_time[0], start + 3000u * 1000);
+   EXPECT_LE(scheduler_test_time[0], os_get_current_time_ns());
+}
+
+TEST_F (SchedulerTest, SchedulerShouldNotDispatchEarly)
+{
+   uint32_t                timeout;
+   uint32_t                delay = 0;
+
+   scheduler_test_calls = 0;
+   ASSERT_EQ(0, pf_scheduler_add(net, 1000000, scheduler_test_name, scheduler_test_cb, NULL, &timeout));
+
+   pf_scheduler_tick(net);
+   os_usleep(2000);
+   pf_scheduler_tick(net);
+   EXPECT_EQ(0, scheduler_test_calls);
+   ASSERT_EQ(0, pf_scheduler_next_delay(net, &delay));
+   EXPECT_LE(delay, 1000000u);
+
+   pf_scheduler_remove(net, scheduler_test_name, timeout);
+}
+
+TEST_F (SchedulerTest, SchedulerShouldRemoveAnyOfManyTimeouts)
+{
+   uint32_t                timeout[40];
+   uint16_t                ix;
+
+   scheduler_test_calls = 0;
+   for (ix = 0; ix < NELEMENTS(timeout); ix++)
+   {
+      ASSERT_EQ(0, pf_scheduler_add(net, 1000 + 10 * ix, scheduler_test_name, scheduler_test_cb, (void *)(uintptr_t)ix, &timeout[ix]));
+   }
+
+   /* Also the ones far from the head of the queue */
+   for (ix = 0; ix < NELEMENTS(timeout); ix += 2)
+   {
+      pf_scheduler_remove(net, scheduler_test_name, timeout[ix]);
+   }
+
+   os_usleep(5000);
+   pf_scheduler_tick(net);
+
+   ASSERT_EQ(NELEMENTS(timeout) / 2, scheduler_test_calls);
+   EXPECT_EQ(1u, scheduler_test_order[0]);
+   EXPECT_EQ(3u, scheduler_test_order[1]);
+   EXPECT_EQ(5u, scheduler_test_order[2]);
+}
+
+TEST_F (SchedulerTest, SchedulerShouldDispatchZeroDelaysInOrderAdded)
+{
+   uint32_t                timeout[3];
+   uint16_t                ix;
+
+   scheduler_test_calls = 0;
+   for (ix = 0; ix < NELEMENTS(timeout); ix++)
+   {
+      ASSERT_EQ(0, pf_scheduler_add(net, 0, scheduler_test_name, scheduler_test_cb, (void *)(uintptr_t)ix, &timeout[ix]));
+   }
+
+   pf_scheduler_tick(net);
+
+   ASSERT_EQ(3, scheduler_test_calls);
+   EXPECT_EQ(0u, scheduler_test_order[0]);
+   EXPECT_EQ(1u, scheduler_test_order[1]);
+   EXPECT_EQ(2u, scheduler_test_order[2]);
+}
@@ -0,0 +1,131 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+
+class StatsTest : public PnetIntegrationTest {};
+
+
+/* DCP Get NameOfStation request */
+static uint8_t get_name_req[] =
+{
+   0x1e, 0x30, 0x6c, 0xa2, 0x45, 0x5e, 0xc8, 0x5b, 0x76, 0xe6, 0x89, 0xdf, 0x88, 0x92, 0xfe, 0xfd,
+   0x03, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x06, 0x02, 0x02, 0x02, 0x03, 0x01, 0x02,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+/* Start of an IPv4 frame */
+static uint8_t ip_frame[] =
+{
+   0x1e, 0x30, 0x6c, 0xa2, 0x45, 0x5e, 0xc8, 0x5b, 0x76, 0xe6, 0x89, 0xdf, 0x08, 0x00, 0x45, 0x00,
+   0x00, 0x1c, 0x00, 0x00, 0x40, 0x00, 0x40, 0x11, 0x00, 0x00, 0xc0, 0xa8, 0x01, 0x01, 0xc0, 0xa8,
+   0x01, 0xab, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+TEST_F (StatsTest, StatsCountOctets)
+{
+   pnet_interface_stats_t  before;
+   pnet_interface_stats_t  after;
+   os_buf_t                *p_buf;
+   int                     ret;
+
+   ret = pnet_get_interface_statistics(net, &before);
+   EXPECT_EQ(ret, 0);
+
+   mock_clear();
+   p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   memcpy(p_buf->payload, get_name_req, sizeof(get_name_req));
+   p_buf->len = sizeof(get_name_req);
+   ret = pf_eth_recv(net, p_buf);
+   EXPECT_EQ(ret, 1);
+   EXPECT_EQ(mock_os_data.eth_send_count, 1);
+
+   ret = pnet_get_interface_statistics(net, &after);
+   EXPECT_EQ(ret, 0);
+
+   /* One frame in and one response out, counted in octets */
+   EXPECT_EQ(after.ifInOctets - before.ifInOctets, sizeof(get_name_req));
+   EXPECT_EQ(after.ifOutOctets - before.ifOutOctets, (uint32_t)mock_os_data.eth_send_len);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_DCP].in_packets -
+             before.traffic[PNET_TRAFFIC_CLASS_DCP].in_packets, 1u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_DCP].out_packets -
+             before.traffic[PNET_TRAFFIC_CLASS_DCP].out_packets, 1u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_RT].in_packets,
+             before.traffic[PNET_TRAFFIC_CLASS_RT].in_packets);
+   EXPECT_EQ(after.ifInDiscards, before.ifInDiscards);
+
+   /* Other Ethertypes are discarded */
+   p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   memcpy(p_buf->payload, ip_frame, sizeof(ip_frame));
+   p_buf->len = sizeof(ip_frame);
+   ret = pf_eth_recv(net, p_buf);
+   EXPECT_EQ(ret, 0);
+   os_buf_free(p_buf);
+
+   before = after;
+   ret = pnet_get_interface_statistics(net, &after);
+   EXPECT_EQ(ret, 0);
+   EXPECT_EQ(after.ifInOctets, before.ifInOctets);
+   EXPECT_EQ(after.ifInDiscards - before.ifInDiscards, 1u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_OTHER].in_discards -
+             before.traffic[PNET_TRAFFIC_CLASS_OTHER].in_discards, 1u);
+}
+
+TEST_F (StatsTest, StatsSumAllThreads)
+{
+   pnet_interface_stats_t  before;
+   pnet_interface_stats_t  after;
+
+   pf_stats_get(net, &before);
+
+   pf_stats_in(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_RT, 100);
+   pf_stats_out(net, PF_STATS_CTX_CYCLIC, PNET_TRAFFIC_CLASS_RT, 60);
+   pf_stats_out(net, PF_STATS_CTX_CYCLIC, PNET_TRAFFIC_CLASS_RT, 60);
+   pf_stats_in(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC, 1000);
+   pf_stats_out_error(net, PF_STATS_CTX_PERIODIC, PNET_TRAFFIC_CLASS_ALARM);
+   pf_stats_out_error(net, PF_STATS_CTX_CYCLIC, PNET_TRAFFIC_CLASS_RT);
+   pf_stats_out_discard(net, PF_STATS_CTX_RPC, PNET_TRAFFIC_CLASS_RPC);
+   pf_stats_in_discard(net, PF_STATS_CTX_RX, PNET_TRAFFIC_CLASS_OTHER);
+
+   pf_stats_get(net, &after);
+
+   EXPECT_EQ(after.ifInOctets - before.ifInOctets, 1100u);
+   EXPECT_EQ(after.ifOutOctets - before.ifOutOctets, 120u);
+   EXPECT_EQ(after.ifInDiscards - before.ifInDiscards, 1u);
+   EXPECT_EQ(after.ifOutDiscards - before.ifOutDiscards, 1u);
+   EXPECT_EQ(after.ifInErrors - before.ifInErrors, 0u);
+   EXPECT_EQ(after.ifOutErrors - before.ifOutErrors, 2u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_RT].in_packets -
+             before.traffic[PNET_TRAFFIC_CLASS_RT].in_packets, 1u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_RT].out_packets -
+             before.traffic[PNET_TRAFFIC_CLASS_RT].out_packets, 2u);
+   EXPECT_EQ(after.traffic[PNET_TRAFFIC_CLASS_RPC].in_octets -
+             before.traffic[PNET_TRAFFIC_CLASS_RPC].in_octets, 1000u);
+
+   /* The slots of different threads do not share a cache line */
+   EXPECT_GE(sizeof(net->stats[0]),
+             sizeof(net->stats[0].traffic) + PF_CACHE_LINE_SIZE);
+   EXPECT_EQ(sizeof(net->stats[0]) % PF_CACHE_LINE_SIZE, 0u);
+
+   EXPECT_EQ(pnet_get_interface_statistics(net, NULL), -1);
+}
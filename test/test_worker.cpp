@@ -0,0 +1,166 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#include "utils_for_testing.h"
+#include "mocks.h"
+
+#include "pf_includes.h"
+
+#include <gtest/gtest.h>
+
+
+class WorkerTest : public PnetIntegrationTest {};
+
+
+/* DCP Set IP request */
+static uint8_t set_ip_req[] =
+{
+   0x1e, 0x30, 0x6c, 0xa2, 0x45, 0x5e, 0xc8, 0x5b, 0x76, 0xe6, 0x89, 0xdf, 0x88, 0x92, 0xfe, 0xfd,
+   0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x18, 0x01, 0x02, 0x00, 0x0e, 0x00, 0x00,
+   0xc0, 0xa8, 0x01, 0xab, 0xff, 0xff, 0xff, 0x00, 0xc0, 0xa8, 0x01, 0x01, 0x05, 0x02, 0x00, 0x02,
+   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+typedef struct worker_test_log
+{
+   uint16_t                count;
+   uintptr_t               args[PF_WORKER_JOBS * 2];
+} worker_test_log_t;
+
+static worker_test_log_t   worker_log;
+
+static void worker_test_record(
+   pnet_t                  *net,
+   void                    *arg)
+{
+   if (worker_log.count < NELEMENTS(worker_log.args))
+   {
+      worker_log.args[worker_log.count] = (uintptr_t)arg;
+   }
+   worker_log.count++;
+}
+
+/* Keeps the worker thread busy until the semaphore is signalled */
+static void worker_test_block(
+   pnet_t                  *net,
+   void                    *arg)
+{
+   (void)os_sem_wait((os_sem_t *)arg, OS_WAIT_FOREVER);
+}
+
+TEST_F (WorkerTest, WorkerShouldRunJobsInOrder)
+{
+   uintptr_t               ix;
+
+   memset(&worker_log, 0, sizeof(worker_log));
+
+   for (ix = 0; ix < 10; ix++)
+   {
+      pf_worker_post(net, worker_test_record, (void *)ix);
+   }
+   os_usleep(TEST_UDP_DELAY);
+
+   EXPECT_EQ(worker_log.count, 10);
+   for (ix = 0; ix < 10; ix++)
+   {
+      EXPECT_EQ(worker_log.args[ix], ix);
+   }
+}
+
+TEST_F (WorkerTest, WorkerShouldKeepIpChangeOffReceiveThread)
+{
+   os_sem_t                *p_sem = os_sem_create(0);
+   os_buf_t                *p_buf;
+   int                     ret;
+
+   ASSERT_NE(p_sem, nullptr);
+   mock_clear();
+
+   pf_worker_post(net, worker_test_block, p_sem);
+
+   p_buf = os_buf_alloc(PF_FRAME_BUFFER_SIZE);
+   memcpy(p_buf->payload, set_ip_req, sizeof(set_ip_req));
+   ret = pf_eth_recv(net, p_buf);
+
+   /* The response is sent at once, the IP settings are changed later */
+   EXPECT_EQ(ret, 1);
+   EXPECT_EQ(mock_os_data.eth_send_count, 1);
+   EXPECT_EQ(mock_os_data.set_ip_suite_count, 0);
+
+   os_sem_signal(p_sem);
+   os_usleep(TEST_UDP_DELAY);
+
+   EXPECT_EQ(mock_os_data.set_ip_suite_count, 1);
+   EXPECT_EQ(mock_os_data.eth_send_count, 2);      /* LLDP */
+
+   os_sem_destroy(p_sem);
+}
+
+TEST_F (WorkerTest, WorkerShouldRunJobsInCallerWhenFull)
+{
+   os_sem_t                *p_sem = os_sem_create(0);
+   uintptr_t               ix;
+
+   ASSERT_NE(p_sem, nullptr);
+   memset(&worker_log, 0, sizeof(worker_log));
+
+   /* Holds one job until it returns */
+   pf_worker_post(net, worker_test_block, p_sem);
+
+   for (ix = 0; ix < PF_WORKER_JOBS; ix++)
+   {
+      pf_worker_post(net, worker_test_record, (void *)ix);
+   }
+   /* The last one did not fit */
+   EXPECT_EQ(worker_log.count, 1);
+   EXPECT_EQ(worker_log.args[0], (uintptr_t)(PF_WORKER_JOBS - 1));
+
+   os_sem_signal(p_sem);
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(worker_log.count, PF_WORKER_JOBS);
+
+   os_sem_destroy(p_sem);
+}
+
+TEST_F (WorkerTest, WorkerShouldFinishJobsOnExit)
+{
+   os_sem_t                *p_sem = os_sem_create(0);
+
+   ASSERT_NE(p_sem, nullptr);
+   memset(&worker_log, 0, sizeof(worker_log));
+
+   pf_worker_post(net, worker_test_record, (void *)1);
+   pf_worker_post(net, worker_test_record, (void *)2);
+   pf_worker_exit(net);
+   EXPECT_EQ(worker_log.count, 2);
+   EXPECT_EQ(net->worker_q, nullptr);
+   EXPECT_EQ(net->worker_free, nullptr);
+
+   /* Without the thread, jobs are run by the caller */
+   pf_worker_post(net, worker_test_record, (void *)3);
+   EXPECT_EQ(worker_log.count, 3);
+   EXPECT_EQ(worker_log.args[2], 3u);
+
+   /* And the thread can be started again */
+   EXPECT_EQ(pf_worker_init(net), 0);
+   pf_worker_post(net, worker_test_block, p_sem);
+   pf_worker_post(net, worker_test_record, (void *)4);
+   EXPECT_EQ(worker_log.count, 3);
+   os_sem_signal(p_sem);
+   os_usleep(TEST_UDP_DELAY);
+   EXPECT_EQ(worker_log.count, 4);
+
+   os_sem_destroy(p_sem);
+}
@@ -0,0 +1,121 @@
+/*********************************************************************
+ *        _       _         _
+ *  _ __ | |_  _ | |  __ _ | |__   ___
+ * | '__|| __|(_)| | / _` || '_ \ / __|
+ * | |   | |_  _ | || (_| || |_) |\__ \
+ * |_|    \__|(_)|_| \__,_||_.__/ |___/
+ *
+ * www.rt-labs.com
+ * Copyright 2018 rt-labs AB, Sweden.
+ *
+ * This software is dual-licensed under GPLv3 and a commercial
+ * license. See the file LICENSE.md distributed with this software for
+ * full license information.
+ ********************************************************************/
+
+#ifndef UTILS_FOR_BENCHMARK_H
+#define UTILS_FOR_BENCHMARK_H
+
+#include "utils_for_testing.h"
+
+#include <benchmark/benchmark.h>
+
+#define BENCH_DATA_FRAME_ID                        0x8000   /* Output CR in bench_connect_req */
+#define BENCH_FRAME_ID_POS                         14       /* No VLAN tag in bench_data_packet */
+
+/*
+ * Recorded frames, see test_cmrpc.cpp.
+ * The RPC frames are UDP payload, the data packet is a raw Ethernet frame.
+ */
+extern uint8_t bench_connect_req[];
+extern uint8_t bench_prm_end_req[];
+extern uint8_t bench_appl_rdy_rsp[];
+extern uint8_t bench_release_req[];
+extern uint8_t bench_data_packet[];
+extern const uint16_t bench_connect_req_len;
+extern const uint16_t bench_prm_end_req_len;
+extern const uint16_t bench_appl_rdy_rsp_len;
+extern const uint16_t bench_release_req_len;
+extern const uint16_t bench_data_packet_len;
+
+/**
+ * A p-net stack instance using the mocked OS layer, for benchmarks.
+ *
+ * Unlike PnetIntegrationTest no periodic timer is started. The benchmarks
+ * call the stack functions directly, so the measured code runs in the
+ * benchmark thread only.
+ */
+class PnetBenchStack : public PnetIntegrationTestBase
+{
+public:
+   using PnetIntegrationTestBase::net;
+   using PnetIntegrationTestBase::appdata;
+
+   /** Initialize mocks, callbacks and the stack. */
+   void init();
+
+   /**
+    * Process one RPC request (UDP payload) synchronously.
+    * @param p_req         In:   The request.
+    * @param len           In:   Length of the request.
+    */
+   void rpc(
+      uint8_t              *p_req,
+      uint16_t             len);
+
+   /**
+    * Run connect, parameter end and application ready, then feed some
+    * cyclic data frames.
+    * @return  0  if the AR reached the APPLRDY or DATA state.
+    *          -1 if an error occurred.
+    */
+   int connect();
+
+   /**
+    * Allocate a copy of bench_data_packet with the next cycle counter.
+    * @return  The frame, or NULL if out of buffers.
+    */
+   os_buf_t *data_frame();
+
+   /**
+    * Find the first IOCR of a type in the connected AR.
+    * @param type          In:   PF_IOCR_TYPE_INPUT or PF_IOCR_TYPE_OUTPUT.
+    * @return  The IOCR, or NULL if not found.
+    */
+   pf_iocr_t *find_iocr(
+      pf_iocr_type_values_t type);
+
+private:
+   void TestBody() override {};
+
+   uint16_t                cycle_counter = 0;
+};
+
+/** Benchmark fixture with an initialized but unconnected stack. */
+class PnetBench : public benchmark::Fixture
+{
+public:
+   void SetUp(const benchmark::State&) override
+   {
+      stack.init();
+   };
+
+protected:
+   PnetBenchStack          stack;
+};
+
+/** Benchmark fixture with an AR connected by bench_connect_req. */
+class PnetConnectedBench : public PnetBench
+{
+public:
+   void SetUp(const benchmark::State&) override
+   {
+      stack.init();
+      connected = (stack.connect() == 0);
+   };
+
+protected:
+   bool                    connected = false;
+};
+
+#endif /* UTILS_FOR_BENCHMARK_H */
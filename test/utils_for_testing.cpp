@@ -495,6 +495,7 @@ void PnetIntegrationTestBase::available_modules_and_submodules_init()
 
 void PnetIntegrationTestBase::cfg_init()
 {
+   memset(&pnet_default_cfg, 0, sizeof(pnet_default_cfg));
    pnet_default_cfg.state_cb = my_state_ind;
    pnet_default_cfg.connect_cb = my_connect_ind;
    pnet_default_cfg.release_cb = my_release_ind;
@@ -556,6 +557,7 @@ void PnetIntegrationTestBase::cfg_init()
    pnet_default_cfg.ip_gateway.b = 168;
    pnet_default_cfg.ip_gateway.c = 1;
    pnet_default_cfg.ip_gateway.d = 1;
+   pnet_default_cfg.diag_nonvol_window_ms = 60 * 1000;    /* Tests use pf_diag_nonvol_flush() */
 
    pnet_default_cfg.im_0_data.vendor_id_hi = 0x00;
    pnet_default_cfg.im_0_data.vendor_id_lo = 0x01;